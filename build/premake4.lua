@@ -92,6 +92,19 @@ if not _OPTIONS["with-nacl"] then
 	--include "../opencl/gpu_rigidbody_pipeline2"
 	
 	include "../dynamics/profiler_test"
+	include "../dynamics/linear_math_bench"
+	include "../dynamics/island_solver_bench"
+	include "../dynamics/ray_batch_bench"
+	include "../dynamics/bvh_build_bench"
+	include "../dynamics/bullet_file_bench"
+	include "../dynamics/alloc_bench"
+	include "../dynamics/profile_trace_bench"
+	include "../dynamics/soft_body_bench"
+	include "../dynamics/sparse_sdf_bench"
+	include "../dynamics/heightfield_bench"
+	include "../dynamics/gimpact_bench"
+	include "../dynamics/convex_batch_bench"
+	include "../dynamics/dbvt_broadphase_bench"
 	--include "../Lua"
 	
 	
@@ -108,6 +121,10 @@ if _OPTIONS["with-pe"] then
 	include "../physics_effects/sample_api_physics_effects/4_motion_type"
 	include "../physics_effects/sample_api_physics_effects/5_raycast"
 	include "../physics_effects/sample_api_physics_effects/6_joint"
+	include "../physics_effects/sample_api_physics_effects/7_broadphase_bench"
+	include "../physics_effects/sample_api_physics_effects/8_sort_bench"
+	include "../physics_effects/sample_api_physics_effects/9_raycast_bench"
+	include "../physics_effects/sample_api_physics_effects/10_mesh_cache"
 
 end
 	
@@ -151,6 +151,8 @@ public:
 	
 	virtual void	rayTest(const btVector3& rayFrom,const btVector3& rayTo, btBroadphaseRayCallback& rayCallback, const btVector3& aabbMin=btVector3(0,0,0), const btVector3& aabbMax = btVector3(0,0,0));
 	virtual void	aabbTest(const btVector3& aabbMin, const btVector3& aabbMax, btBroadphaseAabbCallback& callback);
+	virtual void	prepareRayTestPackets();
+	virtual void	rayTestPacket(const btRayPacket& packet, btBroadphaseRayPacketCallback& callback);
 
 	
 	void quantize(BP_FP_INT_TYPE* out, const btVector3& point, int isMax) const;
@@ -312,6 +314,27 @@ void	btAxisSweep3Internal<BP_FP_INT_TYPE>::aabbTest(const btVector3& aabbMin, co
 	}
 }
 
+template <typename BP_FP_INT_TYPE>
+void	btAxisSweep3Internal<BP_FP_INT_TYPE>::prepareRayTestPackets()
+{
+	if (m_raycastAccelerator)
+	{
+		m_raycastAccelerator->prepareRayTestPackets();
+	}
+}
+
+template <typename BP_FP_INT_TYPE>
+void	btAxisSweep3Internal<BP_FP_INT_TYPE>::rayTestPacket(const btRayPacket& packet, btBroadphaseRayPacketCallback& callback)
+{
+	if (m_raycastAccelerator)
+	{
+		m_raycastAccelerator->rayTestPacket(packet,callback);
+	} else
+	{
+		btBroadphaseInterface::rayTestPacket(packet,callback);
+	}
+}
+
 
 
 template <typename BP_FP_INT_TYPE>
@@ -43,7 +43,16 @@ struct	btBroadphaseRayCallback : public btBroadphaseAabbCallback
 	virtual ~btBroadphaseRayCallback() {}
 };
 
+///btBroadphaseRayPacketCallback receives the proxies found by btBroadphaseInterface::rayTestPacket
+struct	btBroadphaseRayPacketCallback
+{
+	virtual ~btBroadphaseRayPacketCallback() {}
+	///bit i of rayMask is set when ray i of the packet may hit the proxy
+	virtual bool	process(const btBroadphaseProxy* proxy,int rayMask) = 0;
+};
+
 #include "LinearMath/btVector3.h"
+#include "btRayPacket.h"
 
 ///The btBroadphaseInterface class provides an interface to detect aabb-overlapping object pairs.
 ///Some implementations for this broadphase interface include btAxisSweep3, bt32BitAxisSweep3 and btDbvtBroadphase.
@@ -62,6 +71,35 @@ public:
 
 	virtual void	aabbTest(const btVector3& aabbMin, const btVector3& aabbMax, btBroadphaseAabbCallback& callback) = 0;
 
+	///prepareRayTestPackets is called before rayTestPacket, on the calling thread, to bring lazily updated structures up to date
+	virtual void	prepareRayTestPackets() {}
+
+	///rayTestPacket calls the callback for the proxies the rays of the packet may hit, as rayTest does for a single ray.
+	///It is called from several threads at once by btCollisionWorld::rayTestBatch, so it must not modify the broadphase.
+	///The default implementation reports the proxies overlapping the bounding box of the packet to all its rays.
+	virtual void	rayTestPacket(const btRayPacket& packet, btBroadphaseRayPacketCallback& callback)
+	{
+		struct	PacketAabbCallback : public btBroadphaseAabbCallback
+		{
+			btBroadphaseRayPacketCallback&	m_packetCallback;
+			int								m_rayMask;
+
+			PacketAabbCallback(btBroadphaseRayPacketCallback& packetCallback,int rayMask)
+				:m_packetCallback(packetCallback),
+				m_rayMask(rayMask)
+			{
+			}
+			virtual bool	process(const btBroadphaseProxy* proxy)
+			{
+				return m_packetCallback.process(proxy,m_rayMask);
+			}
+		};
+		PacketAabbCallback aabbCallback(callback,packet.getActiveMask());
+		btVector3 aabbMin,aabbMax;
+		packet.getAabb(aabbMin,aabbMax);
+		aabbTest(aabbMin,aabbMax,aabbCallback);
+	}
+
 	///calculateOverlappingPairs is optional: incremental algorithms (sweep and prune) might do it during the set aabb
 	virtual void	calculateOverlappingPairs(btDispatcher* dispatcher)=0;
 
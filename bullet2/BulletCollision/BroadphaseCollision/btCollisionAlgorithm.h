@@ -25,6 +25,7 @@ class btManifoldResult;
 class btCollisionObject;
 struct btDispatcherInfo;
 class	btPersistentManifold;
+class	btConvexConvexAlgorithm;
 
 typedef btAlignedObjectArray<btPersistentManifold*>	btManifoldArray;
 
@@ -74,6 +75,12 @@ public:
 	virtual btScalar calculateTimeOfImpact(btCollisionObject* body0,btCollisionObject* body1,const btDispatcherInfo& dispatchInfo,btManifoldResult* resultOut) = 0;
 
 	virtual	void	getAllContactManifolds(btManifoldArray&	manifoldArray) = 0;
+
+	///returns the algorithm if it is a btConvexConvexAlgorithm, whose separation the dispatcher can bound in batches
+	virtual	btConvexConvexAlgorithm*	getConvexConvexAlgorithm()
+	{
+		return 0;
+	}
 };
 
 
@@ -21,6 +21,8 @@ subject to the following restrictions:
 #include "LinearMath/btVector3.h"
 #include "LinearMath/btTransform.h"
 #include "LinearMath/btAabbUtil2.h"
+#include "LinearMath/btArenaAllocator.h"
+#include "btRayPacket.h"
 
 //
 // Compile time configuration
@@ -328,6 +330,12 @@ struct	btDbvt
 		const btVector3& rayFrom,
 		const btVector3& rayTo,
 		DBVT_IPOLICY);
+	///rayTestPacket is a re-entrant test of all rays of a btRayPacket at once, it reports the leaves one of them hits.
+	///The maximum fractions of the packet are read at every node, so the policy can lower them.
+	DBVT_PREFIX
+		static void		rayTestPacket(	const btDbvtNode* root,
+		const btRayPacket& packet,
+		DBVT_IPOLICY);
 	///rayTestInternal is faster than rayTest, because it uses a persistent stack (to reduce dynamic memory allocations to a minimum) and it uses precomputed signs/rayInverseDirections
 	///rayTestInternal is used by btDbvtBroadphase to accelerate world ray casts
 	DBVT_PREFIX
@@ -717,7 +725,9 @@ inline void		btDbvt::collideTT(	const btDbvtNode* root0,
 		{
 			int								depth=1;
 			int								treshold=DOUBLE_STACKSIZE-4;
+			btScratchScope					scratch;
 			btAlignedObjectArray<sStkNN>	stkStack;
+			scratch.reserve(stkStack,DOUBLE_STACKSIZE);
 			stkStack.resize(DOUBLE_STACKSIZE);
 			stkStack[0]=sStkNN(root0,root1);
 			do	{		
@@ -848,7 +858,9 @@ inline void		btDbvt::collideTT(	const btDbvtNode* root0,
 		{
 			int								depth=1;
 			int								treshold=DOUBLE_STACKSIZE-4;
+			btScratchScope					scratch;
 			btAlignedObjectArray<sStkNN>	stkStack;
+			scratch.reserve(stkStack,DOUBLE_STACKSIZE);
 			stkStack.resize(DOUBLE_STACKSIZE);
 			stkStack[0]=sStkNN(root0,root1);
 			do	{
@@ -914,9 +926,10 @@ inline void		btDbvt::collideTV(	const btDbvtNode* root,
 		if(root)
 		{
 			ATTRIBUTE_ALIGNED16(btDbvtVolume)		volume(vol);
+			btScratchScope					scratch;
 			btAlignedObjectArray<const btDbvtNode*>	stack;
 			stack.resize(0);
-			stack.reserve(SIMPLE_STACKSIZE);
+			scratch.reserve(stack,SIMPLE_STACKSIZE);
 			stack.push_back(root);
 			do	{
 				const btDbvtNode*	n=stack[stack.size()-1];
@@ -1013,11 +1026,13 @@ inline void		btDbvt::rayTest(	const btDbvtNode* root,
 
 			btVector3 resultNormal;
 
+			btScratchScope					scratch;
 			btAlignedObjectArray<const btDbvtNode*>	stack;
 
 			int								depth=1;
 			int								treshold=DOUBLE_STACKSIZE-2;
 
+			scratch.reserve(stack,DOUBLE_STACKSIZE);
 			stack.resize(DOUBLE_STACKSIZE);
 			stack[0]=root;
 			btVector3 bounds[2];
@@ -1058,6 +1073,45 @@ inline void		btDbvt::rayTest(	const btDbvtNode* root,
 		}
 }
 
+//
+DBVT_PREFIX
+inline void		btDbvt::rayTestPacket(	const btDbvtNode* root,
+										const btRayPacket& packet,
+										DBVT_IPOLICY)
+{
+	DBVT_CHECKTYPE
+		if(root)
+		{
+			btScratchScope					scratch;
+			btAlignedObjectArray<const btDbvtNode*>	stack;
+			int								depth=1;
+			int								treshold=DOUBLE_STACKSIZE-2;
+			scratch.reserve(stack,DOUBLE_STACKSIZE);
+			stack.resize(DOUBLE_STACKSIZE);
+			stack[0]=root;
+			do	{
+				const btDbvtNode*	node=stack[--depth];
+				if(packet.testAabb(node->volume.Mins(),node->volume.Maxs()))
+				{
+					if(node->isinternal())
+					{
+						if(depth>treshold)
+						{
+							stack.resize(stack.size()*2);
+							treshold=stack.size()-2;
+						}
+						stack[depth++]=node->childs[0];
+						stack[depth++]=node->childs[1];
+					}
+					else
+					{
+						policy.Process(node);
+					}
+				}
+			} while(depth);
+		}
+}
+
 //
 DBVT_PREFIX
 inline void		btDbvt::collideKDOP(const btDbvtNode* root,
@@ -1070,6 +1124,7 @@ inline void		btDbvt::collideKDOP(const btDbvtNode* root,
 		if(root)
 		{
 			const int						inside=(1<<count)-1;
+			btScratchScope					scratch;
 			btAlignedObjectArray<sStkNP>	stack;
 			int								signs[sizeof(unsigned)*8];
 			btAssert(count<int (sizeof(signs)/sizeof(signs[0])));
@@ -1079,7 +1134,7 @@ inline void		btDbvt::collideKDOP(const btDbvtNode* root,
 					((normals[i].y()>=0)?2:0)+
 					((normals[i].z()>=0)?4:0);
 			}
-			stack.reserve(SIMPLE_STACKSIZE);
+			scratch.reserve(stack,SIMPLE_STACKSIZE);
 			stack.push_back(sStkNP(root,0));
 			do	{
 				sStkNP	se=stack[stack.size()-1];
@@ -1130,6 +1185,7 @@ inline void		btDbvt::collideOCL(	const btDbvtNode* root,
 				(sortaxis[1]>=0?2:0)+
 				(sortaxis[2]>=0?4:0);
 			const int						inside=(1<<count)-1;
+			btScratchScope					scratch;
 			btAlignedObjectArray<sStkNPS>	stock;
 			btAlignedObjectArray<int>		ifree;
 			btAlignedObjectArray<int>		stack;
@@ -1141,9 +1197,9 @@ inline void		btDbvt::collideOCL(	const btDbvtNode* root,
 					((normals[i].y()>=0)?2:0)+
 					((normals[i].z()>=0)?4:0);
 			}
-			stock.reserve(SIMPLE_STACKSIZE);
-			stack.reserve(SIMPLE_STACKSIZE);
-			ifree.reserve(SIMPLE_STACKSIZE);
+			scratch.reserve(stock,SIMPLE_STACKSIZE);
+			scratch.reserve(stack,SIMPLE_STACKSIZE);
+			scratch.reserve(ifree,SIMPLE_STACKSIZE);
 			stack.push_back(allocate(ifree,stock,sStkNPS(root,0,root->volume.ProjectMinimum(sortaxis,srtsgns))));
 			do	{
 				const int	id=stack[stack.size()-1];
@@ -1219,8 +1275,9 @@ inline void		btDbvt::collideTU(	const btDbvtNode* root,
 	DBVT_CHECKTYPE
 		if(root)
 		{
+			btScratchScope					scratch;
 			btAlignedObjectArray<const btDbvtNode*>	stack;
-			stack.reserve(SIMPLE_STACKSIZE);
+			scratch.reserve(stack,SIMPLE_STACKSIZE);
 			stack.push_back(root);
 			do	{
 				const btDbvtNode*	n=stack[stack.size()-1];
@@ -16,6 +16,7 @@ subject to the following restrictions:
 ///btDbvtBroadphase implementation by Nathanael Presson
 
 #include "btDbvtBroadphase.h"
+#include "LinearMath/btHashMap.h"
 
 //
 // Profiling
@@ -114,6 +115,92 @@ struct	btDbvtTreeCollider : btDbvt::ICollide
 	}
 };
 
+/* Pair collector, one per thread in parallel mode	*/ 
+struct	btDbvtTreePairCollector : btDbvt::ICollide
+{
+	btAlignedObjectArray<btDbvtProxy*>*	pairs;
+	void	Process(const btDbvtNode* na,const btDbvtNode* nb)
+	{
+		if(na!=nb)
+		{
+			pairs->push_back((btDbvtProxy*)na->data);
+			pairs->push_back((btDbvtProxy*)nb->data);
+		}
+	}
+};
+
+/* Tree against tree tasks	*/ 
+struct	btDbvtCollideTasksLoop : btIParallelForBody
+{
+	btDbvtBroadphase*	pbp;
+	void	forLoop(int iBegin,int iEnd) const
+	{
+		const int					thread=btGetCurrentThreadIndex();
+		btDbvtTreePairCollector		collector;
+		collector.pairs=&pbp->m_threadpairs[thread]->pairs;
+		for(int i=iBegin;i<iEnd;++i)
+		{
+			btDbvtBroadphase::sCollideTask&	task=pbp->m_collidetasks[i];
+			task.thread=thread;
+			task.begin=collector.pairs->size();
+			pbp->m_sets[0].collideTT(task.a,task.b,collector);
+			task.end=collector.pairs->size();
+		}
+	}
+};
+
+/* Leaf update without reinsertion, same bounds as btDbvt::update	*/ 
+static inline bool	refitleaf(btDbvtNode* leaf,btDbvtVolume& volume,const btVector3& velocity)
+{
+	if(leaf->volume.Contain(volume)) return(false);
+#ifdef DBVT_BP_MARGIN
+	volume.Expand(btVector3(DBVT_BP_MARGIN,DBVT_BP_MARGIN,DBVT_BP_MARGIN));
+#endif
+	volume.SignedExpand(velocity);
+	leaf->volume=volume;
+	return(true);
+}
+
+//
+static void			refitsubtree(btDbvtNode* node)
+{
+	if(node->isinternal())
+	{
+		refitsubtree(node->childs[0]);
+		refitsubtree(node->childs[1]);
+		Merge(node->childs[0]->volume,node->childs[1]->volume,node->volume);
+	}
+}
+
+/* Subtree refit tasks	*/ 
+struct	btDbvtRefitLoop : btIParallelForBody
+{
+	btDbvtNode**	subtrees;
+	void	forLoop(int iBegin,int iEnd) const
+	{
+		for(int i=iBegin;i<iEnd;++i)
+		{
+			refitsubtree(subtrees[i]);
+		}
+	}
+};
+
+/* Leaves of the shadow set	*/ 
+struct	btDbvtLeafCollector : btDbvt::ICollide
+{
+	btAlignedObjectArray<btDbvtNode*>*	leaves;
+	void	Process(const btDbvtNode* n)
+	{
+		leaves->push_back((btDbvtNode*)n);
+	}
+};
+
+//
+void	btDbvtBroadphase::sRebuildJob::run()
+{
+	set->optimizeTopDown(DBVT_BP_REBUILD_BOTTOMUP);
+}
+
 //
 // btDbvtBroadphase
 //
@@ -142,6 +229,13 @@ btDbvtBroadphase::btDbvtBroadphase(btOverlappingPairCache* paircache)
 	{
 		m_stageRoots[i]=0;
 	}
+	m_taskScheduler		=	0;
+	m_backgroundWorker	=	0;
+	m_rebuildjob.set	=	&m_shadowset;
+	m_rupdates			=	1000;
+	m_rebuildupdates	=	0;
+	m_shadowpending		=	false;
+	m_needrefit			=	false;
 #if DBVT_BP_PROFILE
 	clear(m_profiling);
 #endif
@@ -150,6 +244,12 @@ btDbvtBroadphase::btDbvtBroadphase(btOverlappingPairCache* paircache)
 //
 btDbvtBroadphase::~btDbvtBroadphase()
 {
+	btDeleteBackgroundWorker(m_backgroundWorker);
+	for(int i=0;i<m_threadpairs.size();++i)
+	{
+		m_threadpairs[i]->~sThreadPairs();
+		btAlignedFree(m_threadpairs[i]);
+	}
 	if(m_releasepaircache) 
 	{
 		m_paircache->~btOverlappingPairCache();
@@ -177,8 +277,9 @@ btBroadphaseProxy*				btDbvtBroadphase::createProxy(	const btVector3& aabbMin,
 	proxy->stage		=	m_stageCurrent;
 	proxy->m_uniqueId	=	++m_gid;
 	proxy->leaf			=	m_sets[0].insert(aabb,proxy);
+	logShadowChange(proxy,true);
 	listappend(proxy,m_stageRoots[m_stageCurrent]);
-	if(!m_deferedcollide)
+	if(!m_deferedcollide&&!m_taskScheduler)
 	{
 		btDbvtTreeCollider	collider(this);
 		collider.proxy=proxy;
@@ -196,7 +297,10 @@ void							btDbvtBroadphase::destroyProxy(	btBroadphaseProxy* absproxy,
 	if(proxy->stage==STAGECOUNT)
 		m_sets[1].remove(proxy->leaf);
 	else
+	{
 		m_sets[0].remove(proxy->leaf);
+		logShadowChange(proxy,false);
+	}
 	listremove(proxy,m_stageRoots[proxy->stage]);
 	m_paircache->removeOverlappingPairsContainingProxy(proxy,dispatcher);
 	btAlignedFree(proxy);
@@ -228,6 +332,8 @@ void	btDbvtBroadphase::rayTest(const btVector3& rayFrom,const btVector3& rayTo,
 {
 	BroadphaseRayTester callback(rayCallback);
 
+	if(m_needrefit) refit();
+
 	m_sets[0].rayTestInternal(	m_sets[0].m_root,
 		rayFrom,
 		rayTo,
@@ -269,6 +375,8 @@ void	btDbvtBroadphase::aabbTest(const btVector3& aabbMin,const btVector3& aabbMa
 {
 	BroadphaseAabbTester callback(aabbCallback);
 
+	if(m_needrefit) refit();
+
 	const ATTRIBUTE_ALIGNED16(btDbvtVolume)	bounds=btDbvtVolume::FromMM(aabbMin,aabbMax);
 		//process all children, that overlap with  the given AABB bounds
 	m_sets[0].collideTV(m_sets[0].m_root,bounds,callback);
@@ -276,6 +384,41 @@ void	btDbvtBroadphase::aabbTest(const btVector3& aabbMin,const btVector3& aabbMa
 
 }
 
+//
+void	btDbvtBroadphase::prepareRayTestPackets()
+{
+	if(m_needrefit) refit();
+}
+
+//
+struct	BroadphaseRayPacketTester : btDbvt::ICollide
+{
+	const btRayPacket&				m_packet;
+	btBroadphaseRayPacketCallback&	m_packetCallback;
+	BroadphaseRayPacketTester(const btRayPacket& packet,btBroadphaseRayPacketCallback& orgCallback)
+		:m_packet(packet),
+		m_packetCallback(orgCallback)
+	{
+	}
+	void					Process(const btDbvtNode* leaf)
+	{
+		const int		rayMask=m_packet.testAabb(leaf->volume.Mins(),leaf->volume.Maxs());
+		if(rayMask)
+		{
+			btDbvtProxy*	proxy=(btDbvtProxy*)leaf->data;
+			m_packetCallback.process(proxy,rayMask);
+		}
+	}
+};
+
+//
+void	btDbvtBroadphase::rayTestPacket(const btRayPacket& packet,btBroadphaseRayPacketCallback& packetCallback)
+{
+	BroadphaseRayPacketTester callback(packet,packetCallback);
+	btDbvt::rayTestPacket(m_sets[0].m_root,packet,callback);
+	btDbvt::rayTestPacket(m_sets[1].m_root,packet,callback);
+}
+
 
 
 //
@@ -295,6 +438,7 @@ void							btDbvtBroadphase::setAabb(		btBroadphaseProxy* absproxy,
 		{/* fixed -> dynamic set	*/ 
 			m_sets[1].remove(proxy->leaf);
 			proxy->leaf=m_sets[0].insert(aabb,proxy);
+			logShadowChange(proxy,true);
 			docollide=true;
 		}
 		else
@@ -308,13 +452,22 @@ void							btDbvtBroadphase::setAabb(		btBroadphaseProxy* absproxy,
 				if(delta[0]<0) velocity[0]=-velocity[0];
 				if(delta[1]<0) velocity[1]=-velocity[1];
 				if(delta[2]<0) velocity[2]=-velocity[2];
-				if	(
+				bool	updated;
+				if(m_taskScheduler)
+				{/* Refit the leaf only, collide refits its parents	*/ 
+					updated=refitleaf(proxy->leaf,aabb,velocity);
+					m_needrefit|=updated;
+					m_rebuildupdates+=updated;
+				}
+				else
+				{
 #ifdef DBVT_BP_MARGIN				
-					m_sets[0].update(proxy->leaf,aabb,velocity,DBVT_BP_MARGIN)
+					updated=m_sets[0].update(proxy->leaf,aabb,velocity,DBVT_BP_MARGIN);
 #else
-					m_sets[0].update(proxy->leaf,aabb,velocity)
+					updated=m_sets[0].update(proxy->leaf,aabb,velocity);
 #endif
-					)
+				}
+				if(updated)
 				{
 					++m_updates_done;
 					docollide=true;
@@ -335,7 +488,7 @@ void							btDbvtBroadphase::setAabb(		btBroadphaseProxy* absproxy,
 		if(docollide)
 		{
 			m_needcleanup=true;
-			if(!m_deferedcollide)
+			if(!m_deferedcollide&&!m_taskScheduler)
 			{
 				btDbvtTreeCollider	collider(this);
 				m_sets[1].collideTTpersistentStack(m_sets[1].m_root,proxy->leaf,collider);
@@ -359,6 +512,7 @@ void							btDbvtBroadphase::setAabbForceUpdate(		btBroadphaseProxy* absproxy,
 	{/* fixed -> dynamic set	*/ 
 		m_sets[1].remove(proxy->leaf);
 		proxy->leaf=m_sets[0].insert(aabb,proxy);
+		logShadowChange(proxy,true);
 		docollide=true;
 	}
 	else
@@ -377,7 +531,7 @@ void							btDbvtBroadphase::setAabbForceUpdate(		btBroadphaseProxy* absproxy,
 	if(docollide)
 	{
 		m_needcleanup=true;
-		if(!m_deferedcollide)
+		if(!m_deferedcollide&&!m_taskScheduler)
 		{
 			btDbvtTreeCollider	collider(this);
 			m_sets[1].collideTTpersistentStack(m_sets[1].m_root,proxy->leaf,collider);
@@ -507,6 +661,11 @@ void							btDbvtBroadphase::collide(btDispatcher* dispatcher)
 
 
 	SPC(m_profiling.m_total);
+	if(m_taskScheduler)
+	{
+		swapShadowSet();
+		if(m_needrefit) refit();
+	}
 	/* optimize				*/ 
 	m_sets[0].optimizeIncremental(1+(m_sets[0].m_leaves*m_dupdates)/100);
 	if(m_fixedleft)
@@ -532,6 +691,7 @@ void							btDbvtBroadphase::collide(btDispatcher* dispatcher)
 			btDbvt::collideTV(m_sets[1].m_root,current->aabb,collider);
 #endif
 			m_sets[0].remove(current->leaf);
+			logShadowChange(current,false);
 			ATTRIBUTE_ALIGNED16(btDbvtVolume)	curAabb=btDbvtVolume::FromMM(current->m_aabbMin,current->m_aabbMax);
 			current->leaf	=	m_sets[1].insert(curAabb,current);
 			current->stage	=	STAGECOUNT;	
@@ -541,6 +701,18 @@ void							btDbvtBroadphase::collide(btDispatcher* dispatcher)
 		m_needcleanup=true;
 	}
 	/* collide dynamics		*/ 
+	if(m_taskScheduler)
+	{
+		{
+			SPC(m_profiling.m_fdcollide);
+			collideParallel(m_sets[0].m_root,m_sets[1].m_root);
+		}
+		{
+			SPC(m_profiling.m_ddcollide);
+			collideParallel(m_sets[0].m_root,m_sets[0].m_root);
+		}
+	}
+	else
 	{
 		btDbvtTreeCollider	collider(this);
 		if(m_deferedcollide)
@@ -590,6 +762,11 @@ void							btDbvtBroadphase::collide(btDispatcher* dispatcher)
 	{ m_updates_ratio=0; }
 	m_updates_done/=2;
 	m_updates_call/=2;
+	/* overlaps with the rest of the frame	*/ 
+	if(m_backgroundWorker&&(m_rebuildupdates*100>=m_sets[0].m_leaves*m_rupdates))
+	{
+		startShadowRebuild();
+	}
 }
 
 //
@@ -599,6 +776,218 @@ void							btDbvtBroadphase::optimize()
 	m_sets[1].optimizeTopDown();
 }
 
+//
+void							btDbvtBroadphase::setTaskScheduler(btITaskScheduler* scheduler)
+{
+	/* the serial mode needs refit parents	*/ 
+	if(m_needrefit) refit();
+	m_taskScheduler=scheduler;
+	if(scheduler)
+	{
+		while(m_threadpairs.size()<scheduler->getMaxNumThreads())
+		{
+			m_threadpairs.push_back(new(btAlignedAlloc(sizeof(sThreadPairs),16)) sThreadPairs());
+		}
+		if(!m_backgroundWorker)
+		{
+			m_backgroundWorker=btCreateBackgroundWorker();
+		}
+	}
+	else
+	{
+		btDeleteBackgroundWorker(m_backgroundWorker);
+		m_backgroundWorker=0;
+		m_shadowpending=false;
+		m_shadowchanges.resize(0);
+		m_shadowset.clear();
+	}
+}
+
+//
+void							btDbvtBroadphase::refit()
+{
+	m_needrefit=false;
+	btDbvtNode*	root=m_sets[0].m_root;
+	if(!root) return;
+	if(!m_taskScheduler)
+	{
+		refitsubtree(root);
+		return;
+	}
+	/* split the top of the tree into subtrees	*/ 
+	m_refittop.resize(0);
+	m_refitsubtrees.resize(0);
+	m_refitsubtrees.push_back(root);
+	while(m_refitsubtrees.size()<DBVT_BP_PARALLEL_TASKS)
+	{
+		bool	split=false;
+		m_splitsubtrees.resize(0);
+		for(int i=0;i<m_refitsubtrees.size();++i)
+		{
+			btDbvtNode*	node=m_refitsubtrees[i];
+			if(node->isinternal())
+			{
+				m_refittop.push_back(node);
+				m_splitsubtrees.push_back(node->childs[0]);
+				m_splitsubtrees.push_back(node->childs[1]);
+				split=true;
+			}
+			else
+			{
+				m_splitsubtrees.push_back(node);
+			}
+		}
+		m_refitsubtrees.copyFromArray(m_splitsubtrees);
+		if(!split) break;
+	}
+	/* subtrees in parallel, then the nodes above them bottom-up	*/ 
+	btDbvtRefitLoop	loop;
+	loop.subtrees=&m_refitsubtrees[0];
+	m_taskScheduler->parallelFor(0,m_refitsubtrees.size(),1,loop);
+	for(int i=m_refittop.size()-1;i>=0;--i)
+	{
+		btDbvtNode*	node=m_refittop[i];
+		Merge(node->childs[0]->volume,node->childs[1]->volume,node->volume);
+	}
+}
+
+//
+void							btDbvtBroadphase::collideParallel(const btDbvtNode* root0,const btDbvtNode* root1)
+{
+	if(!root0||!root1) return;
+	/* split the tree pair the way collideTT descends it, independent of the number of threads	*/ 
+	m_collidetasks.resize(0);
+	sCollideTask&	roottask=m_collidetasks.expand();
+	roottask.a=root0;
+	roottask.b=root1;
+	while(m_collidetasks.size()<DBVT_BP_PARALLEL_TASKS)
+	{
+		bool	split=false;
+		m_splittasks.resize(0);
+		for(int i=0;i<m_collidetasks.size();++i)
+		{
+			const btDbvtNode*	a=m_collidetasks[i].a;
+			const btDbvtNode*	b=m_collidetasks[i].b;
+			const btDbvtNode*	sa[2]={a,a};
+			const btDbvtNode*	sb[2]={b,b};
+			int					na=1,nb=1;
+			if(a==b)
+			{
+				if(a->isinternal())
+				{
+					sCollideTask&	t0=m_splittasks.expand();t0.a=a->childs[0];t0.b=a->childs[0];
+					sCollideTask&	t1=m_splittasks.expand();t1.a=a->childs[1];t1.b=a->childs[1];
+					sCollideTask&	t2=m_splittasks.expand();t2.a=a->childs[0];t2.b=a->childs[1];
+					split=true;
+				}
+				continue;
+			}
+			if(!Intersect(a->volume,b->volume)) continue;
+			if(a->isinternal()) { sa[0]=a->childs[0];sa[1]=a->childs[1];na=2; }
+			if(b->isinternal()) { sb[0]=b->childs[0];sb[1]=b->childs[1];nb=2; }
+			split|=(na*nb)>1;
+			for(int j=0;j<nb;++j)
+			{
+				for(int k=0;k<na;++k)
+				{
+					sCollideTask&	t=m_splittasks.expand();
+					t.a=sa[k];
+					t.b=sb[j];
+				}
+			}
+		}
+		m_collidetasks.copyFromArray(m_splittasks);
+		if(!split) break;
+	}
+	/* collect the pairs in parallel	*/ 
+	for(int i=0;i<m_threadpairs.size();++i)
+	{
+		m_threadpairs[i]->pairs.resize(0);
+	}
+	btAssert(m_threadpairs.size()>=m_taskScheduler->getNumThreads());
+	btDbvtCollideTasksLoop	loop;
+	loop.pbp=this;
+	m_taskScheduler->parallelFor(0,m_collidetasks.size(),1,loop);
+	/* the pair cache is not thread safe, add them in task order	*/ 
+	for(int i=0;i<m_collidetasks.size();++i)
+	{
+		const sCollideTask&						task=m_collidetasks[i];
+		const btAlignedObjectArray<btDbvtProxy*>&	pairs=m_threadpairs[task.thread]->pairs;
+		for(int j=task.begin;j<task.end;j+=2)
+		{
+			btDbvtProxy*	pa=pairs[j];
+			btDbvtProxy*	pb=pairs[j+1];
+#if DBVT_BP_SORTPAIRS
+			if(pa->m_uniqueId>pb->m_uniqueId) 
+				btSwap(pa,pb);
+#endif
+			m_paircache->addOverlappingPair(pa,pb);
+			++m_newpairs;
+		}
+	}
+}
+
+//
+void							btDbvtBroadphase::swapShadowSet()
+{
+	if(!m_shadowpending) return;
+	m_backgroundWorker->wait();
+	m_shadowpending=false;
+	/* last change of each proxy, the proxies removed meanwhile may be deleted	*/ 
+	btHashMap<btHashPtr,int>	lastchange;
+	int							i;
+	for(i=0;i<m_shadowchanges.size();++i)
+	{
+		lastchange.insert(btHashPtr(m_shadowchanges[i].proxy),i);
+	}
+	/* remove their cloned leaves, relink the others with their current volumes	*/ 
+	btDbvtLeafCollector	collector;
+	collector.leaves=&m_shadowleaves;
+	m_shadowleaves.resize(0);
+	btDbvt::enumLeaves(m_shadowset.m_root,collector);
+	for(i=0;i<m_shadowleaves.size();++i)
+	{
+		btDbvtNode*	leaf=m_shadowleaves[i];
+		if(lastchange.find(btHashPtr(leaf->data)))
+			m_shadowset.remove(leaf);
+		else
+		{
+			btDbvtProxy*	proxy=(btDbvtProxy*)leaf->data;
+			leaf->volume=proxy->leaf->volume;
+			proxy->leaf=leaf;
+		}
+	}
+	/* reinsert the proxies that are in the dynamic set now	*/ 
+	for(i=0;i<m_shadowchanges.size();++i)
+	{
+		const sShadowChange&	change=m_shadowchanges[i];
+		if(change.insert&&(*lastchange.find(btHashPtr(change.proxy))==i))
+		{
+			change.proxy->leaf=m_shadowset.insert(change.proxy->leaf->volume,change.proxy);
+		}
+	}
+	m_shadowchanges.resize(0);
+	btSwap(m_sets[0].m_root,m_shadowset.m_root);
+	btSwap(m_sets[0].m_free,m_shadowset.m_free);
+	btSwap(m_sets[0].m_lkhd,m_shadowset.m_lkhd);
+	btSwap(m_sets[0].m_leaves,m_shadowset.m_leaves);
+	btSwap(m_sets[0].m_opath,m_shadowset.m_opath);
+	m_shadowset.clear();
+	m_needrefit=true;
+}
+
+//
+void							btDbvtBroadphase::startShadowRebuild()
+{
+	if(m_shadowpending) return;
+	m_rebuildupdates=0;
+	btDbvt::IClone	noclone;
+	m_sets[0].clone(m_shadowset,&noclone);
+	m_shadowset.m_leaves=m_sets[0].m_leaves;
+	m_shadowpending=true;
+	m_backgroundWorker->start(&m_rebuildjob);
+}
+
 //
 btOverlappingPairCache*			btDbvtBroadphase::getOverlappingPairCache()
 {
@@ -638,6 +1027,7 @@ void btDbvtBroadphase::resetPool(btDispatcher* dispatcher)
 		//reset internal dynamic tree data structures
 		m_sets[0].clear();
 		m_sets[1].clear();
+		m_needrefit			=	false;
 		
 		m_deferedcollide	=	false;
 		m_needcleanup		=	true;
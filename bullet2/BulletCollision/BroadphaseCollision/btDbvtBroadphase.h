@@ -19,6 +19,7 @@ subject to the following restrictions:
 
 #include "BulletCollision/BroadphaseCollision/btDbvt.h"
 #include "BulletCollision/BroadphaseCollision/btOverlappingPairCache.h"
+#include "LinearMath/btThreads.h"
 
 //
 // Compile time config
@@ -30,6 +31,8 @@ subject to the following restrictions:
 #define DBVT_BP_ACCURATESLEEPING		0
 #define DBVT_BP_ENABLE_BENCHMARK		0
 #define DBVT_BP_MARGIN					(btScalar)0.05
+#define DBVT_BP_PARALLEL_TASKS			64	/* Number of tasks parallel refit and pair finding are split into	*/ 
+#define DBVT_BP_REBUILD_BOTTOMUP		16	/* Background rebuilds split top-down until this number of leaves	*/ 
 
 #if DBVT_BP_PROFILE
 #define	DBVT_BP_PROFILING_RATE	256
@@ -87,6 +90,45 @@ struct	btDbvtBroadphase : btBroadphaseInterface
 	bool					m_releasepaircache;			// Release pair cache on delete
 	bool					m_deferedcollide;			// Defere dynamic/static collision to collide call
 	bool					m_needcleanup;				// Need to run cleanup?
+	/* Parallel mode	*/ 
+	struct	sCollideTask
+	{
+		const btDbvtNode*	a;
+		const btDbvtNode*	b;
+		int					thread;						// Thread that collected the pairs
+		int					begin;						// First pair in the thread pairs
+		int					end;
+	};
+	struct	sThreadPairs
+	{
+		btAlignedObjectArray<btDbvtProxy*>	pairs;		// Two proxies per pair
+	};
+	struct	sRebuildJob : btIBackgroundJob
+	{
+		btDbvt*				set;
+		void				run();
+	};
+	struct	sShadowChange
+	{
+		btDbvtProxy*		proxy;
+		bool				insert;						// Inserted into or removed from the dynamic set
+	};
+	btITaskScheduler*		m_taskScheduler;			// Parallel refit and pair finding
+	btIBackgroundWorker*	m_backgroundWorker;			// Rebuilds the dynamic set
+	btDbvt					m_shadowset;				// Dynamic set rebuilt in the background
+	sRebuildJob				m_rebuildjob;
+	int						m_rupdates;					// % of dynamic leaves updated before a background rebuild
+	int						m_rebuildupdates;			// Dynamic leaves updated since the last rebuild
+	bool					m_shadowpending;			// Shadow set rebuild started
+	bool					m_needrefit;				// Dynamic leaves changed, their parents are not refit yet
+	btAlignedObjectArray<sShadowChange>		m_shadowchanges;	// Dynamic set changes since the shadow set was cloned
+	btAlignedObjectArray<btDbvtNode*>		m_shadowleaves;
+	btAlignedObjectArray<sThreadPairs*>		m_threadpairs;
+	btAlignedObjectArray<sCollideTask>		m_collidetasks;
+	btAlignedObjectArray<sCollideTask>		m_splittasks;
+	btAlignedObjectArray<btDbvtNode*>		m_refittop;
+	btAlignedObjectArray<btDbvtNode*>		m_refitsubtrees;
+	btAlignedObjectArray<btDbvtNode*>		m_splitsubtrees;
 #if DBVT_BP_PROFILE
 	btClock					m_clock;
 	struct	{
@@ -102,6 +144,32 @@ struct	btDbvtBroadphase : btBroadphaseInterface
 	~btDbvtBroadphase();
 	void							collide(btDispatcher* dispatcher);
 	void							optimize();
+
+	///setTaskScheduler switches to the parallel mode, pass 0 to switch back. The scheduler is not owned by the broadphase.
+	///Moving proxies only refit their leaf, collide refits the dynamic set bottom-up and finds the pairs (as with m_deferedcollide)
+	///with tree against tree tests split into DBVT_BP_PARALLEL_TASKS tasks. The tasks are the same for any number of threads,
+	///so the pairs are added to the pair cache in the same order.
+	///After m_rupdates % of the dynamic leaves moved, a copy of the dynamic set is rebuilt top-down on a background thread
+	///and swapped in at the next collide, with the proxies created, destroyed or moved between the sets meanwhile patched in.
+	void							setTaskScheduler(btITaskScheduler* scheduler);
+	btITaskScheduler*				getTaskScheduler()
+	{
+		return m_taskScheduler;
+	}
+	///refits the parents of the dynamic leaves that moved in parallel mode; collide, rayTest and aabbTest call it when needed
+	void							refit();
+	void							collideParallel(const btDbvtNode* root0,const btDbvtNode* root1);
+	void							swapShadowSet();
+	void							startShadowRebuild();
+	void							logShadowChange(btDbvtProxy* proxy,bool insert)
+	{
+		if(m_shadowpending)
+		{
+			sShadowChange&	change=m_shadowchanges.expand();
+			change.proxy=proxy;
+			change.insert=insert;
+		}
+	}
 	
 	/* btBroadphaseInterface Implementation	*/
 	btBroadphaseProxy*				createProxy(const btVector3& aabbMin,const btVector3& aabbMax,int shapeType,void* userPtr,short int collisionFilterGroup,short int collisionFilterMask,btDispatcher* dispatcher,void* multiSapProxy);
@@ -109,6 +177,8 @@ struct	btDbvtBroadphase : btBroadphaseInterface
 	virtual void					setAabb(btBroadphaseProxy* proxy,const btVector3& aabbMin,const btVector3& aabbMax,btDispatcher* dispatcher);
 	virtual void					rayTest(const btVector3& rayFrom,const btVector3& rayTo, btBroadphaseRayCallback& rayCallback, const btVector3& aabbMin=btVector3(0,0,0), const btVector3& aabbMax = btVector3(0,0,0));
 	virtual void					aabbTest(const btVector3& aabbMin, const btVector3& aabbMax, btBroadphaseAabbCallback& callback);
+	virtual void					prepareRayTestPackets();
+	virtual void					rayTestPacket(const btRayPacket& packet, btBroadphaseRayPacketCallback& callback);
 
 	virtual void					getAabb(btBroadphaseProxy* proxy,btVector3& aabbMin, btVector3& aabbMax ) const;
 	virtual	void					calculateOverlappingPairs(btDispatcher* dispatcher);
@@ -18,16 +18,31 @@ subject to the following restrictions:
 #include "LinearMath/btAabbUtil2.h"
 #include "LinearMath/btIDebugDraw.h"
 #include "LinearMath/btSerializer.h"
+#include "LinearMath/btThreads.h"
 
 #define RAYAABB2
 
+///number of bins per axis of the binned SAH builder
+#define BT_BVH_SAH_BIN_COUNT 16
+///deeper ranges use the balanced median split, to bound the recursion depth of unbalanced SAH trees
+#define BT_BVH_SAH_MAX_DEPTH 48
+///the parallel build splits ranges of at least twice this many leaves into tasks
+#define BT_BVH_PARALLEL_BUILD_MIN_LEAVES 1024
+#define BT_BVH_PARALLEL_BUILD_TASKS 64
+///traversal stack of the wide nodes, trees too deep for it keep using the binary traversal
+#define BT_BVH_WIDE_STACK_SIZE 256
+
 btQuantizedBvh::btQuantizedBvh() : 
 					m_bulletVersion(BT_BULLET_VERSION),
+					m_curNodeIndex(0),
 					m_useQuantization(false), 
 					//m_traversalMode(TRAVERSAL_STACKLESS_CACHE_FRIENDLY)
 					m_traversalMode(TRAVERSAL_STACKLESS)
 					//m_traversalMode(TRAVERSAL_RECURSIVE)
 					,m_subtreeHeaderCount(0) //PCK: add this line
+					,m_buildMode(BUILD_MEDIAN_SPLIT)
+					,m_taskScheduler(0)
+					,m_useWideNodes(false)
 {
 	m_bvhAabbMin.setValue(-SIMD_INFINITY,-SIMD_INFINITY,-SIMD_INFINITY);
 	m_bvhAabbMax.setValue(SIMD_INFINITY,SIMD_INFINITY,SIMD_INFINITY);
@@ -71,6 +86,10 @@ void btQuantizedBvh::buildInternal()
 	//PCK: clear m_quantizedLeafNodes and m_leafNodes, they are temporary
 	m_quantizedLeafNodes.clear();
 	m_leafNodes.clear();
+
+	m_wideNodes.clear();
+	if (m_useWideNodes)
+		buildWideNodes();
 }
 
 
@@ -112,6 +131,30 @@ int gMaxStackDepth = 0;
 #endif //DEBUG_TREE_BUILDING
 
 void	btQuantizedBvh::buildTree	(int startIndex,int endIndex)
+{
+	int numIndices =endIndex-startIndex;
+	int rootNodeIndex = m_curNodeIndex;
+
+	btAssert(numIndices>0);
+
+	if (m_taskScheduler && numIndices >= 2*BT_BVH_PARALLEL_BUILD_MIN_LEAVES)
+	{
+		buildTreeParallel(startIndex,endIndex,rootNodeIndex);
+	} else
+	{
+		buildSubtree(startIndex,endIndex,rootNodeIndex,0);
+	}
+
+	//a binary tree with n leaves has 2n-1 nodes
+	m_curNodeIndex += 2*numIndices-1;
+
+	if (m_useQuantization)
+	{
+		addSubtreeHeaders(rootNodeIndex);
+	}
+}
+
+void	btQuantizedBvh::buildSubtree(int startIndex,int endIndex,int nodeIndex,int depth)
 {
 #ifdef DEBUG_TREE_BUILDING
 	gStackDepth++;
@@ -119,10 +162,7 @@ void	btQuantizedBvh::buildTree	(int startIndex,int endIndex)
 		gMaxStackDepth = gStackDepth;
 #endif //DEBUG_TREE_BUILDING
 
-
-	int splitAxis, splitIndex, i;
 	int numIndices =endIndex-startIndex;
-	int curIndex = m_curNodeIndex;
 
 	btAssert(numIndices>0);
 
@@ -132,66 +172,140 @@ void	btQuantizedBvh::buildTree	(int startIndex,int endIndex)
 		gStackDepth--;
 #endif //DEBUG_TREE_BUILDING
 		
-		assignInternalNodeFromLeafNode(m_curNodeIndex,startIndex);
-
-		m_curNodeIndex++;
+		assignInternalNodeFromLeafNode(nodeIndex,startIndex);
 		return;	
 	}
-	//calculate Best Splitting Axis and where to split it. Sort the incoming 'leafNodes' array within range 'startIndex/endIndex'.
-	
-	splitAxis = calcSplittingAxis(startIndex,endIndex);
 
-	splitIndex = sortAndCalcSplittingIndex(startIndex,endIndex,splitAxis);
+	int splitIndex = buildInternalNode(startIndex,endIndex,nodeIndex,depth);
+
+	//build left child tree, directly after this node
+	buildSubtree(startIndex,splitIndex,nodeIndex+1,depth+1);
+
+	//build right child tree, after the 2*(splitIndex-startIndex)-1 nodes of the left child tree
+	buildSubtree(splitIndex,endIndex,nodeIndex+2*(splitIndex-startIndex),depth+1);
+
+#ifdef DEBUG_TREE_BUILDING
+	gStackDepth--;
+#endif //DEBUG_TREE_BUILDING
+}
+
+int	btQuantizedBvh::buildInternalNode(int startIndex,int endIndex,int nodeIndex,int depth)
+{
+	int i, splitIndex = startIndex;
+
+	//calculate Best Splitting Axis and where to split it. Sort the incoming 'leafNodes' array within range 'startIndex/endIndex'.
+	if (m_buildMode == BUILD_BINNED_SAH && depth < BT_BVH_SAH_MAX_DEPTH)
+	{
+		splitIndex = sortAndCalcSahSplittingIndex(startIndex,endIndex);
+	}
+	if (splitIndex == startIndex)
+	{
+		int splitAxis = calcSplittingAxis(startIndex,endIndex);
+		splitIndex = sortAndCalcSplittingIndex(startIndex,endIndex,splitAxis);
+	}
 
-	int internalNodeIndex = m_curNodeIndex;
-	
 	//set the min aabb to 'inf' or a max value, and set the max aabb to a -inf/minimum value.
 	//the aabb will be expanded during buildTree/mergeInternalNodeAabb with actual node values
-	setInternalNodeAabbMin(m_curNodeIndex,m_bvhAabbMax);//can't use btVector3(SIMD_INFINITY,SIMD_INFINITY,SIMD_INFINITY)) because of quantization
-	setInternalNodeAabbMax(m_curNodeIndex,m_bvhAabbMin);//can't use btVector3(-SIMD_INFINITY,-SIMD_INFINITY,-SIMD_INFINITY)) because of quantization
-	
+	setInternalNodeAabbMin(nodeIndex,m_bvhAabbMax);//can't use btVector3(SIMD_INFINITY,SIMD_INFINITY,SIMD_INFINITY)) because of quantization
+	setInternalNodeAabbMax(nodeIndex,m_bvhAabbMin);//can't use btVector3(-SIMD_INFINITY,-SIMD_INFINITY,-SIMD_INFINITY)) because of quantization
 	
 	for (i=startIndex;i<endIndex;i++)
 	{
-		mergeInternalNodeAabb(m_curNodeIndex,getAabbMin(i),getAabbMax(i));
+		mergeInternalNodeAabb(nodeIndex,getAabbMin(i),getAabbMax(i));
 	}
 
-	m_curNodeIndex++;
-	
+	//escapeIndex is the number of nodes of this subtree
+	setInternalNodeEscapeIndex(nodeIndex,2*(endIndex-startIndex)-1);
 
-	//internalNode->m_escapeIndex;
-	
-	int leftChildNodexIndex = m_curNodeIndex;
-
-	//build left child tree
-	buildTree(startIndex,splitIndex);
-
-	int rightChildNodexIndex = m_curNodeIndex;
-	//build right child tree
-	buildTree(splitIndex,endIndex);
+	return splitIndex;
+}
 
-#ifdef DEBUG_TREE_BUILDING
-	gStackDepth--;
-#endif //DEBUG_TREE_BUILDING
+///a range of leaves built by one task of btQuantizedBvh::buildTreeParallel
+struct	btQuantizedBvhBuildTask
+{
+	int	m_startIndex;
+	int	m_endIndex;
+	int	m_nodeIndex;
+	int	m_depth;
+};
 
-	int escapeIndex = m_curNodeIndex - curIndex;
+struct	btQuantizedBvhBuildLoop : public btIParallelForBody
+{
+	btQuantizedBvh*						m_bvh;
+	const btQuantizedBvhBuildTask*		m_tasks;
 
-	if (m_useQuantization)
+	void forLoop(int iBegin, int iEnd) const
 	{
-		//escapeIndex is the number of nodes of this subtree
-		const int sizeQuantizedNode =sizeof(btQuantizedBvhNode);
-		const int treeSizeInBytes = escapeIndex * sizeQuantizedNode;
-		if (treeSizeInBytes > MAX_SUBTREE_SIZE_IN_BYTES)
+		for (int i=iBegin;i<iEnd;i++)
 		{
-			updateSubtreeHeaders(leftChildNodexIndex,rightChildNodexIndex);
+			const btQuantizedBvhBuildTask& task = m_tasks[i];
+			m_bvh->buildSubtree(task.m_startIndex,task.m_endIndex,task.m_nodeIndex,task.m_depth);
 		}
-	} else
+	}
+};
+
+void	btQuantizedBvh::buildTreeParallel(int startIndex,int endIndex,int nodeIndex)
+{
+	///split the largest range until there are enough tasks. The node index of each child is known in advance,
+	///so the subtrees are built independently and the result is the same as buildSubtree on the whole range.
+	btAlignedObjectArray<btQuantizedBvhBuildTask> tasks;
+	btQuantizedBvhBuildTask& root = tasks.expand();
+	root.m_startIndex = startIndex;
+	root.m_endIndex = endIndex;
+	root.m_nodeIndex = nodeIndex;
+	root.m_depth = 0;
+
+	while (tasks.size() < BT_BVH_PARALLEL_BUILD_TASKS)
 	{
+		int largestTask = -1;
+		int largestSize = 2*BT_BVH_PARALLEL_BUILD_MIN_LEAVES-1;
+		for (int i=0;i<tasks.size();i++)
+		{
+			const int size = tasks[i].m_endIndex-tasks[i].m_startIndex;
+			if (size > largestSize)
+			{
+				largestTask = i;
+				largestSize = size;
+			}
+		}
+		if (largestTask<0)
+			break;
+
+		btQuantizedBvhBuildTask task = tasks[largestTask];
+		const int splitIndex = buildInternalNode(task.m_startIndex,task.m_endIndex,task.m_nodeIndex,task.m_depth);
 
+		btQuantizedBvhBuildTask& leftTask = tasks[largestTask];
+		leftTask.m_endIndex = splitIndex;
+		leftTask.m_nodeIndex = task.m_nodeIndex+1;
+		leftTask.m_depth = task.m_depth+1;
+
+		btQuantizedBvhBuildTask& rightTask = tasks.expand();
+		rightTask.m_startIndex = splitIndex;
+		rightTask.m_endIndex = task.m_endIndex;
+		rightTask.m_nodeIndex = task.m_nodeIndex+2*(splitIndex-task.m_startIndex);
+		rightTask.m_depth = task.m_depth+1;
 	}
 
-	setInternalNodeEscapeIndex(internalNodeIndex,escapeIndex);
+	btQuantizedBvhBuildLoop loop;
+	loop.m_bvh = this;
+	loop.m_tasks = &tasks[0];
+	m_taskScheduler->parallelFor(0,tasks.size(),1,loop);
+}
+
+void	btQuantizedBvh::addSubtreeHeaders(int nodeIndex)
+{
+	btAssert(m_useQuantization);
 
+	const int subtreeSize = getSubtreeSize(nodeIndex);
+	const int treeSizeInBytes = subtreeSize * static_cast<int>(sizeof(btQuantizedBvhNode));
+	if (treeSizeInBytes <= MAX_SUBTREE_SIZE_IN_BYTES)
+		return;
+
+	const int leftChildNodexIndex = nodeIndex+1;
+	const int rightChildNodexIndex = leftChildNodexIndex+getSubtreeSize(leftChildNodexIndex);
+	addSubtreeHeaders(leftChildNodexIndex);
+	addSubtreeHeaders(rightChildNodexIndex);
+	updateSubtreeHeaders(leftChildNodexIndex,rightChildNodexIndex);
 }
 
 void	btQuantizedBvh::updateSubtreeHeaders(int leftChildNodexIndex,int rightChildNodexIndex)
@@ -281,6 +395,117 @@ int	btQuantizedBvh::sortAndCalcSplittingIndex(int startIndex,int endIndex,int sp
 }
 
 
+int	btQuantizedBvh::sortAndCalcSahSplittingIndex(int startIndex,int endIndex)
+{
+	int i, j, k;
+
+	btVector3 centerMin(btScalar(BT_LARGE_FLOAT),btScalar(BT_LARGE_FLOAT),btScalar(BT_LARGE_FLOAT));
+	btVector3 centerMax(btScalar(-BT_LARGE_FLOAT),btScalar(-BT_LARGE_FLOAT),btScalar(-BT_LARGE_FLOAT));
+	for (i=startIndex;i<endIndex;i++)
+	{
+		btVector3 center = btScalar(0.5)*(getAabbMax(i)+getAabbMin(i));
+		centerMin.setMin(center);
+		centerMax.setMax(center);
+	}
+
+	btVector3 binScale;
+	for (j=0;j<3;j++)
+	{
+		const btScalar extent = centerMax[j]-centerMin[j];
+		binScale[j] = extent > btScalar(0.) ? btScalar(BT_BVH_SAH_BIN_COUNT)/extent : btScalar(0.);
+	}
+
+	//bin the leaves by their center, along all three axes
+	btVector3 binAabbMin[3][BT_BVH_SAH_BIN_COUNT];
+	btVector3 binAabbMax[3][BT_BVH_SAH_BIN_COUNT];
+	int binCount[3][BT_BVH_SAH_BIN_COUNT];
+	for (j=0;j<3;j++)
+	{
+		for (k=0;k<BT_BVH_SAH_BIN_COUNT;k++)
+		{
+			binAabbMin[j][k].setValue(btScalar(BT_LARGE_FLOAT),btScalar(BT_LARGE_FLOAT),btScalar(BT_LARGE_FLOAT));
+			binAabbMax[j][k].setValue(btScalar(-BT_LARGE_FLOAT),btScalar(-BT_LARGE_FLOAT),btScalar(-BT_LARGE_FLOAT));
+			binCount[j][k] = 0;
+		}
+	}
+	for (i=startIndex;i<endIndex;i++)
+	{
+		const btVector3 aabbMin = getAabbMin(i);
+		const btVector3 aabbMax = getAabbMax(i);
+		btVector3 center = btScalar(0.5)*(aabbMax+aabbMin);
+		for (j=0;j<3;j++)
+		{
+			const int bin = btMin(int((center[j]-centerMin[j])*binScale[j]),BT_BVH_SAH_BIN_COUNT-1);
+			binAabbMin[j][bin].setMin(aabbMin);
+			binAabbMax[j][bin].setMax(aabbMax);
+			binCount[j][bin]++;
+		}
+	}
+
+	//the cost of a split is the number of leaves of each side times the surface area of its bounds
+	int bestAxis = -1;
+	int bestBin = 0;
+	btScalar bestCost = SIMD_INFINITY;
+	for (j=0;j<3;j++)
+	{
+		if (binScale[j] == btScalar(0.))
+			continue;
+
+		btScalar rightCost[BT_BVH_SAH_BIN_COUNT];
+		btVector3 aabbMin = binAabbMin[j][BT_BVH_SAH_BIN_COUNT-1];
+		btVector3 aabbMax = binAabbMax[j][BT_BVH_SAH_BIN_COUNT-1];
+		int count = binCount[j][BT_BVH_SAH_BIN_COUNT-1];
+		for (k=BT_BVH_SAH_BIN_COUNT-1;k>0;k--)
+		{
+			aabbMin.setMin(binAabbMin[j][k]);
+			aabbMax.setMax(binAabbMax[j][k]);
+			count += k < BT_BVH_SAH_BIN_COUNT-1 ? binCount[j][k] : 0;
+			const btVector3 extent = aabbMax-aabbMin;
+			rightCost[k] = count ? btScalar(count)*(extent.getX()*extent.getY()+extent.getY()*extent.getZ()+extent.getZ()*extent.getX()) : btScalar(0.);
+		}
+
+		aabbMin = binAabbMin[j][0];
+		aabbMax = binAabbMax[j][0];
+		count = 0;
+		for (k=0;k<BT_BVH_SAH_BIN_COUNT-1;k++)
+		{
+			aabbMin.setMin(binAabbMin[j][k]);
+			aabbMax.setMax(binAabbMax[j][k]);
+			count += binCount[j][k];
+			if (!count || count == endIndex-startIndex)
+				continue;
+			const btVector3 extent = aabbMax-aabbMin;
+			const btScalar cost = btScalar(count)*(extent.getX()*extent.getY()+extent.getY()*extent.getZ()+extent.getZ()*extent.getX()) + rightCost[k+1];
+			if (cost < bestCost)
+			{
+				bestCost = cost;
+				bestAxis = j;
+				bestBin = k;
+			}
+		}
+	}
+
+	if (bestAxis<0)
+		return startIndex;
+
+	//sort leafNodes so the bins up to bestBin come first, recomputing the bins exactly as above
+	int splitIndex = startIndex;
+	for (i=startIndex;i<endIndex;i++)
+	{
+		btVector3 center = btScalar(0.5)*(getAabbMax(i)+getAabbMin(i));
+		const int bin = btMin(int((center[bestAxis]-centerMin[bestAxis])*binScale[bestAxis]),BT_BVH_SAH_BIN_COUNT-1);
+		if (bin <= bestBin)
+		{
+			swapLeafNodes(i,splitIndex);
+			splitIndex++;
+		}
+	}
+
+	btAssert(splitIndex>startIndex && splitIndex<endIndex);
+	return splitIndex;
+}
+
+
 int	btQuantizedBvh::calcSplittingAxis(int startIndex,int endIndex)
 {
 	int i;
@@ -314,7 +539,21 @@ void	btQuantizedBvh::reportAabbOverlappingNodex(btNodeOverlapCallback* nodeCallb
 {
 	//either choose recursive traversal (walkTree) or stackless (walkStacklessTree)
 
-	if (m_useQuantization)
+	if (m_wideNodes.size())
+	{
+		if (m_useQuantization)
+		{
+			///round the query AABB to the quantization grid, so the wide tree reports the same leaves as the quantized tree
+			unsigned short int quantizedQueryAabbMin[3];
+			unsigned short int quantizedQueryAabbMax[3];
+			quantizeWithClamp(quantizedQueryAabbMin,aabbMin,0);
+			quantizeWithClamp(quantizedQueryAabbMax,aabbMax,1);
+			walkWideTree(nodeCallback,unQuantize(quantizedQueryAabbMin),unQuantize(quantizedQueryAabbMax));
+		} else
+		{
+			walkWideTree(nodeCallback,aabbMin,aabbMax);
+		}
+	} else if (m_useQuantization)
 	{
 		///quantize query AABB
 		unsigned short int quantizedQueryAabbMin[3];
@@ -759,11 +998,69 @@ void	btQuantizedBvh::reportRayOverlappingNodex (btNodeOverlapCallback* nodeCallb
 }
 
 
+void	btQuantizedBvh::reportRayPacketOverlappingNodex(btNodeOverlapPacketCallback* nodeCallback, const btRayPacket& packet) const
+{
+	int curIndex = 0;
+	if (m_wideNodes.size())
+	{
+		walkWideTreeAgainstRayPacket(nodeCallback,packet);
+	} else if (m_useQuantization)
+	{
+		const btQuantizedBvhNode* rootNode = &m_quantizedContiguousNodes[0];
+		while (curIndex < m_curNodeIndex)
+		{
+			const int rayMask = packet.testAabb(unQuantize(rootNode->m_quantizedAabbMin),unQuantize(rootNode->m_quantizedAabbMax));
+			const bool isLeafNode = rootNode->isLeafNode();
+			if (isLeafNode && rayMask)
+			{
+				nodeCallback->processNode(rootNode->getPartId(),rootNode->getTriangleIndex(),rayMask);
+			}
+			if (rayMask || isLeafNode)
+			{
+				rootNode++;
+				curIndex++;
+			} else
+			{
+				const int escapeIndex = rootNode->getEscapeIndex();
+				rootNode += escapeIndex;
+				curIndex += escapeIndex;
+			}
+		}
+	} else
+	{
+		const btOptimizedBvhNode* rootNode = &m_contiguousNodes[0];
+		while (curIndex < m_curNodeIndex)
+		{
+			const int rayMask = packet.testAabb(rootNode->m_aabbMinOrg,rootNode->m_aabbMaxOrg);
+			const bool isLeafNode = rootNode->m_escapeIndex == -1;
+			if (isLeafNode && rayMask)
+			{
+				nodeCallback->processNode(rootNode->m_subPart,rootNode->m_triangleIndex,rayMask);
+			}
+			if (rayMask || isLeafNode)
+			{
+				rootNode++;
+				curIndex++;
+			} else
+			{
+				const int escapeIndex = rootNode->m_escapeIndex;
+				rootNode += escapeIndex;
+				curIndex += escapeIndex;
+			}
+		}
+	}
+}
+
+
 void	btQuantizedBvh::reportBoxCastOverlappingNodex(btNodeOverlapCallback* nodeCallback, const btVector3& raySource, const btVector3& rayTarget, const btVector3& aabbMin,const btVector3& aabbMax) const
 {
 	//always use stackless
 
-	if (m_useQuantization)
+	if (m_wideNodes.size())
+	{
+		walkWideTreeAgainstRay(nodeCallback, raySource, rayTarget, aabbMin, aabbMax);
+	}
+	else if (m_useQuantization)
 	{
 		walkStacklessQuantizedTreeAgainstRay(nodeCallback, raySource, rayTarget, aabbMin, aabbMax, 0, m_curNodeIndex);
 	}
@@ -787,6 +1084,306 @@ void	btQuantizedBvh::reportBoxCastOverlappingNodex(btNodeOverlapCallback* nodeCa
 }
 
 
+int	btQuantizedBvh::getSubtreeSize(int nodeIndex) const
+{
+	if (m_useQuantization)
+	{
+		const btQuantizedBvhNode& node = m_quantizedContiguousNodes[nodeIndex];
+		return node.isLeafNode() ? 1 : node.getEscapeIndex();
+	}
+	const btOptimizedBvhNode& node = m_contiguousNodes[nodeIndex];
+	return node.m_escapeIndex == -1 ? 1 : node.m_escapeIndex;
+}
+
+
+void	btQuantizedBvh::getNodeAabb(int nodeIndex,btVector3& aabbMin,btVector3& aabbMax) const
+{
+	if (m_useQuantization)
+	{
+		aabbMin = unQuantize(m_quantizedContiguousNodes[nodeIndex].m_quantizedAabbMin);
+		aabbMax = unQuantize(m_quantizedContiguousNodes[nodeIndex].m_quantizedAabbMax);
+	} else
+	{
+		aabbMin = m_contiguousNodes[nodeIndex].m_aabbMinOrg;
+		aabbMax = m_contiguousNodes[nodeIndex].m_aabbMaxOrg;
+	}
+}
+
+
+void	btQuantizedBvh::reportLeafNode(btNodeOverlapCallback* nodeCallback,int nodeIndex) const
+{
+	if (m_useQuantization)
+	{
+		const btQuantizedBvhNode& node = m_quantizedContiguousNodes[nodeIndex];
+		nodeCallback->processNode(node.getPartId(),node.getTriangleIndex());
+	} else
+	{
+		const btOptimizedBvhNode& node = m_contiguousNodes[nodeIndex];
+		nodeCallback->processNode(node.m_subPart,node.m_triangleIndex);
+	}
+}
+
+
+void	btQuantizedBvh::setUseWideNodes(bool useWideNodes)
+{
+	m_useWideNodes = useWideNodes;
+	if (!useWideNodes)
+	{
+		m_wideNodes.clear();
+	} else if (m_curNodeIndex>0 && !m_wideNodes.size())
+	{
+		buildWideNodes();
+	}
+}
+
+
+void	btQuantizedBvh::buildWideNodes()
+{
+	m_wideNodes.resize(0);
+	if (m_curNodeIndex<=0)
+		return;
+
+	int maxDepth = 0;
+	buildWideNode(0,1,maxDepth);
+
+	//each level of the traversal pushes at most BT_BVH_WIDE_NODE_WIDTH-1 nodes more than it pops
+	if (maxDepth*(BT_BVH_WIDE_NODE_WIDTH-1)+1 > BT_BVH_WIDE_STACK_SIZE)
+	{
+		m_wideNodes.clear();
+		return;
+	}
+
+	refitWideNodes();
+}
+
+
+int	btQuantizedBvh::buildWideNode(int nodeIndex,int depth,int& maxDepth)
+{
+	if (depth>maxDepth)
+		maxDepth = depth;
+
+	//collapse the binary subtree: open the internal child with the largest surface area until there are enough children,
+	//keeping the children in the order of the binary tree
+	int children[BT_BVH_WIDE_NODE_WIDTH];
+	int numChildren = 0;
+	if (getSubtreeSize(nodeIndex)==1)
+	{
+		children[numChildren++] = nodeIndex;
+	} else
+	{
+		children[numChildren++] = nodeIndex+1;
+		children[numChildren++] = nodeIndex+1+getSubtreeSize(nodeIndex+1);
+	}
+	while (numChildren<BT_BVH_WIDE_NODE_WIDTH)
+	{
+		int openChild = -1;
+		btScalar openArea = btScalar(-1.);
+		for (int i=0;i<numChildren;i++)
+		{
+			if (getSubtreeSize(children[i])==1)
+				continue;
+			btVector3 aabbMin,aabbMax;
+			getNodeAabb(children[i],aabbMin,aabbMax);
+			const btVector3 extent = aabbMax-aabbMin;
+			const btScalar area = extent.getX()*extent.getY()+extent.getY()*extent.getZ()+extent.getZ()*extent.getX();
+			if (area > openArea)
+			{
+				openChild = i;
+				openArea = area;
+			}
+		}
+		if (openChild<0)
+			break;
+		const int openNode = children[openChild];
+		for (int i=numChildren;i>openChild+1;i--)
+		{
+			children[i] = children[i-1];
+		}
+		children[openChild] = openNode+1;
+		children[openChild+1] = openNode+1+getSubtreeSize(openNode+1);
+		numChildren++;
+	}
+
+	const int wideNodeIndex = m_wideNodes.size();
+	m_wideNodes.expand();
+	for (int i=0;i<BT_BVH_WIDE_NODE_WIDTH;i++)
+	{
+		m_wideNodes[wideNodeIndex].m_nodeIndex[i] = i<numChildren ? children[i] : -1;
+		m_wideNodes[wideNodeIndex].m_childIndex[i] = -1;
+	}
+	//the array may grow while the children are built, so index it again each time
+	for (int i=0;i<numChildren;i++)
+	{
+		if (getSubtreeSize(children[i])>1)
+		{
+			const int childIndex = buildWideNode(children[i],depth+1,maxDepth);
+			m_wideNodes[wideNodeIndex].m_childIndex[i] = childIndex;
+		}
+	}
+	return wideNodeIndex;
+}
+
+
+void	btQuantizedBvh::refitWideNodes()
+{
+	for (int n=0;n<m_wideNodes.size();n++)
+	{
+		btBvhWideNode& wideNode = m_wideNodes[n];
+		for (int i=0;i<BT_BVH_WIDE_NODE_WIDTH;i++)
+		{
+			btVector3 aabbMin(btScalar(BT_LARGE_FLOAT),btScalar(BT_LARGE_FLOAT),btScalar(BT_LARGE_FLOAT));
+			btVector3 aabbMax(btScalar(-BT_LARGE_FLOAT),btScalar(-BT_LARGE_FLOAT),btScalar(-BT_LARGE_FLOAT));
+			if (wideNode.m_nodeIndex[i]>=0)
+			{
+				getNodeAabb(wideNode.m_nodeIndex[i],aabbMin,aabbMax);
+			}
+			for (int j=0;j<3;j++)
+			{
+				wideNode.m_aabbMin[j][i] = aabbMin[j];
+				wideNode.m_aabbMax[j][i] = aabbMax[j];
+			}
+		}
+	}
+}
+
+
+void	btQuantizedBvh::walkWideTree(btNodeOverlapCallback* nodeCallback,const btVector3& aabbMin,const btVector3& aabbMax) const
+{
+	int stack[BT_BVH_WIDE_STACK_SIZE];
+	int depth = 0;
+	stack[depth++] = 0;
+	while (depth)
+	{
+		const btBvhWideNode& wideNode = m_wideNodes[stack[--depth]];
+		const int overlap = wideNode.testAabb(aabbMin,aabbMax);
+		if (!overlap)
+			continue;
+		int i;
+		for (i=0;i<BT_BVH_WIDE_NODE_WIDTH;i++)
+		{
+			if ((overlap & (1<<i)) && wideNode.m_childIndex[i]<0)
+			{
+				reportLeafNode(nodeCallback,wideNode.m_nodeIndex[i]);
+			}
+		}
+		//push in reverse, so the children are visited in order
+		for (i=BT_BVH_WIDE_NODE_WIDTH-1;i>=0;i--)
+		{
+			if ((overlap & (1<<i)) && wideNode.m_childIndex[i]>=0)
+			{
+				btAssert(depth<BT_BVH_WIDE_STACK_SIZE);
+				stack[depth++] = wideNode.m_childIndex[i];
+			}
+		}
+	}
+}
+
+
+void	btQuantizedBvh::walkWideTreeAgainstRay(btNodeOverlapCallback* nodeCallback, const btVector3& raySource, const btVector3& rayTarget, const btVector3& aabbMin, const btVector3& aabbMax) const
+{
+	//same ray setup as walkStacklessQuantizedTreeAgainstRay, so both trees report the same leaves
+	btVector3 rayDirection = rayTarget-raySource;
+	rayDirection.normalize();
+	const btScalar lambdaMax = rayDirection.dot(rayTarget-raySource);
+	///what about division by zero? --> just set rayDirection[i] to BT_LARGE_FLOAT
+	btVector3 rayInvDirection;
+	rayInvDirection[0] = rayDirection[0] == btScalar(0.0) ? btScalar(BT_LARGE_FLOAT) : btScalar(1.0) / rayDirection[0];
+	rayInvDirection[1] = rayDirection[1] == btScalar(0.0) ? btScalar(BT_LARGE_FLOAT) : btScalar(1.0) / rayDirection[1];
+	rayInvDirection[2] = rayDirection[2] == btScalar(0.0) ? btScalar(BT_LARGE_FLOAT) : btScalar(1.0) / rayDirection[2];
+	unsigned int sign[3] = { rayInvDirection[0] < 0.0, rayInvDirection[1] < 0.0, rayInvDirection[2] < 0.0};
+
+	/* Quick pruning by the bounding box of the cast */
+	btVector3 rayAabbMin = raySource;
+	btVector3 rayAabbMax = raySource;
+	rayAabbMin.setMin(rayTarget);
+	rayAabbMax.setMax(rayTarget);
+	rayAabbMin += aabbMin;
+	rayAabbMax += aabbMax;
+	if (m_useQuantization)
+	{
+		unsigned short int quantizedQueryAabbMin[3];
+		unsigned short int quantizedQueryAabbMax[3];
+		quantizeWithClamp(quantizedQueryAabbMin,rayAabbMin,0);
+		quantizeWithClamp(quantizedQueryAabbMax,rayAabbMax,1);
+		rayAabbMin = unQuantize(quantizedQueryAabbMin);
+		rayAabbMax = unQuantize(quantizedQueryAabbMax);
+	}
+
+	int stack[BT_BVH_WIDE_STACK_SIZE];
+	int depth = 0;
+	stack[depth++] = 0;
+	while (depth)
+	{
+		const btBvhWideNode& wideNode = m_wideNodes[stack[--depth]];
+		const int overlap = wideNode.testAabb(rayAabbMin,rayAabbMax) & wideNode.testRay(raySource,rayInvDirection,sign,lambdaMax,aabbMin,aabbMax);
+		if (!overlap)
+			continue;
+		int i;
+		for (i=0;i<BT_BVH_WIDE_NODE_WIDTH;i++)
+		{
+			if ((overlap & (1<<i)) && wideNode.m_childIndex[i]<0)
+			{
+				reportLeafNode(nodeCallback,wideNode.m_nodeIndex[i]);
+			}
+		}
+		for (i=BT_BVH_WIDE_NODE_WIDTH-1;i>=0;i--)
+		{
+			if ((overlap & (1<<i)) && wideNode.m_childIndex[i]>=0)
+			{
+				btAssert(depth<BT_BVH_WIDE_STACK_SIZE);
+				stack[depth++] = wideNode.m_childIndex[i];
+			}
+		}
+	}
+}
+
+
+void	btQuantizedBvh::walkWideTreeAgainstRayPacket(btNodeOverlapPacketCallback* nodeCallback, const btRayPacket& packet) const
+{
+	int stack[BT_BVH_WIDE_STACK_SIZE];
+	int depth = 0;
+	stack[depth++] = 0;
+	while (depth)
+	{
+		const btBvhWideNode& wideNode = m_wideNodes[stack[--depth]];
+		int rayMask[BT_BVH_WIDE_NODE_WIDTH];
+		int i;
+		for (i=0;i<BT_BVH_WIDE_NODE_WIDTH;i++)
+		{
+			rayMask[i] = 0;
+			if (wideNode.m_nodeIndex[i]<0)
+				continue;
+			rayMask[i] = packet.testAabb(btVector3(wideNode.m_aabbMin[0][i],wideNode.m_aabbMin[1][i],wideNode.m_aabbMin[2][i]),
+				btVector3(wideNode.m_aabbMax[0][i],wideNode.m_aabbMax[1][i],wideNode.m_aabbMax[2][i]));
+			if (rayMask[i] && wideNode.m_childIndex[i]<0)
+			{
+				int partId, triangleIndex;
+				if (m_useQuantization)
+				{
+					const btQuantizedBvhNode& node = m_quantizedContiguousNodes[wideNode.m_nodeIndex[i]];
+					partId = node.getPartId();
+					triangleIndex = node.getTriangleIndex();
+				} else
+				{
+					const btOptimizedBvhNode& node = m_contiguousNodes[wideNode.m_nodeIndex[i]];
+					partId = node.m_subPart;
+					triangleIndex = node.m_triangleIndex;
+				}
+				nodeCallback->processNode(partId,triangleIndex,rayMask[i]);
+			}
+		}
+		for (i=BT_BVH_WIDE_NODE_WIDTH-1;i>=0;i--)
+		{
+			if (rayMask[i] && wideNode.m_childIndex[i]>=0)
+			{
+				btAssert(depth<BT_BVH_WIDE_STACK_SIZE);
+				stack[depth++] = wideNode.m_childIndex[i];
+			}
+		}
+	}
+}
+
+
 void	btQuantizedBvh::swapLeafNodes(int i,int splitIndex)
 {
 	if (m_useQuantization)
@@ -1139,7 +1736,10 @@ btQuantizedBvh::btQuantizedBvh(btQuantizedBvh &self, bool /* ownsMemory */) :
 m_bvhAabbMin(self.m_bvhAabbMin),
 m_bvhAabbMax(self.m_bvhAabbMax),
 m_bvhQuantization(self.m_bvhQuantization),
-m_bulletVersion(BT_BULLET_VERSION)
+m_bulletVersion(BT_BULLET_VERSION),
+m_buildMode(BUILD_MEDIAN_SPLIT),
+m_taskScheduler(0),
+m_useWideNodes(false)
 {
 
 }
@@ -1288,6 +1888,28 @@ void btQuantizedBvh::deSerializeDouble(struct btQuantizedBvhDoubleData& quantize
 }
 
 
+void btQuantizedBvh::deSerializeFloatInPlace(struct btQuantizedBvhFloatData& quantizedBvhFloatData)
+{
+	btQuantizedBvhFloatData header = quantizedBvhFloatData;
+	header.m_numQuantizedContiguousNodes = 0;
+	deSerializeFloat(header);
+
+	int numElem = quantizedBvhFloatData.m_numQuantizedContiguousNodes;
+	btAssert(!numElem || !(size_t(quantizedBvhFloatData.m_quantizedContiguousNodesPtr)&15));
+	m_quantizedContiguousNodes.initializeFromBuffer(quantizedBvhFloatData.m_quantizedContiguousNodesPtr,numElem,numElem);
+}
+
+void btQuantizedBvh::deSerializeDoubleInPlace(struct btQuantizedBvhDoubleData& quantizedBvhDoubleData)
+{
+	btQuantizedBvhDoubleData header = quantizedBvhDoubleData;
+	header.m_numQuantizedContiguousNodes = 0;
+	deSerializeDouble(header);
+
+	int numElem = quantizedBvhDoubleData.m_numQuantizedContiguousNodes;
+	btAssert(!numElem || !(size_t(quantizedBvhDoubleData.m_quantizedContiguousNodesPtr)&15));
+	m_quantizedContiguousNodes.initializeFromBuffer(quantizedBvhDoubleData.m_quantizedContiguousNodesPtr,numElem,numElem);
+}
+
 
 ///fills the dataBuffer and returns the struct name (and 0 on failure)
 const char*	btQuantizedBvh::serialize(void* dataBuffer, btSerializer* serializer) const
@@ -17,6 +17,7 @@ subject to the following restrictions:
 #define BT_QUANTIZED_BVH_H
 
 class btSerializer;
+class btITaskScheduler;
 
 //#define DEBUG_CHECK_DEQUANTIZATION 1
 #ifdef DEBUG_CHECK_DEQUANTIZATION
@@ -147,6 +148,92 @@ public:
 ;
 
 
+///number of children of a btBvhWideNode, one per SSE lane
+#define BT_BVH_WIDE_NODE_WIDTH 4
+
+///btBvhWideNode is a node of the optional 4-wide layout of btQuantizedBvh, built by collapsing the binary tree.
+///It stores the unquantized bounds of up to four children as a structure of arrays, so a query tests them at once.
+///A child is another wide node or a leaf of the binary tree. Unused children have empty bounds and node index -1.
+ATTRIBUTE_ALIGNED16 (struct) btBvhWideNode
+{
+	BT_DECLARE_ALIGNED_ALLOCATOR();
+
+	btScalar	m_aabbMin[3][BT_BVH_WIDE_NODE_WIDTH];
+	btScalar	m_aabbMax[3][BT_BVH_WIDE_NODE_WIDTH];
+	///index of the child wide node, -1 for leaves and unused children
+	int			m_childIndex[BT_BVH_WIDE_NODE_WIDTH];
+	///index of the child in the binary node array, -1 for unused children
+	int			m_nodeIndex[BT_BVH_WIDE_NODE_WIDTH];
+
+	///returns bit i set when the bounds of child i overlap the box
+	int		testAabb(const btVector3& aabbMin,const btVector3& aabbMax) const
+	{
+#if defined (BT_USE_SSE) && (BT_BVH_WIDE_NODE_WIDTH == 4)
+		__m128 overlap = _mm_and_ps(_mm_cmple_ps(_mm_load_ps(m_aabbMin[0]),_mm_set1_ps(aabbMax.getX())),_mm_cmpge_ps(_mm_load_ps(m_aabbMax[0]),_mm_set1_ps(aabbMin.getX())));
+		overlap = _mm_and_ps(overlap,_mm_and_ps(_mm_cmple_ps(_mm_load_ps(m_aabbMin[1]),_mm_set1_ps(aabbMax.getY())),_mm_cmpge_ps(_mm_load_ps(m_aabbMax[1]),_mm_set1_ps(aabbMin.getY()))));
+		overlap = _mm_and_ps(overlap,_mm_and_ps(_mm_cmple_ps(_mm_load_ps(m_aabbMin[2]),_mm_set1_ps(aabbMax.getZ())),_mm_cmpge_ps(_mm_load_ps(m_aabbMax[2]),_mm_set1_ps(aabbMin.getZ()))));
+		return _mm_movemask_ps(overlap);
+#else
+		int mask = 0;
+		for (int i=0;i<BT_BVH_WIDE_NODE_WIDTH;i++)
+		{
+			if (m_aabbMin[0][i] <= aabbMax.getX() && m_aabbMax[0][i] >= aabbMin.getX() &&
+				m_aabbMin[1][i] <= aabbMax.getY() && m_aabbMax[1][i] >= aabbMin.getY() &&
+				m_aabbMin[2][i] <= aabbMax.getZ() && m_aabbMax[2][i] >= aabbMin.getZ())
+				mask |= 1<<i;
+		}
+		return mask;
+#endif
+	}
+
+	///slab test of the ray rayFrom + t * direction, t in (0, lambdaMax), against the children bounds grown by the extents
+	///of a swept box, [aabbMin, aabbMax] around the ray. rayInvDirection is 1 / direction, raySign its signs.
+	///Returns bit i set when the ray enters child i. The comparisons are those of btRayAabb2, so the wide tree
+	///accepts exactly the nodes the binary traversal accepts.
+	int		testRay(const btVector3& rayFrom,const btVector3& rayInvDirection,const unsigned int raySign[3],btScalar lambdaMax,const btVector3& aabbMin,const btVector3& aabbMax) const
+	{
+#if defined (BT_USE_SSE) && (BT_BVH_WIDE_NODE_WIDTH == 4)
+		__m128 tmin = _mm_set1_ps(-SIMD_INFINITY);
+		__m128 tmax = _mm_set1_ps(SIMD_INFINITY);
+		for (int j=0;j<3;j++)
+		{
+			const __m128 lower = _mm_sub_ps(_mm_load_ps(m_aabbMin[j]),_mm_set1_ps(aabbMax[j]));
+			const __m128 upper = _mm_sub_ps(_mm_load_ps(m_aabbMax[j]),_mm_set1_ps(aabbMin[j]));
+			const __m128 from = _mm_set1_ps(rayFrom[j]);
+			const __m128 invDirection = _mm_set1_ps(rayInvDirection[j]);
+			const __m128 tnear = _mm_mul_ps(_mm_sub_ps(raySign[j] ? upper : lower,from),invDirection);
+			const __m128 tfar = _mm_mul_ps(_mm_sub_ps(raySign[j] ? lower : upper,from),invDirection);
+			tmin = _mm_max_ps(tmin,tnear);
+			tmax = _mm_min_ps(tmax,tfar);
+		}
+		__m128 hit = _mm_cmple_ps(tmin,tmax);
+		hit = _mm_and_ps(hit,_mm_cmplt_ps(tmin,_mm_set1_ps(lambdaMax)));
+		hit = _mm_and_ps(hit,_mm_cmpgt_ps(tmax,_mm_setzero_ps()));
+		return _mm_movemask_ps(hit);
+#else
+		int mask = 0;
+		for (int i=0;i<BT_BVH_WIDE_NODE_WIDTH;i++)
+		{
+			btScalar tmin = -SIMD_INFINITY;
+			btScalar tmax = SIMD_INFINITY;
+			for (int j=0;j<3;j++)
+			{
+				const btScalar lower = m_aabbMin[j][i]-aabbMax[j];
+				const btScalar upper = m_aabbMax[j][i]-aabbMin[j];
+				const btScalar tnear = ((raySign[j] ? upper : lower)-rayFrom[j])*rayInvDirection[j];
+				const btScalar tfar = ((raySign[j] ? lower : upper)-rayFrom[j])*rayInvDirection[j];
+				tmin = btMax(tmin,tnear);
+				tmax = btMin(tmax,tfar);
+			}
+			if (tmin <= tmax && tmin < lambdaMax && tmax > btScalar(0.))
+				mask |= 1<<i;
+		}
+		return mask;
+#endif
+	}
+};
+
+
 class btNodeOverlapCallback
 {
 public:
@@ -155,8 +242,19 @@ public:
 	virtual void processNode(int subPart, int triangleIndex) = 0;
 };
 
+///btNodeOverlapPacketCallback receives the leaves hit by the rays of a btRayPacket
+class btNodeOverlapPacketCallback
+{
+public:
+	virtual ~btNodeOverlapPacketCallback() {};
+
+	///bit i of rayMask is set when ray i of the packet hits the leaf bounds
+	virtual void processNode(int subPart, int triangleIndex, int rayMask) = 0;
+};
+
 #include "LinearMath/btAlignedAllocator.h"
 #include "LinearMath/btAlignedObjectArray.h"
+#include "btRayPacket.h"
 
 
 
@@ -164,6 +262,7 @@ public:
 typedef btAlignedObjectArray<btOptimizedBvhNode>	NodeArray;
 typedef btAlignedObjectArray<btQuantizedBvhNode>	QuantizedNodeArray;
 typedef btAlignedObjectArray<btBvhSubtreeInfo>		BvhSubtreeInfoArray;
+typedef btAlignedObjectArray<btBvhWideNode>		WideNodeArray;
 
 
 ///The btQuantizedBvh class stores an AABB tree that can be quickly traversed on CPU and Cell SPU.
@@ -179,6 +278,14 @@ public:
 		TRAVERSAL_RECURSIVE
 	};
 
+	enum btBuildMode
+	{
+		///split at the mean of the leaf centers along the axis of largest variance
+		BUILD_MEDIAN_SPLIT = 0,
+		///split where the surface area heuristic, evaluated on binned leaf centers, is lowest
+		BUILD_BINNED_SAH
+	};
+
 protected:
 
 
@@ -205,6 +312,13 @@ protected:
 	//This is only used for serialization so we don't have to add serialization directly to btAlignedObjectArray
 	mutable int m_subtreeHeaderCount;
 
+	btBuildMode			m_buildMode;
+	btITaskScheduler*	m_taskScheduler;
+
+	///the optional 4-wide layout, built from the binary tree and not serialized
+	bool				m_useWideNodes;
+	WideNodeArray		m_wideNodes;
+
 	
 
 
@@ -303,9 +417,37 @@ protected:
 
 	void	buildTree	(int startIndex,int endIndex);
 
+	///buildSubtree builds the nodes of the leaves [startIndex, endIndex) at nodeIndex, it only touches that range and those nodes
+	void	buildSubtree(int startIndex,int endIndex,int nodeIndex,int depth);
+
+	void	buildTreeParallel(int startIndex,int endIndex,int nodeIndex);
+
+	///sorts the leaves, sets the aabb and escape index of the internal node and returns the index of the first leaf of the right child
+	int		buildInternalNode(int startIndex,int endIndex,int nodeIndex,int depth);
+
 	int	calcSplittingAxis(int startIndex,int endIndex);
 
 	int	sortAndCalcSplittingIndex(int startIndex,int endIndex,int splitAxis);
+
+	///returns startIndex when no binned split separates the leaves
+	int	sortAndCalcSahSplittingIndex(int startIndex,int endIndex);
+
+	///number of nodes of the subtree at nodeIndex in the contiguous node array, 1 for a leaf
+	int		getSubtreeSize(int nodeIndex) const;
+
+	void	getNodeAabb(int nodeIndex,btVector3& aabbMin,btVector3& aabbMax) const;
+
+	void	reportLeafNode(btNodeOverlapCallback* nodeCallback,int nodeIndex) const;
+
+	void	buildWideNodes();
+
+	int		buildWideNode(int nodeIndex,int depth,int& maxDepth);
+
+	void	walkWideTree(btNodeOverlapCallback* nodeCallback,const btVector3& aabbMin,const btVector3& aabbMax) const;
+
+	void	walkWideTreeAgainstRay(btNodeOverlapCallback* nodeCallback, const btVector3& raySource, const btVector3& rayTarget, const btVector3& aabbMin, const btVector3& aabbMax) const;
+
+	void	walkWideTreeAgainstRayPacket(btNodeOverlapPacketCallback* nodeCallback, const btRayPacket& packet) const;
 	
 	void	walkStacklessTree(btNodeOverlapCallback* nodeCallback,const btVector3& aabbMin,const btVector3& aabbMax) const;
 
@@ -327,6 +469,11 @@ protected:
 
 	void	updateSubtreeHeaders(int leftChildNodexIndex,int rightChildNodexIndex);
 
+	///adds the subtree headers of the tree at nodeIndex, in the order buildTree used to add them while recursing
+	void	addSubtreeHeaders(int nodeIndex);
+
+	friend struct btQuantizedBvhBuildLoop;
+
 public:
 	
 	BT_DECLARE_ALIGNED_ALLOCATOR();
@@ -346,6 +493,9 @@ public:
 	void	reportAabbOverlappingNodex(btNodeOverlapCallback* nodeCallback,const btVector3& aabbMin,const btVector3& aabbMax) const;
 	void	reportRayOverlappingNodex (btNodeOverlapCallback* nodeCallback, const btVector3& raySource, const btVector3& rayTarget) const;
 	void	reportBoxCastOverlappingNodex(btNodeOverlapCallback* nodeCallback, const btVector3& raySource, const btVector3& rayTarget, const btVector3& aabbMin,const btVector3& aabbMax) const;
+	///reportRayPacketOverlappingNodex walks the tree once for all rays of the packet, in the same order as reportRayOverlappingNodex.
+	///Subtrees are skipped when no ray hits their bounds before its maximum fraction, which the callback may lower as it finds hits.
+	void	reportRayPacketOverlappingNodex(btNodeOverlapPacketCallback* nodeCallback, const btRayPacket& packet) const;
 
 		SIMD_FORCE_INLINE void quantize(unsigned short* out, const btVector3& point,int isMax) const
 	{
@@ -444,6 +594,37 @@ public:
 		m_traversalMode = traversalMode;
 	}
 
+	///setBuildMode selects the split strategy of the next build. With a task scheduler, large trees are split serially
+	///into independent subtrees which are built in parallel; the resulting tree is the same as a serial build.
+	void	setBuildMode(btBuildMode buildMode, btITaskScheduler* taskScheduler=0)
+	{
+		m_buildMode = buildMode;
+		m_taskScheduler = taskScheduler;
+	}
+
+	btBuildMode	getBuildMode() const
+	{
+		return m_buildMode;
+	}
+
+	///setUseWideNodes adds a 4-wide copy of the tree, which reportAabbOverlappingNodex, reportBoxCastOverlappingNodex,
+	///reportRayOverlappingNodex and reportRayPacketOverlappingNodex traverse instead of the binary tree, whatever the traversal mode.
+	///It is built now for a tree that is already built (or deserialized), and by later builds. Refits update it.
+	void	setUseWideNodes(bool useWideNodes);
+
+	bool	usesWideNodes() const
+	{
+		return m_wideNodes.size() != 0;
+	}
+
+	///updates the bounds of the wide nodes after a refit of the binary tree
+	void	refitWideNodes();
+
+	const WideNodeArray&	getWideNodeArray() const
+	{
+		return m_wideNodes;
+	}
+
 
 	SIMD_FORCE_INLINE QuantizedNodeArray&	getQuantizedNodeArray()
 	{	
@@ -480,6 +661,12 @@ public:
 
 	virtual	void deSerializeDouble(struct btQuantizedBvhDoubleData& quantizedBvhDoubleData);
 
+	///deSerializeFloatInPlace is deSerializeFloat, but uses the quantized nodes of the serialized data in place instead of copying them.
+	///btQuantizedBvhNodeData has the layout of btQuantizedBvhNode. The nodes must be 16 byte aligned and stay valid while the bvh is used.
+	void	deSerializeFloatInPlace(struct btQuantizedBvhFloatData& quantizedBvhFloatData);
+
+	void	deSerializeDoubleInPlace(struct btQuantizedBvhDoubleData& quantizedBvhDoubleData);
+
 
 ////////////////////////////////////////////////////////////////////
 
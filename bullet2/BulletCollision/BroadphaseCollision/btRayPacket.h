@@ -0,0 +1,146 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2009 Erwin Coumans  http://bulletphysics.org
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef BT_RAY_PACKET_H
+#define BT_RAY_PACKET_H
+
+#include "LinearMath/btVector3.h"
+#include "LinearMath/btTransform.h"
+
+///number of rays in a btRayPacket, one per SSE lane
+#define BT_RAY_PACKET_SIZE 4
+
+///btRayPacket holds up to BT_RAY_PACKET_SIZE ray segments as a structure of arrays, so bounding volume hierarchies
+///can test a node against all of them at once. Distances along the rays are fractions of the segments, as in rayTest.
+///Traversals skip the nodes beyond m_maxFraction, which the caller lowers as closer hits are found.
+ATTRIBUTE_ALIGNED16 (struct)	btRayPacket
+{
+	BT_DECLARE_ALIGNED_ALLOCATOR();
+
+	btScalar	m_from[3][BT_RAY_PACKET_SIZE];
+	btScalar	m_to[3][BT_RAY_PACKET_SIZE];
+	///1 / (to - from), BT_LARGE_FLOAT for zero components
+	btScalar	m_invDirection[3][BT_RAY_PACKET_SIZE];
+	///unused rays have a negative maximum fraction and never hit
+	btScalar	m_maxFraction[BT_RAY_PACKET_SIZE];
+	int			m_numRays;
+
+	void	init(const btVector3* rayFrom,const btVector3* rayTo,int numRays)
+	{
+		btAssert(numRays>0 && numRays<=BT_RAY_PACKET_SIZE);
+		m_numRays = numRays;
+		for (int i=0;i<BT_RAY_PACKET_SIZE;i++)
+		{
+			const int ray = i<numRays ? i : 0;
+			setRay(i,rayFrom[ray],rayTo[ray]);
+			m_maxFraction[i] = i<numRays ? btScalar(1.) : btScalar(-1.);
+		}
+	}
+
+	///the rays of packet in the frame of trans: trans * from, trans * to
+	void	initTransformed(const btRayPacket& packet,const btTransform& trans)
+	{
+		m_numRays = packet.m_numRays;
+		for (int i=0;i<BT_RAY_PACKET_SIZE;i++)
+		{
+			setRay(i,trans*packet.getFrom(i),trans*packet.getTo(i));
+			m_maxFraction[i] = packet.m_maxFraction[i];
+		}
+	}
+
+	void	setRay(int i,const btVector3& from,const btVector3& to)
+	{
+		const btVector3 direction = to-from;
+		for (int j=0;j<3;j++)
+		{
+			m_from[j][i] = from[j];
+			m_to[j][i] = to[j];
+			m_invDirection[j][i] = direction[j] == btScalar(0.0) ? btScalar(BT_LARGE_FLOAT) : btScalar(1.0) / direction[j];
+		}
+	}
+
+	btVector3	getFrom(int i) const
+	{
+		return btVector3(m_from[0][i],m_from[1][i],m_from[2][i]);
+	}
+
+	btVector3	getTo(int i) const
+	{
+		return btVector3(m_to[0][i],m_to[1][i],m_to[2][i]);
+	}
+
+	///bit i is set while ray i can still hit something
+	int		getActiveMask() const
+	{
+		int mask = 0;
+		for (int i=0;i<BT_RAY_PACKET_SIZE;i++)
+		{
+			if (m_maxFraction[i] > btScalar(0.))
+				mask |= 1<<i;
+		}
+		return mask;
+	}
+
+	///bounding box of the ray segments
+	void	getAabb(btVector3& aabbMin,btVector3& aabbMax) const
+	{
+		aabbMin = aabbMax = getFrom(0);
+		for (int i=0;i<m_numRays;i++)
+		{
+			aabbMin.setMin(getFrom(i));
+			aabbMin.setMin(getTo(i));
+			aabbMax.setMax(getFrom(i));
+			aabbMax.setMax(getTo(i));
+		}
+	}
+
+	///slab test of all rays against the box, returns bit i set when ray i enters it within [0, m_maxFraction[i]]
+	int		testAabb(const btVector3& aabbMin,const btVector3& aabbMax) const
+	{
+#if defined (BT_USE_SSE) && (BT_RAY_PACKET_SIZE == 4)
+		__m128 tmin = _mm_setzero_ps();
+		__m128 tmax = _mm_load_ps(m_maxFraction);
+		for (int j=0;j<3;j++)
+		{
+			const __m128 from = _mm_load_ps(m_from[j]);
+			const __m128 invDirection = _mm_load_ps(m_invDirection[j]);
+			const __m128 t0 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(aabbMin[j]),from),invDirection);
+			const __m128 t1 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(aabbMax[j]),from),invDirection);
+			tmin = _mm_max_ps(tmin,_mm_min_ps(t0,t1));
+			tmax = _mm_min_ps(tmax,_mm_max_ps(t0,t1));
+		}
+		return _mm_movemask_ps(_mm_cmple_ps(tmin,tmax));
+#else
+		int mask = 0;
+		for (int i=0;i<BT_RAY_PACKET_SIZE;i++)
+		{
+			btScalar tmin = btScalar(0.);
+			btScalar tmax = m_maxFraction[i];
+			for (int j=0;j<3;j++)
+			{
+				const btScalar t0 = (aabbMin[j]-m_from[j][i])*m_invDirection[j][i];
+				const btScalar t1 = (aabbMax[j]-m_from[j][i])*m_invDirection[j][i];
+				tmin = btMax(tmin,btMin(t0,t1));
+				tmax = btMin(tmax,btMax(t0,t1));
+			}
+			if (tmin <= tmax)
+				mask |= 1<<i;
+		}
+		return mask;
+#endif
+	}
+};
+
+#endif //BT_RAY_PACKET_H
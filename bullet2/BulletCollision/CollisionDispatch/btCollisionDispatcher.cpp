@@ -24,7 +24,10 @@ subject to the following restrictions:
 #include "BulletCollision/CollisionDispatch/btCollisionObject.h"
 #include "BulletCollision/BroadphaseCollision/btOverlappingPairCache.h"
 #include "LinearMath/btPoolAllocator.h"
+#include "LinearMath/btThreads.h"
+#include "LinearMath/btQuickprof.h"
 #include "BulletCollision/CollisionDispatch/btCollisionConfiguration.h"
+#include "BulletCollision/CollisionDispatch/btConvexConvexAlgorithm.h"
 
 int gNumManifold = 0;
 
@@ -67,9 +70,22 @@ btCollisionDispatcher::~btCollisionDispatcher()
 {
 }
 
+btPersistentManifold*	btCollisionDispatcher::constructManifold(void* mem,btCollisionObject* body0,btCollisionObject* body1)
+{
+	//optional relative contact breaking threshold, turned on by default (use setDispatcherFlags to switch off feature for improved performance)
+	
+	btScalar contactBreakingThreshold =  (m_dispatcherFlags & btCollisionDispatcher::CD_USE_RELATIVE_CONTACT_BREAKING_THRESHOLD) ? 
+		btMin(body0->getCollisionShape()->getContactBreakingThreshold(gContactBreakingThreshold) , body1->getCollisionShape()->getContactBreakingThreshold(gContactBreakingThreshold))
+		: gContactBreakingThreshold ;
+
+	btScalar contactProcessingThreshold = btMin(body0->getContactProcessingThreshold(),body1->getContactProcessingThreshold());
+
+	return new(mem) btPersistentManifold (body0,body1,0,contactBreakingThreshold,contactProcessingThreshold);
+}
+
 btPersistentManifold*	btCollisionDispatcher::getNewManifold(void* b0,void* b1) 
 { 
-	gNumManifold++;
+	btAtomicAdd(&gNumManifold,1);
 	
 	//btAssert(gNumManifold < 65535);
 	
@@ -77,20 +93,9 @@ btPersistentManifold*	btCollisionDispatcher::getNewManifold(void* b0,void* b1)
 	btCollisionObject* body0 = (btCollisionObject*)b0;
 	btCollisionObject* body1 = (btCollisionObject*)b1;
 
-	//optional relative contact breaking threshold, turned on by default (use setDispatcherFlags to switch off feature for improved performance)
-	
-	btScalar contactBreakingThreshold =  (m_dispatcherFlags & btCollisionDispatcher::CD_USE_RELATIVE_CONTACT_BREAKING_THRESHOLD) ? 
-		btMin(body0->getCollisionShape()->getContactBreakingThreshold(gContactBreakingThreshold) , body1->getCollisionShape()->getContactBreakingThreshold(gContactBreakingThreshold))
-		: gContactBreakingThreshold ;
-
-	btScalar contactProcessingThreshold = btMin(body0->getContactProcessingThreshold(),body1->getContactProcessingThreshold());
-		
-	void* mem = 0;
+	void* mem = m_persistentManifoldPoolAllocator->allocate(sizeof(btPersistentManifold));
 	
-	if (m_persistentManifoldPoolAllocator->getFreeCount())
-	{
-		mem = m_persistentManifoldPoolAllocator->allocate(sizeof(btPersistentManifold));
-	} else
+	if (!mem)
 	{
 		//we got a pool memory overflow, by default we fallback to dynamically allocate memory. If we require a contiguous contact pool then assert.
 		if ((m_dispatcherFlags&CD_DISABLE_CONTACTPOOL_DYNAMIC_ALLOCATION)==0)
@@ -103,7 +108,7 @@ btPersistentManifold*	btCollisionDispatcher::getNewManifold(void* b0,void* b1)
 			return 0;
 		}
 	}
-	btPersistentManifold* manifold = new(mem) btPersistentManifold (body0,body1,0,contactBreakingThreshold,contactProcessingThreshold);
+	btPersistentManifold* manifold = constructManifold(mem,body0,body1);
 	manifold->m_index1a = m_manifoldsPtr.size();
 	m_manifoldsPtr.push_back(manifold);
 
@@ -116,19 +121,24 @@ void btCollisionDispatcher::clearManifold(btPersistentManifold* manifold)
 }
 
 	
+void btCollisionDispatcher::removeManifoldFromArray(btPersistentManifold* manifold)
+{
+	int findIndex = manifold->m_index1a;
+	btAssert(findIndex < m_manifoldsPtr.size());
+	m_manifoldsPtr.swap(findIndex,m_manifoldsPtr.size()-1);
+	m_manifoldsPtr[findIndex]->m_index1a = findIndex;
+	m_manifoldsPtr.pop_back();
+}
+
 void btCollisionDispatcher::releaseManifold(btPersistentManifold* manifold)
 {
 	
-	gNumManifold--;
+	btAtomicAdd(&gNumManifold,-1);
 
 	//printf("releaseManifold: gNumManifold %d\n",gNumManifold);
 	clearManifold(manifold);
 
-	int findIndex = manifold->m_index1a;
-	btAssert(findIndex < m_manifoldsPtr.size());
-	m_manifoldsPtr.swap(findIndex,m_manifoldsPtr.size()-1);
-	m_manifoldsPtr[findIndex]->m_index1a = findIndex;
-	m_manifoldsPtr.pop_back();
+	removeManifoldFromArray(manifold);
 
 	manifold->~btPersistentManifold();
 	if (m_persistentManifoldPoolAllocator->validPtr(manifold))
@@ -240,14 +250,104 @@ void	btCollisionDispatcher::dispatchAllCollisionPairs(btOverlappingPairCache* pa
 {
 	//m_blockedForChanges = true;
 
+	boundConvexSeparations(pairCache,dispatchInfo,0);
+
 	btCollisionPairCallback	collisionCallback(dispatchInfo,this);
 
 	pairCache->processAllOverlappingPairs(&collisionCallback,dispatcher);
 
+	clearConvexSeparationBounds(pairCache);
+
 	//m_blockedForChanges = false;
 
 }
 
+struct btSeparationBoundsLoop : public btIParallelForBody
+{
+	const btGjkEpaSolver2::sBatchPair*	m_pairs;
+	btScalar*							m_bounds;
+	int									m_numPairs;
+
+	void forLoop(int iBegin, int iEnd) const
+	{
+		const int begin = iBegin*4;
+		const int end = btMin(iEnd*4,m_numPairs);
+		btGjkEpaSolver2::SeparationLowerBounds(m_pairs+begin,end-begin,m_bounds+begin);
+	}
+};
+
+void	btCollisionDispatcher::boundConvexSeparations(btOverlappingPairCache* pairCache,const btDispatcherInfo& dispatchInfo,btITaskScheduler* scheduler)
+{
+	if (!(m_dispatcherFlags & CD_BATCH_CONVEX_SEPARATION) || dispatchInfo.m_dispatchFunc != btDispatcherInfo::DISPATCH_DISCRETE)
+		return;
+
+	BT_PROFILE("boundConvexSeparations");
+	const int numPairs = pairCache->getNumOverlappingPairs();
+	btBroadphasePair* pairs = pairCache->getOverlappingPairArrayPtr();
+	m_separationPairs.resize(0);
+	m_separationAlgorithms.resize(0);
+	for (int i=0;i<numPairs;i++)
+	{
+		btCollisionAlgorithm* algorithm = pairs[i].m_algorithm;
+		btConvexConvexAlgorithm* convexAlgorithm = algorithm ? algorithm->getConvexConvexAlgorithm() : 0;
+		if (!convexAlgorithm)
+			continue;
+		btCollisionObject* colObj0 = (btCollisionObject*)pairs[i].m_pProxy0->m_clientObject;
+		btCollisionObject* colObj1 = (btCollisionObject*)pairs[i].m_pProxy1->m_clientObject;
+		if (!needsCollision(colObj0,colObj1))
+			continue;
+		btGjkEpaSolver2::sBatchPair& pair = m_separationPairs.expand();
+		if (convexAlgorithm->getSeparationBatchPair(colObj0,colObj1,pair))
+		{
+			m_separationAlgorithms.push_back(convexAlgorithm);
+		} else
+		{
+			m_separationPairs.pop_back();
+		}
+	}
+
+	const int numBatched = m_separationPairs.size();
+	if (!numBatched)
+		return;
+	m_separationBounds.resize(numBatched);
+
+	btSeparationBoundsLoop loop;
+	loop.m_pairs = &m_separationPairs[0];
+	loop.m_bounds = &m_separationBounds[0];
+	loop.m_numPairs = numBatched;
+	const int numBatches = (numBatched+3)/4;
+	if (scheduler && scheduler->getNumThreads()>1)
+	{
+		scheduler->parallelFor(0,numBatches,16,loop);
+	} else
+	{
+		loop.forLoop(0,numBatches);
+	}
+
+	for (int i=0;i<numBatched;i++)
+	{
+		m_separationAlgorithms[i]->setSeparationLowerBound(m_separationBounds[i]);
+	}
+}
+
+void	btCollisionDispatcher::clearConvexSeparationBounds(btOverlappingPairCache* pairCache)
+{
+	if (!m_separationAlgorithms.size())
+		return;
+
+	//the pairs may have been removed while dispatching, clear the bounds through the pairs left
+	const int numPairs = pairCache->getNumOverlappingPairs();
+	btBroadphasePair* pairs = pairCache->getOverlappingPairArrayPtr();
+	for (int i=0;i<numPairs;i++)
+	{
+		btCollisionAlgorithm* algorithm = pairs[i].m_algorithm;
+		btConvexConvexAlgorithm* convexAlgorithm = algorithm ? algorithm->getConvexConvexAlgorithm() : 0;
+		if (convexAlgorithm)
+			convexAlgorithm->setSeparationLowerBound(-BT_LARGE_FLOAT);
+	}
+	m_separationAlgorithms.resize(0);
+}
+
 
 
 
@@ -289,9 +389,10 @@ void btCollisionDispatcher::defaultNearCallback(btBroadphasePair& collisionPair,
 
 void* btCollisionDispatcher::allocateCollisionAlgorithm(int size)
 {
-	if (m_collisionAlgorithmPoolAllocator->getFreeCount())
+	void* mem = m_collisionAlgorithmPoolAllocator->allocate(size);
+	if (mem)
 	{
-		return m_collisionAlgorithmPoolAllocator->allocate(size);
+		return mem;
 	}
 	
 	//warn user for overflow?
@@ -22,12 +22,15 @@ subject to the following restrictions:
 #include "BulletCollision/CollisionDispatch/btManifoldResult.h"
 
 #include "BulletCollision/BroadphaseCollision/btBroadphaseProxy.h"
+#include "BulletCollision/NarrowPhaseCollision/btGjkEpa2.h"
 #include "LinearMath/btAlignedObjectArray.h"
 
 class btIDebugDraw;
 class btOverlappingPairCache;
 class btPoolAllocator;
 class btCollisionConfiguration;
+class btITaskScheduler;
+class btConvexConvexAlgorithm;
 
 #include "btCollisionCreateFunc.h"
 
@@ -61,6 +64,23 @@ protected:
 
 	btCollisionConfiguration*	m_collisionConfiguration;
 
+	///placement new of a manifold between body0 and body1, with the contact thresholds of the dispatcher
+	btPersistentManifold*	constructManifold(void* mem,btCollisionObject* body0,btCollisionObject* body1);
+
+	///swap-removes the manifold from m_manifoldsPtr, using its m_index1a
+	void	removeManifoldFromArray(btPersistentManifold* manifold);
+
+	btAlignedObjectArray<btGjkEpaSolver2::sBatchPair>	m_separationPairs;
+	btAlignedObjectArray<btConvexConvexAlgorithm*>		m_separationAlgorithms;
+	btAlignedObjectArray<btScalar>						m_separationBounds;
+
+	///with CD_BATCH_CONVEX_SEPARATION, bounds the separation of the convex pairs four at a time before they are dispatched,
+	///in parallel if scheduler is not 0
+	void	boundConvexSeparations(btOverlappingPairCache* pairCache,const btDispatcherInfo& dispatchInfo,btITaskScheduler* scheduler);
+
+	///clears the bounds of the pairs, so no bound outlives the dispatch that computed it
+	void	clearConvexSeparationBounds(btOverlappingPairCache* pairCache);
+
 
 public:
 
@@ -68,7 +88,10 @@ public:
 	{
 		CD_STATIC_STATIC_REPORTED = 1,
 		CD_USE_RELATIVE_CONTACT_BREAKING_THRESHOLD = 2,
-		CD_DISABLE_CONTACTPOOL_DYNAMIC_ALLOCATION = 4
+		CD_DISABLE_CONTACTPOOL_DYNAMIC_ALLOCATION = 4,
+		///bound the distance of the sphere, box, capsule and convex hull pairs of btConvexConvexAlgorithm in SIMD batches
+		///before dispatching them, the pairs proven further apart than the contact breaking threshold skip the pair detector
+		CD_BATCH_CONVEX_SEPARATION = 8
 	};
 
 	int	getDispatcherFlags() const
@@ -0,0 +1,295 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2009 Erwin Coumans  http://bulletphysics.org
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include "btCollisionDispatcherMt.h"
+
+#include "BulletCollision/BroadphaseCollision/btOverlappingPairCache.h"
+#include "BulletCollision/CollisionShapes/btCollisionShape.h"
+#include "BulletCollision/CollisionDispatch/btCollisionObject.h"
+#include "BulletCollision/CollisionDispatch/btCollisionConfiguration.h"
+#include "LinearMath/btPoolAllocator.h"
+#include "LinearMath/btQuickprof.h"
+
+extern int gNumManifold;
+
+
+struct btCollisionDispatcherMt::DispatchPairsLoop : public btIParallelForBody
+{
+	btCollisionDispatcherMt*	m_dispatcher;
+	btBroadphasePair*			m_pairs;
+	const btDispatcherInfo*		m_dispatchInfo;
+
+	void forLoop(int iBegin, int iEnd) const
+	{
+		BT_PROFILE("dispatchPairs");
+		ThreadContext& context = m_dispatcher->getThreadContext();
+		btNearCallback nearCallback = m_dispatcher->getNearCallback();
+		for (int i=iBegin;i<iEnd;i++)
+		{
+			if (isParallelPair(m_pairs[i]))
+			{
+				context.m_pairIndex = i;
+				context.m_sequence = 0;
+				(*nearCallback)(m_pairs[i],*m_dispatcher,*m_dispatchInfo);
+			}
+		}
+	}
+};
+
+
+btCollisionDispatcherMt::btCollisionDispatcherMt(btCollisionConfiguration* collisionConfiguration,int grainSize,int threadPoolSize)
+:btCollisionDispatcher(collisionConfiguration),
+m_taskScheduler(0),
+m_grainSize(grainSize),
+m_threadPoolSize(threadPoolSize),
+m_dispatching(false)
+{
+	void* mem = btAlignedAlloc(sizeof(ThreadContext),16);
+	ThreadContext* context = new (mem) ThreadContext;
+	context->m_algorithmPool = m_collisionAlgorithmPoolAllocator;
+	context->m_manifoldPool = m_persistentManifoldPoolAllocator;
+	context->m_ownsPools = false;
+	context->m_pairIndex = 0;
+	context->m_sequence = 0;
+	m_threadContexts.push_back(context);
+}
+
+btCollisionDispatcherMt::~btCollisionDispatcherMt()
+{
+	for (int i=0;i<m_threadContexts.size();i++)
+	{
+		ThreadContext* context = m_threadContexts[i];
+		if (context->m_ownsPools)
+		{
+			context->m_algorithmPool->~btPoolAllocator();
+			btAlignedFree(context->m_algorithmPool);
+			context->m_manifoldPool->~btPoolAllocator();
+			btAlignedFree(context->m_manifoldPool);
+		}
+		context->~ThreadContext();
+		btAlignedFree(context);
+	}
+}
+
+void	btCollisionDispatcherMt::setTaskScheduler(btITaskScheduler* scheduler)
+{
+	m_taskScheduler = scheduler;
+	if (!scheduler)
+		return;
+
+	///contexts are only added, never removed: algorithms and manifolds allocated from their pools can outlive the scheduler
+	while (m_threadContexts.size() < scheduler->getMaxNumThreads())
+	{
+		void* mem = btAlignedAlloc(sizeof(ThreadContext),16);
+		ThreadContext* context = new (mem) ThreadContext;
+		mem = btAlignedAlloc(sizeof(btPoolAllocator),16);
+		context->m_algorithmPool = new (mem) btPoolAllocator(m_collisionAlgorithmPoolAllocator->getElementSize(),m_threadPoolSize);
+		mem = btAlignedAlloc(sizeof(btPoolAllocator),16);
+		context->m_manifoldPool = new (mem) btPoolAllocator(m_persistentManifoldPoolAllocator->getElementSize(),m_threadPoolSize);
+		context->m_ownsPools = true;
+		context->m_pairIndex = 0;
+		context->m_sequence = 0;
+		m_threadContexts.push_back(context);
+	}
+}
+
+bool	btCollisionDispatcherMt::isParallelPair(const btBroadphasePair& pair)
+{
+	const btCollisionShape* shape0 = ((btCollisionObject*)pair.m_pProxy0->m_clientObject)->getCollisionShape();
+	const btCollisionShape* shape1 = ((btCollisionObject*)pair.m_pProxy1->m_clientObject)->getCollisionShape();
+	bool convexOrPlane0 = shape0->isConvex() || shape0->getShapeType() == STATIC_PLANE_PROXYTYPE;
+	bool convexOrPlane1 = shape1->isConvex() || shape1->getShapeType() == STATIC_PLANE_PROXYTYPE;
+	return convexOrPlane0 && convexOrPlane1;
+}
+
+void	btCollisionDispatcherMt::addManifoldEvent(btPersistentManifold* manifold,bool release)
+{
+	ThreadContext& context = getThreadContext();
+	ManifoldEvent& manifoldEvent = context.m_manifoldEvents.expandNonInitializing();
+	manifoldEvent.m_pairIndex = context.m_pairIndex;
+	manifoldEvent.m_sequence = context.m_sequence++;
+	manifoldEvent.m_manifold = manifold;
+	manifoldEvent.m_release = release;
+}
+
+btPersistentManifold*	btCollisionDispatcherMt::getNewManifold(void* b0,void* b1)
+{
+	if (!m_dispatching)
+	{
+		return btCollisionDispatcher::getNewManifold(b0,b1);
+	}
+
+	btAtomicAdd(&gNumManifold,1);
+
+	ThreadContext& context = getThreadContext();
+	void* mem = context.m_manifoldPool->allocate(sizeof(btPersistentManifold));
+
+	if (!mem)
+	{
+		if ((m_dispatcherFlags&CD_DISABLE_CONTACTPOOL_DYNAMIC_ALLOCATION)==0)
+		{
+			mem = btAlignedAlloc(sizeof(btPersistentManifold),16);
+		} else
+		{
+			btAssert(0);
+			//make sure to increase the threadPoolSize of the dispatcher
+			return 0;
+		}
+	}
+
+	btPersistentManifold* manifold = constructManifold(mem,(btCollisionObject*)b0,(btCollisionObject*)b1);
+	///added to m_manifoldsPtr after dispatching, in pair order
+	addManifoldEvent(manifold,false);
+	return manifold;
+}
+
+void	btCollisionDispatcherMt::freeManifoldMemory(btPersistentManifold* manifold)
+{
+	manifold->~btPersistentManifold();
+	for (int i=0;i<m_threadContexts.size();i++)
+	{
+		ThreadContext* context = m_threadContexts[i];
+		if (context->m_manifoldPool->validPtr(manifold))
+		{
+			context->m_manifoldPool->freeMemory(manifold);
+			return;
+		}
+	}
+	btAlignedFree(manifold);
+}
+
+void	btCollisionDispatcherMt::releaseManifold(btPersistentManifold* manifold)
+{
+	btAtomicAdd(&gNumManifold,-1);
+
+	clearManifold(manifold);
+
+	if (m_dispatching)
+	{
+		///removed from m_manifoldsPtr and freed after dispatching, in pair order
+		addManifoldEvent(manifold,true);
+	} else
+	{
+		removeManifoldFromArray(manifold);
+		freeManifoldMemory(manifold);
+	}
+}
+
+void	btCollisionDispatcherMt::applyManifoldEvents()
+{
+	m_mergedManifoldEvents.resize(0);
+	int i;
+	for (i=0;i<m_threadContexts.size();i++)
+	{
+		btAlignedObjectArray<ManifoldEvent>& events = m_threadContexts[i]->m_manifoldEvents;
+		for (int j=0;j<events.size();j++)
+		{
+			m_mergedManifoldEvents.push_back(events[j]);
+		}
+		events.resize(0);
+	}
+
+	///replaying the events in pair order gives the same manifold array as processing the pairs one by one
+	m_mergedManifoldEvents.quickSort(ManifoldEventSortPredicate());
+
+	for (i=0;i<m_mergedManifoldEvents.size();i++)
+	{
+		btPersistentManifold* manifold = m_mergedManifoldEvents[i].m_manifold;
+		if (m_mergedManifoldEvents[i].m_release)
+		{
+			removeManifoldFromArray(manifold);
+			freeManifoldMemory(manifold);
+		} else
+		{
+			manifold->m_index1a = m_manifoldsPtr.size();
+			m_manifoldsPtr.push_back(manifold);
+		}
+	}
+}
+
+void	btCollisionDispatcherMt::dispatchAllCollisionPairs(btOverlappingPairCache* pairCache,const btDispatcherInfo& dispatchInfo,btDispatcher* dispatcher)
+{
+	int numPairs = pairCache->getNumOverlappingPairs();
+
+	///continuous collision detection reduces the time of impact into dispatchInfo, keep it serial
+	if (!m_taskScheduler || m_taskScheduler->getNumThreads()<=1 || numPairs<=m_grainSize ||
+		dispatchInfo.m_dispatchFunc != btDispatcherInfo::DISPATCH_DISCRETE)
+	{
+		btCollisionDispatcher::dispatchAllCollisionPairs(pairCache,dispatchInfo,dispatcher);
+		return;
+	}
+	btAssert(m_threadContexts.size() >= m_taskScheduler->getNumThreads());
+
+	btBroadphasePair* pairs = pairCache->getOverlappingPairArrayPtr();
+
+	boundConvexSeparations(pairCache,dispatchInfo,m_taskScheduler);
+
+	m_dispatching = true;
+
+	{
+		BT_PROFILE("dispatchParallelPairs");
+		DispatchPairsLoop loop;
+		loop.m_dispatcher = this;
+		loop.m_pairs = pairs;
+		loop.m_dispatchInfo = &dispatchInfo;
+		m_taskScheduler->parallelFor(0,numPairs,m_grainSize,loop);
+	}
+
+	{
+		BT_PROFILE("dispatchSerialPairs");
+		ThreadContext& context = getThreadContext();
+		for (int i=0;i<numPairs;i++)
+		{
+			if (!isParallelPair(pairs[i]))
+			{
+				context.m_pairIndex = i;
+				context.m_sequence = 0;
+				(*getNearCallback())(pairs[i],*this,dispatchInfo);
+			}
+		}
+	}
+
+	m_dispatching = false;
+
+	clearConvexSeparationBounds(pairCache);
+
+	applyManifoldEvents();
+}
+
+void* btCollisionDispatcherMt::allocateCollisionAlgorithm(int size)
+{
+	ThreadContext& context = getThreadContext();
+	void* mem = context.m_algorithmPool->allocate(size);
+
+	if (!mem)
+	{
+		mem = btAlignedAlloc(static_cast<size_t>(size), 16);
+	}
+	return mem;
+}
+
+void btCollisionDispatcherMt::freeCollisionAlgorithm(void* ptr)
+{
+	for (int i=0;i<m_threadContexts.size();i++)
+	{
+		ThreadContext* context = m_threadContexts[i];
+		if (context->m_algorithmPool->validPtr(ptr))
+		{
+			context->m_algorithmPool->freeMemory(ptr);
+			return;
+		}
+	}
+	btAlignedFree(ptr);
+}
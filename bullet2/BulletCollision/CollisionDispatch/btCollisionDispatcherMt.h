@@ -0,0 +1,113 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2009 Erwin Coumans  http://bulletphysics.org
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef BT_COLLISION_DISPATCHER_MT_H
+#define BT_COLLISION_DISPATCHER_MT_H
+
+#include "btCollisionDispatcher.h"
+#include "LinearMath/btThreads.h"
+
+///btCollisionDispatcherMt processes the overlapping pairs on the threads of a btITaskScheduler.
+///Pairs of two convex shapes (or a convex shape and a static plane) are processed in parallel. Compound, concave,
+///soft body and GImpact pairs temporarily swap the shape of their collision objects, so they are processed afterwards
+///on the calling thread.
+///Each thread allocates collision algorithms and manifolds from its own pools. Manifolds created or released while
+///dispatching are added to / removed from the manifold array afterwards in pair order, so the manifold array
+///(and the simulation islands built from it) is the same as with btCollisionDispatcher.
+///The near callback, the contact added/processed callbacks and custom collision algorithms for convex pairs must be thread safe.
+class btCollisionDispatcherMt : public btCollisionDispatcher
+{
+	struct	ManifoldEvent
+	{
+		int						m_pairIndex;
+		int						m_sequence;
+		btPersistentManifold*	m_manifold;
+		bool					m_release;
+	};
+
+	struct	ManifoldEventSortPredicate
+	{
+		bool operator() ( const ManifoldEvent& lhs, const ManifoldEvent& rhs ) const
+		{
+			if (lhs.m_pairIndex != rhs.m_pairIndex)
+				return lhs.m_pairIndex < rhs.m_pairIndex;
+			return lhs.m_sequence < rhs.m_sequence;
+		}
+	};
+
+	///thread 0 uses the pools of the collision configuration, the other threads own their pools.
+	///The pools are thread safe, so any thread can free elements of them.
+	struct	ThreadContext
+	{
+		btPoolAllocator*	m_algorithmPool;
+		btPoolAllocator*	m_manifoldPool;
+		bool				m_ownsPools;
+
+		btAlignedObjectArray<ManifoldEvent>	m_manifoldEvents;
+		int					m_pairIndex;
+		int					m_sequence;
+	};
+
+	struct	DispatchPairsLoop;
+
+	btAlignedObjectArray<ThreadContext*>	m_threadContexts;
+	btAlignedObjectArray<ManifoldEvent>		m_mergedManifoldEvents;
+
+	btITaskScheduler*	m_taskScheduler;
+	int					m_grainSize;
+	int					m_threadPoolSize;
+	bool				m_dispatching;
+
+	ThreadContext&	getThreadContext()
+	{
+		return *m_threadContexts[btGetCurrentThreadIndex()];
+	}
+
+	void	addManifoldEvent(btPersistentManifold* manifold,bool release);
+
+	void	applyManifoldEvents();
+
+	void	freeManifoldMemory(btPersistentManifold* manifold);
+
+public:
+
+	///grainSize is the number of pairs per task, threadPoolSize the number of algorithms and manifolds in the pools of each worker thread
+	btCollisionDispatcherMt(btCollisionConfiguration* collisionConfiguration,int grainSize = 40,int threadPoolSize = 1024);
+
+	virtual ~btCollisionDispatcherMt();
+
+	///the scheduler is not owned by the dispatcher, pass 0 to dispatch serially
+	void	setTaskScheduler(btITaskScheduler* scheduler);
+
+	btITaskScheduler*	getTaskScheduler()
+	{
+		return m_taskScheduler;
+	}
+
+	///true for pairs that can be processed in parallel with other pairs
+	static bool	isParallelPair(const btBroadphasePair& pair);
+
+	virtual btPersistentManifold*	getNewManifold(void* b0,void* b1);
+
+	virtual void releaseManifold(btPersistentManifold* manifold);
+
+	virtual void	dispatchAllCollisionPairs(btOverlappingPairCache* pairCache,const btDispatcherInfo& dispatchInfo,btDispatcher* dispatcher) ;
+
+	virtual	void* allocateCollisionAlgorithm(int size);
+
+	virtual	void freeCollisionAlgorithm(void* ptr);
+};
+
+#endif //BT_COLLISION_DISPATCHER_MT_H
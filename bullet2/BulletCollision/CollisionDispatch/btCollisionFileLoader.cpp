@@ -0,0 +1,583 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2009 Erwin Coumans  http://bulletphysics.org
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include "btCollisionFileLoader.h"
+#include "btCollisionWorld.h"
+#include "btCollisionObject.h"
+#include "BulletCollision/CollisionShapes/btBoxShape.h"
+#include "BulletCollision/CollisionShapes/btSphereShape.h"
+#include "BulletCollision/CollisionShapes/btCapsuleShape.h"
+#include "BulletCollision/CollisionShapes/btCylinderShape.h"
+#include "BulletCollision/CollisionShapes/btConvexHullShape.h"
+#include "BulletCollision/CollisionShapes/btMultiSphereShape.h"
+#include "BulletCollision/CollisionShapes/btStaticPlaneShape.h"
+#include "BulletCollision/CollisionShapes/btCompoundShape.h"
+#include "BulletCollision/CollisionShapes/btBvhTriangleMeshShape.h"
+#include "BulletCollision/CollisionShapes/btScaledBvhTriangleMeshShape.h"
+#include "BulletCollision/CollisionShapes/btTriangleIndexVertexArray.h"
+#include "BulletCollision/CollisionShapes/btOptimizedBvh.h"
+#include "BulletCollision/CollisionShapes/btTriangleInfoMap.h"
+#include "LinearMath/btSerializer.h"
+#include <stdio.h>
+#include <string.h>
+
+static void	btDeSerializeTransform(btTransform& tr,const btTransformFloatData& data)
+{
+	tr.deSerializeFloat(data);
+}
+
+static void	btDeSerializeTransform(btTransform& tr,const btTransformDoubleData& data)
+{
+	tr.deSerializeDouble(data);
+}
+
+template <class T>
+static void	btDeSerializeCollisionObject(btCollisionObject* colObj,const T& data)
+{
+	btTransform worldTransform;
+	btDeSerializeTransform(worldTransform,data.m_worldTransform);
+	colObj->setWorldTransform(worldTransform);
+	btTransform interpolationWorldTransform;
+	btDeSerializeTransform(interpolationWorldTransform,data.m_interpolationWorldTransform);
+	colObj->setInterpolationWorldTransform(interpolationWorldTransform);
+	colObj->setFriction(btScalar(data.m_friction));
+	colObj->setRestitution(btScalar(data.m_restitution));
+	colObj->setContactProcessingThreshold(btScalar(data.m_contactProcessingThreshold));
+	colObj->setCcdMotionThreshold(btScalar(data.m_ccdMotionThreshold));
+	colObj->setCcdSweptSphereRadius(btScalar(data.m_ccdSweptSphereRadius));
+	colObj->setCollisionFlags(data.m_collisionFlags);
+}
+
+
+btCollisionFileLoader::btCollisionFileLoader(btCollisionWorld* collisionWorld)
+:m_collisionWorld(collisionWorld),
+m_verboseMode(0)
+{
+}
+
+btCollisionFileLoader::~btCollisionFileLoader()
+{
+	deleteAllData();
+}
+
+void	btCollisionFileLoader::deleteAllData()
+{
+	int i;
+	for (i=0;i<m_collisionObjects.size();i++)
+	{
+		if (m_collisionWorld)
+			m_collisionWorld->removeCollisionObject(m_collisionObjects[i]);
+		delete m_collisionObjects[i];
+	}
+	m_collisionObjects.clear();
+
+	for (i=0;i<m_collisionShapes.size();i++)
+	{
+		delete m_collisionShapes[i];
+	}
+	m_collisionShapes.clear();
+
+	for (i=0;i<m_meshInterfaces.size();i++)
+	{
+		delete m_meshInterfaces[i];
+	}
+	m_meshInterfaces.clear();
+
+	for (i=0;i<m_bvhs.size();i++)
+	{
+		m_bvhs[i]->~btOptimizedBvh();
+		btAlignedFree(m_bvhs[i]);
+	}
+	m_bvhs.clear();
+
+	for (i=0;i<m_triangleInfoMaps.size();i++)
+	{
+		delete m_triangleInfoMaps[i];
+	}
+	m_triangleInfoMaps.clear();
+
+	for (i=0;i<m_allocations.size();i++)
+	{
+		btAlignedFree(m_allocations[i]);
+	}
+	m_allocations.clear();
+
+	m_shapeMap.clear();
+	m_bvhMap.clear();
+	m_nameShapeMap.clear();
+	m_nameColObjMap.clear();
+	m_file.unload();
+}
+
+bool	btCollisionFileLoader::loadFile(const char* fileName)
+{
+	deleteAllData();
+	if (!m_file.loadFile(fileName))
+		return false;
+	return convertAllObjects();
+}
+
+bool	btCollisionFileLoader::loadBuffer(void* buffer,int length)
+{
+	deleteAllData();
+	if (!m_file.loadBuffer(buffer,length))
+		return false;
+	return convertAllObjects();
+}
+
+bool	btCollisionFileLoader::convertAllObjects()
+{
+	const btSerializedDna& dna = m_file.getNativeDna();
+	const int shapeStruct = dna.findStruct("btCollisionShapeData");
+	const int floatObjectStruct = dna.findStruct("btCollisionObjectFloatData");
+	const int doubleObjectStruct = dna.findStruct("btCollisionObjectDoubleData");
+	int i;
+
+	for (i=0;i<m_file.getNumChunks();i++)
+	{
+		const btSerializedChunk& chunk = m_file.getChunk(i);
+		if (chunk.m_code==BT_SHAPE_CODE && chunk.m_dnaNr>=0 && chunk.m_number>0)
+		{
+			//every shape struct starts with a btCollisionShapeData
+			const btSerializedDna::Struct& strc = dna.getStruct(chunk.m_dnaNr);
+			if (strc.m_size>=dna.getStruct(shapeStruct).m_size)
+			{
+				convertCollisionShape((btCollisionShapeData*)chunk.m_data);
+			}
+		}
+	}
+
+	for (i=0;i<m_file.getNumChunks();i++)
+	{
+		const btSerializedChunk& chunk = m_file.getChunk(i);
+		if ((chunk.m_code!=BT_COLLISIONOBJECT_CODE && chunk.m_code!=BT_RIGIDBODY_CODE) || chunk.m_dnaNr<0 || chunk.m_number<1)
+			continue;
+
+		//rigid body structs start with their collision object struct, find it through the dna
+		int objectStruct = chunk.m_dnaNr;
+		while (objectStruct>=0 && objectStruct!=floatObjectStruct && objectStruct!=doubleObjectStruct)
+		{
+			const btSerializedDna::Struct& strc = dna.getStruct(objectStruct);
+			const btSerializedDna::Member& first = dna.getMember(strc.m_firstMember);
+			objectStruct = (strc.m_numMembers && !first.m_isPointer && first.m_arrayLength==1) ? dna.getTypeStruct(first.m_type) : -1;
+		}
+		if (objectStruct<0)
+		{
+			if (m_verboseMode)
+				printf("btCollisionFileLoader: skipping object of unknown type %s\n",m_file.getStructName(chunk));
+			continue;
+		}
+		btCollisionObject* colObj = createCollisionObject((const char*)chunk.m_data,objectStruct==doubleObjectStruct);
+		if (colObj && m_collisionWorld)
+		{
+			m_collisionWorld->addCollisionObject(colObj);
+		}
+	}
+	return true;
+}
+
+btCollisionObject*	btCollisionFileLoader::createCollisionObject(const char* data,bool doublePrecision)
+{
+	const btCollisionObjectFloatData* floatData = doublePrecision ? 0 : (const btCollisionObjectFloatData*)data;
+	const btCollisionObjectDoubleData* doubleData = doublePrecision ? (const btCollisionObjectDoubleData*)data : 0;
+	btCollisionShapeData* shapeData = (btCollisionShapeData*)(doublePrecision ? doubleData->m_collisionShape : floatData->m_collisionShape);
+	btCollisionShape** shapePtr = shapeData ? m_shapeMap.find(shapeData) : 0;
+	if (!shapePtr || !*shapePtr)
+	{
+		if (m_verboseMode)
+			printf("btCollisionFileLoader: skipping object without a loaded shape\n");
+		return 0;
+	}
+
+	btCollisionObject* colObj = new btCollisionObject();
+	colObj->setCollisionShape(*shapePtr);
+	if (doublePrecision)
+	{
+		btDeSerializeCollisionObject(colObj,*doubleData);
+	} else
+	{
+		btDeSerializeCollisionObject(colObj,*floatData);
+	}
+	m_collisionObjects.push_back(colObj);
+
+	const char* name = doublePrecision ? doubleData->m_name : floatData->m_name;
+	if (name)
+	{
+		m_nameColObjMap.insert(name,colObj);
+	}
+	return colObj;
+}
+
+btOptimizedBvh*	btCollisionFileLoader::createOptimizedBvh(btQuantizedBvhFloatData* floatData,btQuantizedBvhDoubleData* doubleData)
+{
+	void* bvhData = floatData ? (void*)floatData : (void*)doubleData;
+	btOptimizedBvh** bvhPtr = m_bvhMap.find(bvhData);
+	if (bvhPtr)
+		return *bvhPtr;
+
+	void* mem = btAlignedAlloc(sizeof(btOptimizedBvh),16);
+	btOptimizedBvh* bvh = new (mem) btOptimizedBvh();
+	//the quantized nodes are used in place when the writer aligned them (see btDefaultSerializer::allocate)
+	if (floatData)
+	{
+		if (!(size_t(floatData->m_quantizedContiguousNodesPtr)&15))
+			bvh->deSerializeFloatInPlace(*floatData);
+		else
+			bvh->deSerializeFloat(*floatData);
+	} else
+	{
+		if (!(size_t(doubleData->m_quantizedContiguousNodesPtr)&15))
+			bvh->deSerializeDoubleInPlace(*doubleData);
+		else
+			bvh->deSerializeDouble(*doubleData);
+	}
+	m_bvhs.push_back(bvh);
+	m_bvhMap.insert(bvhData,bvh);
+	return bvh;
+}
+
+btStridingMeshInterface*	btCollisionFileLoader::createMeshInterface(btStridingMeshInterfaceData& meshData)
+{
+	btTriangleIndexVertexArray* meshInterface = new btTriangleIndexVertexArray();
+	m_meshInterfaces.push_back(meshInterface);
+
+	for (int i=0;i<meshData.m_numMeshParts;i++)
+	{
+		const btMeshPartData& part = meshData.m_meshPartsPtr[i];
+		btIndexedMesh meshPart;
+		meshPart.m_numTriangles = part.m_numTriangles;
+		meshPart.m_numVertices = part.m_numVertices;
+
+		//the vertices and the indices point into the file
+		if (part.m_vertices3f)
+		{
+			meshPart.m_vertexBase = (const unsigned char*)part.m_vertices3f;
+			meshPart.m_vertexStride = sizeof(btVector3FloatData);
+			meshPart.m_vertexType = PHY_FLOAT;
+		} else
+		{
+			meshPart.m_vertexBase = (const unsigned char*)part.m_vertices3d;
+			meshPart.m_vertexStride = sizeof(btVector3DoubleData);
+			meshPart.m_vertexType = PHY_DOUBLE;
+		}
+
+		if (part.m_indices32)
+		{
+			meshPart.m_triangleIndexBase = (const unsigned char*)part.m_indices32;
+			meshPart.m_triangleIndexStride = 3*sizeof(btIntIndexData);
+			meshPart.m_indexType = PHY_INTEGER;
+		} else if (part.m_3indices16)
+		{
+			meshPart.m_triangleIndexBase = (const unsigned char*)part.m_3indices16;
+			meshPart.m_triangleIndexStride = sizeof(btShortIntIndexTripletData);
+			meshPart.m_indexType = PHY_SHORT;
+		} else if (part.m_3indices8)
+		{
+			meshPart.m_triangleIndexBase = (const unsigned char*)part.m_3indices8;
+			meshPart.m_triangleIndexStride = sizeof(btCharIndexTripletData);
+			meshPart.m_indexType = PHY_UCHAR;
+		} else if (part.m_indices16)
+		{
+			//older files pad each 16 bit index, these are packed into a copy
+			const int numIndices = 3*part.m_numTriangles;
+			short* indices = (short*)btAlignedAlloc(sizeof(short)*(numIndices ? numIndices : 1),16);
+			m_allocations.push_back(indices);
+			for (int j=0;j<numIndices;j++)
+			{
+				indices[j] = part.m_indices16[j].m_value;
+			}
+			meshPart.m_triangleIndexBase = (const unsigned char*)indices;
+			meshPart.m_triangleIndexStride = 3*sizeof(short);
+			meshPart.m_indexType = PHY_SHORT;
+		} else
+		{
+			meshPart.m_triangleIndexBase = 0;
+			meshPart.m_numTriangles = 0;
+		}
+
+		if (!meshPart.m_vertexBase)
+		{
+			meshPart.m_numVertices = 0;
+			meshPart.m_numTriangles = 0;
+		}
+		meshInterface->addIndexedMesh(meshPart,meshPart.m_indexType);
+	}
+
+	btVector3 scaling;
+	scaling.deSerializeFloat(meshData.m_scaling);
+	meshInterface->setScaling(scaling);
+	return meshInterface;
+}
+
+btBvhTriangleMeshShape*	btCollisionFileLoader::createTriangleMeshShape(btTriangleMeshShapeData& trimeshData)
+{
+	btStridingMeshInterface* meshInterface = createMeshInterface(trimeshData.m_meshInterface);
+	btOptimizedBvh* bvh = 0;
+	if (trimeshData.m_quantizedFloatBvh || trimeshData.m_quantizedDoubleBvh)
+	{
+		bvh = createOptimizedBvh(trimeshData.m_quantizedFloatBvh,trimeshData.m_quantizedDoubleBvh);
+		//the bvh bounds the mesh, which saves a pass over all vertices in the btTriangleMeshShape constructor
+		btVector3 bvhAabbMin,bvhAabbMax;
+		if (trimeshData.m_quantizedFloatBvh)
+		{
+			bvhAabbMin.deSerializeFloat(trimeshData.m_quantizedFloatBvh->m_bvhAabbMin);
+			bvhAabbMax.deSerializeFloat(trimeshData.m_quantizedFloatBvh->m_bvhAabbMax);
+		} else
+		{
+			bvhAabbMin.deSerializeDouble(trimeshData.m_quantizedDoubleBvh->m_bvhAabbMin);
+			bvhAabbMax.deSerializeDouble(trimeshData.m_quantizedDoubleBvh->m_bvhAabbMax);
+		}
+		meshInterface->setPremadeAabb(bvhAabbMin,bvhAabbMax);
+	}
+
+	btBvhTriangleMeshShape* trimesh = new btBvhTriangleMeshShape(meshInterface,bvh ? bvh->isQuantized() : true,bvh==0);
+	if (bvh)
+	{
+		trimesh->setOptimizedBvh(bvh,meshInterface->getScaling());
+	}
+	trimesh->setMargin(btScalar(trimeshData.m_collisionMargin));
+
+	//the hash table of the triangle info map is stored as plain ints, which are not converted for the other byte order
+	if (trimeshData.m_triangleInfoMap && !m_file.isSwapped())
+	{
+		btTriangleInfoMap* triangleInfoMap = new btTriangleInfoMap();
+		triangleInfoMap->deSerialize(*trimeshData.m_triangleInfoMap);
+		trimesh->setTriangleInfoMap(triangleInfoMap);
+		m_triangleInfoMaps.push_back(triangleInfoMap);
+	}
+	return trimesh;
+}
+
+btCollisionShape*	btCollisionFileLoader::convertCollisionShape(btCollisionShapeData* shapeData)
+{
+	btCollisionShape** shapePtr = m_shapeMap.find(shapeData);
+	if (shapePtr)
+		return *shapePtr;
+
+	btCollisionShape* shape = 0;
+	switch (shapeData->m_shapeType)
+	{
+	case BOX_SHAPE_PROXYTYPE:
+	case SPHERE_SHAPE_PROXYTYPE:
+	case CAPSULE_SHAPE_PROXYTYPE:
+	case CYLINDER_SHAPE_PROXYTYPE:
+	case CONVEX_HULL_SHAPE_PROXYTYPE:
+	case MULTI_SPHERE_SHAPE_PROXYTYPE:
+		{
+			btConvexInternalShapeData* convexData = (btConvexInternalShapeData*)shapeData;
+			btVector3 localScaling;
+			localScaling.deSerializeFloat(convexData->m_localScaling);
+			btVector3 implicitShapeDimensions;
+			implicitShapeDimensions.deSerializeFloat(convexData->m_implicitShapeDimensions);
+			const btScalar margin = btScalar(convexData->m_collisionMargin);
+			//the unscaled dimensions including the margin, as passed to the constructors
+			const btVector3 halfExtents = (implicitShapeDimensions+btVector3(margin,margin,margin))/localScaling;
+
+			switch (shapeData->m_shapeType)
+			{
+			case BOX_SHAPE_PROXYTYPE:
+				{
+					shape = new btBoxShape(halfExtents);
+					shape->setMargin(margin);
+					break;
+				}
+			case SPHERE_SHAPE_PROXYTYPE:
+				{
+					//the radius of a sphere is its margin
+					shape = new btSphereShape(implicitShapeDimensions.getX());
+					break;
+				}
+			case CAPSULE_SHAPE_PROXYTYPE:
+				{
+					btCapsuleShapeData* capsuleData = (btCapsuleShapeData*)shapeData;
+					const int upAxis = capsuleData->m_upAxis;
+					const btScalar radius = halfExtents[(upAxis+2)%3];
+					const btScalar height = btScalar(2.)*halfExtents[upAxis];
+					switch (upAxis)
+					{
+					case 0:
+						shape = new btCapsuleShapeX(radius,height);
+						break;
+					case 2:
+						shape = new btCapsuleShapeZ(radius,height);
+						break;
+					default:
+						shape = new btCapsuleShape(radius,height);
+						break;
+					}
+					shape->setMargin(margin);
+					break;
+				}
+			case CYLINDER_SHAPE_PROXYTYPE:
+				{
+					btCylinderShapeData* cylinderData = (btCylinderShapeData*)shapeData;
+					switch (cylinderData->m_upAxis)
+					{
+					case 0:
+						shape = new btCylinderShapeX(halfExtents);
+						break;
+					case 2:
+						shape = new btCylinderShapeZ(halfExtents);
+						break;
+					default:
+						shape = new btCylinderShape(halfExtents);
+						break;
+					}
+					shape->setMargin(margin);
+					break;
+				}
+			case CONVEX_HULL_SHAPE_PROXYTYPE:
+				{
+					btConvexHullShapeData* hullData = (btConvexHullShapeData*)shapeData;
+					const int numPoints = hullData->m_numUnscaledPoints;
+#ifdef BT_USE_DOUBLE_PRECISION
+					btVector3* points = (btVector3*)hullData->m_unscaledPointsDoublePtr;
+#else
+					btVector3* points = (btVector3*)hullData->m_unscaledPointsFloatPtr;
+#endif
+					btConvexHullShape* hull = 0;
+					if (points && !(size_t(points)&15))
+					{
+						//the points have the layout of btVector3, use them in place
+						hull = new btConvexHullShape();
+						hull->setUnscaledPointsInPlace(points,numPoints);
+					} else
+					{
+						btAlignedObjectArray<btVector3> convertedPoints;
+						convertedPoints.resize(numPoints);
+						for (int i=0;i<numPoints;i++)
+						{
+							if (hullData->m_unscaledPointsFloatPtr)
+								convertedPoints[i].deSerializeFloat(hullData->m_unscaledPointsFloatPtr[i]);
+							else if (hullData->m_unscaledPointsDoublePtr)
+								convertedPoints[i].deSerializeDouble(hullData->m_unscaledPointsDoublePtr[i]);
+							else
+								convertedPoints[i].setValue(0,0,0);
+						}
+						hull = new btConvexHullShape(numPoints ? &convertedPoints[0].getX() : 0,numPoints);
+					}
+					hull->setMargin(margin);
+					shape = hull;
+					break;
+				}
+			case MULTI_SPHERE_SHAPE_PROXYTYPE:
+				{
+					btMultiSphereShapeData* multiSphereData = (btMultiSphereShapeData*)shapeData;
+					const int numSpheres = multiSphereData->m_localPositionArraySize;
+					if (numSpheres<1 || !multiSphereData->m_localPositionArrayPtr)
+						break;
+					btAlignedObjectArray<btVector3> positions;
+					btAlignedObjectArray<btScalar> radii;
+					positions.resize(numSpheres);
+					radii.resize(numSpheres);
+					for (int i=0;i<numSpheres;i++)
+					{
+						positions[i].deSerializeFloat(multiSphereData->m_localPositionArrayPtr[i].m_pos);
+						radii[i] = btScalar(multiSphereData->m_localPositionArrayPtr[i].m_radius);
+					}
+					shape = new btMultiSphereShape(&positions[0],&radii[0],numSpheres);
+					shape->setMargin(margin);
+					break;
+				}
+			default:
+				break;
+			}
+			if (shape)
+			{
+				shape->setLocalScaling(localScaling);
+			}
+			if (shape && shapeData->m_shapeType!=CONVEX_HULL_SHAPE_PROXYTYPE && shapeData->m_shapeType!=MULTI_SPHERE_SHAPE_PROXYTYPE)
+			{
+				//setMargin and setLocalScaling round the dimensions, restore them exactly as they were saved
+				((btConvexInternalShape*)shape)->setImplicitShapeDimensions(implicitShapeDimensions);
+			}
+			break;
+		}
+	case STATIC_PLANE_PROXYTYPE:
+		{
+			btStaticPlaneShapeData* planeData = (btStaticPlaneShapeData*)shapeData;
+			btVector3 planeNormal,localScaling;
+			planeNormal.deSerializeFloat(planeData->m_planeNormal);
+			localScaling.deSerializeFloat(planeData->m_localScaling);
+			shape = new btStaticPlaneShape(planeNormal,btScalar(planeData->m_planeConstant));
+			shape->setLocalScaling(localScaling);
+			break;
+		}
+	case COMPOUND_SHAPE_PROXYTYPE:
+		{
+			btCompoundShapeData* compoundData = (btCompoundShapeData*)shapeData;
+			btCompoundShape* compound = new btCompoundShape();
+			//register the compound first, so a corrupt file that contains it as its own child can not recurse forever
+			m_shapeMap.insert(shapeData,compound);
+			m_collisionShapes.push_back(compound);
+			for (int i=0;i<compoundData->m_numChildShapes;i++)
+			{
+				btCompoundShapeChildData& childData = compoundData->m_childShapePtr[i];
+				btCollisionShape* childShape = childData.m_childShape ? convertCollisionShape(childData.m_childShape) : 0;
+				if (!childShape || childShape==compound)
+					continue;
+				btTransform childTransform;
+				childTransform.deSerializeFloat(childData.m_transform);
+				compound->addChildShape(childTransform,childShape);
+			}
+			compound->setMargin(btScalar(compoundData->m_collisionMargin));
+			if (shapeData->m_name)
+				m_nameShapeMap.insert(shapeData->m_name,compound);
+			return compound;
+		}
+	case TRIANGLE_MESH_SHAPE_PROXYTYPE:
+		{
+			shape = createTriangleMeshShape(*(btTriangleMeshShapeData*)shapeData);
+			break;
+		}
+	case SCALED_TRIANGLE_MESH_SHAPE_PROXYTYPE:
+		{
+			//the scaled shape embeds the data of its child
+			btScaledTriangleMeshShapeData* scaledData = (btScaledTriangleMeshShapeData*)shapeData;
+			btBvhTriangleMeshShape* childShape = createTriangleMeshShape(scaledData->m_trimeshShapeData);
+			m_collisionShapes.push_back(childShape);
+			btVector3 localScaling;
+			localScaling.deSerializeFloat(scaledData->m_localScaling);
+			shape = new btScaledBvhTriangleMeshShape(childShape,localScaling);
+			break;
+		}
+	default:
+		break;
+	}
+
+	if (!shape)
+	{
+		if (m_verboseMode)
+			printf("btCollisionFileLoader: unsupported shape type %d\n",shapeData->m_shapeType);
+		return 0;
+	}
+	m_shapeMap.insert(shapeData,shape);
+	m_collisionShapes.push_back(shape);
+	if (shapeData->m_name)
+		m_nameShapeMap.insert(shapeData->m_name,shape);
+	return shape;
+}
+
+btCollisionShape*	btCollisionFileLoader::getCollisionShapeByName(const char* name)
+{
+	btCollisionShape** shapePtr = m_nameShapeMap.find(name);
+	return shapePtr ? *shapePtr : 0;
+}
+
+btCollisionObject*	btCollisionFileLoader::getCollisionObjectByName(const char* name)
+{
+	btCollisionObject** colObjPtr = m_nameColObjMap.find(name);
+	return colObjPtr ? *colObjPtr : 0;
+}
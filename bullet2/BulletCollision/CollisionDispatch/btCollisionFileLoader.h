@@ -0,0 +1,138 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2009 Erwin Coumans  http://bulletphysics.org
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef BT_COLLISION_FILE_LOADER_H
+#define BT_COLLISION_FILE_LOADER_H
+
+#include "LinearMath/btSerializedFile.h"
+#include "LinearMath/btAlignedObjectArray.h"
+#include "LinearMath/btHashMap.h"
+
+class btCollisionWorld;
+class btCollisionObject;
+class btCollisionShape;
+class btStridingMeshInterface;
+class btOptimizedBvh;
+class btBvhTriangleMeshShape;
+struct btTriangleInfoMap;
+struct btCollisionShapeData;
+struct btStridingMeshInterfaceData;
+struct btTriangleMeshShapeData;
+struct btQuantizedBvhFloatData;
+struct btQuantizedBvhDoubleData;
+
+///btCollisionFileLoader creates the collision shapes and objects of a .bullet file written by btCollisionWorld::serialize
+///(or btDiscreteDynamicsWorld::serialize) from a memory mapped btSerializedFile.
+///Triangle meshes are not rebuilt: their vertices, indices and quantized bvh nodes are used in place in the mapping,
+///so loading a large static level touches little more than its small chunks. Rigid bodies are loaded as collision objects
+///with their world transform, shape, friction and restitution, for queries; the dynamics state is not loaded.
+///The loader owns everything it creates, and the file must stay loaded (the loader must not be deleted) while they are used.
+class btCollisionFileLoader
+{
+protected:
+
+	btSerializedFile	m_file;
+	btCollisionWorld*	m_collisionWorld;
+	int					m_verboseMode;
+
+	btAlignedObjectArray<btCollisionShape*>			m_collisionShapes;
+	btAlignedObjectArray<btCollisionObject*>		m_collisionObjects;
+	btAlignedObjectArray<btStridingMeshInterface*>	m_meshInterfaces;
+	btAlignedObjectArray<btOptimizedBvh*>			m_bvhs;
+	btAlignedObjectArray<btTriangleInfoMap*>		m_triangleInfoMaps;
+	///converted arrays that could not be used in place
+	btAlignedObjectArray<void*>						m_allocations;
+
+	btHashMap<btHashPtr,btCollisionShape*>		m_shapeMap;
+	btHashMap<btHashPtr,btOptimizedBvh*>		m_bvhMap;
+	btHashMap<btHashString,btCollisionShape*>	m_nameShapeMap;
+	btHashMap<btHashString,btCollisionObject*>	m_nameColObjMap;
+
+	bool	convertAllObjects();
+
+	virtual btCollisionShape*			convertCollisionShape(btCollisionShapeData* shapeData);
+
+	virtual btBvhTriangleMeshShape*		createTriangleMeshShape(btTriangleMeshShapeData& trimeshData);
+
+	virtual btStridingMeshInterface*	createMeshInterface(btStridingMeshInterfaceData& meshData);
+
+	virtual btOptimizedBvh*				createOptimizedBvh(btQuantizedBvhFloatData* floatData,btQuantizedBvhDoubleData* doubleData);
+
+	///data is a btCollisionObjectFloatData or btCollisionObjectDoubleData
+	virtual btCollisionObject*			createCollisionObject(const char* data,bool doublePrecision);
+
+public:
+
+	///loaded collision objects are added to collisionWorld, when it is not 0
+	btCollisionFileLoader(btCollisionWorld* collisionWorld=0);
+
+	virtual ~btCollisionFileLoader();
+
+	///maps the file and creates its shapes and objects. Returns false when the file can not be read (see getFile().getError()).
+	bool	loadFile(const char* fileName);
+
+	///as loadFile, for a .bullet file in memory that stays valid while the loaded objects are used
+	bool	loadBuffer(void* buffer,int length);
+
+	///removes the loaded objects from the world, deletes everything created and unloads the file
+	void	deleteAllData();
+
+	const btSerializedFile&	getFile() const
+	{
+		return m_file;
+	}
+
+	///print warnings for chunks that are skipped
+	void	setVerboseMode(int verboseMode)
+	{
+		m_verboseMode = verboseMode;
+	}
+
+	int		getNumCollisionShapes() const
+	{
+		return m_collisionShapes.size();
+	}
+
+	btCollisionShape*	getCollisionShapeByIndex(int index)
+	{
+		return m_collisionShapes[index];
+	}
+
+	int		getNumCollisionObjects() const
+	{
+		return m_collisionObjects.size();
+	}
+
+	btCollisionObject*	getCollisionObjectByIndex(int index)
+	{
+		return m_collisionObjects[index];
+	}
+
+	int		getNumBvhs() const
+	{
+		return m_bvhs.size();
+	}
+
+	btOptimizedBvh*	getBvhByIndex(int index)
+	{
+		return m_bvhs[index];
+	}
+
+	btCollisionShape*	getCollisionShapeByName(const char* name);
+
+	btCollisionObject*	getCollisionObjectByName(const char* name);
+};
+
+#endif //BT_COLLISION_FILE_LOADER_H
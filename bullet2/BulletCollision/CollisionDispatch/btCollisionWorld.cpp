@@ -21,6 +21,7 @@ subject to the following restrictions:
 #include "BulletCollision/NarrowPhaseCollision/btGjkEpaPenetrationDepthSolver.h"
 #include "BulletCollision/CollisionShapes/btSphereShape.h" //for raycasting
 #include "BulletCollision/CollisionShapes/btBvhTriangleMeshShape.h" //for raycasting
+#include "BulletCollision/CollisionShapes/btHeightfieldTerrainShape.h" //for raycasting
 #include "BulletCollision/NarrowPhaseCollision/btRaycastCallback.h"
 #include "BulletCollision/CollisionShapes/btCompoundShape.h"
 #include "BulletCollision/NarrowPhaseCollision/btSubSimplexConvexCast.h"
@@ -34,9 +35,13 @@ subject to the following restrictions:
 #include "LinearMath/btStackAlloc.h"
 #include "LinearMath/btSerializer.h"
 #include "BulletCollision/CollisionShapes/btConvexPolyhedron.h"
+#include "LinearMath/btThreads.h"
 
 //#define DISABLE_DBVT_COMPOUNDSHAPE_RAYCAST_ACCELERATION
 
+///number of ray packets per rayTestBatch task
+#define BT_RAY_BATCH_GRAIN_SIZE 16
+
 
 //#define USE_BRUTEFORCE_RAYBROADPHASE 1
 //RECALCULATE_AABB is slower, but benefit is that you don't need to call 'stepSimulation'  or 'updateAabbs' before using a rayTest
@@ -426,12 +431,20 @@ void	btCollisionWorld::rayTestSingle(const btTransform& rayFromTrans,const btTra
 				BridgeTriangleRaycastCallback	rcb(rayFromLocal,rayToLocal,&resultCallback,collisionObject,concaveShape, colObjWorldTransform);
 				rcb.m_hitFraction = resultCallback.m_closestHitFraction;
 
-				btVector3 rayAabbMinLocal = rayFromLocal;
-				rayAabbMinLocal.setMin(rayToLocal);
-				btVector3 rayAabbMaxLocal = rayFromLocal;
-				rayAabbMaxLocal.setMax(rayToLocal);
+				if (collisionShape->getShapeType()==TERRAIN_SHAPE_PROXYTYPE)
+				{
+					///traverses the min/max height pyramid of btHeightfieldTerrainShape when it has one
+					btHeightfieldTerrainShape* heightfield = (btHeightfieldTerrainShape*)collisionShape;
+					heightfield->performRaycast(&rcb,rayFromLocal,rayToLocal);
+				} else
+				{
+					btVector3 rayAabbMinLocal = rayFromLocal;
+					rayAabbMinLocal.setMin(rayToLocal);
+					btVector3 rayAabbMaxLocal = rayFromLocal;
+					rayAabbMaxLocal.setMax(rayToLocal);
 
-				concaveShape->processAllTriangles(&rcb,rayAabbMinLocal,rayAabbMaxLocal);
+					concaveShape->processAllTriangles(&rcb,rayAabbMinLocal,rayAabbMaxLocal);
+				}
 			}
 		} else {
 			//			BT_PROFILE("rayTestCompound");
@@ -917,6 +930,444 @@ void	btCollisionWorld::rayTest(const btVector3& rayFromWorld, const btVector3& r
 }
 
 
+///RayBatchPacket is one packet of rayTestBatch: its rays in world space, and the closest hits found so far
+struct	btRayBatchPacket
+{
+	btRayPacket		m_packet;
+	btVector3		m_rayFromWorld[BT_RAY_PACKET_SIZE];
+	btVector3		m_rayToWorld[BT_RAY_PACKET_SIZE];
+	btCollisionWorld::RayBatchHit*	m_hits[BT_RAY_PACKET_SIZE];
+
+	void	reportHit(int ray,btCollisionObject* collisionObject,const btVector3& hitNormalWorld,btScalar hitFraction,int shapePart,int triangleIndex)
+	{
+		btCollisionWorld::RayBatchHit& hit = *m_hits[ray];
+		m_packet.m_maxFraction[ray] = hitFraction;
+		hit.m_hitFraction = hitFraction;
+		hit.m_collisionObject = collisionObject;
+		hit.m_hitNormalWorld = hitNormalWorld;
+		hit.m_hitPointWorld.setInterpolate3(m_rayFromWorld[ray],m_rayToWorld[ray],hitFraction);
+		hit.m_shapePart = shapePart;
+		hit.m_triangleIndex = triangleIndex;
+	}
+};
+
+///closest hit of one ray, for the shapes without a packet test
+struct btRayBatchSingleCallback : public btCollisionWorld::RayResultCallback
+{
+	btRayBatchPacket&	m_batchPacket;
+	int					m_ray;
+	int					m_childIndex;
+
+	btRayBatchSingleCallback(btRayBatchPacket& batchPacket,int ray,int childIndex)
+		:m_batchPacket(batchPacket),
+		m_ray(ray),
+		m_childIndex(childIndex)
+	{
+		m_closestHitFraction = batchPacket.m_packet.m_maxFraction[ray];
+	}
+
+	virtual	btScalar	addSingleResult(btCollisionWorld::LocalRayResult& rayResult,bool normalInWorldSpace)
+	{
+		btAssert(rayResult.m_hitFraction <= m_closestHitFraction);
+		m_closestHitFraction = rayResult.m_hitFraction;
+		m_collisionObject = rayResult.m_collisionObject;
+		btVector3 hitNormalWorld = rayResult.m_hitNormalLocal;
+		if (!normalInWorldSpace)
+		{
+			hitNormalWorld = m_collisionObject->getWorldTransform().getBasis()*rayResult.m_hitNormalLocal;
+		}
+		if (rayResult.m_localShapeInfo)
+		{
+			m_batchPacket.reportHit(m_ray,m_collisionObject,hitNormalWorld,rayResult.m_hitFraction,rayResult.m_localShapeInfo->m_shapePart,rayResult.m_localShapeInfo->m_triangleIndex);
+		} else
+		{
+			m_batchPacket.reportHit(m_ray,m_collisionObject,hitNormalWorld,rayResult.m_hitFraction,-1,m_childIndex);
+		}
+		return rayResult.m_hitFraction;
+	}
+};
+
+///tests the triangles of a btBvhTriangleMeshShape against the rays of a packet, the same way btTriangleRaycastCallback does for one ray
+struct btRayBatchMeshCallback : public btNodeOverlapPacketCallback
+{
+	btRayBatchPacket&			m_batchPacket;
+	btRayPacket&				m_localPacket;
+	const btStridingMeshInterface*	m_meshInterface;
+	btCollisionObject*			m_collisionObject;
+	const btMatrix3x3&			m_basis;
+
+	btRayBatchMeshCallback(btRayBatchPacket& batchPacket,btRayPacket& localPacket,const btStridingMeshInterface* meshInterface,btCollisionObject* collisionObject,const btMatrix3x3& basis)
+		:m_batchPacket(batchPacket),
+		m_localPacket(localPacket),
+		m_meshInterface(meshInterface),
+		m_collisionObject(collisionObject),
+		m_basis(basis)
+	{
+	}
+
+	virtual void processNode(int nodeSubPart, int nodeTriangleIndex, int rayMask)
+	{
+		btVector3 triangle[3];
+		const unsigned char *vertexbase;
+		int numverts;
+		PHY_ScalarType type;
+		int stride;
+		const unsigned char *indexbase;
+		int indexstride;
+		int numfaces;
+		PHY_ScalarType indicestype;
+
+		m_meshInterface->getLockedReadOnlyVertexIndexBase(
+			&vertexbase,
+			numverts,
+			type,
+			stride,
+			&indexbase,
+			indexstride,
+			numfaces,
+			indicestype,
+			nodeSubPart);
+
+		unsigned int* gfxbase = (unsigned int*)(indexbase+nodeTriangleIndex*indexstride);
+		btAssert(indicestype==PHY_INTEGER||indicestype==PHY_SHORT);
+
+		const btVector3& meshScaling = m_meshInterface->getScaling();
+		for (int j=2;j>=0;j--)
+		{
+			int graphicsindex = indicestype==PHY_SHORT?((unsigned short*)gfxbase)[j]:gfxbase[j];
+			if (type == PHY_FLOAT)
+			{
+				float* graphicsbase = (float*)(vertexbase+graphicsindex*stride);
+				triangle[j] = btVector3(graphicsbase[0]*meshScaling.getX(),graphicsbase[1]*meshScaling.getY(),graphicsbase[2]*meshScaling.getZ());
+			}
+			else
+			{
+				double* graphicsbase = (double*)(vertexbase+graphicsindex*stride);
+				triangle[j] = btVector3(btScalar(graphicsbase[0])*meshScaling.getX(),btScalar(graphicsbase[1])*meshScaling.getY(),btScalar(graphicsbase[2])*meshScaling.getZ());
+			}
+		}
+		m_meshInterface->unLockReadOnlyVertexBase(nodeSubPart);
+
+		processTriangle(triangle,nodeSubPart,nodeTriangleIndex,rayMask);
+	}
+
+	void	processTriangle(const btVector3* triangle,int partId,int triangleIndex,int rayMask)
+	{
+		const btVector3 v10 = triangle[1] - triangle[0];
+		const btVector3 v20 = triangle[2] - triangle[0];
+		btVector3 triangleNormal = v10.cross(v20);
+		const btScalar dist = triangle[0].dot(triangleNormal);
+
+		///plane crossing of all rays at once, the rest of the test runs for the rays that cross the plane closer than their hits
+		ATTRIBUTE_ALIGNED16(btScalar	distA[BT_RAY_PACKET_SIZE]);
+		ATTRIBUTE_ALIGNED16(btScalar	distance[BT_RAY_PACKET_SIZE]);
+#if defined (BT_USE_SSE) && (BT_RAY_PACKET_SIZE == 4)
+		const __m128 nx = _mm_set1_ps(triangleNormal.getX());
+		const __m128 ny = _mm_set1_ps(triangleNormal.getY());
+		const __m128 nz = _mm_set1_ps(triangleNormal.getZ());
+		const __m128 d = _mm_set1_ps(dist);
+		const __m128 a = _mm_sub_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(nx,_mm_load_ps(m_localPacket.m_from[0])),_mm_mul_ps(ny,_mm_load_ps(m_localPacket.m_from[1]))),_mm_mul_ps(nz,_mm_load_ps(m_localPacket.m_from[2]))),d);
+		const __m128 b = _mm_sub_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(nx,_mm_load_ps(m_localPacket.m_to[0])),_mm_mul_ps(ny,_mm_load_ps(m_localPacket.m_to[1]))),_mm_mul_ps(nz,_mm_load_ps(m_localPacket.m_to[2]))),d);
+		const __m128 t = _mm_div_ps(a,_mm_sub_ps(a,b));
+		const __m128 crossing = _mm_cmplt_ps(_mm_mul_ps(a,b),_mm_setzero_ps());
+		const __m128 closer = _mm_cmplt_ps(t,_mm_load_ps(m_localPacket.m_maxFraction));
+		rayMask &= _mm_movemask_ps(_mm_and_ps(crossing,closer));
+		if (!rayMask)
+			return;
+		_mm_store_ps(distA,a);
+		_mm_store_ps(distance,t);
+#else
+		int crossingMask = 0;
+		for (int i=0;i<BT_RAY_PACKET_SIZE;i++)
+		{
+			if (rayMask & (1<<i))
+			{
+				distA[i] = triangleNormal.dot(m_localPacket.getFrom(i)) - dist;
+				const btScalar distB = triangleNormal.dot(m_localPacket.getTo(i)) - dist;
+				distance[i] = distA[i]/(distA[i]-distB);
+				if ((distA[i]*distB < btScalar(0.0)) && (distance[i] < m_localPacket.m_maxFraction[i]))
+					crossingMask |= 1<<i;
+			}
+		}
+		rayMask = crossingMask;
+		if (!rayMask)
+			return;
+#endif
+
+		btScalar edge_tolerance = triangleNormal.length2();
+		edge_tolerance *= btScalar(-0.0001);
+		for (int i=0;i<BT_RAY_PACKET_SIZE;i++)
+		{
+			if (!(rayMask & (1<<i)))
+				continue;
+			btVector3 point; point.setInterpolate3(m_localPacket.getFrom(i),m_localPacket.getTo(i),distance[i]);
+			const btVector3 v0p = triangle[0] - point;
+			const btVector3 v1p = triangle[1] - point;
+			if (v0p.cross(v1p).dot(triangleNormal) < edge_tolerance)
+				continue;
+			const btVector3 v2p = triangle[2] - point;
+			if (v1p.cross(v2p).dot(triangleNormal) < edge_tolerance)
+				continue;
+			if (v2p.cross(v0p).dot(triangleNormal) < edge_tolerance)
+				continue;
+			btVector3 hitNormalLocal = triangleNormal.normalized();
+			if (distA[i] <= btScalar(0.0))
+				hitNormalLocal = -hitNormalLocal;
+			m_localPacket.m_maxFraction[i] = distance[i];
+			m_batchPacket.reportHit(i,m_collisionObject,m_basis*hitNormalLocal,distance[i],partId,triangleIndex);
+		}
+	}
+};
+
+///tests the rays of rayMask against a collision object, or against a child shape of its compound shape
+static void	rayTestBatchObject(btRayBatchPacket& batchPacket,int rayMask,btCollisionObject* collisionObject,const btCollisionShape* collisionShape,const btTransform& colObjWorldTransform,int childIndex)
+{
+	if (collisionShape->getShapeType()==TRIANGLE_MESH_SHAPE_PROXYTYPE)
+	{
+		btBvhTriangleMeshShape* triangleMesh = (btBvhTriangleMeshShape*)collisionShape;
+		btTransform worldTocollisionObject = colObjWorldTransform.inverse();
+		btRayPacket localPacket;
+		localPacket.initTransformed(batchPacket.m_packet,worldTocollisionObject);
+		for (int i=0;i<BT_RAY_PACKET_SIZE;i++)
+		{
+			if (!(rayMask & (1<<i)))
+				localPacket.m_maxFraction[i] = btScalar(-1.);
+		}
+		btRayBatchMeshCallback meshCallback(batchPacket,localPacket,triangleMesh->getMeshInterface(),collisionObject,colObjWorldTransform.getBasis());
+		triangleMesh->getOptimizedBvh()->reportRayPacketOverlappingNodex(&meshCallback,localPacket);
+		return;
+	}
+
+	if (collisionShape->isCompound())
+	{
+		///the children are tested here instead of in rayTestSingle, which temporarily replaces the shape of the collision object
+		struct ChildTester : btDbvt::ICollide
+		{
+			btRayBatchPacket&		m_batchPacket;
+			int						m_rayMask;
+			btCollisionObject*		m_collisionObject;
+			const btCompoundShape*	m_compoundShape;
+			const btTransform&		m_colObjWorldTransform;
+			///rays in the frame of the compound shape, to test them against its dynamic aabb tree
+			btRayPacket				m_localPacket;
+
+			ChildTester(btRayBatchPacket& batchPacket,int rayMask,btCollisionObject* collisionObject,const btCompoundShape* compoundShape,const btTransform& colObjWorldTransform)
+				:m_batchPacket(batchPacket),
+				m_rayMask(rayMask),
+				m_collisionObject(collisionObject),
+				m_compoundShape(compoundShape),
+				m_colObjWorldTransform(colObjWorldTransform)
+			{
+			}
+
+			void Process(int i,int rayMask)
+			{
+				const btCollisionShape* childCollisionShape = m_compoundShape->getChildShape(i);
+				btTransform childWorldTrans = m_colObjWorldTransform * m_compoundShape->getChildTransform(i);
+				rayTestBatchObject(m_batchPacket,rayMask,m_collisionObject,childCollisionShape,childWorldTrans,i);
+			}
+
+			void Process(const btDbvtNode* leaf)
+			{
+				///the traversal visits the leaves hit by any ray of the packet, keep those that hit this leaf
+				const int rayMask = m_rayMask & m_localPacket.testAabb(leaf->volume.Mins(),leaf->volume.Maxs());
+				if (rayMask)
+				{
+					Process(leaf->dataAsInt,rayMask);
+				}
+			}
+		};
+
+		const btCompoundShape* compoundShape = static_cast<const btCompoundShape*>(collisionShape);
+		ChildTester childTester(batchPacket,rayMask,collisionObject,compoundShape,colObjWorldTransform);
+		const btDbvt* dbvt = compoundShape->getDynamicAabbTree();
+#ifndef	DISABLE_DBVT_COMPOUNDSHAPE_RAYCAST_ACCELERATION
+		if (dbvt)
+		{
+			childTester.m_localPacket.initTransformed(batchPacket.m_packet,colObjWorldTransform.inverse());
+			btDbvt::rayTestPacket(dbvt->m_root,childTester.m_localPacket,childTester);
+		}
+		else
+#endif //DISABLE_DBVT_COMPOUNDSHAPE_RAYCAST_ACCELERATION
+		{
+			for (int i = 0, n = compoundShape->getNumChildShapes(); i < n; ++i)
+			{
+				childTester.Process(i,rayMask);
+			}
+		}
+		return;
+	}
+
+	for (int i=0;i<BT_RAY_PACKET_SIZE;i++)
+	{
+		if (rayMask & (1<<i))
+		{
+			btTransform rayFromTrans,rayToTrans;
+			rayFromTrans.setIdentity();
+			rayFromTrans.setOrigin(batchPacket.m_rayFromWorld[i]);
+			rayToTrans.setIdentity();
+			rayToTrans.setOrigin(batchPacket.m_rayToWorld[i]);
+			btRayBatchSingleCallback resultCallback(batchPacket,i,childIndex);
+			btCollisionWorld::rayTestSingle(rayFromTrans,rayToTrans,collisionObject,collisionShape,colObjWorldTransform,resultCallback);
+		}
+	}
+}
+
+struct btRayBatchBroadphaseCallback : public btBroadphaseRayPacketCallback
+{
+	btRayBatchPacket&	m_batchPacket;
+	short int			m_collisionFilterGroup;
+	short int			m_collisionFilterMask;
+
+	btRayBatchBroadphaseCallback(btRayBatchPacket& batchPacket,short int collisionFilterGroup,short int collisionFilterMask)
+		:m_batchPacket(batchPacket),
+		m_collisionFilterGroup(collisionFilterGroup),
+		m_collisionFilterMask(collisionFilterMask)
+	{
+	}
+
+	virtual bool	process(const btBroadphaseProxy* proxy,int rayMask)
+	{
+		btCollisionObject*	collisionObject = (btCollisionObject*)proxy->m_clientObject;
+		const btBroadphaseProxy* handle = collisionObject->getBroadphaseHandle();
+		if (!(handle->m_collisionFilterGroup & m_collisionFilterMask) || !(m_collisionFilterGroup & handle->m_collisionFilterMask))
+			return true;
+		///skip the rays that already hit something closer than the broadphase bounds
+		rayMask &= m_batchPacket.m_packet.getActiveMask();
+		if (rayMask)
+		{
+			rayTestBatchObject(m_batchPacket,rayMask,collisionObject,collisionObject->getCollisionShape(),collisionObject->getWorldTransform(),-1);
+		}
+		return true;
+	}
+};
+
+struct btRayBatchSortKey
+{
+	unsigned int	m_key;
+	int				m_ray;
+};
+
+struct btRayBatchSortPredicate
+{
+	bool operator() ( const btRayBatchSortKey& lhs, const btRayBatchSortKey& rhs ) const
+	{
+		if (lhs.m_key != rhs.m_key)
+			return lhs.m_key < rhs.m_key;
+		return lhs.m_ray < rhs.m_ray;
+	}
+};
+
+///spreads the 10 low bits of x to every third bit
+static unsigned int	btRayBatchExpandBits(unsigned int x)
+{
+	x = (x | (x << 16)) & 0x030000ff;
+	x = (x | (x << 8)) & 0x0300f00f;
+	x = (x | (x << 4)) & 0x030c30c3;
+	x = (x | (x << 2)) & 0x09249249;
+	return x;
+}
+
+struct btRayBatchLoop : public btIParallelForBody
+{
+	const btVector3*	m_rayFromWorld;
+	const btVector3*	m_rayToWorld;
+	int					m_numRays;
+	const btRayBatchSortKey*	m_sortedRays;
+	btCollisionWorld::RayBatchHit*	m_hits;
+	btBroadphaseInterface*	m_broadphase;
+	short int			m_collisionFilterGroup;
+	short int			m_collisionFilterMask;
+
+	void forLoop(int iBegin, int iEnd) const
+	{
+		btRayBatchPacket batchPacket;
+		btRayBatchBroadphaseCallback broadphaseCallback(batchPacket,m_collisionFilterGroup,m_collisionFilterMask);
+		for (int p=iBegin;p<iEnd;p++)
+		{
+			const int firstRay = p*BT_RAY_PACKET_SIZE;
+			const int numRays = btMin(m_numRays-firstRay,BT_RAY_PACKET_SIZE);
+			for (int i=0;i<BT_RAY_PACKET_SIZE;i++)
+			{
+				const int ray = m_sortedRays[firstRay+(i<numRays ? i : 0)].m_ray;
+				batchPacket.m_rayFromWorld[i] = m_rayFromWorld[ray];
+				batchPacket.m_rayToWorld[i] = m_rayToWorld[ray];
+				batchPacket.m_hits[i] = &m_hits[ray];
+			}
+			for (int i=0;i<numRays;i++)
+			{
+				btCollisionWorld::RayBatchHit& hit = *batchPacket.m_hits[i];
+				hit.m_hitFraction = btScalar(1.);
+				hit.m_collisionObject = 0;
+				hit.m_shapePart = -1;
+				hit.m_triangleIndex = -1;
+			}
+			batchPacket.m_packet.init(batchPacket.m_rayFromWorld,batchPacket.m_rayToWorld,numRays);
+			m_broadphase->rayTestPacket(batchPacket.m_packet,broadphaseCallback);
+		}
+	}
+};
+
+void	btCollisionWorld::rayTestBatch(const btVector3* rayFromWorld, const btVector3* rayToWorld, int numRays, RayBatchHit* hits,
+									   short int collisionFilterGroup, short int collisionFilterMask, btITaskScheduler* scheduler) const
+{
+	BT_PROFILE("rayTestBatch");
+	if (numRays<=0)
+		return;
+
+	///sort the rays by direction octant, then along a Morton curve through their origins, so the rays of a packet are close
+	btAlignedObjectArray<btRayBatchSortKey> sortedRays;
+	sortedRays.resize(numRays);
+	btVector3 originMin = rayFromWorld[0];
+	btVector3 originMax = rayFromWorld[0];
+	int i;
+	for (i=1;i<numRays;i++)
+	{
+		originMin.setMin(rayFromWorld[i]);
+		originMax.setMax(rayFromWorld[i]);
+	}
+	btVector3 extent = originMax-originMin;
+	btVector3 scale(0,0,0);
+	for (int j=0;j<3;j++)
+	{
+		if (extent[j] > btScalar(0.))
+			scale[j] = btScalar(1023.)/extent[j];
+	}
+	for (i=0;i<numRays;i++)
+	{
+		const btVector3 cell = (rayFromWorld[i]-originMin)*scale;
+		const btVector3 direction = rayToWorld[i]-rayFromWorld[i];
+		const unsigned int octant = (direction.getX() < btScalar(0.) ? 1 : 0) | (direction.getY() < btScalar(0.) ? 2 : 0) | (direction.getZ() < btScalar(0.) ? 4 : 0);
+		sortedRays[i].m_key = (octant << 30) |
+			(btRayBatchExpandBits((unsigned int)cell.getX()) << 2) |
+			(btRayBatchExpandBits((unsigned int)cell.getY()) << 1) |
+			btRayBatchExpandBits((unsigned int)cell.getZ());
+		sortedRays[i].m_ray = i;
+	}
+	sortedRays.quickSort(btRayBatchSortPredicate());
+
+	m_broadphasePairCache->prepareRayTestPackets();
+
+	btRayBatchLoop loop;
+	loop.m_rayFromWorld = rayFromWorld;
+	loop.m_rayToWorld = rayToWorld;
+	loop.m_numRays = numRays;
+	loop.m_sortedRays = &sortedRays[0];
+	loop.m_hits = hits;
+	loop.m_broadphase = m_broadphasePairCache;
+	loop.m_collisionFilterGroup = collisionFilterGroup;
+	loop.m_collisionFilterMask = collisionFilterMask;
+	const int numPackets = (numRays+BT_RAY_PACKET_SIZE-1)/BT_RAY_PACKET_SIZE;
+	if (scheduler)
+	{
+		scheduler->parallelFor(0,numPackets,BT_RAY_BATCH_GRAIN_SIZE,loop);
+	} else
+	{
+		loop.forLoop(0,numPackets);
+	}
+}
+
+
 struct btSingleSweepCallback : public btBroadphaseRayCallback
 {
 
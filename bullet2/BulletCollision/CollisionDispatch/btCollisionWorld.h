@@ -70,6 +70,7 @@ class btCollisionShape;
 class btConvexShape;
 class btBroadphaseInterface;
 class btSerializer;
+class btITaskScheduler;
 
 #include "LinearMath/btVector3.h"
 #include "LinearMath/btTransform.h"
@@ -303,6 +304,25 @@ public:
 		}
 	};
 
+	///RayBatchHit is the closest hit of a ray of rayTestBatch, the same as a ClosestRayResultCallback would report
+	struct	RayBatchHit
+	{
+		btVector3	m_hitPointWorld;
+		btVector3	m_hitNormalWorld;
+		///1 when the ray hit nothing
+		btScalar	m_hitFraction;
+		///0 when the ray hit nothing
+		btCollisionObject*	m_collisionObject;
+		///triangle mesh part and triangle, or -1 and the child index for compound shapes, -1 otherwise
+		int			m_shapePart;
+		int			m_triangleIndex;
+
+		bool	hasHit() const
+		{
+			return (m_collisionObject != 0);
+		}
+	};
+
 
 	struct LocalConvexResult
 	{
@@ -435,6 +455,13 @@ public:
 	/// This allows for several queries: first hit, all hits, any hit, dependent on the value returned by the callback.
 	virtual void rayTest(const btVector3& rayFromWorld, const btVector3& rayToWorld, RayResultCallback& resultCallback) const; 
 
+	/// rayTestBatch finds the closest hit of each of numRays rays and writes it to hits[i], as rayTest with a ClosestRayResultCallback would.
+	/// The rays are sorted for coherence and traced in packets of BT_RAY_PACKET_SIZE through the broadphase and btBvhTriangleMeshShape trees.
+	/// With a scheduler the packets are traced on its threads; the world must not be modified meanwhile.
+	void	rayTestBatch(const btVector3* rayFromWorld, const btVector3* rayToWorld, int numRays, RayBatchHit* hits,
+					short int collisionFilterGroup=btBroadphaseProxy::DefaultFilter, short int collisionFilterMask=btBroadphaseProxy::AllFilter,
+					btITaskScheduler* scheduler=0) const;
+
 	/// convexTest performs a swept convex cast on all objects in the btCollisionWorld, and calls the resultCallback
 	/// This allows for several queries: first hit, all hits, any hit, dependent on the value return by the callback.
 	void    convexSweepTest (const btConvexShape* castShape, const btTransform& from, const btTransform& to, ConvexResultCallback& resultCallback,  btScalar allowedCcdPenetration = btScalar(0.)) const;
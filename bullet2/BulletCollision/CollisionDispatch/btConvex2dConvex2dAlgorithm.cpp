@@ -122,7 +122,11 @@ void btConvex2dConvex2dAlgorithm ::processCollision (btCollisionObject* body0,bt
 
 		btGjkPairDetector::ClosestPointInput input;
 
-		btGjkPairDetector	gjkPairDetector(min0,min1,m_simplexSolver,m_pdSolver);
+		///m_simplexSolver is shared by all pairs of the collision configuration, run the query on a private
+		///solver with the same settings so pairs can be processed on several threads
+		btVoronoiSimplexSolver simplexSolver;
+		simplexSolver.setEqualVertexThreshold(m_simplexSolver->getEqualVertexThreshold());
+		btGjkPairDetector	gjkPairDetector(min0,min1,&simplexSolver,m_pdSolver);
 		//TODO: if (dispatchInfo.m_useContinuous)
 		gjkPairDetector.setMinkowskiA(min0);
 		gjkPairDetector.setMinkowskiB(min1);
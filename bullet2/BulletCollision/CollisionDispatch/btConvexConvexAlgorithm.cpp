@@ -203,7 +203,8 @@ m_sepDistance((static_cast<btConvexShape*>(body0->getCollisionShape()))->getAngu
 			  (static_cast<btConvexShape*>(body1->getCollisionShape()))->getAngularMotionDisc()),
 #endif
 m_numPerturbationIterations(numPerturbationIterations),
-m_minimumPointsPerturbationThreshold(minimumPointsPerturbationThreshold)
+m_minimumPointsPerturbationThreshold(minimumPointsPerturbationThreshold),
+m_separationLowerBound(-BT_LARGE_FLOAT)
 {
 	(void)body0;
 	(void)body1;
@@ -226,6 +227,42 @@ void	btConvexConvexAlgorithm ::setLowLevelOfDetail(bool useLowLevel)
 	m_lowLevelOfDetail = useLowLevel;
 }
 
+bool	btConvexConvexAlgorithm::getSeparationBatchPair(btCollisionObject* body0,btCollisionObject* body1,btGjkEpaSolver2::sBatchPair& pair) const
+{
+#ifdef USE_SEPDISTANCE_UTIL2
+	(void)body0;
+	(void)body1;
+	(void)pair;
+	return false;
+#else
+	if (!m_manifoldPtr || m_numPerturbationIterations)
+		return false;
+	//pairs that touched in the previous step mostly still touch, the bound would be wasted on them
+	if (m_manifoldPtr->getNumContacts())
+		return false;
+
+	const btConvexShape* min0 = static_cast<const btConvexShape*>(body0->getCollisionShape());
+	const btConvexShape* min1 = static_cast<const btConvexShape*>(body1->getCollisionShape());
+	if (!btGjkEpaSolver2::IsBatchShape(min0) || !btGjkEpaSolver2::IsBatchShape(min1))
+		return false;
+
+	//capsule pairs have their own closest points, polyhedra with features are clipped
+	if (min0->getShapeType() == CAPSULE_SHAPE_PROXYTYPE && min1->getShapeType() == CAPSULE_SHAPE_PROXYTYPE)
+		return false;
+	if (min0->isPolyhedral() && min1->isPolyhedral() &&
+		static_cast<const btPolyhedralConvexShape*>(min0)->getConvexPolyhedron() &&
+		static_cast<const btPolyhedralConvexShape*>(min1)->getConvexPolyhedron())
+		return false;
+
+	pair.shapes[0] = min0;
+	pair.shapes[1] = min1;
+	pair.wtrs[0] = &body0->getWorldTransform();
+	pair.wtrs[1] = &body1->getWorldTransform();
+	pair.threshold = m_manifoldPtr->getContactBreakingThreshold();
+	return true;
+#endif //USE_SEPDISTANCE_UTIL2
+}
+
 
 struct btPerturbedContactResult : public btManifoldResult
 {
@@ -303,6 +340,17 @@ void btConvexConvexAlgorithm ::processCollision (btCollisionObject* body0,btColl
 	//comment-out next line to test multi-contact generation
 	//resultOut->getPersistentManifold()->clearManifold();
 	
+	btScalar separationLowerBound = m_separationLowerBound;
+	m_separationLowerBound = -BT_LARGE_FLOAT;
+	if (separationLowerBound > m_manifoldPtr->getContactBreakingThreshold())
+	{
+		//the shapes are further apart than the pair detector reports points, see getSeparationBatchPair
+		if (m_ownManifold)
+		{
+			resultOut->refreshContactPoints();
+		}
+		return;
+	}
 
 	btConvexShape* min0 = static_cast<btConvexShape*>(body0->getCollisionShape());
 	btConvexShape* min1 = static_cast<btConvexShape*>(body1->getCollisionShape());
@@ -350,7 +398,11 @@ void btConvexConvexAlgorithm ::processCollision (btCollisionObject* body0,btColl
 	
 	btGjkPairDetector::ClosestPointInput input;
 
-	btGjkPairDetector	gjkPairDetector(min0,min1,m_simplexSolver,m_pdSolver);
+	///m_simplexSolver is shared by all pairs of the collision configuration, run the query on a private
+	///solver with the same settings so pairs can be processed on several threads
+	btVoronoiSimplexSolver simplexSolver;
+	simplexSolver.setEqualVertexThreshold(m_simplexSolver->getEqualVertexThreshold());
+	btGjkPairDetector	gjkPairDetector(min0,min1,&simplexSolver,m_pdSolver);
 	//TODO: if (dispatchInfo.m_useContinuous)
 	gjkPairDetector.setMinkowskiA(min0);
 	gjkPairDetector.setMinkowskiB(min1);
@@ -21,6 +21,7 @@ subject to the following restrictions:
 #include "BulletCollision/NarrowPhaseCollision/btPersistentManifold.h"
 #include "BulletCollision/BroadphaseCollision/btBroadphaseProxy.h"
 #include "BulletCollision/NarrowPhaseCollision/btVoronoiSimplexSolver.h"
+#include "BulletCollision/NarrowPhaseCollision/btGjkEpa2.h"
 #include "btCollisionCreateFunc.h"
 #include "btCollisionDispatcher.h"
 #include "LinearMath/btTransformUtil.h" //for btConvexSeparatingDistanceUtil
@@ -57,6 +58,9 @@ class btConvexConvexAlgorithm : public btActivatingCollisionAlgorithm
 	int m_numPerturbationIterations;
 	int m_minimumPointsPerturbationThreshold;
 
+	///lower bound of the distance between the shapes set by the dispatcher, used by the next processCollision only
+	btScalar	m_separationLowerBound;
+
 
 	///cache separating vector to speedup collision detection
 	
@@ -82,6 +86,22 @@ public:
 
 	void	setLowLevelOfDetail(bool useLowLevel);
 
+	virtual	btConvexConvexAlgorithm*	getConvexConvexAlgorithm()
+	{
+		return this;
+	}
+
+	///fills the pair of a batched separation bound, see btGjkEpaSolver2::SeparationLowerBounds. Returns false for pairs whose
+	///contacts do not only come from the pair detector (capsule pairs, polyhedral clipping, perturbation), unsupported shapes,
+	///and pairs that still have contact points, which are most likely touching
+	bool	getSeparationBatchPair(btCollisionObject* body0,btCollisionObject* body1,btGjkEpaSolver2::sBatchPair& pair) const;
+
+	///when the bound exceeds the contact breaking threshold, the next processCollision only refreshes the manifold
+	void	setSeparationLowerBound(btScalar lowerBound)
+	{
+		m_separationLowerBound = lowerBound;
+	}
+
 
 	const btPersistentManifold*	getManifold()
 	{
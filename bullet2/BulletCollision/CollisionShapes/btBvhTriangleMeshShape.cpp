@@ -25,6 +25,9 @@ btBvhTriangleMeshShape::btBvhTriangleMeshShape(btStridingMeshInterface* meshInte
 :btTriangleMeshShape(meshInterface),
 m_bvh(0),
 m_triangleInfoMap(0),
+m_bvhBuildMode(btQuantizedBvh::BUILD_MEDIAN_SPLIT),
+m_bvhTaskScheduler(0),
+m_useWideBvhNodes(false),
 m_useQuantizedAabbCompression(useQuantizedAabbCompression),
 m_ownsBvh(false)
 {
@@ -45,6 +48,9 @@ btBvhTriangleMeshShape::btBvhTriangleMeshShape(btStridingMeshInterface* meshInte
 :btTriangleMeshShape(meshInterface),
 m_bvh(0),
 m_triangleInfoMap(0),
+m_bvhBuildMode(btQuantizedBvh::BUILD_MEDIAN_SPLIT),
+m_bvhTaskScheduler(0),
+m_useWideBvhNodes(false),
 m_useQuantizedAabbCompression(useQuantizedAabbCompression),
 m_ownsBvh(false)
 {
@@ -347,6 +353,8 @@ void   btBvhTriangleMeshShape::buildOptimizedBvh()
 	///m_localAabbMin/m_localAabbMax is already re-calculated in btTriangleMeshShape. We could just scale aabb, but this needs some more work
 	void* mem = btAlignedAlloc(sizeof(btOptimizedBvh),16);
 	m_bvh = new(mem) btOptimizedBvh();
+	m_bvh->setBuildMode(m_bvhBuildMode,m_bvhTaskScheduler);
+	m_bvh->setUseWideNodes(m_useWideBvhNodes);
 	//rebuild the bvh...
 	m_bvh->build(m_meshInterface,m_useQuantizedAabbCompression,m_localAabbMin,m_localAabbMax);
 	m_ownsBvh = true;
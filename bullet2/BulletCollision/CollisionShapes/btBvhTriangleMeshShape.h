@@ -31,6 +31,10 @@ ATTRIBUTE_ALIGNED16(class) btBvhTriangleMeshShape : public btTriangleMeshShape
 	btOptimizedBvh*	m_bvh;
 	btTriangleInfoMap*	m_triangleInfoMap;
 
+	btQuantizedBvh::btBuildMode	m_bvhBuildMode;
+	btITaskScheduler*	m_bvhTaskScheduler;
+	bool m_useWideBvhNodes;
+
 	bool m_useQuantizedAabbCompression;
 	bool m_ownsBvh;
 	bool m_pad[11];////need padding due to alignment
@@ -79,6 +83,17 @@ public:
 
 	void    buildOptimizedBvh();
 
+	///setBvhBuildSettings selects the split strategy of the bvh, an optional task scheduler to build it on several threads,
+	///and whether processAllTriangles, performRaycast and performConvexcast traverse its 4-wide node layout.
+	///The settings apply to the next buildOptimizedBvh (also called by setLocalScaling): construct the shape with buildBvh
+	///set to false, then set them and call buildOptimizedBvh.
+	void	setBvhBuildSettings(btQuantizedBvh::btBuildMode buildMode, bool useWideNodes, btITaskScheduler* taskScheduler=0)
+	{
+		m_bvhBuildMode = buildMode;
+		m_useWideBvhNodes = useWideNodes;
+		m_bvhTaskScheduler = taskScheduler;
+	}
+
 	bool	usesQuantizedAabbCompression() const
 	{
 		return	m_useQuantizedAabbCompression;
@@ -34,6 +34,7 @@ btConvexHullShape ::btConvexHullShape (const btScalar* points,int numPoints,int
 	}
 
 	recalcLocalAabb();
+	updateSoaPoints();
 
 }
 
@@ -43,15 +44,43 @@ void btConvexHullShape::setLocalScaling(const btVector3& scaling)
 {
 	m_localScaling = scaling;
 	recalcLocalAabb();
+	updateSoaPoints();
 }
 
 void btConvexHullShape::addPoint(const btVector3& point)
 {
 	m_unscaledPoints.push_back(point);
 	recalcLocalAabb();
+	updateSoaPoints();
 
 }
 
+void btConvexHullShape::setUnscaledPointsInPlace(btVector3* points,int numPoints)
+{
+	btAssert(!(size_t(points)&15));
+	m_unscaledPoints.initializeFromBuffer(points,numPoints,numPoints);
+	recalcLocalAabb();
+	updateSoaPoints();
+}
+
+void btConvexHullShape::updateSoaPoints()
+{
+	const int numPoints = m_unscaledPoints.size();
+	const int numBlocks = (numPoints+3)/4;
+	m_soaPoints.resize(numBlocks*12);
+	for (int block=0;block<numBlocks;block++)
+	{
+		btScalar* soa = &m_soaPoints[block*12];
+		for (int lane=0;lane<4;lane++)
+		{
+			const btVector3 vtx = getScaledPoint(btMin(block*4+lane,numPoints-1));
+			soa[lane] = vtx.getX();
+			soa[4+lane] = vtx.getY();
+			soa[8+lane] = vtx.getZ();
+		}
+	}
+}
+
 btVector3	btConvexHullShape::localGetSupportingVertexWithoutMargin(const btVector3& vec)const
 {
 	btVector3 supVec(btScalar(0.),btScalar(0.),btScalar(0.));
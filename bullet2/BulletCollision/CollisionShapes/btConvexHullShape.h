@@ -27,6 +27,9 @@ ATTRIBUTE_ALIGNED16(class) btConvexHullShape : public btPolyhedralConvexAabbCach
 {
 	btAlignedObjectArray<btVector3>	m_unscaledPoints;
 
+	///the scaled points in blocks of four x, four y and four z coordinates, the last block padded with the last point
+	btAlignedObjectArray<btScalar>	m_soaPoints;
+
 public:
 	BT_DECLARE_ALIGNED_ALLOCATOR();
 
@@ -38,6 +41,10 @@ public:
 
 	void addPoint(const btVector3& point);
 
+	///uses the points in place instead of copying them, for example from a memory mapped .bullet file.
+	///The points must be 16 byte aligned and stay valid while the shape is used. addPoint copies them first.
+	void setUnscaledPointsInPlace(btVector3* points,int numPoints);
+
 	
 	btVector3* getUnscaledPoints()
 	{
@@ -68,6 +75,21 @@ public:
 		return m_unscaledPoints.size();
 	}
 
+	///rebuilds the structure of arrays copy of the scaled points, used by the batched support mapping of btGjkEpaSolver2.
+	///addPoint, setUnscaledPointsInPlace and setLocalScaling call it, call it after changing the points of getUnscaledPoints.
+	void	updateSoaPoints();
+
+	///the scaled points as blocks of four x, four y and four z coordinates, getNumSoaBlocks()*12 scalars
+	const btScalar*	getSoaPoints() const
+	{
+		return m_soaPoints.size() ? &m_soaPoints[0] : 0;
+	}
+
+	int		getNumSoaBlocks() const
+	{
+		return m_soaPoints.size()/12;
+	}
+
 	virtual btVector3	localGetSupportingVertex(const btVector3& vec)const;
 	virtual btVector3	localGetSupportingVertexWithoutMargin(const btVector3& vec)const;
 	virtual void	batchedUnitVectorGetSupportingVertexWithoutMargin(const btVector3* vectors,btVector3* supportVerticesOut,int numVectors) const;
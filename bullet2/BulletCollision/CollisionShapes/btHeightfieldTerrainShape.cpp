@@ -16,6 +16,7 @@ subject to the following restrictions:
 #include "btHeightfieldTerrainShape.h"
 
 #include "LinearMath/btTransformUtil.h"
+#include "BulletCollision/NarrowPhaseCollision/btRaycastCallback.h"
 
 
 
@@ -84,6 +85,8 @@ PHY_ScalarType hdt, bool flipQuadEdges
 	m_useDiamondSubdivision = false;
 	m_upAxis = upAxis;
 	m_localScaling.setValue(btScalar(1.), btScalar(1.), btScalar(1.));
+	m_minMaxLeafLevel = 0;
+	m_minMaxTopLevel = 0;
 
 	// determine min/max axis-aligned bounding box (aabb) values
 	switch (m_upAxis)
@@ -188,14 +191,19 @@ btHeightfieldTerrainShape::getRawHeightFieldValue(int x,int y) const
 
 /// this returns the vertex in bullet-local coordinates
 void	btHeightfieldTerrainShape::getVertex(int x,int y,btVector3& vertex) const
+{
+	getVertex(x,y,getRawHeightFieldValue(x,y),vertex);
+}
+
+
+
+void	btHeightfieldTerrainShape::getVertex(int x,int y,btScalar height,btVector3& vertex) const
 {
 	btAssert(x>=0);
 	btAssert(y>=0);
 	btAssert(x<m_heightStickWidth);
 	btAssert(y<m_heightStickLength);
 
-	btScalar	height = getRawHeightFieldValue(x,y);
-
 	switch (m_upAxis)
 	{
 	case 0:
@@ -357,41 +365,383 @@ void	btHeightfieldTerrainShape::processAllTriangles(btTriangleCallback* callback
 	
   
 
+	// with the min/max pyramid, skip the blocks and cells whose heights are all outside the query
+	const bool cull = hasMinMaxPyramid();
+	const btScalar minQueryHeight = btMin(localAabbMin[m_upAxis],localAabbMax[m_upAxis]);
+	const btScalar maxQueryHeight = btMax(localAabbMin[m_upAxis],localAabbMax[m_upAxis]);
+	// the blocks of each level last found to overlap the query
+	int overlapX[32];
+	int overlapJ[32];
+	for (int level = 0; level < 32; ++level) {
+		overlapX[level] = -1;
+		overlapJ[level] = -1;
+	}
+
 	for(int j=startJ; j<endJ; j++)
 	{
-		for(int x=startX; x<endX; x++)
+		btScalar h00 = 0, h01 = 0;
+		bool haveLeftHeights = false;
+		int x = startX;
+		while (x<endX)
 		{
-			btVector3 vertices[3];
-			if (m_flipQuadEdges || (m_useDiamondSubdivision && !((j+x) & 1)))
+			if (cull)
 			{
-        //first triangle
-        getVertex(x,j,vertices[0]);
-        getVertex(x+1,j,vertices[1]);
-        getVertex(x+1,j+1,vertices[2]);
-        callback->processTriangle(vertices,x,j);
-        //second triangle
-        getVertex(x,j,vertices[0]);
-        getVertex(x+1,j+1,vertices[1]);
-        getVertex(x,j+1,vertices[2]);
-        callback->processTriangle(vertices,x,j);				
-			} else
+				// the largest block around the cell that is outside the query, cells of the same row up to its end are skipped
+				int skipX = x;
+				for (int level = m_minMaxTopLevel; level >= m_minMaxLeafLevel; --level)
+				{
+					const int nx = x>>level;
+					const int nj = j>>level;
+					if (overlapX[level] == nx && overlapJ[level] == nj)
+						continue;
+					const MinMaxNode& node = m_minMaxNodes[m_minMaxLevelOffsets[level-m_minMaxLeafLevel] + nj*getNumMinMaxNodesX(level) + nx];
+					if (node.m_max < minQueryHeight || node.m_min > maxQueryHeight)
+					{
+						skipX = (nx+1)<<level;
+						break;
+					}
+					overlapX[level] = nx;
+					overlapJ[level] = nj;
+				}
+				if (skipX > x)
+				{
+					x = skipX;
+					haveLeftHeights = false;
+					continue;
+				}
+			}
+
+			// decode each height once, the right heights of a cell are the left heights of the next one
+			if (!haveLeftHeights)
 			{
-        //first triangle
-        getVertex(x,j,vertices[0]);
-        getVertex(x,j+1,vertices[1]);
-        getVertex(x+1,j,vertices[2]);
-        callback->processTriangle(vertices,x,j);
-        //second triangle
-        getVertex(x+1,j,vertices[0]);
-        getVertex(x,j+1,vertices[1]);
-        getVertex(x+1,j+1,vertices[2]);
-        callback->processTriangle(vertices,x,j);
+				h00 = getRawHeightFieldValue(x,j);
+				h01 = getRawHeightFieldValue(x,j+1);
 			}
+			const btScalar h10 = getRawHeightFieldValue(x+1,j);
+			const btScalar h11 = getRawHeightFieldValue(x+1,j+1);
+
+			if (!cull ||
+				(btMax(btMax(h00,h01),btMax(h10,h11)) >= minQueryHeight &&
+				 btMin(btMin(h00,h01),btMin(h10,h11)) <= maxQueryHeight))
+			{
+				btVector3 v00,v10,v01,v11;
+				getVertex(x,j,h00,v00);
+				getVertex(x+1,j,h10,v10);
+				getVertex(x,j+1,h01,v01);
+				getVertex(x+1,j+1,h11,v11);
+				processQuad(callback,x,j,v00,v10,v01,v11);
+			}
+
+			h00 = h10;
+			h01 = h11;
+			haveLeftHeights = true;
+			x++;
 		}
 	}
+}
+
+
+
+void	btHeightfieldTerrainShape::processQuad(btTriangleCallback* callback,int x,int j,const btVector3& v00,const btVector3& v10,const btVector3& v01,const btVector3& v11) const
+{
+	// the callback may modify the vertices, each triangle gets its own copy
+	btVector3 vertices[3];
+	if (m_flipQuadEdges || (m_useDiamondSubdivision && !((j+x) & 1)))
+	{
+		//first triangle
+		vertices[0] = v00;
+		vertices[1] = v10;
+		vertices[2] = v11;
+		callback->processTriangle(vertices,x,j);
+		//second triangle
+		vertices[0] = v00;
+		vertices[1] = v11;
+		vertices[2] = v01;
+		callback->processTriangle(vertices,x,j);
+	} else
+	{
+		//first triangle
+		vertices[0] = v00;
+		vertices[1] = v01;
+		vertices[2] = v10;
+		callback->processTriangle(vertices,x,j);
+		//second triangle
+		vertices[0] = v10;
+		vertices[1] = v01;
+		vertices[2] = v11;
+		callback->processTriangle(vertices,x,j);
+	}
+}
+
+
+
+void	btHeightfieldTerrainShape::getHeightRange(int startX,int startY,int endX,int endY,btScalar& minHeight,btScalar& maxHeight) const
+{
+	minHeight = BT_LARGE_FLOAT;
+	maxHeight = -BT_LARGE_FLOAT;
+	for (int y = startY; y <= endY; ++y)
+	{
+		for (int x = startX; x <= endX; ++x)
+		{
+			const btScalar height = getRawHeightFieldValue(x,y);
+			minHeight = btMin(minHeight,height);
+			maxHeight = btMax(maxHeight,height);
+		}
+	}
+}
+
+
+
+void	btHeightfieldTerrainShape::getMinMaxNodeRange(int level,int nx,int ny,btScalar& minHeight,btScalar& maxHeight) const
+{
+	if (level >= m_minMaxLeafLevel)
+	{
+		const MinMaxNode& node = m_minMaxNodes[m_minMaxLevelOffsets[level-m_minMaxLeafLevel] + ny*getNumMinMaxNodesX(level) + nx];
+		minHeight = node.m_min;
+		maxHeight = node.m_max;
+	} else
+	{
+		getHeightRange(nx<<level,ny<<level,
+			btMin((nx+1)<<level,m_heightStickWidth-1),btMin((ny+1)<<level,m_heightStickLength-1),
+			minHeight,maxHeight);
+	}
+}
+
+
+
+void	btHeightfieldTerrainShape::buildMinMaxPyramid(int leafLevel)
+{
+	btAssert(leafLevel >= 0 && leafLevel < 30);
+	clearMinMaxPyramid();
+	m_minMaxLeafLevel = leafLevel;
+
+	int level = leafLevel;
+	int numNodes = 0;
+	for (;;)
+	{
+		m_minMaxLevelOffsets.push_back(numNodes);
+		numNodes += getNumMinMaxNodesX(level)*getNumMinMaxNodesY(level);
+		if (getNumMinMaxNodesX(level) == 1 && getNumMinMaxNodesY(level) == 1)
+			break;
+		level++;
+	}
+	m_minMaxTopLevel = level;
+	m_minMaxNodes.resize(numNodes);
+
+	updateMinMaxNodes(0,0,getNumMinMaxNodesX(leafLevel)-1,getNumMinMaxNodesY(leafLevel)-1);
+}
 
-	
 
+
+void	btHeightfieldTerrainShape::updateMinMaxPyramid(int startX,int startY,int endX,int endY)
+{
+	if (!hasMinMaxPyramid())
+		return;
+
+	// a grid point is a corner of the cells on both of its sides
+	startX = btMax(startX-1,0);
+	startY = btMax(startY-1,0);
+	endX = btMin(endX,m_heightStickWidth-2);
+	endY = btMin(endY,m_heightStickLength-2);
+	if (startX > endX || startY > endY)
+		return;
+
+	updateMinMaxNodes(startX>>m_minMaxLeafLevel,startY>>m_minMaxLeafLevel,endX>>m_minMaxLeafLevel,endY>>m_minMaxLeafLevel);
+}
+
+
+
+/// recomputes the leaf blocks startX..endX, startY..endY (inclusive) from the heights, and their parents from their children
+void	btHeightfieldTerrainShape::updateMinMaxNodes(int startX,int startY,int endX,int endY)
+{
+	int level = m_minMaxLeafLevel;
+	MinMaxNode* nodes = &m_minMaxNodes[0];
+	for (int ny = startY; ny <= endY; ++ny)
+	{
+		for (int nx = startX; nx <= endX; ++nx)
+		{
+			MinMaxNode& node = nodes[ny*getNumMinMaxNodesX(level) + nx];
+			getHeightRange(nx<<level,ny<<level,
+				btMin((nx+1)<<level,m_heightStickWidth-1),btMin((ny+1)<<level,m_heightStickLength-1),
+				node.m_min,node.m_max);
+		}
+	}
+
+	for (level = m_minMaxLeafLevel+1; level <= m_minMaxTopLevel; ++level)
+	{
+		const MinMaxNode* children = &m_minMaxNodes[m_minMaxLevelOffsets[level-1-m_minMaxLeafLevel]];
+		const int numChildrenX = getNumMinMaxNodesX(level-1);
+		const int numChildrenY = getNumMinMaxNodesY(level-1);
+		nodes = &m_minMaxNodes[m_minMaxLevelOffsets[level-m_minMaxLeafLevel]];
+		startX >>= 1;
+		startY >>= 1;
+		endX >>= 1;
+		endY >>= 1;
+		for (int ny = startY; ny <= endY; ++ny)
+		{
+			for (int nx = startX; nx <= endX; ++nx)
+			{
+				MinMaxNode& node = nodes[ny*getNumMinMaxNodesX(level) + nx];
+				node.m_min = BT_LARGE_FLOAT;
+				node.m_max = -BT_LARGE_FLOAT;
+				for (int cy = 2*ny; cy < btMin(2*ny+2,numChildrenY); ++cy)
+				{
+					for (int cx = 2*nx; cx < btMin(2*nx+2,numChildrenX); ++cx)
+					{
+						const MinMaxNode& child = children[cy*numChildrenX + cx];
+						node.m_min = btMin(node.m_min,child.m_min);
+						node.m_max = btMax(node.m_max,child.m_max);
+					}
+				}
+			}
+		}
+	}
+}
+
+
+
+void	btHeightfieldTerrainShape::clearMinMaxPyramid()
+{
+	m_minMaxNodes.clear();
+	m_minMaxLevelOffsets.clear();
+	m_minMaxLeafLevel = 0;
+	m_minMaxTopLevel = 0;
+}
+
+
+
+/// clips the segment from + t*delta, t in [tEnter,tExit], against the box
+static inline bool clipSegment(const btVector3& from,const btVector3& delta,const btVector3& boxMin,const btVector3& boxMax,btScalar& tEnter,btScalar& tExit)
+{
+	for (int i = 0; i < 3; ++i)
+	{
+		if (delta[i] == btScalar(0.))
+		{
+			if (from[i] < boxMin[i] || from[i] > boxMax[i])
+				return false;
+		} else
+		{
+			const btScalar invDelta = btScalar(1.)/delta[i];
+			btScalar t0 = (boxMin[i]-from[i])*invDelta;
+			btScalar t1 = (boxMax[i]-from[i])*invDelta;
+			if (t0 > t1)
+				btSwap(t0,t1);
+			tEnter = btMax(tEnter,t0);
+			tExit = btMin(tExit,t1);
+			if (tEnter > tExit)
+				return false;
+		}
+	}
+	return true;
+}
+
+
+
+/// the ray is in grid coordinates: grid point indices along the width and the length, and raw height
+void	btHeightfieldTerrainShape::raycastNode(btTriangleRaycastCallback* callback,const btVector3& rayFrom,const btVector3& rayDelta,const btVector3& pad,int level,int nx,int ny,btScalar tEnter) const
+{
+	if (tEnter > callback->m_hitFraction)
+		return;
+
+	if (level == 0)
+	{
+		btVector3 v00,v10,v01,v11;
+		getVertex(nx,ny,v00);
+		getVertex(nx+1,ny,v10);
+		getVertex(nx,ny+1,v01);
+		getVertex(nx+1,ny+1,v11);
+		processQuad(callback,nx,ny,v00,v10,v01,v11);
+		return;
+	}
+
+	// children hit by the ray, sorted by entry
+	int childX[4];
+	int childY[4];
+	btScalar childEnter[4];
+	int numChildren = 0;
+	const int childLevel = level-1;
+	for (int cy = 2*ny; cy < btMin(2*ny+2,getNumMinMaxNodesY(childLevel)); ++cy)
+	{
+		for (int cx = 2*nx; cx < btMin(2*nx+2,getNumMinMaxNodesX(childLevel)); ++cx)
+		{
+			btScalar minHeight,maxHeight;
+			getMinMaxNodeRange(childLevel,cx,cy,minHeight,maxHeight);
+			const btVector3 boxMin = btVector3(btScalar(cx<<childLevel),btScalar(cy<<childLevel),minHeight) - pad;
+			const btVector3 boxMax = btVector3(btScalar(btMin((cx+1)<<childLevel,m_heightStickWidth-1)),
+				btScalar(btMin((cy+1)<<childLevel,m_heightStickLength-1)),maxHeight) + pad;
+			btScalar t0 = btScalar(0.);
+			btScalar t1 = callback->m_hitFraction;
+			if (!clipSegment(rayFrom,rayDelta,boxMin,boxMax,t0,t1))
+				continue;
+			int i = numChildren++;
+			for (; i > 0 && childEnter[i-1] > t0; --i)
+			{
+				childX[i] = childX[i-1];
+				childY[i] = childY[i-1];
+				childEnter[i] = childEnter[i-1];
+			}
+			childX[i] = cx;
+			childY[i] = cy;
+			childEnter[i] = t0;
+		}
+	}
+
+	for (int i = 0; i < numChildren; ++i)
+	{
+		raycastNode(callback,rayFrom,rayDelta,pad,childLevel,childX[i],childY[i],childEnter[i]);
+	}
+}
+
+
+
+void	btHeightfieldTerrainShape::performRaycast(btTriangleRaycastCallback* callback,const btVector3& raySource,const btVector3& rayTarget) const
+{
+	if (!hasMinMaxPyramid())
+	{
+		btVector3 rayAabbMin = raySource;
+		rayAabbMin.setMin(rayTarget);
+		btVector3 rayAabbMax = raySource;
+		rayAabbMax.setMax(rayTarget);
+		processAllTriangles(callback,rayAabbMin,rayAabbMax);
+		return;
+	}
+
+	int axisX = 0;
+	int axisY = 1;
+	switch (m_upAxis)
+	{
+	case 0:
+		axisX = 1;
+		axisY = 2;
+		break;
+	case 1:
+		axisX = 0;
+		axisY = 2;
+		break;
+	default:
+		axisX = 0;
+		axisY = 1;
+	}
+
+	// unscale and shift the ray like processAllTriangles does the aabb, then the width and length coordinates are grid point indices
+	const btVector3 localFrom = raySource/m_localScaling + m_localOrigin;
+	const btVector3 localTo = rayTarget/m_localScaling + m_localOrigin;
+	const btVector3 rayFrom(localFrom[axisX],localFrom[axisY],localFrom[m_upAxis]);
+	const btVector3 rayDelta = btVector3(localTo[axisX],localTo[axisY],localTo[m_upAxis]) - rayFrom;
+
+	// pad the blocks for the rounding of the ray conversion, the triangles are tested in local coordinates
+	const btScalar heightPad = (btFabs(m_minHeight)+btFabs(m_maxHeight)+btScalar(1.))*btScalar(1e-5);
+	const btScalar gridPad = (m_width+m_length)*btScalar(1e-6) + btScalar(1e-4);
+	const btVector3 pad(gridPad,gridPad,heightPad);
+
+	btScalar minHeight,maxHeight;
+	getMinMaxNodeRange(m_minMaxTopLevel,0,0,minHeight,maxHeight);
+	btScalar tEnter = btScalar(0.);
+	btScalar tExit = callback->m_hitFraction;
+	if (clipSegment(rayFrom,rayDelta,btVector3(0,0,minHeight)-pad,btVector3(m_width,m_length,maxHeight)+pad,tEnter,tExit))
+	{
+		raycastNode(callback,rayFrom,rayDelta,pad,m_minMaxTopLevel,0,0,tEnter);
+	}
 }
 
 void	btHeightfieldTerrainShape::calculateLocalInertia(btScalar ,btVector3& inertia) const
@@ -17,6 +17,9 @@ subject to the following restrictions:
 #define BT_HEIGHTFIELD_TERRAIN_SHAPE_H
 
 #include "btConcaveShape.h"
+#include "LinearMath/btAlignedObjectArray.h"
+
+class btTriangleRaycastCallback;
 
 ///btHeightfieldTerrainShape simulates a 2D heightfield terrain
 /**
@@ -66,6 +69,14 @@ subject to the following restrictions:
   or maximum heights.  These values are used to determine the heightfield's
   axis-aligned bounding box, multiplied by localScaling.
 
+  buildMinMaxPyramid precomputes the minimum and maximum height of blocks of
+  cells, and of blocks of blocks up to the whole grid. With this pyramid,
+  processAllTriangles skips the cells whose heights are all above or all below
+  the query aabb, and performRaycast (used by btCollisionWorld::rayTest) only
+  visits the cells of the blocks the ray passes through, nearest first.
+  The pyramid is a copy of the heights: call buildMinMaxPyramid again, or
+  updateMinMaxPyramid for the changed region, when the heightfield data changes.
+
   For usage and testing see the TerrainDemo.
  */
 class btHeightfieldTerrainShape : public btConcaveShape
@@ -99,9 +110,47 @@ protected:
 	
 	btVector3	m_localScaling;
 
+	///raw height range of a block of cells
+	struct MinMaxNode
+	{
+		btScalar	m_min;
+		btScalar	m_max;
+	};
+
+	///the blocks of (1<<level) x (1<<level) cells, from level m_minMaxLeafLevel (one array per level, row major) up to the level of the whole grid
+	btAlignedObjectArray<MinMaxNode>	m_minMaxNodes;
+	btAlignedObjectArray<int>	m_minMaxLevelOffsets;
+	int	m_minMaxLeafLevel;
+	int	m_minMaxTopLevel;
+
 	virtual btScalar	getRawHeightFieldValue(int x,int y) const;
 	void		quantizeWithClamp(int* out, const btVector3& point,int isMax) const;
 	void		getVertex(int x,int y,btVector3& vertex) const;
+	///vertex of the grid point x,y of raw height 'height', as returned by getRawHeightFieldValue
+	void		getVertex(int x,int y,btScalar height,btVector3& vertex) const;
+
+	///reports the two triangles of the cell x,y given its four corners
+	void		processQuad(btTriangleCallback* callback,int x,int y,const btVector3& v00,const btVector3& v10,const btVector3& v01,const btVector3& v11) const;
+
+	int			getNumMinMaxNodesX(int level) const
+	{
+		return ((m_heightStickWidth-2)>>level)+1;
+	}
+
+	int			getNumMinMaxNodesY(int level) const
+	{
+		return ((m_heightStickLength-2)>>level)+1;
+	}
+
+	///raw height range of the grid points startX..endX, startY..endY (inclusive)
+	void		getHeightRange(int startX,int startY,int endX,int endY,btScalar& minHeight,btScalar& maxHeight) const;
+
+	///raw height range of the block of cells nx,ny of the level, read from the pyramid above its leaf level and computed from the heights below
+	void		getMinMaxNodeRange(int level,int nx,int ny,btScalar& minHeight,btScalar& maxHeight) const;
+
+	void		updateMinMaxNodes(int startX,int startY,int endX,int endY);
+
+	void		raycastNode(btTriangleRaycastCallback* callback,const btVector3& rayFrom,const btVector3& rayDelta,const btVector3& pad,int level,int nx,int ny,btScalar tEnter) const;
 
 
 
@@ -147,6 +196,31 @@ public:
 
 	virtual void	processAllTriangles(btTriangleCallback* callback,const btVector3& aabbMin,const btVector3& aabbMax) const;
 
+	///builds the min/max height pyramid. The smallest blocks hold (1<<leafLevel) x (1<<leafLevel) cells, smaller blocks are
+	///computed from the heights on the fly. The default of 4x4 cells takes about a sixth of the memory of float heights.
+	void	buildMinMaxPyramid(int leafLevel=2);
+
+	///updates the pyramid after a change of the heights of the grid points startX..endX, startY..endY (inclusive)
+	void	updateMinMaxPyramid(int startX,int startY,int endX,int endY);
+
+	void	clearMinMaxPyramid();
+
+	bool	hasMinMaxPyramid() const
+	{
+		return m_minMaxNodes.size()>0;
+	}
+
+	///memory used by the pyramid in bytes
+	int		getMinMaxPyramidMemory() const
+	{
+		return m_minMaxNodes.size()*int(sizeof(MinMaxNode));
+	}
+
+	///reports to the callback the triangles the ray from raySource to rayTarget (in local coordinates) may hit.
+	///With the pyramid, blocks are visited nearest first and skipped when beyond the callback hit fraction,
+	///otherwise the triangles of the aabb of the ray are processed.
+	void	performRaycast(btTriangleRaycastCallback* callback,const btVector3& raySource,const btVector3& rayTarget) const;
+
 	virtual void	calculateLocalInertia(btScalar mass,btVector3& inertia) const;
 
 	virtual void	setLocalScaling(const btVector3& scaling);
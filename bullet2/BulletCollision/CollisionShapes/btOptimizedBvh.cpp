@@ -198,6 +198,10 @@ void btOptimizedBvh::build(btStridingMeshInterface* triangles, bool useQuantized
 	//PCK: clear m_quantizedLeafNodes and m_leafNodes, they are temporary
 	m_quantizedLeafNodes.clear();
 	m_leafNodes.clear();
+
+	m_wideNodes.clear();
+	if (m_useWideNodes)
+		buildWideNodes();
 }
 
 
@@ -221,6 +225,8 @@ void	btOptimizedBvh::refit(btStridingMeshInterface* meshInterface,const btVector
 			subtree.setAabbFromQuantizeNode(m_quantizedContiguousNodes[subtree.m_rootNodeIndex]);
 		}
 
+		refitWideNodes();
+
 	} else
 	{
 
@@ -266,7 +272,9 @@ void	btOptimizedBvh::refitPartial(btStridingMeshInterface* meshInterface,const b
 			subtree.setAabbFromQuantizeNode(m_quantizedContiguousNodes[subtree.m_rootNodeIndex]);
 		}
 	}
-	
+
+	///the wide nodes copy the bounds of the binary nodes, which are cheap to copy again compared to the triangles
+	refitWideNodes();
 }
 
 void	btOptimizedBvh::updateBvhNodes(btStridingMeshInterface* meshInterface,int firstNode,int endNode,int index)
@@ -193,16 +193,56 @@ float btGImpactCollisionAlgorithm::getAverageTriangleCollisionTime()
 
 
 
+struct btGImpactCollisionAlgorithm::TriangleScratch
+{
+	//! the triangles of each part in world space with their planes, each transformed once per call
+	btAlignedObjectArray<btPrimitiveTriangle> m_world_triangles[2];
+	//! index in m_world_triangles of each triangle of the parts, -1 if not transformed
+	btAlignedObjectArray<int> m_world_triangle_index[2];
+	//! the pairs which pass the conservative overlap test
+	btAlignedObjectArray<int> m_overlapping_pairs;
+	btAlignedObjectArray<int> m_hits;
+	//! the contacts of the overlapping pairs, not constructed since GIM_TRIANGLE_CONTACT copies its points on copy
+	GIM_TRIANGLE_CONTACT * m_contacts;
+	int m_contact_capacity;
+
+	TriangleScratch():m_contacts(NULL),m_contact_capacity(0)
+	{
+	}
+
+	~TriangleScratch()
+	{
+		if (m_contacts)
+			btAlignedFree(m_contacts);
+	}
+
+	void reserveContacts(int count)
+	{
+		if (count <= m_contact_capacity)
+			return;
+		if (m_contacts)
+			btAlignedFree(m_contacts);
+		m_contact_capacity = btMax(count,2*m_contact_capacity);
+		m_contacts = (GIM_TRIANGLE_CONTACT *)btAlignedAlloc(sizeof(GIM_TRIANGLE_CONTACT)*m_contact_capacity,16);
+	}
+};
+
 btGImpactCollisionAlgorithm::btGImpactCollisionAlgorithm( const btCollisionAlgorithmConstructionInfo& ci, btCollisionObject* body0,btCollisionObject* body1)
 : btActivatingCollisionAlgorithm(ci,body0,body1)
 {
 	m_manifoldPtr = NULL;
 	m_convex_algorithm = NULL;
+	m_triangle_scratch = NULL;
 }
 
 btGImpactCollisionAlgorithm::~btGImpactCollisionAlgorithm()
 {
 	clearCache();
+	if (m_triangle_scratch)
+	{
+		m_triangle_scratch->~TriangleScratch();
+		btAlignedFree(m_triangle_scratch);
+	}
 }
 
 
@@ -398,6 +438,46 @@ void btGImpactCollisionAlgorithm::collide_gjk_triangles(btCollisionObject * body
 	shape1->unlockChildShapes();
 }
 
+//! the index of the triangle in world_triangles, transformed and with its plane built on its first use
+static SIMD_FORCE_INLINE int gatherWorldTriangle(btGImpactMeshShapePart * shape, const btTransform & trans, int triangle_index,
+	btAlignedObjectArray<btPrimitiveTriangle> & world_triangles, btAlignedObjectArray<int> & world_triangle_index)
+{
+	int & index = world_triangle_index[triangle_index];
+	if (index < 0)
+	{
+		index = world_triangles.size();
+		btPrimitiveTriangle & ptri = world_triangles.expand();
+		shape->getPrimitiveTriangle(triangle_index,ptri);
+		ptri.applyTransform(trans);
+		ptri.buildTriPlane();
+	}
+	return index;
+}
+
+//! clips the overlapping triangle pairs of btGImpactCollisionAlgorithm::collide_sat_triangles
+struct btGImpactClipTrianglesLoop : public btIParallelForBody
+{
+	const btPrimitiveTriangle * m_world_triangles0;
+	const btPrimitiveTriangle * m_world_triangles1;
+	const int * m_world_triangle_index0;
+	const int * m_world_triangle_index1;
+	const int * m_pairs;
+	const int * m_overlapping_pairs;
+	GIM_TRIANGLE_CONTACT * m_contacts;
+	int * m_hits;
+
+	void forLoop(int iBegin, int iEnd) const
+	{
+		for (int i=iBegin;i<iEnd;i++)
+		{
+			const int * pair = m_pairs + 2*m_overlapping_pairs[i];
+			btPrimitiveTriangle ptri0 = m_world_triangles0[m_world_triangle_index0[pair[0]]];
+			btPrimitiveTriangle ptri1 = m_world_triangles1[m_world_triangle_index1[pair[1]]];
+			m_hits[i] = ptri0.find_triangle_collision_clip_method(ptri1,m_contacts[i]) ? 1 : 0;
+		}
+	}
+};
+
 void btGImpactCollisionAlgorithm::collide_sat_triangles(btCollisionObject * body0,
 					  btCollisionObject * body1,
 					  btGImpactMeshShapePart * shape0,
@@ -407,63 +487,125 @@ void btGImpactCollisionAlgorithm::collide_sat_triangles(btCollisionObject * body
 	btTransform orgtrans0 = body0->getWorldTransform();
 	btTransform orgtrans1 = body1->getWorldTransform();
 
-	btPrimitiveTriangle ptri0;
-	btPrimitiveTriangle ptri1;
-	GIM_TRIANGLE_CONTACT contact_data;
+	if (!m_triangle_scratch)
+	{
+		m_triangle_scratch = new (btAlignedAlloc(sizeof(TriangleScratch),16)) TriangleScratch;
+	}
+	TriangleScratch & scratch = *m_triangle_scratch;
 
 	shape0->lockChildShapes();
 	shape1->lockChildShapes();
 
-	const int * pair_pointer = pairs;
+	#ifdef TRI_COLLISION_PROFILING
+	bt_begin_gim02_tri_time();
+	#endif
 
-	while(pair_count--)
+	//transform the triangles of the pairs once, a triangle is usually in several pairs
+	btGImpactMeshShapePart * shapes[2] = {shape0,shape1};
+	const btTransform * transforms[2] = {&orgtrans0,&orgtrans1};
+	for (int k=0;k<2;k++)
 	{
+		if (scratch.m_world_triangle_index[k].size() < shapes[k]->getNumChildShapes())
+		{
+			scratch.m_world_triangle_index[k].resize(shapes[k]->getNumChildShapes(),-1);
+		}
+		for (int i=0;i<pair_count;i++)
+		{
+			gatherWorldTriangle(shapes[k],*transforms[k],pairs[2*i+k],scratch.m_world_triangles[k],scratch.m_world_triangle_index[k]);
+		}
+	}
 
-		m_triface0 = *(pair_pointer);
-		m_triface1 = *(pair_pointer+1);
-		pair_pointer+=2;
-
-
-		shape0->getPrimitiveTriangle(m_triface0,ptri0);
-		shape1->getPrimitiveTriangle(m_triface1,ptri1);
-
-		#ifdef TRI_COLLISION_PROFILING
-		bt_begin_gim02_tri_time();
-		#endif
-
-		ptri0.applyTransform(orgtrans0);
-		ptri1.applyTransform(orgtrans1);
+	//test conservative, 4 pairs at once
+	const btPrimitiveTriangle * world_triangles0 = &scratch.m_world_triangles[0][0];
+	const btPrimitiveTriangle * world_triangles1 = &scratch.m_world_triangles[1][0];
+	const int * world_triangle_index0 = &scratch.m_world_triangle_index[0][0];
+	const int * world_triangle_index1 = &scratch.m_world_triangle_index[1][0];
+	scratch.m_overlapping_pairs.resize(0);
+	for (int i=0;i<pair_count;i+=4)
+	{
+		const btPrimitiveTriangle * ptris0[4];
+		const btPrimitiveTriangle * ptris1[4];
+		const int count = btMin(4,pair_count-i);
+		for (int j=0;j<count;j++)
+		{
+			ptris0[j] = &world_triangles0[world_triangle_index0[pairs[2*(i+j)]]];
+			ptris1[j] = &world_triangles1[world_triangle_index1[pairs[2*(i+j)+1]]];
+		}
+		const int mask = btPrimitiveTriangle::overlap_test_conservative_4(ptris0,ptris1,count);
+		for (int j=0;j<count;j++)
+		{
+			if (mask & (1<<j))
+			{
+				scratch.m_overlapping_pairs.push_back(i+j);
+			}
+		}
+	}
 
+	//clip the overlapping pairs, in parallel if a shape has a task scheduler
+	const int overlap_count = scratch.m_overlapping_pairs.size();
+	if (overlap_count > 0)
+	{
+		scratch.reserveContacts(overlap_count);
+		scratch.m_hits.resize(overlap_count);
+
+		btGImpactClipTrianglesLoop loop;
+		loop.m_world_triangles0 = world_triangles0;
+		loop.m_world_triangles1 = world_triangles1;
+		loop.m_world_triangle_index0 = world_triangle_index0;
+		loop.m_world_triangle_index1 = world_triangle_index1;
+		loop.m_pairs = pairs;
+		loop.m_overlapping_pairs = &scratch.m_overlapping_pairs[0];
+		loop.m_contacts = scratch.m_contacts;
+		loop.m_hits = &scratch.m_hits[0];
+
+		btITaskScheduler * scheduler = shape0->getTaskScheduler() ? shape0->getTaskScheduler() : shape1->getTaskScheduler();
+		if (scheduler && scheduler->getNumThreads() > 1 && overlap_count >= BT_GIMPACT_PARALLEL_TASKS)
+		{
+			scheduler->parallelFor(0,overlap_count,16,loop);
+		}
+		else
+		{
+			loop.forLoop(0,overlap_count);
+		}
+	}
 
-		//build planes
-		ptri0.buildTriPlane();
-		ptri1.buildTriPlane();
-		// test conservative
+	#ifdef TRI_COLLISION_PROFILING
+	bt_end_gim02_tri_time();
+	#endif
 
+	//add the contacts in the order of the pairs
+	for (int i=0;i<overlap_count;i++)
+	{
+		if (!scratch.m_hits[i])
+			continue;
 
+		const int * pair_pointer = pairs + 2*scratch.m_overlapping_pairs[i];
+		m_triface0 = *(pair_pointer);
+		m_triface1 = *(pair_pointer+1);
 
-		if(ptri0.overlap_test_conservative(ptri1))
+		const GIM_TRIANGLE_CONTACT & contact_data = scratch.m_contacts[i];
+		int j = contact_data.m_point_count;
+		while(j--)
 		{
-			if(ptri0.find_triangle_collision_clip_method(ptri1,contact_data))
-			{
-
-				int j = contact_data.m_point_count;
-				while(j--)
-				{
 
-					addContactPoint(body0, body1,
-								contact_data.m_points[j],
-								contact_data.m_separating_normal,
-								-contact_data.m_penetration_depth);
-				}
-			}
+			addContactPoint(body0, body1,
+						contact_data.m_points[j],
+						contact_data.m_separating_normal,
+						-contact_data.m_penetration_depth);
 		}
+	}
 
-		#ifdef TRI_COLLISION_PROFILING
-		bt_end_gim02_tri_time();
-		#endif
+	m_triface0 = pairs[2*(pair_count-1)];
+	m_triface1 = pairs[2*(pair_count-1)+1];
 
+	//reset the indices of the transformed triangles for the next call
+	for (int i=0;i<pair_count;i++)
+	{
+		scratch.m_world_triangle_index[0][pairs[2*i]] = -1;
+		scratch.m_world_triangle_index[1][pairs[2*i+1]] = -1;
 	}
+	scratch.m_world_triangles[0].resize(0);
+	scratch.m_world_triangles[1].resize(0);
 
 	shape0->unlockChildShapes();
 	shape1->unlockChildShapes();
@@ -63,6 +63,10 @@ protected:
 	int m_triface1;
 	int m_part1;
 
+	//! arrays reused by collide_sat_triangles, allocated on first use so the algorithm fits the dispatcher pool
+	struct TriangleScratch;
+	TriangleScratch * m_triangle_scratch;
+
 
 	//! Creates a new contact point
 	SIMD_FORCE_INLINE btPersistentManifold* newContactManifold(btCollisionObject* body0,btCollisionObject* body1)
@@ -178,21 +178,8 @@ int btQuantizedBvhTree::_sort_and_calc_splitting_index(
 }
 
 
-void btQuantizedBvhTree::_build_sub_tree(GIM_BVH_DATA_ARRAY & primitive_boxes, int startIndex,  int endIndex)
+int btQuantizedBvhTree::_build_node(GIM_BVH_DATA_ARRAY & primitive_boxes, int startIndex,  int endIndex, int nodeIndex)
 {
-	int curIndex = m_num_nodes;
-	m_num_nodes++;
-
-	btAssert((endIndex-startIndex)>0);
-
-	if ((endIndex-startIndex)==1)
-	{
-	    //We have a leaf node
-	    setNodeBound(curIndex,primitive_boxes[startIndex].m_bound);
-		m_node_array[curIndex].setDataIndex(primitive_boxes[startIndex].m_data);
-
-		return;
-	}
 	//calculate Best Splitting Axis and where to split it. Sort the incoming 'leafNodes' array within range 'startIndex/endIndex'.
 
 	//split axis
@@ -214,75 +201,261 @@ void btQuantizedBvhTree::_build_sub_tree(GIM_BVH_DATA_ARRAY & primitive_boxes, i
 		node_bound.merge(primitive_boxes[i].m_bound);
 	}
 
-	setNodeBound(curIndex,node_bound);
+	setNodeBound(nodeIndex,node_bound);
+
+	//the subtree takes 2n-1 nodes
+	m_node_array[nodeIndex].setEscapeIndex(2*(endIndex-startIndex)-1);
 
+	return splitIndex;
+}
+
+
+void btQuantizedBvhTree::_build_sub_tree(GIM_BVH_DATA_ARRAY & primitive_boxes, int startIndex,  int endIndex, int nodeIndex)
+{
+	btAssert((endIndex-startIndex)>0);
+
+	if ((endIndex-startIndex)==1)
+	{
+	    //We have a leaf node
+	    setNodeBound(nodeIndex,primitive_boxes[startIndex].m_bound);
+		m_node_array[nodeIndex].setDataIndex(primitive_boxes[startIndex].m_data);
+
+		return;
+	}
+
+	int splitIndex = _build_node(primitive_boxes,startIndex,endIndex,nodeIndex);
 
 	//build left branch
-	_build_sub_tree(primitive_boxes, startIndex, splitIndex );
+	_build_sub_tree(primitive_boxes, startIndex, splitIndex, nodeIndex+1);
 
 
 	//build right branch
-	 _build_sub_tree(primitive_boxes, splitIndex ,endIndex);
+	_build_sub_tree(primitive_boxes, splitIndex ,endIndex, nodeIndex+2*(splitIndex-startIndex));
+}
+
+
+///a range of primitives built by one task of btQuantizedBvhTree::_build_tree_parallel
+struct btGImpactQuantizedBvhBuildTask
+{
+	int m_startIndex;
+	int m_endIndex;
+	int m_nodeIndex;
+};
+
+struct btGImpactQuantizedBvhBuildLoop : public btIParallelForBody
+{
+	btQuantizedBvhTree * m_tree;
+	GIM_BVH_DATA_ARRAY * m_primitive_boxes;
+	const btGImpactQuantizedBvhBuildTask * m_tasks;
+
+	void forLoop(int iBegin, int iEnd) const
+	{
+		for (int i=iBegin;i<iEnd;i++)
+		{
+			const btGImpactQuantizedBvhBuildTask & task = m_tasks[i];
+			m_tree->_build_sub_tree(*m_primitive_boxes,task.m_startIndex,task.m_endIndex,task.m_nodeIndex);
+		}
+	}
+};
+
+
+void btQuantizedBvhTree::_build_tree_parallel(GIM_BVH_DATA_ARRAY & primitive_boxes, btITaskScheduler * scheduler)
+{
+	//split the largest range until there are enough tasks, each task sorts and builds its own range of primitives
+	btAlignedObjectArray<btGImpactQuantizedBvhBuildTask> tasks;
+	btGImpactQuantizedBvhBuildTask & root = tasks.expand();
+	root.m_startIndex = 0;
+	root.m_endIndex = primitive_boxes.size();
+	root.m_nodeIndex = 0;
+
+	while (tasks.size() < BT_GIMPACT_PARALLEL_TASKS)
+	{
+		int largestTask = -1;
+		int largestSize = BT_GIMPACT_PARALLEL_MIN_PRIMITIVES/BT_GIMPACT_PARALLEL_TASKS;
+		for (int i=0;i<tasks.size();i++)
+		{
+			const int size = tasks[i].m_endIndex-tasks[i].m_startIndex;
+			if (size > largestSize)
+			{
+				largestTask = i;
+				largestSize = size;
+			}
+		}
+		if (largestTask<0)
+			break;
+
+		btGImpactQuantizedBvhBuildTask task = tasks[largestTask];
+		const int splitIndex = _build_node(primitive_boxes,task.m_startIndex,task.m_endIndex,task.m_nodeIndex);
 
-	m_node_array[curIndex].setEscapeIndex(m_num_nodes - curIndex);
+		btGImpactQuantizedBvhBuildTask & leftTask = tasks[largestTask];
+		leftTask.m_endIndex = splitIndex;
+		leftTask.m_nodeIndex = task.m_nodeIndex+1;
 
+		btGImpactQuantizedBvhBuildTask & rightTask = tasks.expand();
+		rightTask.m_startIndex = splitIndex;
+		rightTask.m_endIndex = task.m_endIndex;
+		rightTask.m_nodeIndex = task.m_nodeIndex+2*(splitIndex-task.m_startIndex);
+	}
 
+	btGImpactQuantizedBvhBuildLoop loop;
+	loop.m_tree = this;
+	loop.m_primitive_boxes = &primitive_boxes;
+	loop.m_tasks = &tasks[0];
+	scheduler->parallelFor(0,tasks.size(),1,loop);
 }
 
 //! stackless build tree
 void btQuantizedBvhTree::build_tree(
-	GIM_BVH_DATA_ARRAY & primitive_boxes)
+	GIM_BVH_DATA_ARRAY & primitive_boxes, btITaskScheduler * scheduler)
 {
+	if (primitive_boxes.size() == 0)
+	{
+		clearNodes();
+		return;
+	}
+
 	calc_quantization(primitive_boxes);
-	// initialize node count to 0
-	m_num_nodes = 0;
+	// a tree of n primitives has 2n-1 nodes
+	m_num_nodes = 2*primitive_boxes.size()-1;
 	// allocate nodes
 	m_node_array.resize(primitive_boxes.size()*2);
 
-	_build_sub_tree(primitive_boxes, 0, primitive_boxes.size());
+	if (scheduler && primitive_boxes.size() >= BT_GIMPACT_PARALLEL_MIN_PRIMITIVES)
+	{
+		_build_tree_parallel(primitive_boxes, scheduler);
+	}
+	else
+	{
+		_build_sub_tree(primitive_boxes, 0, primitive_boxes.size(), 0);
+	}
 }
 
 ////////////////////////////////////class btGImpactQuantizedBvh
 
-void btGImpactQuantizedBvh::refit()
+void btGImpactQuantizedBvh::refitNode(int nodeindex)
 {
-	int nodecount = getNodeCount();
-	while(nodecount--)
+	if(isLeafNode(nodeindex))
+	{
+		btAABB leafbox;
+		m_primitive_manager->get_primitive_box(getNodeData(nodeindex),leafbox);
+		setNodeBound(nodeindex,leafbox);
+	}
+	else
 	{
-		if(isLeafNode(nodecount))
+		//const GIM_BVH_TREE_NODE * nodepointer = get_node_pointer(nodeindex);
+		//get left bound
+		btAABB bound;
+		bound.invalidate();
+
+		btAABB temp_box;
+
+		int child_node = getLeftNode(nodeindex);
+		if(child_node)
 		{
-			btAABB leafbox;
-			m_primitive_manager->get_primitive_box(getNodeData(nodecount),leafbox);
-			setNodeBound(nodecount,leafbox);
+			getNodeBound(child_node,temp_box);
+			bound.merge(temp_box);
 		}
-		else
+
+		child_node = getRightNode(nodeindex);
+		if(child_node)
 		{
-			//const GIM_BVH_TREE_NODE * nodepointer = get_node_pointer(nodecount);
-			//get left bound
-			btAABB bound;
-			bound.invalidate();
+			getNodeBound(child_node,temp_box);
+			bound.merge(temp_box);
+		}
 
-			btAABB temp_box;
+		setNodeBound(nodeindex,bound);
+	}
+}
 
-			int child_node = getLeftNode(nodecount);
-			if(child_node)
-			{
-				getNodeBound(child_node,temp_box);
-				bound.merge(temp_box);
-			}
+void btGImpactQuantizedBvh::refitRange(int beginNode, int endNode)
+{
+	int nodecount = endNode;
+	while(nodecount-- > beginNode)
+	{
+		refitNode(nodecount);
+	}
+}
 
-			child_node = getRightNode(nodecount);
-			if(child_node)
+struct btGImpactQuantizedBvhRefitLoop : public btIParallelForBody
+{
+	btGImpactQuantizedBvh * m_boxset;
+	const int * m_subtrees;
+
+	void forLoop(int iBegin, int iEnd) const
+	{
+		for (int i=iBegin;i<iEnd;i++)
+		{
+			const int root = m_subtrees[i];
+			const int size = m_boxset->isLeafNode(root) ? 1 : m_boxset->getEscapeNodeIndex(root);
+			m_boxset->refitRange(root,root+size);
+		}
+	}
+};
+
+void btGImpactQuantizedBvh::refit()
+{
+	int nodecount = getNodeCount();
+	if (!m_task_scheduler || nodecount < 2*BT_GIMPACT_PARALLEL_MIN_PRIMITIVES)
+	{
+		refitRange(0,nodecount);
+		return;
+	}
+
+	//split the largest subtree until there are enough of them; the nodes of a subtree are contiguous,
+	//so each one is refit like the whole tree, then the split nodes are refit from the last split one
+	btAlignedObjectArray<int> subtrees;
+	btAlignedObjectArray<int> splitNodes;
+	subtrees.push_back(0);
+	while (subtrees.size() < BT_GIMPACT_PARALLEL_TASKS)
+	{
+		int largestSubtree = -1;
+		int largestSize = 2*BT_GIMPACT_PARALLEL_MIN_PRIMITIVES/BT_GIMPACT_PARALLEL_TASKS;
+		for (int i=0;i<subtrees.size();i++)
+		{
+			const int size = isLeafNode(subtrees[i]) ? 1 : getEscapeNodeIndex(subtrees[i]);
+			if (size > largestSize)
 			{
-				getNodeBound(child_node,temp_box);
-				bound.merge(temp_box);
+				largestSubtree = i;
+				largestSize = size;
 			}
-
-			setNodeBound(nodecount,bound);
 		}
+		if (largestSubtree<0)
+			break;
+
+		const int node = subtrees[largestSubtree];
+		splitNodes.push_back(node);
+		subtrees[largestSubtree] = getLeftNode(node);
+		subtrees.push_back(getRightNode(node));
+	}
+
+	btGImpactQuantizedBvhRefitLoop loop;
+	loop.m_boxset = this;
+	loop.m_subtrees = &subtrees[0];
+	m_task_scheduler->parallelFor(0,subtrees.size(),1,loop);
+
+	//a node is split after its parent
+	int i = splitNodes.size();
+	while (i--)
+	{
+		refitNode(splitNodes[i]);
 	}
 }
 
+struct btGImpactQuantizedBvhPrimitiveBoxLoop : public btIParallelForBody
+{
+	const btPrimitiveManagerBase * m_primitive_manager;
+	GIM_BVH_DATA * m_primitive_boxes;
+
+	void forLoop(int iBegin, int iEnd) const
+	{
+		for (int i=iBegin;i<iEnd;i++)
+		{
+			m_primitive_manager->get_primitive_box(i,m_primitive_boxes[i].m_bound);
+			m_primitive_boxes[i].m_data = i;
+		}
+	}
+};
+
 //! this rebuild the entire set
 void btGImpactQuantizedBvh::buildSet()
 {
@@ -290,13 +463,23 @@ void btGImpactQuantizedBvh::buildSet()
 	GIM_BVH_DATA_ARRAY primitive_boxes;
 	primitive_boxes.resize(m_primitive_manager->get_primitive_count());
 
-	for (int i = 0;i<primitive_boxes.size() ;i++ )
+	if (m_task_scheduler && primitive_boxes.size() >= BT_GIMPACT_PARALLEL_MIN_PRIMITIVES)
+	{
+		btGImpactQuantizedBvhPrimitiveBoxLoop loop;
+		loop.m_primitive_manager = m_primitive_manager;
+		loop.m_primitive_boxes = &primitive_boxes[0];
+		m_task_scheduler->parallelFor(0,primitive_boxes.size(),BT_GIMPACT_PARALLEL_MIN_PRIMITIVES,loop);
+	}
+	else
 	{
-		 m_primitive_manager->get_primitive_box(i,primitive_boxes[i].m_bound);
-		 primitive_boxes[i].m_data = i;
+		for (int i = 0;i<primitive_boxes.size() ;i++ )
+		{
+			 m_primitive_manager->get_primitive_box(i,primitive_boxes[i].m_bound);
+			 primitive_boxes[i].m_data = i;
+		}
 	}
 
-	m_box_tree.build_tree(primitive_boxes);
+	m_box_tree.build_tree(primitive_boxes,m_task_scheduler);
 }
 
 //! returns the indices of the primitives in the m_primitive_manager
@@ -501,6 +684,141 @@ static void _find_quantized_collision_pairs_recursive(
 }
 
 
+///a pair of nodes of the traversal of btGImpactQuantizedBvh::find_collision, descended by one task
+struct btGImpactQuantizedBvhNodePair
+{
+	int m_node0;
+	int m_node1;
+	bool m_complete_primitive_tests;
+	//! the nodes are overlapping leaves
+	bool m_leaf_pair;
+};
+
+struct btGImpactQuantizedBvhCollisionLoop : public btIParallelForBody
+{
+	btGImpactQuantizedBvh * m_boxset0;
+	btGImpactQuantizedBvh * m_boxset1;
+	const BT_BOX_BOX_TRANSFORM_CACHE * m_trans_cache_1to0;
+	const btGImpactQuantizedBvhNodePair * m_node_pairs;
+	btPairSet * m_collision_pairs;
+
+	void forLoop(int iBegin, int iEnd) const
+	{
+		for (int i=iBegin;i<iEnd;i++)
+		{
+			const btGImpactQuantizedBvhNodePair & pair = m_node_pairs[i];
+			if (pair.m_leaf_pair)
+			{
+				m_collision_pairs[i].push_pair(
+					m_boxset0->getNodeData(pair.m_node0),m_boxset1->getNodeData(pair.m_node1));
+			}
+			else
+			{
+				_find_quantized_collision_pairs_recursive(
+					m_boxset0,m_boxset1,
+					&m_collision_pairs[i],*m_trans_cache_1to0,
+					pair.m_node0,pair.m_node1,pair.m_complete_primitive_tests);
+			}
+		}
+	}
+};
+
+
+//! descends the node pairs breadth first in the order of the recursion, so the pairs found from each of them
+//! in parallel, concatenated in order, are the pairs of the serial traversal
+static void _find_quantized_collision_pairs_parallel(
+	btGImpactQuantizedBvh * boxset0, btGImpactQuantizedBvh * boxset1,
+	btPairSet * collision_pairs,
+	const BT_BOX_BOX_TRANSFORM_CACHE & trans_cache_1to0,
+	btITaskScheduler * scheduler)
+{
+	btAlignedObjectArray<btGImpactQuantizedBvhNodePair> node_pair_arrays[2];
+	btAlignedObjectArray<btGImpactQuantizedBvhNodePair> * node_pairs = &node_pair_arrays[0];
+	btAlignedObjectArray<btGImpactQuantizedBvhNodePair> * next_node_pairs = &node_pair_arrays[1];
+	btGImpactQuantizedBvhNodePair root;
+	root.m_node0 = 0;
+	root.m_node1 = 0;
+	root.m_complete_primitive_tests = true;
+	root.m_leaf_pair = false;
+	node_pairs->push_back(root);
+
+	bool descended = true;
+	while (descended && node_pairs->size() > 0 && node_pairs->size() < BT_GIMPACT_PARALLEL_TASKS)
+	{
+		descended = false;
+		next_node_pairs->resize(0);
+		for (int i=0;i<node_pairs->size();i++)
+		{
+			const btGImpactQuantizedBvhNodePair pair = (*node_pairs)[i];
+			if (pair.m_leaf_pair)
+			{
+				next_node_pairs->push_back(pair);
+				continue;
+			}
+			if (_quantized_node_collision(
+				boxset0,boxset1,trans_cache_1to0,
+				pair.m_node0,pair.m_node1,pair.m_complete_primitive_tests) == false) continue;
+
+			const bool leaf0 = boxset0->isLeafNode(pair.m_node0);
+			const bool leaf1 = boxset1->isLeafNode(pair.m_node1);
+			btGImpactQuantizedBvhNodePair child;
+			child.m_complete_primitive_tests = false;
+			child.m_leaf_pair = false;
+			if (leaf0 && leaf1)
+			{
+				child.m_node0 = pair.m_node0;
+				child.m_node1 = pair.m_node1;
+				child.m_leaf_pair = true;
+				next_node_pairs->push_back(child);
+				continue;
+			}
+			descended = true;
+			const int children0[2] = {leaf0 ? pair.m_node0 : boxset0->getLeftNode(pair.m_node0),
+				leaf0 ? pair.m_node0 : boxset0->getRightNode(pair.m_node0)};
+			const int children1[2] = {leaf1 ? pair.m_node1 : boxset1->getLeftNode(pair.m_node1),
+				leaf1 ? pair.m_node1 : boxset1->getRightNode(pair.m_node1)};
+			for (int c0=0;c0<(leaf0 ? 1 : 2);c0++)
+			{
+				for (int c1=0;c1<(leaf1 ? 1 : 2);c1++)
+				{
+					child.m_node0 = children0[c0];
+					child.m_node1 = children1[c1];
+					next_node_pairs->push_back(child);
+				}
+			}
+		}
+		btSwap(node_pairs,next_node_pairs);
+	}
+
+	if (node_pairs->size() == 0) return;
+
+	btAlignedObjectArray<btPairSet> task_pairs;
+	task_pairs.resize(node_pairs->size());
+
+	btGImpactQuantizedBvhCollisionLoop loop;
+	loop.m_boxset0 = boxset0;
+	loop.m_boxset1 = boxset1;
+	loop.m_trans_cache_1to0 = &trans_cache_1to0;
+	loop.m_node_pairs = &(*node_pairs)[0];
+	loop.m_collision_pairs = &task_pairs[0];
+	scheduler->parallelFor(0,node_pairs->size(),1,loop);
+
+	int pair_count = collision_pairs->size();
+	for (int i=0;i<task_pairs.size();i++)
+	{
+		pair_count += task_pairs[i].size();
+	}
+	collision_pairs->reserve(pair_count);
+	for (int i=0;i<task_pairs.size();i++)
+	{
+		for (int j=0;j<task_pairs[i].size();j++)
+		{
+			collision_pairs->push_back(task_pairs[i][j]);
+		}
+	}
+}
+
+
 void btGImpactQuantizedBvh::find_collision(btGImpactQuantizedBvh * boxset0, const btTransform & trans0,
 		btGImpactQuantizedBvh * boxset1, const btTransform & trans1,
 		btPairSet & collision_pairs)
@@ -512,17 +830,28 @@ void btGImpactQuantizedBvh::find_collision(btGImpactQuantizedBvh * boxset0, cons
 
 	trans_cache_1to0.calc_from_homogenic(trans0,trans1);
 
+	btITaskScheduler * scheduler = boxset0->getTaskScheduler() ? boxset0->getTaskScheduler() : boxset1->getTaskScheduler();
+	const bool parallel = scheduler && scheduler->getNumThreads() > 1 &&
+		boxset0->getNodeCount() + boxset1->getNodeCount() >= 2*BT_GIMPACT_PARALLEL_MIN_PRIMITIVES;
+
 #ifdef TRI_COLLISION_PROFILING
 	bt_begin_gim02_q_tree_time();
 #endif //TRI_COLLISION_PROFILING
 
-	_find_quantized_collision_pairs_recursive(
-		boxset0,boxset1,
-		&collision_pairs,trans_cache_1to0,0,0,true);
+	if (parallel)
+	{
+		_find_quantized_collision_pairs_parallel(
+			boxset0,boxset1,
+			&collision_pairs,trans_cache_1to0,scheduler);
+	}
+	else
+	{
+		_find_quantized_collision_pairs_recursive(
+			boxset0,boxset1,
+			&collision_pairs,trans_cache_1to0,0,0,true);
+	}
 #ifdef TRI_COLLISION_PROFILING
 	bt_end_gim02_q_tree_time();
 #endif //TRI_COLLISION_PROFILING
 
 }
-
-
@@ -26,6 +26,12 @@ subject to the following restrictions:
 
 #include "btGImpactBvh.h"
 #include "btQuantization.h"
+#include "LinearMath/btThreads.h"
+
+///a parallel build, refit or pair search splits the tree into about this many subtrees or node pairs
+#define BT_GIMPACT_PARALLEL_TASKS 64
+///trees with fewer primitives are built, refit and collided serially
+#define BT_GIMPACT_PARALLEL_MIN_PRIMITIVES 256
 
 
 
@@ -118,7 +124,15 @@ protected:
 
 	int _calc_splitting_axis(GIM_BVH_DATA_ARRAY & primitive_boxes, int startIndex,  int endIndex);
 
-	void _build_sub_tree(GIM_BVH_DATA_ARRAY & primitive_boxes, int startIndex,  int endIndex);
+	//! builds the node nodeIndex of the primitives startIndex..endIndex-1 and returns the split index of its children
+	int _build_node(GIM_BVH_DATA_ARRAY & primitive_boxes, int startIndex,  int endIndex, int nodeIndex);
+
+	//! a subtree of n primitives takes 2n-1 nodes, so the children of each node are built at known indices
+	void _build_sub_tree(GIM_BVH_DATA_ARRAY & primitive_boxes, int startIndex,  int endIndex, int nodeIndex);
+
+	void _build_tree_parallel(GIM_BVH_DATA_ARRAY & primitive_boxes, btITaskScheduler * scheduler);
+
+	friend struct btGImpactQuantizedBvhBuildLoop;
 public:
 	btQuantizedBvhTree()
 	{
@@ -127,7 +141,8 @@ public:
 
 	//! prototype functions for box tree management
 	//!@{
-	void build_tree(GIM_BVH_DATA_ARRAY & primitive_boxes);
+	//! with a scheduler the top of the tree is split serially and its subtrees are built in parallel, the tree is the same
+	void build_tree(GIM_BVH_DATA_ARRAY & primitive_boxes, btITaskScheduler * scheduler = 0);
 
 	SIMD_FORCE_INLINE void quantizePoint(
 		unsigned short * quantizedpoint, const btVector3 & point) const
@@ -228,22 +243,45 @@ class btGImpactQuantizedBvh
 protected:
 	btQuantizedBvhTree m_box_tree;
 	btPrimitiveManagerBase * m_primitive_manager;
+	btITaskScheduler * m_task_scheduler;
 
 protected:
+	//! refits a node from its primitive or its children
+	void refitNode(int nodeindex);
+
+	//! refits the nodes beginNode..endNode-1 from the last one, children are refit before their parent
+	void refitRange(int beginNode, int endNode);
+
 	//stackless refit
 	void refit();
+
+	friend struct btGImpactQuantizedBvhRefitLoop;
 public:
 
 	//! this constructor doesn't build the tree. you must call	buildSet
 	btGImpactQuantizedBvh()
 	{
 		m_primitive_manager = NULL;
+		m_task_scheduler = NULL;
 	}
 
 	//! this constructor doesn't build the tree. you must call	buildSet
 	btGImpactQuantizedBvh(btPrimitiveManagerBase * primitive_manager)
 	{
 		m_primitive_manager = primitive_manager;
+		m_task_scheduler = NULL;
+	}
+
+	//! with a task scheduler, buildSet, update and find_collision run in parallel on large trees, with the same results.
+	//! The scheduler is not owned by the set, and the primitive manager must allow concurrent get_primitive_box calls.
+	SIMD_FORCE_INLINE void setTaskScheduler(btITaskScheduler * scheduler)
+	{
+		m_task_scheduler = scheduler;
+	}
+
+	SIMD_FORCE_INLINE btITaskScheduler * getTaskScheduler() const
+	{
+		return m_task_scheduler;
 	}
 
 	SIMD_FORCE_INLINE btAABB getGlobalBox()  const
@@ -363,6 +401,8 @@ public:
 	static float getAverageTreeCollisionTime();
 #endif //TRI_COLLISION_PROFILING
 
+	//! finds the pairs of overlapping primitives. When a set has a task scheduler, the top node pairs of the
+	//! traversal are collected serially and descended in parallel; the pairs come in the same order as serially.
 	static void find_collision(btGImpactQuantizedBvh * boxset1, const btTransform & trans1,
 		btGImpactQuantizedBvh * boxset2, const btTransform & trans2,
 		btPairSet & collision_pairs);
@@ -197,6 +197,21 @@ public:
 		return &m_box_set;
 	}
 
+	//! sets the task scheduler of the box set, not owned by the shape
+	/*!
+	The box set is then built and refit in parallel, and btGImpactCollisionAlgorithm finds and tests the triangle
+	pairs of this shape in parallel. The results are the same as without a scheduler.
+	*/
+	virtual void setTaskScheduler(btITaskScheduler * scheduler)
+	{
+		m_box_set.setTaskScheduler(scheduler);
+	}
+
+	SIMD_FORCE_INLINE btITaskScheduler * getTaskScheduler() const
+	{
+		return m_box_set.getTaskScheduler();
+	}
+
 	//! Determines if this class has a hierarchy structure for sorting its primitives
 	SIMD_FORCE_INLINE bool hasBoxSet()  const
 	{
@@ -998,6 +1013,18 @@ public:
 		m_needs_update = true;
     }
 
+	//! sets the task scheduler of all the mesh parts
+	virtual void setTaskScheduler(btITaskScheduler * scheduler)
+	{
+		m_box_set.setTaskScheduler(scheduler);
+
+		int i = m_mesh_parts.size();
+		while(i--)
+		{
+			m_mesh_parts[i]->setTaskScheduler(scheduler);
+		}
+	}
+
 	//! Tells to this object that is needed to refit all the meshes
     virtual void postUpdate()
     {
@@ -62,7 +62,7 @@ void GIM_TRIANGLE_CONTACT::merge_points(const btVector4 & plane,
 }
 
 ///class btPrimitiveTriangle
-bool btPrimitiveTriangle::overlap_test_conservative(const btPrimitiveTriangle& other)
+bool btPrimitiveTriangle::overlap_test_conservative(const btPrimitiveTriangle& other) const
 {
     btScalar total_margin = m_margin + other.m_margin;
     // classify points on other triangle
@@ -86,6 +86,70 @@ bool btPrimitiveTriangle::overlap_test_conservative(const btPrimitiveTriangle& o
     return true;
 }
 
+int btPrimitiveTriangle::overlap_test_conservative_4(const btPrimitiveTriangle * const * triangles0,
+	const btPrimitiveTriangle * const * triangles1, int count)
+{
+    btAssert(count>0 && count<=4);
+#ifdef BT_USE_SSE
+    // gather the planes, vertices and margins of the pairs as structure of arrays, unused lanes repeat the first pair
+    ATTRIBUTE_ALIGNED16(btScalar planes[2][4][4]);
+    ATTRIBUTE_ALIGNED16(btScalar vertices[2][3][3][4]);
+    ATTRIBUTE_ALIGNED16(btScalar margins[4]);
+    for (int lane = 0; lane < 4; lane++)
+    {
+        const int pair = lane < count ? lane : 0;
+        const btPrimitiveTriangle * triangles[2] = {triangles0[pair], triangles1[pair]};
+        for (int t = 0; t < 2; t++)
+        {
+            for (int c = 0; c < 4; c++)
+            {
+                planes[t][c][lane] = triangles[t]->m_plane[c];
+            }
+            for (int v = 0; v < 3; v++)
+            {
+                for (int c = 0; c < 3; c++)
+                {
+                    vertices[t][v][c][lane] = triangles[t]->m_vertices[v][c];
+                }
+            }
+        }
+        margins[lane] = triangles[0]->m_margin + triangles[1]->m_margin;
+    }
+
+    // the distances are computed in the order of bt_distance_point_plane, so the lanes give the scalar results
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 total_margin = _mm_load_ps(margins);
+    __m128 separated = zero;
+    for (int t = 0; t < 2; t++)
+    {
+        // vertices of one triangle against the plane of the other
+        const int p = 1-t;
+        __m128 outside = _mm_cmpeq_ps(zero,zero);
+        for (int v = 0; v < 3; v++)
+        {
+            __m128 dis = _mm_add_ps(
+                _mm_add_ps(_mm_mul_ps(_mm_load_ps(vertices[t][v][0]),_mm_load_ps(planes[p][0])),
+                           _mm_mul_ps(_mm_load_ps(vertices[t][v][1]),_mm_load_ps(planes[p][1]))),
+                _mm_mul_ps(_mm_load_ps(vertices[t][v][2]),_mm_load_ps(planes[p][2])));
+            dis = _mm_sub_ps(_mm_sub_ps(dis,_mm_load_ps(planes[p][3])),total_margin);
+            outside = _mm_and_ps(outside,_mm_cmpgt_ps(dis,zero));
+        }
+        separated = _mm_or_ps(separated,outside);
+    }
+    return ~_mm_movemask_ps(separated) & ((1<<count)-1);
+#else
+    int mask = 0;
+    for (int i = 0; i < count; i++)
+    {
+        if (triangles0[i]->overlap_test_conservative(*triangles1[i]))
+        {
+            mask |= 1<<i;
+        }
+    }
+    return mask;
+#endif
+}
+
 int btPrimitiveTriangle::clip_triangle(btPrimitiveTriangle & other, btVector3 * clipped_points )
 {
     // edge 0
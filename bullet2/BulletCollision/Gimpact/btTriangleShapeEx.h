@@ -92,7 +92,15 @@ public:
 	}
 
 	//! Test if triangles could collide
-	bool overlap_test_conservative(const btPrimitiveTriangle& other);
+	bool overlap_test_conservative(const btPrimitiveTriangle& other) const;
+
+	//! Tests if up to 4 pairs of triangles could collide, one pair per SIMD lane
+	/*!
+	\pre the triangles must have their planes calculated.
+	\return a mask with bit i set if triangles0[i] and triangles1[i] could collide, as overlap_test_conservative
+	*/
+	static int overlap_test_conservative_4(const btPrimitiveTriangle * const * triangles0,
+		const btPrimitiveTriangle * const * triangles1, int count);
 
 	//! Calcs the plane which is paralele to the edge and perpendicular to the triangle plane
 	/*!
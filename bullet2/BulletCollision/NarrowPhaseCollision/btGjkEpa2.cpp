@@ -24,6 +24,9 @@ GJK-EPA collision solver by Nathanael Presson, 2008
 */
 #include "BulletCollision/CollisionShapes/btConvexInternalShape.h"
 #include "BulletCollision/CollisionShapes/btSphereShape.h"
+#include "BulletCollision/CollisionShapes/btBoxShape.h"
+#include "BulletCollision/CollisionShapes/btCapsuleShape.h"
+#include "BulletCollision/CollisionShapes/btConvexHullShape.h"
 #include "btGjkEpa2.h"
 
 #if defined(DEBUG) || defined (_DEBUG)
@@ -1012,6 +1015,329 @@ bool	btGjkEpaSolver2::SignedDistance(const btConvexShape*	shape0,
 }
 #endif //__SPU__
 
+//
+// Batched separation bounds
+//
+
+namespace gjkepa2_impl
+{
+
+	/* Four lanes of scalars, one per pair	*/ 
+#ifdef BT_USE_SSE
+	typedef __m128	Lanes;
+	static SIMD_FORCE_INLINE Lanes	lSplat(btScalar x)					{ return(_mm_set1_ps(x)); }
+	static SIMD_FORCE_INLINE Lanes	lLoad(const btScalar* p)			{ return(_mm_load_ps(p)); }
+	static SIMD_FORCE_INLINE void	lStore(btScalar* p,Lanes a)			{ _mm_store_ps(p,a); }
+	static SIMD_FORCE_INLINE Lanes	lAdd(Lanes a,Lanes b)				{ return(_mm_add_ps(a,b)); }
+	static SIMD_FORCE_INLINE Lanes	lSub(Lanes a,Lanes b)				{ return(_mm_sub_ps(a,b)); }
+	static SIMD_FORCE_INLINE Lanes	lMul(Lanes a,Lanes b)				{ return(_mm_mul_ps(a,b)); }
+	static SIMD_FORCE_INLINE Lanes	lDiv(Lanes a,Lanes b)				{ return(_mm_div_ps(a,b)); }
+	static SIMD_FORCE_INLINE Lanes	lMax(Lanes a,Lanes b)				{ return(_mm_max_ps(a,b)); }
+	static SIMD_FORCE_INLINE Lanes	lMin(Lanes a,Lanes b)				{ return(_mm_min_ps(a,b)); }
+	static SIMD_FORCE_INLINE Lanes	lSqrt(Lanes a)						{ return(_mm_sqrt_ps(a)); }
+	static SIMD_FORCE_INLINE Lanes	lAbs(Lanes a)						{ return(_mm_andnot_ps(_mm_set1_ps(-0.f),a)); }
+	static SIMD_FORCE_INLINE Lanes	lGreater(Lanes a,Lanes b)			{ return(_mm_cmpgt_ps(a,b)); }
+	static SIMD_FORCE_INLINE Lanes	lGreaterEqual(Lanes a,Lanes b)		{ return(_mm_cmpge_ps(a,b)); }
+	static SIMD_FORCE_INLINE Lanes	lOr(Lanes a,Lanes b)				{ return(_mm_or_ps(a,b)); }
+	static SIMD_FORCE_INLINE Lanes	lSelect(Lanes m,Lanes a,Lanes b)	{ return(_mm_or_ps(_mm_and_ps(m,a),_mm_andnot_ps(m,b))); }
+	static SIMD_FORCE_INLINE int	lMask(Lanes m)						{ return(_mm_movemask_ps(m)); }
+#else
+	struct	Lanes { btScalar m[4]; };
+#define LANES_OP(_e_)	Lanes r;for(int i=0;i<4;++i) r.m[i]=(_e_);return(r)
+	static SIMD_FORCE_INLINE Lanes	lSplat(btScalar x)					{ LANES_OP(x); }
+	static SIMD_FORCE_INLINE Lanes	lLoad(const btScalar* p)			{ LANES_OP(p[i]); }
+	static SIMD_FORCE_INLINE void	lStore(btScalar* p,Lanes a)			{ for(int i=0;i<4;++i) p[i]=a.m[i]; }
+	static SIMD_FORCE_INLINE Lanes	lAdd(Lanes a,Lanes b)				{ LANES_OP(a.m[i]+b.m[i]); }
+	static SIMD_FORCE_INLINE Lanes	lSub(Lanes a,Lanes b)				{ LANES_OP(a.m[i]-b.m[i]); }
+	static SIMD_FORCE_INLINE Lanes	lMul(Lanes a,Lanes b)				{ LANES_OP(a.m[i]*b.m[i]); }
+	static SIMD_FORCE_INLINE Lanes	lDiv(Lanes a,Lanes b)				{ LANES_OP(a.m[i]/b.m[i]); }
+	static SIMD_FORCE_INLINE Lanes	lMax(Lanes a,Lanes b)				{ LANES_OP(btMax(a.m[i],b.m[i])); }
+	static SIMD_FORCE_INLINE Lanes	lMin(Lanes a,Lanes b)				{ LANES_OP(btMin(a.m[i],b.m[i])); }
+	static SIMD_FORCE_INLINE Lanes	lSqrt(Lanes a)						{ LANES_OP(btSqrt(a.m[i])); }
+	static SIMD_FORCE_INLINE Lanes	lAbs(Lanes a)						{ LANES_OP(btFabs(a.m[i])); }
+	static SIMD_FORCE_INLINE Lanes	lGreater(Lanes a,Lanes b)			{ LANES_OP(a.m[i]>b.m[i]?1:0); }
+	static SIMD_FORCE_INLINE Lanes	lGreaterEqual(Lanes a,Lanes b)		{ LANES_OP(a.m[i]>=b.m[i]?1:0); }
+	static SIMD_FORCE_INLINE Lanes	lOr(Lanes a,Lanes b)				{ LANES_OP((a.m[i]!=0)||(b.m[i]!=0)?1:0); }
+	static SIMD_FORCE_INLINE Lanes	lSelect(Lanes m,Lanes a,Lanes b)	{ LANES_OP(m.m[i]!=0?a.m[i]:b.m[i]); }
+	static SIMD_FORCE_INLINE int	lMask(Lanes m)						{ int r=0;for(int i=0;i<4;++i) if(m.m[i]!=0) r|=1<<i;return(r); }
+#undef LANES_OP
+#endif //BT_USE_SSE
+
+	static SIMD_FORCE_INLINE Lanes	lDot(Lanes ax,Lanes ay,Lanes az,Lanes bx,Lanes by,Lanes bz)
+	{
+		return(lAdd(lAdd(lMul(ax,bx),lMul(ay,by)),lMul(az,bz)));
+	}
+
+	/* One side of four pairs, a shape is the Minkowski sum of a box, a segment
+	(or a convex hull) and a sphere						*/ 
+	ATTRIBUTE_ALIGNED16(struct)	BatchShapes
+	{
+		btScalar					basis[9][4];
+		btScalar					origin[3][4];
+		btScalar					extents[3][4];
+		btScalar					axis[3][4];
+		btScalar					radius[4];
+		const btConvexHullShape*	hulls[4];
+		int							nhulls;
+	};
+
+	/* The hull has a point and its structure of arrays is up to date			*/ 
+	static SIMD_FORCE_INLINE bool	IsBatchHull(const btConvexHullShape* hull)
+	{
+		return(hull->getNumPoints()>0 && hull->getNumSoaBlocks()==(hull->getNumPoints()+3)/4);
+	}
+
+	/* The shape in a lane, as GJK sees it: the support without margin grown by the margin	*/ 
+	static bool		SetBatchShape(const btConvexShape* shape,const btTransform& wtrs,BatchShapes& s,int lane)
+	{
+		btVector3					extents(0,0,0);
+		btVector3					axis(0,0,0);
+		btScalar					radius=shape->getMarginNonVirtual();
+		const btConvexHullShape*	hull=0;
+		switch(shape->getShapeType())
+		{
+		case	SPHERE_SHAPE_PROXYTYPE:
+			break;
+		case	BOX_SHAPE_PROXYTYPE:
+			extents=static_cast<const btBoxShape*>(shape)->getImplicitShapeDimensions();
+			break;
+		case	CAPSULE_SHAPE_PROXYTYPE:
+			{
+				const btCapsuleShape*	capsule=static_cast<const btCapsuleShape*>(shape);
+				axis[capsule->getUpAxis()]=capsule->getHalfHeight();
+				radius=capsule->getRadius();
+			}
+			break;
+		case	CONVEX_HULL_SHAPE_PROXYTYPE:
+			hull=static_cast<const btConvexHullShape*>(shape);
+			if(!IsBatchHull(hull)) return(false);
+			break;
+		default:
+			return(false);
+		}
+		const btMatrix3x3&	basis=wtrs.getBasis();
+		for(int i=0;i<3;++i)
+		{
+			for(int j=0;j<3;++j) s.basis[i*3+j][lane]=basis[i][j];
+			s.origin[i][lane]	=	wtrs.getOrigin()[i];
+			s.extents[i][lane]	=	extents[i];
+			s.axis[i][lane]		=	axis[i];
+		}
+		s.radius[lane]	=	radius;
+		s.hulls[lane]	=	hull;
+		if(hull) ++s.nhulls;
+		return(true);
+	}
+
+	/* A point at the origin, for the lanes without a pair		*/ 
+	static void		ClearBatchShape(BatchShapes& s,int lane)
+	{
+		for(int i=0;i<3;++i)
+		{
+			for(int j=0;j<3;++j) s.basis[i*3+j][lane]=i==j?1:0;
+			s.origin[i][lane]=s.extents[i][lane]=s.axis[i][lane]=0;
+		}
+		s.radius[lane]=0;
+		if(s.hulls[lane]) --s.nhulls;
+		s.hulls[lane]=0;
+	}
+
+	/* Support of a hull in a direction, four points at a time			*/ 
+	static void		HullSupport(const btConvexHullShape* hull,btScalar dx,btScalar dy,btScalar dz,btScalar* p)
+	{
+		const btScalar*	soa=hull->getSoaPoints();
+		const int		nblocks=hull->getNumSoaBlocks();
+		int				block=0;
+		int				lane=0;
+#ifdef BT_USE_SSE
+		const __m128	vx=_mm_set1_ps(dx);
+		const __m128	vy=_mm_set1_ps(dy);
+		const __m128	vz=_mm_set1_ps(dz);
+		__m128			best=_mm_set1_ps(-BT_LARGE_FLOAT);
+		__m128			bestblock=_mm_setzero_ps();
+		for(int i=0;i<nblocks;++i,soa+=12)
+		{
+			const __m128	d=_mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_load_ps(soa),vx),_mm_mul_ps(_mm_load_ps(soa+4),vy)),_mm_mul_ps(_mm_load_ps(soa+8),vz));
+			const __m128	m=_mm_cmpgt_ps(d,best);
+			best		=	_mm_or_ps(_mm_and_ps(m,d),_mm_andnot_ps(m,best));
+			bestblock	=	_mm_or_ps(_mm_and_ps(m,_mm_set1_ps(btScalar(i))),_mm_andnot_ps(m,bestblock));
+		}
+		ATTRIBUTE_ALIGNED16(btScalar	dots[4]);
+		ATTRIBUTE_ALIGNED16(btScalar	blocks[4]);
+		_mm_store_ps(dots,best);
+		_mm_store_ps(blocks,bestblock);
+		for(int i=1;i<4;++i) if(dots[i]>dots[lane]) lane=i;
+		block=int(blocks[lane]);
+#else
+		btScalar		best=-BT_LARGE_FLOAT;
+		for(int i=0;i<nblocks;++i)
+		{
+			const btScalar*	b=soa+i*12;
+			for(int j=0;j<4;++j)
+			{
+				const btScalar	d=b[j]*dx+b[4+j]*dy+b[8+j]*dz;
+				if(d>best) { best=d;block=i;lane=j; }
+			}
+		}
+#endif //BT_USE_SSE
+		soa=hull->getSoaPoints()+block*12;
+		p[0]=soa[lane];
+		p[1]=soa[4+lane];
+		p[2]=soa[8+lane];
+	}
+
+	/* Supports of the shapes of the lanes in world directions n			*/ 
+	static SIMD_FORCE_INLINE void	BatchSupport(const BatchShapes& s,Lanes nx,Lanes ny,Lanes nz,Lanes& px,Lanes& py,Lanes& pz)
+	{
+		const Lanes	zero=lSplat(0);
+		const Lanes	one=lSplat(1);
+		const Lanes	minusone=lSplat(-1);
+		/* Direction in shape space			*/ 
+		const Lanes	dx=lDot(lLoad(s.basis[0]),lLoad(s.basis[3]),lLoad(s.basis[6]),nx,ny,nz);
+		const Lanes	dy=lDot(lLoad(s.basis[1]),lLoad(s.basis[4]),lLoad(s.basis[7]),nx,ny,nz);
+		const Lanes	dz=lDot(lLoad(s.basis[2]),lLoad(s.basis[5]),lLoad(s.basis[8]),nx,ny,nz);
+		/* Box corner and segment end in the direction, as btFsels		*/ 
+		const Lanes	ex=lLoad(s.extents[0]);
+		const Lanes	ey=lLoad(s.extents[1]);
+		const Lanes	ez=lLoad(s.extents[2]);
+		const Lanes	ax=lLoad(s.axis[0]);
+		const Lanes	ay=lLoad(s.axis[1]);
+		const Lanes	az=lLoad(s.axis[2]);
+		const Lanes	as=lSelect(lGreaterEqual(lDot(ax,ay,az,dx,dy,dz),zero),one,minusone);
+		Lanes		qx=lAdd(lSelect(lGreaterEqual(dx,zero),ex,lSub(zero,ex)),lMul(ax,as));
+		Lanes		qy=lAdd(lSelect(lGreaterEqual(dy,zero),ey,lSub(zero,ey)),lMul(ay,as));
+		Lanes		qz=lAdd(lSelect(lGreaterEqual(dz,zero),ez,lSub(zero,ez)),lMul(az,as));
+		if(s.nhulls)
+		{
+			ATTRIBUTE_ALIGNED16(btScalar	d[3][4]);
+			ATTRIBUTE_ALIGNED16(btScalar	q[3][4]);
+			lStore(d[0],dx);lStore(d[1],dy);lStore(d[2],dz);
+			lStore(q[0],qx);lStore(q[1],qy);lStore(q[2],qz);
+			for(int i=0;i<4;++i)
+			{
+				if(s.hulls[i])
+				{
+					btScalar	p[3];
+					HullSupport(s.hulls[i],d[0][i],d[1][i],d[2][i],p);
+					q[0][i]+=p[0];q[1][i]+=p[1];q[2][i]+=p[2];
+				}
+			}
+			qx=lLoad(q[0]);qy=lLoad(q[1]);qz=lLoad(q[2]);
+		}
+		/* World space, grown by the radius		*/ 
+		const Lanes	r=lLoad(s.radius);
+		px=lAdd(lAdd(lDot(lLoad(s.basis[0]),lLoad(s.basis[1]),lLoad(s.basis[2]),qx,qy,qz),lLoad(s.origin[0])),lMul(r,nx));
+		py=lAdd(lAdd(lDot(lLoad(s.basis[3]),lLoad(s.basis[4]),lLoad(s.basis[5]),qx,qy,qz),lLoad(s.origin[1])),lMul(r,ny));
+		pz=lAdd(lAdd(lDot(lLoad(s.basis[6]),lLoad(s.basis[7]),lLoad(s.basis[8]),qx,qy,qz),lLoad(s.origin[2])),lMul(r,nz));
+	}
+
+}
+
+//
+bool	btGjkEpaSolver2::IsBatchShape(const btConvexShape* shape)
+{
+	switch(shape->getShapeType())
+	{
+	case	SPHERE_SHAPE_PROXYTYPE:
+	case	BOX_SHAPE_PROXYTYPE:
+	case	CAPSULE_SHAPE_PROXYTYPE:
+		return(true);
+	case	CONVEX_HULL_SHAPE_PROXYTYPE:
+		return(gjkepa2_impl::IsBatchHull(static_cast<const btConvexHullShape*>(shape)));
+	default:
+		return(false);
+	}
+}
+
+//
+void	btGjkEpaSolver2::SeparationLowerBounds(	const sBatchPair* pairs,
+												int count,
+												btScalar* lowerBounds,
+												int maxIterations)
+{
+	using namespace gjkepa2_impl;
+	for(int first=0;first<count;first+=4)
+	{
+		const int		n=btMin(4,count-first);
+		BatchShapes		shapes[2];
+		ATTRIBUTE_ALIGNED16(btScalar	thresholds[4]);
+		ATTRIBUTE_ALIGNED16(btScalar	bounds[4]);
+		int				valid=0;
+		shapes[0].nhulls=shapes[1].nhulls=0;
+		for(int lane=0;lane<4;++lane)
+		{
+			/* Unused lanes repeat the first pair		*/ 
+			const sBatchPair&	pair=pairs[first+(lane<n?lane:0)];
+			shapes[0].hulls[lane]=shapes[1].hulls[lane]=0;
+			if(	SetBatchShape(pair.shapes[0],*pair.wtrs[0],shapes[0],lane)&&
+				SetBatchShape(pair.shapes[1],*pair.wtrs[1],shapes[1],lane))
+			{
+				if(lane<n) valid|=1<<lane;
+			}
+			else
+			{
+				ClearBatchShape(shapes[0],lane);
+				ClearBatchShape(shapes[1],lane);
+			}
+			thresholds[lane]=pair.threshold;
+		}
+		const Lanes	zero=lSplat(0);
+		const Lanes	one=lSplat(1);
+		const Lanes	tiny=lSplat(GJK_MIN_DISTANCE*GJK_MIN_DISTANCE);
+		/* Rounding of the supports, subtracted from the bound to keep it below the distance	*/ 
+		const Lanes	rounding=lSplat(SIMD_EPSILON*64);
+		const Lanes	threshold=lLoad(thresholds);
+		Lanes		bound=lSplat(-BT_LARGE_FLOAT);
+		/* The first direction joins the origins		*/ 
+		Lanes		vx=lSub(lLoad(shapes[0].origin[0]),lLoad(shapes[1].origin[0]));
+		Lanes		vy=lSub(lLoad(shapes[0].origin[1]),lLoad(shapes[1].origin[1]));
+		Lanes		vz=lSub(lLoad(shapes[0].origin[2]),lLoad(shapes[1].origin[2]));
+		for(int iteration=0;iteration<maxIterations;++iteration)
+		{
+			const Lanes	l2=lDot(vx,vy,vz,vx,vy,vz);
+			const Lanes	degenerate=lGreater(tiny,l2);
+			const Lanes	length=lSqrt(lMax(l2,tiny));
+			const Lanes	nx=lSelect(degenerate,one,lDiv(vx,length));
+			const Lanes	ny=lSelect(degenerate,zero,lDiv(vy,length));
+			const Lanes	nz=lSelect(degenerate,zero,lDiv(vz,length));
+			/* Support of the difference of the shapes in -n, its projection on n bounds the distance	*/ 
+			Lanes		ax,ay,az,bx,by,bz;
+			BatchSupport(shapes[0],lSub(zero,nx),lSub(zero,ny),lSub(zero,nz),ax,ay,az);
+			BatchSupport(shapes[1],nx,ny,nz,bx,by,bz);
+			const Lanes	wx=lSub(ax,bx);
+			const Lanes	wy=lSub(ay,by);
+			const Lanes	wz=lSub(az,bz);
+			const Lanes	magnitude=lAdd(lAdd(lAdd(lAbs(ax),lAbs(ay)),lAdd(lAbs(az),lAbs(bx))),lAdd(lAbs(by),lAbs(bz)));
+			bound=lMax(bound,lSub(lDot(wx,wy,wz,nx,ny,nz),lMul(rounding,lAdd(magnitude,one))));
+			if(iteration==0)
+			{
+				vx=wx;vy=wy;vz=wz;
+			}
+			else
+			{
+				/* Closest point to the origin on the segment v,w, a point of the difference	*/ 
+				const Lanes	ex=lSub(wx,vx);
+				const Lanes	ey=lSub(wy,vy);
+				const Lanes	ez=lSub(wz,vz);
+				const Lanes	e2=lMax(lDot(ex,ey,ez,ex,ey,ez),tiny);
+				const Lanes	t=lMin(lMax(lDiv(lSub(zero,lDot(vx,vy,vz,ex,ey,ez)),e2),zero),one);
+				vx=lAdd(vx,lMul(ex,t));
+				vy=lAdd(vy,lMul(ey,t));
+				vz=lAdd(vz,lMul(ez,t));
+			}
+			/* A pair is done once it is proven apart, or once v shows it is not			*/ 
+			const Lanes	distance=lSqrt(lDot(vx,vy,vz,vx,vy,vz));
+			const Lanes	done=lOr(lGreater(bound,threshold),lGreaterEqual(threshold,distance));
+			if((lMask(done)&valid)==valid) break;
+		}
+		lStore(bounds,bound);
+		for(int lane=0;lane<n;++lane)
+		{
+			lowerBounds[first+lane]=(valid&(1<<lane))?bounds[lane]:-BT_LARGE_FLOAT;
+		}
+	}
+}
+
 /* Symbols cleanup		*/ 
 
 #undef GJK_MAX_ITERATIONS
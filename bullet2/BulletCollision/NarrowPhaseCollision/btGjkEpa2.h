@@ -43,6 +43,12 @@ struct	sResults
 	btVector3	normal;
 	btScalar	distance;
 	};
+struct	sBatchPair
+	{
+	const btConvexShape*	shapes[2];
+	const btTransform*		wtrs[2];
+	btScalar				threshold;	/* A pair is done once its bound exceeds threshold		*/ 
+	};
 
 static int		StackSizeRequirement();
 
@@ -69,6 +75,17 @@ static bool		SignedDistance(	const btConvexShape* shape0,const btTransform& wtrs
 								sResults& results);
 #endif //__SPU__
 
+///true for the shapes of SeparationLowerBounds: spheres, boxes, capsules and convex hulls
+static bool		IsBatchShape(const btConvexShape* shape);
+
+///SeparationLowerBounds bounds from below the distance between the shapes of each pair, margins included, with a descent
+///along the Minkowski difference evaluated on four pairs at once in SIMD lanes. The shapes of a pair are at least
+///lowerBounds[i] apart; the bound of a pair that overlaps, or that is not proven apart within maxIterations, is not positive.
+static void		SeparationLowerBounds(	const sBatchPair* pairs,
+										int count,
+										btScalar* lowerBounds,
+										int maxIterations=16);
+
 };
 
 #endif //BT_GJK_EPA2_H
@@ -17,6 +17,7 @@ subject to the following restrictions:
 #include "BulletCollision/CollisionShapes/btConvexShape.h"
 #include "BulletCollision/NarrowPhaseCollision/btSimplexSolverInterface.h"
 #include "BulletCollision/NarrowPhaseCollision/btConvexPenetrationDepthSolver.h"
+#include "LinearMath/btThreads.h"
 
 
 
@@ -98,7 +99,7 @@ void btGjkPairDetector::getClosestPointsNonVirtual(const ClosestPointInput& inpu
 	btScalar marginA = m_marginA;
 	btScalar marginB = m_marginB;
 
-	gNumGjkChecks++;
+	btAtomicAdd(&gNumGjkChecks,1);
 
 #ifdef DEBUG_SPU_COLLISION_DETECTION
 	spu_printf("inside gjk\n");
@@ -345,7 +346,7 @@ void btGjkPairDetector::getClosestPointsNonVirtual(const ClosestPointInput& inpu
 				// Penetration depth case.
 				btVector3 tmpPointOnA,tmpPointOnB;
 				
-				gNumDeepPenetrationChecks++;
+				btAtomicAdd(&gNumDeepPenetrationChecks,1);
 				m_cachedSeparatingAxis.setZero();
 
 				bool isValid2 = m_penetrationDepthSolver->calcPenDepth( 
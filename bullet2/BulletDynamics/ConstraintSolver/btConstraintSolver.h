@@ -27,6 +27,13 @@ struct btBroadphaseProxy;
 class btIDebugDraw;
 class btStackAlloc;
 class	btDispatcher;
+
+enum	btConstraintSolverType
+{
+	BT_SEQUENTIAL_IMPULSE_SOLVER=1,
+	BT_USER_CONSTRAINT_SOLVER=2
+};
+
 /// btConstraintSolver provides solver interface
 class btConstraintSolver
 {
@@ -44,6 +51,19 @@ public:
 
 	///clear internal cached data and reset random seed
 	virtual	void	reset() = 0;
+
+	virtual	btConstraintSolverType	getSolverType() const
+	{
+		return BT_USER_CONSTRAINT_SOLVER;
+	}
+
+	///returns a new solver that solves groups like this one, for another thread of the parallel island solving in btDiscreteDynamicsWorld.
+	///It is allocated with btAlignedAlloc, the world destroys it with ~btConstraintSolver and btAlignedFree.
+	///Returns 0 by default, so the islands of a solver that does not opt in are solved serially.
+	virtual	btConstraintSolver*	createThreadSolver()
+	{
+		return 0;
+	}
 };
 
 
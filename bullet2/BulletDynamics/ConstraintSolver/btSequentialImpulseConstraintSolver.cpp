@@ -32,12 +32,15 @@ subject to the following restrictions:
 #include "btSolverBody.h"
 #include "btSolverConstraint.h"
 #include "LinearMath/btAlignedObjectArray.h"
+#include "LinearMath/btThreads.h"
 #include <string.h> //for memset
 
 int		gNumSplitImpulseRecoveries = 0;
 
 btSequentialImpulseConstraintSolver::btSequentialImpulseConstraintSolver()
-:m_btSeed2(0)
+:m_fixedBody(0,0,0),
+m_btSeed2(0),
+m_numSplitImpulseRecoveries(0)
 {
 
 }
@@ -46,6 +49,12 @@ btSequentialImpulseConstraintSolver::~btSequentialImpulseConstraintSolver()
 {
 }
 
+btConstraintSolver* btSequentialImpulseConstraintSolver::createThreadSolver()
+{
+	void* mem = btAlignedAlloc(sizeof(btSequentialImpulseConstraintSolver),16);
+	return new (mem) btSequentialImpulseConstraintSolver;
+}
+
 #ifdef USE_SIMD
 #include <emmintrin.h>
 #define btVecSplat(x, e) _mm_shuffle_ps(x, x, _MM_SHUFFLE(e,e,e,e))
@@ -181,7 +190,7 @@ void	btSequentialImpulseConstraintSolver::resolveSplitPenetrationImpulseCacheFri
 {
 		if (c.m_rhsPenetration)
         {
-			gNumSplitImpulseRecoveries++;
+			m_numSplitImpulseRecoveries++;
 			btScalar deltaImpulse = c.m_rhsPenetration-btScalar(c.m_appliedPushImpulse)*c.m_cfm;
 			const btScalar deltaVel1Dotn	=	c.m_contactNormal.dot(body1.internalGetPushVelocity()) 	+ c.m_relpos1CrossNormal.dot(body1.internalGetTurnVelocity());
 			const btScalar deltaVel2Dotn	=	-c.m_contactNormal.dot(body2.internalGetPushVelocity()) + c.m_relpos2CrossNormal.dot(body2.internalGetTurnVelocity());
@@ -209,7 +218,7 @@ void	btSequentialImpulseConstraintSolver::resolveSplitPenetrationImpulseCacheFri
 	if (!c.m_rhsPenetration)
 		return;
 
-	gNumSplitImpulseRecoveries++;
+	m_numSplitImpulseRecoveries++;
 
 	__m128 cpAppliedImp = _mm_set1_ps(c.m_appliedPushImpulse);
 	__m128	lowerLimit1 = _mm_set1_ps(c.m_lowerLimit);
@@ -338,8 +347,8 @@ void btSequentialImpulseConstraintSolver::setupFrictionConstraint(btSolverConstr
 
 	solverConstraint.m_contactNormal = normalAxis;
 
-	solverConstraint.m_solverBodyA = body0 ? body0 : &getFixedBody();
-	solverConstraint.m_solverBodyB = body1 ? body1 : &getFixedBody();
+	solverConstraint.m_solverBodyA = getSolverRigidBody(body0);
+	solverConstraint.m_solverBodyB = getSolverRigidBody(body1);
 
 	solverConstraint.m_friction = cp.m_combinedFriction;
 	solverConstraint.m_originalContactPoint = 0;
@@ -676,8 +685,8 @@ void	btSequentialImpulseConstraintSolver::convertContact(btPersistentManifold* m
 			btSolverConstraint& solverConstraint = m_tmpSolverContactConstraintPool.expandNonInitializing();
 			btRigidBody* rb0 = btRigidBody::upcast(colObj0);
 			btRigidBody* rb1 = btRigidBody::upcast(colObj1);
-			solverConstraint.m_solverBodyA = rb0? rb0 : &getFixedBody();
-			solverConstraint.m_solverBodyB = rb1? rb1 : &getFixedBody();
+			solverConstraint.m_solverBodyA = getSolverRigidBody(rb0);
+			solverConstraint.m_solverBodyB = getSolverRigidBody(rb1);
 			solverConstraint.m_originalContactPoint = &cp;
 
 			setupContactConstraint(solverConstraint, colObj0, colObj1, cp, infoGlobal, vel, rel_vel, relaxation, rel_pos1, rel_pos2);
@@ -780,6 +789,10 @@ btScalar btSequentialImpulseConstraintSolver::solveGroupCacheFriendlySetup(btCol
 			}
 		}
 	}
+	m_fixedBody.internalGetDeltaLinearVelocity().setZero();
+	m_fixedBody.internalGetDeltaAngularVelocity().setZero();
+	m_fixedBody.internalGetPushVelocity().setZero();
+	m_fixedBody.internalGetTurnVelocity().setZero();
 
 	if (1)
 	{
@@ -848,15 +861,15 @@ btScalar btSequentialImpulseConstraintSolver::solveGroupCacheFriendlySetup(btCol
 						currentConstraintRow[j].m_upperLimit = SIMD_INFINITY;
 						currentConstraintRow[j].m_appliedImpulse = 0.f;
 						currentConstraintRow[j].m_appliedPushImpulse = 0.f;
-						currentConstraintRow[j].m_solverBodyA = &rbA;
-						currentConstraintRow[j].m_solverBodyB = &rbB;
+						currentConstraintRow[j].m_solverBodyA = getSolverRigidBody(&rbA);
+						currentConstraintRow[j].m_solverBodyB = getSolverRigidBody(&rbB);
 						currentConstraintRow[j].m_overrideNumSolverIterations = overrideNumSolverIterations;
 					}
 
-					rbA.internalGetDeltaLinearVelocity().setValue(0.f,0.f,0.f);
-					rbA.internalGetDeltaAngularVelocity().setValue(0.f,0.f,0.f);
-					rbB.internalGetDeltaLinearVelocity().setValue(0.f,0.f,0.f);
-					rbB.internalGetDeltaAngularVelocity().setValue(0.f,0.f,0.f);
+					currentConstraintRow->m_solverBodyA->internalGetDeltaLinearVelocity().setValue(0.f,0.f,0.f);
+					currentConstraintRow->m_solverBodyA->internalGetDeltaAngularVelocity().setValue(0.f,0.f,0.f);
+					currentConstraintRow->m_solverBodyB->internalGetDeltaLinearVelocity().setValue(0.f,0.f,0.f);
+					currentConstraintRow->m_solverBodyB->internalGetDeltaAngularVelocity().setValue(0.f,0.f,0.f);
 
 
 
@@ -1115,6 +1128,376 @@ btScalar btSequentialImpulseConstraintSolver::solveSingleIteration(int iteration
 }
 
 
+int	btSequentialImpulseConstraintSolver::getBatchBodyIndex(btRigidBody* body)
+{
+	int index = body->getCompanionId();
+	if (index < 0)
+	{
+		index = m_batchBodies.size();
+		body->setCompanionId(index);
+		btSolverBatchBody& batchBody = m_batchBodies.expandNonInitializing();
+		batchBody.m_deltaLinearVelocity = body->internalGetDeltaLinearVelocity();
+		batchBody.m_deltaAngularVelocity = body->internalGetDeltaAngularVelocity();
+		m_batchRigidBodies.push_back(body);
+		m_batchBodyLastBatch.push_back(-1);
+	}
+	return index;
+}
+
+int	btSequentialImpulseConstraintSolver::findFreeBatch(int batchIndex,btConstraintBatchArray& batches)
+{
+	int freeIndex = batchIndex;
+	while (freeIndex < batches.size() && m_batchNumRows[freeIndex] == BT_SOLVER_BATCH_WIDTH)
+	{
+		freeIndex = m_batchNextFree[freeIndex];
+	}
+	///path compression, full batches are skipped in one step next time
+	while (batchIndex < batches.size() && m_batchNumRows[batchIndex] == BT_SOLVER_BATCH_WIDTH)
+	{
+		int next = m_batchNextFree[batchIndex];
+		m_batchNextFree[batchIndex] = freeIndex;
+		batchIndex = next;
+	}
+
+	///the lanes are filled by buildConstraintBatches, unused lanes are cleared at the end
+	while (freeIndex >= batches.size())
+	{
+		batches.expandNonInitializing();
+		m_batchNumRows.push_back(0);
+		m_batchNextFree.push_back(batches.size());
+	}
+	return freeIndex;
+}
+
+void	btSequentialImpulseConstraintSolver::buildConstraintBatches(btConstraintArray& rows,bool friction,btConstraintBatchArray& batches)
+{
+	batches.resize(0);
+	m_batchNumRows.resize(0);
+	m_batchNextFree.resize(0);
+	int i;
+	for (i=0;i<m_batchBodyLastBatch.size();i++)
+	{
+		m_batchBodyLastBatch[i] = -1;
+	}
+
+	///greedy graph colouring in one pass: a row goes to the first batch with a free lane after the last batch
+	///of both its bodies. Rows of the same body keep their order. The fixed body (index 0) is never written, it can be shared.
+	for (int row=0;row<rows.size();row++)
+	{
+		btSolverConstraint& c = rows[row];
+		int bodyA = getBatchBodyIndex(c.m_solverBodyA);
+		int bodyB = getBatchBodyIndex(c.m_solverBodyB);
+		int batchIndex = findFreeBatch(btMax(bodyA ? m_batchBodyLastBatch[bodyA] : -1,bodyB ? m_batchBodyLastBatch[bodyB] : -1)+1,batches);
+		m_batchBodyLastBatch[bodyA] = batchIndex;
+		m_batchBodyLastBatch[bodyB] = batchIndex;
+		int lane = m_batchNumRows[batchIndex]++;
+
+		btSolverConstraintBatch& batch = batches[batchIndex];
+		btVector3 linearComponentA = c.m_contactNormal*c.m_solverBodyA->internalGetInvMass();
+		btVector3 linearComponentB = c.m_contactNormal*c.m_solverBodyB->internalGetInvMass();
+		for (int k=0;k<3;k++)
+		{
+			batch.m_contactNormal[k][lane] = c.m_contactNormal[k];
+			batch.m_relpos1CrossNormal[k][lane] = c.m_relpos1CrossNormal[k];
+			batch.m_relpos2CrossNormal[k][lane] = c.m_relpos2CrossNormal[k];
+			batch.m_linearComponentA[k][lane] = linearComponentA[k];
+			batch.m_linearComponentB[k][lane] = linearComponentB[k];
+			batch.m_angularComponentA[k][lane] = c.m_angularComponentA[k];
+			batch.m_angularComponentB[k][lane] = c.m_angularComponentB[k];
+		}
+		batch.m_rhs[lane] = c.m_rhs;
+		batch.m_cfm[lane] = c.m_cfm;
+		batch.m_jacDiagABInv[lane] = c.m_jacDiagABInv;
+		batch.m_lowerLimit[lane] = c.m_lowerLimit;
+		batch.m_upperLimit[lane] = c.m_upperLimit;
+		batch.m_friction[lane] = c.m_friction;
+		batch.m_appliedImpulse[lane] = c.m_appliedImpulse;
+		batch.m_bodyA[lane] = bodyA;
+		batch.m_bodyB[lane] = bodyB;
+		batch.m_row[lane] = row;
+		if (friction)
+		{
+			batch.m_contactLane[lane] = m_contactRowLanes[c.m_frictionIndex];
+		} else
+		{
+			m_contactRowLanes[row] = batchIndex*BT_SOLVER_BATCH_WIDTH+lane;
+		}
+	}
+
+	///unused lanes have zero coefficients and use the fixed body, so solving them changes nothing
+	for (i=0;i<batches.size();i++)
+	{
+		btSolverConstraintBatch& batch = batches[i];
+		for (int lane=m_batchNumRows[i];lane<BT_SOLVER_BATCH_WIDTH;lane++)
+		{
+			for (int k=0;k<3;k++)
+			{
+				batch.m_contactNormal[k][lane] = btScalar(0.);
+				batch.m_relpos1CrossNormal[k][lane] = btScalar(0.);
+				batch.m_relpos2CrossNormal[k][lane] = btScalar(0.);
+				batch.m_linearComponentA[k][lane] = btScalar(0.);
+				batch.m_linearComponentB[k][lane] = btScalar(0.);
+				batch.m_angularComponentA[k][lane] = btScalar(0.);
+				batch.m_angularComponentB[k][lane] = btScalar(0.);
+			}
+			batch.m_rhs[lane] = btScalar(0.);
+			batch.m_cfm[lane] = btScalar(0.);
+			batch.m_jacDiagABInv[lane] = btScalar(0.);
+			batch.m_lowerLimit[lane] = btScalar(0.);
+			batch.m_upperLimit[lane] = btScalar(0.);
+			batch.m_friction[lane] = btScalar(0.);
+			batch.m_appliedImpulse[lane] = btScalar(0.);
+			batch.m_bodyA[lane] = 0;
+			batch.m_bodyB[lane] = 0;
+			batch.m_row[lane] = -1;
+			batch.m_contactLane[lane] = -1;
+		}
+	}
+}
+
+void	btSequentialImpulseConstraintSolver::setupConstraintBatches()
+{
+	BT_PROFILE("setupConstraintBatches");
+
+	m_batchBodies.resize(0);
+	m_batchRigidBodies.resize(0);
+	m_batchBodyLastBatch.resize(0);
+
+	///slot 0: static and kinematic bodies, their velocity changes stay zero
+	btSolverBatchBody& fixedBody = m_batchBodies.expandNonInitializing();
+	fixedBody.m_deltaLinearVelocity.setZero();
+	fixedBody.m_deltaAngularVelocity.setZero();
+	m_batchBodyLastBatch.push_back(-1);
+	m_fixedBody.setCompanionId(0);
+
+	m_contactRowLanes.resize(m_tmpSolverContactConstraintPool.size());
+	buildConstraintBatches(m_tmpSolverContactConstraintPool,false,m_contactBatches);
+	buildConstraintBatches(m_tmpSolverContactFrictionConstraintPool,true,m_frictionBatches);
+}
+
+void	btSequentialImpulseConstraintSolver::writeBatchBodiesToRigidBodies()
+{
+	for (int i=0;i<m_batchRigidBodies.size();i++)
+	{
+		btRigidBody* body = m_batchRigidBodies[i];
+		const btSolverBatchBody& batchBody = m_batchBodies[body->getCompanionId()];
+		body->internalGetDeltaLinearVelocity() = batchBody.m_deltaLinearVelocity;
+		body->internalGetDeltaAngularVelocity() = batchBody.m_deltaAngularVelocity;
+	}
+}
+
+void	btSequentialImpulseConstraintSolver::readBatchBodiesFromRigidBodies()
+{
+	for (int i=0;i<m_batchRigidBodies.size();i++)
+	{
+		btRigidBody* body = m_batchRigidBodies[i];
+		btSolverBatchBody& batchBody = m_batchBodies[body->getCompanionId()];
+		batchBody.m_deltaLinearVelocity = body->internalGetDeltaLinearVelocity();
+		batchBody.m_deltaAngularVelocity = body->internalGetDeltaAngularVelocity();
+	}
+}
+
+void	btSequentialImpulseConstraintSolver::finishConstraintBatches()
+{
+	writeBatchBodiesToRigidBodies();
+	int i;
+	for (i=0;i<m_batchRigidBodies.size();i++)
+	{
+		m_batchRigidBodies[i]->setCompanionId(-1);
+	}
+	m_fixedBody.setCompanionId(-1);
+
+	for (i=0;i<m_contactBatches.size();i++)
+	{
+		const btSolverConstraintBatch& batch = m_contactBatches[i];
+		for (int lane=0;lane<BT_SOLVER_BATCH_WIDTH && batch.m_row[lane]>=0;lane++)
+		{
+			m_tmpSolverContactConstraintPool[batch.m_row[lane]].m_appliedImpulse = batch.m_appliedImpulse[lane];
+		}
+	}
+	for (i=0;i<m_frictionBatches.size();i++)
+	{
+		const btSolverConstraintBatch& batch = m_frictionBatches[i];
+		for (int lane=0;lane<BT_SOLVER_BATCH_WIDTH && batch.m_row[lane]>=0;lane++)
+		{
+			m_tmpSolverContactFrictionConstraintPool[batch.m_row[lane]].m_appliedImpulse = batch.m_appliedImpulse[lane];
+		}
+	}
+}
+
+#ifdef USE_SIMD
+static SIMD_FORCE_INLINE void btGatherBatchBodies(const btSolverBatchBody* bodies,const int* index,__m128* linear,__m128* angular)
+{
+	__m128 v0 = bodies[index[0]].m_deltaLinearVelocity.mVec128;
+	__m128 v1 = bodies[index[1]].m_deltaLinearVelocity.mVec128;
+	__m128 v2 = bodies[index[2]].m_deltaLinearVelocity.mVec128;
+	__m128 v3 = bodies[index[3]].m_deltaLinearVelocity.mVec128;
+	_MM_TRANSPOSE4_PS(v0,v1,v2,v3);
+	linear[0] = v0; linear[1] = v1; linear[2] = v2;
+	v0 = bodies[index[0]].m_deltaAngularVelocity.mVec128;
+	v1 = bodies[index[1]].m_deltaAngularVelocity.mVec128;
+	v2 = bodies[index[2]].m_deltaAngularVelocity.mVec128;
+	v3 = bodies[index[3]].m_deltaAngularVelocity.mVec128;
+	_MM_TRANSPOSE4_PS(v0,v1,v2,v3);
+	angular[0] = v0; angular[1] = v1; angular[2] = v2;
+}
+
+static SIMD_FORCE_INLINE void btScatterBatchBodies(btSolverBatchBody* bodies,const int* index,const __m128* linear,const __m128* angular)
+{
+	__m128 v0 = linear[0], v1 = linear[1], v2 = linear[2], v3 = _mm_setzero_ps();
+	_MM_TRANSPOSE4_PS(v0,v1,v2,v3);
+	bodies[index[0]].m_deltaLinearVelocity.mVec128 = v0;
+	bodies[index[1]].m_deltaLinearVelocity.mVec128 = v1;
+	bodies[index[2]].m_deltaLinearVelocity.mVec128 = v2;
+	bodies[index[3]].m_deltaLinearVelocity.mVec128 = v3;
+	v0 = angular[0]; v1 = angular[1]; v2 = angular[2]; v3 = _mm_setzero_ps();
+	_MM_TRANSPOSE4_PS(v0,v1,v2,v3);
+	bodies[index[0]].m_deltaAngularVelocity.mVec128 = v0;
+	bodies[index[1]].m_deltaAngularVelocity.mVec128 = v1;
+	bodies[index[2]].m_deltaAngularVelocity.mVec128 = v2;
+	bodies[index[3]].m_deltaAngularVelocity.mVec128 = v3;
+}
+
+static SIMD_FORCE_INLINE __m128 btBatchDot3(const btScalar (*a)[BT_SOLVER_BATCH_WIDTH],const __m128* b)
+{
+	return _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_load_ps(a[0]),b[0]),_mm_mul_ps(_mm_load_ps(a[1]),b[1])),_mm_mul_ps(_mm_load_ps(a[2]),b[2]));
+}
+#endif //USE_SIMD
+
+// Projected Gauss Seidel on BT_SOLVER_BATCH_WIDTH independent rows, the same math as resolveSingleConstraintRowGeneric
+void	btSequentialImpulseConstraintSolver::resolveConstraintBatch(btSolverConstraintBatch& b,bool friction)
+{
+	btSolverBatchBody* bodies = &m_batchBodies[0];
+#ifdef USE_SIMD
+	__m128 linearA[3],angularA[3],linearB[3],angularB[3];
+	btGatherBatchBodies(bodies,b.m_bodyA,linearA,angularA);
+	btGatherBatchBodies(bodies,b.m_bodyB,linearB,angularB);
+
+	__m128 appliedImpulse = _mm_load_ps(b.m_appliedImpulse);
+	__m128 lowerLimit,upperLimit;
+	if (friction)
+	{
+		///the friction limit follows the impulse of the contact row; rows without contact impulse are not solved
+		btSimdScalar totalImpulse;
+		for (int lane=0;lane<BT_SOLVER_BATCH_WIDTH;lane++)
+		{
+			int contactLane = b.m_contactLane[lane];
+			totalImpulse.m_floats[lane] = contactLane>=0 ? m_contactBatches[contactLane/BT_SOLVER_BATCH_WIDTH].m_appliedImpulse[contactLane%BT_SOLVER_BATCH_WIDTH] : 0.f;
+		}
+		upperLimit = _mm_mul_ps(_mm_load_ps(b.m_friction),totalImpulse.m_vec128);
+		lowerLimit = _mm_sub_ps(_mm_setzero_ps(),upperLimit);
+		__m128 active = _mm_cmpgt_ps(totalImpulse.m_vec128,_mm_setzero_ps());
+		lowerLimit = _mm_or_ps(_mm_and_ps(active,lowerLimit),_mm_andnot_ps(active,appliedImpulse));
+		upperLimit = _mm_or_ps(_mm_and_ps(active,upperLimit),_mm_andnot_ps(active,appliedImpulse));
+	} else
+	{
+		lowerLimit = _mm_load_ps(b.m_lowerLimit);
+		upperLimit = _mm_load_ps(b.m_upperLimit);
+	}
+
+	__m128 jacDiagABInv = _mm_load_ps(b.m_jacDiagABInv);
+	__m128 deltaVel1Dotn = _mm_add_ps(btBatchDot3(b.m_contactNormal,linearA),btBatchDot3(b.m_relpos1CrossNormal,angularA));
+	__m128 deltaVel2Dotn = _mm_sub_ps(btBatchDot3(b.m_relpos2CrossNormal,angularB),btBatchDot3(b.m_contactNormal,linearB));
+	__m128 deltaImpulse = _mm_sub_ps(_mm_load_ps(b.m_rhs),_mm_mul_ps(appliedImpulse,_mm_load_ps(b.m_cfm)));
+	deltaImpulse = _mm_sub_ps(deltaImpulse,_mm_mul_ps(deltaVel1Dotn,jacDiagABInv));
+	deltaImpulse = _mm_sub_ps(deltaImpulse,_mm_mul_ps(deltaVel2Dotn,jacDiagABInv));
+	__m128 sum = _mm_add_ps(appliedImpulse,deltaImpulse);
+	sum = _mm_min_ps(_mm_max_ps(sum,lowerLimit),upperLimit);
+	deltaImpulse = _mm_sub_ps(sum,appliedImpulse);
+	_mm_store_ps(b.m_appliedImpulse,sum);
+
+	for (int k=0;k<3;k++)
+	{
+		linearA[k] = _mm_add_ps(linearA[k],_mm_mul_ps(_mm_load_ps(b.m_linearComponentA[k]),deltaImpulse));
+		angularA[k] = _mm_add_ps(angularA[k],_mm_mul_ps(_mm_load_ps(b.m_angularComponentA[k]),deltaImpulse));
+		linearB[k] = _mm_sub_ps(linearB[k],_mm_mul_ps(_mm_load_ps(b.m_linearComponentB[k]),deltaImpulse));
+		angularB[k] = _mm_add_ps(angularB[k],_mm_mul_ps(_mm_load_ps(b.m_angularComponentB[k]),deltaImpulse));
+	}
+	btScatterBatchBodies(bodies,b.m_bodyA,linearA,angularA);
+	btScatterBatchBodies(bodies,b.m_bodyB,linearB,angularB);
+#else
+	for (int lane=0;lane<BT_SOLVER_BATCH_WIDTH;lane++)
+	{
+		btScalar lowerLimit = b.m_lowerLimit[lane];
+		btScalar upperLimit = b.m_upperLimit[lane];
+		if (friction)
+		{
+			int contactLane = b.m_contactLane[lane];
+			btScalar totalImpulse = contactLane>=0 ? m_contactBatches[contactLane/BT_SOLVER_BATCH_WIDTH].m_appliedImpulse[contactLane%BT_SOLVER_BATCH_WIDTH] : btScalar(0.);
+			if (totalImpulse<=btScalar(0.))
+				continue;
+			upperLimit = b.m_friction[lane]*totalImpulse;
+			lowerLimit = -upperLimit;
+		}
+		btSolverBatchBody& bodyA = bodies[b.m_bodyA[lane]];
+		btSolverBatchBody& bodyB = bodies[b.m_bodyB[lane]];
+		btVector3 contactNormal(b.m_contactNormal[0][lane],b.m_contactNormal[1][lane],b.m_contactNormal[2][lane]);
+		btVector3 relpos1CrossNormal(b.m_relpos1CrossNormal[0][lane],b.m_relpos1CrossNormal[1][lane],b.m_relpos1CrossNormal[2][lane]);
+		btVector3 relpos2CrossNormal(b.m_relpos2CrossNormal[0][lane],b.m_relpos2CrossNormal[1][lane],b.m_relpos2CrossNormal[2][lane]);
+
+		btScalar deltaImpulse = b.m_rhs[lane]-b.m_appliedImpulse[lane]*b.m_cfm[lane];
+		const btScalar deltaVel1Dotn = contactNormal.dot(bodyA.m_deltaLinearVelocity) + relpos1CrossNormal.dot(bodyA.m_deltaAngularVelocity);
+		const btScalar deltaVel2Dotn = -contactNormal.dot(bodyB.m_deltaLinearVelocity) + relpos2CrossNormal.dot(bodyB.m_deltaAngularVelocity);
+		deltaImpulse -= deltaVel1Dotn*b.m_jacDiagABInv[lane];
+		deltaImpulse -= deltaVel2Dotn*b.m_jacDiagABInv[lane];
+		btScalar sum = b.m_appliedImpulse[lane] + deltaImpulse;
+		sum = btMin(btMax(sum,lowerLimit),upperLimit);
+		deltaImpulse = sum - b.m_appliedImpulse[lane];
+		b.m_appliedImpulse[lane] = sum;
+
+		bodyA.m_deltaLinearVelocity += btVector3(b.m_linearComponentA[0][lane],b.m_linearComponentA[1][lane],b.m_linearComponentA[2][lane])*deltaImpulse;
+		bodyA.m_deltaAngularVelocity += btVector3(b.m_angularComponentA[0][lane],b.m_angularComponentA[1][lane],b.m_angularComponentA[2][lane])*deltaImpulse;
+		bodyB.m_deltaLinearVelocity -= btVector3(b.m_linearComponentB[0][lane],b.m_linearComponentB[1][lane],b.m_linearComponentB[2][lane])*deltaImpulse;
+		bodyB.m_deltaAngularVelocity += btVector3(b.m_angularComponentB[0][lane],b.m_angularComponentB[1][lane],b.m_angularComponentB[2][lane])*deltaImpulse;
+	}
+#endif //USE_SIMD
+}
+
+btScalar btSequentialImpulseConstraintSolver::solveSingleIterationBatched(int iteration, btTypedConstraint** constraints,int numConstraints,const btContactSolverInfo& infoGlobal)
+{
+	int j;
+	int numNonContactPool = m_tmpSolverNonContactConstraintPool.size();
+	bool solveObsolete = numConstraints && iteration< infoGlobal.m_numIterations;
+	if (numNonContactPool || solveObsolete)
+	{
+		///joints work on the rigid bodies, bring them up to date with the compact body array and back
+		writeBatchBodiesToRigidBodies();
+		for (j=0;j<numNonContactPool;j++)
+		{
+			btSolverConstraint& constraint = m_tmpSolverNonContactConstraintPool[m_orderNonContactConstraintPool[j]];
+			if (iteration < constraint.m_overrideNumSolverIterations)
+			{
+				if (infoGlobal.m_solverMode & SOLVER_SIMD)
+					resolveSingleConstraintRowGenericSIMD(*constraint.m_solverBodyA,*constraint.m_solverBodyB,constraint);
+				else
+					resolveSingleConstraintRowGeneric(*constraint.m_solverBodyA,*constraint.m_solverBodyB,constraint);
+			}
+		}
+		if (solveObsolete)
+		{
+			for (j=0;j<numConstraints;j++)
+			{
+				constraints[j]->solveConstraintObsolete(constraints[j]->getRigidBodyA(),constraints[j]->getRigidBodyB(),infoGlobal.m_timeStep);
+			}
+		}
+		readBatchBodiesFromRigidBodies();
+	}
+
+	if (iteration< infoGlobal.m_numIterations)
+	{
+		for (j=0;j<m_contactBatches.size();j++)
+		{
+			resolveConstraintBatch(m_contactBatches[j],false);
+		}
+		for (j=0;j<m_frictionBatches.size();j++)
+		{
+			resolveConstraintBatch(m_frictionBatches[j],true);
+		}
+	}
+	return 0.f;
+}
+
+
 void btSequentialImpulseConstraintSolver::solveGroupCacheFriendlySplitImpulseIterations(btCollisionObject** bodies,int numBodies,btPersistentManifold** manifoldPtr, int numManifolds,btTypedConstraint** constraints,int numConstraints,const btContactSolverInfo& infoGlobal,btIDebugDraw* debugDrawer,btStackAlloc* stackAlloc)
 {
 	int iteration;
@@ -1152,6 +1535,8 @@ void btSequentialImpulseConstraintSolver::solveGroupCacheFriendlySplitImpulseIte
 				}
 			}
 		}
+		btAtomicAdd(&gNumSplitImpulseRecoveries,m_numSplitImpulseRecoveries);
+		m_numSplitImpulseRecoveries = 0;
 	}
 }
 
@@ -1165,10 +1550,21 @@ btScalar btSequentialImpulseConstraintSolver::solveGroupCacheFriendlyIterations(
 
 		int maxIterations = m_maxOverrideNumSolverIterations > infoGlobal.m_numIterations? m_maxOverrideNumSolverIterations : infoGlobal.m_numIterations;
 
-		for ( int iteration = 0 ; iteration< maxIterations ; iteration++)
-		//for ( int iteration = maxIterations-1  ; iteration >= 0;iteration--)
-		{			
-			solveSingleIteration(iteration, bodies ,numBodies,manifoldPtr, numManifolds,constraints,numConstraints,infoGlobal,debugDrawer,stackAlloc);
+		if ((infoGlobal.m_solverMode & SOLVER_BATCHED_SOA) && !(infoGlobal.m_solverMode & SOLVER_RANDMIZE_ORDER) && m_tmpSolverContactConstraintPool.size())
+		{
+			setupConstraintBatches();
+			for ( int iteration = 0 ; iteration< maxIterations ; iteration++)
+			{
+				solveSingleIterationBatched(iteration,constraints,numConstraints,infoGlobal);
+			}
+			finishConstraintBatches();
+		} else
+		{
+			for ( int iteration = 0 ; iteration< maxIterations ; iteration++)
+			//for ( int iteration = maxIterations-1  ; iteration >= 0;iteration--)
+			{			
+				solveSingleIteration(iteration, bodies ,numBodies,manifoldPtr, numManifolds,constraints,numConstraints,infoGlobal,debugDrawer,stackAlloc);
+			}
 		}
 		
 	}
@@ -1263,7 +1659,9 @@ void	btSequentialImpulseConstraintSolver::reset()
 btRigidBody& btSequentialImpulseConstraintSolver::getFixedBody()
 {
 	static btRigidBody s_fixed(0, 0,0);
-	s_fixed.setMassProps(btScalar(0.),btVector3(btScalar(0.),btScalar(0.),btScalar(0.)));
+	///only write when needed: islands solved on several threads share this body
+	if (s_fixed.getInvMass() != btScalar(0.))
+		s_fixed.setMassProps(btScalar(0.),btVector3(btScalar(0.),btScalar(0.),btScalar(0.)));
 	return s_fixed;
 }
 
@@ -21,6 +21,7 @@ class btIDebugDraw;
 #include "btContactConstraint.h"
 #include "btSolverBody.h"
 #include "btSolverConstraint.h"
+#include "btSolverConstraintBatch.h"
 #include "btTypedConstraint.h"
 #include "BulletCollision/NarrowPhaseCollision/btManifoldPoint.h"
 
@@ -38,6 +39,35 @@ protected:
 	btAlignedObjectArray<btTypedConstraint::btConstraintInfo1> m_tmpConstraintSizesPool;
 	int							m_maxOverrideNumSolverIterations;
 
+	///static and kinematic bodies can be shared by islands that are solved on different threads.
+	///Solver rows reference this body instead, so the iterations only write to bodies owned by the island
+	btRigidBody					m_fixedBody;
+
+	btRigidBody*	getSolverRigidBody(btRigidBody* body)
+	{
+		return (body && !body->isStaticOrKinematicObject()) ? body : &m_fixedBody;
+	}
+
+	///SOLVER_BATCHED_SOA: the contact and friction rows are packed into batches that gather and scatter the velocity
+	///changes of a compact body array. The companion id of a rigid body is its index in m_batchBodies while solving.
+	btAlignedObjectArray<btSolverBatchBody>	m_batchBodies;
+	btAlignedObjectArray<btRigidBody*>		m_batchRigidBodies;
+	btConstraintBatchArray		m_contactBatches;
+	btConstraintBatchArray		m_frictionBatches;
+	btAlignedObjectArray<int>	m_contactRowLanes;
+	btAlignedObjectArray<int>	m_batchBodyLastBatch;
+	btAlignedObjectArray<int>	m_batchNumRows;
+	btAlignedObjectArray<int>	m_batchNextFree;
+
+	int		getBatchBodyIndex(btRigidBody* body);
+	int		findFreeBatch(int batchIndex,btConstraintBatchArray& batches);
+	void	buildConstraintBatches(btConstraintArray& rows,bool friction,btConstraintBatchArray& batches);
+	void	setupConstraintBatches();
+	void	finishConstraintBatches();
+	void	writeBatchBodiesToRigidBodies();
+	void	readBatchBodiesFromRigidBodies();
+	void	resolveConstraintBatch(btSolverConstraintBatch& batch,bool friction);
+
 	void setupFrictionConstraint(	btSolverConstraint& solverConstraint, const btVector3& normalAxis,btRigidBody* solverBodyA,btRigidBody* solverBodyIdB,
 									btManifoldPoint& cp,const btVector3& rel_pos1,const btVector3& rel_pos2,
 									btCollisionObject* colObj0,btCollisionObject* colObj1, btScalar relaxation, 
@@ -55,6 +85,10 @@ protected:
 	///m_btSeed2 is used for re-arranging the constraint rows. improves convergence/quality of friction
 	unsigned long	m_btSeed2;
 
+	///split impulse recoveries of the running solveGroup, added to gNumSplitImpulseRecoveries once per group
+	///because the solvers of several threads run at the same time
+	int		m_numSplitImpulseRecoveries;
+
 //	void	initSolverBody(btSolverBody* solverBody, btCollisionObject* collisionObject);
 	btScalar restitutionCurve(btScalar rel_vel, btScalar restitution);
 
@@ -88,6 +122,7 @@ protected:
 	virtual void solveGroupCacheFriendlySplitImpulseIterations(btCollisionObject** bodies,int numBodies,btPersistentManifold** manifoldPtr, int numManifolds,btTypedConstraint** constraints,int numConstraints,const btContactSolverInfo& infoGlobal,btIDebugDraw* debugDrawer,btStackAlloc* stackAlloc);
 	virtual btScalar solveGroupCacheFriendlyFinish(btCollisionObject** bodies ,int numBodies,btPersistentManifold** manifoldPtr, int numManifolds,btTypedConstraint** constraints,int numConstraints,const btContactSolverInfo& infoGlobal,btIDebugDraw* debugDrawer,btStackAlloc* stackAlloc);
 	btScalar solveSingleIteration(int iteration, btCollisionObject** bodies ,int numBodies,btPersistentManifold** manifoldPtr, int numManifolds,btTypedConstraint** constraints,int numConstraints,const btContactSolverInfo& infoGlobal,btIDebugDraw* debugDrawer,btStackAlloc* stackAlloc);
+	btScalar solveSingleIterationBatched(int iteration, btTypedConstraint** constraints,int numConstraints,const btContactSolverInfo& infoGlobal);
 
 	virtual btScalar solveGroupCacheFriendlySetup(btCollisionObject** bodies,int numBodies,btPersistentManifold** manifoldPtr, int numManifolds,btTypedConstraint** constraints,int numConstraints,const btContactSolverInfo& infoGlobal,btIDebugDraw* debugDrawer,btStackAlloc* stackAlloc);
 	virtual btScalar solveGroupCacheFriendlyIterations(btCollisionObject** bodies,int numBodies,btPersistentManifold** manifoldPtr, int numManifolds,btTypedConstraint** constraints,int numConstraints,const btContactSolverInfo& infoGlobal,btIDebugDraw* debugDrawer,btStackAlloc* stackAlloc);
@@ -105,6 +140,15 @@ public:
 	
 	///clear internal cached data and reset random seed
 	virtual	void	reset();
+
+	virtual	btConstraintSolverType	getSolverType() const
+	{
+		return BT_SEQUENTIAL_IMPULSE_SOLVER;
+	}
+
+	///returns a plain btSequentialImpulseConstraintSolver. A subclass that overrides solveGroup or the solveGroupCacheFriendly
+	///methods must override this too, returning an instance of its own class, or 0 to have its islands solved serially.
+	virtual	btConstraintSolver*	createThreadSolver();
 	
 	unsigned long btRand2();
 
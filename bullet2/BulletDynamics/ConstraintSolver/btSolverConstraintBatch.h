@@ -0,0 +1,71 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2009 Erwin Coumans  http://bulletphysics.org
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef BT_SOLVER_CONSTRAINT_BATCH_H
+#define BT_SOLVER_CONSTRAINT_BATCH_H
+
+#include "LinearMath/btVector3.h"
+#include "LinearMath/btAlignedAllocator.h"
+#include "LinearMath/btAlignedObjectArray.h"
+
+///number of solver rows in a btSolverConstraintBatch, one per SSE lane
+#define BT_SOLVER_BATCH_WIDTH 4
+
+///velocity changes of a body, in the compact body array used by SOLVER_BATCHED_SOA.
+///Slot 0 is the fixed body: static and kinematic bodies, and unused lanes, map to it.
+ATTRIBUTE_ALIGNED16 (struct)	btSolverBatchBody
+{
+	BT_DECLARE_ALIGNED_ALLOCATOR();
+
+	btVector3		m_deltaLinearVelocity;
+	btVector3		m_deltaAngularVelocity;
+};
+
+///BT_SOLVER_BATCH_WIDTH contact or friction rows of btSolverConstraint, stored as a structure of arrays.
+///The rows of a batch never share a dynamic body, so they are solved side by side and their velocity changes
+///are written back to the compact body array without conflicts. Unused lanes have zero coefficients.
+ATTRIBUTE_ALIGNED16 (struct)	btSolverConstraintBatch
+{
+	BT_DECLARE_ALIGNED_ALLOCATOR();
+
+	btScalar	m_contactNormal[3][BT_SOLVER_BATCH_WIDTH];
+	btScalar	m_relpos1CrossNormal[3][BT_SOLVER_BATCH_WIDTH];
+	btScalar	m_relpos2CrossNormal[3][BT_SOLVER_BATCH_WIDTH];
+	///contact normal times the inverse mass (including the linear factor) of body A and B
+	btScalar	m_linearComponentA[3][BT_SOLVER_BATCH_WIDTH];
+	btScalar	m_linearComponentB[3][BT_SOLVER_BATCH_WIDTH];
+	btScalar	m_angularComponentA[3][BT_SOLVER_BATCH_WIDTH];
+	btScalar	m_angularComponentB[3][BT_SOLVER_BATCH_WIDTH];
+
+	btScalar	m_rhs[BT_SOLVER_BATCH_WIDTH];
+	btScalar	m_cfm[BT_SOLVER_BATCH_WIDTH];
+	btScalar	m_jacDiagABInv[BT_SOLVER_BATCH_WIDTH];
+	btScalar	m_lowerLimit[BT_SOLVER_BATCH_WIDTH];
+	btScalar	m_upperLimit[BT_SOLVER_BATCH_WIDTH];
+	btScalar	m_friction[BT_SOLVER_BATCH_WIDTH];
+	btScalar	m_appliedImpulse[BT_SOLVER_BATCH_WIDTH];
+
+	///index into the compact body array
+	int			m_bodyA[BT_SOLVER_BATCH_WIDTH];
+	int			m_bodyB[BT_SOLVER_BATCH_WIDTH];
+	///index of the row in its solver constraint pool, -1 for unused lanes
+	int			m_row[BT_SOLVER_BATCH_WIDTH];
+	///friction rows: lane (batch * BT_SOLVER_BATCH_WIDTH + lane) of the contact row that limits the friction impulse
+	int			m_contactLane[BT_SOLVER_BATCH_WIDTH];
+};
+
+typedef btAlignedObjectArray<btSolverConstraintBatch>	btConstraintBatchArray;
+
+#endif //BT_SOLVER_CONSTRAINT_BATCH_H
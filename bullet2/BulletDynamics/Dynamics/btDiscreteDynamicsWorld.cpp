@@ -47,6 +47,7 @@ subject to the following restrictions:
 #include "LinearMath/btMotionState.h"
 
 #include "LinearMath/btSerializer.h"
+#include "LinearMath/btThreads.h"
 
 #if 0
 btAlignedObjectArray<btVector3> debugContacts;
@@ -94,6 +95,53 @@ struct InplaceSolverIslandCallback : public btSimulationIslandManager::IslandCal
 	btAlignedObjectArray<btPersistentManifold*> m_manifolds;
 	btAlignedObjectArray<btTypedConstraint*> m_constraints;
 
+	///parallel island solving: one solver per scheduler thread, m_threadSolvers[0] is m_solver
+	btITaskScheduler*		m_taskScheduler;
+	btAlignedObjectArray<btConstraintSolver*> m_threadSolvers;
+	bool					m_parallel;
+
+	///a batch of islands, stored as ranges of m_bodies, m_manifolds and m_constraints
+	struct IslandBatch
+	{
+		int	m_bodyStart;
+		int	m_numBodies;
+		int	m_manifoldStart;
+		int	m_numManifolds;
+		int	m_constraintStart;
+		int	m_numConstraints;
+	};
+	btAlignedObjectArray<IslandBatch>	m_batches;
+	btAlignedObjectArray<int>			m_batchOrder;
+	IslandBatch							m_openBatch;
+
+	///largest batches first, ties keep the island order so the schedule is reproducible
+	struct BatchSortPredicate
+	{
+		const IslandBatch* m_batches;
+		bool operator() ( int lhs, int rhs ) const
+		{
+			int lhsCost = m_batches[lhs].m_numManifolds + m_batches[lhs].m_numConstraints;
+			int rhsCost = m_batches[rhs].m_numManifolds + m_batches[rhs].m_numConstraints;
+			if (lhsCost != rhsCost)
+				return lhsCost > rhsCost;
+			return lhs < rhs;
+		}
+	};
+
+	struct SolveBatchesLoop : public btIParallelForBody
+	{
+		InplaceSolverIslandCallback* m_callback;
+
+		void forLoop(int iBegin, int iEnd) const
+		{
+			BT_PROFILE("solveIslandBatches");
+			for (int i=iBegin;i<iEnd;i++)
+			{
+				m_callback->solveBatch(m_callback->m_batches[m_callback->m_batchOrder[i]],btGetCurrentThreadIndex());
+			}
+		}
+	};
+
 
 	InplaceSolverIslandCallback(
 		btConstraintSolver*	solver,
@@ -105,7 +153,9 @@ struct InplaceSolverIslandCallback : public btSimulationIslandManager::IslandCal
 		m_numConstraints(0),
 		m_debugDrawer(NULL),
 		m_stackAlloc(stackAlloc),
-		m_dispatcher(dispatcher)
+		m_dispatcher(dispatcher),
+		m_taskScheduler(NULL),
+		m_parallel(false)
 	{
 
 	}
@@ -127,6 +177,12 @@ struct InplaceSolverIslandCallback : public btSimulationIslandManager::IslandCal
 		m_bodies.resize (0);
 		m_manifolds.resize (0);
 		m_constraints.resize (0);
+
+		m_parallel = m_taskScheduler && m_taskScheduler->getNumThreads()>1 && m_threadSolvers.size()>=m_taskScheduler->getNumThreads();
+		m_batches.resize(0);
+		m_openBatch.m_bodyStart = 0;
+		m_openBatch.m_manifoldStart = 0;
+		m_openBatch.m_constraintStart = 0;
 	}
 
 	
@@ -164,6 +220,22 @@ struct InplaceSolverIslandCallback : public btSimulationIslandManager::IslandCal
 				}
 			}
 
+			if (m_parallel)
+			{
+				///islands are only collected here, processConstraints solves them on all threads.
+				///they are batched exactly like the serial path below, so each island sees the same solver calls
+				for (i=0;i<numBodies;i++)
+					m_bodies.push_back(bodies[i]);
+				for (i=0;i<numManifolds;i++)
+					m_manifolds.push_back(manifolds[i]);
+				for (i=0;i<numCurConstraints;i++)
+					m_constraints.push_back(startConstraint[i]);
+				int batchSize = m_constraints.size()-m_openBatch.m_constraintStart + m_manifolds.size()-m_openBatch.m_manifoldStart;
+				if (m_solverInfo->m_minimumSolverBatchSize<=1 || batchSize>m_solverInfo->m_minimumSolverBatchSize)
+				{
+					closeBatch();
+				}
+			} else
 			if (m_solverInfo->m_minimumSolverBatchSize<=1)
 			{
 				///only call solveGroup if there is some work: avoid virtual function call, its overhead can be excessive
@@ -190,8 +262,60 @@ struct InplaceSolverIslandCallback : public btSimulationIslandManager::IslandCal
 			}
 		}
 	}
+
+	void	closeBatch()
+	{
+		IslandBatch& batch = m_openBatch;
+		batch.m_numBodies = m_bodies.size()-batch.m_bodyStart;
+		batch.m_numManifolds = m_manifolds.size()-batch.m_manifoldStart;
+		batch.m_numConstraints = m_constraints.size()-batch.m_constraintStart;
+		if (batch.m_numManifolds + batch.m_numConstraints>0)
+		{
+			m_batches.push_back(batch);
+		}
+		batch.m_bodyStart = m_bodies.size();
+		batch.m_manifoldStart = m_manifolds.size();
+		batch.m_constraintStart = m_constraints.size();
+	}
+
+	void	solveBatch(const IslandBatch& batch, unsigned int threadIndex)
+	{
+		btCollisionObject** bodies = batch.m_numBodies? &m_bodies[batch.m_bodyStart]:0;
+		btPersistentManifold** manifold = batch.m_numManifolds? &m_manifolds[batch.m_manifoldStart]:0;
+		btTypedConstraint** constraints = batch.m_numConstraints? &m_constraints[batch.m_constraintStart]:0;
+
+		m_threadSolvers[threadIndex]->solveGroup( bodies,batch.m_numBodies,manifold,batch.m_numManifolds,constraints,batch.m_numConstraints,*m_solverInfo,m_debugDrawer,m_stackAlloc,m_dispatcher);
+	}
+
+	void	processBatches()
+	{
+		closeBatch();
+
+		int numBatches = m_batches.size();
+		m_batchOrder.resize(numBatches);
+		for (int i=0;i<numBatches;i++)
+			m_batchOrder[i] = i;
+		if (numBatches>1)
+		{
+			BatchSortPredicate predicate;
+			predicate.m_batches = &m_batches[0];
+			m_batchOrder.quickSort(predicate);
+		}
+
+		///batch i of the sorted list always runs on thread i % numThreads, so a fixed thread count gives reproducible results
+		SolveBatchesLoop loop;
+		loop.m_callback = this;
+		m_taskScheduler->parallelFor(0,numBatches,1,loop);
+
+		m_batches.resize(0);
+	}
+
 	void	processConstraints()
 	{
+		if (m_parallel)
+		{
+			processBatches();
+		} else
 		if (m_manifolds.size() + m_constraints.size()>0)
 		{
 
@@ -219,7 +343,9 @@ m_localTime(0),
 m_synchronizeAllMotionStates(false),
 m_profileTimings(0),
 m_sortedConstraints	(),
-m_solverIslandCallback ( NULL )
+m_solverIslandCallback ( NULL ),
+m_taskScheduler(NULL),
+m_ownsTaskScheduler(false)
 {
 	if (!m_constraintSolver)
 	{
@@ -240,7 +366,7 @@ m_solverIslandCallback ( NULL )
 
 	{
 		void* mem = btAlignedAlloc(sizeof(InplaceSolverIslandCallback),16);
-		m_solverIslandCallback = new (mem) InplaceSolverIslandCallback (constraintSolver, m_stackAlloc, dispatcher);
+		m_solverIslandCallback = new (mem) InplaceSolverIslandCallback (m_constraintSolver, m_stackAlloc, dispatcher);
 	}
 }
 
@@ -253,6 +379,7 @@ btDiscreteDynamicsWorld::~btDiscreteDynamicsWorld()
 		m_islandManager->~btSimulationIslandManager();
 		btAlignedFree( m_islandManager);
 	}
+	setTaskScheduler(0);
 	if (m_solverIslandCallback)
 	{
 		m_solverIslandCallback->~InplaceSolverIslandCallback();
@@ -1193,6 +1320,88 @@ void	btDiscreteDynamicsWorld::setConstraintSolver(btConstraintSolver* solver)
 	}
 	m_ownsConstraintSolver = false;
 	m_constraintSolver = solver;
+	m_solverIslandCallback->m_solver = solver;
+	updateThreadConstraintSolvers();
+}
+
+void	btDiscreteDynamicsWorld::setNumTasks(int numTasks)
+{
+	if (numTasks<=1)
+	{
+		if (m_ownsTaskScheduler)
+		{
+			setTaskScheduler(0);
+		} else if (m_taskScheduler)
+		{
+			m_taskScheduler->setNumThreads(1);
+		}
+		return;
+	}
+
+	if (!m_taskScheduler || (m_ownsTaskScheduler && m_taskScheduler->getMaxNumThreads()<numTasks))
+	{
+		btITaskScheduler* scheduler = btCreateDefaultTaskScheduler(numTasks);
+		if (!scheduler)
+		{
+			//no threads on this platform, keep solving serially
+			return;
+		}
+		setTaskScheduler(scheduler);
+		m_ownsTaskScheduler = true;
+	}
+	m_taskScheduler->setNumThreads(numTasks);
+}
+
+int		btDiscreteDynamicsWorld::getNumTasks() const
+{
+	return m_taskScheduler ? m_taskScheduler->getNumThreads() : 1;
+}
+
+void	btDiscreteDynamicsWorld::setTaskScheduler(btITaskScheduler* scheduler)
+{
+	if (m_taskScheduler == scheduler)
+		return;
+	if (m_ownsTaskScheduler)
+	{
+		btDeleteTaskScheduler(m_taskScheduler);
+	}
+	m_taskScheduler = scheduler;
+	m_ownsTaskScheduler = false;
+	m_solverIslandCallback->m_taskScheduler = scheduler;
+	updateThreadConstraintSolvers();
+}
+
+void	btDiscreteDynamicsWorld::updateThreadConstraintSolvers()
+{
+	int i;
+	for (i=0;i<m_threadConstraintSolvers.size();i++)
+	{
+		m_threadConstraintSolvers[i]->~btConstraintSolver();
+		btAlignedFree(m_threadConstraintSolvers[i]);
+	}
+	m_threadConstraintSolvers.resize(0);
+	m_solverIslandCallback->m_threadSolvers.resize(0);
+
+	///solvers keep per-call scratch state, so each thread needs its own instance.
+	///Leaving m_threadSolvers empty makes the island callback solve serially
+	if (!m_taskScheduler || !m_constraintSolver)
+		return;
+
+	for (i=1;i<m_taskScheduler->getMaxNumThreads();i++)
+	{
+		btConstraintSolver* solver = m_constraintSolver->createThreadSolver();
+		if (!solver)
+			break;
+		m_threadConstraintSolvers.push_back(solver);
+	}
+	if (m_threadConstraintSolvers.size() < m_taskScheduler->getMaxNumThreads()-1)
+		return;
+
+	m_solverIslandCallback->m_threadSolvers.push_back(m_constraintSolver);
+	for (i=0;i<m_threadConstraintSolvers.size();i++)
+	{
+		m_solverIslandCallback->m_threadSolvers.push_back(m_threadConstraintSolvers[i]);
+	}
 }
 
 btConstraintSolver* btDiscreteDynamicsWorld::getConstraintSolver()
@@ -27,6 +27,7 @@ class btTypedConstraint;
 class btActionInterface;
 
 class btIDebugDraw;
+class btITaskScheduler;
 struct InplaceSolverIslandCallback;
 
 #include "LinearMath/btAlignedObjectArray.h"
@@ -63,6 +64,14 @@ protected:
 	
 	int	m_profileTimings;
 
+	///islands are solved in parallel on this scheduler when it runs more than one thread
+	btITaskScheduler*	m_taskScheduler;
+	bool	m_ownsTaskScheduler;
+	///one solver per scheduler thread except thread 0, which uses m_constraintSolver
+	btAlignedObjectArray<btConstraintSolver*>	m_threadConstraintSolvers;
+
+	void	updateThreadConstraintSolvers();
+
 	virtual void	predictUnconstraintMotion(btScalar timeStep);
 	
 	virtual void	integrateTransforms(btScalar timeStep);
@@ -166,9 +175,24 @@ public:
 	///apply gravity, call this once per timestep
 	virtual void	applyGravity();
 
-	virtual void	setNumTasks(int numTasks)
+	///solve independent simulation islands on numTasks threads, 1 (the default) solves them on the calling thread.
+	///Creates a thread pool owned by the world unless a scheduler was passed to setTaskScheduler.
+	///Only solvers that return a solver per thread from btConstraintSolver::createThreadSolver, like btSequentialImpulseConstraintSolver,
+	///are run in parallel. Other solvers keep solving serially.
+	virtual void	setNumTasks(int numTasks);
+
+	int		getNumTasks() const;
+
+	///share a scheduler with other parts of the application. The world does not delete it, pass 0 to go back to serial solving.
+	///Deletes the scheduler created by setNumTasks, derived worlds that pass the scheduler on must override this.
+	///Islands are solved serially when the constraint solver returns 0 from createThreadSolver, which is the default for
+	///btConstraintSolver subclasses. Subclasses of btSequentialImpulseConstraintSolver that change how groups are solved
+	///must override createThreadSolver as well.
+	virtual void	setTaskScheduler(btITaskScheduler* scheduler);
+
+	btITaskScheduler*	getTaskScheduler()
 	{
-        (void) numTasks;
+		return m_taskScheduler;
 	}
 
 	///obsolete, use updateActions instead
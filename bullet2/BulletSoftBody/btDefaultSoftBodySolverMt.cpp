@@ -0,0 +1,638 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2009 Erwin Coumans  http://bulletphysics.org
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include "btDefaultSoftBodySolverMt.h"
+#include "btSoftBodyInternals.h"
+#include "BulletCollision/BroadphaseCollision/btBroadphaseInterface.h"
+#include "BulletDynamics/Dynamics/btRigidBody.h"
+#include "LinearMath/btQuickprof.h"
+#include <new>
+
+///colors of the link coloring, a node can be in at most this many batches. Links of nodes with more colors go to a serial batch.
+#define BT_SOFT_BODY_MAX_LINK_COLORS 64
+
+
+struct btDefaultSoftBodySolverMt::PredictMotionLoop : public btIParallelForBody
+{
+	btSoftBody**	m_bodies;
+	btScalar		m_timeStep;
+
+	void forLoop(int iBegin, int iEnd) const
+	{
+		for (int i=iBegin;i<iEnd;i++)
+		{
+			m_bodies[i]->predictMotion(m_timeStep);
+		}
+	}
+};
+
+struct btDefaultSoftBodySolverMt::UpdateSoftBodiesLoop : public btIParallelForBody
+{
+	btSoftBody**	m_bodies;
+
+	void forLoop(int iBegin, int iEnd) const
+	{
+		for (int i=iBegin;i<iEnd;i++)
+		{
+			m_bodies[i]->integrateMotion();
+		}
+	}
+};
+
+struct btDefaultSoftBodySolverMt::SolveBodiesLoop : public btIParallelForBody
+{
+	btSoftBody**	m_bodies;
+
+	void forLoop(int iBegin, int iEnd) const
+	{
+		for (int i=iBegin;i<iEnd;i++)
+		{
+			m_bodies[i]->solveConstraints();
+		}
+	}
+};
+
+///the link loops of btSoftBody::solveConstraints, PSolve_Links and VSolve_Links over a range of links in batch order
+struct btDefaultSoftBodySolverMt::LinkLoop : public btIParallelForBody
+{
+	enum Mode
+	{
+		PREPARE,
+		POSITIONS,
+		VELOCITIES
+	};
+
+	btSoftBody::Link*	m_links;
+	const int*			m_linkOrder;
+	PackedLink*			m_packedLinks;
+	Mode				m_mode;
+	btScalar			m_kst;
+
+	void forLoop(int iBegin, int iEnd) const
+	{
+		switch (m_mode)
+		{
+		case PREPARE:
+			for (int i=iBegin;i<iEnd;i++)
+			{
+				btSoftBody::Link&	l=m_links[m_linkOrder[i]];
+				PackedLink&			p=m_packedLinks[i];
+				l.m_c3		=	l.m_n[1]->m_q-l.m_n[0]->m_q;
+				l.m_c2		=	1/(l.m_c3.length2()*l.m_c0);
+				p.m_c3		=	l.m_c3;
+				p.m_n[0]	=	l.m_n[0];
+				p.m_n[1]	=	l.m_n[1];
+				p.m_c0		=	l.m_c0;
+				p.m_c1		=	l.m_c1;
+				p.m_c2		=	l.m_c2;
+			}
+			break;
+		case POSITIONS:
+			for (int i=iBegin;i<iEnd;i++)
+			{
+				const PackedLink&	l=m_packedLinks[i];
+				if(l.m_c0>0)
+				{
+					btSoftBody::Node&	a=*l.m_n[0];
+					btSoftBody::Node&	b=*l.m_n[1];
+					const btVector3	del=b.m_x-a.m_x;
+					const btScalar	len=del.length2();
+					if (l.m_c1+len > SIMD_EPSILON)
+					{
+						const btScalar	k=((l.m_c1-len)/(l.m_c0*(l.m_c1+len)))*m_kst;
+						a.m_x-=del*(k*a.m_im);
+						b.m_x+=del*(k*b.m_im);
+					}
+				}
+			}
+			break;
+		case VELOCITIES:
+			for (int i=iBegin;i<iEnd;i++)
+			{
+				const PackedLink&	l=m_packedLinks[i];
+				btSoftBody::Node*const*	n=l.m_n;
+				const btScalar	j=-btDot(l.m_c3,n[0]->m_v-n[1]->m_v)*l.m_c2*m_kst;
+				n[0]->m_v+=	l.m_c3*(j*n[0]->m_im);
+				n[1]->m_v-=	l.m_c3*(j*n[1]->m_im);
+			}
+			break;
+		}
+	}
+};
+
+///the node loops of btSoftBody::solveConstraints
+struct btDefaultSoftBodySolverMt::NodeLoop : public btIParallelForBody
+{
+	enum Mode
+	{
+		INTEGRATE_VELOCITIES,
+		UPDATE_VELOCITIES,
+		STORE_POSITIONS,
+		CORRECT_DRIFT
+	};
+
+	btSoftBody::Node*	m_nodes;
+	Mode				m_mode;
+	btScalar			m_scale;
+
+	void forLoop(int iBegin, int iEnd) const
+	{
+		switch (m_mode)
+		{
+		case INTEGRATE_VELOCITIES:
+			for (int i=iBegin;i<iEnd;i++)
+			{
+				btSoftBody::Node&	n=m_nodes[i];
+				n.m_x	=	n.m_q+n.m_v*m_scale;
+			}
+			break;
+		case UPDATE_VELOCITIES:
+			for (int i=iBegin;i<iEnd;i++)
+			{
+				btSoftBody::Node&	n=m_nodes[i];
+				n.m_v	=	(n.m_x-n.m_q)*m_scale;
+				n.m_f	=	btVector3(0,0,0);
+			}
+			break;
+		case STORE_POSITIONS:
+			for (int i=iBegin;i<iEnd;i++)
+			{
+				btSoftBody::Node&	n=m_nodes[i];
+				n.m_q	=	n.m_x;
+			}
+			break;
+		case CORRECT_DRIFT:
+			for (int i=iBegin;i<iEnd;i++)
+			{
+				btSoftBody::Node&	n=m_nodes[i];
+				n.m_v	+=	(n.m_x-n.m_q)*m_scale;
+			}
+			break;
+		}
+	}
+};
+
+
+btDefaultSoftBodySolverMt::btDefaultSoftBodySolverMt(int minBatchedLinks,int grainSize)
+:m_taskScheduler(0),
+m_minBatchedLinks(minBatchedLinks),
+m_grainSize(grainSize)
+{
+}
+
+btDefaultSoftBodySolverMt::~btDefaultSoftBodySolverMt()
+{
+	for (int i=0;i<m_linkBatches.size();i++)
+	{
+		LinkBatches* batches = *m_linkBatches.getAtIndex(i);
+		batches->~LinkBatches();
+		btAlignedFree(batches);
+	}
+}
+
+btITaskScheduler*	btDefaultSoftBodySolverMt::getScheduler() const
+{
+	return m_taskScheduler ? m_taskScheduler : btGetSequentialTaskScheduler();
+}
+
+static void	parallelFor(btITaskScheduler* scheduler,int iBegin,int iEnd,int grainSize,const btIParallelForBody& body)
+{
+	if (iEnd-iBegin<=grainSize || scheduler->getNumThreads()<=1)
+	{
+		body.forLoop(iBegin,iEnd);
+	} else
+	{
+		scheduler->parallelFor(iBegin,iEnd,grainSize,body);
+	}
+}
+
+void	btDefaultSoftBodySolverMt::optimize( btAlignedObjectArray< btSoftBody * > &softBodies,bool forceUpdate )
+{
+	btDefaultSoftBodySolver::optimize(softBodies,forceUpdate);
+
+	//forget the link batches of removed bodies
+	btAlignedObjectArray<const btSoftBody*> removed;
+	for (int i=0;i<m_linkBatches.size();i++)
+	{
+		const btSoftBody* psb = (*m_linkBatches.getAtIndex(i))->m_body;
+		if (m_softBodySet.findLinearSearch((btSoftBody*)psb)==m_softBodySet.size())
+		{
+			removed.push_back(psb);
+		}
+	}
+	for (int i=0;i<removed.size();i++)
+	{
+		invalidateLinkBatches(removed[i]);
+	}
+}
+
+void	btDefaultSoftBodySolverMt::predictMotion( float timeStep )
+{
+	m_activeBodies.resize(0);
+	m_broadphaseHandles.resize(0);
+	for (int i=0;i<m_softBodySet.size();i++)
+	{
+		btSoftBody* psb = m_softBodySet[i];
+		if (psb->isActive())
+		{
+			//btSoftBody::updateBounds moves the broadphase proxy, which is not thread safe: detach it while predicting
+			m_activeBodies.push_back(psb);
+			m_broadphaseHandles.push_back(psb->getBroadphaseHandle());
+			psb->setBroadphaseHandle(0);
+		}
+	}
+
+	if (m_activeBodies.size())
+	{
+		PredictMotionLoop loop;
+		loop.m_bodies = &m_activeBodies[0];
+		loop.m_timeStep = timeStep;
+		parallelFor(getScheduler(),0,m_activeBodies.size(),1,loop);
+	}
+
+	//update the proxies in body order, as btDefaultSoftBodySolver does
+	for (int i=0;i<m_activeBodies.size();i++)
+	{
+		btSoftBody* psb = m_activeBodies[i];
+		btBroadphaseProxy* handle = m_broadphaseHandles[i];
+		psb->setBroadphaseHandle(handle);
+		if (handle && psb->m_ndbvt.m_root)
+		{
+			psb->m_worldInfo->m_broadphase->setAabb(handle,psb->m_bounds[0],psb->m_bounds[1],psb->m_worldInfo->m_dispatcher);
+		}
+	}
+}
+
+void	btDefaultSoftBodySolverMt::updateSoftBodies( )
+{
+	m_activeBodies.resize(0);
+	for (int i=0;i<m_softBodySet.size();i++)
+	{
+		if (m_softBodySet[i]->isActive())
+		{
+			m_activeBodies.push_back(m_softBodySet[i]);
+		}
+	}
+	if (m_activeBodies.size())
+	{
+		UpdateSoftBodiesLoop loop;
+		loop.m_bodies = &m_activeBodies[0];
+		parallelFor(getScheduler(),0,m_activeBodies.size(),1,loop);
+	}
+}
+
+static bool	ownsNode(const btSoftBody* psb,const btSoftBody::Node* node)
+{
+	return psb->m_nodes.size() && node>=&psb->m_nodes[0] && node<=&psb->m_nodes[psb->m_nodes.size()-1];
+}
+
+bool	btDefaultSoftBodySolverMt::isIndependent(const btSoftBody* psb)
+{
+	if (psb->m_anchors.size())
+	{
+		return false;
+	}
+	for (int i=0;i<psb->m_rcontacts.size();i++)
+	{
+		const btRigidBody* body = btRigidBody::upcast(psb->m_rcontacts[i].m_cti.m_colObj);
+		if (body && body->getInvMass()!=btScalar(0.))
+		{
+			return false;
+		}
+	}
+	for (int i=0;i<psb->m_scontacts.size();i++)
+	{
+		if (!ownsNode(psb,psb->m_scontacts[i].m_face->m_n[0]))
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+void	btDefaultSoftBodySolverMt::solveConstraints( float solverdt )
+{
+	(void)solverdt;
+	m_activeBodies.resize(0);
+	for (int i=0;i<m_softBodySet.size();i++)
+	{
+		if (m_softBodySet[i]->isActive())
+		{
+			m_activeBodies.push_back(m_softBodySet[i]);
+		}
+	}
+
+	//the faces of a body in contact with another body are solved by the other body, so neither of them is independent
+	btAlignedObjectArray<bool> serial;
+	serial.resize(m_activeBodies.size(),false);
+	for (int i=0;i<m_activeBodies.size();i++)
+	{
+		const btSoftBody* psb = m_activeBodies[i];
+		if (isBatched(psb) || !isIndependent(psb))
+		{
+			serial[i] = true;
+		}
+		for (int j=0;j<psb->m_scontacts.size();j++)
+		{
+			const btSoftBody::Node* node = psb->m_scontacts[j].m_face->m_n[0];
+			if (!ownsNode(psb,node))
+			{
+				for (int k=0;k<m_activeBodies.size();k++)
+				{
+					if (ownsNode(m_activeBodies[k],node))
+					{
+						serial[k] = true;
+						break;
+					}
+				}
+			}
+		}
+	}
+
+	m_parallelBodies.resize(0);
+	for (int i=0;i<m_activeBodies.size();i++)
+	{
+		if (!serial[i])
+		{
+			m_parallelBodies.push_back(m_activeBodies[i]);
+		}
+	}
+	if (m_parallelBodies.size())
+	{
+		SolveBodiesLoop loop;
+		loop.m_bodies = &m_parallelBodies[0];
+		parallelFor(getScheduler(),0,m_parallelBodies.size(),1,loop);
+	}
+
+	//the independent bodies touch no other body, so solving the others afterwards gives the same results as in body order
+	for (int i=0;i<m_activeBodies.size();i++)
+	{
+		if (serial[i])
+		{
+			btSoftBody* psb = m_activeBodies[i];
+			if (isBatched(psb))
+			{
+				solveBatched(psb);
+			} else
+			{
+				psb->solveConstraints();
+			}
+		}
+	}
+}
+
+btDefaultSoftBodySolverMt::LinkBatches&	btDefaultSoftBodySolverMt::getLinkBatches(btSoftBody* psb)
+{
+	LinkBatches** found = m_linkBatches.find(btHashPtr(psb));
+	LinkBatches* batches;
+	if (found)
+	{
+		batches = *found;
+	} else
+	{
+		batches = new (btAlignedAlloc(sizeof(LinkBatches),16)) LinkBatches();
+		batches->m_body = psb;
+		batches->m_links = 0;
+		batches->m_nodes = 0;
+		batches->m_numLinks = -1;
+		m_linkBatches.insert(btHashPtr(psb),batches);
+	}
+	const btSoftBody::Link* links = psb->m_links.size() ? &psb->m_links[0] : 0;
+	const btSoftBody::Node* nodes = psb->m_nodes.size() ? &psb->m_nodes[0] : 0;
+	if (batches->m_links!=links || batches->m_nodes!=nodes || batches->m_numLinks!=psb->m_links.size())
+	{
+		colorLinks(psb,*batches);
+	}
+	return *batches;
+}
+
+void	btDefaultSoftBodySolverMt::colorLinks(btSoftBody* psb,LinkBatches& batches)
+{
+	BT_PROFILE("colorSoftBodyLinks");
+	const int numLinks = psb->m_links.size();
+	const int numNodes = psb->m_nodes.size();
+	batches.m_links = numLinks ? &psb->m_links[0] : 0;
+	batches.m_nodes = numNodes ? &psb->m_nodes[0] : 0;
+	batches.m_numLinks = numLinks;
+
+	//greedy coloring: each link gets the first color not used by a link of either of its nodes
+	btAlignedObjectArray<unsigned long long> usedColors;
+	usedColors.resize(numNodes,0);
+	btAlignedObjectArray<int> colors;
+	colors.resize(numLinks);
+	int counts[BT_SOFT_BODY_MAX_LINK_COLORS+1];
+	for (int c=0;c<=BT_SOFT_BODY_MAX_LINK_COLORS;c++)
+	{
+		counts[c] = 0;
+	}
+	int numColors = 0;
+	for (int i=0;i<numLinks;i++)
+	{
+		const btSoftBody::Link& l = psb->m_links[i];
+		const int n0 = int(l.m_n[0]-batches.m_nodes);
+		const int n1 = int(l.m_n[1]-batches.m_nodes);
+		btAssert(n0>=0 && n0<numNodes && n1>=0 && n1<numNodes);
+		const unsigned long long used = usedColors[n0]|usedColors[n1];
+		int color = 0;
+		while (color<BT_SOFT_BODY_MAX_LINK_COLORS && (used&(1ULL<<color)))
+		{
+			color++;
+		}
+		if (color<BT_SOFT_BODY_MAX_LINK_COLORS)
+		{
+			usedColors[n0] |= 1ULL<<color;
+			usedColors[n1] |= 1ULL<<color;
+			numColors = btMax(numColors,color+1);
+		}
+		colors[i] = color;
+		counts[color]++;
+	}
+
+	//counting sort of the links by color, keeping the link order inside each batch
+	batches.m_lastBatchSerial = counts[BT_SOFT_BODY_MAX_LINK_COLORS]>0;
+	if (batches.m_lastBatchSerial)
+	{
+		counts[numColors] = counts[BT_SOFT_BODY_MAX_LINK_COLORS];
+		for (int i=0;i<numLinks;i++)
+		{
+			if (colors[i]==BT_SOFT_BODY_MAX_LINK_COLORS)
+			{
+				colors[i] = numColors;
+			}
+		}
+		numColors++;
+	}
+	batches.m_batchOffsets.resize(numColors+1);
+	batches.m_batchOffsets[0] = 0;
+	for (int c=0;c<numColors;c++)
+	{
+		batches.m_batchOffsets[c+1] = batches.m_batchOffsets[c]+counts[c];
+	}
+	btAlignedObjectArray<int> next;
+	next.copyFromArray(batches.m_batchOffsets);
+	batches.m_linkOrder.resize(numLinks);
+	batches.m_packedLinks.resize(numLinks);
+	for (int i=0;i<numLinks;i++)
+	{
+		batches.m_linkOrder[next[colors[i]]++] = i;
+	}
+}
+
+void	btDefaultSoftBodySolverMt::invalidateLinkBatches(const btSoftBody* psb)
+{
+	LinkBatches** found = m_linkBatches.find(btHashPtr(psb));
+	if (found)
+	{
+		LinkBatches* batches = *found;
+		m_linkBatches.remove(btHashPtr(psb));
+		batches->~LinkBatches();
+		btAlignedFree(batches);
+	}
+}
+
+int		btDefaultSoftBodySolverMt::getNumLinkBatches(const btSoftBody* psb) const
+{
+	const LinkBatches* const* found = m_linkBatches.find(btHashPtr(psb));
+	return found ? (*found)->m_batchOffsets.size()-1 : 0;
+}
+
+void	btDefaultSoftBodySolverMt::solveLinkBatches(LinkBatches& batches,bool positions,btScalar kst)
+{
+	btITaskScheduler* scheduler = getScheduler();
+	LinkLoop loop;
+	loop.m_links = 0;
+	loop.m_linkOrder = 0;
+	loop.m_packedLinks = &batches.m_packedLinks[0];
+	loop.m_mode = positions ? LinkLoop::POSITIONS : LinkLoop::VELOCITIES;
+	loop.m_kst = kst;
+	const int numBatches = batches.m_batchOffsets.size()-1;
+	for (int b=0;b<numBatches;b++)
+	{
+		const int iBegin = batches.m_batchOffsets[b];
+		const int iEnd = batches.m_batchOffsets[b+1];
+		if (b==numBatches-1 && batches.m_lastBatchSerial)
+		{
+			loop.forLoop(iBegin,iEnd);
+		} else
+		{
+			parallelFor(scheduler,iBegin,iEnd,m_grainSize,loop);
+		}
+	}
+}
+
+///btSoftBody::solveConstraints with the links solved in parallel batches
+void	btDefaultSoftBodySolverMt::solveBatched(btSoftBody* psb)
+{
+	BT_PROFILE("solveSoftBodyBatched");
+	btITaskScheduler* scheduler = getScheduler();
+	LinkBatches& batches = getLinkBatches(psb);
+	const btSoftBody::Config& cfg = psb->m_cfg;
+	const btSoftBody::SolverState& sst = psb->m_sst;
+
+	/* Apply clusters		*/
+	psb->applyClusters(false);
+	/* Prepare links		*/
+	LinkLoop prepare;
+	prepare.m_links = &psb->m_links[0];
+	prepare.m_linkOrder = &batches.m_linkOrder[0];
+	prepare.m_packedLinks = &batches.m_packedLinks[0];
+	prepare.m_mode = LinkLoop::PREPARE;
+	prepare.m_kst = 1;
+	parallelFor(scheduler,0,psb->m_links.size(),m_grainSize,prepare);
+	/* Prepare anchors		*/
+	for(int i=0,ni=psb->m_anchors.size();i<ni;++i)
+	{
+		btSoftBody::Anchor&	a=psb->m_anchors[i];
+		const btVector3		ra=a.m_body->getWorldTransform().getBasis()*a.m_local;
+		a.m_c0	=	ImpulseMatrix(	sst.sdt,
+			a.m_node->m_im,
+			a.m_body->getInvMass(),
+			a.m_body->getInvInertiaTensorWorld(),
+			ra);
+		a.m_c1	=	ra;
+		a.m_c2	=	sst.sdt*a.m_node->m_im;
+		a.m_body->activate();
+	}
+
+	NodeLoop nodeLoop;
+	nodeLoop.m_nodes = psb->m_nodes.size() ? &psb->m_nodes[0] : 0;
+	const int numNodes = psb->m_nodes.size();
+	/* Solve velocities		*/
+	if(cfg.viterations>0)
+	{
+		for(int isolve=0;isolve<cfg.viterations;++isolve)
+		{
+			for(int iseq=0;iseq<cfg.m_vsequence.size();++iseq)
+			{
+				if (cfg.m_vsequence[iseq]==btSoftBody::eVSolver::Linear)
+				{
+					solveLinkBatches(batches,false,1);
+				} else
+				{
+					btSoftBody::getSolver(cfg.m_vsequence[iseq])(psb,1);
+				}
+			}
+		}
+		nodeLoop.m_mode = NodeLoop::INTEGRATE_VELOCITIES;
+		nodeLoop.m_scale = sst.sdt;
+		parallelFor(scheduler,0,numNodes,m_grainSize,nodeLoop);
+	}
+	/* Solve positions		*/
+	if(cfg.piterations>0)
+	{
+		for(int isolve=0;isolve<cfg.piterations;++isolve)
+		{
+			const btScalar ti=isolve/(btScalar)cfg.piterations;
+			for(int iseq=0;iseq<cfg.m_psequence.size();++iseq)
+			{
+				if (cfg.m_psequence[iseq]==btSoftBody::ePSolver::Linear)
+				{
+					solveLinkBatches(batches,true,1);
+				} else
+				{
+					btSoftBody::getSolver(cfg.m_psequence[iseq])(psb,1,ti);
+				}
+			}
+		}
+		nodeLoop.m_mode = NodeLoop::UPDATE_VELOCITIES;
+		nodeLoop.m_scale = sst.isdt*(1-cfg.kDP);
+		parallelFor(scheduler,0,numNodes,m_grainSize,nodeLoop);
+	}
+	/* Solve drift			*/
+	if(cfg.diterations>0)
+	{
+		nodeLoop.m_mode = NodeLoop::STORE_POSITIONS;
+		parallelFor(scheduler,0,numNodes,m_grainSize,nodeLoop);
+		for(int idrift=0;idrift<cfg.diterations;++idrift)
+		{
+			for(int iseq=0;iseq<cfg.m_dsequence.size();++iseq)
+			{
+				if (cfg.m_dsequence[iseq]==btSoftBody::ePSolver::Linear)
+				{
+					solveLinkBatches(batches,true,1);
+				} else
+				{
+					btSoftBody::getSolver(cfg.m_dsequence[iseq])(psb,1,0);
+				}
+			}
+		}
+		nodeLoop.m_mode = NodeLoop::CORRECT_DRIFT;
+		nodeLoop.m_scale = cfg.kVCF*sst.isdt;
+		parallelFor(scheduler,0,numNodes,m_grainSize,nodeLoop);
+	}
+	/* Apply clusters		*/
+	psb->dampClusters();
+	psb->applyClusters(true);
+}
@@ -0,0 +1,140 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2009 Erwin Coumans  http://bulletphysics.org
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef BT_SOFT_BODY_DEFAULT_SOLVER_MT_H
+#define BT_SOFT_BODY_DEFAULT_SOLVER_MT_H
+
+#include "btDefaultSoftBodySolver.h"
+#include "btSoftBody.h"
+#include "LinearMath/btHashMap.h"
+#include "LinearMath/btThreads.h"
+
+///btDefaultSoftBodySolverMt solves the soft bodies on the threads of a btITaskScheduler.
+///predictMotion and updateSoftBodies process the soft bodies in parallel, with the same results as btDefaultSoftBodySolver.
+///The links of each soft body are colored into batches of links that share no node. Bodies with at least
+///minBatchedLinks links are solved one at a time, with the links of each batch prepared and solved in parallel.
+///Links are solved batch by batch instead of in link order, so these bodies do not move exactly like with
+///btDefaultSoftBodySolver, but the results do not depend on the number of threads.
+///Smaller bodies are solved whole, in parallel with each other, unless they touch another body (anchors,
+///contacts with dynamic rigid bodies, or contacts with the faces of another soft body).
+///Pass the solver to the btSoftRigidDynamicsWorld constructor, which sets it on each soft body it adds.
+class btDefaultSoftBodySolverMt : public btDefaultSoftBodySolver
+{
+	///the solver data of a link, gathered in batch order so the solver loops read the links sequentially
+	ATTRIBUTE_ALIGNED16(struct) PackedLink
+	{
+		btVector3			m_c3;
+		btSoftBody::Node*	m_n[2];
+		btScalar			m_c0;
+		btScalar			m_c1;
+		btScalar			m_c2;
+	};
+
+	///the links of a soft body ordered by batch
+	struct LinkBatches
+	{
+		const btSoftBody*		m_body;
+		const btSoftBody::Link*	m_links;
+		const btSoftBody::Node*	m_nodes;
+		int						m_numLinks;
+		btAlignedObjectArray<int>	m_linkOrder;
+		btAlignedObjectArray<PackedLink>	m_packedLinks;
+		///numBatches+1 offsets into m_linkOrder. The last batch holds the links of nodes with too many colors, it is solved serially.
+		btAlignedObjectArray<int>	m_batchOffsets;
+		bool					m_lastBatchSerial;
+	};
+
+	struct	PredictMotionLoop;
+	struct	UpdateSoftBodiesLoop;
+	struct	SolveBodiesLoop;
+	struct	LinkLoop;
+	struct	NodeLoop;
+
+	btITaskScheduler*	m_taskScheduler;
+	int					m_minBatchedLinks;
+	int					m_grainSize;
+
+	btHashMap<btHashPtr,LinkBatches*>	m_linkBatches;
+	btAlignedObjectArray<btSoftBody*>	m_activeBodies;
+	btAlignedObjectArray<btSoftBody*>	m_parallelBodies;
+	btAlignedObjectArray<btBroadphaseProxy*>	m_broadphaseHandles;
+
+	btITaskScheduler*	getScheduler() const;
+
+	static bool	isIndependent(const btSoftBody* psb);
+
+	bool	isBatched(const btSoftBody* psb) const
+	{
+		return psb->m_links.size()>0 && psb->m_links.size()>=m_minBatchedLinks;
+	}
+
+	LinkBatches&	getLinkBatches(btSoftBody* psb);
+
+	void	colorLinks(btSoftBody* psb,LinkBatches& batches);
+
+	void	solveLinkBatches(LinkBatches& batches,bool positions,btScalar kst);
+
+	void	solveBatched(btSoftBody* psb);
+
+public:
+
+	///minBatchedLinks is the number of links from which a soft body is solved with parallel link batches, grainSize the number of links or nodes per task
+	btDefaultSoftBodySolverMt(int minBatchedLinks = 1024,int grainSize = 128);
+
+	virtual ~btDefaultSoftBodySolverMt();
+
+	virtual SolverTypes getSolverType() const
+	{
+		return CPU_SOLVER;
+	}
+
+	///the scheduler is not owned by the solver, pass 0 to solve on the calling thread
+	void	setTaskScheduler(btITaskScheduler* scheduler)
+	{
+		m_taskScheduler = scheduler;
+	}
+
+	btITaskScheduler*	getTaskScheduler()
+	{
+		return m_taskScheduler;
+	}
+
+	void	setMinBatchedLinks(int minBatchedLinks)
+	{
+		m_minBatchedLinks = minBatchedLinks;
+	}
+
+	int		getMinBatchedLinks() const
+	{
+		return m_minBatchedLinks;
+	}
+
+	///the links are colored again when their number or the node array of the body changes.
+	///Call this after reordering or replacing links of a soft body, for example with btSoftBody::randomizeConstraints.
+	void	invalidateLinkBatches(const btSoftBody* psb);
+
+	///number of link batches of the soft body, computed on its first batched solve (0 before)
+	int		getNumLinkBatches(const btSoftBody* psb) const;
+
+	virtual void optimize( btAlignedObjectArray< btSoftBody * > &softBodies,bool forceUpdate=false );
+
+	virtual void updateSoftBodies( );
+
+	virtual void solveConstraints( float solverdt );
+
+	virtual void predictMotion( float solverdt );
+};
+
+#endif //BT_SOFT_BODY_DEFAULT_SOLVER_MT_H
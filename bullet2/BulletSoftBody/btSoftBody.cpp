@@ -3059,6 +3059,17 @@ void			btSoftBody::defaultCollisionHandler(btCollisionObject* pco)
 
 			docollide.dynmargin	=	basemargin+timemargin;
 			docollide.stamargin	=	basemargin;
+			if(m_worldInfo->m_sparsesdf.CanPrepopulate())
+			{
+				/* Build the missing SDF cells of the nodes in parallel	*/ 
+				btSoftColliders::GatherSDF_RS	gather;
+				gather.itr	=	(prb1 ? prb1->getWorldTransform() : pco->getWorldTransform()).inverse();
+				m_ndbvt.collideTV(m_ndbvt.m_root,volume,gather);
+				if(gather.points.size())
+				{
+					m_worldInfo->m_sparsesdf.Prepopulate(&gather.points[0],gather.points.size(),pco->getCollisionShape());
+				}
+			}
 			m_ndbvt.collideTV(m_ndbvt.m_root,volume,docollide);
 		}
 		break;
@@ -421,7 +421,7 @@ static inline btVector3		BaryCoord(	const btVector3& a,
 }
 
 //
-static btScalar				ImplicitSolve(	btSoftBody::ImplicitFn* fn,
+static inline btScalar		ImplicitSolve(	btSoftBody::ImplicitFn* fn,
 										  const btVector3& a,
 										  const btVector3& b,
 										  const btScalar accuracy,
@@ -503,7 +503,7 @@ static inline btScalar		VolumeOf(	const btVector3& x0,
 }
 
 //
-static void					EvaluateMedium(	const btSoftBodyWorldInfo* wfi,
+static inline void			EvaluateMedium(	const btSoftBodyWorldInfo* wfi,
 										   const btVector3& x,
 										   btSoftBody::sMedium& medium)
 {
@@ -827,6 +827,19 @@ struct btSoftColliders
 		}	
 	};
 	//
+	// GatherSDF_RS
+	//
+	struct	GatherSDF_RS : btDbvt::ICollide
+	{
+		void		Process(const btDbvtNode* leaf)
+		{
+			const btSoftBody::Node*	node=(const btSoftBody::Node*)leaf->data;
+			if(!node->m_battach) points.push_back(itr*node->m_x);
+		}
+		btTransform						itr;
+		btAlignedObjectArray<btVector3>	points;
+	};
+	//
 	// CollideSDF_RS
 	//
 	struct	CollideSDF_RS : btDbvt::ICollide
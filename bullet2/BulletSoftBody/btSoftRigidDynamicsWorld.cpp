@@ -69,6 +69,15 @@ btSoftRigidDynamicsWorld::~btSoftRigidDynamicsWorld()
 		m_softBodySolver->~btSoftBodySolver();
 		btAlignedFree(m_softBodySolver);
 	}
+	m_sbi.m_sparsesdf.Reset();
+}
+
+void	btSoftRigidDynamicsWorld::setTaskScheduler(btITaskScheduler* scheduler)
+{
+	//the scheduler created by setNumTasks is deleted here, the sparse SDF must not keep it
+	m_sbi.m_sparsesdf.SetTaskScheduler(0);
+	btDiscreteDynamicsWorld::setTaskScheduler(scheduler);
+	m_sbi.m_sparsesdf.SetTaskScheduler(getTaskScheduler());
 }
 
 void	btSoftRigidDynamicsWorld::predictUnconstraintMotion(btScalar timeStep)
@@ -54,6 +54,10 @@ public:
 
 	virtual void	debugDrawWorld();
 
+	///also lets the sparse SDF of the world info build new cells on the task scheduler (see btSparseSdf::Prepopulate).
+	///setNumTasks goes through here too
+	virtual void	setTaskScheduler(btITaskScheduler* scheduler);
+
 	void	addSoftBody(btSoftBody* body,short int collisionFilterGroup=btBroadphaseProxy::DefaultFilter,short int collisionFilterMask=btBroadphaseProxy::AllFilter);
 
 	void	removeSoftBody(btSoftBody* body);
@@ -19,6 +19,9 @@ subject to the following restrictions:
 
 #include "BulletCollision/CollisionDispatch/btCollisionObject.h"
 #include "BulletCollision/NarrowPhaseCollision/btGjkEpa2.h"
+#include "LinearMath/btThreads.h"
+#include "LinearMath/btMinMax.h"
+#include <string.h>
 
 // Modified Paul Hsieh hash
 template <const int DWORDLEN>
@@ -40,6 +43,15 @@ unsigned int HsiehHash(const void* pdata)
 	return(hash);
 }
 
+///number of locks of the cell hash table, each guards the buckets with the same index modulo BT_SPARSE_SDF_NUM_STRIPES
+#define BT_SPARSE_SDF_NUM_STRIPES 64
+
+///btSparseSdf caches signed distance grids of convex shapes in cells of CELLSIZE^3 voxels, built on first use.
+///It holds at most about maxCells cells: the hash table is split in BT_SPARSE_SDF_NUM_STRIPES stripes, each with
+///its own lock and list of cells in least recently used order, and a stripe evicts its least recently used cell
+///when it exceeds its share of maxCells. Evaluate is thread safe; cells are built outside of the locks.
+///With a task scheduler, Prepopulate builds the missing cells of a set of points in parallel.
+///Reset, GarbageCollect, RemoveReferences and Initialize must not run concurrently with Evaluate.
 template <const int CELLSIZE>
 struct	btSparseSdf
 {
@@ -60,26 +72,101 @@ struct	btSparseSdf
 		unsigned			hash;
 		btCollisionShape*	pclient;
 		Cell*				next;
+		///least recently used order of the stripe
+		Cell*				lruprev;
+		Cell*				lrunext;
+	};
+	struct	Stripe
+	{
+		btSpinMutex			mutex;
+		///most recently used cell
+		Cell*				lrufirst;
+		Cell*				lrulast;
+		int					ncells;
+		int					nqueries;
+		int					nprobes;
+		int					nbuilt;
+		int					nevicted;
+	};
+	struct	Stats
+	{
+		int					ncells;
+		int					maxcells;
+		int					nqueries;
+		int					nprobes;
+		int					nbuilt;
+		int					nevicted;
+		int					nprepopulated;
+		size_t				memory;
+	};
+	struct	CellKey
+	{
+		int					c[3];
+		unsigned			hash;
+	};
+	struct	CellKeyPredicate
+	{
+		bool operator() ( const CellKey& lhs, const CellKey& rhs ) const
+		{
+			if (lhs.hash!=rhs.hash) return(lhs.hash<rhs.hash);
+			if (lhs.c[0]!=rhs.c[0]) return(lhs.c[0]<rhs.c[0]);
+			if (lhs.c[1]!=rhs.c[1]) return(lhs.c[1]<rhs.c[1]);
+			return(lhs.c[2]<rhs.c[2]);
+		}
+	};
+	struct	PrepopulateLoop : public btIParallelForBody
+	{
+		btSparseSdf*		sdf;
+		const CellKey*		keys;
+		btCollisionShape*	shape;
+		void forLoop(int iBegin, int iEnd) const
+		{
+			for(int i=iBegin;i<iEnd;++i)
+			{
+				Cell*	c=sdf->NewCell(keys[i].c[0],keys[i].c[1],keys[i].c[2],keys[i].hash,shape);
+				Stripe&	s=sdf->stripes[sdf->StripeIndex(keys[i].hash)];
+				s.mutex.lock();
+				sdf->Insert(s,c);
+				s.mutex.unlock();
+			}
+		}
 	};
 	//
 	// Fields
 	//
 
 	btAlignedObjectArray<Cell*>		cells;	
+	Stripe							stripes[BT_SPARSE_SDF_NUM_STRIPES];
 	btScalar						voxelsz;
 	int								puid;
 	int								ncells;
-	int								nprobes;
-	int								nqueries;	
+	int								maxcells;
+	int								nprepopulated;
+	btITaskScheduler*				scheduler;
+	btAlignedObjectArray<CellKey>	prepopulatekeys;
+
+	btSparseSdf()
+		:maxcells(256*1024),
+		nprepopulated(0),
+		scheduler(0)
+	{
+		for(int i=0;i<BT_SPARSE_SDF_NUM_STRIPES;++i)
+		{
+			stripes[i].lrufirst=stripes[i].lrulast=0;
+			stripes[i].ncells=0;
+		}
+		ResetStats();
+	}
 
 	//
 	// Methods
 	//
 
 	//
-	void					Initialize(int hashsize=2383)
+	void					Initialize(int hashsize=2383,int maxCells=256*1024)
 	{
 		cells.resize(hashsize,0);
+		maxcells=maxCells;
 		Reset();		
 	}
 	//
@@ -96,11 +183,74 @@ struct	btSparseSdf
 				pc=pn;
 			}
 		}
+		for(int i=0;i<BT_SPARSE_SDF_NUM_STRIPES;++i)
+		{
+			stripes[i].lrufirst=stripes[i].lrulast=0;
+			stripes[i].ncells=0;
+		}
 		voxelsz		=0.25;
 		puid		=0;
 		ncells		=0;
-		nprobes		=1;
-		nqueries	=1;
+		ResetStats();
+	}
+	///limits the cache to about maxCells cells (rounded up to a multiple of BT_SPARSE_SDF_NUM_STRIPES), evicting the least recently used ones
+	void					SetMaxCells(int maxCells)
+	{
+		maxcells=maxCells;
+		for(int i=0;i<BT_SPARSE_SDF_NUM_STRIPES;++i)
+		{
+			Stripe&	s=stripes[i];
+			s.mutex.lock();
+			Evict(s);
+			s.mutex.unlock();
+		}
+	}
+	///the scheduler is not owned by the cache, Prepopulate does nothing without one
+	void					SetTaskScheduler(btITaskScheduler* taskScheduler)
+	{
+		scheduler=taskScheduler;
+	}
+	btITaskScheduler*		GetTaskScheduler() const
+	{
+		return(scheduler);
+	}
+	///true when Prepopulate builds cells in parallel
+	bool					CanPrepopulate() const
+	{
+		return(scheduler&&scheduler->getNumThreads()>1);
+	}
+	//
+	void					GetStats(Stats& stats) const
+	{
+		stats.ncells=0;
+		stats.maxcells=maxcells;
+		stats.nqueries=0;
+		stats.nprobes=0;
+		stats.nbuilt=0;
+		stats.nevicted=0;
+		stats.nprepopulated=nprepopulated;
+		for(int i=0;i<BT_SPARSE_SDF_NUM_STRIPES;++i)
+		{
+			const Stripe&	s=stripes[i];
+			stats.ncells+=s.ncells;
+			stats.nqueries+=s.nqueries;
+			stats.nprobes+=s.nprobes;
+			stats.nbuilt+=s.nbuilt;
+			stats.nevicted+=s.nevicted;
+		}
+		stats.memory=sizeof(Cell)*stats.ncells+sizeof(Cell*)*cells.size();
+	}
+	///clears the query, probe, build, eviction and prepopulation counters
+	void					ResetStats()
+	{
+		for(int i=0;i<BT_SPARSE_SDF_NUM_STRIPES;++i)
+		{
+			stripes[i].nqueries=0;
+			stripes[i].nprobes=0;
+			stripes[i].nbuilt=0;
+			stripes[i].nevicted=0;
+		}
+		nprepopulated=0;
 	}
 	//
 	void					GarbageCollect(int lifetime=256)
@@ -117,16 +267,13 @@ struct	btSparseSdf
 				if(pc->puid<life)
 				{
 					if(pp) pp->next=pn; else root=pn;
-					delete pc;pc=pp;--ncells;
+					Remove(stripes[StripeIndex(pc->hash)],pc);
+					delete pc;pc=pp;
 				}
 				pp=pc;pc=pn;
 			}
 		}
-		//printf("GC[%d]: %d cells, PpQ: %f\r\n",puid,ncells,nprobes/(btScalar)nqueries);
-		nqueries=1;
-		nprobes=1;
 		++puid;	///@todo: Reset puid's when int range limit is reached	*/ 
-		/* else setup a priority list...						*/ 
 	}
 	//
 	int						RemoveReferences(btCollisionShape* pcs)
@@ -143,6 +290,7 @@ struct	btSparseSdf
 				if(pc->pclient==pcs)
 				{
 					if(pp) pp->next=pn; else root=pn;
+					Remove(stripes[StripeIndex(pc->hash)],pc);
 					delete pc;pc=pp;++refcount;
 				}
 				pp=pc;pc=pn;
@@ -162,31 +310,21 @@ struct	btSparseSdf
 		const IntFrac	iy=Decompose(scx.y());
 		const IntFrac	iz=Decompose(scx.z());
 		const unsigned	h=Hash(ix.b,iy.b,iz.b,shape);
-		Cell*&			root=cells[static_cast<int>(h%cells.size())];
-		Cell*			c=root;
-		++nqueries;
-		while(c)
+		Stripe&			s=stripes[StripeIndex(h)];
+		s.mutex.lock();
+		++s.nqueries;
+		Cell*			c=Find(s,h,ix.b,iy.b,iz.b,shape);
+		if(!c)
 		{
-			++nprobes;
-			if(	(c->hash==h)	&&
-				(c->c[0]==ix.b)	&&
-				(c->c[1]==iy.b)	&&
-				(c->c[2]==iz.b)	&&
-				(c->pclient==shape))
-			{ break; }
-			else
-			{ c=c->next; }
+			/* Build outside of the lock, an other thread may insert the same cell meanwhile	*/ 
+			s.mutex.unlock();
+			Cell*	pc=NewCell(ix.b,iy.b,iz.b,h,shape);
+			s.mutex.lock();
+			c=Insert(s,pc);
 		}
-		if(!c)
+		else
 		{
-			++nprobes;		
-			++ncells;
-			c=new Cell();
-			c->next=root;root=c;
-			c->pclient=shape;
-			c->hash=h;
-			c->c[0]=ix.b;c->c[1]=iy.b;c->c[2]=iz.b;
-			BuildCell(*c);
+			Touch(s,c);
 		}
 		c->puid=puid;
 		/* Extract infos		*/ 
@@ -199,6 +337,7 @@ struct	btSparseSdf
 			c->d[o[0]+1][o[1]+0][o[2]+1],
 			c->d[o[0]+1][o[1]+1][o[2]+1],
 			c->d[o[0]+0][o[1]+1][o[2]+1]};
+		s.mutex.unlock();
 		/* Normal	*/ 
 #if 1
 		const btScalar	gx[]={	d[1]-d[0],d[2]-d[3],
@@ -224,6 +363,144 @@ struct	btSparseSdf
 			Lerp(d[7],d[6],ix.f),iy.f);
 		return(Lerp(d0,d1,iz.f)-margin);
 	}
+	///builds the missing cells that Evaluate will look up for the points (in the local space of shape) on the threads
+	///of the task scheduler, so they are not built one after the other by the first Evaluate calls. Returns the number of cells built.
+	int						Prepopulate(const btVector3* points,int npoints,btCollisionShape* shape)
+	{
+		if(!CanPrepopulate()||!shape->isConvex()) return(0);
+		btAlignedObjectArray<CellKey>&	keys=prepopulatekeys;
+		keys.resize(0);
+		CellKey	l;
+		l.c[0]=l.c[1]=l.c[2]=0;
+		l.hash=0;
+		for(int i=0;i<npoints;++i)
+		{
+			const btVector3	scx=points[i]/voxelsz;
+			CellKey			k;
+			k.c[0]=Decompose(scx.x()).b;
+			k.c[1]=Decompose(scx.y()).b;
+			k.c[2]=Decompose(scx.z()).b;
+			/* Consecutive points are often in the same cell	*/ 
+			if(i>0&&l.c[0]==k.c[0]&&l.c[1]==k.c[1]&&l.c[2]==k.c[2]) continue;
+			k.hash=Hash(k.c[0],k.c[1],k.c[2],shape);
+			l=k;
+			Stripe&	s=stripes[StripeIndex(k.hash)];
+			s.mutex.lock();
+			const bool	found=Find(s,k.hash,k.c[0],k.c[1],k.c[2],shape)!=0;
+			s.mutex.unlock();
+			if(!found) keys.push_back(k);
+		}
+		if(keys.size()==0) return(0);
+		/* Neighboring points share cells	*/ 
+		keys.quickSort(CellKeyPredicate());
+		int	nkeys=1;
+		for(int i=1;i<keys.size();++i)
+		{
+			const CellKey&	l=keys[nkeys-1];
+			const CellKey&	k=keys[i];
+			if(l.hash!=k.hash||l.c[0]!=k.c[0]||l.c[1]!=k.c[1]||l.c[2]!=k.c[2]) keys[nkeys++]=k;
+		}
+		keys.resize(nkeys);
+		PrepopulateLoop	loop;
+		loop.sdf=this;
+		loop.keys=&keys[0];
+		loop.shape=shape;
+		scheduler->parallelFor(0,nkeys,1,loop);
+		nprepopulated+=nkeys;
+		return(nkeys);
+	}
+	//
+	int						StripeIndex(unsigned h) const
+	{
+		return(static_cast<int>(h%cells.size())%BT_SPARSE_SDF_NUM_STRIPES);
+	}
+	///cell of the stripe, or 0. The stripe must be locked.
+	Cell*					Find(Stripe& s,unsigned h,int x,int y,int z,btCollisionShape* shape)
+	{
+		Cell*	c=cells[static_cast<int>(h%cells.size())];
+		while(c)
+		{
+			++s.nprobes;
+			if(	(c->hash==h)	&&
+				(c->c[0]==x)	&&
+				(c->c[1]==y)	&&
+				(c->c[2]==z)	&&
+				(c->pclient==shape))
+			{ break; }
+			else
+			{ c=c->next; }
+		}
+		return(c);
+	}
+	//
+	Cell*					NewCell(int x,int y,int z,unsigned h,btCollisionShape* shape)
+	{
+		Cell*	c=new Cell();
+		c->pclient=shape;
+		c->hash=h;
+		c->c[0]=x;c->c[1]=y;c->c[2]=z;
+		c->puid=puid;
+		c->next=c->lruprev=c->lrunext=0;
+		BuildCell(*c);
+		return(c);
+	}
+	///inserts the cell built outside of the lock unless an other thread inserted it first, returns the cell of the cache.
+	///The stripe must be locked.
+	Cell*					Insert(Stripe& s,Cell* pc)
+	{
+		Cell*	c=Find(s,pc->hash,pc->c[0],pc->c[1],pc->c[2],pc->pclient);
+		if(c)
+		{
+			delete pc;
+			Touch(s,c);
+			return(c);
+		}
+		Cell*&	root=cells[static_cast<int>(pc->hash%cells.size())];
+		pc->next=root;root=pc;
+		pc->lruprev=0;
+		pc->lrunext=s.lrufirst;
+		if(s.lrufirst) s.lrufirst->lruprev=pc; else s.lrulast=pc;
+		s.lrufirst=pc;
+		++s.ncells;
+		++s.nbuilt;
+		btAtomicAdd(&ncells,1);
+		Evict(s);
+		return(pc);
+	}
+	///moves the cell to the front of the least recently used list
+	void					Touch(Stripe& s,Cell* c)
+	{
+		if(s.lrufirst==c) return;
+		c->lruprev->lrunext=c->lrunext;
+		if(c->lrunext) c->lrunext->lruprev=c->lruprev; else s.lrulast=c->lruprev;
+		c->lruprev=0;
+		c->lrunext=s.lrufirst;
+		s.lrufirst->lruprev=c;
+		s.lrufirst=c;
+	}
+	///unlinks the cell from the least recently used list, the caller unlinks it from its bucket
+	void					Remove(Stripe& s,Cell* c)
+	{
+		if(c->lruprev) c->lruprev->lrunext=c->lrunext; else s.lrufirst=c->lrunext;
+		if(c->lrunext) c->lrunext->lruprev=c->lruprev; else s.lrulast=c->lruprev;
+		--s.ncells;
+		btAtomicAdd(&ncells,-1);
+	}
+	///deletes the least recently used cells while the stripe holds more than its share of maxcells, keeping the most recent one
+	void					Evict(Stripe& s)
+	{
+		const int	maxstripecells=btMax(1,(maxcells+BT_SPARSE_SDF_NUM_STRIPES-1)/BT_SPARSE_SDF_NUM_STRIPES);
+		while((s.ncells>maxstripecells)&&(s.lrulast!=s.lrufirst))
+		{
+			Cell*	c=s.lrulast;
+			Cell**	pp=&cells[static_cast<int>(c->hash%cells.size())];
+			while(*pp!=c) pp=&(*pp)->next;
+			*pp=c->next;
+			Remove(s,c);
+			++s.nevicted;
+			delete c;
+		}
+	}
 	//
 	void					BuildCell(Cell& c)
 	{
@@ -291,6 +568,8 @@ struct	btSparseSdf
 		};
 
 		btS myset;
+		/* Clear the padding of 64 bit pointers, it is hashed too	*/ 
+		memset(&myset,0,sizeof(myset));
 
 		myset.x=x;myset.y=y;myset.z=z;myset.p=shape;
 		const void* ptr = &myset;
@@ -14,6 +14,7 @@ subject to the following restrictions:
 */
 
 #include "btAlignedAllocator.h"
+#include "btThreads.h"
 
 int gNumAlignedAllocs = 0;
 int gNumAlignedFree = 0;
@@ -98,6 +99,16 @@ void btAlignedAllocSetCustomAligned(btAlignedAllocFunc *allocFunc, btAlignedFree
   sAlignedFreeFunc = freeFunc ? freeFunc : btAlignedFreeDefault;
 }
 
+int	btAlignedAllocGetNumAllocs()
+{
+	return gNumAlignedAllocs;
+}
+
+int	btAlignedAllocGetNumFrees()
+{
+	return gNumAlignedFree;
+}
+
 void btAlignedAllocSetCustom(btAllocFunc *allocFunc, btFreeFunc *freeFunc)
 {
   sAllocFunc = allocFunc ? allocFunc : btAllocDefault;
@@ -158,7 +169,8 @@ void    btAlignedFreeInternal   (void* ptr,int line,char* filename)
 
 void*	btAlignedAllocInternal	(size_t size, int alignment)
 {
-	gNumAlignedAllocs++;
+	//islands solved on several threads allocate concurrently
+	btAtomicAdd(&gNumAlignedAllocs,1);
 	void* ptr;
 	ptr = sAlignedAllocFunc(size, alignment);
 //	printf("btAlignedAllocInternal %d, %x\n",size,ptr);
@@ -172,7 +184,7 @@ void	btAlignedFreeInternal	(void* ptr)
 		return;
 	}
 
-	gNumAlignedFree++;
+	btAtomicAdd(&gNumAlignedFree,1);
 //	printf("btAlignedFreeInternal %x\n",ptr);
 	sAlignedFreeFunc(ptr);
 }
@@ -53,6 +53,12 @@ typedef void (btFreeFunc)(void *memblock);
 void btAlignedAllocSetCustom(btAllocFunc *allocFunc, btFreeFunc *freeFunc);
 ///If the developer has already an custom aligned allocator, then btAlignedAllocSetCustomAligned can be used. The default aligned allocator pre-allocates extra memory using the non-aligned allocator, and instruments it.
 void btAlignedAllocSetCustomAligned(btAlignedAllocFunc *allocFunc, btAlignedFreeFunc *freeFunc);
+///Custom allocators must be thread safe when Bullet runs on several threads (btITaskScheduler).
+
+///number of btAlignedAlloc calls since startup, for profiling
+int	btAlignedAllocGetNumAllocs();
+///number of btAlignedFree calls since startup, for profiling
+int	btAlignedAllocGetNumFrees();
 
 
 ///The btAlignedAllocator is a portable class for aligned memory allocations.
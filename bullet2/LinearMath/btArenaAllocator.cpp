@@ -0,0 +1,210 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2009 Erwin Coumans  http://bulletphysics.org
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include "btArenaAllocator.h"
+#include "btAlignedAllocator.h"
+#include "btMinMax.h"
+
+#if defined(_WIN32) || defined(__unix__) || defined(__APPLE__)
+#define BT_USE_THREAD_LOCAL 1
+#endif
+
+#if defined(_MSC_VER)
+#define BT_THREAD_LOCAL __declspec(thread)
+#else
+#define BT_THREAD_LOCAL __thread
+#endif
+
+
+btArenaAllocator::btArenaAllocator(size_t blockSize)
+	:m_currentBlock(0),
+	m_offset(0),
+	m_blockSize(blockSize),
+	m_usedBytes(0),
+	m_peakBytes(0),
+	m_numAllocations(0),
+	m_numBlockAllocations(0)
+{
+}
+
+btArenaAllocator::~btArenaAllocator()
+{
+	freeBlocks();
+}
+
+void	btArenaAllocator::freeBlocks()
+{
+	for (int i=0;i<m_blocks.size();i++)
+	{
+		btAlignedFree(m_blocks[i].m_data);
+	}
+	m_blocks.resize(0);
+}
+
+void*	btArenaAllocator::allocate(size_t size,int alignment)
+{
+	btAssert(alignment>0 && alignment<=64 && (alignment&(alignment-1))==0);
+	m_numAllocations++;
+	size_t mask = size_t(alignment-1);
+
+	//use the rest of the current block, or the next block kept from an earlier rewind
+	while (m_currentBlock<m_blocks.size())
+	{
+		const Block& block = m_blocks[m_currentBlock];
+		size_t offset = (m_offset+mask)&~mask;
+		if (offset+size<=block.m_capacity)
+		{
+			m_usedBytes += offset+size-m_offset;
+			m_peakBytes = btMax(m_peakBytes,m_usedBytes);
+			m_offset = offset+size;
+			return block.m_data+offset;
+		}
+		m_currentBlock++;
+		m_offset = 0;
+	}
+
+	Block block;
+	block.m_capacity = btMax(m_blockSize,size);
+	block.m_data = (char*)btAlignedAlloc(block.m_capacity,64);
+	m_blocks.push_back(block);
+	m_numBlockAllocations++;
+
+	m_currentBlock = m_blocks.size()-1;
+	m_offset = size;
+	m_usedBytes += size;
+	m_peakBytes = btMax(m_peakBytes,m_usedBytes);
+	return block.m_data;
+}
+
+size_t	btArenaAllocator::getCapacity() const
+{
+	size_t capacity = 0;
+	for (int i=0;i<m_blocks.size();i++)
+	{
+		capacity += m_blocks[i].m_capacity;
+	}
+	return capacity;
+}
+
+void	btArenaAllocator::reset()
+{
+	if (m_blocks.size()>1)
+	{
+		//everything fit in the blocks, so it fits in one block of their total size
+		size_t capacity = getCapacity();
+		freeBlocks();
+		Block block;
+		block.m_capacity = capacity;
+		block.m_data = (char*)btAlignedAlloc(capacity,64);
+		m_blocks.push_back(block);
+		m_numBlockAllocations++;
+	}
+	m_currentBlock = 0;
+	m_offset = 0;
+	m_usedBytes = 0;
+}
+
+void	btArenaAllocator::clear()
+{
+	freeBlocks();
+	m_currentBlock = 0;
+	m_offset = 0;
+	m_usedBytes = 0;
+}
+
+
+static btArenaAllocator	gScratchArenas[BT_MAX_THREAD_COUNT+1];
+///held by the thread inside the outermost scope of each arena
+static btSpinMutex		gScratchArenaMutexes[BT_MAX_THREAD_COUNT+1];
+static int				gNumScratchFallbacks = 0;
+
+#ifdef BT_USE_THREAD_LOCAL
+static BT_THREAD_LOCAL btArenaAllocator*	gScratchArena = 0;
+static BT_THREAD_LOCAL int					gScratchDepth = 0;
+#else
+static btArenaAllocator*	gScratchArena = 0;
+static int					gScratchDepth = 0;
+#endif
+
+btScratchScope::btScratchScope()
+	:m_arena(gScratchArena)
+{
+	if (!m_arena)
+	{
+		unsigned int threadIndex = btGetCurrentThreadIndex();
+		btAssert(threadIndex <= BT_MAX_THREAD_COUNT);
+		if (gScratchArenaMutexes[threadIndex].tryLock())
+		{
+			m_arena = &gScratchArenas[threadIndex];
+			gScratchArena = m_arena;
+		} else
+		{
+			btAtomicAdd(&gNumScratchFallbacks,1);
+			return;
+		}
+	}
+	gScratchDepth++;
+	m_marker = m_arena->getMarker();
+}
+
+btScratchScope::~btScratchScope()
+{
+	if (!m_arena)
+	{
+		return;
+	}
+	m_arena->rewind(m_marker);
+	if (--gScratchDepth==0)
+	{
+		m_arena->reset();
+		gScratchArena = 0;
+		gScratchArenaMutexes[m_arena-gScratchArenas].unlock();
+	}
+}
+
+void	btGetScratchArenaStats(btScratchArenaStats& stats)
+{
+	stats.m_capacity = 0;
+	stats.m_peakBytes = 0;
+	stats.m_numAllocations = 0;
+	stats.m_numBlockAllocations = 0;
+	stats.m_numFallbacks = gNumScratchFallbacks;
+	for (int i=0;i<=BT_MAX_THREAD_COUNT;i++)
+	{
+		const btArenaAllocator& arena = gScratchArenas[i];
+		stats.m_capacity += arena.getCapacity();
+		stats.m_peakBytes += arena.getPeakBytes();
+		stats.m_numAllocations += arena.getNumAllocations();
+		stats.m_numBlockAllocations += arena.getNumBlockAllocations();
+	}
+}
+
+void	btResetScratchArenaCounters()
+{
+	gNumScratchFallbacks = 0;
+	for (int i=0;i<=BT_MAX_THREAD_COUNT;i++)
+	{
+		gScratchArenas[i].resetCounters();
+	}
+}
+
+void	btClearScratchArenas()
+{
+	for (int i=0;i<=BT_MAX_THREAD_COUNT;i++)
+	{
+		btAssert(gScratchArenas[i].getUsedBytes()==0);
+		gScratchArenas[i].clear();
+	}
+}
@@ -0,0 +1,188 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2009 Erwin Coumans  http://bulletphysics.org
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef BT_ARENA_ALLOCATOR_H
+#define BT_ARENA_ALLOCATOR_H
+
+#include "btScalar.h"
+#include "btAlignedObjectArray.h"
+#include "btThreads.h"
+
+///position in a btArenaAllocator, to free everything allocated after it at once
+struct btArenaMarker
+{
+	int		m_block;
+	size_t	m_offset;
+	size_t	m_usedBytes;
+};
+
+///btArenaAllocator hands out memory from large blocks by bumping an offset. Memory is not freed one allocation at a time:
+///rewind frees everything allocated after a marker, reset frees everything. Blocks are kept for reuse, and reset merges
+///them into one block large enough for the peak usage, so a workload that repeats (like a simulation step) stops
+///allocating from the heap after its first run. It is not thread safe, each thread uses its own arena.
+class btArenaAllocator
+{
+	struct Block
+	{
+		char*	m_data;
+		size_t	m_capacity;
+	};
+
+	btAlignedObjectArray<Block>	m_blocks;
+	int			m_currentBlock;
+	size_t		m_offset;
+	size_t		m_blockSize;
+
+	size_t		m_usedBytes;
+	size_t		m_peakBytes;
+	int			m_numAllocations;
+	int			m_numBlockAllocations;
+
+	void	freeBlocks();
+
+public:
+
+	btArenaAllocator(size_t blockSize=64*1024);
+
+	~btArenaAllocator();
+
+	///alignment must be a power of two, at most 64
+	void*	allocate(size_t size,int alignment=16);
+
+	btArenaMarker	getMarker() const
+	{
+		btArenaMarker marker;
+		marker.m_block = m_currentBlock;
+		marker.m_offset = m_offset;
+		marker.m_usedBytes = m_usedBytes;
+		return marker;
+	}
+
+	///frees all allocations made after marker was taken
+	void	rewind(const btArenaMarker& marker)
+	{
+		btAssert(marker.m_block<m_currentBlock || (marker.m_block==m_currentBlock && marker.m_offset<=m_offset));
+		m_currentBlock = marker.m_block;
+		m_offset = marker.m_offset;
+		m_usedBytes = marker.m_usedBytes;
+	}
+
+	///frees all allocations. When they needed more than one block, the blocks are replaced by one block of the peak size.
+	void	reset();
+
+	///releases all blocks to the heap
+	void	clear();
+
+	///bytes handed out and not freed, including alignment padding
+	size_t	getUsedBytes() const
+	{
+		return m_usedBytes;
+	}
+
+	size_t	getPeakBytes() const
+	{
+		return m_peakBytes;
+	}
+
+	///bytes of all blocks
+	size_t	getCapacity() const;
+
+	int		getNumBlocks() const
+	{
+		return m_blocks.size();
+	}
+
+	///number of allocate calls since the last resetCounters
+	int		getNumAllocations() const
+	{
+		return m_numAllocations;
+	}
+
+	///number of blocks allocated from the heap since the last resetCounters
+	int		getNumBlockAllocations() const
+	{
+		return m_numBlockAllocations;
+	}
+
+	void	resetCounters()
+	{
+		m_numAllocations = 0;
+		m_numBlockAllocations = 0;
+		m_peakBytes = m_usedBytes;
+	}
+};
+
+
+///btScratchScope gives the calling thread its scratch arena for temporary arrays, such as traversal stacks of queries.
+///Each thread index (btGetCurrentThreadIndex) has one scratch arena. Scopes nest: everything allocated inside a scope
+///is freed when it ends, and the arena is reset when the outermost scope of the thread ends.
+///Threads that are not owned by a task scheduler share index 0 with the main thread; while one of them is inside a
+///scope, the others get no arena (getArena returns 0) and should use the heap instead.
+class btScratchScope
+{
+	btArenaAllocator*	m_arena;
+	btArenaMarker		m_marker;
+
+	btScratchScope(const btScratchScope&);
+	btScratchScope& operator=(const btScratchScope&);
+
+public:
+
+	btScratchScope();
+
+	~btScratchScope();
+
+	///the scratch arena of the calling thread, or 0
+	btArenaAllocator*	getArena()
+	{
+		return m_arena;
+	}
+
+	///makes array use capacity elements of the scratch arena, when it is empty and has less capacity.
+	///Growing past that capacity moves the array to the heap, as usual. Declare the scope before the array, so the array is destroyed first.
+	template <typename T>
+	void	reserve(btAlignedObjectArray<T>& array,int capacity)
+	{
+		if (m_arena && array.size()==0 && array.capacity()<capacity)
+		{
+			T* buffer = (T*)m_arena->allocate(sizeof(T)*capacity,16);
+			array.initializeFromBuffer(buffer,0,capacity);
+		} else
+		{
+			array.reserve(capacity);
+		}
+	}
+};
+
+
+///statistics summed over the scratch arenas of all thread indices. Only exact when no thread is inside a scratch scope.
+struct btScratchArenaStats
+{
+	size_t	m_capacity;
+	size_t	m_peakBytes;
+	int		m_numAllocations;
+	int		m_numBlockAllocations;
+	///scopes that got no arena because another thread with the same index was inside a scope
+	int		m_numFallbacks;
+};
+
+void	btGetScratchArenaStats(btScratchArenaStats& stats);
+
+void	btResetScratchArenaCounters();
+
+///releases the blocks of all scratch arenas to the heap. No thread may be inside a scratch scope.
+void	btClearScratchArenas();
+
+#endif //BT_ARENA_ALLOCATOR_H
@@ -25,6 +25,28 @@ subject to the following restrictions:
 #define btMatrix3x3Data	btMatrix3x3FloatData
 #endif //BT_USE_DOUBLE_PRECISION
 
+#ifdef BT_USE_SSE
+///transpose the x, y and z lanes of three rows in place, w of the results is zero
+SIMD_FORCE_INLINE void btvTranspose3(__m128& r0, __m128& r1, __m128& r2)
+{
+	__m128 zero = _mm_setzero_ps();
+	__m128 t0 = _mm_unpacklo_ps(r0, r1);	// x0 x1 y0 y1
+	__m128 t1 = _mm_unpackhi_ps(r0, r1);	// z0 z1 w0 w1
+	__m128 t2 = _mm_unpacklo_ps(r2, zero);	// x2 0  y2 0
+	__m128 t3 = _mm_unpackhi_ps(r2, zero);	// z2 0  w2 0
+	r0 = _mm_movelh_ps(t0, t2);
+	r1 = _mm_movehl_ps(t2, t0);
+	r2 = _mm_movelh_ps(t1, t3);
+}
+
+///v.x * r0 + v.y * r1 + v.z * r2 with w cleared
+SIMD_FORCE_INLINE __m128 btvCombineRows(__m128 v, __m128 r0, __m128 r1, __m128 r2)
+{
+	__m128 r = _mm_add_ps(_mm_add_ps(_mm_mul_ps(bt_splat_ps(v, 0), r0), _mm_mul_ps(bt_splat_ps(v, 1), r1)), _mm_mul_ps(bt_splat_ps(v, 2), r2));
+	return _mm_and_ps(r, btvFFF0Mask());
+}
+#endif //BT_USE_SSE
+
 
 /**@brief The btMatrix3x3 class implements a 3x3 rotation matrix, to perform linear algebra in combination with btQuaternion, btTransform and btVector3.
 * Make sure to only include a pure orthogonal matrix without scaling. */
@@ -57,6 +79,14 @@ public:
 			yx, yy, yz, 
 			zx, zy, zz);
 	}
+	/** @brief Constructor from three rows */
+	SIMD_FORCE_INLINE btMatrix3x3(const btVector3& v0, const btVector3& v1, const btVector3& v2)
+	{
+		m_el[0] = v0;
+		m_el[1] = v1;
+		m_el[2] = v2;
+	}
+
 	/** @brief Copy constructor */
 	SIMD_FORCE_INLINE btMatrix3x3 (const btMatrix3x3& other)
 	{
@@ -527,9 +557,18 @@ public:
 SIMD_FORCE_INLINE btMatrix3x3& 
 btMatrix3x3::operator*=(const btMatrix3x3& m)
 {
+#ifdef BT_USE_SSE
+	__m128 m0 = m.m_el[0].mVec128;
+	__m128 m1 = m.m_el[1].mVec128;
+	__m128 m2 = m.m_el[2].mVec128;
+	m_el[0].mVec128 = btvCombineRows(m_el[0].mVec128, m0, m1, m2);
+	m_el[1].mVec128 = btvCombineRows(m_el[1].mVec128, m0, m1, m2);
+	m_el[2].mVec128 = btvCombineRows(m_el[2].mVec128, m0, m1, m2);
+#else
 	setValue(m.tdotx(m_el[0]), m.tdoty(m_el[0]), m.tdotz(m_el[0]),
 		m.tdotx(m_el[1]), m.tdoty(m_el[1]), m.tdotz(m_el[1]),
 		m.tdotx(m_el[2]), m.tdoty(m_el[2]), m.tdotz(m_el[2]));
+#endif
 	return *this;
 }
 
@@ -616,18 +655,30 @@ btMatrix3x3::determinant() const
 SIMD_FORCE_INLINE btMatrix3x3 
 btMatrix3x3::absolute() const
 {
+#ifdef BT_USE_SSE
+	return btMatrix3x3(m_el[0].absolute(), m_el[1].absolute(), m_el[2].absolute());
+#else
 	return btMatrix3x3(
 		btFabs(m_el[0].x()), btFabs(m_el[0].y()), btFabs(m_el[0].z()),
 		btFabs(m_el[1].x()), btFabs(m_el[1].y()), btFabs(m_el[1].z()),
 		btFabs(m_el[2].x()), btFabs(m_el[2].y()), btFabs(m_el[2].z()));
+#endif
 }
 
 SIMD_FORCE_INLINE btMatrix3x3 
 btMatrix3x3::transpose() const 
 {
+#ifdef BT_USE_SSE
+	__m128 r0 = m_el[0].mVec128;
+	__m128 r1 = m_el[1].mVec128;
+	__m128 r2 = m_el[2].mVec128;
+	btvTranspose3(r0, r1, r2);
+	return btMatrix3x3(btVector3(r0), btVector3(r1), btVector3(r2));
+#else
 	return btMatrix3x3(m_el[0].x(), m_el[1].x(), m_el[2].x(),
 		m_el[0].y(), m_el[1].y(), m_el[2].y(),
 		m_el[0].z(), m_el[1].z(), m_el[2].z());
+#endif
 }
 
 SIMD_FORCE_INLINE btMatrix3x3 
@@ -653,6 +704,19 @@ btMatrix3x3::inverse() const
 SIMD_FORCE_INLINE btMatrix3x3 
 btMatrix3x3::transposeTimes(const btMatrix3x3& m) const
 {
+#ifdef BT_USE_SSE
+	__m128 a0 = m_el[0].mVec128;
+	__m128 a1 = m_el[1].mVec128;
+	__m128 a2 = m_el[2].mVec128;
+	btvTranspose3(a0, a1, a2);
+	__m128 m0 = m.m_el[0].mVec128;
+	__m128 m1 = m.m_el[1].mVec128;
+	__m128 m2 = m.m_el[2].mVec128;
+	return btMatrix3x3(
+		btVector3(btvCombineRows(a0, m0, m1, m2)),
+		btVector3(btvCombineRows(a1, m0, m1, m2)),
+		btVector3(btvCombineRows(a2, m0, m1, m2)));
+#else
 	return btMatrix3x3(
 		m_el[0].x() * m[0].x() + m_el[1].x() * m[1].x() + m_el[2].x() * m[2].x(),
 		m_el[0].x() * m[0].y() + m_el[1].x() * m[1].y() + m_el[2].x() * m[2].y(),
@@ -663,38 +727,72 @@ btMatrix3x3::transposeTimes(const btMatrix3x3& m) const
 		m_el[0].z() * m[0].x() + m_el[1].z() * m[1].x() + m_el[2].z() * m[2].x(),
 		m_el[0].z() * m[0].y() + m_el[1].z() * m[1].y() + m_el[2].z() * m[2].y(),
 		m_el[0].z() * m[0].z() + m_el[1].z() * m[1].z() + m_el[2].z() * m[2].z());
+#endif
 }
 
 SIMD_FORCE_INLINE btMatrix3x3 
 btMatrix3x3::timesTranspose(const btMatrix3x3& m) const
 {
+#ifdef BT_USE_SSE
+	__m128 t0 = m.m_el[0].mVec128;
+	__m128 t1 = m.m_el[1].mVec128;
+	__m128 t2 = m.m_el[2].mVec128;
+	btvTranspose3(t0, t1, t2);
+	return btMatrix3x3(
+		btVector3(btvCombineRows(m_el[0].mVec128, t0, t1, t2)),
+		btVector3(btvCombineRows(m_el[1].mVec128, t0, t1, t2)),
+		btVector3(btvCombineRows(m_el[2].mVec128, t0, t1, t2)));
+#else
 	return btMatrix3x3(
 		m_el[0].dot(m[0]), m_el[0].dot(m[1]), m_el[0].dot(m[2]),
 		m_el[1].dot(m[0]), m_el[1].dot(m[1]), m_el[1].dot(m[2]),
 		m_el[2].dot(m[0]), m_el[2].dot(m[1]), m_el[2].dot(m[2]));
-
+#endif
 }
 
 SIMD_FORCE_INLINE btVector3 
 operator*(const btMatrix3x3& m, const btVector3& v) 
 {
+#ifdef BT_USE_SSE
+	//multiply each row by v, then sum the products of each row in one lane
+	__m128 p0 = _mm_mul_ps(m[0].mVec128, v.mVec128);
+	__m128 p1 = _mm_mul_ps(m[1].mVec128, v.mVec128);
+	__m128 p2 = _mm_mul_ps(m[2].mVec128, v.mVec128);
+	btvTranspose3(p0, p1, p2);
+	return btVector3(_mm_add_ps(_mm_add_ps(p0, p1), p2));
+#else
 	return btVector3(m[0].dot(v), m[1].dot(v), m[2].dot(v));
+#endif
 }
 
 
 SIMD_FORCE_INLINE btVector3
 operator*(const btVector3& v, const btMatrix3x3& m)
 {
+#ifdef BT_USE_SSE
+	return btVector3(btvCombineRows(v.mVec128, m[0].mVec128, m[1].mVec128, m[2].mVec128));
+#else
 	return btVector3(m.tdotx(v), m.tdoty(v), m.tdotz(v));
+#endif
 }
 
 SIMD_FORCE_INLINE btMatrix3x3 
 operator*(const btMatrix3x3& m1, const btMatrix3x3& m2)
 {
+#ifdef BT_USE_SSE
+	__m128 b0 = m2[0].mVec128;
+	__m128 b1 = m2[1].mVec128;
+	__m128 b2 = m2[2].mVec128;
+	return btMatrix3x3(
+		btVector3(btvCombineRows(m1[0].mVec128, b0, b1, b2)),
+		btVector3(btvCombineRows(m1[1].mVec128, b0, b1, b2)),
+		btVector3(btvCombineRows(m1[2].mVec128, b0, b1, b2)));
+#else
 	return btMatrix3x3(
 		m2.tdotx( m1[0]), m2.tdoty( m1[0]), m2.tdotz( m1[0]),
 		m2.tdotx( m1[1]), m2.tdoty( m1[1]), m2.tdotz( m1[1]),
 		m2.tdotx( m1[2]), m2.tdoty( m1[2]), m2.tdotz( m1[2]));
+#endif
 }
 
 /*
@@ -3,8 +3,8 @@ Copyright (c) 2003-2006 Gino van den Bergen / Erwin Coumans  http://continuousph
 
 This software is provided 'as-is', without any express or implied warranty.
 In no event will the authors be held liable for any damages arising from the use of this software.
-Permission is granted to anyone to use this software for any purpose, 
-including commercial applications, and to alter it and redistribute it freely, 
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
 subject to the following restrictions:
 
 1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
@@ -18,22 +18,243 @@ subject to the following restrictions:
 
 #include "btScalar.h"
 #include "btAlignedAllocator.h"
+#include "btThreads.h"
+#include "btMinMax.h"
+#include <new>
+
+///default number of free elements a thread caches in its magazine
+#define BT_POOL_MAGAZINE_SIZE 32
+///set to 1 to count allocations, frees and depot transfers, the counters cost the single threaded path about 10%
+#ifndef BT_POOL_ALLOCATOR_PROFILE
+#define BT_POOL_ALLOCATOR_PROFILE 0
+#endif
 
 ///The btPoolAllocator class allows to efficiently allocate a large pool of objects, instead of dynamically allocating them separately.
+///It is thread safe: each thread (by btGetCurrentThreadIndex) allocates from and frees to its own magazine, a small
+///free list of up to magazineSize elements. An empty magazine is refilled with half a magazine from the shared depot,
+///a full magazine is returned to the depot in one splice. The depot lock is only taken once per magazineSize/2
+///operations, and the lock of a magazine is only contended when threads outside a task scheduler share index 0.
+///While no scheduler or background worker thread exists (btGetNumWorkerThreads is 0) the depot is used as a plain free
+///list without locks, so a single thread pays nothing for the magazines and gets elements in the same order as from a
+///single free list. allocate returns 0 when the pool is exhausted, callers fall back to btAlignedAlloc.
 class btPoolAllocator
 {
+	ATTRIBUTE_ALIGNED64 (struct) Magazine
+	{
+		btSpinMutex	m_mutex;
+		void*		m_first;
+		void*		m_last;
+		int			m_count;
+#if BT_POOL_ALLOCATOR_PROFILE
+		int			m_numAllocations;
+		int			m_numFrees;
+#endif
+
+		Magazine()
+			:m_first(0),
+			m_last(0),
+			m_count(0)
+		{
+#if BT_POOL_ALLOCATOR_PROFILE
+			m_numAllocations = 0;
+			m_numFrees = 0;
+#endif
+		}
+	};
+
 	int				m_elemSize;
 	int				m_maxElements;
+	int				m_magazineSize;
+	///the depot, a free list shared by all threads
+	btSpinMutex		m_depotMutex;
 	int				m_freeCount;
 	void*			m_firstFree;
+#if BT_POOL_ALLOCATOR_PROFILE
+	int				m_numDepotTransfers;
+	///allocations and frees served by the depot, without magazines
+	int				m_numAllocations;
+	int				m_numFrees;
+#endif
 	unsigned char*	m_pool;
+	///BT_MAX_THREAD_COUNT+1 magazines, one per thread index including the background thread, or 0 without magazines
+	Magazine*		m_magazines;
+
+	Magazine&	getMagazine()
+	{
+		unsigned int threadIndex = btGetCurrentThreadIndex();
+		btAssert(threadIndex <= BT_MAX_THREAD_COUNT);
+		return m_magazines[threadIndex];
+	}
+
+	///moves up to half a magazine from the top of the depot to the empty magazine, returns false when the depot is empty
+	bool	refill(Magazine& magazine)
+	{
+		btAssert(magazine.m_count==0);
+		m_depotMutex.lock();
+		int count = btMin(m_freeCount,btMax(m_magazineSize/2,1));
+		if (count)
+		{
+			void* last = m_firstFree;
+			for (int i=1;i<count;i++)
+			{
+				last = *(void**)last;
+			}
+			magazine.m_first = m_firstFree;
+			magazine.m_last = last;
+			magazine.m_count = count;
+			m_firstFree = *(void**)last;
+			m_freeCount -= count;
+#if BT_POOL_ALLOCATOR_PROFILE
+			m_numDepotTransfers++;
+#endif
+		}
+		m_depotMutex.unlock();
+		return count!=0;
+	}
+
+	///takes an element from the magazine of any thread, for when the magazine of the calling thread and the depot are empty.
+	///Only one magazine is locked at a time, so threads stealing from each other can not deadlock
+	void*	steal(bool useLocks)
+	{
+		for (int i=0;i<=BT_MAX_THREAD_COUNT;i++)
+		{
+			Magazine& magazine = m_magazines[i];
+			if (!magazine.m_count)
+				continue;
+			if (useLocks)
+				magazine.m_mutex.lock();
+			void* result = 0;
+			if (magazine.m_count)
+			{
+				result = magazine.m_first;
+				magazine.m_first = *(void**)result;
+				if (!--magazine.m_count)
+				{
+					magazine.m_last = 0;
+				}
+#if BT_POOL_ALLOCATOR_PROFILE
+				//counted as an allocation of the magazine, so the counters of each magazine stay balanced
+				magazine.m_numAllocations++;
+#endif
+			}
+			if (useLocks)
+				magazine.m_mutex.unlock();
+			if (result)
+				return result;
+		}
+		return 0;
+	}
+
+	///splices all elements of the magazine on top of the depot
+	void	flush(Magazine& magazine)
+	{
+		if (!magazine.m_count)
+			return;
+		m_depotMutex.lock();
+		*(void**)magazine.m_last = m_firstFree;
+		m_firstFree = magazine.m_first;
+		m_freeCount += magazine.m_count;
+#if BT_POOL_ALLOCATOR_PROFILE
+		m_numDepotTransfers++;
+#endif
+		m_depotMutex.unlock();
+		magazine.m_first = 0;
+		magazine.m_last = 0;
+		magazine.m_count = 0;
+	}
+
+	///the allocate path when worker threads exist, or when the depot is empty
+	void*	allocateShared()
+	{
+		void* result = 0;
+		if (!btGetNumWorkerThreads())
+		{
+			//elements freed into the magazines while threads ran are taken last
+			return m_magazines ? steal(false) : 0;
+		}
+		if (!m_magazines)
+		{
+			m_depotMutex.lock();
+			if (m_freeCount)
+			{
+				result = m_firstFree;
+				m_firstFree = *(void**)m_firstFree;
+				--m_freeCount;
+#if BT_POOL_ALLOCATOR_PROFILE
+				m_numAllocations++;
+				m_numDepotTransfers++;
+#endif
+			}
+			m_depotMutex.unlock();
+			return result;
+		}
+
+		Magazine& magazine = getMagazine();
+		magazine.m_mutex.lock();
+		if (magazine.m_count || refill(magazine))
+		{
+			result = magazine.m_first;
+			magazine.m_first = *(void**)result;
+			--magazine.m_count;
+#if BT_POOL_ALLOCATOR_PROFILE
+			magazine.m_numAllocations++;
+#endif
+		}
+		magazine.m_mutex.unlock();
+		if (!result)
+		{
+			result = steal(true);
+		}
+		return result;
+	}
+
+	///the freeMemory path when worker threads exist
+	void	freeShared(void* ptr)
+	{
+		if (!m_magazines)
+		{
+			m_depotMutex.lock();
+			*(void**)ptr = m_firstFree;
+			m_firstFree = ptr;
+			++m_freeCount;
+#if BT_POOL_ALLOCATOR_PROFILE
+			m_numFrees++;
+			m_numDepotTransfers++;
+#endif
+			m_depotMutex.unlock();
+			return;
+		}
+
+		Magazine& magazine = getMagazine();
+		magazine.m_mutex.lock();
+		if (magazine.m_count==m_magazineSize)
+		{
+			flush(magazine);
+		}
+		*(void**)ptr = magazine.m_first;
+		if (!magazine.m_count)
+		{
+			magazine.m_last = ptr;
+		}
+		magazine.m_first = ptr;
+		++magazine.m_count;
+#if BT_POOL_ALLOCATOR_PROFILE
+		magazine.m_numFrees++;
+#endif
+		magazine.m_mutex.unlock();
+	}
 
 public:
 
-	btPoolAllocator(int elemSize, int maxElements)
+	///magazineSize 0 disables the per-thread magazines, all threads then share the depot lock
+	btPoolAllocator(int elemSize, int maxElements, int magazineSize=BT_POOL_MAGAZINE_SIZE)
 		:m_elemSize(elemSize),
-		m_maxElements(maxElements)
+		m_maxElements(maxElements),
+		m_magazineSize(magazineSize),
+		m_magazines(0)
 	{
+		btAssert(m_elemSize>=int(sizeof(void*)));
+		resetCounters();
 		m_pool = (unsigned char*) btAlignedAlloc( static_cast<unsigned int>(m_elemSize*m_maxElements),16);
 
 		unsigned char* p = m_pool;
@@ -45,21 +266,43 @@ public:
             p += m_elemSize;
         }
         *(void**)p = 0;
+
+		if (m_magazineSize>0)
+		{
+			m_magazines = (Magazine*) btAlignedAlloc(sizeof(Magazine)*(BT_MAX_THREAD_COUNT+1),64);
+			for (int i=0;i<=BT_MAX_THREAD_COUNT;i++)
+			{
+				new (&m_magazines[i]) Magazine();
+			}
+		}
     }
 
 	~btPoolAllocator()
 	{
+		if (m_magazines)
+		{
+			btAlignedFree(m_magazines);
+		}
 		btAlignedFree( m_pool);
 	}
 
+	///number of free elements in the depot and all magazines. Exact when no thread is allocating or freeing.
 	int	getFreeCount() const
 	{
-		return m_freeCount;
+		int freeCount = m_freeCount;
+		if (m_magazines)
+		{
+			for (int i=0;i<=BT_MAX_THREAD_COUNT;i++)
+			{
+				freeCount += m_magazines[i].m_count;
+			}
+		}
+		return freeCount;
 	}
 
 	int getUsedCount() const
 	{
-		return m_maxElements - m_freeCount;
+		return m_maxElements - getFreeCount();
 	}
 
 	int getMaxCount() const
@@ -67,16 +310,29 @@ public:
 		return m_maxElements;
 	}
 
+	int getMagazineSize() const
+	{
+		return m_magazineSize;
+	}
+
+	///returns 0 when no free element is left for the calling thread
 	void*	allocate(int size)
 	{
 		// release mode fix
 		(void)size;
 		btAssert(!size || size<=m_elemSize);
-		btAssert(m_freeCount>0);
-        void* result = m_firstFree;
-        m_firstFree = *(void**)m_firstFree;
-        --m_freeCount;
-        return result;
+		//no other thread can use the pool, so the depot is a plain free list
+		if (!btGetNumWorkerThreads() && m_freeCount)
+		{
+			void* result = m_firstFree;
+			m_firstFree = *(void**)m_firstFree;
+			--m_freeCount;
+#if BT_POOL_ALLOCATOR_PROFILE
+			m_numAllocations++;
+#endif
+			return result;
+		}
+		return allocateShared();
 	}
 
 	bool validPtr(void* ptr)
@@ -90,17 +346,101 @@ public:
 		return false;
 	}
 
+	///ptr can be freed by any thread, not only the one that allocated it
 	void	freeMemory(void* ptr)
 	{
 		 if (ptr) {
             btAssert((unsigned char*)ptr >= m_pool && (unsigned char*)ptr < m_pool + m_maxElements * m_elemSize);
 
-            *(void**)ptr = m_firstFree;
-            m_firstFree = ptr;
-            ++m_freeCount;
+			if (!btGetNumWorkerThreads())
+			{
+				*(void**)ptr = m_firstFree;
+				m_firstFree = ptr;
+				++m_freeCount;
+#if BT_POOL_ALLOCATOR_PROFILE
+				m_numFrees++;
+#endif
+				return;
+			}
+			freeShared(ptr);
         }
 	}
 
+	///returns the free elements cached by the calling thread to the depot, for example before the thread exits
+	void	flushMagazine()
+	{
+		if (m_magazines)
+		{
+			Magazine& magazine = getMagazine();
+			magazine.m_mutex.lock();
+			flush(magazine);
+			magazine.m_mutex.unlock();
+		}
+	}
+
+	///number of allocate calls that returned an element, 0 unless BT_POOL_ALLOCATOR_PROFILE is set
+	int	getNumAllocations() const
+	{
+		int numAllocations = 0;
+#if BT_POOL_ALLOCATOR_PROFILE
+		numAllocations = m_numAllocations;
+		if (m_magazines)
+		{
+			for (int i=0;i<=BT_MAX_THREAD_COUNT;i++)
+			{
+				numAllocations += m_magazines[i].m_numAllocations;
+			}
+		}
+#endif
+		return numAllocations;
+	}
+
+	///number of freeMemory calls, 0 unless BT_POOL_ALLOCATOR_PROFILE is set
+	int	getNumFrees() const
+	{
+		int numFrees = 0;
+#if BT_POOL_ALLOCATOR_PROFILE
+		numFrees = m_numFrees;
+		if (m_magazines)
+		{
+			for (int i=0;i<=BT_MAX_THREAD_COUNT;i++)
+			{
+				numFrees += m_magazines[i].m_numFrees;
+			}
+		}
+#endif
+		return numFrees;
+	}
+
+	///number of times the depot lock was taken (refills and returns of magazines, or every call without magazines),
+	///the depot is not locked while there are no worker threads. 0 unless BT_POOL_ALLOCATOR_PROFILE is set
+	int	getNumDepotTransfers() const
+	{
+#if BT_POOL_ALLOCATOR_PROFILE
+		return m_numDepotTransfers;
+#else
+		return 0;
+#endif
+	}
+
+	///clears the allocation, free and depot transfer counters
+	void	resetCounters()
+	{
+#if BT_POOL_ALLOCATOR_PROFILE
+		m_numDepotTransfers = 0;
+		m_numAllocations = 0;
+		m_numFrees = 0;
+		if (m_magazines)
+		{
+			for (int i=0;i<=BT_MAX_THREAD_COUNT;i++)
+			{
+				m_magazines[i].m_numAllocations = 0;
+				m_magazines[i].m_numFrees = 0;
+			}
+		}
+#endif
+	}
+
 	int	getElementSize() const
 	{
 		return m_elemSize;
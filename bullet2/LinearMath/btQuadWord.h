@@ -47,7 +47,24 @@ public:
 	}
 protected:
 #else //__CELLOS_LV2__ __SPU__
+#ifdef BT_USE_SSE
+	union {
+		__m128 mVec128;
+		btScalar	m_floats[4];
+	};
+public:
+	SIMD_FORCE_INLINE	__m128	get128() const
+	{
+		return mVec128;
+	}
+	SIMD_FORCE_INLINE	void	set128(__m128 v128)
+	{
+		mVec128 = v128;
+	}
+protected:
+#else
 	btScalar	m_floats[4];
+#endif
 #endif //__CELLOS_LV2__ __SPU__
 
 	public:
@@ -120,10 +137,14 @@ protected:
    */
 		SIMD_FORCE_INLINE void	setValue(const btScalar& x, const btScalar& y, const btScalar& z,const btScalar& w)
 		{
+#ifdef BT_USE_SSE
+			mVec128 = _mm_setr_ps(x, y, z, w);
+#else
 			m_floats[0]=x;
 			m_floats[1]=y;
 			m_floats[2]=z;
 			m_floats[3]=w;
+#endif
 		}
   /**@brief No initialization constructor */
 		SIMD_FORCE_INLINE btQuadWord()
@@ -149,7 +170,11 @@ protected:
    */
 		SIMD_FORCE_INLINE btQuadWord(const btScalar& x, const btScalar& y, const btScalar& z,const btScalar& w) 
 		{
+#ifdef BT_USE_SSE
+			mVec128 = _mm_setr_ps(x, y, z, w);
+#else
 			m_floats[0] = x, m_floats[1] = y, m_floats[2] = z, m_floats[3] = w;
+#endif
 		}
 
   /**@brief Set each element to the max of the current values and the values of another btQuadWord
@@ -21,6 +21,43 @@ subject to the following restrictions:
 #include "btVector3.h"
 #include "btQuadWord.h"
 
+#ifdef BT_USE_SSE
+///sign mask that negates w only
+SIMD_FORCE_INLINE __m128 btvQuatWSignMask()
+{
+	return _mm_setr_ps(0.0f, 0.0f, 0.0f, -0.0f);
+}
+
+///sign mask that negates x, y and z
+SIMD_FORCE_INLINE __m128 btvQuatXYZSignMask()
+{
+	return _mm_setr_ps(-0.0f, -0.0f, -0.0f, 0.0f);
+}
+
+///quaternion product q1 * q2, summed in the same order as the scalar code
+SIMD_FORCE_INLINE __m128 btvQuatMul(__m128 a, __m128 b)
+{
+	__m128 t1 = _mm_mul_ps(bt_splat_ps(a, 3), b);
+	__m128 t2 = _mm_mul_ps(bt_pshufd_ps(a, _MM_SHUFFLE(0,2,1,0)), bt_pshufd_ps(b, _MM_SHUFFLE(0,3,3,3)));
+	__m128 t3 = _mm_mul_ps(bt_pshufd_ps(a, _MM_SHUFFLE(1,0,2,1)), bt_pshufd_ps(b, _MM_SHUFFLE(1,1,0,2)));
+	__m128 t4 = _mm_mul_ps(bt_pshufd_ps(a, _MM_SHUFFLE(2,1,0,2)), bt_pshufd_ps(b, _MM_SHUFFLE(2,0,2,1)));
+	t2 = _mm_xor_ps(t2, btvQuatWSignMask());
+	t3 = _mm_xor_ps(t3, btvQuatWSignMask());
+	return _mm_sub_ps(_mm_add_ps(_mm_add_ps(t1, t2), t3), t4);
+}
+
+///quaternion times pure vector q * (v,0), the w of v is ignored
+SIMD_FORCE_INLINE __m128 btvQuatMulVec(__m128 q, __m128 v)
+{
+	__m128 t1 = _mm_mul_ps(bt_pshufd_ps(q, _MM_SHUFFLE(0,3,3,3)), bt_pshufd_ps(v, _MM_SHUFFLE(0,2,1,0)));
+	__m128 t2 = _mm_mul_ps(bt_pshufd_ps(q, _MM_SHUFFLE(1,0,2,1)), bt_pshufd_ps(v, _MM_SHUFFLE(1,1,0,2)));
+	__m128 t3 = _mm_mul_ps(bt_pshufd_ps(q, _MM_SHUFFLE(2,1,0,2)), bt_pshufd_ps(v, _MM_SHUFFLE(2,0,2,1)));
+	t1 = _mm_xor_ps(t1, btvQuatWSignMask());
+	t2 = _mm_xor_ps(t2, btvQuatWSignMask());
+	return _mm_sub_ps(_mm_add_ps(t1, t2), t3);
+}
+#endif //BT_USE_SSE
+
 /**@brief The btQuaternion implements quaternion to perform linear algebra rotations in combination with btMatrix3x3, btVector3 and btTransform. */
 class btQuaternion : public btQuadWord {
 public:
@@ -33,6 +70,13 @@ public:
 	btQuaternion(const btScalar& x, const btScalar& y, const btScalar& z, const btScalar& w) 
 		: btQuadWord(x, y, z, w) 
 	{}
+#ifdef BT_USE_SSE
+  /**@brief Constructor from an SSE register */
+	SIMD_FORCE_INLINE explicit btQuaternion(__m128 v128)
+	{
+		mVec128 = v128;
+	}
+#endif
   /**@brief Axis angle Constructor
    * @param axis The axis which the rotation is around
    * @param angle The magnitude of the rotation around the angle (Radians) */
@@ -107,7 +151,11 @@ public:
    * @param q The quaternion to add to this one */
 	SIMD_FORCE_INLINE	btQuaternion& operator+=(const btQuaternion& q)
 	{
+#ifdef BT_USE_SSE
+		mVec128 = _mm_add_ps(mVec128, q.mVec128);
+#else
 		m_floats[0] += q.x(); m_floats[1] += q.y(); m_floats[2] += q.z(); m_floats[3] += q.m_floats[3];
+#endif
 		return *this;
 	}
 
@@ -115,7 +163,11 @@ public:
    * @param q The quaternion to subtract from this one */
 	btQuaternion& operator-=(const btQuaternion& q) 
 	{
+#ifdef BT_USE_SSE
+		mVec128 = _mm_sub_ps(mVec128, q.mVec128);
+#else
 		m_floats[0] -= q.x(); m_floats[1] -= q.y(); m_floats[2] -= q.z(); m_floats[3] -= q.m_floats[3];
+#endif
 		return *this;
 	}
 
@@ -123,7 +175,11 @@ public:
    * @param s The scalar to scale by */
 	btQuaternion& operator*=(const btScalar& s)
 	{
+#ifdef BT_USE_SSE
+		mVec128 = _mm_mul_ps(mVec128, _mm_set1_ps(s));
+#else
 		m_floats[0] *= s; m_floats[1] *= s; m_floats[2] *= s; m_floats[3] *= s;
+#endif
 		return *this;
 	}
 
@@ -132,17 +188,27 @@ public:
    * Equivilant to this = this * q */
 	btQuaternion& operator*=(const btQuaternion& q)
 	{
+#ifdef BT_USE_SSE
+		mVec128 = btvQuatMul(mVec128, q.mVec128);
+#else
 		setValue(m_floats[3] * q.x() + m_floats[0] * q.m_floats[3] + m_floats[1] * q.z() - m_floats[2] * q.y(),
 			m_floats[3] * q.y() + m_floats[1] * q.m_floats[3] + m_floats[2] * q.x() - m_floats[0] * q.z(),
 			m_floats[3] * q.z() + m_floats[2] * q.m_floats[3] + m_floats[0] * q.y() - m_floats[1] * q.x(),
 			m_floats[3] * q.m_floats[3] - m_floats[0] * q.x() - m_floats[1] * q.y() - m_floats[2] * q.z());
+#endif
 		return *this;
 	}
   /**@brief Return the dot product between this quaternion and another
    * @param q The other quaternion */
 	btScalar dot(const btQuaternion& q) const
 	{
+#ifdef BT_USE_SSE
+		__m128 m = _mm_mul_ps(mVec128, q.mVec128);
+		__m128 r = _mm_add_ss(_mm_add_ss(_mm_add_ss(m, bt_splat_ps(m, 1)), _mm_movehl_ps(m, m)), bt_splat_ps(m, 3));
+		return _mm_cvtss_f32(r);
+#else
 		return m_floats[0] * q.x() + m_floats[1] * q.y() + m_floats[2] * q.z() + m_floats[3] * q.m_floats[3];
+#endif
 	}
 
   /**@brief Return the length squared of the quaternion */
@@ -169,7 +235,11 @@ public:
 	SIMD_FORCE_INLINE btQuaternion
 	operator*(const btScalar& s) const
 	{
+#ifdef BT_USE_SSE
+		return btQuaternion(_mm_mul_ps(mVec128, _mm_set1_ps(s)));
+#else
 		return btQuaternion(x() * s, y() * s, z() * s, m_floats[3] * s);
+#endif
 	}
 
 
@@ -223,7 +293,11 @@ public:
 	/**@brief Return the inverse of this quaternion */
 	btQuaternion inverse() const
 	{
+#ifdef BT_USE_SSE
+		return btQuaternion(_mm_xor_ps(mVec128, btvQuatXYZSignMask()));
+#else
 		return btQuaternion(-m_floats[0], -m_floats[1], -m_floats[2], m_floats[3]);
+#endif
 	}
 
   /**@brief Return the sum of this quaternion and the other 
@@ -324,19 +398,27 @@ public:
 /**@brief Return the product of two quaternions */
 SIMD_FORCE_INLINE btQuaternion
 operator*(const btQuaternion& q1, const btQuaternion& q2) {
+#ifdef BT_USE_SSE
+	return btQuaternion(btvQuatMul(q1.get128(), q2.get128()));
+#else
 	return btQuaternion(q1.w() * q2.x() + q1.x() * q2.w() + q1.y() * q2.z() - q1.z() * q2.y(),
 		q1.w() * q2.y() + q1.y() * q2.w() + q1.z() * q2.x() - q1.x() * q2.z(),
 		q1.w() * q2.z() + q1.z() * q2.w() + q1.x() * q2.y() - q1.y() * q2.x(),
 		q1.w() * q2.w() - q1.x() * q2.x() - q1.y() * q2.y() - q1.z() * q2.z()); 
+#endif
 }
 
 SIMD_FORCE_INLINE btQuaternion
 operator*(const btQuaternion& q, const btVector3& w)
 {
+#ifdef BT_USE_SSE
+	return btQuaternion(btvQuatMulVec(q.get128(), w.get128()));
+#else
 	return btQuaternion( q.w() * w.x() + q.y() * w.z() - q.z() * w.y(),
 		q.w() * w.y() + q.z() * w.x() - q.x() * w.z(),
 		q.w() * w.z() + q.x() * w.y() - q.y() * w.x(),
 		-q.x() * w.x() - q.y() * w.y() - q.z() * w.z()); 
+#endif
 }
 
 SIMD_FORCE_INLINE btQuaternion
@@ -393,7 +475,11 @@ quatRotate(const btQuaternion& rotation, const btVector3& v)
 {
 	btQuaternion q = rotation * v;
 	q *= rotation.inverse();
+#ifdef BT_USE_SSE
+	return btVector3(_mm_and_ps(q.get128(), btvFFF0Mask()));
+#else
 	return btVector3(q.getX(),q.getY(),q.getZ());
+#endif
 }
 
 SIMD_FORCE_INLINE btQuaternion 
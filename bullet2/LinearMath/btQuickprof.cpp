@@ -17,6 +17,11 @@
 
 #ifndef BT_NO_PROFILE
 
+#include "btThreads.h"
+#include "btAlignedObjectArray.h"
+#include "btMinMax.h"
+#include <string.h>
+
 
 static btClock gProfileClock;
 
@@ -239,18 +244,83 @@ unsigned long int btClock::getTimeMicroseconds()
 
 
 
-inline void Profile_Get_Ticks(unsigned long int * ticks)
+#if !defined(BT_NO_PROFILE_TSC) && !defined(__CELLOS_LV2__) && (defined(__i386__) || defined(__x86_64__) || defined(_M_IX86) || defined(_M_X64))
+//the time stamp counter is read in a few cycles, gettimeofday and QueryPerformanceCounter take much longer
+#define BT_PROFILE_USE_TSC 1
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+#ifdef BT_PROFILE_USE_TSC
+
+static inline btProfileTicks Profile_Read_Tsc()
+{
+#ifdef _MSC_VER
+	return __rdtsc();
+#else
+	unsigned int lo,hi;
+	__asm__ __volatile__ ("rdtsc" : "=a" (lo), "=d" (hi));
+	return (btProfileTicks(hi)<<32) | lo;
+#endif
+}
+
+//the tick rate is measured against a clock started together with the counter
+static btClock gCalibrationClock;
+static btProfileTicks gCalibrationTicks = Profile_Read_Tsc();
+static double gTickRate = 0.;
+//the rate measured so far, kept until the next Reset so all the times read between two resets agree
+static double gTickRateEstimate = 0.;
+
+inline void Profile_Get_Ticks(btProfileTicks * ticks)
+{
+	*ticks = Profile_Read_Tsc();
+}
+
+///ticks per millisecond
+static double Profile_Get_Tick_Rate(void)
+{
+	if (gTickRate > 0.)
+		return gTickRate;
+	if (gTickRateEstimate > 0.)
+		return gTickRateEstimate;
+	unsigned long int us = gCalibrationClock.getTimeMicroseconds();
+	while (us < 10000)
+	{
+		us = gCalibrationClock.getTimeMicroseconds();
+	}
+	double rate = double(Profile_Read_Tsc() - gCalibrationTicks) * 1000. / double(us);
+	//after a second the rate is accurate enough, keep it
+	if (us >= 1000000)
+		gTickRate = rate;
+	else
+		gTickRateEstimate = rate;
+	return rate;
+}
+
+static void Profile_Refine_Tick_Rate(void)
+{
+	gTickRateEstimate = 0.;
+}
+
+#else
+
+inline void Profile_Get_Ticks(btProfileTicks * ticks)
 {
 	*ticks = gProfileClock.getTimeMicroseconds();
 }
 
-inline float Profile_Get_Tick_Rate(void)
+static double Profile_Get_Tick_Rate(void)
 {
-//	return 1000000.f;
-	return 1000.f;
+	return 1000.;
+}
 
+static void Profile_Refine_Tick_Rate(void)
+{
 }
 
+#endif //BT_PROFILE_USE_TSC
+
 
 
 /***************************************************************************************************
@@ -271,7 +341,7 @@ inline float Profile_Get_Tick_Rate(void)
 CProfileNode::CProfileNode( const char * name, CProfileNode * parent ) :
 	Name( name ),
 	TotalCalls( 0 ),
-	TotalTime( 0 ),
+	TotalTicks( 0 ),
 	StartTime( 0 ),
 	RecursionCounter( 0 ),
 	Parent( parent ),
@@ -329,7 +399,7 @@ CProfileNode * CProfileNode::Get_Sub_Node( const char * name )
 void	CProfileNode::Reset( void )
 {
 	TotalCalls = 0;
-	TotalTime = 0.0f;
+	TotalTicks = 0;
 	
 
 	if ( Child ) {
@@ -351,17 +421,46 @@ void	CProfileNode::Call( void )
 
 
 bool	CProfileNode::Return( void )
+{
+	btProfileTicks time;
+	Profile_Get_Ticks(&time);
+	return Return(time);
+}
+
+
+bool	CProfileNode::Return( btProfileTicks time )
 {
 	if ( --RecursionCounter == 0 && TotalCalls != 0 ) { 
-		unsigned long int time;
-		Profile_Get_Ticks(&time);
-		time-=StartTime;
-		TotalTime += (float)time / Profile_Get_Tick_Rate();
+		TotalTicks += time-StartTime;
 	}
 	return ( RecursionCounter == 0 );
 }
 
 
+float	CProfileNode::Get_Total_Time( void )
+{
+	return (float)(double(TotalTicks) / Profile_Get_Tick_Rate());
+}
+
+
+void	CProfileNode::Merge( CProfileNode * other )
+{
+	TotalCalls += other->TotalCalls;
+	TotalTicks += other->TotalTicks;
+	for (CProfileNode* child = other->Child; child; child = child->Sibling) {
+		Get_Sub_Node( child->Name )->Merge( child );
+	}
+}
+
+
+void	CProfileNode::Merge_Child( CProfileNode * other )
+{
+	TotalCalls += other->TotalCalls;
+	TotalTicks += other->TotalTicks;
+	Get_Sub_Node( other->Name )->Merge( other );
+}
+
+
 /***************************************************************************************************
 **
 ** CProfileIterator
@@ -423,9 +522,46 @@ void	CProfileIterator::Enter_Parent( void )
 ***************************************************************************************************/
 
 CProfileNode	CProfileManager::Root( "Root", NULL );
-CProfileNode *	CProfileManager::CurrentNode = &CProfileManager::Root;
+CProfileNode	CProfileManager::MergedRoot( "Root", NULL );
 int				CProfileManager::FrameCounter = 0;
-unsigned long int			CProfileManager::ResetTime = 0;
+btProfileTicks	CProfileManager::ResetTime = 0;
+
+///the profile tree and event ring buffer of one thread index
+struct	btProfileThread
+{
+	CProfileNode*	m_root;
+	CProfileNode*	m_currentNode;
+	btAlignedObjectArray<btProfileEvent>	m_events;
+	///number of events recorded since the last Reset, the ring buffer keeps the last m_events.size()
+	int				m_numEvents;
+
+	btProfileThread(CProfileNode* root)
+		:m_root(root),
+		m_currentNode(root),
+		m_numEvents(0)
+	{
+	}
+};
+
+static btProfileThread*	gProfileThreads[BT_MAX_THREAD_COUNT+1];
+static int				gEventCapacity = 0;
+//the event ring buffers are kept over Reset, so their times and frames count from Set_Event_Capacity
+static btProfileTicks	gEventStartTime = 0;
+static int				gEventFrame = 0;
+
+///mainRoot is the tree of thread 0
+static btProfileThread*	Profile_Get_Thread( int threadIndex, CProfileNode* mainRoot )
+{
+	btProfileThread* thread = gProfileThreads[threadIndex];
+	if (!thread)
+	{
+		//created by the thread itself, each index is used by one thread at a time
+		thread = new btProfileThread(threadIndex ? new CProfileNode( "Root", NULL ) : mainRoot);
+		thread->m_events.resize(gEventCapacity);
+		gProfileThreads[threadIndex] = thread;
+	}
+	return thread;
+}
 
 
 /***********************************************************************************************
@@ -443,11 +579,12 @@ unsigned long int			CProfileManager::ResetTime = 0;
  *=============================================================================================*/
 void	CProfileManager::Start_Profile( const char * name )
 {
-	if (name != CurrentNode->Get_Name()) {
-		CurrentNode = CurrentNode->Get_Sub_Node( name );
+	btProfileThread* thread = Profile_Get_Thread(btGetCurrentThreadIndex(),&Root);
+	if (name != thread->m_currentNode->Get_Name()) {
+		thread->m_currentNode = thread->m_currentNode->Get_Sub_Node( name );
 	} 
 	
-	CurrentNode->Call();
+	thread->m_currentNode->Call();
 }
 
 
@@ -456,11 +593,43 @@ void	CProfileManager::Start_Profile( const char * name )
  *=============================================================================================*/
 void	CProfileManager::Stop_Profile( void )
 {
+	btProfileTicks time;
+	Profile_Get_Ticks(&time);
+	btProfileThread* thread = Profile_Get_Thread(btGetCurrentThreadIndex(),&Root);
+	CProfileNode* node = thread->m_currentNode;
 	// Return will indicate whether we should back up to our parent (we may
 	// be profiling a recursive function)
-	if (CurrentNode->Return()) {
-		CurrentNode = CurrentNode->Get_Parent();
+	if (node->Return(time)) {
+		if (thread->m_events.size()) {
+			btProfileEvent& event = thread->m_events[thread->m_numEvents % thread->m_events.size()];
+			event.m_name = node->Get_Name();
+			event.m_startTicks = node->Get_Start_Ticks();
+			event.m_endTicks = time;
+			event.m_frame = gEventFrame;
+			thread->m_numEvents++;
+		}
+		thread->m_currentNode = node->Get_Parent();
+	}
+}
+
+
+void	CProfileManager::CleanupMemory( void )
+{
+	for (int i=0;i<=BT_MAX_THREAD_COUNT;i++)
+	{
+		if (gProfileThreads[i])
+		{
+			//the tree of thread 0 is Root
+			if (i)
+			{
+				delete gProfileThreads[i]->m_root;
+			}
+			delete gProfileThreads[i];
+			gProfileThreads[i] = 0;
+		}
 	}
+	Root.CleanupMemory();
+	MergedRoot.CleanupMemory();
 }
 
 
@@ -472,6 +641,14 @@ void	CProfileManager::Stop_Profile( void )
 void	CProfileManager::Reset( void )
 { 
 	gProfileClock.reset();
+	Profile_Refine_Tick_Rate();
+	for (int i=1;i<=BT_MAX_THREAD_COUNT;i++)
+	{
+		if (gProfileThreads[i])
+		{
+			gProfileThreads[i]->m_root->Reset();
+		}
+	}
 	Root.Reset();
     Root.Call();
 	FrameCounter = 0;
@@ -485,6 +662,7 @@ void	CProfileManager::Reset( void )
 void CProfileManager::Increment_Frame_Counter( void )
 {
 	FrameCounter++;
+	gEventFrame++;
 }
 
 
@@ -493,12 +671,121 @@ void CProfileManager::Increment_Frame_Counter( void )
  *=============================================================================================*/
 float CProfileManager::Get_Time_Since_Reset( void )
 {
-	unsigned long int time;
+	btProfileTicks time;
 	Profile_Get_Ticks(&time);
-	time -= ResetTime;
-	return (float)time / Profile_Get_Tick_Rate();
+	return (float)Get_Time_Since_Reset(time);
+}
+
+
+double CProfileManager::Get_Time_Since_Reset( btProfileTicks ticks )
+{
+	return double((long long int)(ticks - ResetTime)) / Profile_Get_Tick_Rate();
+}
+
+
+CProfileIterator *	CProfileManager::Get_Thread_Iterator( int threadIndex )
+{
+	if (threadIndex == 0)
+		return Get_Iterator();
+	if (threadIndex < 0 || threadIndex > BT_MAX_THREAD_COUNT || !gProfileThreads[threadIndex])
+		return 0;
+	return new CProfileIterator( gProfileThreads[threadIndex]->m_root );
+}
+
+
+static bool	Profile_Is_Thread_Node( const char* name );
+
+///depth first search for a node called name, by pointer and then by string compare, not entering the nodes of the scheduler threads
+static CProfileNode*	Profile_Find_Node( CProfileNode* node, const char* name )
+{
+	for (CProfileNode* child = node->Get_Child(); child; child = child->Get_Sibling())
+	{
+		if (Profile_Is_Thread_Node(child->Get_Name()))
+			continue;
+		if (child->Get_Name() == name || !strcmp(child->Get_Name(),name))
+			return child;
+		CProfileNode* found = Profile_Find_Node(child,name);
+		if (found)
+			return found;
+	}
+	return 0;
+}
+
+
+static char	gProfileThreadNodeNames[BT_MAX_THREAD_COUNT+1][16];
+
+///the static name of the merged node holding the samples of a scheduler thread
+static const char*	Profile_Get_Thread_Node_Name( int threadIndex )
+{
+	if (!gProfileThreadNodeNames[threadIndex][0])
+		sprintf(gProfileThreadNodeNames[threadIndex],"thread %d",threadIndex);
+	return gProfileThreadNodeNames[threadIndex];
+}
+
+static bool	Profile_Is_Thread_Node( const char* name )
+{
+	return name >= gProfileThreadNodeNames[0] && name < gProfileThreadNodeNames[BT_MAX_THREAD_COUNT+1];
+}
+
+
+CProfileIterator *	CProfileManager::Get_Merged_Iterator( void )
+{
+	MergedRoot.CleanupMemory();
+	MergedRoot.Reset();
+	MergedRoot.Merge( &Root );
+	for (int i=1;i<=BT_MAX_THREAD_COUNT;i++)
+	{
+		if (!gProfileThreads[i])
+			continue;
+		//the top level samples of a scheduler thread run inside a parallelFor of the main thread, which usually
+		//takes the same samples for its own share of the loop: they go in a node of the thread next to that sample,
+		//the time of the threads overlaps the time of the main thread and is not part of the time of the parent
+		const char* threadName = Profile_Get_Thread_Node_Name(i);
+		for (CProfileNode* child = gProfileThreads[i]->m_root->Get_Child(); child; child = child->Get_Sibling())
+		{
+			CProfileNode* node = Profile_Find_Node( &MergedRoot, child->Get_Name() );
+			CProfileNode* parent = node ? node->Get_Parent() : &MergedRoot;
+			parent->Get_Sub_Node( threadName )->Merge_Child( child );
+		}
+	}
+	return new CProfileIterator( &MergedRoot );
+}
+
+
+void	CProfileManager::Set_Event_Capacity( int eventsPerThread )
+{
+	gEventCapacity = eventsPerThread > 0 ? eventsPerThread : 0;
+	gEventFrame = 0;
+	Profile_Get_Ticks(&gEventStartTime);
+	for (int i=0;i<=BT_MAX_THREAD_COUNT;i++)
+	{
+		if (gProfileThreads[i])
+		{
+			gProfileThreads[i]->m_events.resize(gEventCapacity);
+			gProfileThreads[i]->m_numEvents = 0;
+		}
+	}
+}
+
+
+int	CProfileManager::Get_Num_Events( int threadIndex )
+{
+	const btProfileThread* thread = gProfileThreads[threadIndex];
+	if (!thread)
+		return 0;
+	return btMin(thread->m_numEvents,thread->m_events.size());
+}
+
+
+const btProfileEvent&	CProfileManager::Get_Event( int threadIndex, int index )
+{
+	const btProfileThread* thread = gProfileThreads[threadIndex];
+	int capacity = thread->m_events.size();
+	int first = thread->m_numEvents > capacity ? thread->m_numEvents - capacity : 0;
+	return thread->m_events[(first + index) % capacity];
 }
 
+
 #include <stdio.h>
 
 void	CProfileManager::dumpRecursive(CProfileIterator* profileIterator, int spacing)
@@ -523,7 +810,9 @@ void	CProfileManager::dumpRecursive(CProfileIterator* profileIterator, int spaci
 	{
 		numChildren++;
 		float current_total_time = profileIterator->Get_Current_Total_Time();
-		accumulated_time += current_total_time;
+		//the merged samples of other threads run in parallel with the parent
+		if (!Profile_Is_Thread_Node(profileIterator->Get_Current_Name()))
+			accumulated_time += current_total_time;
 		float fraction = parent_time > SIMD_EPSILON ? (current_total_time / parent_time) * 100 : 0.f;
 		{
 			int i;	for (i=0;i<spacing;i++)	printf(".");
@@ -558,6 +847,79 @@ void	CProfileManager::dumpAll()
 	dumpRecursive(profileIterator,0);
 
 	CProfileManager::Release_Iterator(profileIterator);
+
+	for (int i=1;i<=BT_MAX_THREAD_COUNT;i++)
+	{
+		profileIterator = Get_Thread_Iterator(i);
+		if (profileIterator)
+		{
+			profileIterator->First();
+			if (!profileIterator->Is_Done())
+			{
+				printf("Thread %d\n",i);
+				dumpRecursive(profileIterator,0);
+			}
+			Release_Iterator(profileIterator);
+		}
+	}
+}
+
+
+
+void	CProfileManager::dumpMerged()
+{
+	CProfileIterator* profileIterator = Get_Merged_Iterator();
+	printf("All threads\n");
+	dumpRecursive(profileIterator,0);
+	Release_Iterator(profileIterator);
+}
+
+
+static void	Profile_Write_Json_String(FILE* file, const char* text)
+{
+	fputc('"',file);
+	for (const char* c = text; *c; c++)
+	{
+		if (*c == '"' || *c == '\\')
+			fputc('\\',file);
+		if ((unsigned char)*c >= 32)
+			fputc(*c,file);
+	}
+	fputc('"',file);
+}
+
+
+bool	CProfileManager::dumpTraceEvents( const char* fileName )
+{
+	FILE* file = fopen(fileName,"w");
+	if (!file)
+		return false;
+	fprintf(file,"{\"traceEvents\":[\n");
+	bool first = true;
+	for (int i=0;i<=BT_MAX_THREAD_COUNT;i++)
+	{
+		int numEvents = Get_Num_Events(i);
+		if (!numEvents)
+			continue;
+		fprintf(file,"%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":%d,\"args\":{\"name\":\"%s %d\"}}",
+			first ? "" : ",\n",i,i ? "worker" : "main",i);
+		first = false;
+		for (int j=0;j<numEvents;j++)
+		{
+			const btProfileEvent& event = Get_Event(i,j);
+			//timestamps in microseconds since Set_Event_Capacity
+			double start = double((long long int)(event.m_startTicks - gEventStartTime)) * 1000. / Profile_Get_Tick_Rate();
+			double duration = double(event.m_endTicks - event.m_startTicks) * 1000. / Profile_Get_Tick_Rate();
+			fprintf(file,",\n{\"name\":");
+			Profile_Write_Json_String(file,event.m_name);
+			fprintf(file,",\"ph\":\"X\",\"pid\":0,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f,\"args\":{\"frame\":%d}}",
+				i,start,duration,event.m_frame);
+		}
+	}
+	fprintf(file,"\n],\"displayTimeUnit\":\"ms\"}\n");
+	bool ok = !ferror(file);
+	fclose(file);
+	return ok;
 }
 
 
@@ -58,7 +58,17 @@ private:
 
 #endif //USE_BT_CLOCK
 
+///profile timestamps, in ticks of the time stamp counter on x86 (unless BT_NO_PROFILE_TSC is defined), else in microseconds
+typedef unsigned long long int btProfileTicks;
 
+///one completed sample in the event ring buffer of a thread, see CProfileManager::Set_Event_Capacity
+struct btProfileEvent
+{
+	const char*		m_name;
+	btProfileTicks	m_startTicks;
+	btProfileTicks	m_endTicks;
+	int				m_frame;
+};
 
 
 ///A node in the Profile Hierarchy Tree
@@ -78,18 +88,28 @@ public:
 	void				Reset( void );
 	void				Call( void );
 	bool				Return( void );
+	///as Return, with the current time already read
+	bool				Return( btProfileTicks time );
+
+	///adds the calls and time of other to this node, and merges the children of other into the children of this node
+	void				Merge( CProfileNode * other );
+	///adds the calls and time of other to this node, and merges other into the child of this node with the same name
+	void				Merge_Child( CProfileNode * other );
 
 	const char *	Get_Name( void )				{ return Name; }
 	int				Get_Total_Calls( void )		{ return TotalCalls; }
-	float				Get_Total_Time( void )		{ return TotalTime; }
+	///in milliseconds
+	float				Get_Total_Time( void );
+	btProfileTicks		Get_Total_Ticks( void )		{ return TotalTicks; }
+	btProfileTicks		Get_Start_Ticks( void )		{ return StartTime; }
 	void*			GetUserPointer() const {return m_userPtr;}
 	void			SetUserPointer(void* ptr) { m_userPtr = ptr;}
 protected:
 
 	const char *	Name;
 	int				TotalCalls;
-	float				TotalTime;
-	unsigned long int			StartTime;
+	btProfileTicks	TotalTicks;
+	btProfileTicks	StartTime;
 	int				RecursionCounter;
 
 	CProfileNode *	Parent;
@@ -137,16 +157,17 @@ protected:
 };
 
 
-///The Manager for the Profile system
+///The Manager for the Profile system.
+///Every thread index (btGetCurrentThreadIndex) records into a profile tree of its own: the main thread into the tree
+///of Get_Iterator, the threads of a task scheduler into the trees of Get_Thread_Iterator. Samples are only taken on the
+///main thread and on scheduler threads, other threads share index 0 with the main thread and must not profile.
+///Reset, the iterators and the dump functions must be called while no other thread is profiling, for example between steps.
 class	CProfileManager {
 public:
 	static	void						Start_Profile( const char * name );
 	static	void						Stop_Profile( void );
 
-	static	void						CleanupMemory(void)
-	{
-		Root.CleanupMemory();
-	}
+	static	void						CleanupMemory(void);
 
 	static	void						Reset( void );
 	static	void						Increment_Frame_Counter( void );
@@ -160,15 +181,41 @@ public:
 	}
 	static	void						Release_Iterator( CProfileIterator * iterator ) { delete ( iterator); }
 
+	///iterator over the tree of the thread with index threadIndex (0 is the main thread), or 0 when that thread never profiled
+	static	CProfileIterator *	Get_Thread_Iterator( int threadIndex );
+
+	///iterator over the sum of the trees of all threads. The top level samples of a scheduler thread are merged into a
+	///"thread <index>" node next to the first sample of the main thread with the same name (or at the top level). The time
+	///of those nodes overlaps the time of their parent, dumpRecursive leaves it out of the unaccounted time.
+	static	CProfileIterator *	Get_Merged_Iterator( void );
+
+	///keeps the last eventsPerThread completed samples of each thread in a ring buffer, for dumpTraceEvents. 0 disables the ring buffers.
+	///Reset does not clear the ring buffers, so they hold the samples of the last frames.
+	static	void						Set_Event_Capacity( int eventsPerThread );
+
+	///the events in the ring buffer of a thread, oldest first
+	static	int						Get_Num_Events( int threadIndex );
+	static	const btProfileEvent&	Get_Event( int threadIndex, int index );
+
+	///milliseconds from the last Reset to ticks
+	static	double					Get_Time_Since_Reset( btProfileTicks ticks );
+
+	///writes the events in the ring buffers as a trace event JSON file, as read by chrome://tracing. Returns false when the file can not be written.
+	static	bool						dumpTraceEvents( const char* fileName );
+
 	static void	dumpRecursive(CProfileIterator* profileIterator, int spacing);
 
+	///prints the tree of the main thread and the trees of the scheduler threads
 	static void	dumpAll();
 
+	///prints the merged tree of all threads
+	static void	dumpMerged();
+
 private:
 	static	CProfileNode			Root;
-	static	CProfileNode *			CurrentNode;
+	static	CProfileNode			MergedRoot;
 	static	int						FrameCounter;
-	static	unsigned long int					ResetTime;
+	static	btProfileTicks			ResetTime;
 };
 
 
@@ -67,7 +67,7 @@ inline int	btGetVersion()
  			#define btFsel(a,b,c) __fsel((a),(b),(c))
 		#else
 
-#if (defined (_WIN32) && (_MSC_VER) && _MSC_VER >= 1400) && (!defined (BT_USE_DOUBLE_PRECISION))
+#if (defined (_WIN32) && (_MSC_VER) && _MSC_VER >= 1400) && (!defined (BT_USE_DOUBLE_PRECISION)) && (!defined (BT_DISABLE_SSE))
 			#define BT_USE_SSE
 			#include <emmintrin.h>
 #endif
@@ -143,7 +143,8 @@ inline int	btGetVersion()
 #else
 	//non-windows systems
 
-#if (defined (__APPLE__) && defined (__i386__) && (!defined (BT_USE_DOUBLE_PRECISION)))
+///GCC and Clang builds use SSE when the target has SSE2 (always true on x86-64). Define BT_DISABLE_SSE to use the scalar implementation.
+#if ((defined (__APPLE__) && defined (__i386__)) || ((defined (__GNUC__) || defined (__clang__)) && defined (__SSE2__))) && (!defined (BT_USE_DOUBLE_PRECISION)) && (!defined (BT_DISABLE_SSE))
 	#define BT_USE_SSE
 	#include <emmintrin.h>
 
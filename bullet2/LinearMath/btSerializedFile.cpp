@@ -0,0 +1,739 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2009 Erwin Coumans  http://bulletphysics.org
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include "btSerializedFile.h"
+#include "btSerializer.h"
+#include "btAlignedAllocator.h"
+#include "btMinMax.h"
+#include <string.h>
+#include <stdio.h>
+
+#if defined(_WIN32)
+#define BT_USE_WIN32_FILE_MAPPING 1
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#elif defined(__unix__) || defined(__APPLE__)
+#define BT_USE_MMAP 1
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#if defined(_MSC_VER)
+typedef unsigned __int64 btFileUint64;
+#else
+typedef unsigned long long int btFileUint64;
+#endif
+
+///how the file data of a btSerializedFile is held
+enum btFileStorage
+{
+	BT_FILE_NONE = 0,
+	BT_FILE_MAPPED,
+	BT_FILE_ALLOCATED,
+	BT_FILE_EXTERNAL
+};
+
+static bool btIsHostLittleEndian()
+{
+	int littleEndian = 1;
+	return ((char*)&littleEndian)[0] != 0;
+}
+
+///copies size bytes, reversing their order when swap is set
+static void btCopyBytes(const char* src,char* dst,int size,bool swap)
+{
+	if (swap)
+	{
+		for (int i=0;i<size;i++)
+		{
+			dst[i] = src[size-1-i];
+		}
+	} else
+	{
+		memcpy(dst,src,size);
+	}
+}
+
+static int btReadInt(const char* src,bool swap)
+{
+	int value;
+	btCopyBytes(src,(char*)&value,4,swap);
+	return value;
+}
+
+static int btReadShort(const char* src,bool swap)
+{
+	unsigned short value;
+	btCopyBytes(src,(char*)&value,2,swap);
+	return value;
+}
+
+static btFileUint64 btReadPointer(const char* src,int pointerSize,bool swap)
+{
+	if (pointerSize==8)
+	{
+		btFileUint64 value;
+		btCopyBytes(src,(char*)&value,8,swap);
+		return value;
+	}
+	unsigned int value;
+	btCopyBytes(src,(char*)&value,4,swap);
+	return value;
+}
+
+static void btWritePointer(btFileUint64 value,char* dst,int pointerSize,bool swap)
+{
+	if (pointerSize==8)
+	{
+		btCopyBytes((const char*)&value,dst,8,swap);
+	} else
+	{
+		unsigned int value32 = (unsigned int)value;
+		btCopyBytes((const char*)&value32,dst,4,swap);
+	}
+}
+
+///number of elements of a member name like m_floats[4] or m_el[3][3]
+static int btGetArrayLength(const char* name)
+{
+	int length = 1;
+	for (const char* cp=name;*cp;cp++)
+	{
+		if (*cp=='[')
+		{
+			int dim = 0;
+			for (cp++;*cp>='0' && *cp<='9';cp++)
+			{
+				dim = dim*10+(*cp-'0');
+			}
+			length *= dim;
+			if (!*cp)
+				break;
+		}
+	}
+	return length;
+}
+
+
+bool	btSerializedDna::init(const char* dna,int dnaLength,int pointerSize,bool swapDna,bool swapData)
+{
+	m_names.clear();
+	m_types.clear();
+	m_typeLengths.clear();
+	m_typeStructs.clear();
+	m_structs.clear();
+	m_members.clear();
+	m_structLookup.clear();
+	m_pointerSize = pointerSize;
+	m_swapData = swapData;
+
+	/*
+		SDNA NAME <nr> <string>... TYPE <nr> <string>... TLEN <short>... STRC <nr> (<type> <nr_of_elems> (<type> <name>)...)...
+		Each block starts 4 byte aligned.
+	*/
+	const char* end = dna+dnaLength;
+	const char* cp = dna;
+	if (dnaLength<12 || strncmp(cp,"SDNA",4) || strncmp(cp+4,"NAME",4))
+		return false;
+	cp += 8;
+	int numNames = btReadInt(cp,swapDna);
+	cp += 4;
+	if (numNames<0)
+		return false;
+	int i;
+	for (i=0;i<numNames;i++)
+	{
+		m_names.push_back(cp);
+		while (cp<end && *cp)
+			cp++;
+		if (cp>=end)
+			return false;
+		cp++;
+	}
+	cp = dna+((cp-dna+3)&~3);
+
+	if (cp+8>end || strncmp(cp,"TYPE",4))
+		return false;
+	int numTypes = btReadInt(cp+4,swapDna);
+	cp += 8;
+	if (numTypes<0)
+		return false;
+	for (i=0;i<numTypes;i++)
+	{
+		m_types.push_back(cp);
+		while (cp<end && *cp)
+			cp++;
+		if (cp>=end)
+			return false;
+		cp++;
+	}
+	cp = dna+((cp-dna+3)&~3);
+
+	if (cp+4+2*numTypes>end || strncmp(cp,"TLEN",4))
+		return false;
+	cp += 4;
+	for (i=0;i<numTypes;i++,cp+=2)
+	{
+		m_typeLengths.push_back(btReadShort(cp,swapDna));
+		m_typeStructs.push_back(-1);
+	}
+	cp = dna+((cp-dna+3)&~3);
+
+	if (cp+8>end || strncmp(cp,"STRC",4))
+		return false;
+	int numStructs = btReadInt(cp+4,swapDna);
+	cp += 8;
+	if (numStructs<0)
+		return false;
+	for (i=0;i<numStructs;i++)
+	{
+		if (cp+4>end)
+			return false;
+		Struct strc;
+		strc.m_type = btReadShort(cp,swapDna);
+		strc.m_numMembers = btReadShort(cp+2,swapDna);
+		strc.m_firstMember = m_members.size();
+		strc.m_hasPointers = false;
+		cp += 4;
+		if (strc.m_type>=numTypes || cp+4*strc.m_numMembers>end)
+			return false;
+		strc.m_size = m_typeLengths[strc.m_type];
+
+		int offset = 0;
+		for (int j=0;j<strc.m_numMembers;j++,cp+=4)
+		{
+			Member member;
+			member.m_type = btReadShort(cp,swapDna);
+			int name = btReadShort(cp+2,swapDna);
+			if (member.m_type>=numTypes || name>=numNames)
+				return false;
+			member.m_name = m_names[name];
+			member.m_isPointer = member.m_name[0]=='*' || member.m_name[0]=='(';
+			member.m_elementSize = member.m_isPointer ? pointerSize : m_typeLengths[member.m_type];
+			member.m_arrayLength = btGetArrayLength(member.m_name);
+			member.m_offset = offset;
+			offset += member.m_elementSize*member.m_arrayLength;
+			m_members.push_back(member);
+		}
+		//the members have to fill the struct exactly, as there is no implicit padding in serialization structs
+		if (offset != strc.m_size)
+			return false;
+		m_typeStructs[strc.m_type] = m_structs.size();
+		m_structLookup.insert(btHashString(m_types[strc.m_type]),m_structs.size());
+		m_structs.push_back(strc);
+	}
+
+	for (i=0;i<m_structs.size();i++)
+	{
+		m_structs[i].m_hasPointers = findPointers(i,0);
+	}
+	return true;
+}
+
+bool	btSerializedDna::initNative()
+{
+	if (sizeof(void*)==8)
+		return init(sBulletDNAstr64,sBulletDNAlen64,8,!btIsHostLittleEndian(),false);
+	return init(sBulletDNAstr,sBulletDNAlen,4,!btIsHostLittleEndian(),false);
+}
+
+bool	btSerializedDna::findPointers(int structIndex,int depth)
+{
+	//guard against structs that (through corrupt data) contain themselves
+	if (depth>m_structs.size())
+		return false;
+	const Struct& strc = m_structs[structIndex];
+	for (int j=0;j<strc.m_numMembers;j++)
+	{
+		const Member& member = m_members[strc.m_firstMember+j];
+		if (member.m_isPointer)
+			return true;
+		int sub = m_typeStructs[member.m_type];
+		if (sub>=0 && findPointers(sub,depth+1))
+			return true;
+	}
+	return false;
+}
+
+int		btSerializedDna::findStruct(const char* typeName) const
+{
+	const int* structIndex = m_structLookup.find(btHashString(typeName));
+	return structIndex ? *structIndex : -1;
+}
+
+bool	btSerializedDna::hasSameLayout(int structIndex,const btSerializedDna& otherDna,int otherStruct) const
+{
+	if (m_swapData != otherDna.m_swapData)
+		return false;
+	const Struct& a = m_structs[structIndex];
+	const Struct& b = otherDna.m_structs[otherStruct];
+	if (a.m_size != b.m_size || a.m_numMembers != b.m_numMembers)
+		return false;
+	for (int j=0;j<a.m_numMembers;j++)
+	{
+		const Member& ma = m_members[a.m_firstMember+j];
+		const Member& mb = otherDna.m_members[b.m_firstMember+j];
+		if (ma.m_offset != mb.m_offset || ma.m_elementSize != mb.m_elementSize || ma.m_arrayLength != mb.m_arrayLength ||
+			ma.m_isPointer != mb.m_isPointer || strcmp(ma.m_name,mb.m_name) || strcmp(m_types[ma.m_type],otherDna.m_types[mb.m_type]))
+			return false;
+		if (!ma.m_isPointer)
+		{
+			int subA = m_typeStructs[ma.m_type];
+			int subB = otherDna.m_typeStructs[mb.m_type];
+			if ((subA>=0) != (subB>=0))
+				return false;
+			if (subA>=0 && !hasSameLayout(subA,otherDna,subB))
+				return false;
+		}
+	}
+	return true;
+}
+
+void	btSerializedDna::convertStructs(int structIndex,const char* src,const btSerializedDna& toDna,int toStruct,char* dst,int numElements) const
+{
+	const Struct& from = m_structs[structIndex];
+	const Struct& to = toDna.m_structs[toStruct];
+	const bool swap = m_swapData != toDna.m_swapData;
+
+	//match the members once, by name
+	btAlignedObjectArray<int> sourceMembers;
+	sourceMembers.resize(to.m_numMembers);
+	int j;
+	for (j=0;j<to.m_numMembers;j++)
+	{
+		const Member& toMember = toDna.m_members[to.m_firstMember+j];
+		sourceMembers[j] = -1;
+		for (int k=0;k<from.m_numMembers;k++)
+		{
+			const Member& member = m_members[from.m_firstMember+k];
+			if (!strcmp(member.m_name,toMember.m_name) && member.m_isPointer==toMember.m_isPointer &&
+				(member.m_isPointer || !strcmp(m_types[member.m_type],toDna.m_types[toMember.m_type])))
+			{
+				sourceMembers[j] = from.m_firstMember+k;
+				break;
+			}
+		}
+	}
+
+	for (int e=0;e<numElements;e++)
+	{
+		const char* srcElement = src+e*from.m_size;
+		char* dstElement = dst+e*to.m_size;
+		memset(dstElement,0,to.m_size);
+		for (j=0;j<to.m_numMembers;j++)
+		{
+			if (sourceMembers[j]<0)
+				continue;
+			const Member& toMember = toDna.m_members[to.m_firstMember+j];
+			const Member& member = m_members[sourceMembers[j]];
+			const int count = btMin(member.m_arrayLength,toMember.m_arrayLength);
+			const char* srcMember = srcElement+member.m_offset;
+			char* dstMember = dstElement+toMember.m_offset;
+			if (member.m_isPointer)
+			{
+				for (int i=0;i<count;i++)
+				{
+					btWritePointer(btReadPointer(srcMember+i*member.m_elementSize,m_pointerSize,m_swapData),dstMember+i*toMember.m_elementSize,toDna.m_pointerSize,toDna.m_swapData);
+				}
+				continue;
+			}
+			int sub = m_typeStructs[member.m_type];
+			int toSub = toDna.m_typeStructs[toMember.m_type];
+			if (sub>=0 && toSub>=0)
+			{
+				convertStructs(sub,srcMember,toDna,toSub,dstMember,count);
+			} else if (sub<0 && toSub<0 && member.m_elementSize==toMember.m_elementSize)
+			{
+				for (int i=0;i<count;i++)
+				{
+					btCopyBytes(srcMember+i*member.m_elementSize,dstMember+i*toMember.m_elementSize,member.m_elementSize,swap);
+				}
+			}
+		}
+	}
+}
+
+
+btSerializedFile::btSerializedFile()
+	:m_fileData(0),
+	m_fileLength(0),
+	m_storage(BT_FILE_NONE),
+	m_fileHandle(0),
+	m_mappingHandle(0),
+	m_doublePrecision(false),
+	m_version(0),
+	m_native(false),
+	m_inPlaceBytes(0),
+	m_copiedBytes(0),
+	m_error(0)
+{
+}
+
+btSerializedFile::~btSerializedFile()
+{
+	unload();
+}
+
+void	btSerializedFile::unload()
+{
+	for (int i=0;i<m_allocations.size();i++)
+	{
+		btAlignedFree(m_allocations[i]);
+	}
+	m_allocations.clear();
+	m_chunks.clear();
+	m_pointerMap.clear();
+	m_nativeStructs.clear();
+	m_sameLayout.clear();
+
+	switch (m_storage)
+	{
+	case BT_FILE_MAPPED:
+#if defined(BT_USE_WIN32_FILE_MAPPING)
+		UnmapViewOfFile(m_fileData);
+		CloseHandle((HANDLE)m_mappingHandle);
+		CloseHandle((HANDLE)m_fileHandle);
+#elif defined(BT_USE_MMAP)
+		munmap(m_fileData,m_fileLength);
+#endif
+		break;
+	case BT_FILE_ALLOCATED:
+		btAlignedFree(m_fileData);
+		break;
+	default:
+		break;
+	}
+	m_storage = BT_FILE_NONE;
+	m_fileData = 0;
+	m_fileLength = 0;
+	m_fileHandle = 0;
+	m_mappingHandle = 0;
+	m_native = false;
+	m_inPlaceBytes = 0;
+	m_copiedBytes = 0;
+}
+
+bool	btSerializedFile::loadFile(const char* fileName)
+{
+	unload();
+	m_error = 0;
+
+#if defined(BT_USE_WIN32_FILE_MAPPING)
+	HANDLE file = CreateFileA(fileName,GENERIC_READ,FILE_SHARE_READ,0,OPEN_EXISTING,FILE_ATTRIBUTE_NORMAL,0);
+	if (file==INVALID_HANDLE_VALUE)
+	{
+		m_error = "cannot open file";
+		return false;
+	}
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(file,&size) || !size.QuadPart)
+	{
+		CloseHandle(file);
+		m_error = "cannot read file";
+		return false;
+	}
+	//copy on write, so resolving data in place never changes the file
+	HANDLE mapping = CreateFileMappingA(file,0,PAGE_WRITECOPY,0,0,0);
+	void* view = mapping ? MapViewOfFile(mapping,FILE_MAP_COPY,0,0,0) : 0;
+	if (!view)
+	{
+		if (mapping)
+			CloseHandle(mapping);
+		CloseHandle(file);
+		m_error = "cannot map file";
+		return false;
+	}
+	m_fileData = (char*)view;
+	m_fileLength = size_t(size.QuadPart);
+	m_fileHandle = file;
+	m_mappingHandle = mapping;
+	m_storage = BT_FILE_MAPPED;
+#elif defined(BT_USE_MMAP)
+	int fd = open(fileName,O_RDONLY);
+	if (fd<0)
+	{
+		m_error = "cannot open file";
+		return false;
+	}
+	struct stat fileStat;
+	if (fstat(fd,&fileStat) || !fileStat.st_size)
+	{
+		close(fd);
+		m_error = "cannot read file";
+		return false;
+	}
+	//private mapping: pages written to are copied, the file is never changed
+	void* view = mmap(0,size_t(fileStat.st_size),PROT_READ|PROT_WRITE,MAP_PRIVATE,fd,0);
+	close(fd);
+	if (view==MAP_FAILED)
+	{
+		m_error = "cannot map file";
+		return false;
+	}
+	m_fileData = (char*)view;
+	m_fileLength = size_t(fileStat.st_size);
+	m_storage = BT_FILE_MAPPED;
+#else
+	FILE* file = fopen(fileName,"rb");
+	if (!file)
+	{
+		m_error = "cannot open file";
+		return false;
+	}
+	fseek(file,0,SEEK_END);
+	long length = ftell(file);
+	fseek(file,0,SEEK_SET);
+	if (length<=0)
+	{
+		fclose(file);
+		m_error = "cannot read file";
+		return false;
+	}
+	m_fileData = (char*)btAlignedAlloc(size_t(length),16);
+	m_fileLength = size_t(length);
+	m_storage = BT_FILE_ALLOCATED;
+	size_t numRead = fread(m_fileData,1,m_fileLength,file);
+	fclose(file);
+	if (numRead != m_fileLength)
+	{
+		unload();
+		m_error = "cannot read file";
+		return false;
+	}
+#endif
+
+	if (!parse())
+	{
+		const char* error = m_error;
+		unload();
+		m_error = error;
+		return false;
+	}
+	return true;
+}
+
+bool	btSerializedFile::loadBuffer(void* buffer,int length)
+{
+	unload();
+	m_error = 0;
+	m_fileData = (char*)buffer;
+	m_fileLength = size_t(length>0 ? length : 0);
+	m_storage = BT_FILE_EXTERNAL;
+	if (!parse())
+	{
+		const char* error = m_error;
+		unload();
+		m_error = error;
+		return false;
+	}
+	return true;
+}
+
+struct btRawChunk
+{
+	int				m_code;
+	int				m_length;
+	btFileUint64	m_oldPtr;
+	int				m_dnaNr;
+	int				m_number;
+	size_t			m_dataOffset;
+};
+
+bool	btSerializedFile::parse()
+{
+	if (m_fileLength<BT_HEADER_LENGTH || strncmp(m_fileData,"BULLET",6))
+	{
+		m_error = "not a .bullet file";
+		return false;
+	}
+
+	//header: BULLET, f or d for the precision, - for 8 byte and _ for 4 byte pointers, v for little and V for big endian, version
+	if (m_fileData[6]!='f' && m_fileData[6]!='d')
+	{
+		m_error = "unknown precision";
+		return false;
+	}
+	m_doublePrecision = m_fileData[6]=='d';
+	if (m_fileData[7]!='-' && m_fileData[7]!='_')
+	{
+		m_error = "unknown pointer size";
+		return false;
+	}
+	const int pointerSize = m_fileData[7]=='-' ? 8 : 4;
+	if (m_fileData[8]!='v' && m_fileData[8]!='V')
+	{
+		m_error = "unknown byte order";
+		return false;
+	}
+	const bool swap = (m_fileData[8]=='v') != btIsHostLittleEndian();
+	m_version = 0;
+	for (int i=9;i<BT_HEADER_LENGTH;i++)
+	{
+		m_version = m_version*10+(m_fileData[i]-'0');
+	}
+
+	//chunk header: code, length, old pointer, dna index, number of elements
+	const size_t chunkHeaderLength = 16+pointerSize;
+	btAlignedObjectArray<btRawChunk> rawChunks;
+	const char* dna = 0;
+	int dnaLength = 0;
+	size_t offset = BT_HEADER_LENGTH;
+	while (offset+chunkHeaderLength<=m_fileLength)
+	{
+		const char* header = m_fileData+offset;
+		btRawChunk chunk;
+		//the code is 4 characters, which are in the same order on every platform
+		memcpy(&chunk.m_code,header,4);
+		chunk.m_length = btReadInt(header+4,swap);
+		chunk.m_oldPtr = btReadPointer(header+8,pointerSize,swap);
+		chunk.m_dnaNr = btReadInt(header+8+pointerSize,swap);
+		chunk.m_number = btReadInt(header+12+pointerSize,swap);
+		chunk.m_dataOffset = offset+chunkHeaderLength;
+		if (chunk.m_code==MAKE_ID('E','N','D','B'))
+			break;
+		if (chunk.m_length<0 || chunk.m_dataOffset+size_t(chunk.m_length)>m_fileLength)
+		{
+			m_error = "truncated chunk";
+			return false;
+		}
+		if (chunk.m_code==BT_DNA_CODE)
+		{
+			dna = m_fileData+chunk.m_dataOffset;
+			dnaLength = chunk.m_length;
+		} else
+		{
+			rawChunks.push_back(chunk);
+		}
+		offset = chunk.m_dataOffset+chunk.m_length;
+	}
+
+	//validate the dna once, then compare it struct by struct with the dna of this build
+	if (!dna || !m_fileDna.init(dna,dnaLength,pointerSize,swap,swap))
+	{
+		m_error = "missing or corrupt dna";
+		return false;
+	}
+	if (!m_nativeDna.initNative())
+	{
+		m_error = "corrupt native dna";
+		return false;
+	}
+	const char* nativeDna = sizeof(void*)==8 ? sBulletDNAstr64 : sBulletDNAstr;
+	const int nativeDnaLength = sizeof(void*)==8 ? sBulletDNAlen64 : sBulletDNAlen;
+	m_native = pointerSize==int(sizeof(void*)) && !swap && dnaLength>=nativeDnaLength && !memcmp(dna,nativeDna,nativeDnaLength);
+
+	int i;
+	for (i=0;i<m_fileDna.getNumStructs();i++)
+	{
+		const int nativeStruct = m_nativeDna.findStruct(m_fileDna.getStructName(i));
+		m_nativeStructs.push_back(nativeStruct);
+		m_sameLayout.push_back(nativeStruct>=0 && (m_native || m_fileDna.hasSameLayout(i,m_nativeDna,nativeStruct)));
+	}
+
+	for (i=0;i<rawChunks.size();i++)
+	{
+		const btRawChunk& raw = rawChunks[i];
+		btSerializedChunk chunk;
+		chunk.m_code = raw.m_code;
+		chunk.m_number = raw.m_number;
+		chunk.m_oldPtr = (const void*)size_t(raw.m_oldPtr);
+		chunk.m_data = m_fileData+raw.m_dataOffset;
+		chunk.m_inPlace = true;
+		chunk.m_dnaNr = -1;
+
+		const int fileStruct = (raw.m_dnaNr>=0 && raw.m_dnaNr<m_fileDna.getNumStructs()) ? raw.m_dnaNr : -1;
+		const int nativeStruct = fileStruct>=0 ? m_nativeStructs[fileStruct] : -1;
+		if (nativeStruct>=0)
+		{
+			const int fileStructSize = m_fileDna.getStruct(fileStruct).m_size;
+			if (raw.m_number<0 || (fileStructSize && raw.m_number>raw.m_length/fileStructSize))
+			{
+				m_error = "corrupt chunk";
+				return false;
+			}
+			chunk.m_dnaNr = nativeStruct;
+			const btSerializedDna::Struct& strc = m_nativeDna.getStruct(nativeStruct);
+			//chunks with pointers are copied, so their pointers can be resolved without writing to the file
+			chunk.m_inPlace = m_sameLayout[fileStruct] && !strc.m_hasPointers && !(size_t(chunk.m_data)&3);
+			if (!chunk.m_inPlace)
+			{
+				const size_t size = size_t(strc.m_size)*size_t(raw.m_number);
+				char* data = (char*)btAlignedAlloc(size ? size : 16,16);
+				m_allocations.push_back(data);
+				if (m_sameLayout[fileStruct])
+				{
+					memcpy(data,chunk.m_data,size);
+				} else
+				{
+					m_fileDna.convertStructs(fileStruct,(const char*)chunk.m_data,m_nativeDna,nativeStruct,data,raw.m_number);
+				}
+				chunk.m_data = data;
+				m_copiedBytes += size;
+			}
+		}
+		if (chunk.m_inPlace)
+		{
+			m_inPlaceBytes += raw.m_length;
+		}
+		m_pointerMap.insert(chunk.m_oldPtr,chunk.m_data);
+		m_chunks.push_back(chunk);
+	}
+
+	for (i=0;i<m_chunks.size();i++)
+	{
+		const btSerializedChunk& chunk = m_chunks[i];
+		if (!chunk.m_inPlace && m_nativeDna.getStruct(chunk.m_dnaNr).m_hasPointers)
+		{
+			resolvePointers(chunk.m_dnaNr,(char*)chunk.m_data,chunk.m_number);
+		}
+	}
+	return true;
+}
+
+void	btSerializedFile::resolvePointers(int structIndex,char* data,int numElements)
+{
+	const btSerializedDna::Struct& strc = m_nativeDna.getStruct(structIndex);
+	for (int e=0;e<numElements;e++)
+	{
+		char* element = data+e*strc.m_size;
+		for (int j=0;j<strc.m_numMembers;j++)
+		{
+			const btSerializedDna::Member& member = m_nativeDna.getMember(strc.m_firstMember+j);
+			char* memberData = element+member.m_offset;
+			if (member.m_isPointer)
+			{
+				for (int i=0;i<member.m_arrayLength;i++)
+				{
+					void* oldPtr;
+					memcpy(&oldPtr,memberData+i*sizeof(void*),sizeof(void*));
+					void* ptr = oldPtr ? findPointer(oldPtr) : 0;
+					memcpy(memberData+i*sizeof(void*),&ptr,sizeof(void*));
+				}
+			} else
+			{
+				const int sub = m_nativeDna.getTypeStruct(member.m_type);
+				if (sub>=0 && m_nativeDna.getStruct(sub).m_hasPointers)
+				{
+					resolvePointers(sub,memberData,member.m_arrayLength);
+				}
+			}
+		}
+	}
+}
@@ -0,0 +1,279 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2009 Erwin Coumans  http://bulletphysics.org
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef BT_SERIALIZED_FILE_H
+#define BT_SERIALIZED_FILE_H
+
+#include "btScalar.h"
+#include "btAlignedObjectArray.h"
+#include "btHashMap.h"
+
+///btSerializedDna is the parsed DNA chunk of a .bullet file: the names, sizes and members of the serialization
+///structs, for the pointer size and byte order of the platform that wrote the file.
+class btSerializedDna
+{
+public:
+
+	struct Member
+	{
+		int			m_type;
+		const char*	m_name;
+		int			m_offset;
+		///size of one element, the pointer size for pointers
+		int			m_elementSize;
+		///number of elements, more than one for arrays like m_floats[4]
+		int			m_arrayLength;
+		bool		m_isPointer;
+	};
+
+	struct Struct
+	{
+		int			m_type;
+		int			m_size;
+		int			m_firstMember;
+		int			m_numMembers;
+		///the struct or one of its nested structs has pointer members
+		bool		m_hasPointers;
+	};
+
+private:
+
+	btAlignedObjectArray<const char*>	m_names;
+	btAlignedObjectArray<const char*>	m_types;
+	btAlignedObjectArray<int>			m_typeLengths;
+	///struct index of each type, -1 for basic types
+	btAlignedObjectArray<int>			m_typeStructs;
+	btAlignedObjectArray<Struct>		m_structs;
+	btAlignedObjectArray<Member>		m_members;
+	btHashMap<btHashString,int>			m_structLookup;
+	int									m_pointerSize;
+	bool								m_swapData;
+
+	bool	findPointers(int structIndex,int depth);
+
+public:
+
+	btSerializedDna()
+		:m_pointerSize(int(sizeof(void*))),
+		m_swapData(false)
+	{
+	}
+
+	///parses and validates dna, which must stay valid while the btSerializedDna is used.
+	///swapDna tells the dna itself is stored in the other byte order, swapData that the data described by it is.
+	///Returns false when the dna is corrupt or its struct sizes do not add up.
+	bool	init(const char* dna,int dnaLength,int pointerSize,bool swapDna,bool swapData);
+
+	///the layout of the serialization structs of this build
+	bool	initNative();
+
+	int		getPointerSize() const
+	{
+		return m_pointerSize;
+	}
+
+	bool	isSwapped() const
+	{
+		return m_swapData;
+	}
+
+	int		getNumStructs() const
+	{
+		return m_structs.size();
+	}
+
+	const Struct&	getStruct(int structIndex) const
+	{
+		return m_structs[structIndex];
+	}
+
+	const Member&	getMember(int memberIndex) const
+	{
+		return m_members[memberIndex];
+	}
+
+	const char*	getTypeName(int type) const
+	{
+		return m_types[type];
+	}
+
+	const char*	getStructName(int structIndex) const
+	{
+		return m_types[m_structs[structIndex].m_type];
+	}
+
+	///returns -1 for basic types
+	int		getTypeStruct(int type) const
+	{
+		return m_typeStructs[type];
+	}
+
+	///returns the struct index, or -1
+	int		findStruct(const char* typeName) const;
+
+	///returns true when data of structIndex can be read as struct otherStruct of otherDna without conversion
+	bool	hasSameLayout(int structIndex,const btSerializedDna& otherDna,int otherStruct) const;
+
+	///converts numElements structs from the layout of this dna to struct toStruct of toDna, member by member.
+	///Members are matched by name, members missing in the source are zeroed. Pointers keep their value,
+	///truncated or extended to the pointer size of toDna.
+	void	convertStructs(int structIndex,const char* src,const btSerializedDna& toDna,int toStruct,char* dst,int numElements) const;
+};
+
+
+///btSerializedChunk is a chunk of a btSerializedFile, with its data in the layout of this build
+struct btSerializedChunk
+{
+	int			m_code;
+	///struct index in the native dna (btSerializedFile::getNativeDna), -1 for chunks of plain bytes like names
+	int			m_dnaNr;
+	int			m_number;
+	///the pointer the data had when it was written. Pointers inside the file refer to chunks by this value.
+	const void*	m_oldPtr;
+	void*		m_data;
+	///m_data points into the file itself, instead of memory owned by the btSerializedFile
+	bool		m_inPlace;
+};
+
+
+///btSerializedFile reads a .bullet file written by btDefaultSerializer without copying it.
+///The file is memory mapped and its DNA is validated once. When the layout of a struct in the file matches this build
+///(same pointer size, byte order and members), chunks of that struct are used in place, so large arrays like bvh nodes,
+///triangle indices and vertices are never copied or converted. Other chunks are converted to the layout of this build.
+///Chunks with pointer members are always copied, so their pointers can be resolved to the loaded chunks.
+///The mapping is private: writes to in place data (like a bvh refit) copy the touched pages, the file is never changed.
+class btSerializedFile
+{
+	btSerializedDna		m_fileDna;
+	btSerializedDna		m_nativeDna;
+	///native struct index of each struct of the file dna, -1 when the struct does not exist in this build
+	btAlignedObjectArray<int>	m_nativeStructs;
+	btAlignedObjectArray<char>	m_sameLayout;
+
+	btAlignedObjectArray<btSerializedChunk>	m_chunks;
+	btHashMap<btHashPtr,void*>	m_pointerMap;
+	btAlignedObjectArray<void*>	m_allocations;
+
+	char*		m_fileData;
+	size_t		m_fileLength;
+	int			m_storage;
+	void*		m_fileHandle;
+	void*		m_mappingHandle;
+
+	bool		m_doublePrecision;
+	int			m_version;
+	bool		m_native;
+	size_t		m_inPlaceBytes;
+	size_t		m_copiedBytes;
+	const char*	m_error;
+
+	bool	parse();
+	void	resolvePointers(int structIndex,char* data,int numElements);
+
+public:
+
+	btSerializedFile();
+
+	virtual ~btSerializedFile();
+
+	///maps the file and parses it. Returns false (see getError) when the file can not be read or is not a valid .bullet file.
+	bool	loadFile(const char* fileName);
+
+	///parses a .bullet file already in memory. The buffer is used in place and must stay valid until unload.
+	bool	loadBuffer(void* buffer,int length);
+
+	///releases the mapping and all converted chunks
+	void	unload();
+
+	const char*	getError() const
+	{
+		return m_error;
+	}
+
+	bool	isDoublePrecision() const
+	{
+		return m_doublePrecision;
+	}
+
+	///version number of the header, for example 280
+	int		getVersion() const
+	{
+		return m_version;
+	}
+
+	int		getPointerSize() const
+	{
+		return m_fileDna.getPointerSize();
+	}
+
+	///the file was written in the other byte order
+	bool	isSwapped() const
+	{
+		return m_fileDna.isSwapped();
+	}
+
+	///the file has the dna, pointer size and byte order of this build
+	bool	isNative() const
+	{
+		return m_native;
+	}
+
+	const btSerializedDna&	getFileDna() const
+	{
+		return m_fileDna;
+	}
+
+	const btSerializedDna&	getNativeDna() const
+	{
+		return m_nativeDna;
+	}
+
+	int		getNumChunks() const
+	{
+		return m_chunks.size();
+	}
+
+	const btSerializedChunk&	getChunk(int i) const
+	{
+		return m_chunks[i];
+	}
+
+	///the struct name of a chunk, 0 for plain bytes
+	const char*	getStructName(const btSerializedChunk& chunk) const
+	{
+		return chunk.m_dnaNr>=0 ? m_nativeDna.getStructName(chunk.m_dnaNr) : 0;
+	}
+
+	///returns the loaded data of the chunk written from oldPtr, or 0
+	void*	findPointer(const void* oldPtr) const
+	{
+		void*const* ptr = m_pointerMap.find(oldPtr);
+		return ptr ? *ptr : 0;
+	}
+
+	///bytes of chunk data used in place
+	size_t	getInPlaceBytes() const
+	{
+		return m_inPlaceBytes;
+	}
+
+	///bytes of chunk data copied or converted
+	size_t	getCopiedBytes() const
+	{
+		return m_copiedBytes;
+	}
+};
+
+#endif //BT_SERIALIZED_FILE_H
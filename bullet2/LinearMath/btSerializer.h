@@ -450,7 +450,21 @@ public:
 				unsigned char* buffer = internalAlloc(BT_HEADER_LENGTH);
 				writeHeader(buffer);
 			}
-			
+
+			///chunks are padded so their data stays 16 byte aligned in the file (see allocate). When the header does not
+			///leave the data of the first chunk aligned, a small char chunk shifts the chunks that follow it.
+			if ((BT_HEADER_LENGTH+sizeof(btChunk))&15)
+			{
+				int padding = int((16-((BT_HEADER_LENGTH+2*sizeof(btChunk))&15))&15);
+				unsigned char* ptr = internalAlloc(padding+sizeof(btChunk));
+				btChunk* chunk = (btChunk*)ptr;
+				chunk->m_oldPtr = ptr+sizeof(btChunk);
+				chunk->m_length = padding;
+				chunk->m_number = padding;
+				memset(chunk->m_oldPtr,0,padding);
+				m_chunkPtrs.push_back(chunk);
+				finalizeChunk(chunk,"char",BT_ARRAY_CODE,chunk->m_oldPtr);
+			}
 		}
 
 		virtual	void	finishSerialization()
@@ -563,14 +577,20 @@ public:
 		virtual	btChunk*	allocate(size_t size, int numElements)
 		{
 
-			unsigned char* ptr = internalAlloc(int(size)*numElements+sizeof(btChunk));
+			///pad the chunk, so the data of the next chunk starts 16 byte aligned in the file as well.
+			///Loaders can then use arrays like bvh nodes and hull vertices in place. Readers use m_number, not m_length,
+			///to find the number of elements, so the padding is ignored.
+			int length = int(size)*numElements;
+			int paddedLength = int(((length+sizeof(btChunk)+15)&~15)-sizeof(btChunk));
+			unsigned char* ptr = internalAlloc(paddedLength+sizeof(btChunk));
 
 			unsigned char* data = ptr + sizeof(btChunk);
+			memset(data+length,0,paddedLength-length);
 			
 			btChunk* chunk = (btChunk*)ptr;
 			chunk->m_chunkCode = 0;
 			chunk->m_oldPtr = data;
-			chunk->m_length = int(size)*numElements;
+			chunk->m_length = paddedLength;
 			chunk->m_number = numElements;
 			
 			m_chunkPtrs.push_back(chunk);
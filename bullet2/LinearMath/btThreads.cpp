@@ -0,0 +1,514 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2009 Erwin Coumans  http://bulletphysics.org
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include "btThreads.h"
+#include "btAlignedAllocator.h"
+#include "btMinMax.h"
+#include <new>
+
+#if defined(_WIN32)
+#define BT_USE_WIN32_THREADS 1
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#include <intrin.h>
+#elif defined(__unix__) || defined(__APPLE__)
+#define BT_USE_PTHREADS 1
+#include <pthread.h>
+#endif
+
+#if defined(_MSC_VER)
+#define BT_THREAD_LOCAL __declspec(thread)
+#else
+#define BT_THREAD_LOCAL __thread
+#endif
+
+#if defined (BT_USE_WIN32_THREADS) || defined (BT_USE_PTHREADS)
+static BT_THREAD_LOCAL unsigned int gThreadIndex = 0;
+#else
+static unsigned int gThreadIndex = 0;
+#endif
+
+unsigned int btGetCurrentThreadIndex()
+{
+	return gThreadIndex;
+}
+
+//counted before a thread is created and after it is joined, by the thread that creates and deletes it
+volatile int gNumWorkerThreads = 0;
+
+
+int	btAtomicAdd(volatile int* dest, int value)
+{
+#if defined(_MSC_VER)
+	return _InterlockedExchangeAdd((volatile long*)dest, value) + value;
+#elif defined(__GNUC__)
+	return __sync_add_and_fetch(dest, value);
+#else
+	//no threads on this platform
+	*dest += value;
+	return *dest;
+#endif
+}
+
+bool	btSpinMutex::tryLock()
+{
+#if defined(_MSC_VER)
+	return _InterlockedExchange((volatile long*)&m_lock, 1) == 0;
+#elif defined(__GNUC__)
+	return __sync_lock_test_and_set(&m_lock, 1) == 0;
+#else
+	if (m_lock)
+		return false;
+	m_lock = 1;
+	return true;
+#endif
+}
+
+void	btSpinMutex::lock()
+{
+	while (!tryLock())
+	{
+		//spin on a plain read, so the cache line is not hammered with writes
+		while (m_lock)
+		{
+		}
+	}
+}
+
+void	btSpinMutex::unlock()
+{
+#if defined(_MSC_VER)
+	_InterlockedExchange((volatile long*)&m_lock, 0);
+#elif defined(__GNUC__)
+	__sync_lock_release(&m_lock);
+#else
+	m_lock = 0;
+#endif
+}
+
+
+///runs all loops on the calling thread
+class btTaskSchedulerSequential : public btITaskScheduler
+{
+public:
+	virtual const char* getName() const
+	{
+		return "Sequential";
+	}
+	virtual int		getMaxNumThreads() const
+	{
+		return 1;
+	}
+	virtual int		getNumThreads() const
+	{
+		return 1;
+	}
+	virtual void	setNumThreads(int numThreads)
+	{
+		(void)numThreads;
+	}
+	virtual void	parallelFor(int iBegin, int iEnd, int grainSize, const btIParallelForBody& body)
+	{
+		(void)grainSize;
+		if (iBegin < iEnd)
+			body.forLoop(iBegin, iEnd);
+	}
+};
+
+btITaskScheduler*	btGetSequentialTaskScheduler()
+{
+	static btTaskSchedulerSequential sTaskScheduler;
+	return &sTaskScheduler;
+}
+
+
+#if defined (BT_USE_WIN32_THREADS) || defined (BT_USE_PTHREADS)
+
+///counting semaphore, used to start the workers and to wait for them
+class btThreadSemaphore
+{
+#ifdef BT_USE_WIN32_THREADS
+	HANDLE	m_semaphore;
+public:
+	btThreadSemaphore()
+	{
+		m_semaphore = CreateSemaphore(NULL, 0, BT_MAX_THREAD_COUNT, NULL);
+	}
+	~btThreadSemaphore()
+	{
+		CloseHandle(m_semaphore);
+	}
+	void	wait()
+	{
+		WaitForSingleObject(m_semaphore, INFINITE);
+	}
+	void	post()
+	{
+		ReleaseSemaphore(m_semaphore, 1, NULL);
+	}
+#else
+	pthread_mutex_t	m_mutex;
+	pthread_cond_t	m_cond;
+	int				m_count;
+public:
+	btThreadSemaphore()
+		:m_count(0)
+	{
+		pthread_mutex_init(&m_mutex, NULL);
+		pthread_cond_init(&m_cond, NULL);
+	}
+	~btThreadSemaphore()
+	{
+		pthread_cond_destroy(&m_cond);
+		pthread_mutex_destroy(&m_mutex);
+	}
+	void	wait()
+	{
+		pthread_mutex_lock(&m_mutex);
+		while (m_count == 0)
+		{
+			pthread_cond_wait(&m_cond, &m_mutex);
+		}
+		m_count--;
+		pthread_mutex_unlock(&m_mutex);
+	}
+	void	post()
+	{
+		pthread_mutex_lock(&m_mutex);
+		m_count++;
+		pthread_cond_signal(&m_cond);
+		pthread_mutex_unlock(&m_mutex);
+	}
+#endif
+};
+
+///thread pool that keeps its workers asleep on a semaphore between loops.
+///Chunks are assigned statically (chunk k runs on thread k % numThreads), there is no work stealing.
+class btTaskSchedulerDefault : public btITaskScheduler
+{
+	struct WorkerInfo
+	{
+		btTaskSchedulerDefault*	m_scheduler;
+		unsigned int			m_threadIndex;
+		btThreadSemaphore		m_start;
+#ifdef BT_USE_WIN32_THREADS
+		HANDLE					m_thread;
+#else
+		pthread_t				m_thread;
+#endif
+	};
+
+	WorkerInfo*			m_workers;
+	btThreadSemaphore	m_done;
+	int					m_maxNumThreads;
+	int					m_numThreads;
+	bool				m_exit;
+	bool				m_busy;
+
+	//current loop
+	const btIParallelForBody*	m_body;
+	int					m_begin;
+	int					m_end;
+	int					m_grainSize;
+	int					m_numChunks;
+	int					m_loopNumThreads;
+
+	void	runChunks(int threadIndex)
+	{
+		for (int chunk = threadIndex; chunk < m_numChunks; chunk += m_loopNumThreads)
+		{
+			int iBegin = m_begin + chunk * m_grainSize;
+			int iEnd = btMin(iBegin + m_grainSize, m_end);
+			m_body->forLoop(iBegin, iEnd);
+		}
+	}
+
+	void	workerLoop(WorkerInfo* worker)
+	{
+		gThreadIndex = worker->m_threadIndex;
+		for (;;)
+		{
+			worker->m_start.wait();
+			if (m_exit)
+				break;
+			runChunks(worker->m_threadIndex);
+			m_done.post();
+		}
+	}
+
+#ifdef BT_USE_WIN32_THREADS
+	static DWORD WINAPI	workerThreadFunc(LPVOID arg)
+	{
+		WorkerInfo* worker = (WorkerInfo*)arg;
+		worker->m_scheduler->workerLoop(worker);
+		return 0;
+	}
+#else
+	static void*	workerThreadFunc(void* arg)
+	{
+		WorkerInfo* worker = (WorkerInfo*)arg;
+		worker->m_scheduler->workerLoop(worker);
+		return 0;
+	}
+#endif
+
+public:
+
+	btTaskSchedulerDefault(int maxNumThreads)
+		:m_exit(false),
+		m_busy(false),
+		m_body(0)
+	{
+		m_maxNumThreads = btMax(1, btMin(maxNumThreads, int(BT_MAX_THREAD_COUNT)));
+		m_numThreads = m_maxNumThreads;
+
+		void* mem = btAlignedAlloc(sizeof(WorkerInfo) * m_maxNumThreads, 16);
+		m_workers = (WorkerInfo*)mem;
+		//worker 0 is the calling thread, it has no thread of its own
+		for (int i = 1; i < m_maxNumThreads; i++)
+		{
+			WorkerInfo* worker = new (&m_workers[i]) WorkerInfo;
+			worker->m_scheduler = this;
+			worker->m_threadIndex = i;
+			btAtomicAdd(&gNumWorkerThreads, 1);
+#ifdef BT_USE_WIN32_THREADS
+			worker->m_thread = CreateThread(NULL, 0, workerThreadFunc, worker, 0, NULL);
+#else
+			pthread_create(&worker->m_thread, NULL, workerThreadFunc, worker);
+#endif
+		}
+	}
+
+	virtual ~btTaskSchedulerDefault()
+	{
+		btAssert(!m_busy);
+		m_exit = true;
+		int i;
+		for (i = 1; i < m_maxNumThreads; i++)
+		{
+			m_workers[i].m_start.post();
+		}
+		for (i = 1; i < m_maxNumThreads; i++)
+		{
+#ifdef BT_USE_WIN32_THREADS
+			WaitForSingleObject(m_workers[i].m_thread, INFINITE);
+			CloseHandle(m_workers[i].m_thread);
+#else
+			pthread_join(m_workers[i].m_thread, NULL);
+#endif
+			btAtomicAdd(&gNumWorkerThreads, -1);
+			m_workers[i].~WorkerInfo();
+		}
+		btAlignedFree(m_workers);
+	}
+
+	virtual const char* getName() const
+	{
+		return "Default";
+	}
+
+	virtual int		getMaxNumThreads() const
+	{
+		return m_maxNumThreads;
+	}
+
+	virtual int		getNumThreads() const
+	{
+		return m_numThreads;
+	}
+
+	virtual void	setNumThreads(int numThreads)
+	{
+		btAssert(!m_busy);
+		m_numThreads = btMax(1, btMin(numThreads, m_maxNumThreads));
+	}
+
+	virtual void	parallelFor(int iBegin, int iEnd, int grainSize, const btIParallelForBody& body)
+	{
+		if (iBegin >= iEnd)
+			return;
+		grainSize = btMax(1, grainSize);
+		int numChunks = (iEnd - iBegin + grainSize - 1) / grainSize;
+
+		//nested loops, single chunks and single threaded pools run on the calling thread
+		if (m_busy || btGetCurrentThreadIndex() != 0 || m_numThreads <= 1 || numChunks <= 1)
+		{
+			body.forLoop(iBegin, iEnd);
+			return;
+		}
+
+		m_busy = true;
+		m_body = &body;
+		m_begin = iBegin;
+		m_end = iEnd;
+		m_grainSize = grainSize;
+		m_numChunks = numChunks;
+		m_loopNumThreads = btMin(m_numThreads, numChunks);
+
+		int i;
+		for (i = 1; i < m_loopNumThreads; i++)
+		{
+			m_workers[i].m_start.post();
+		}
+		runChunks(0);
+		for (i = 1; i < m_loopNumThreads; i++)
+		{
+			m_done.wait();
+		}
+
+		m_body = 0;
+		m_busy = false;
+	}
+};
+
+btITaskScheduler*	btCreateDefaultTaskScheduler(int maxNumThreads)
+{
+	void* mem = btAlignedAlloc(sizeof(btTaskSchedulerDefault), 16);
+	return new (mem) btTaskSchedulerDefault(maxNumThreads);
+}
+
+///runs the jobs on a thread that sleeps on a semaphore between jobs
+class btBackgroundWorkerDefault : public btIBackgroundWorker
+{
+	btThreadSemaphore	m_start;
+	btThreadSemaphore	m_done;
+	btIBackgroundJob*	m_job;
+	bool				m_busy;
+	bool				m_exit;
+#ifdef BT_USE_WIN32_THREADS
+	HANDLE				m_thread;
+#else
+	pthread_t			m_thread;
+#endif
+
+	void	workerLoop()
+	{
+		gThreadIndex = BT_BACKGROUND_THREAD_INDEX;
+		for (;;)
+		{
+			m_start.wait();
+			if (m_exit)
+				break;
+			m_job->run();
+			m_done.post();
+		}
+	}
+
+#ifdef BT_USE_WIN32_THREADS
+	static DWORD WINAPI	workerThreadFunc(LPVOID arg)
+	{
+		((btBackgroundWorkerDefault*)arg)->workerLoop();
+		return 0;
+	}
+#else
+	static void*	workerThreadFunc(void* arg)
+	{
+		((btBackgroundWorkerDefault*)arg)->workerLoop();
+		return 0;
+	}
+#endif
+
+public:
+
+	btBackgroundWorkerDefault()
+		:m_job(0),
+		m_busy(false),
+		m_exit(false)
+	{
+		btAtomicAdd(&gNumWorkerThreads, 1);
+#ifdef BT_USE_WIN32_THREADS
+		m_thread = CreateThread(NULL, 0, workerThreadFunc, this, 0, NULL);
+#else
+		pthread_create(&m_thread, NULL, workerThreadFunc, this);
+#endif
+	}
+
+	virtual ~btBackgroundWorkerDefault()
+	{
+		wait();
+		m_exit = true;
+		m_start.post();
+#ifdef BT_USE_WIN32_THREADS
+		WaitForSingleObject(m_thread, INFINITE);
+		CloseHandle(m_thread);
+#else
+		pthread_join(m_thread, NULL);
+#endif
+		btAtomicAdd(&gNumWorkerThreads, -1);
+	}
+
+	virtual void	start(btIBackgroundJob* job)
+	{
+		btAssert(!m_busy);
+		m_job = job;
+		m_busy = true;
+		m_start.post();
+	}
+
+	virtual void	wait()
+	{
+		if (m_busy)
+		{
+			m_done.wait();
+			m_busy = false;
+		}
+	}
+
+	virtual bool	isBusy() const
+	{
+		return m_busy;
+	}
+};
+
+btIBackgroundWorker*	btCreateBackgroundWorker()
+{
+	void* mem = btAlignedAlloc(sizeof(btBackgroundWorkerDefault), 16);
+	return new (mem) btBackgroundWorkerDefault();
+}
+
+#else //BT_USE_WIN32_THREADS || BT_USE_PTHREADS
+
+btITaskScheduler*	btCreateDefaultTaskScheduler(int maxNumThreads)
+{
+	(void)maxNumThreads;
+	return 0;
+}
+
+btIBackgroundWorker*	btCreateBackgroundWorker()
+{
+	return 0;
+}
+
+#endif //BT_USE_WIN32_THREADS || BT_USE_PTHREADS
+
+void	btDeleteTaskScheduler(btITaskScheduler* scheduler)
+{
+	if (scheduler && scheduler != btGetSequentialTaskScheduler())
+	{
+		scheduler->~btITaskScheduler();
+		btAlignedFree(scheduler);
+	}
+}
+
+void	btDeleteBackgroundWorker(btIBackgroundWorker* worker)
+{
+	if (worker)
+	{
+		worker->~btIBackgroundWorker();
+		btAlignedFree(worker);
+	}
+}
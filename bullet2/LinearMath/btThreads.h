@@ -0,0 +1,137 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2009 Erwin Coumans  http://bulletphysics.org
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef BT_THREADS_H
+#define BT_THREADS_H
+
+#include "btScalar.h"
+
+///maximum number of threads a btITaskScheduler can run, including the calling thread
+#define BT_MAX_THREAD_COUNT 64
+
+///index of the calling thread inside the task scheduler that runs it.
+///The thread that calls btITaskScheduler::parallelFor (and any thread not owned by a scheduler) has index 0,
+///worker threads have indices 1 .. numThreads-1.
+unsigned int btGetCurrentThreadIndex();
+
+SIMD_FORCE_INLINE bool btIsMainThread()
+{
+	return btGetCurrentThreadIndex() == 0;
+}
+
+///number of threads started by task schedulers and background workers that have not been deleted yet.
+///When it is 0, Bullet code only runs on the threads of the application, and data used by a single one of them needs no lock.
+extern volatile int gNumWorkerThreads;
+
+SIMD_FORCE_INLINE int btGetNumWorkerThreads()
+{
+	return gNumWorkerThreads;
+}
+
+///btSpinMutex is a lightweight lock for short critical sections; it busy-waits instead of sleeping.
+class btSpinMutex
+{
+	volatile int	m_lock;
+
+public:
+	btSpinMutex()
+		:m_lock(0)
+	{
+	}
+	void	lock();
+	void	unlock();
+	bool	tryLock();
+};
+
+///atomically adds value to *dest and returns the new value
+int	btAtomicAdd(volatile int* dest, int value);
+
+///btIParallelForBody is the loop body executed by btITaskScheduler::parallelFor
+class btIParallelForBody
+{
+public:
+	virtual ~btIParallelForBody() {}
+
+	///process the indices [iBegin, iEnd)
+	virtual void forLoop(int iBegin, int iEnd) const = 0;
+};
+
+///btITaskScheduler runs loop bodies on a fixed pool of threads.
+///parallelFor splits [iBegin, iEnd) into chunks of grainSize indices and hands chunk k to thread k % getNumThreads(),
+///so for a fixed thread count each chunk always runs on the same thread in the same order. Callers that keep
+///per-thread state (indexed by btGetCurrentThreadIndex) therefore get reproducible results.
+///parallelFor called from inside a running loop body is executed serially on the calling thread.
+class btITaskScheduler
+{
+public:
+	virtual ~btITaskScheduler() {}
+
+	virtual const char* getName() const = 0;
+
+	virtual int		getMaxNumThreads() const = 0;
+
+	virtual int		getNumThreads() const = 0;
+
+	///numThreads is clamped to [1, getMaxNumThreads()]
+	virtual void	setNumThreads(int numThreads) = 0;
+
+	///returns after all chunks have been processed. The calling thread processes the chunks of thread 0.
+	virtual void	parallelFor(int iBegin, int iEnd, int grainSize, const btIParallelForBody& body) = 0;
+};
+
+///returns a scheduler that runs every loop on the calling thread. It is owned by Bullet, do not delete it.
+btITaskScheduler*	btGetSequentialTaskScheduler();
+
+///creates a thread pool with maxNumThreads threads, counting the calling thread.
+///Returns 0 when threads are not supported on this platform. Delete it with btDeleteTaskScheduler.
+btITaskScheduler*	btCreateDefaultTaskScheduler(int maxNumThreads);
+
+void	btDeleteTaskScheduler(btITaskScheduler* scheduler);
+
+///thread index of a btIBackgroundWorker thread, outside the range of btITaskScheduler threads
+#define BT_BACKGROUND_THREAD_INDEX BT_MAX_THREAD_COUNT
+
+///btIBackgroundJob is the work executed by btIBackgroundWorker::start
+class btIBackgroundJob
+{
+public:
+	virtual ~btIBackgroundJob() {}
+
+	virtual void run() = 0;
+};
+
+///btIBackgroundWorker runs one job at a time on a thread of its own, so the job overlaps with the work of the calling thread.
+///The job must only touch data the calling thread leaves alone until wait() returns.
+class btIBackgroundWorker
+{
+public:
+	virtual ~btIBackgroundWorker() {}
+
+	///starts the job and returns immediately. The previous job must have been waited for.
+	virtual void	start(btIBackgroundJob* job) = 0;
+
+	///returns after the last started job has finished
+	virtual void	wait() = 0;
+
+	virtual bool	isBusy() const = 0;
+};
+
+///creates a worker with a thread of its own. Returns 0 when threads are not supported on this platform.
+///Delete it with btDeleteBackgroundWorker, which waits for the running job.
+btIBackgroundWorker*	btCreateBackgroundWorker();
+
+void	btDeleteBackgroundWorker(btIBackgroundWorker* worker);
+
+#endif //BT_THREADS_H
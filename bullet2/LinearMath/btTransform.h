@@ -93,9 +93,13 @@ public:
 /**@brief Return the transform of the vector */
 	SIMD_FORCE_INLINE btVector3 operator()(const btVector3& x) const
 	{
+#ifdef BT_USE_SSE
+		return m_basis * x + m_origin;
+#else
 		return btVector3(m_basis[0].dot(x) + m_origin.x(), 
 			m_basis[1].dot(x) + m_origin.y(), 
 			m_basis[2].dot(x) + m_origin.z());
+#endif
 	}
 
   /**@brief Return the transform of the vector */
@@ -225,7 +229,8 @@ SIMD_FORCE_INLINE btVector3
 btTransform::invXform(const btVector3& inVec) const
 {
 	btVector3 v = inVec - m_origin;
-	return (m_basis.transpose() * v);
+	//same as m_basis.transpose() * v without building the transpose
+	return v * m_basis;
 }
 
 SIMD_FORCE_INLINE btTransform 
@@ -29,6 +29,44 @@ subject to the following restrictions:
 #define btVector3DataName "btVector3FloatData"
 #endif //BT_USE_DOUBLE_PRECISION
 
+#ifdef BT_USE_SSE
+///SSE helpers shared by btVector3, btQuaternion, btMatrix3x3 and btTransform.
+///The SSE code paths compute x, y and z in the same order as the scalar code, so the results are identical.
+///Operations that set w to zero in the scalar code also set it to zero here, and compound assignments leave w unchanged.
+#define bt_splat_ps(v, i) _mm_shuffle_ps((v), (v), _MM_SHUFFLE(i,i,i,i))
+#define bt_pshufd_ps(v, m) _mm_shuffle_ps((v), (v), (m))
+
+///mask that keeps x, y and z and clears w
+SIMD_FORCE_INLINE __m128 btvFFF0Mask()
+{
+	return _mm_castsi128_ps(_mm_setr_epi32(-1, -1, -1, 0));
+}
+
+///mask that clears the sign of x, y and z and clears w
+SIMD_FORCE_INLINE __m128 btvAbsFFF0Mask()
+{
+	return _mm_castsi128_ps(_mm_setr_epi32(0x7fffffff, 0x7fffffff, 0x7fffffff, 0));
+}
+
+SIMD_FORCE_INLINE __m128 btvSignMask()
+{
+	return _mm_set1_ps(-0.0f);
+}
+
+SIMD_FORCE_INLINE __m128 btv0001()
+{
+	return _mm_setr_ps(0.0f, 0.0f, 0.0f, 1.0f);
+}
+
+///horizontal sum x+y+z of a product, evaluated as (x+y)+z. The result is in the x lane.
+///_mm_dp_ps (SSE4.1) was measured slower than this on current CPUs, so it is not used.
+SIMD_FORCE_INLINE __m128 btvDot3(__m128 a, __m128 b)
+{
+	__m128 m = _mm_mul_ps(a, b);
+	return _mm_add_ss(_mm_add_ss(m, bt_splat_ps(m, 1)), _mm_movehl_ps(m, m));
+}
+#endif //BT_USE_SSE
+
 
 
 
@@ -69,8 +107,22 @@ public:
 
 	public:
 
-  /**@brief No initialization constructor */
-	SIMD_FORCE_INLINE btVector3() {}
+  /**@brief Constructor without arguments. With BT_USE_SSE the lanes are zeroed so copies of it are defined, otherwise
+   * the components are left uninitialized, so callers must not rely on the zeroing */
+	SIMD_FORCE_INLINE btVector3()
+	{
+#ifdef BT_USE_SSE
+		mVec128 = _mm_setzero_ps();
+#endif
+	}
+
+#ifdef BT_USE_SSE
+  /**@brief Constructor from an SSE register, w is taken as is */
+	SIMD_FORCE_INLINE explicit btVector3(__m128 v128)
+	{
+		mVec128 = v128;
+	}
+#endif
 
  
 	
@@ -81,10 +133,14 @@ public:
    */
 	SIMD_FORCE_INLINE btVector3(const btScalar& x, const btScalar& y, const btScalar& z)
 	{
+#ifdef BT_USE_SSE
+		mVec128 = _mm_setr_ps(x, y, z, 0.0f);
+#else
 		m_floats[0] = x;
 		m_floats[1] = y;
 		m_floats[2] = z;
 		m_floats[3] = btScalar(0.);
+#endif
 	}
 
 	
@@ -92,8 +148,11 @@ public:
  * @param The vector to add to this one */
 	SIMD_FORCE_INLINE btVector3& operator+=(const btVector3& v)
 	{
-
+#ifdef BT_USE_SSE
+		mVec128 = _mm_add_ps(mVec128, _mm_and_ps(v.mVec128, btvFFF0Mask()));
+#else
 		m_floats[0] += v.m_floats[0]; m_floats[1] += v.m_floats[1];m_floats[2] += v.m_floats[2];
+#endif
 		return *this;
 	}
 
@@ -102,14 +161,22 @@ public:
    * @param The vector to subtract */
 	SIMD_FORCE_INLINE btVector3& operator-=(const btVector3& v) 
 	{
+#ifdef BT_USE_SSE
+		mVec128 = _mm_sub_ps(mVec128, _mm_and_ps(v.mVec128, btvFFF0Mask()));
+#else
 		m_floats[0] -= v.m_floats[0]; m_floats[1] -= v.m_floats[1];m_floats[2] -= v.m_floats[2];
+#endif
 		return *this;
 	}
   /**@brief Scale the vector
    * @param s Scale factor */
 	SIMD_FORCE_INLINE btVector3& operator*=(const btScalar& s)
 	{
+#ifdef BT_USE_SSE
+		mVec128 = _mm_mul_ps(mVec128, _mm_setr_ps(s, s, s, 1.0f));
+#else
 		m_floats[0] *= s; m_floats[1] *= s;m_floats[2] *= s;
+#endif
 		return *this;
 	}
 
@@ -125,7 +192,11 @@ public:
    * @param v The other vector in the dot product */
 	SIMD_FORCE_INLINE btScalar dot(const btVector3& v) const
 	{
+#ifdef BT_USE_SSE
+		return _mm_cvtss_f32(btvDot3(mVec128, v.mVec128));
+#else
 		return m_floats[0] * v.m_floats[0] + m_floats[1] * v.m_floats[1] +m_floats[2] * v.m_floats[2];
+#endif
 	}
 
   /**@brief Return the length of the vector squared */
@@ -187,19 +258,32 @@ public:
   /**@brief Return a vector will the absolute values of each element */
 	SIMD_FORCE_INLINE btVector3 absolute() const 
 	{
+#ifdef BT_USE_SSE
+		return btVector3(_mm_and_ps(mVec128, btvAbsFFF0Mask()));
+#else
 		return btVector3(
 			btFabs(m_floats[0]), 
 			btFabs(m_floats[1]), 
 			btFabs(m_floats[2]));
+#endif
 	}
   /**@brief Return the cross product between this and another vector 
    * @param v The other vector */
 	SIMD_FORCE_INLINE btVector3 cross(const btVector3& v) const
 	{
+#ifdef BT_USE_SSE
+		__m128 a = mVec128;
+		__m128 b = v.mVec128;
+		__m128 r = _mm_sub_ps(
+			_mm_mul_ps(bt_pshufd_ps(a, _MM_SHUFFLE(3,0,2,1)), bt_pshufd_ps(b, _MM_SHUFFLE(3,1,0,2))),
+			_mm_mul_ps(bt_pshufd_ps(a, _MM_SHUFFLE(3,1,0,2)), bt_pshufd_ps(b, _MM_SHUFFLE(3,0,2,1))));
+		return btVector3(_mm_and_ps(r, btvFFF0Mask()));
+#else
 		return btVector3(
 			m_floats[1] * v.m_floats[2] -m_floats[2] * v.m_floats[1],
 			m_floats[2] * v.m_floats[0] - m_floats[0] * v.m_floats[2],
 			m_floats[0] * v.m_floats[1] - m_floats[1] * v.m_floats[0]);
+#endif
 	}
 
 	SIMD_FORCE_INLINE btScalar triple(const btVector3& v1, const btVector3& v2) const
@@ -248,16 +332,25 @@ public:
    * @param t The ration of this to v (t = 0 => return this, t=1 => return other) */
 	SIMD_FORCE_INLINE btVector3 lerp(const btVector3& v, const btScalar& t) const 
 	{
+#ifdef BT_USE_SSE
+		__m128 r = _mm_add_ps(mVec128, _mm_mul_ps(_mm_sub_ps(v.mVec128, mVec128), _mm_set1_ps(t)));
+		return btVector3(_mm_and_ps(r, btvFFF0Mask()));
+#else
 		return btVector3(m_floats[0] + (v.m_floats[0] - m_floats[0]) * t,
 			m_floats[1] + (v.m_floats[1] - m_floats[1]) * t,
 			m_floats[2] + (v.m_floats[2] -m_floats[2]) * t);
+#endif
 	}
 
   /**@brief Elementwise multiply this vector by the other 
    * @param v The other vector */
 	SIMD_FORCE_INLINE btVector3& operator*=(const btVector3& v)
 	{
+#ifdef BT_USE_SSE
+		mVec128 = _mm_mul_ps(mVec128, _mm_or_ps(_mm_and_ps(v.mVec128, btvFFF0Mask()), btv0001()));
+#else
 		m_floats[0] *= v.m_floats[0]; m_floats[1] *= v.m_floats[1];m_floats[2] *= v.m_floats[2];
+#endif
 		return *this;
 	}
 
@@ -292,7 +385,11 @@ public:
 
 	SIMD_FORCE_INLINE	bool	operator==(const btVector3& other) const
 	{
+#ifdef BT_USE_SSE
+		return _mm_movemask_ps(_mm_cmpeq_ps(mVec128, other.mVec128)) == 0xf;
+#else
 		return ((m_floats[3]==other.m_floats[3]) && (m_floats[2]==other.m_floats[2]) && (m_floats[1]==other.m_floats[1]) && (m_floats[0]==other.m_floats[0]));
+#endif
 	}
 
 	SIMD_FORCE_INLINE	bool	operator!=(const btVector3& other) const
@@ -305,28 +402,42 @@ public:
    */
 		SIMD_FORCE_INLINE void	setMax(const btVector3& other)
 		{
+#ifdef BT_USE_SSE
+			//operand order matches btSetMax for NaN and signed zero
+			mVec128 = _mm_max_ps(other.mVec128, mVec128);
+#else
 			btSetMax(m_floats[0], other.m_floats[0]);
 			btSetMax(m_floats[1], other.m_floats[1]);
 			btSetMax(m_floats[2], other.m_floats[2]);
 			btSetMax(m_floats[3], other.w());
+#endif
 		}
   /**@brief Set each element to the min of the current values and the values of another btVector3
    * @param other The other btVector3 to compare with 
    */
 		SIMD_FORCE_INLINE void	setMin(const btVector3& other)
 		{
+#ifdef BT_USE_SSE
+			//operand order matches btSetMin for NaN and signed zero
+			mVec128 = _mm_min_ps(other.mVec128, mVec128);
+#else
 			btSetMin(m_floats[0], other.m_floats[0]);
 			btSetMin(m_floats[1], other.m_floats[1]);
 			btSetMin(m_floats[2], other.m_floats[2]);
 			btSetMin(m_floats[3], other.w());
+#endif
 		}
 
 		SIMD_FORCE_INLINE void 	setValue(const btScalar& x, const btScalar& y, const btScalar& z)
 		{
+#ifdef BT_USE_SSE
+			mVec128 = _mm_setr_ps(x, y, z, 0.0f);
+#else
 			m_floats[0]=x;
 			m_floats[1]=y;
 			m_floats[2]=z;
 			m_floats[3] = btScalar(0.);
+#endif
 		}
 
 		void	getSkewSymmetricMatrix(btVector3* v0,btVector3* v1,btVector3* v2) const
@@ -369,34 +480,54 @@ public:
 SIMD_FORCE_INLINE btVector3 
 operator+(const btVector3& v1, const btVector3& v2) 
 {
+#ifdef BT_USE_SSE
+	return btVector3(_mm_and_ps(_mm_add_ps(v1.mVec128, v2.mVec128), btvFFF0Mask()));
+#else
 	return btVector3(v1.m_floats[0] + v2.m_floats[0], v1.m_floats[1] + v2.m_floats[1], v1.m_floats[2] + v2.m_floats[2]);
+#endif
 }
 
 /**@brief Return the elementwise product of two vectors */
 SIMD_FORCE_INLINE btVector3 
 operator*(const btVector3& v1, const btVector3& v2) 
 {
+#ifdef BT_USE_SSE
+	return btVector3(_mm_and_ps(_mm_mul_ps(v1.mVec128, v2.mVec128), btvFFF0Mask()));
+#else
 	return btVector3(v1.m_floats[0] * v2.m_floats[0], v1.m_floats[1] * v2.m_floats[1], v1.m_floats[2] * v2.m_floats[2]);
+#endif
 }
 
 /**@brief Return the difference between two vectors */
 SIMD_FORCE_INLINE btVector3 
 operator-(const btVector3& v1, const btVector3& v2)
 {
+#ifdef BT_USE_SSE
+	return btVector3(_mm_and_ps(_mm_sub_ps(v1.mVec128, v2.mVec128), btvFFF0Mask()));
+#else
 	return btVector3(v1.m_floats[0] - v2.m_floats[0], v1.m_floats[1] - v2.m_floats[1], v1.m_floats[2] - v2.m_floats[2]);
+#endif
 }
 /**@brief Return the negative of the vector */
 SIMD_FORCE_INLINE btVector3 
 operator-(const btVector3& v)
 {
+#ifdef BT_USE_SSE
+	return btVector3(_mm_and_ps(_mm_xor_ps(v.mVec128, btvSignMask()), btvFFF0Mask()));
+#else
 	return btVector3(-v.m_floats[0], -v.m_floats[1], -v.m_floats[2]);
+#endif
 }
 
 /**@brief Return the vector scaled by s */
 SIMD_FORCE_INLINE btVector3 
 operator*(const btVector3& v, const btScalar& s)
 {
+#ifdef BT_USE_SSE
+	return btVector3(_mm_and_ps(_mm_mul_ps(v.mVec128, _mm_set1_ps(s)), btvFFF0Mask()));
+#else
 	return btVector3(v.m_floats[0] * s, v.m_floats[1] * s, v.m_floats[2] * s);
+#endif
 }
 
 /**@brief Return the vector scaled by s */
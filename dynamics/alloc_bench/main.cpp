@@ -0,0 +1,383 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2012 Erwin Coumans  http://bulletphysics.org
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+///Allocator benchmark
+///1. Random allocate/free sequences on a btPoolAllocator with and without per-thread magazines, compared to a plain
+///   single free list. Checks the pool hands out the same addresses as the single free list on one thread.
+///2. Threads of a task scheduler allocate, stamp, verify and free pool elements concurrently.
+///   Checks no element is handed out twice and all elements are free afterwards. Then the calling thread allocates the
+///   whole pool while the other threads still cache free elements in their magazines, and must get every element.
+///3. btDbvt::collideTV aabb queries using the scratch arena for their traversal stack, compared to the same traversal
+///   with a heap allocated stack. Checks both find the same leaves and counts btAlignedAlloc calls per query.
+///Build with -DBT_POOL_ALLOCATOR_PROFILE=1 to also print the allocation and depot transfer counters of the pools.
+///Usage: alloc_bench [number of pool operations]
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "LinearMath/btPoolAllocator.h"
+#include "LinearMath/btArenaAllocator.h"
+#include "LinearMath/btQuickprof.h"
+#include "LinearMath/btThreads.h"
+#include "BulletCollision/BroadphaseCollision/btDbvt.h"
+
+#define NUM_OPERATIONS 20000000
+#define POOL_SIZE 4096
+#define ELEMENT_SIZE 64
+#define NUM_TASKS 256
+#define TASK_ELEMENTS 128
+#define TASK_ROUNDS 2000
+#define NUM_LEAVES 20000
+#define NUM_QUERIES 200000
+
+///the single free list btPoolAllocator used before it got magazines
+class ReferencePool
+{
+	int				m_elemSize;
+	int				m_freeCount;
+	void*			m_firstFree;
+	unsigned char*	m_pool;
+
+public:
+	ReferencePool(int elemSize, int maxElements)
+		:m_elemSize(elemSize)
+	{
+		m_pool = (unsigned char*)btAlignedAlloc(static_cast<unsigned int>(elemSize*maxElements), 16);
+		unsigned char* p = m_pool;
+		m_firstFree = p;
+		m_freeCount = maxElements;
+		for (int i = 1; i < maxElements; i++)
+		{
+			*(void**)p = p + elemSize;
+			p += elemSize;
+		}
+		*(void**)p = 0;
+	}
+	~ReferencePool()
+	{
+		btAlignedFree(m_pool);
+	}
+	void* allocate(int)
+	{
+		if (!m_freeCount)
+			return 0;
+		void* result = m_firstFree;
+		m_firstFree = *(void**)m_firstFree;
+		--m_freeCount;
+		return result;
+	}
+	void freeMemory(void* ptr)
+	{
+		*(void**)ptr = m_firstFree;
+		m_firstFree = ptr;
+		++m_freeCount;
+	}
+	unsigned char* getPoolAddress()
+	{
+		return m_pool;
+	}
+};
+
+///random allocate/free sequence, returns a checksum of the element indices handed out
+template <typename Pool>
+static unsigned int runSequence(Pool& pool, unsigned char* base, int numOperations)
+{
+	btAlignedObjectArray<void*> live;
+	live.reserve(POOL_SIZE);
+	unsigned int seed = 12345;
+	unsigned int checksum = 0;
+	for (int i = 0; i < numOperations; i++)
+	{
+		seed = seed * 1664525u + 1013904223u;
+		//keep about three quarters of the pool in use, in bursts
+		bool doAllocate = live.size() == 0 || (live.size() < POOL_SIZE && ((seed >> 16) % 8) < ((live.size() < POOL_SIZE * 3 / 4) ? 5u : 3u));
+		if (doAllocate)
+		{
+			void* ptr = pool.allocate(ELEMENT_SIZE);
+			checksum = checksum * 31u + unsigned(((unsigned char*)ptr - base) / ELEMENT_SIZE);
+			live.push_back(ptr);
+		}
+		else
+		{
+			int index = int((seed >> 8) % unsigned(live.size()));
+			pool.freeMemory(live[index]);
+			live[index] = live[live.size() - 1];
+			live.pop_back();
+		}
+	}
+	for (int i = 0; i < live.size(); i++)
+	{
+		pool.freeMemory(live[i]);
+	}
+	return checksum;
+}
+
+struct PoolTasks : public btIParallelForBody
+{
+	btPoolAllocator* m_pool;
+	mutable volatile int m_errors;
+	mutable volatile int m_failedAllocations;
+
+	virtual void forLoop(int iBegin, int iEnd) const
+	{
+		void* elements[TASK_ELEMENTS];
+		for (int task = iBegin; task < iEnd; task++)
+		{
+			for (int round = 0; round < TASK_ROUNDS; round++)
+			{
+				int count = 1 + (task * 7 + round * 13) % TASK_ELEMENTS;
+				for (int i = 0; i < count; i++)
+				{
+					elements[i] = m_pool->allocate(ELEMENT_SIZE);
+					if (!elements[i])
+					{
+						btAtomicAdd(&m_failedAllocations, 1);
+						count = i;
+						break;
+					}
+					int* stamp = (int*)elements[i];
+					stamp[2] = task;
+					stamp[3] = round * TASK_ELEMENTS + i;
+				}
+				for (int i = count - 1; i >= 0; i--)
+				{
+					int* stamp = (int*)elements[i];
+					if (stamp[2] != task || stamp[3] != round * TASK_ELEMENTS + i)
+						btAtomicAdd(&m_errors, 1);
+					m_pool->freeMemory(elements[i]);
+				}
+			}
+		}
+	}
+};
+
+///each thread allocates and frees a quarter of the pool, leaving free elements in its magazine
+struct FillMagazines : public btIParallelForBody
+{
+	btPoolAllocator* m_pool;
+
+	virtual void forLoop(int iBegin, int iEnd) const
+	{
+		btAlignedObjectArray<void*> elements;
+		for (int task = iBegin; task < iEnd; task++)
+		{
+			for (int i = 0; i < POOL_SIZE / 4; i++)
+			{
+				void* ptr = m_pool->allocate(ELEMENT_SIZE);
+				if (ptr)
+					elements.push_back(ptr);
+			}
+			for (int i = 0; i < elements.size(); i++)
+			{
+				m_pool->freeMemory(elements[i]);
+			}
+			elements.resize(0);
+		}
+	}
+};
+
+struct CollectLeaves : btDbvt::ICollide
+{
+	btAlignedObjectArray<int>* m_leaves;
+	void Process(const btDbvtNode* leaf)
+	{
+		m_leaves->push_back(int(size_t(leaf->data)));
+	}
+};
+
+///collideTV as it was, with a stack on the heap for every query
+static void collideTVHeap(const btDbvtNode* root, const btDbvtVolume& volume, btDbvt::ICollide& policy)
+{
+	btAlignedObjectArray<const btDbvtNode*> stack;
+	stack.reserve(btDbvt::SIMPLE_STACKSIZE);
+	stack.push_back(root);
+	do
+	{
+		const btDbvtNode* n = stack[stack.size() - 1];
+		stack.pop_back();
+		if (Intersect(n->volume, volume))
+		{
+			if (n->isinternal())
+			{
+				stack.push_back(n->childs[0]);
+				stack.push_back(n->childs[1]);
+			}
+			else
+			{
+				policy.Process(n);
+			}
+		}
+	} while (stack.size() > 0);
+}
+
+///ends the line, with the pool counters when they are compiled in by BT_POOL_ALLOCATOR_PROFILE
+static void printCounters(const btPoolAllocator& pool)
+{
+#if BT_POOL_ALLOCATOR_PROFILE
+	printf("  (%d allocations, %d depot transfers)", pool.getNumAllocations(), pool.getNumDepotTransfers());
+#else
+	(void)pool;
+#endif
+	printf("\n");
+}
+
+static btScalar randRange(btScalar lo, btScalar hi)
+{
+	return lo + (hi - lo) * btScalar(rand()) / btScalar(RAND_MAX);
+}
+
+int main(int argc, char* argv[])
+{
+	int numOperations = argc > 1 ? atoi(argv[1]) : NUM_OPERATIONS;
+	if (numOperations < 1)
+		numOperations = 1;
+	int failures = 0;
+	btClock clock;
+
+	//single thread sequences
+	unsigned long int usReference;
+	unsigned int referenceChecksum;
+	{
+		ReferencePool pool(ELEMENT_SIZE, POOL_SIZE);
+		clock.reset();
+		referenceChecksum = runSequence(pool, pool.getPoolAddress(), numOperations);
+		usReference = clock.getTimeMicroseconds();
+	}
+	printf("%d pool operations on one thread\n", numOperations);
+	printf("single free list           %8lu us\n", usReference);
+	for (int pass = 0; pass < 2; pass++)
+	{
+		int magazineSize = pass ? 0 : BT_POOL_MAGAZINE_SIZE;
+		btPoolAllocator pool(ELEMENT_SIZE, POOL_SIZE, magazineSize);
+		clock.reset();
+		unsigned int checksum = runSequence(pool, pool.getPoolAddress(), numOperations);
+		unsigned long int us = clock.getTimeMicroseconds();
+		bool same = checksum == referenceChecksum && pool.getFreeCount() == POOL_SIZE;
+		if (!same)
+			failures++;
+		printf("btPoolAllocator magazine %2d %8lu us  x%4.2f  %s", magazineSize, us,
+			us ? double(usReference) / double(us) : 0.0, same ? "identical" : "MISMATCH");
+		printCounters(pool);
+	}
+
+	//concurrent allocations
+	for (int numThreads = 1; numThreads <= 8; numThreads *= 2)
+	{
+		btITaskScheduler* scheduler = btCreateDefaultTaskScheduler(numThreads);
+		if (!scheduler)
+			break;
+		scheduler->setNumThreads(numThreads);
+		for (int pass = 0; pass < 2; pass++)
+		{
+			int magazineSize = pass ? 0 : BT_POOL_MAGAZINE_SIZE;
+			btPoolAllocator pool(ELEMENT_SIZE, POOL_SIZE, magazineSize);
+			PoolTasks tasks;
+			tasks.m_pool = &pool;
+			tasks.m_errors = 0;
+			tasks.m_failedAllocations = 0;
+			clock.reset();
+			scheduler->parallelFor(0, NUM_TASKS, 1, tasks);
+			unsigned long int us = clock.getTimeMicroseconds();
+			bool ok = !tasks.m_errors && !tasks.m_failedAllocations && pool.getFreeCount() == POOL_SIZE &&
+				pool.getNumAllocations() == pool.getNumFrees();
+			if (!ok)
+				failures++;
+			printf("%d threads magazine %2d      %8lu us  %s", numThreads, magazineSize, us, ok ? "ok" : "FAILED");
+			printCounters(pool);
+			if (!ok)
+				printf("  %d corrupted elements, %d failed allocations, %d free\n", tasks.m_errors, tasks.m_failedAllocations, pool.getFreeCount());
+		}
+		if (numThreads > 1)
+		{
+			btPoolAllocator pool(ELEMENT_SIZE, POOL_SIZE);
+			FillMagazines fill;
+			fill.m_pool = &pool;
+			scheduler->parallelFor(0, numThreads, 1, fill);
+			btAlignedObjectArray<void*> elements;
+			for (void* ptr = pool.allocate(ELEMENT_SIZE); ptr; ptr = pool.allocate(ELEMENT_SIZE))
+			{
+				elements.push_back(ptr);
+			}
+			bool ok = elements.size() == POOL_SIZE;
+			if (!ok)
+				failures++;
+			printf("%d threads, whole pool on one thread        %s  (%d of %d elements)\n", numThreads, ok ? "ok" : "FAILED", elements.size(), POOL_SIZE);
+			for (int i = 0; i < elements.size(); i++)
+			{
+				pool.freeMemory(elements[i]);
+			}
+		}
+		btDeleteTaskScheduler(scheduler);
+	}
+
+	//aabb queries on a dbvt
+	srand(1);
+	btDbvt tree;
+	for (int i = 0; i < NUM_LEAVES; i++)
+	{
+		btVector3 center(randRange(-100, 100), randRange(-100, 100), randRange(-100, 100));
+		btVector3 extents(randRange(0.5, 2), randRange(0.5, 2), randRange(0.5, 2));
+		tree.insert(btDbvtVolume::FromCE(center, extents), (void*)size_t(i));
+	}
+	btAlignedObjectArray<btDbvtVolume> queries;
+	for (int i = 0; i < NUM_QUERIES; i++)
+	{
+		btVector3 center(randRange(-100, 100), randRange(-100, 100), randRange(-100, 100));
+		queries.push_back(btDbvtVolume::FromCE(center, btVector3(3, 3, 3)));
+	}
+	btAlignedObjectArray<int> heapLeaves, scratchLeaves;
+	heapLeaves.reserve(NUM_QUERIES * 4);
+	scratchLeaves.reserve(NUM_QUERIES * 4);
+	CollectLeaves collect;
+
+	collect.m_leaves = &heapLeaves;
+	int allocs = btAlignedAllocGetNumAllocs();
+	clock.reset();
+	for (int i = 0; i < NUM_QUERIES; i++)
+	{
+		collideTVHeap(tree.m_root, queries[i], collect);
+	}
+	unsigned long int usHeap = clock.getTimeMicroseconds();
+	int heapAllocs = btAlignedAllocGetNumAllocs() - allocs;
+
+	collect.m_leaves = &scratchLeaves;
+	btResetScratchArenaCounters();
+	allocs = btAlignedAllocGetNumAllocs();
+	clock.reset();
+	for (int i = 0; i < NUM_QUERIES; i++)
+	{
+		tree.collideTV(tree.m_root, queries[i], collect);
+	}
+	unsigned long int usScratch = clock.getTimeMicroseconds();
+	int scratchAllocs = btAlignedAllocGetNumAllocs() - allocs;
+
+	bool same = heapLeaves.size() == scratchLeaves.size();
+	for (int i = 0; same && i < heapLeaves.size(); i++)
+	{
+		same = heapLeaves[i] == scratchLeaves[i];
+	}
+	if (!same)
+		failures++;
+	btScratchArenaStats stats;
+	btGetScratchArenaStats(stats);
+	printf("%d collideTV queries, %d leaves found\n", NUM_QUERIES, heapLeaves.size());
+	printf("heap stack                 %8lu us  %8d allocations\n", usHeap, heapAllocs);
+	printf("scratch arena stack        %8lu us  %8d allocations  x%4.2f  %s  (arena capacity %d bytes, %d block allocations)\n",
+		usScratch, scratchAllocs, usScratch ? double(usHeap) / double(usScratch) : 0.0, same ? "identical" : "MISMATCH",
+		int(stats.m_capacity), stats.m_numBlockAllocations);
+
+	btClearScratchArenas();
+	return failures ? 1 : 0;
+}
@@ -0,0 +1,446 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2012 Erwin Coumans  http://bulletphysics.org
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+///.bullet file loading benchmark
+///Builds a level of a large btBvhTriangleMeshShape terrain with boxes, spheres, capsules, cylinders, convex hulls,
+///multi spheres, compounds and scaled meshes, serializes it with btCollisionWorld::serialize and loads it back with
+///btCollisionFileLoader, which maps the file and uses the meshes and bvh nodes in place.
+///Compares the time of building the level (bvh included) with the time of loading the file, and checks rayTest
+///reports exactly the same closest hits in the original and the loaded world.
+///The file is also rewritten for 32 bit pointers in big endian byte order, to check the conversion of foreign files.
+///Usage: bullet_file_bench [terrain size] [file name]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "btBulletCollisionCommon.h"
+#include "BulletCollision/CollisionDispatch/btCollisionFileLoader.h"
+#include "BulletCollision/CollisionShapes/btScaledBvhTriangleMeshShape.h"
+#include "LinearMath/btSerializer.h"
+#include "LinearMath/btSerializedFile.h"
+#include "LinearMath/btQuickprof.h"
+
+#define TERRAIN_SIZE 384
+#define NUM_OBJECTS 600
+#define NUM_HULLS 16
+#define NUM_RAYS 20000
+
+static btScalar terrainHeight(int x, int z)
+{
+	return btScalar(4.) * btSin(btScalar(x) * btScalar(0.05)) * btCos(btScalar(z) * btScalar(0.04)) + btScalar(0.5) * btSin(btScalar(x + z) * btScalar(0.3));
+}
+
+static btScalar randRange(btScalar lo, btScalar hi)
+{
+	return lo + (hi - lo) * btScalar(rand()) / btScalar(RAND_MAX);
+}
+
+struct Level
+{
+	btAlignedObjectArray<btVector3> m_vertices;
+	btAlignedObjectArray<int> m_indices;
+	btAlignedObjectArray<btVector3> m_smallVertices;
+	btAlignedObjectArray<short> m_smallIndices;
+	btAlignedObjectArray<btStridingMeshInterface*> m_meshInterfaces;
+	btAlignedObjectArray<btCollisionShape*> m_shapes;
+	btAlignedObjectArray<btCollisionObject*> m_objects;
+
+	void build(btCollisionWorld& world, int terrainSize)
+	{
+		for (int z = 0; z <= terrainSize; z++)
+		{
+			for (int x = 0; x <= terrainSize; x++)
+			{
+				m_vertices.push_back(btVector3(btScalar(x - terrainSize / 2), terrainHeight(x, z), btScalar(z - terrainSize / 2)));
+			}
+		}
+		for (int z = 0; z < terrainSize; z++)
+		{
+			for (int x = 0; x < terrainSize; x++)
+			{
+				int i = z * (terrainSize + 1) + x;
+				m_indices.push_back(i); m_indices.push_back(i + terrainSize + 1); m_indices.push_back(i + 1);
+				m_indices.push_back(i + 1); m_indices.push_back(i + terrainSize + 1); m_indices.push_back(i + terrainSize + 2);
+			}
+		}
+		btTriangleIndexVertexArray* terrainMesh = new btTriangleIndexVertexArray(m_indices.size() / 3, &m_indices[0], 3 * sizeof(int), m_vertices.size(), (btScalar*)&m_vertices[0].x(), sizeof(btVector3));
+		m_meshInterfaces.push_back(terrainMesh);
+		btBvhTriangleMeshShape* terrainShape = new btBvhTriangleMeshShape(terrainMesh, true);
+		m_shapes.push_back(terrainShape);
+		addObject(world, terrainShape, btTransform::getIdentity());
+
+		//a small mesh with 16 bit indices, used unscaled and scaled
+		const int smallSize = 8;
+		for (int z = 0; z <= smallSize; z++)
+		{
+			for (int x = 0; x <= smallSize; x++)
+			{
+				m_smallVertices.push_back(btVector3(btScalar(x - smallSize / 2), btScalar(0.5) * btSin(btScalar(x * z)), btScalar(z - smallSize / 2)));
+			}
+		}
+		for (int z = 0; z < smallSize; z++)
+		{
+			for (int x = 0; x < smallSize; x++)
+			{
+				short i = short(z * (smallSize + 1) + x);
+				m_smallIndices.push_back(i); m_smallIndices.push_back(short(i + smallSize + 1)); m_smallIndices.push_back(short(i + 1));
+				m_smallIndices.push_back(short(i + 1)); m_smallIndices.push_back(short(i + smallSize + 1)); m_smallIndices.push_back(short(i + smallSize + 2));
+			}
+		}
+		btTriangleIndexVertexArray* smallMesh = new btTriangleIndexVertexArray();
+		btIndexedMesh part;
+		part.m_numTriangles = m_smallIndices.size() / 3;
+		part.m_triangleIndexBase = (const unsigned char*)&m_smallIndices[0];
+		part.m_triangleIndexStride = 3 * sizeof(short);
+		part.m_numVertices = m_smallVertices.size();
+		part.m_vertexBase = (const unsigned char*)&m_smallVertices[0].x();
+		part.m_vertexStride = sizeof(btVector3);
+		smallMesh->addIndexedMesh(part, PHY_SHORT);
+		m_meshInterfaces.push_back(smallMesh);
+		btBvhTriangleMeshShape* smallShape = new btBvhTriangleMeshShape(smallMesh, true);
+		m_shapes.push_back(smallShape);
+		btScaledBvhTriangleMeshShape* scaledShape = new btScaledBvhTriangleMeshShape(smallShape, btVector3(2, 1, 3));
+		m_shapes.push_back(scaledShape);
+
+		btAlignedObjectArray<btCollisionShape*> shapes;
+		shapes.push_back(smallShape);
+		shapes.push_back(scaledShape);
+		shapes.push_back(new btBoxShape(btVector3(1, 0.5, 2)));
+		shapes.push_back(new btSphereShape(1));
+		shapes.push_back(new btCapsuleShape(btScalar(0.5), 2));
+		shapes.push_back(new btCapsuleShapeX(btScalar(0.75), 1));
+		shapes.push_back(new btCylinderShape(btVector3(1, 1, 1)));
+		shapes.push_back(new btCylinderShapeZ(btVector3(btScalar(0.5), btScalar(0.5), 2)));
+		btVector3 spherePositions[2] = {btVector3(-1, 0, 0), btVector3(1, 0, 0)};
+		btScalar sphereRadii[2] = {btScalar(0.5), btScalar(1.)};
+		shapes.push_back(new btMultiSphereShape(spherePositions, sphereRadii, 2));
+		btBoxShape* scaledBox = new btBoxShape(btVector3(1, 1, 1));
+		scaledBox->setLocalScaling(btVector3(2, btScalar(0.5), 1));
+		shapes.push_back(scaledBox);
+		for (int i = 0; i < NUM_HULLS; i++)
+		{
+			btConvexHullShape* hull = new btConvexHullShape();
+			for (int j = 0; j < 32; j++)
+			{
+				hull->addPoint(btVector3(randRange(-1, 1), randRange(-1, 1), randRange(-1, 1)));
+			}
+			shapes.push_back(hull);
+		}
+		btCompoundShape* compound = new btCompoundShape();
+		btTransform childTransform;
+		childTransform.setIdentity();
+		childTransform.setOrigin(btVector3(-1, 0, 0));
+		compound->addChildShape(childTransform, shapes[2]);
+		childTransform.setOrigin(btVector3(1, 0, 0));
+		compound->addChildShape(childTransform, shapes[3]);
+		childTransform.setRotation(btQuaternion(btVector3(1, 0, 0), SIMD_HALF_PI));
+		compound->addChildShape(childTransform, shapes[10]);
+		shapes.push_back(compound);
+		for (int i = 2; i < shapes.size(); i++)
+		{
+			m_shapes.push_back(shapes[i]);
+		}
+
+		for (int i = 0; i < NUM_OBJECTS; i++)
+		{
+			btTransform tr;
+			tr.setIdentity();
+			tr.setRotation(btQuaternion(btVector3(randRange(-1, 1), 1, randRange(-1, 1)).normalized(), randRange(0, SIMD_2_PI)));
+			tr.setOrigin(btVector3(randRange(-150, 150), randRange(6, 10), randRange(-150, 150)));
+			addObject(world, shapes[i % shapes.size()], tr);
+		}
+		btStaticPlaneShape* plane = new btStaticPlaneShape(btVector3(0, 1, 0), -10);
+		m_shapes.push_back(plane);
+		addObject(world, plane, btTransform::getIdentity());
+	}
+
+	void addObject(btCollisionWorld& world, btCollisionShape* shape, const btTransform& tr)
+	{
+		btCollisionObject* object = new btCollisionObject();
+		object->setCollisionShape(shape);
+		object->setWorldTransform(tr);
+		world.addCollisionObject(object);
+		m_objects.push_back(object);
+	}
+
+	void destroy(btCollisionWorld& world)
+	{
+		for (int i = 0; i < m_objects.size(); i++)
+		{
+			world.removeCollisionObject(m_objects[i]);
+			delete m_objects[i];
+		}
+		for (int i = m_shapes.size() - 1; i >= 0; i--)
+		{
+			delete m_shapes[i];
+		}
+		for (int i = 0; i < m_meshInterfaces.size(); i++)
+		{
+			delete m_meshInterfaces[i];
+		}
+	}
+};
+
+struct RayHit
+{
+	int m_object;
+	btScalar m_fraction;
+	btVector3 m_point;
+	btVector3 m_normal;
+};
+
+static void castRays(btCollisionWorld& world, const btAlignedObjectArray<btVector3>& rayFrom, const btAlignedObjectArray<btVector3>& rayTo, btAlignedObjectArray<RayHit>& hits)
+{
+	hits.resize(rayFrom.size());
+	for (int i = 0; i < rayFrom.size(); i++)
+	{
+		btCollisionWorld::ClosestRayResultCallback callback(rayFrom[i], rayTo[i]);
+		world.rayTest(rayFrom[i], rayTo[i], callback);
+		hits[i].m_object = callback.m_collisionObject ? world.getCollisionObjectArray().findLinearSearch((btCollisionObject*)callback.m_collisionObject) : -1;
+		hits[i].m_fraction = callback.m_closestHitFraction;
+		hits[i].m_point = callback.m_hitPointWorld;
+		hits[i].m_normal = callback.m_hitNormalWorld;
+	}
+}
+
+///the fourth component is not part of the result
+static bool sameXyz(const btVector3& a, const btVector3& b)
+{
+	return a.x() == b.x() && a.y() == b.y() && a.z() == b.z();
+}
+
+static int countMismatches(const btAlignedObjectArray<RayHit>& a, const btAlignedObjectArray<RayHit>& b)
+{
+	int mismatches = 0;
+	for (int i = 0; i < a.size(); i++)
+	{
+		if (a[i].m_object != b[i].m_object)
+			mismatches++;
+		else if (a[i].m_object >= 0 && (a[i].m_fraction != b[i].m_fraction || !sameXyz(a[i].m_point, b[i].m_point) || !sameXyz(a[i].m_normal, b[i].m_normal)))
+			mismatches++;
+	}
+	return mismatches;
+}
+
+static void swapBytes(char* data, int size)
+{
+	for (int i = 0; i < size / 2; i++)
+	{
+		char c = data[i];
+		data[i] = data[size - 1 - i];
+		data[size - 1 - i] = c;
+	}
+}
+
+///byte swaps the counts and numbers of a little endian dna, the names stay as they are
+static void swapDna(char* dna)
+{
+	char* cp = dna + 8;
+	int numNames = *(int*)cp;
+	swapBytes(cp, 4);
+	cp += 4;
+	for (int i = 0; i < numNames; i++)
+	{
+		cp += strlen(cp) + 1;
+	}
+	cp = dna + ((cp - dna + 3) & ~3);
+	int numTypes = *(int*)(cp + 4);
+	swapBytes(cp + 4, 4);
+	cp += 8;
+	for (int i = 0; i < numTypes; i++)
+	{
+		cp += strlen(cp) + 1;
+	}
+	cp = dna + ((cp - dna + 3) & ~3);
+	cp += 4;
+	for (int i = 0; i < numTypes; i++, cp += 2)
+	{
+		swapBytes(cp, 2);
+	}
+	cp = dna + ((cp - dna + 3) & ~3);
+	int numStructs = *(int*)(cp + 4);
+	swapBytes(cp + 4, 4);
+	cp += 8;
+	for (int i = 0; i < numStructs; i++)
+	{
+		int numMembers = *(short*)(cp + 2);
+		for (int j = 0; j < 2 + 2 * numMembers; j++, cp += 2)
+		{
+			swapBytes(cp, 2);
+		}
+	}
+}
+
+static void appendInt(btAlignedObjectArray<char>& out, int value, bool swap)
+{
+	char bytes[4];
+	memcpy(bytes, &value, 4);
+	if (swap)
+		swapBytes(bytes, 4);
+	for (int i = 0; i < 4; i++)
+		out.push_back(bytes[i]);
+}
+
+///rewrites a .bullet file of this build for 32 bit pointers in big endian byte order, converting each struct chunk
+///with btSerializedDna::convertStructs, the way a file of such a platform would be written
+static bool writeForeignFile(const char* data, int length, btAlignedObjectArray<char>& out)
+{
+	btSerializedDna nativeDna, foreignDna;
+	if (!nativeDna.initNative() || !foreignDna.init(sBulletDNAstr, sBulletDNAlen, 4, false, true))
+		return false;
+	for (int i = 0; i < BT_HEADER_LENGTH; i++)
+		out.push_back(data[i]);
+	out[7] = '_';
+	out[8] = 'V';
+
+	int offset = BT_HEADER_LENGTH;
+	btAlignedObjectArray<char> converted;
+	while (offset + int(sizeof(btChunk)) <= length)
+	{
+		btChunk chunk;
+		memcpy(&chunk, data + offset, sizeof(btChunk));
+		const char* chunkData = data + offset + sizeof(btChunk);
+		offset += sizeof(btChunk) + chunk.m_length;
+
+		int foreignStruct = -1;
+		if (chunk.m_chunkCode == BT_DNA_CODE)
+		{
+			converted.resize(sBulletDNAlen);
+			memcpy(&converted[0], sBulletDNAstr, sBulletDNAlen);
+			swapDna(&converted[0]);
+		} else if (chunk.m_dna_nr >= 0)
+		{
+			foreignStruct = foreignDna.findStruct(nativeDna.getStructName(chunk.m_dna_nr));
+			if (foreignStruct < 0)
+				return false;
+			converted.resize(foreignDna.getStruct(foreignStruct).m_size * chunk.m_number);
+			nativeDna.convertStructs(chunk.m_dna_nr, chunkData, foreignDna, foreignStruct, converted.size() ? &converted[0] : 0, chunk.m_number);
+		} else
+		{
+			converted.resize(chunk.m_length);
+			if (chunk.m_length)
+				memcpy(&converted[0], chunkData, chunk.m_length);
+		}
+
+		//code, length, 32 bit old pointer, dna index, number
+		for (int i = 0; i < 4; i++)
+			out.push_back(((const char*)&chunk.m_chunkCode)[i]);
+		appendInt(out, converted.size(), true);
+		appendInt(out, int(size_t(chunk.m_oldPtr)), true);
+		appendInt(out, foreignStruct, true);
+		appendInt(out, chunk.m_number, true);
+		for (int i = 0; i < converted.size(); i++)
+			out.push_back(converted[i]);
+	}
+	return true;
+}
+
+static bool loadAndCompare(const char* label, btCollisionFileLoader& loader, btCollisionWorld& world, bool fromFile, const char* fileName, void* buffer, int length,
+	const btAlignedObjectArray<btVector3>& rayFrom, const btAlignedObjectArray<btVector3>& rayTo, const btAlignedObjectArray<RayHit>& reference, unsigned long int usReference)
+{
+	btClock clock;
+	bool loaded = fromFile ? loader.loadFile(fileName) : loader.loadBuffer(buffer, length);
+	unsigned long int usLoad = clock.getTimeMicroseconds();
+	if (!loaded)
+	{
+		printf("%s: loading failed: %s\n", label, loader.getFile().getError());
+		return false;
+	}
+	const btSerializedFile& file = loader.getFile();
+	printf("%s: %d objects, %d shapes, %d-bit %s, loaded in %lu us\n", label, loader.getNumCollisionObjects(), loader.getNumCollisionShapes(),
+		file.getPointerSize() * 8, file.isSwapped() ? "swapped" : "native order", usLoad);
+	printf("  chunk data in place %8lu bytes, copied or converted %8lu bytes\n", (unsigned long int)file.getInPlaceBytes(), (unsigned long int)file.getCopiedBytes());
+
+	world.updateAabbs();
+	btAlignedObjectArray<RayHit> hits;
+	clock.reset();
+	castRays(world, rayFrom, rayTo, hits);
+	unsigned long int usRays = clock.getTimeMicroseconds();
+	int mismatches = countMismatches(reference, hits);
+	printf("  rayTest %8lu us (original world %lu us)  %s\n", usRays, usReference, mismatches ? "MISMATCH" : "identical");
+	if (mismatches)
+		printf("  %d rays differ\n", mismatches);
+	loader.deleteAllData();
+	return !mismatches;
+}
+
+int main(int argc, char* argv[])
+{
+	int terrainSize = argc > 1 ? atoi(argv[1]) : TERRAIN_SIZE;
+	if (terrainSize < 2)
+		terrainSize = 2;
+	const char* fileName = argc > 2 ? argv[2] : "bullet_file_bench.bullet";
+
+	btDefaultCollisionConfiguration collisionConfiguration;
+	btCollisionDispatcher dispatcher(&collisionConfiguration);
+	btDbvtBroadphase broadphase;
+	btCollisionWorld world(&dispatcher, &broadphase, &collisionConfiguration);
+
+	srand(1);
+	Level level;
+	btClock clock;
+	level.build(world, terrainSize);
+	world.updateAabbs();
+	unsigned long int usBuild = clock.getTimeMicroseconds();
+	printf("%d triangles, %d objects\n", terrainSize * terrainSize * 2, world.getNumCollisionObjects());
+	printf("build level with bvh        %8lu us\n", usBuild);
+
+	btAlignedObjectArray<btVector3> rayFrom, rayTo;
+	for (int i = 0; i < NUM_RAYS; i++)
+	{
+		rayFrom.push_back(btVector3(randRange(-150, 150), randRange(8, 14), randRange(-150, 150)));
+		rayTo.push_back(rayFrom[i] + btVector3(randRange(-40, 40), randRange(-24, 2), randRange(-40, 40)));
+	}
+	btAlignedObjectArray<RayHit> reference;
+	clock.reset();
+	castRays(world, rayFrom, rayTo, reference);
+	unsigned long int usReference = clock.getTimeMicroseconds();
+
+	btDefaultSerializer* serializer = new btDefaultSerializer();
+	clock.reset();
+	world.serialize(serializer);
+	FILE* file = fopen(fileName, "wb");
+	if (!file)
+	{
+		printf("cannot write %s\n", fileName);
+		return 1;
+	}
+	fwrite(serializer->getBufferPointer(), serializer->getCurrentBufferSize(), 1, file);
+	fclose(file);
+	printf("serialize and write         %8lu us, %d bytes\n", clock.getTimeMicroseconds(), serializer->getCurrentBufferSize());
+
+	int failures = 0;
+	btDbvtBroadphase loadedBroadphase;
+	btCollisionWorld loadedWorld(&dispatcher, &loadedBroadphase, &collisionConfiguration);
+	level.destroy(world);
+	{
+		btCollisionFileLoader loader(&loadedWorld);
+		if (!loadAndCompare("mapped file", loader, loadedWorld, true, fileName, 0, 0, rayFrom, rayTo, reference, usReference))
+			failures++;
+
+		btAlignedObjectArray<char> foreign;
+		if (!writeForeignFile((const char*)serializer->getBufferPointer(), serializer->getCurrentBufferSize(), foreign))
+		{
+			printf("cannot convert the file for 32 bit big endian\n");
+			failures++;
+		} else if (!loadAndCompare("32 bit big endian buffer", loader, loadedWorld, false, 0, &foreign[0], foreign.size(), rayFrom, rayTo, reference, usReference))
+		{
+			failures++;
+		}
+	}
+	delete serializer;
+	return failures ? 1 : 0;
+}
@@ -0,0 +1,300 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2012 Erwin Coumans  http://bulletphysics.org
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+///Triangle mesh bvh build and query benchmark
+///Builds the quantized bvh of a terrain scattered with dense clusters of small triangles with the median split and the
+///binned SAH build, serially and with a task scheduler of 1, 2 and 4 threads, then runs aabb queries, rays, box casts
+///and rayTestBatch against the binary and the 4-wide node layouts.
+///Checks the parallel builds produce exactly the serial trees and every layout reports exactly the same triangles.
+///Usage: bvh_build_bench [terrain size] [number of queries]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "btBulletDynamicsCommon.h"
+#include "LinearMath/btQuickprof.h"
+#include "LinearMath/btAlignedObjectArray.h"
+#include "LinearMath/btThreads.h"
+#include "BulletCollision/NarrowPhaseCollision/btRaycastCallback.h"
+
+#define TERRAIN_SIZE 256
+#define NUM_CLUSTERS 64
+#define CLUSTER_TRIANGLES 2048
+#define NUM_QUERIES 20000
+
+static btScalar randRange(btScalar lo, btScalar hi)
+{
+	return lo + (hi - lo) * btScalar(rand()) / btScalar(RAND_MAX);
+}
+
+///order independent summary of the triangles reported by a query
+struct TriangleSetCallback : public btTriangleCallback
+{
+	int				m_count;
+	unsigned int	m_hash;
+
+	TriangleSetCallback()
+		:m_count(0),
+		m_hash(0)
+	{
+	}
+
+	virtual void processTriangle(btVector3* triangle, int partId, int triangleIndex)
+	{
+		(void)triangle;
+		m_count++;
+		m_hash += (unsigned int)(partId * 31 + triangleIndex) * 2654435761u;
+	}
+};
+
+struct ClosestTriangleRayCallback : public btTriangleRaycastCallback
+{
+	TriangleSetCallback	m_set;
+
+	ClosestTriangleRayCallback(const btVector3& from, const btVector3& to)
+		:btTriangleRaycastCallback(from, to)
+	{
+	}
+
+	virtual void processTriangle(btVector3* triangle, int partId, int triangleIndex)
+	{
+		m_set.processTriangle(triangle, partId, triangleIndex);
+		btTriangleRaycastCallback::processTriangle(triangle, partId, triangleIndex);
+	}
+
+	virtual btScalar reportHit(const btVector3& hitNormalLocal, btScalar hitFraction, int partId, int triangleIndex)
+	{
+		(void)hitNormalLocal; (void)partId; (void)triangleIndex;
+		return hitFraction;
+	}
+};
+
+struct QueryResult
+{
+	int				m_count;
+	unsigned int	m_hash;
+	btScalar		m_fraction;
+
+	bool operator==(const QueryResult& other) const
+	{
+		return m_count == other.m_count && m_hash == other.m_hash && m_fraction == other.m_fraction;
+	}
+};
+
+struct Queries
+{
+	btAlignedObjectArray<btVector3>	m_aabbMin;
+	btAlignedObjectArray<btVector3>	m_aabbMax;
+	btAlignedObjectArray<btVector3>	m_rayFrom;
+	btAlignedObjectArray<btVector3>	m_rayTo;
+};
+
+static bool sameTree(btOptimizedBvh* a, btOptimizedBvh* b)
+{
+	if (a->getQuantizedNodeArray().size() != b->getQuantizedNodeArray().size() ||
+		a->getSubtreeInfoArray().size() != b->getSubtreeInfoArray().size())
+		return false;
+	return !memcmp(&a->getQuantizedNodeArray()[0], &b->getQuantizedNodeArray()[0], a->getQuantizedNodeArray().size() * sizeof(btQuantizedBvhNode)) &&
+		!memcmp(&a->getSubtreeInfoArray()[0], &b->getSubtreeInfoArray()[0], a->getSubtreeInfoArray().size() * sizeof(btBvhSubtreeInfo));
+}
+
+static btBvhTriangleMeshShape* buildShape(btStridingMeshInterface* meshInterface, btQuantizedBvh::btBuildMode buildMode, bool useWideNodes,
+	btITaskScheduler* scheduler, unsigned long int& us)
+{
+	btBvhTriangleMeshShape* shape = new btBvhTriangleMeshShape(meshInterface, true, false);
+	shape->setBvhBuildSettings(buildMode, useWideNodes, scheduler);
+	btClock clock;
+	shape->buildOptimizedBvh();
+	us = clock.getTimeMicroseconds();
+	return shape;
+}
+
+///runs all queries against shape, returns the number of queries that differ from reference (or fills reference when empty)
+static int runQueries(const char* name, btBvhTriangleMeshShape* shape, const Queries& queries, btAlignedObjectArray<QueryResult>& reference)
+{
+	const int numQueries = queries.m_rayFrom.size();
+	btAlignedObjectArray<QueryResult> results;
+	results.resize(3 * numQueries + numQueries);
+	btClock clock;
+	for (int i = 0; i < numQueries; i++)
+	{
+		TriangleSetCallback callback;
+		shape->processAllTriangles(&callback, queries.m_aabbMin[i], queries.m_aabbMax[i]);
+		QueryResult result = {callback.m_count, callback.m_hash, 0};
+		results[i] = result;
+	}
+	unsigned long int usAabb = clock.getTimeMicroseconds();
+	clock.reset();
+	for (int i = 0; i < numQueries; i++)
+	{
+		ClosestTriangleRayCallback callback(queries.m_rayFrom[i], queries.m_rayTo[i]);
+		shape->performRaycast(&callback, queries.m_rayFrom[i], queries.m_rayTo[i]);
+		QueryResult result = {callback.m_set.m_count, callback.m_set.m_hash, callback.m_hitFraction};
+		results[numQueries + i] = result;
+	}
+	unsigned long int usRay = clock.getTimeMicroseconds();
+	const btVector3 boxExtents(btScalar(0.5), btScalar(0.5), btScalar(0.5));
+	clock.reset();
+	for (int i = 0; i < numQueries; i++)
+	{
+		TriangleSetCallback callback;
+		shape->performConvexcast(&callback, queries.m_rayFrom[i], queries.m_rayTo[i], -boxExtents, boxExtents);
+		QueryResult result = {callback.m_count, callback.m_hash, 0};
+		results[2 * numQueries + i] = result;
+	}
+	unsigned long int usBoxCast = clock.getTimeMicroseconds();
+
+	//rayTestBatch traverses the bvh with ray packets
+	btDefaultCollisionConfiguration collisionConfiguration;
+	btCollisionDispatcher dispatcher(&collisionConfiguration);
+	btDbvtBroadphase broadphase;
+	btCollisionWorld world(&dispatcher, &broadphase, &collisionConfiguration);
+	btCollisionObject object;
+	object.setCollisionShape(shape);
+	world.addCollisionObject(&object);
+	btAlignedObjectArray<btCollisionWorld::RayBatchHit> hits;
+	hits.resize(numQueries);
+	clock.reset();
+	world.rayTestBatch(&queries.m_rayFrom[0], &queries.m_rayTo[0], numQueries, &hits[0]);
+	unsigned long int usBatch = clock.getTimeMicroseconds();
+	world.removeCollisionObject(&object);
+	for (int i = 0; i < numQueries; i++)
+	{
+		QueryResult result = {hits[i].m_collisionObject ? 1 : 0, 0, hits[i].m_collisionObject ? hits[i].m_hitFraction : btScalar(1.)};
+		results[3 * numQueries + i] = result;
+	}
+
+	int mismatches = 0;
+	if (reference.size())
+	{
+		for (int i = 0; i < results.size(); i++)
+		{
+			if (!(results[i] == reference[i]))
+				mismatches++;
+		}
+	}
+	else
+	{
+		reference = results;
+	}
+	printf("%-18s aabb %8lu us  ray %8lu us  box cast %8lu us  rayTestBatch %8lu us  %s\n", name, usAabb, usRay, usBoxCast, usBatch,
+		mismatches ? "MISMATCH" : "identical");
+	return mismatches;
+}
+
+int main(int argc, char* argv[])
+{
+	int terrainSize = argc > 1 ? atoi(argv[1]) : TERRAIN_SIZE;
+	int numQueries = argc > 2 ? atoi(argv[2]) : NUM_QUERIES;
+	if (terrainSize < 2)
+		terrainSize = 2;
+	if (numQueries < 1)
+		numQueries = 1;
+	const btScalar halfSize = btScalar(terrainSize / 2);
+
+	srand(1);
+	btAlignedObjectArray<btVector3> vertices;
+	btAlignedObjectArray<int> indices;
+	for (int z = 0; z <= terrainSize; z++)
+	{
+		for (int x = 0; x <= terrainSize; x++)
+		{
+			const btScalar height = btScalar(2.) * btSin(btScalar(x) * btScalar(0.2)) * btCos(btScalar(z) * btScalar(0.15)) + randRange(0, btScalar(0.3));
+			vertices.push_back(btVector3(btScalar(x) - halfSize, height, btScalar(z) - halfSize));
+		}
+	}
+	for (int z = 0; z < terrainSize; z++)
+	{
+		for (int x = 0; x < terrainSize; x++)
+		{
+			int i = z * (terrainSize + 1) + x;
+			indices.push_back(i); indices.push_back(i + terrainSize + 1); indices.push_back(i + 1);
+			indices.push_back(i + 1); indices.push_back(i + terrainSize + 1); indices.push_back(i + terrainSize + 2);
+		}
+	}
+	//dense clusters of small triangles, like the props of a level, give the tree an uneven triangle distribution
+	for (int c = 0; c < NUM_CLUSTERS; c++)
+	{
+		const btVector3 center(randRange(-halfSize, halfSize), randRange(1, 4), randRange(-halfSize, halfSize));
+		for (int t = 0; t < CLUSTER_TRIANGLES; t++)
+		{
+			const btVector3 corner = center + btVector3(randRange(-2, 2), randRange(-2, 2), randRange(-2, 2));
+			indices.push_back(vertices.size());
+			indices.push_back(vertices.size() + 1);
+			indices.push_back(vertices.size() + 2);
+			vertices.push_back(corner);
+			vertices.push_back(corner + btVector3(randRange(0, btScalar(0.2)), randRange(0, btScalar(0.2)), 0));
+			vertices.push_back(corner + btVector3(0, randRange(0, btScalar(0.2)), randRange(0, btScalar(0.2))));
+		}
+	}
+	btTriangleIndexVertexArray meshInterface(indices.size() / 3, &indices[0], 3 * sizeof(int), vertices.size(), (btScalar*)&vertices[0].x(), sizeof(btVector3));
+	printf("%d triangles\n", indices.size() / 3);
+
+	int failures = 0;
+	unsigned long int usMedian, usSah;
+	btBvhTriangleMeshShape* medianShape = buildShape(&meshInterface, btQuantizedBvh::BUILD_MEDIAN_SPLIT, false, 0, usMedian);
+	btBvhTriangleMeshShape* sahShape = buildShape(&meshInterface, btQuantizedBvh::BUILD_BINNED_SAH, false, 0, usSah);
+	printf("median split build         %8lu us\n", usMedian);
+	printf("binned SAH build           %8lu us\n", usSah);
+	for (int numThreads = 1; numThreads <= 4; numThreads *= 2)
+	{
+		btITaskScheduler* scheduler = btCreateDefaultTaskScheduler(numThreads);
+		if (!scheduler)
+			break;
+		scheduler->setNumThreads(numThreads);
+		for (int mode = 0; mode < 2; mode++)
+		{
+			unsigned long int us;
+			btBvhTriangleMeshShape* shape = buildShape(&meshInterface, mode ? btQuantizedBvh::BUILD_BINNED_SAH : btQuantizedBvh::BUILD_MEDIAN_SPLIT,
+				false, scheduler, us);
+			const bool same = sameTree(shape->getOptimizedBvh(), (mode ? sahShape : medianShape)->getOptimizedBvh());
+			if (!same)
+				failures++;
+			printf("%-12s %d threads     %8lu us  x%4.2f  %s\n", mode ? "binned SAH" : "median split", numThreads, us,
+				us ? double(mode ? usSah : usMedian) / double(us) : 0.0, same ? "identical" : "MISMATCH");
+			delete shape;
+		}
+		btDeleteTaskScheduler(scheduler);
+	}
+
+	unsigned long int usWide;
+	btBvhTriangleMeshShape* medianWideShape = buildShape(&meshInterface, btQuantizedBvh::BUILD_MEDIAN_SPLIT, true, 0, usWide);
+	btBvhTriangleMeshShape* sahWideShape = buildShape(&meshInterface, btQuantizedBvh::BUILD_BINNED_SAH, true, 0, usWide);
+	printf("binned SAH + 4-wide build  %8lu us, %d wide nodes for %d binary nodes\n", usWide,
+		sahWideShape->getOptimizedBvh()->getWideNodeArray().size(), sahWideShape->getOptimizedBvh()->getQuantizedNodeArray().size());
+
+	Queries queries;
+	for (int i = 0; i < numQueries; i++)
+	{
+		const btVector3 center(randRange(-halfSize, halfSize), randRange(-1, 4), randRange(-halfSize, halfSize));
+		const btVector3 extents(randRange(btScalar(0.1), 3), randRange(btScalar(0.1), 3), randRange(btScalar(0.1), 3));
+		queries.m_aabbMin.push_back(center - extents);
+		queries.m_aabbMax.push_back(center + extents);
+		queries.m_rayFrom.push_back(btVector3(randRange(-halfSize, halfSize), randRange(3, 6), randRange(-halfSize, halfSize)));
+		queries.m_rayTo.push_back(queries.m_rayFrom[i] + btVector3(randRange(-30, 30), randRange(-6, 1), randRange(-30, 30)));
+	}
+	btAlignedObjectArray<QueryResult> reference;
+	runQueries("median split", medianShape, queries, reference);
+	failures += runQueries("median split wide", medianWideShape, queries, reference) ? 1 : 0;
+	failures += runQueries("binned SAH", sahShape, queries, reference) ? 1 : 0;
+	failures += runQueries("binned SAH wide", sahWideShape, queries, reference) ? 1 : 0;
+
+	delete medianShape;
+	delete sahShape;
+	delete medianWideShape;
+	delete sahWideShape;
+	return failures ? 1 : 0;
+}
@@ -0,0 +1,298 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2012 Erwin Coumans  http://bulletphysics.org
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+///Batched convex separation benchmark
+///Bounds the distance of random pairs of spheres, boxes, capsules and convex hulls with btGjkEpaSolver2::SeparationLowerBounds,
+///four pairs per SIMD lanes, and compares it with one btGjkPairDetector query per pair. Every bound must be below the distance.
+///Then steps a scattered pile of the same shapes with btCollisionDispatcher, with CD_BATCH_CONVEX_SEPARATION set,
+///and with a btCollisionDispatcherMt on several tasks; the transforms must be identical.
+///Usage: convex_batch_bench [number of pairs] [number of steps] [number of tasks]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "btBulletDynamicsCommon.h"
+#include "BulletCollision/NarrowPhaseCollision/btGjkEpa2.h"
+#include "BulletCollision/NarrowPhaseCollision/btGjkPairDetector.h"
+#include "BulletCollision/NarrowPhaseCollision/btGjkEpaPenetrationDepthSolver.h"
+#include "BulletCollision/NarrowPhaseCollision/btVoronoiSimplexSolver.h"
+#include "BulletCollision/NarrowPhaseCollision/btPointCollector.h"
+#include "BulletCollision/CollisionDispatch/btCollisionDispatcherMt.h"
+#include "LinearMath/btQuickprof.h"
+
+#define NUM_PAIRS 100000
+#define NUM_STEPS 200
+#define NUM_TASKS 4
+#define NUM_SHAPES 5
+#define THRESHOLD btScalar(0.02)
+
+static unsigned int gSeed = 12345;
+
+static btScalar randRange(btScalar lo, btScalar hi)
+{
+	gSeed = gSeed * 1664525u + 1013904223u;
+	return lo + (hi - lo) * btScalar(gSeed >> 8) / btScalar(1 << 24);
+}
+
+static btQuaternion randRotation()
+{
+	btQuaternion q(randRange(-1, 1), randRange(-1, 1), randRange(-1, 1), randRange(-1, 1));
+	if (q.length2() < btScalar(1e-4))
+		return btQuaternion::getIdentity();
+	return q.normalized();
+}
+
+///a hull of points on a squashed sphere
+static btConvexHullShape* createHull(int numPoints, const btVector3& radii)
+{
+	btAlignedObjectArray<btVector3> points;
+	for (int i = 0; i < numPoints; i++)
+	{
+		btVector3 p(randRange(-1, 1), randRange(-1, 1), randRange(-1, 1));
+		if (p.length2() < btScalar(1e-4))
+			p.setValue(1, 0, 0);
+		points.push_back(p.normalized() * radii);
+	}
+	return new btConvexHullShape(&points[0].x(), points.size());
+}
+
+struct Shapes
+{
+	btSphereShape		m_sphere;
+	btBoxShape			m_box;
+	btCapsuleShape		m_capsule;
+	btConvexHullShape*	m_smallHull;
+	btConvexHullShape*	m_largeHull;
+	btConvexShape*		m_shapes[NUM_SHAPES];
+
+	Shapes()
+		:m_sphere(btScalar(0.5)),
+		m_box(btVector3(btScalar(0.6), btScalar(0.3), btScalar(0.4))),
+		m_capsule(btScalar(0.3), btScalar(0.8))
+	{
+		m_smallHull = createHull(32, btVector3(btScalar(0.6), btScalar(0.4), btScalar(0.5)));
+		m_largeHull = createHull(200, btVector3(btScalar(0.5), btScalar(0.7), btScalar(0.4)));
+		m_shapes[0] = &m_sphere;
+		m_shapes[1] = &m_box;
+		m_shapes[2] = &m_capsule;
+		m_shapes[3] = m_smallHull;
+		m_shapes[4] = m_largeHull;
+	}
+
+	~Shapes()
+	{
+		delete m_smallHull;
+		delete m_largeHull;
+	}
+};
+
+///returns the number of pairs whose bound is above their distance
+static int benchKernel(int numPairs)
+{
+	Shapes shapes;
+	btAlignedObjectArray<btTransform> transforms;
+	btAlignedObjectArray<btGjkEpaSolver2::sBatchPair> pairs;
+	transforms.resize(numPairs * 2);
+	pairs.resize(numPairs);
+	for (int i = 0; i < numPairs; i++)
+	{
+		//centers 0.5 to 2.5 apart, so pairs range from overlapping to well separated
+		transforms[i * 2].setRotation(randRotation());
+		transforms[i * 2].setOrigin(btVector3(0, 0, 0));
+		btVector3 dir(randRange(-1, 1), randRange(-1, 1), randRange(-1, 1));
+		if (dir.length2() < btScalar(1e-4))
+			dir.setValue(0, 1, 0);
+		transforms[i * 2 + 1].setRotation(randRotation());
+		transforms[i * 2 + 1].setOrigin(dir.normalized() * randRange(btScalar(0.5), btScalar(2.5)));
+		btGjkEpaSolver2::sBatchPair& pair = pairs[i];
+		pair.shapes[0] = shapes.m_shapes[i % NUM_SHAPES];
+		pair.shapes[1] = shapes.m_shapes[(i / NUM_SHAPES) % NUM_SHAPES];
+		pair.wtrs[0] = &transforms[i * 2];
+		pair.wtrs[1] = &transforms[i * 2 + 1];
+		pair.threshold = THRESHOLD;
+	}
+
+	btAlignedObjectArray<btScalar> bounds;
+	bounds.resize(numPairs);
+	btClock clock;
+	btGjkEpaSolver2::SeparationLowerBounds(&pairs[0], numPairs, &bounds[0]);
+	unsigned long int usBatch = clock.getTimeMicroseconds();
+
+	btVoronoiSimplexSolver simplexSolver;
+	btGjkEpaPenetrationDepthSolver penetrationSolver;
+	btAlignedObjectArray<btScalar> distances;
+	distances.resize(numPairs);
+	clock.reset();
+	for (int i = 0; i < numPairs; i++)
+	{
+		btGjkPairDetector detector(pairs[i].shapes[0], pairs[i].shapes[1], &simplexSolver, &penetrationSolver);
+		btGjkPairDetector::ClosestPointInput input;
+		input.m_transformA = *pairs[i].wtrs[0];
+		input.m_transformB = *pairs[i].wtrs[1];
+		btPointCollector output;
+		detector.getClosestPoints(input, output, 0);
+		distances[i] = output.m_hasResult ? output.m_distance : BT_LARGE_FLOAT;
+	}
+	unsigned long int usPairs = clock.getTimeMicroseconds();
+
+	//the reference distance of the cores from btGjkEpaSolver2, minus the margins
+	int violations = 0;
+	int numApart = 0;
+	int numProven = 0;
+	btScalar worstExcess = 0;
+	for (int i = 0; i < numPairs; i++)
+	{
+		btGjkEpaSolver2::sResults results;
+		btScalar distance = 0;
+		if (btGjkEpaSolver2::Distance(pairs[i].shapes[0], *pairs[i].wtrs[0], pairs[i].shapes[1], *pairs[i].wtrs[1], btVector3(1, 0, 0), results))
+		{
+			distance = results.distance - pairs[i].shapes[0]->getMarginNonVirtual() - pairs[i].shapes[1]->getMarginNonVirtual();
+		}
+		const btScalar excess = bounds[i] - distance;
+		worstExcess = btMax(worstExcess, excess);
+		if (excess > btScalar(1e-4))
+			violations++;
+		if (distance > pairs[i].threshold)
+		{
+			numApart++;
+			if (bounds[i] > pairs[i].threshold)
+				numProven++;
+		}
+	}
+
+	printf("%d pairs, %d farther than %.2f, %d proven apart by the batch (%.1f%%)\n", numPairs, numApart, double(THRESHOLD),
+		numProven, numApart ? 100. * double(numProven) / double(numApart) : 0.);
+	printf("SeparationLowerBounds, 4 lanes    %8lu us\n", usBatch);
+	printf("btGjkPairDetector, per pair       %8lu us\n", usPairs);
+	printf("bounds below the distance         %s (worst excess %g)\n", violations ? "VIOLATED" : "yes", double(worstExcess));
+	return violations;
+}
+
+///steps a scattered pile of mixed shapes and returns the elapsed time in microseconds
+static unsigned long int benchWorld(bool batch, int numTasks, int numSteps, btAlignedObjectArray<btTransform>& transforms)
+{
+	//the same hulls and the same pile for every run
+	gSeed = 4321;
+	Shapes shapes;
+	btDefaultCollisionConfiguration collisionConfiguration;
+	btCollisionDispatcherMt dispatcherMt(&collisionConfiguration);
+	btCollisionDispatcher dispatcherSerial(&collisionConfiguration);
+	btCollisionDispatcher* dispatcher = numTasks ? &dispatcherMt : &dispatcherSerial;
+	if (batch)
+		dispatcher->setDispatcherFlags(dispatcher->getDispatcherFlags() | btCollisionDispatcher::CD_BATCH_CONVEX_SEPARATION);
+	btDbvtBroadphase broadphase;
+	btSequentialImpulseConstraintSolver solver;
+	btDiscreteDynamicsWorld world(dispatcher, &broadphase, &solver, &collisionConfiguration);
+	if (numTasks)
+	{
+		world.setNumTasks(numTasks);
+		dispatcherMt.setTaskScheduler(world.getTaskScheduler());
+	}
+
+	btBoxShape ground(btVector3(100, 1, 100));
+	btAlignedObjectArray<btRigidBody*> bodies;
+	btTransform tr;
+	tr.setIdentity();
+	tr.setOrigin(btVector3(0, -1, 0));
+	bodies.push_back(new btRigidBody(0, 0, &ground));
+	bodies[0]->setWorldTransform(tr);
+	world.addRigidBody(bodies[0]);
+
+	//bodies about 1.3 apart, close enough for most neighbours to overlap in the broadphase while they fall and settle
+	const int size = 14;
+	for (int y = 0; y < 4; y++)
+	{
+		for (int x = 0; x < size; x++)
+		{
+			for (int z = 0; z < size; z++)
+			{
+				btConvexShape* shape = shapes.m_shapes[(x + z * 3 + y * 7) % NUM_SHAPES];
+				btVector3 inertia;
+				shape->calculateLocalInertia(1, inertia);
+				tr.setRotation(randRotation());
+				tr.setOrigin(btVector3(
+					btScalar(x - size / 2) * btScalar(1.3) + randRange(btScalar(-0.1), btScalar(0.1)),
+					btScalar(y) * btScalar(1.4) + btScalar(1),
+					btScalar(z - size / 2) * btScalar(1.3) + randRange(btScalar(-0.1), btScalar(0.1))));
+				btRigidBody* body = new btRigidBody(1, 0, shape, inertia);
+				body->setWorldTransform(tr);
+				world.addRigidBody(body);
+				bodies.push_back(body);
+			}
+		}
+	}
+
+	btClock clock;
+	for (int i = 0; i < numSteps; i++)
+	{
+		world.stepSimulation(btScalar(1.) / btScalar(60.), 0);
+	}
+	unsigned long int us = clock.getTimeMicroseconds();
+
+	transforms.resize(bodies.size());
+	for (int i = 0; i < bodies.size(); i++)
+	{
+		transforms[i] = bodies[i]->getWorldTransform();
+		world.removeRigidBody(bodies[i]);
+		delete bodies[i];
+	}
+	return us;
+}
+
+static bool identicalTransforms(const btAlignedObjectArray<btTransform>& a, const btAlignedObjectArray<btTransform>& b)
+{
+	if (a.size() != b.size())
+		return false;
+	for (int i = 0; i < a.size(); i++)
+	{
+		btTransformFloatData fa, fb;
+		a[i].serializeFloat(fa);
+		b[i].serializeFloat(fb);
+		if (memcmp(&fa, &fb, sizeof(fa)))
+			return false;
+	}
+	return true;
+}
+
+int main(int argc, char* argv[])
+{
+	int numPairs = argc > 1 ? atoi(argv[1]) : NUM_PAIRS;
+	int numSteps = argc > 2 ? atoi(argv[2]) : NUM_STEPS;
+	int numTasks = argc > 3 ? atoi(argv[3]) : NUM_TASKS;
+	if (numPairs < 1)
+		numPairs = 1;
+	if (numSteps < 1)
+		numSteps = 1;
+	if (numTasks < 1)
+		numTasks = 1;
+	int failures = benchKernel(numPairs);
+
+	btAlignedObjectArray<btTransform> reference, batched, parallel;
+	unsigned long int us = benchWorld(false, 0, numSteps, reference);
+	printf("%d bodies, %d steps\n", reference.size(), numSteps);
+	printf("btCollisionDispatcher             %8lu us\n", us);
+	us = benchWorld(true, 0, numSteps, batched);
+	bool same = identicalTransforms(reference, batched);
+	if (!same)
+		failures++;
+	printf("batched separation                %8lu us  %s\n", us, same ? "identical" : "DIFFERENT");
+	us = benchWorld(true, numTasks, numSteps, parallel);
+	same = identicalTransforms(reference, parallel);
+	if (!same)
+		failures++;
+	printf("batched separation, %2d tasks      %8lu us  %s\n", numTasks, us, same ? "identical" : "DIFFERENT");
+	return failures ? 1 : 0;
+}
@@ -0,0 +1,24 @@
+
+		project "convex_batch_bench"
+
+		language "C++"
+
+		kind "ConsoleApp"
+		targetdir "../../bin"
+
+  		includedirs {
+                ".",
+                "../../bullet2",
+                }
+
+		links {
+			"bullet2"
+		}
+
+		if not os.is("Windows") then
+			links {"pthread"}
+		end
+
+		files {
+		"main.cpp"
+		}
@@ -0,0 +1,243 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2012 Erwin Coumans  http://bulletphysics.org
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+///btDbvtBroadphase modes benchmark
+///Moves boxes in a closed room, a quarter of them at rest so they settle into the fixed set, and destroys and recreates
+///a few proxies every step. The same motion is fed to a btDbvtBroadphase in the default immediate mode, in deferred
+///collide mode and in the parallel mode (setTaskScheduler) with 1 and 4 threads, which refits in parallel, splits the
+///tree against tree tests into tasks and rebuilds the dynamic set on a background thread.
+///Checks after every step that each broadphase holds every pair a brute force test of all boxes finds, that the
+///parallel pair arrays are identical for 1 and 4 threads, and that background rebuilds were swapped in.
+///Usage: dbvt_broadphase_bench [number of boxes] [number of steps]
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "btBulletCollisionCommon.h"
+#include "LinearMath/btQuickprof.h"
+#include "LinearMath/btAlignedObjectArray.h"
+#include "LinearMath/btThreads.h"
+
+#define NUM_BOXES 3000
+#define NUM_STEPS 60
+#define NUM_MODES 4
+#define RECREATED_PER_STEP 16
+
+static const char* gModeNames[NUM_MODES] =
+{
+	"immediate",
+	"deferred collide",
+	"parallel, 1 thread",
+	"parallel, 4 threads",
+};
+
+struct Box
+{
+	btVector3	m_center;
+	btVector3	m_velocity;
+	btVector3	m_halfExtents;
+	bool		m_resting;
+};
+
+struct Mode
+{
+	btDbvtBroadphase*						m_broadphase;
+	btITaskScheduler*						m_scheduler;
+	btAlignedObjectArray<btBroadphaseProxy*>	m_proxies;
+	unsigned long int						m_us;
+	int										m_missing;
+	int										m_rebuilds;
+	bool									m_rebuildPending;
+};
+
+static btScalar randRange(btScalar lo, btScalar hi)
+{
+	return lo + (hi - lo) * btScalar(rand()) / btScalar(RAND_MAX);
+}
+
+static bool overlap(const Box& a, const Box& b)
+{
+	btVector3 d = (a.m_center - b.m_center).absolute() - (a.m_halfExtents + b.m_halfExtents);
+	return d.x() <= btScalar(0.) && d.y() <= btScalar(0.) && d.z() <= btScalar(0.);
+}
+
+static btBroadphaseProxy* createProxy(btDbvtBroadphase* broadphase, const Box& box, int index, btDispatcher* dispatcher)
+{
+	return broadphase->createProxy(box.m_center - box.m_halfExtents, box.m_center + box.m_halfExtents, BOX_SHAPE_PROXYTYPE,
+		(void*)(size_t)index, btBroadphaseProxy::DefaultFilter, btBroadphaseProxy::AllFilter, dispatcher, 0);
+}
+
+///hash of the pair array in its current order, by box index
+static unsigned int pairArrayChecksum(btDbvtBroadphase* broadphase)
+{
+	const btBroadphasePairArray& pairs = broadphase->getOverlappingPairCache()->getOverlappingPairArray();
+	unsigned int checksum = unsigned(pairs.size());
+	for (int i = 0; i < pairs.size(); i++)
+	{
+		checksum = checksum * 31u + unsigned(size_t(pairs[i].m_pProxy0->m_clientObject));
+		checksum = checksum * 31u + unsigned(size_t(pairs[i].m_pProxy1->m_clientObject));
+	}
+	return checksum;
+}
+
+int main(int argc, char* argv[])
+{
+	int numBoxes = argc > 1 ? atoi(argv[1]) : NUM_BOXES;
+	int numSteps = argc > 2 ? atoi(argv[2]) : NUM_STEPS;
+	if (numBoxes < 2)
+		numBoxes = 2;
+	if (numSteps < 1)
+		numSteps = 1;
+	int failures = 0;
+	btClock clock;
+
+	//about one box per 8 cubic units, with half extents from 0.2 to 1.5
+	btScalar roomHalfSize = btScalar(0.5) * btPow(btScalar(numBoxes) * btScalar(8.), btScalar(1.) / btScalar(3.));
+	srand(1234);
+	btAlignedObjectArray<Box> boxes;
+	boxes.resize(numBoxes);
+	for (int i = 0; i < numBoxes; i++)
+	{
+		Box& box = boxes[i];
+		box.m_halfExtents = btVector3(randRange(0.2f, 1.5f), randRange(0.2f, 1.5f), randRange(0.2f, 1.5f));
+		box.m_center = btVector3(randRange(-roomHalfSize, roomHalfSize), randRange(-roomHalfSize, roomHalfSize), randRange(-roomHalfSize, roomHalfSize));
+		box.m_velocity = btVector3(randRange(-0.3f, 0.3f), randRange(-0.3f, 0.3f), randRange(-0.3f, 0.3f));
+		box.m_resting = (i % 4) == 0;
+	}
+
+	btDefaultCollisionConfiguration collisionConfiguration;
+	btCollisionDispatcher dispatcher(&collisionConfiguration);
+	Mode modes[NUM_MODES];
+	for (int m = 0; m < NUM_MODES; m++)
+	{
+		Mode& mode = modes[m];
+		mode.m_broadphase = new btDbvtBroadphase();
+		mode.m_scheduler = 0;
+		mode.m_us = 0;
+		mode.m_missing = 0;
+		mode.m_rebuilds = 0;
+		mode.m_rebuildPending = false;
+		if (m == 1)
+			mode.m_broadphase->m_deferedcollide = true;
+		if (m >= 2)
+		{
+			int numThreads = m == 2 ? 1 : 4;
+			mode.m_scheduler = btCreateDefaultTaskScheduler(numThreads);
+			mode.m_scheduler->setNumThreads(numThreads);
+			mode.m_broadphase->setTaskScheduler(mode.m_scheduler);
+		}
+		mode.m_proxies.resize(numBoxes);
+		for (int i = 0; i < numBoxes; i++)
+		{
+			mode.m_proxies[i] = createProxy(mode.m_broadphase, boxes[i], i, &dispatcher);
+		}
+	}
+
+	int totalPairs = 0;
+	int parallelMismatches = 0;
+	for (int step = 0; step < numSteps; step++)
+	{
+		//move the boxes, bouncing off the walls
+		for (int i = 0; i < numBoxes; i++)
+		{
+			Box& box = boxes[i];
+			if (box.m_resting)
+				continue;
+			box.m_center += box.m_velocity;
+			for (int axis = 0; axis < 3; axis++)
+			{
+				if (btFabs(box.m_center[axis]) > roomHalfSize)
+					box.m_velocity[axis] = -box.m_velocity[axis];
+			}
+		}
+		//boxes recreated this step, in all modes
+		int recreateBegin = (step * RECREATED_PER_STEP * 7) % numBoxes;
+
+		for (int m = 0; m < NUM_MODES; m++)
+		{
+			Mode& mode = modes[m];
+			clock.reset();
+			for (int j = 0; j < RECREATED_PER_STEP && j < numBoxes; j++)
+			{
+				int i = (recreateBegin + j * 7) % numBoxes;
+				mode.m_broadphase->destroyProxy(mode.m_proxies[i], &dispatcher);
+				mode.m_proxies[i] = createProxy(mode.m_broadphase, boxes[i], i, &dispatcher);
+			}
+			for (int i = 0; i < numBoxes; i++)
+			{
+				const Box& box = boxes[i];
+				if (!box.m_resting)
+					mode.m_broadphase->setAabb(mode.m_proxies[i], box.m_center - box.m_halfExtents, box.m_center + box.m_halfExtents, &dispatcher);
+			}
+			mode.m_broadphase->calculateOverlappingPairs(&dispatcher);
+			mode.m_us += clock.getTimeMicroseconds();
+			//a rebuild is started at the end of a collide and swapped in at the next one
+			if (mode.m_broadphase->m_shadowpending && !mode.m_rebuildPending)
+				mode.m_rebuilds++;
+			mode.m_rebuildPending = mode.m_broadphase->m_shadowpending;
+		}
+
+		//every overlapping pair must be in each pair cache
+		for (int i = 0; i < numBoxes; i++)
+		{
+			for (int j = i + 1; j < numBoxes; j++)
+			{
+				if (!overlap(boxes[i], boxes[j]))
+					continue;
+				totalPairs++;
+				for (int m = 0; m < NUM_MODES; m++)
+				{
+					Mode& mode = modes[m];
+					if (!mode.m_broadphase->getOverlappingPairCache()->findPair(mode.m_proxies[i], mode.m_proxies[j]))
+						mode.m_missing++;
+				}
+			}
+		}
+
+		//the parallel tasks do not depend on the number of threads
+		if (pairArrayChecksum(modes[2].m_broadphase) != pairArrayChecksum(modes[3].m_broadphase))
+			parallelMismatches++;
+	}
+
+	printf("%d boxes, %d steps, %d overlapping pairs in total\n", numBoxes, numSteps, totalPairs);
+	for (int m = 0; m < NUM_MODES; m++)
+	{
+		Mode& mode = modes[m];
+		bool ok = mode.m_missing == 0;
+		if (m >= 2)
+			ok = ok && mode.m_rebuilds > 0;
+		if (!ok)
+			failures++;
+		printf("%-22s %8lu us  x%4.2f  %6d pairs missing  %3d background rebuilds  %s\n", gModeNames[m], mode.m_us,
+			mode.m_us ? double(modes[0].m_us) / double(mode.m_us) : 0.0, mode.m_missing, mode.m_rebuilds, ok ? "ok" : "FAILED");
+	}
+	if (parallelMismatches)
+		failures++;
+	printf("parallel pair arrays, 1 and 4 threads  %s  (%d of %d steps differ)\n", parallelMismatches ? "DIFFERENT" : "identical", parallelMismatches, numSteps);
+
+	for (int m = 0; m < NUM_MODES; m++)
+	{
+		Mode& mode = modes[m];
+		for (int i = 0; i < numBoxes; i++)
+		{
+			mode.m_broadphase->destroyProxy(mode.m_proxies[i], &dispatcher);
+		}
+		mode.m_broadphase->setTaskScheduler(0);
+		delete mode.m_broadphase;
+		if (mode.m_scheduler)
+			btDeleteTaskScheduler(mode.m_scheduler);
+	}
+	return failures ? 1 : 0;
+}
@@ -0,0 +1,301 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2012 Erwin Coumans  http://bulletphysics.org
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+///GImpact benchmark
+///Builds the box sets of two dense deformable meshes, deforms and refits them, finds the overlapping triangle pairs
+///and the contacts between the meshes, serially and with a task scheduler set on the shapes.
+///The trees, the pairs and the contacts must be identical.
+///Usage: gimpact_bench [grid resolution] [number of tasks]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "btBulletCollisionCommon.h"
+#include "BulletCollision/Gimpact/btGImpactShape.h"
+#include "BulletCollision/Gimpact/btGImpactCollisionAlgorithm.h"
+#include "LinearMath/btQuickprof.h"
+
+#define GRID_RESOLUTION 160
+#define NUM_TASKS 4
+#define NUM_FRAMES 10
+
+///a wavy grid whose vertices are moved every frame
+struct Surface
+{
+	btAlignedObjectArray<btVector3>	m_vertices;
+	btAlignedObjectArray<int>		m_indices;
+	btTriangleIndexVertexArray*		m_mesh;
+	btGImpactMeshShape*				m_shape;
+	btScalar						m_phase;
+
+	Surface(int resolution, btScalar phase)
+		:m_phase(phase)
+	{
+		const int n = resolution + 1;
+		m_vertices.resize(n * n);
+		for (int z = 0; z < resolution; z++)
+		{
+			for (int x = 0; x < resolution; x++)
+			{
+				const int i = z * n + x;
+				m_indices.push_back(i);
+				m_indices.push_back(i + n);
+				m_indices.push_back(i + 1);
+				m_indices.push_back(i + 1);
+				m_indices.push_back(i + n);
+				m_indices.push_back(i + n + 1);
+			}
+		}
+		deform(resolution, 0);
+		m_mesh = new btTriangleIndexVertexArray(m_indices.size() / 3, &m_indices[0], 3 * sizeof(int),
+			m_vertices.size(), (btScalar*)&m_vertices[0].x(), sizeof(btVector3));
+		m_shape = new btGImpactMeshShape(m_mesh);
+		m_shape->setMargin(btScalar(0.01));
+	}
+
+	~Surface()
+	{
+		delete m_shape;
+		delete m_mesh;
+	}
+
+	void deform(int resolution, int frame)
+	{
+		const int n = resolution + 1;
+		const btScalar t = btScalar(frame) * btScalar(0.1) + m_phase;
+		for (int z = 0; z < n; z++)
+		{
+			for (int x = 0; x < n; x++)
+			{
+				const btScalar px = btScalar(x) / btScalar(resolution) * 20 - 10;
+				const btScalar pz = btScalar(z) / btScalar(resolution) * 20 - 10;
+				m_vertices[z * n + x].setValue(px, btScalar(0.5) * btSin(px * btScalar(1.3) + t) * btCos(pz * btScalar(0.9) - t), pz);
+			}
+		}
+	}
+};
+
+struct ContactRecord
+{
+	btVector3	m_pointA;
+	btVector3	m_pointB;
+	btVector3	m_normal;
+	btScalar	m_distance;
+	int			m_index0;
+	int			m_index1;
+};
+
+struct ContactCollector : public btCollisionWorld::ContactResultCallback
+{
+	btAlignedObjectArray<ContactRecord>&	m_contacts;
+
+	ContactCollector(btAlignedObjectArray<ContactRecord>& contacts)
+		:m_contacts(contacts)
+	{
+	}
+
+	virtual	btScalar	addSingleResult(btManifoldPoint& cp, const btCollisionObject* colObj0, int partId0, int index0, const btCollisionObject* colObj1, int partId1, int index1)
+	{
+		ContactRecord& c = m_contacts.expand();
+		c.m_pointA = cp.m_positionWorldOnA;
+		c.m_pointB = cp.m_positionWorldOnB;
+		c.m_normal = cp.m_normalWorldOnB;
+		c.m_distance = cp.getDistance();
+		c.m_index0 = index0;
+		c.m_index1 = index1;
+		return 0;
+	}
+};
+
+struct RunResult
+{
+	unsigned long int	m_buildUs;
+	unsigned long int	m_refitUs;
+	unsigned long int	m_pairsUs;
+	unsigned long int	m_contactsUs;
+	int					m_numTriangles;
+	int					m_numPairs;
+	///the nodes of both trees after the last refit
+	btAlignedObjectArray<BT_QUANTIZED_BVH_NODE>	m_nodes;
+	btAlignedObjectArray<GIM_PAIR>				m_pairs;
+	btAlignedObjectArray<ContactRecord>			m_contacts;
+};
+
+static void appendNodes(const btGImpactQuantizedBvh* boxSet, btAlignedObjectArray<BT_QUANTIZED_BVH_NODE>& nodes)
+{
+	for (int i = 0; i < boxSet->getNodeCount(); i++)
+		nodes.push_back(*boxSet->get_node_pointer(i));
+}
+
+static void run(int resolution, btITaskScheduler* scheduler, RunResult& result)
+{
+	btDefaultCollisionConfiguration collisionConfiguration;
+	btCollisionDispatcher dispatcher(&collisionConfiguration);
+	btGImpactCollisionAlgorithm::registerAlgorithm(&dispatcher);
+	btDbvtBroadphase broadphase;
+	btCollisionWorld world(&dispatcher, &broadphase, &collisionConfiguration);
+
+	Surface surface0(resolution, 0);
+	Surface surface1(resolution, btScalar(1.7));
+	surface0.m_shape->setTaskScheduler(scheduler);
+	surface1.m_shape->setTaskScheduler(scheduler);
+
+	btClock clock;
+	surface0.m_shape->updateBound();
+	surface1.m_shape->updateBound();
+	result.m_buildUs = clock.getTimeMicroseconds();
+
+	btCollisionObject object0, object1;
+	object0.setCollisionShape(surface0.m_shape);
+	object1.setCollisionShape(surface1.m_shape);
+	btTransform tr;
+	tr.setIdentity();
+	tr.setOrigin(btVector3(0, btScalar(0.1), 0));
+	object1.setWorldTransform(tr);
+	world.addCollisionObject(&object0);
+	world.addCollisionObject(&object1);
+
+	btGImpactQuantizedBvh* boxSet0 = surface0.m_shape->getMeshPart(0)->getBoxSet();
+	btGImpactQuantizedBvh* boxSet1 = surface1.m_shape->getMeshPart(0)->getBoxSet();
+	result.m_numTriangles = boxSet0->getPrimitiveManager()->get_primitive_count() + boxSet1->getPrimitiveManager()->get_primitive_count();
+	result.m_refitUs = 0;
+	result.m_pairsUs = 0;
+	result.m_contactsUs = 0;
+	result.m_numPairs = 0;
+	btPairSet pairs;
+	for (int frame = 1; frame <= NUM_FRAMES; frame++)
+	{
+		surface0.deform(resolution, frame);
+		surface1.deform(resolution, frame);
+		clock.reset();
+		surface0.m_shape->postUpdate();
+		surface1.m_shape->postUpdate();
+		surface0.m_shape->updateBound();
+		surface1.m_shape->updateBound();
+		result.m_refitUs += clock.getTimeMicroseconds();
+
+		pairs.resize(0);
+		clock.reset();
+		btGImpactQuantizedBvh::find_collision(boxSet0, object0.getWorldTransform(), boxSet1, object1.getWorldTransform(), pairs);
+		result.m_pairsUs += clock.getTimeMicroseconds();
+		result.m_numPairs += pairs.size();
+		for (int i = 0; i < pairs.size(); i++)
+			result.m_pairs.push_back(pairs[i]);
+
+		ContactCollector collector(result.m_contacts);
+		clock.reset();
+		world.contactPairTest(&object0, &object1, collector);
+		result.m_contactsUs += clock.getTimeMicroseconds();
+	}
+	result.m_nodes.resize(0);
+	appendNodes(boxSet0, result.m_nodes);
+	appendNodes(boxSet1, result.m_nodes);
+
+	world.removeCollisionObject(&object0);
+	world.removeCollisionObject(&object1);
+}
+
+static bool identicalNodes(const btAlignedObjectArray<BT_QUANTIZED_BVH_NODE>& a, const btAlignedObjectArray<BT_QUANTIZED_BVH_NODE>& b)
+{
+	if (a.size() != b.size())
+		return false;
+	for (int i = 0; i < a.size(); i++)
+	{
+		if (memcmp(a[i].m_quantizedAabbMin, b[i].m_quantizedAabbMin, sizeof(a[i].m_quantizedAabbMin)) ||
+			memcmp(a[i].m_quantizedAabbMax, b[i].m_quantizedAabbMax, sizeof(a[i].m_quantizedAabbMax)) ||
+			a[i].m_escapeIndexOrDataIndex != b[i].m_escapeIndexOrDataIndex)
+			return false;
+	}
+	return true;
+}
+
+static bool identicalPairs(const btAlignedObjectArray<GIM_PAIR>& a, const btAlignedObjectArray<GIM_PAIR>& b)
+{
+	if (a.size() != b.size())
+		return false;
+	for (int i = 0; i < a.size(); i++)
+	{
+		if (a[i].m_index1 != b[i].m_index1 || a[i].m_index2 != b[i].m_index2)
+			return false;
+	}
+	return true;
+}
+
+static bool identicalVectors(const btVector3& a, const btVector3& b)
+{
+	return a.x() == b.x() && a.y() == b.y() && a.z() == b.z();
+}
+
+static bool identicalContacts(const btAlignedObjectArray<ContactRecord>& a, const btAlignedObjectArray<ContactRecord>& b)
+{
+	if (a.size() != b.size())
+		return false;
+	for (int i = 0; i < a.size(); i++)
+	{
+		if (!identicalVectors(a[i].m_pointA, b[i].m_pointA) || !identicalVectors(a[i].m_pointB, b[i].m_pointB) ||
+			!identicalVectors(a[i].m_normal, b[i].m_normal) || a[i].m_distance != b[i].m_distance ||
+			a[i].m_index0 != b[i].m_index0 || a[i].m_index1 != b[i].m_index1)
+			return false;
+	}
+	return true;
+}
+
+static void printRun(const char* name, const RunResult& r)
+{
+	printf("%-16s build %8lu us, refit %8lu us, pairs %8lu us, contacts %8lu us\n",
+		name, r.m_buildUs, r.m_refitUs, r.m_pairsUs, r.m_contactsUs);
+}
+
+int main(int argc, char* argv[])
+{
+	int resolution = argc > 1 ? atoi(argv[1]) : GRID_RESOLUTION;
+	int numTasks = argc > 2 ? atoi(argv[2]) : NUM_TASKS;
+	if (resolution < 2)
+		resolution = 2;
+	if (numTasks < 1)
+		numTasks = 1;
+	int failures = 0;
+
+	RunResult serial, parallel;
+	run(resolution, 0, serial);
+	printf("%d triangles, %d frames, %d triangle pairs, %d contacts\n", serial.m_numTriangles, NUM_FRAMES, serial.m_numPairs, serial.m_contacts.size());
+	printRun("serial", serial);
+
+	btITaskScheduler* scheduler = btCreateDefaultTaskScheduler(numTasks);
+	if (scheduler)
+	{
+		scheduler->setNumThreads(numTasks);
+		run(resolution, scheduler, parallel);
+		char name[64];
+		sprintf(name, "%d tasks", numTasks);
+		printRun(name, parallel);
+
+		bool same = identicalNodes(serial.m_nodes, parallel.m_nodes);
+		if (!same)
+			failures++;
+		printf("trees            %s\n", same ? "identical" : "DIFFERENT");
+		same = identicalPairs(serial.m_pairs, parallel.m_pairs);
+		if (!same)
+			failures++;
+		printf("pairs            %s\n", same ? "identical" : "DIFFERENT");
+		same = identicalContacts(serial.m_contacts, parallel.m_contacts);
+		if (!same)
+			failures++;
+		printf("contacts         %s\n", same ? "identical" : "DIFFERENT");
+		btDeleteTaskScheduler(scheduler);
+	}
+	return failures ? 1 : 0;
+}
@@ -0,0 +1,274 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2012 Erwin Coumans  http://bulletphysics.org
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+///btHeightfieldTerrainShape min/max pyramid benchmark
+///Casts short downward rays and long grazing rays on a large terrain with btCollisionWorld::rayTest, and queries the
+///triangles of boxes above, across and below the surface with processAllTriangles, without and with the min/max height
+///pyramid. The closest hits must be identical, and the box queries must report the same triangles overlapping the box,
+///in the same order. Then raises a hill, updates the pyramid for that region and checks the rays again.
+///Usage: heightfield_bench [grid size] [number of rays] [number of boxes]
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "btBulletCollisionCommon.h"
+#include "BulletCollision/CollisionShapes/btHeightfieldTerrainShape.h"
+#include "LinearMath/btAabbUtil2.h"
+#include "LinearMath/btQuickprof.h"
+
+#define GRID_SIZE 2049
+#define NUM_RAYS 20000
+#define NUM_BOXES 2000
+#define MAX_HEIGHT 30
+#define LONG_RAY_LENGTH 150
+
+static unsigned int gSeed = 12345;
+
+static btScalar randRange(btScalar lo, btScalar hi)
+{
+	gSeed = gSeed * 1664525u + 1013904223u;
+	return lo + (hi - lo) * btScalar(gSeed >> 8) / btScalar(1 << 24);
+}
+
+struct Ray
+{
+	btVector3	m_from;
+	btVector3	m_to;
+};
+
+struct RayResult
+{
+	bool		m_hasHit;
+	btScalar	m_fraction;
+	btVector3	m_normal;
+};
+
+///hashes the triangles overlapping the query box in the order they are reported, and counts all reported triangles
+struct BoxQueryCallback : public btTriangleCallback
+{
+	btVector3		m_aabbMin;
+	btVector3		m_aabbMax;
+	unsigned int	m_hash;
+	int				m_numReported;
+	int				m_numOverlapping;
+
+	virtual void processTriangle(btVector3* triangle, int partId, int triangleIndex)
+	{
+		m_numReported++;
+		if (!TestTriangleAgainstAabb2(triangle, m_aabbMin, m_aabbMax))
+			return;
+		m_numOverlapping++;
+		m_hash = m_hash * 31u + unsigned(partId);
+		m_hash = m_hash * 31u + unsigned(triangleIndex);
+		for (int i = 0; i < 3; i++)
+		{
+			for (int j = 0; j < 3; j++)
+			{
+				union { float f; unsigned int u; } bits;
+				bits.f = float(triangle[i][j]);
+				m_hash = m_hash * 31u + bits.u;
+			}
+		}
+	}
+};
+
+struct BoxResult
+{
+	unsigned int	m_hash;
+	int				m_numOverlapping;
+};
+
+static unsigned long int castRays(btCollisionWorld& world, const btAlignedObjectArray<Ray>& rays, int begin, int end, btAlignedObjectArray<RayResult>& results)
+{
+	results.resize(rays.size());
+	btClock clock;
+	for (int i = begin; i < end; i++)
+	{
+		btCollisionWorld::ClosestRayResultCallback callback(rays[i].m_from, rays[i].m_to);
+		world.rayTest(rays[i].m_from, rays[i].m_to, callback);
+		results[i].m_hasHit = callback.hasHit();
+		results[i].m_fraction = callback.m_closestHitFraction;
+		results[i].m_normal = callback.hasHit() ? callback.m_hitNormalWorld : btVector3(0, 0, 0);
+	}
+	return clock.getTimeMicroseconds();
+}
+
+static int countRayDifferences(const btAlignedObjectArray<RayResult>& a, const btAlignedObjectArray<RayResult>& b, int begin, int end, int& numHits)
+{
+	int differences = 0;
+	numHits = 0;
+	for (int i = begin; i < end; i++)
+	{
+		if (a[i].m_hasHit)
+			numHits++;
+		if (a[i].m_hasHit != b[i].m_hasHit || a[i].m_fraction != b[i].m_fraction || a[i].m_normal.x() != b[i].m_normal.x() ||
+			a[i].m_normal.y() != b[i].m_normal.y() || a[i].m_normal.z() != b[i].m_normal.z())
+			differences++;
+	}
+	return differences;
+}
+
+static unsigned long int queryBoxes(const btHeightfieldTerrainShape& shape, const btAlignedObjectArray<btVector3>& boxes, btAlignedObjectArray<BoxResult>& results, int& numReported)
+{
+	results.resize(boxes.size() / 2);
+	numReported = 0;
+	btClock clock;
+	for (int i = 0; i < results.size(); i++)
+	{
+		BoxQueryCallback callback;
+		callback.m_aabbMin = boxes[2 * i];
+		callback.m_aabbMax = boxes[2 * i + 1];
+		callback.m_hash = 0;
+		callback.m_numReported = 0;
+		callback.m_numOverlapping = 0;
+		shape.processAllTriangles(&callback, callback.m_aabbMin, callback.m_aabbMax);
+		results[i].m_hash = callback.m_hash;
+		results[i].m_numOverlapping = callback.m_numOverlapping;
+		numReported += callback.m_numReported;
+	}
+	return clock.getTimeMicroseconds();
+}
+
+int main(int argc, char* argv[])
+{
+	int gridSize = argc > 1 ? atoi(argv[1]) : GRID_SIZE;
+	int numRays = argc > 2 ? atoi(argv[2]) : NUM_RAYS;
+	int numBoxes = argc > 3 ? atoi(argv[3]) : NUM_BOXES;
+	if (gridSize < 2)
+		gridSize = 2;
+	if (numRays < 2)
+		numRays = 2;
+	int failures = 0;
+
+	//rolling hills with some noise, within [-MAX_HEIGHT,MAX_HEIGHT]
+	btAlignedObjectArray<btScalar> heights;
+	heights.resize(gridSize * gridSize);
+	for (int y = 0; y < gridSize; y++)
+	{
+		for (int x = 0; x < gridSize; x++)
+		{
+			heights[y * gridSize + x] = btScalar(20) * btSin(btScalar(x) * btScalar(0.01)) * btCos(btScalar(y) * btScalar(0.013)) +
+				btScalar(5) * btSin(btScalar(x) * btScalar(0.07) + btScalar(y) * btScalar(0.05)) + randRange(btScalar(-0.5), btScalar(0.5));
+		}
+	}
+	btHeightfieldTerrainShape shape(gridSize, gridSize, &heights[0], 1, -MAX_HEIGHT, MAX_HEIGHT, 1, PHY_FLOAT, false);
+	shape.setUseDiamondSubdivision(true);
+	const btVector3 scaling(btScalar(0.5), 1, btScalar(0.5));
+	shape.setLocalScaling(scaling);
+	const btScalar halfExtent = btScalar(gridSize - 1) * scaling.x() * btScalar(0.5);
+
+	btDefaultCollisionConfiguration collisionConfiguration;
+	btCollisionDispatcher dispatcher(&collisionConfiguration);
+	btDbvtBroadphase broadphase;
+	btCollisionWorld world(&dispatcher, &broadphase, &collisionConfiguration);
+	btCollisionObject terrain;
+	terrain.setCollisionShape(&shape);
+	world.addCollisionObject(&terrain);
+	world.updateAabbs();
+
+	//short downward rays, then long rays grazing the surface
+	btAlignedObjectArray<Ray> rays;
+	const int numShortRays = numRays - numRays / 10;
+	for (int i = 0; i < numRays; i++)
+	{
+		Ray ray;
+		if (i < numShortRays)
+		{
+			ray.m_from.setValue(randRange(-halfExtent, halfExtent), MAX_HEIGHT + 5, randRange(-halfExtent, halfExtent));
+			ray.m_to = ray.m_from + btVector3(randRange(-5, 5), -2 * MAX_HEIGHT - 10, randRange(-5, 5));
+		}
+		else
+		{
+			ray.m_from.setValue(randRange(-halfExtent, halfExtent), randRange(MAX_HEIGHT - 10, MAX_HEIGHT + 5), randRange(-halfExtent, halfExtent));
+			const btScalar angle = randRange(0, SIMD_2_PI);
+			const btScalar length = randRange(LONG_RAY_LENGTH / 2, LONG_RAY_LENGTH);
+			ray.m_to = ray.m_from + btVector3(btCos(angle) * length, randRange(-2 * MAX_HEIGHT, 0), btSin(angle) * length);
+		}
+		rays.push_back(ray);
+	}
+
+	//boxes of a few meters to tens of meters, above, across and below the surface
+	btAlignedObjectArray<btVector3> boxes;
+	for (int i = 0; i < numBoxes; i++)
+	{
+		const btVector3 center(randRange(-halfExtent, halfExtent), randRange(-MAX_HEIGHT - 5, MAX_HEIGHT + 5), randRange(-halfExtent, halfExtent));
+		const btVector3 halfSize(randRange(1, 32), randRange(1, 5), randRange(1, 32));
+		boxes.push_back(center - halfSize);
+		boxes.push_back(center + halfSize);
+	}
+
+	printf("%d x %d heightfield, %d short rays, %d long rays, %d boxes\n", gridSize, gridSize, numShortRays, numRays - numShortRays, numBoxes);
+
+	btAlignedObjectArray<RayResult> scanned, traversed;
+	btAlignedObjectArray<BoxResult> scannedBoxes, culledBoxes;
+	unsigned long int shortScan = castRays(world, rays, 0, numShortRays, scanned);
+	unsigned long int longScan = castRays(world, rays, numShortRays, numRays, scanned);
+	int scannedTriangles = 0;
+	unsigned long int boxScan = queryBoxes(shape, boxes, scannedBoxes, scannedTriangles);
+
+	btClock clock;
+	shape.buildMinMaxPyramid();
+	unsigned long int buildUs = clock.getTimeMicroseconds();
+	printf("pyramid built in %lu us, %.2f MB (heights %.2f MB)\n", buildUs,
+		double(shape.getMinMaxPyramidMemory()) / (1024. * 1024.), double(heights.size() * sizeof(btScalar)) / (1024. * 1024.));
+
+	unsigned long int shortTraverse = castRays(world, rays, 0, numShortRays, traversed);
+	unsigned long int longTraverse = castRays(world, rays, numShortRays, numRays, traversed);
+	int culledTriangles = 0;
+	unsigned long int boxCull = queryBoxes(shape, boxes, culledBoxes, culledTriangles);
+
+	int numHits = 0;
+	int differences = countRayDifferences(scanned, traversed, 0, numShortRays, numHits);
+	printf("short rays  %8lu us scan, %8lu us pyramid, %5d hits, %s\n", shortScan, shortTraverse, numHits, differences ? "DIFFERENT" : "identical");
+	failures += differences ? 1 : 0;
+	differences = countRayDifferences(scanned, traversed, numShortRays, numRays, numHits);
+	printf("long rays   %8lu us scan, %8lu us pyramid, %5d hits, %s\n", longScan, longTraverse, numHits, differences ? "DIFFERENT" : "identical");
+	failures += differences ? 1 : 0;
+
+	differences = 0;
+	int numOverlapping = 0;
+	for (int i = 0; i < scannedBoxes.size(); i++)
+	{
+		numOverlapping += scannedBoxes[i].m_numOverlapping;
+		if (scannedBoxes[i].m_hash != culledBoxes[i].m_hash || scannedBoxes[i].m_numOverlapping != culledBoxes[i].m_numOverlapping)
+			differences++;
+	}
+	printf("boxes       %8lu us scan, %8lu us pyramid, %d overlapping of %d triangles scanned, %d culled, %s\n", boxScan, boxCull,
+		numOverlapping, scannedTriangles, culledTriangles, differences ? "DIFFERENT" : "identical");
+	failures += differences ? 1 : 0;
+
+	//a hill in the middle of the terrain, taller than the rays start
+	const int hillStart = gridSize / 2 - gridSize / 8;
+	const int hillEnd = gridSize / 2 + gridSize / 8;
+	for (int y = hillStart; y <= hillEnd; y++)
+	{
+		for (int x = hillStart; x <= hillEnd; x++)
+		{
+			const btScalar s = btSin(SIMD_PI * btScalar(x - hillStart) / btScalar(hillEnd - hillStart + 1));
+			const btScalar t = btSin(SIMD_PI * btScalar(y - hillStart) / btScalar(hillEnd - hillStart + 1));
+			heights[y * gridSize + x] = btMin(heights[y * gridSize + x] + btScalar(3 * MAX_HEIGHT) * s * t, btScalar(MAX_HEIGHT));
+		}
+	}
+	shape.updateMinMaxPyramid(hillStart, hillStart, hillEnd, hillEnd);
+	castRays(world, rays, 0, numRays, traversed);
+	shape.clearMinMaxPyramid();
+	castRays(world, rays, 0, numRays, scanned);
+	differences = countRayDifferences(scanned, traversed, 0, numRays, numHits);
+	printf("after updateMinMaxPyramid, %d hits, %s\n", numHits, differences ? "DIFFERENT" : "identical");
+	failures += differences ? 1 : 0;
+
+	world.removeCollisionObject(&terrain);
+	return failures ? 1 : 0;
+}
@@ -0,0 +1,222 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2012 Erwin Coumans  http://bulletphysics.org
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+///Parallel island solver and narrowphase benchmark
+///Steps a grid of separate box piles (one simulation island each, some topped with compound bodies) with
+///btDiscreteDynamicsWorld::setNumTasks set to 1, 2, 4 and 8, first with btCollisionDispatcher and then with a
+///btCollisionDispatcherMt sharing the task scheduler of the world.
+///Checks every run ends with exactly the same transforms as the serial solver and dispatcher, and that a solver subclass
+///which does not return thread solvers from createThreadSolver gets every island itself.
+///Usage: island_solver_bench [number of steps] [max number of tasks]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "btBulletDynamicsCommon.h"
+#include "LinearMath/btQuickprof.h"
+#include "LinearMath/btAlignedObjectArray.h"
+
+#define NUM_PILES_X 8
+#define NUM_PILES_Z 8
+#define PILE_WIDTH 4
+#define PILE_HEIGHT 5
+#define NUM_STEPS 300
+
+///a user solver that overrides solveGroup without opting in to parallel island solving
+class CountingSolver : public btSequentialImpulseConstraintSolver
+{
+public:
+	int m_numGroups;
+
+	CountingSolver()
+		:m_numGroups(0)
+	{
+	}
+
+	virtual btScalar solveGroup(btCollisionObject** bodies, int numBodies, btPersistentManifold** manifold, int numManifolds, btTypedConstraint** constraints, int numConstraints, const btContactSolverInfo& info, btIDebugDraw* debugDrawer, btStackAlloc* stackAlloc, btDispatcher* dispatcher)
+	{
+		m_numGroups++;
+		return btSequentialImpulseConstraintSolver::solveGroup(bodies, numBodies, manifold, numManifolds, constraints, numConstraints, info, debugDrawer, stackAlloc, dispatcher);
+	}
+
+	virtual btConstraintSolver* createThreadSolver()
+	{
+		return 0;
+	}
+};
+
+///steps the piles and returns the elapsed time in microseconds, numTasks 0 leaves setNumTasks alone
+static unsigned long int benchIslands(int numTasks, bool parallelDispatcher, int numSteps, int minimumSolverBatchSize, btAlignedObjectArray<btTransform>& transforms, btSequentialImpulseConstraintSolver* userSolver = 0)
+{
+	btDefaultCollisionConfiguration collisionConfiguration;
+	btCollisionDispatcherMt dispatcher(&collisionConfiguration);
+	btDbvtBroadphase broadphase;
+	btSequentialImpulseConstraintSolver defaultSolver;
+	btSequentialImpulseConstraintSolver& solver = userSolver ? *userSolver : defaultSolver;
+	btDiscreteDynamicsWorld world(&dispatcher, &broadphase, &solver, &collisionConfiguration);
+	world.getSolverInfo().m_minimumSolverBatchSize = minimumSolverBatchSize;
+	if (numTasks)
+	{
+		world.setNumTasks(numTasks);
+		if (parallelDispatcher)
+		{
+			dispatcher.setTaskScheduler(world.getTaskScheduler());
+		}
+	}
+
+	btBoxShape ground(btVector3(100, 1, 100));
+	btBoxShape box(btVector3(btScalar(0.5), btScalar(0.5), btScalar(0.5)));
+	btCompoundShape compound;
+	btTransform childTransform;
+	childTransform.setIdentity();
+	childTransform.setOrigin(btVector3(btScalar(-0.6), 0, 0));
+	compound.addChildShape(childTransform, &box);
+	childTransform.setOrigin(btVector3(btScalar(0.6), 0, 0));
+	compound.addChildShape(childTransform, &box);
+	btAlignedObjectArray<btRigidBody*> bodies;
+
+	btTransform tr;
+	tr.setIdentity();
+	tr.setOrigin(btVector3(0, -1, 0));
+	bodies.push_back(new btRigidBody(0, 0, &ground));
+	bodies[0]->setWorldTransform(tr);
+	world.addRigidBody(bodies[0]);
+
+	btVector3 inertia;
+	box.calculateLocalInertia(1, inertia);
+	for (int px = 0; px < NUM_PILES_X; px++)
+	{
+		for (int pz = 0; pz < NUM_PILES_Z; pz++)
+		{
+			//piles get different heights, so the islands have different sizes
+			int height = 1 + (px * NUM_PILES_Z + pz) % PILE_HEIGHT;
+			for (int y = 0; y < height; y++)
+			{
+				for (int x = 0; x < PILE_WIDTH; x++)
+				{
+					for (int z = 0; z < PILE_WIDTH; z++)
+					{
+						tr.setOrigin(btVector3(
+							btScalar(px * 10 - NUM_PILES_X * 5) + btScalar(x) * btScalar(1.1),
+							btScalar(y) + btScalar(0.5),
+							btScalar(pz * 10 - NUM_PILES_Z * 5) + btScalar(z) * btScalar(1.1)));
+						btRigidBody* body = new btRigidBody(1, 0, &box, inertia);
+						body->setWorldTransform(tr);
+						world.addRigidBody(body);
+						bodies.push_back(body);
+					}
+				}
+			}
+			//every third pile gets a compound body on top, its pairs are dispatched on the calling thread
+			if ((px + pz) % 3 == 0)
+			{
+				btVector3 compoundInertia;
+				compound.calculateLocalInertia(2, compoundInertia);
+				tr.setOrigin(btVector3(
+					btScalar(px * 10 - NUM_PILES_X * 5) + btScalar(1.6),
+					btScalar(height) + btScalar(0.6),
+					btScalar(pz * 10 - NUM_PILES_Z * 5) + btScalar(1.6)));
+				btRigidBody* body = new btRigidBody(2, 0, &compound, compoundInertia);
+				body->setWorldTransform(tr);
+				world.addRigidBody(body);
+				bodies.push_back(body);
+			}
+		}
+	}
+
+	btClock clock;
+	for (int i = 0; i < numSteps; i++)
+	{
+		world.stepSimulation(btScalar(1.) / btScalar(60.), 0);
+	}
+	unsigned long int us = clock.getTimeMicroseconds();
+
+	transforms.resize(bodies.size());
+	for (int i = 0; i < bodies.size(); i++)
+	{
+		transforms[i] = bodies[i]->getWorldTransform();
+		world.removeRigidBody(bodies[i]);
+		delete bodies[i];
+	}
+	return us;
+}
+
+static bool identicalTransforms(const btAlignedObjectArray<btTransform>& a, const btAlignedObjectArray<btTransform>& b)
+{
+	if (a.size() != b.size())
+		return false;
+	for (int i = 0; i < a.size(); i++)
+	{
+		btTransformFloatData fa, fb;
+		a[i].serializeFloat(fa);
+		b[i].serializeFloat(fb);
+		if (memcmp(&fa, &fb, sizeof(fa)))
+			return false;
+	}
+	return true;
+}
+
+int main(int argc, char* argv[])
+{
+	int numSteps = argc > 1 ? atoi(argv[1]) : NUM_STEPS;
+	int maxNumTasks = argc > 2 ? atoi(argv[2]) : 8;
+	if (numSteps < 1)
+		numSteps = 1;
+
+	int failures = 0;
+	const int batchSizes[2] = {1, 128};
+	for (int b = 0; b < 2; b++)
+	{
+		btAlignedObjectArray<btTransform> serial;
+		unsigned long int usSerial = benchIslands(0, false, numSteps, batchSizes[b], serial);
+		printf("minimumSolverBatchSize %3d serial                    %8lu us\n", batchSizes[b], usSerial);
+
+		for (int dispatch = 0; dispatch < 2; dispatch++)
+		{
+			for (int numTasks = 1; numTasks <= maxNumTasks; numTasks *= 2)
+			{
+				btAlignedObjectArray<btTransform> parallel;
+				unsigned long int us = benchIslands(numTasks, dispatch != 0, numSteps, batchSizes[b], parallel);
+				bool identical = identicalTransforms(serial, parallel);
+				if (!identical)
+					failures++;
+				printf("minimumSolverBatchSize %3d %2d tasks %-10s %8lu us  x%4.2f  %s\n", batchSizes[b], numTasks,
+					dispatch ? "+narrow" : "islands", us, us ? double(usSerial) / double(us) : 0.0, identical ? "identical" : "MISMATCH");
+			}
+		}
+	}
+
+	//the islands of a solver that returns no thread solvers stay on that solver
+	{
+		btAlignedObjectArray<btTransform> serial;
+		btAlignedObjectArray<btTransform> parallel;
+		CountingSolver serialSolver;
+		CountingSolver parallelSolver;
+		benchIslands(0, false, numSteps, 1, serial, &serialSolver);
+		benchIslands(4, false, numSteps, 1, parallel, &parallelSolver);
+		bool identical = identicalTransforms(serial, parallel) && serialSolver.m_numGroups == parallelSolver.m_numGroups;
+		if (!identical)
+			failures++;
+		printf("solver without thread solvers, 4 tasks                  %s  (%d of %d groups)\n", identical ? "identical" : "MISMATCH",
+			parallelSolver.m_numGroups, serialSolver.m_numGroups);
+	}
+
+	if (failures)
+	{
+		printf("%d runs differ from the serial solver and dispatcher\n", failures);
+	}
+	return failures ? 1 : 0;
+}
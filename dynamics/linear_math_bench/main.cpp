@@ -0,0 +1,377 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2012 Erwin Coumans  http://bulletphysics.org
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+///LinearMath micro benchmark
+///Times btVector3, btQuaternion, btMatrix3x3 and btTransform operations against a scalar reference
+///written out with the same formulas as the scalar code path, and checks the results are bit for bit identical.
+///Then steps a box stack with SOLVER_SIMD, with generic rows and with SOLVER_BATCHED_SOA.
+///Usage: linear_math_bench [number of repeats]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "btBulletDynamicsCommon.h"
+#include "LinearMath/btQuickprof.h"
+#include "LinearMath/btAlignedObjectArray.h"
+
+#define NUM_ELEMENTS 4096
+#define NUM_REPEATS 200
+
+static unsigned int gSeed = 12345;
+
+static btScalar randomScalar()
+{
+	gSeed = gSeed * 1664525u + 1013904223u;
+	return btScalar(gSeed >> 8) / btScalar(1 << 24) * btScalar(2.) - btScalar(1.);
+}
+
+static btVector3 randomVector()
+{
+	return btVector3(randomScalar(), randomScalar(), randomScalar());
+}
+
+static btQuaternion randomQuaternion()
+{
+	btQuaternion q(randomScalar(), randomScalar(), randomScalar(), randomScalar() + btScalar(2.));
+	return q.normalize();
+}
+
+static const char* getBackendName()
+{
+#if defined (BT_USE_SSE) && defined (__AVX__)
+	return "SSE (AVX encoding)";
+#elif defined (BT_USE_SSE)
+	return "SSE";
+#else
+	return "scalar";
+#endif
+}
+
+///scalar reference, same expressions as the scalar code path of LinearMath
+static btVector3 refCross(const btVector3& a, const btVector3& b)
+{
+	return btVector3(a.y() * b.z() - a.z() * b.y(), a.z() * b.x() - a.x() * b.z(), a.x() * b.y() - a.y() * b.x());
+}
+
+static btScalar refDot(const btVector3& a, const btVector3& b)
+{
+	return a.x() * b.x() + a.y() * b.y() + a.z() * b.z();
+}
+
+static btVector3 refNormalized(const btVector3& a)
+{
+	btScalar s = btScalar(1.0) / btSqrt(refDot(a, a));
+	return btVector3(a.x() * s, a.y() * s, a.z() * s);
+}
+
+static btVector3 refMulMatVec(const btMatrix3x3& m, const btVector3& v)
+{
+	return btVector3(refDot(m[0], v), refDot(m[1], v), refDot(m[2], v));
+}
+
+static btMatrix3x3 refMulMatMat(const btMatrix3x3& a, const btMatrix3x3& b)
+{
+	btScalar e[3][3];
+	for (int i = 0; i < 3; i++)
+	{
+		for (int j = 0; j < 3; j++)
+		{
+			e[i][j] = b[0][j] * a[i].x() + b[1][j] * a[i].y() + b[2][j] * a[i].z();
+		}
+	}
+	return btMatrix3x3(e[0][0], e[0][1], e[0][2], e[1][0], e[1][1], e[1][2], e[2][0], e[2][1], e[2][2]);
+}
+
+static btVector3 refTransform(const btTransform& t, const btVector3& x)
+{
+	const btMatrix3x3& b = t.getBasis();
+	return btVector3(refDot(b[0], x) + t.getOrigin().x(), refDot(b[1], x) + t.getOrigin().y(), refDot(b[2], x) + t.getOrigin().z());
+}
+
+static btVector3 refInvXform(const btTransform& t, const btVector3& x)
+{
+	const btMatrix3x3& b = t.getBasis();
+	btVector3 v(x.x() - t.getOrigin().x(), x.y() - t.getOrigin().y(), x.z() - t.getOrigin().z());
+	return btVector3(b[0].x() * v.x() + b[1].x() * v.y() + b[2].x() * v.z(),
+		b[0].y() * v.x() + b[1].y() * v.y() + b[2].y() * v.z(),
+		b[0].z() * v.x() + b[1].z() * v.y() + b[2].z() * v.z());
+}
+
+static btQuaternion refMulQuat(const btQuaternion& q1, const btQuaternion& q2)
+{
+	return btQuaternion(q1.w() * q2.x() + q1.x() * q2.w() + q1.y() * q2.z() - q1.z() * q2.y(),
+		q1.w() * q2.y() + q1.y() * q2.w() + q1.z() * q2.x() - q1.x() * q2.z(),
+		q1.w() * q2.z() + q1.z() * q2.w() + q1.x() * q2.y() - q1.y() * q2.x(),
+		q1.w() * q2.w() - q1.x() * q2.x() - q1.y() * q2.y() - q1.z() * q2.z());
+}
+
+static btVector3 refQuatRotate(const btQuaternion& r, const btVector3& w)
+{
+	btQuaternion q(r.w() * w.x() + r.y() * w.z() - r.z() * w.y(),
+		r.w() * w.y() + r.z() * w.x() - r.x() * w.z(),
+		r.w() * w.z() + r.x() * w.y() - r.y() * w.x(),
+		-r.x() * w.x() - r.y() * w.y() - r.z() * w.z());
+	q = refMulQuat(q, btQuaternion(-r.x(), -r.y(), -r.z(), r.w()));
+	return btVector3(q.x(), q.y(), q.z());
+}
+
+struct BenchData
+{
+	btAlignedObjectArray<btVector3> m_a;
+	btAlignedObjectArray<btVector3> m_b;
+	btAlignedObjectArray<btQuaternion> m_qa;
+	btAlignedObjectArray<btQuaternion> m_qb;
+	btAlignedObjectArray<btMatrix3x3> m_ma;
+	btAlignedObjectArray<btMatrix3x3> m_mb;
+	btAlignedObjectArray<btTransform> m_ta;
+
+	btAlignedObjectArray<btVector3> m_vecOut[2];
+	btAlignedObjectArray<btQuaternion> m_quatOut[2];
+	btAlignedObjectArray<btMatrix3x3> m_matOut[2];
+	btAlignedObjectArray<btScalar> m_scalarOut[2];
+
+	void init(int n)
+	{
+		m_a.resize(n);
+		m_b.resize(n);
+		m_qa.resize(n);
+		m_qb.resize(n);
+		m_ma.resize(n);
+		m_mb.resize(n);
+		m_ta.resize(n);
+		for (int k = 0; k < 2; k++)
+		{
+			m_vecOut[k].resize(n);
+			m_quatOut[k].resize(n);
+			m_matOut[k].resize(n);
+			m_scalarOut[k].resize(n);
+		}
+		for (int i = 0; i < n; i++)
+		{
+			m_a[i] = randomVector();
+			m_b[i] = randomVector();
+			m_qa[i] = randomQuaternion();
+			m_qb[i] = randomQuaternion();
+			m_ma[i].setRotation(randomQuaternion());
+			m_mb[i].setRotation(randomQuaternion());
+			m_ta[i] = btTransform(randomQuaternion(), randomVector());
+		}
+	}
+};
+
+enum BenchOp
+{
+	BENCH_DOT,
+	BENCH_CROSS,
+	BENCH_NORMALIZE,
+	BENCH_MAT_VEC,
+	BENCH_MAT_MAT,
+	BENCH_TRANSFORM,
+	BENCH_INV_XFORM,
+	BENCH_QUAT_MUL,
+	BENCH_QUAT_ROTATE,
+	BENCH_NUM_OPS
+};
+
+static const char* gOpNames[BENCH_NUM_OPS] =
+{
+	"btVector3::dot",
+	"btVector3::cross",
+	"btVector3::normalized",
+	"btMatrix3x3 * btVector3",
+	"btMatrix3x3 * btMatrix3x3",
+	"btTransform * btVector3",
+	"btTransform::invXform",
+	"btQuaternion * btQuaternion",
+	"quatRotate",
+};
+
+///k = 0 runs LinearMath, k = 1 runs the scalar reference
+static void runOp(BenchData& d, int op, int k)
+{
+	const int n = d.m_a.size();
+	btVector3* vo = &d.m_vecOut[k][0];
+	btQuaternion* qo = &d.m_quatOut[k][0];
+	btMatrix3x3* mo = &d.m_matOut[k][0];
+	btScalar* so = &d.m_scalarOut[k][0];
+	int i;
+
+	switch (op)
+	{
+	case BENCH_DOT:
+		if (k == 0) for (i = 0; i < n; i++) so[i] = d.m_a[i].dot(d.m_b[i]);
+		else for (i = 0; i < n; i++) so[i] = refDot(d.m_a[i], d.m_b[i]);
+		break;
+	case BENCH_CROSS:
+		if (k == 0) for (i = 0; i < n; i++) vo[i] = d.m_a[i].cross(d.m_b[i]);
+		else for (i = 0; i < n; i++) vo[i] = refCross(d.m_a[i], d.m_b[i]);
+		break;
+	case BENCH_NORMALIZE:
+		if (k == 0) for (i = 0; i < n; i++) vo[i] = d.m_a[i].normalized();
+		else for (i = 0; i < n; i++) vo[i] = refNormalized(d.m_a[i]);
+		break;
+	case BENCH_MAT_VEC:
+		if (k == 0) for (i = 0; i < n; i++) vo[i] = d.m_ma[i] * d.m_a[i];
+		else for (i = 0; i < n; i++) vo[i] = refMulMatVec(d.m_ma[i], d.m_a[i]);
+		break;
+	case BENCH_MAT_MAT:
+		if (k == 0) for (i = 0; i < n; i++) mo[i] = d.m_ma[i] * d.m_mb[i];
+		else for (i = 0; i < n; i++) mo[i] = refMulMatMat(d.m_ma[i], d.m_mb[i]);
+		break;
+	case BENCH_TRANSFORM:
+		if (k == 0) for (i = 0; i < n; i++) vo[i] = d.m_ta[i] * d.m_a[i];
+		else for (i = 0; i < n; i++) vo[i] = refTransform(d.m_ta[i], d.m_a[i]);
+		break;
+	case BENCH_INV_XFORM:
+		if (k == 0) for (i = 0; i < n; i++) vo[i] = d.m_ta[i].invXform(d.m_a[i]);
+		else for (i = 0; i < n; i++) vo[i] = refInvXform(d.m_ta[i], d.m_a[i]);
+		break;
+	case BENCH_QUAT_MUL:
+		if (k == 0) for (i = 0; i < n; i++) qo[i] = d.m_qa[i] * d.m_qb[i];
+		else for (i = 0; i < n; i++) qo[i] = refMulQuat(d.m_qa[i], d.m_qb[i]);
+		break;
+	case BENCH_QUAT_ROTATE:
+		if (k == 0) for (i = 0; i < n; i++) vo[i] = quatRotate(d.m_qa[i], d.m_a[i]);
+		else for (i = 0; i < n; i++) vo[i] = refQuatRotate(d.m_qa[i], d.m_a[i]);
+		break;
+	}
+}
+
+static bool isIdentical(BenchData& d, int op)
+{
+	const int n = d.m_a.size();
+	switch (op)
+	{
+	case BENCH_DOT:
+		return memcmp(&d.m_scalarOut[0][0], &d.m_scalarOut[1][0], sizeof(btScalar) * n) == 0;
+	case BENCH_MAT_MAT:
+		return memcmp(&d.m_matOut[0][0], &d.m_matOut[1][0], sizeof(btMatrix3x3) * n) == 0;
+	case BENCH_QUAT_MUL:
+		return memcmp(&d.m_quatOut[0][0], &d.m_quatOut[1][0], sizeof(btQuaternion) * n) == 0;
+	default:
+		return memcmp(&d.m_vecOut[0][0], &d.m_vecOut[1][0], sizeof(btVector3) * n) == 0;
+	}
+}
+
+static int benchLinearMath(int numRepeats)
+{
+	BenchData d;
+	d.init(NUM_ELEMENTS);
+
+	btClock clock;
+	int failures = 0;
+
+	printf("LinearMath backend %s, %d elements x %d repeats\n", getBackendName(), NUM_ELEMENTS, numRepeats);
+	for (int op = 0; op < BENCH_NUM_OPS; op++)
+	{
+		unsigned long int us[2];
+		for (int k = 0; k < 2; k++)
+		{
+			clock.reset();
+			for (int r = 0; r < numRepeats; r++)
+			{
+				runOp(d, op, k);
+			}
+			us[k] = clock.getTimeMicroseconds();
+		}
+		bool identical = isIdentical(d, op);
+		if (!identical)
+		{
+			failures++;
+		}
+		printf("%-28s %8lu us  reference %8lu us  x%4.2f  %s\n", gOpNames[op], us[0], us[1],
+			us[0] ? double(us[1]) / double(us[0]) : 0.0, identical ? "identical" : "MISMATCH");
+	}
+	return failures;
+}
+
+///steps a box stack and returns the elapsed time in microseconds
+static unsigned long int benchSolver(int solverMode, int numSteps, btScalar& checksum)
+{
+	btDefaultCollisionConfiguration collisionConfiguration;
+	btCollisionDispatcher dispatcher(&collisionConfiguration);
+	btDbvtBroadphase broadphase;
+	btSequentialImpulseConstraintSolver solver;
+	btDiscreteDynamicsWorld world(&dispatcher, &broadphase, &solver, &collisionConfiguration);
+	world.getSolverInfo().m_solverMode = solverMode;
+
+	btBoxShape ground(btVector3(50, 1, 50));
+	btBoxShape box(btVector3(btScalar(0.5), btScalar(0.5), btScalar(0.5)));
+	btAlignedObjectArray<btRigidBody*> bodies;
+
+	btTransform tr;
+	tr.setIdentity();
+	tr.setOrigin(btVector3(0, -1, 0));
+	bodies.push_back(new btRigidBody(0, 0, &ground));
+	bodies[0]->setWorldTransform(tr);
+	world.addRigidBody(bodies[0]);
+
+	btVector3 inertia;
+	box.calculateLocalInertia(1, inertia);
+	for (int y = 0; y < 10; y++)
+	{
+		for (int x = 0; x < 10; x++)
+		{
+			for (int z = 0; z < 10; z++)
+			{
+				tr.setOrigin(btVector3(btScalar(x) * btScalar(1.1) - 5, btScalar(y) + btScalar(0.5), btScalar(z) * btScalar(1.1) - 5));
+				btRigidBody* body = new btRigidBody(1, 0, &box, inertia);
+				body->setWorldTransform(tr);
+				world.addRigidBody(body);
+				bodies.push_back(body);
+			}
+		}
+	}
+
+	btClock clock;
+	for (int i = 0; i < numSteps; i++)
+	{
+		world.stepSimulation(btScalar(1.) / btScalar(60.), 0);
+	}
+	unsigned long int us = clock.getTimeMicroseconds();
+
+	checksum = 0;
+	for (int i = 0; i < bodies.size(); i++)
+	{
+		checksum += bodies[i]->getWorldTransform().getOrigin().y();
+		world.removeRigidBody(bodies[i]);
+		delete bodies[i];
+	}
+	return us;
+}
+
+int main(int argc, char* argv[])
+{
+	int numRepeats = argc > 1 ? atoi(argv[1]) : NUM_REPEATS;
+	if (numRepeats < 1)
+		numRepeats = 1;
+
+	int failures = benchLinearMath(numRepeats);
+
+	const int numSteps = 300;
+	btScalar checksum[3];
+	unsigned long int usSimd = benchSolver(SOLVER_USE_WARMSTARTING | SOLVER_SIMD, numSteps, checksum[0]);
+	unsigned long int usGeneric = benchSolver(SOLVER_USE_WARMSTARTING, numSteps, checksum[1]);
+	unsigned long int usBatched = benchSolver(SOLVER_USE_WARMSTARTING | SOLVER_SIMD | SOLVER_BATCHED_SOA, numSteps, checksum[2]);
+	printf("box stack 1000 bodies %d steps: SOLVER_SIMD %lu us (height sum %f), generic rows %lu us (height sum %f), SOLVER_BATCHED_SOA %lu us (height sum %f)\n",
+		numSteps, usSimd, checksum[0], usGeneric, checksum[1], usBatched, checksum[2]);
+
+	if (failures)
+	{
+		printf("%d operations differ from the scalar reference\n", failures);
+	}
+	return failures ? 1 : 0;
+}
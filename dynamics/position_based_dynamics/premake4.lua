@@ -18,6 +18,10 @@
 			"bullet2",
 			"gwen"
 		}
+
+		if not os.is("Windows") then
+			links {"pthread"}
+		end
 		
 
 		initOpenGL()
@@ -0,0 +1,237 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2012 Erwin Coumans  http://bulletphysics.org
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+///Multi-threaded profiling benchmark
+///Measures the cost of an empty BT_PROFILE scope with and without the event ring buffers, then profiles a grid of box
+///piles stepped with 4 tasks for the island solver and btCollisionDispatcherMt. Prints the profile tree merged over
+///all threads, checks the merged call counts equal the sum of the per-thread trees and no sample takes longer than its
+///parent, and writes the samples of the last frames as a trace event JSON file that chrome://tracing can open.
+///Usage: profile_trace_bench [number of steps] [trace file]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "btBulletDynamicsCommon.h"
+#include "LinearMath/btQuickprof.h"
+#include "LinearMath/btAlignedObjectArray.h"
+#include "LinearMath/btThreads.h"
+
+#define NUM_PILES_X 8
+#define NUM_PILES_Z 8
+#define PILE_WIDTH 4
+#define PILE_HEIGHT 5
+#define NUM_STEPS 120
+#define NUM_TASKS 4
+#define NUM_SCOPES 2000000
+#define EVENT_CAPACITY 65536
+
+static int gCounter = 0;
+
+static void emptyScopes(int numScopes)
+{
+	BT_PROFILE("emptyScopes");
+	for (int i = 0; i < numScopes; i++)
+	{
+		BT_PROFILE("emptyScope");
+		gCounter++;
+	}
+}
+
+///sums the calls of all nodes called name below the parent of the iterator
+static int countCalls(CProfileIterator* iterator, const char* name)
+{
+	int calls = 0;
+	int numChildren = 0;
+	for (iterator->First(); !iterator->Is_Done(); iterator->Next())
+	{
+		if (!strcmp(iterator->Get_Current_Name(), name))
+			calls += iterator->Get_Current_Total_Calls();
+		numChildren++;
+	}
+	for (int i = 0; i < numChildren; i++)
+	{
+		iterator->Enter_Child(i);
+		calls += countCalls(iterator, name);
+		iterator->Enter_Parent();
+	}
+	return calls;
+}
+
+///counts the nodes below the parent of the iterator whose children take more time than they do, leaving out the
+///"thread <index>" nodes of the merged tree, which run in parallel with their parent
+static int countOverrunParents(CProfileIterator* iterator)
+{
+	int overruns = 0;
+	int numChildren = 0;
+	float childrenTime = 0;
+	for (iterator->First(); !iterator->Is_Done(); iterator->Next())
+	{
+		if (strncmp(iterator->Get_Current_Name(), "thread ", 7))
+			childrenTime += iterator->Get_Current_Total_Time();
+		numChildren++;
+	}
+	if (!iterator->Is_Root() && childrenTime > iterator->Get_Current_Parent_Total_Time() * 1.0001f)
+		overruns++;
+	for (int i = 0; i < numChildren; i++)
+	{
+		iterator->Enter_Child(i);
+		overruns += countOverrunParents(iterator);
+		iterator->Enter_Parent();
+	}
+	return overruns;
+}
+
+static int countThreadCalls(const char* name)
+{
+	int calls = 0;
+	for (int i = 0; i <= BT_MAX_THREAD_COUNT; i++)
+	{
+		CProfileIterator* iterator = CProfileManager::Get_Thread_Iterator(i);
+		if (iterator)
+		{
+			calls += countCalls(iterator, name);
+			CProfileManager::Release_Iterator(iterator);
+		}
+	}
+	return calls;
+}
+
+int main(int argc, char* argv[])
+{
+	int numSteps = argc > 1 ? atoi(argv[1]) : NUM_STEPS;
+	const char* traceFile = argc > 2 ? argv[2] : "profile_trace_bench.json";
+	if (numSteps < 1)
+		numSteps = 1;
+	int failures = 0;
+
+	//cost of a sample
+	btClock clock;
+	for (int pass = 0; pass < 2; pass++)
+	{
+		CProfileManager::Set_Event_Capacity(pass ? EVENT_CAPACITY : 0);
+		CProfileManager::Reset();
+		clock.reset();
+		emptyScopes(NUM_SCOPES);
+		unsigned long int us = clock.getTimeMicroseconds();
+		printf("empty BT_PROFILE scope, event ring %-3s %6.1f ns\n", pass ? "on" : "off", double(us) * 1000. / double(NUM_SCOPES));
+	}
+	CProfileManager::CleanupMemory();
+
+	btDefaultCollisionConfiguration collisionConfiguration;
+	btCollisionDispatcherMt dispatcher(&collisionConfiguration);
+	btDbvtBroadphase broadphase;
+	btSequentialImpulseConstraintSolver solver;
+	btDiscreteDynamicsWorld world(&dispatcher, &broadphase, &solver, &collisionConfiguration);
+	world.setNumTasks(NUM_TASKS);
+	dispatcher.setTaskScheduler(world.getTaskScheduler());
+
+	btBoxShape ground(btVector3(100, 1, 100));
+	btBoxShape box(btVector3(btScalar(0.5), btScalar(0.5), btScalar(0.5)));
+	btAlignedObjectArray<btRigidBody*> bodies;
+	btTransform tr;
+	tr.setIdentity();
+	tr.setOrigin(btVector3(0, -1, 0));
+	bodies.push_back(new btRigidBody(0, 0, &ground));
+	bodies[0]->setWorldTransform(tr);
+	world.addRigidBody(bodies[0]);
+	btVector3 inertia;
+	box.calculateLocalInertia(1, inertia);
+	for (int px = 0; px < NUM_PILES_X; px++)
+	{
+		for (int pz = 0; pz < NUM_PILES_Z; pz++)
+		{
+			int height = 1 + (px * NUM_PILES_Z + pz) % PILE_HEIGHT;
+			for (int y = 0; y < height; y++)
+			{
+				for (int x = 0; x < PILE_WIDTH; x++)
+				{
+					for (int z = 0; z < PILE_WIDTH; z++)
+					{
+						tr.setOrigin(btVector3(
+							btScalar(px * 10 - NUM_PILES_X * 5) + btScalar(x) * btScalar(1.1),
+							btScalar(y) + btScalar(0.5),
+							btScalar(pz * 10 - NUM_PILES_Z * 5) + btScalar(z) * btScalar(1.1)));
+						btRigidBody* body = new btRigidBody(1, 0, &box, inertia);
+						body->setWorldTransform(tr);
+						world.addRigidBody(body);
+						bodies.push_back(body);
+					}
+				}
+			}
+		}
+	}
+
+	CProfileManager::Set_Event_Capacity(EVENT_CAPACITY);
+	CProfileManager::Reset();
+	clock.reset();
+	for (int i = 0; i < numSteps; i++)
+	{
+		//stepSimulation resets the profile trees, they hold the last step; the event ring buffers hold the last frames
+		world.stepSimulation(btScalar(1.) / btScalar(60.), 0);
+	}
+	unsigned long int us = clock.getTimeMicroseconds();
+	printf("%d bodies, %d steps with %d tasks: %lu us\n", bodies.size(), numSteps, NUM_TASKS, us);
+
+	CProfileManager::dumpMerged();
+
+	const char* names[3] = {"internalSingleStepSimulation", "solveIslandBatches", "dispatchPairs"};
+	for (int i = 0; i < 3; i++)
+	{
+		CProfileIterator* merged = CProfileManager::Get_Merged_Iterator();
+		int mergedCalls = countCalls(merged, names[i]);
+		CProfileManager::Release_Iterator(merged);
+		int threadCalls = countThreadCalls(names[i]);
+		bool same = mergedCalls == threadCalls && mergedCalls > 0;
+		if (!same)
+			failures++;
+		printf("%-30s %6d calls merged, %6d calls in the thread trees  %s\n", names[i], mergedCalls, threadCalls, same ? "ok" : "MISMATCH");
+	}
+
+	CProfileIterator* merged = CProfileManager::Get_Merged_Iterator();
+	int overruns = countOverrunParents(merged);
+	CProfileManager::Release_Iterator(merged);
+	if (overruns)
+		failures++;
+	printf("merged samples longer than their parent: %d  %s\n", overruns, overruns ? "MISMATCH" : "ok");
+
+	int numThreads = 0;
+	int numEvents = 0;
+	for (int i = 0; i <= BT_MAX_THREAD_COUNT; i++)
+	{
+		if (CProfileManager::Get_Num_Events(i))
+		{
+			numThreads++;
+			numEvents += CProfileManager::Get_Num_Events(i);
+		}
+	}
+	if (CProfileManager::dumpTraceEvents(traceFile))
+	{
+		printf("wrote %d events of %d threads to %s\n", numEvents, numThreads, traceFile);
+	}
+	else
+	{
+		printf("could not write %s\n", traceFile);
+		failures++;
+	}
+
+	for (int i = 0; i < bodies.size(); i++)
+	{
+		world.removeRigidBody(bodies[i]);
+		delete bodies[i];
+	}
+	CProfileManager::CleanupMemory();
+	return failures ? 1 : 0;
+}
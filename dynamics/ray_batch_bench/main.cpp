@@ -0,0 +1,176 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2012 Erwin Coumans  http://bulletphysics.org
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+///Batched ray query benchmark
+///Casts line of sight rays between random points above a btBvhTriangleMeshShape terrain scattered with boxes, spheres
+///and compound bodies, once with btCollisionWorld::rayTest and a ClosestRayResultCallback per ray, then with
+///btCollisionWorld::rayTestBatch without and with a task scheduler of 1, 2 and 4 threads.
+///Checks rayTestBatch reports exactly the same closest hits as rayTest.
+///Usage: ray_batch_bench [number of rays]
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "btBulletDynamicsCommon.h"
+#include "LinearMath/btQuickprof.h"
+#include "LinearMath/btAlignedObjectArray.h"
+#include "LinearMath/btThreads.h"
+
+#define NUM_RAYS 50000
+#define TERRAIN_SIZE 128
+#define NUM_OBJECTS 400
+
+static btScalar terrainHeight(int x, int z)
+{
+	return btScalar(2.) * btSin(btScalar(x) * btScalar(0.2)) * btCos(btScalar(z) * btScalar(0.15));
+}
+
+static btScalar randRange(btScalar lo, btScalar hi)
+{
+	return lo + (hi - lo) * btScalar(rand()) / btScalar(RAND_MAX);
+}
+
+static bool sameHit(const btCollisionWorld::ClosestRayResultCallback& a, const btCollisionWorld::RayBatchHit& b)
+{
+	if (a.m_collisionObject != b.m_collisionObject)
+		return false;
+	if (!a.hasHit())
+		return true;
+	return a.m_closestHitFraction == b.m_hitFraction &&
+		a.m_hitPointWorld == b.m_hitPointWorld &&
+		a.m_hitNormalWorld == b.m_hitNormalWorld;
+}
+
+int main(int argc, char* argv[])
+{
+	int numRays = argc > 1 ? atoi(argv[1]) : NUM_RAYS;
+	if (numRays < 1)
+		numRays = 1;
+
+	btDefaultCollisionConfiguration collisionConfiguration;
+	btCollisionDispatcher dispatcher(&collisionConfiguration);
+	btDbvtBroadphase broadphase;
+	btCollisionWorld world(&dispatcher, &broadphase, &collisionConfiguration);
+
+	btAlignedObjectArray<btVector3> vertices;
+	btAlignedObjectArray<int> indices;
+	for (int z = 0; z <= TERRAIN_SIZE; z++)
+	{
+		for (int x = 0; x <= TERRAIN_SIZE; x++)
+		{
+			vertices.push_back(btVector3(btScalar(x - TERRAIN_SIZE / 2), terrainHeight(x, z), btScalar(z - TERRAIN_SIZE / 2)));
+		}
+	}
+	for (int z = 0; z < TERRAIN_SIZE; z++)
+	{
+		for (int x = 0; x < TERRAIN_SIZE; x++)
+		{
+			int i = z * (TERRAIN_SIZE + 1) + x;
+			indices.push_back(i); indices.push_back(i + TERRAIN_SIZE + 1); indices.push_back(i + 1);
+			indices.push_back(i + 1); indices.push_back(i + TERRAIN_SIZE + 1); indices.push_back(i + TERRAIN_SIZE + 2);
+		}
+	}
+	btTriangleIndexVertexArray meshInterface(indices.size() / 3, &indices[0], 3 * sizeof(int), vertices.size(), (btScalar*)&vertices[0].x(), sizeof(btVector3));
+	btBvhTriangleMeshShape terrainShape(&meshInterface, true);
+	btCollisionObject terrain;
+	terrain.setCollisionShape(&terrainShape);
+	world.addCollisionObject(&terrain);
+
+	srand(1);
+	btBoxShape box(btVector3(1, 1, 1));
+	btSphereShape sphere(1);
+	btCompoundShape compound;
+	btTransform childTransform;
+	childTransform.setIdentity();
+	childTransform.setOrigin(btVector3(-1, 0, 0));
+	compound.addChildShape(childTransform, &box);
+	childTransform.setOrigin(btVector3(1, 0, 0));
+	compound.addChildShape(childTransform, &sphere);
+	btCollisionShape* shapes[3] = {&box, &sphere, &compound};
+	btAlignedObjectArray<btCollisionObject*> objects;
+	for (int i = 0; i < NUM_OBJECTS; i++)
+	{
+		btCollisionObject* object = new btCollisionObject();
+		object->setCollisionShape(shapes[i % 3]);
+		btTransform tr;
+		tr.setIdentity();
+		tr.setRotation(btQuaternion(btVector3(0, 1, 0), randRange(0, SIMD_2_PI)));
+		tr.setOrigin(btVector3(randRange(-60, 60), randRange(2, 5), randRange(-60, 60)));
+		object->setWorldTransform(tr);
+		world.addCollisionObject(object);
+		objects.push_back(object);
+	}
+	world.updateAabbs();
+
+	btAlignedObjectArray<btVector3> rayFrom, rayTo;
+	for (int i = 0; i < numRays; i++)
+	{
+		rayFrom.push_back(btVector3(randRange(-60, 60), randRange(3, 6), randRange(-60, 60)));
+		rayTo.push_back(rayFrom[i] + btVector3(randRange(-30, 30), randRange(-4, 2), randRange(-30, 30)));
+	}
+
+	btAlignedObjectArray<btCollisionWorld::ClosestRayResultCallback> reference;
+	btClock clock;
+	for (int i = 0; i < numRays; i++)
+	{
+		reference.push_back(btCollisionWorld::ClosestRayResultCallback(rayFrom[i], rayTo[i]));
+		world.rayTest(rayFrom[i], rayTo[i], reference[i]);
+	}
+	unsigned long int usSingle = clock.getTimeMicroseconds();
+	int numHits = 0;
+	for (int i = 0; i < numRays; i++)
+	{
+		numHits += reference[i].hasHit() ? 1 : 0;
+	}
+	printf("%d rays, %d hits\n", numRays, numHits);
+	printf("rayTest                  %8lu us\n", usSingle);
+
+	int failures = 0;
+	btAlignedObjectArray<btCollisionWorld::RayBatchHit> hits;
+	hits.resize(numRays);
+	for (int numThreads = 0; numThreads <= 4; numThreads = numThreads ? numThreads * 2 : 1)
+	{
+		btITaskScheduler* scheduler = numThreads ? btCreateDefaultTaskScheduler(numThreads) : 0;
+		if (numThreads && !scheduler)
+			break;
+		if (scheduler)
+			scheduler->setNumThreads(numThreads);
+		clock.reset();
+		world.rayTestBatch(&rayFrom[0], &rayTo[0], numRays, &hits[0], btBroadphaseProxy::DefaultFilter, btBroadphaseProxy::AllFilter, scheduler);
+		unsigned long int us = clock.getTimeMicroseconds();
+		btDeleteTaskScheduler(scheduler);
+
+		int mismatches = 0;
+		for (int i = 0; i < numRays; i++)
+		{
+			if (!sameHit(reference[i], hits[i]))
+				mismatches++;
+		}
+		if (mismatches)
+			failures++;
+		printf("rayTestBatch %d threads   %8lu us  x%4.2f  %s\n", numThreads, us, us ? double(usSingle) / double(us) : 0.0,
+			mismatches ? "MISMATCH" : "identical");
+		if (mismatches)
+			printf("  %d rays differ\n", mismatches);
+	}
+
+	for (int i = 0; i < objects.size(); i++)
+	{
+		world.removeCollisionObject(objects[i]);
+		delete objects[i];
+	}
+	world.removeCollisionObject(&terrain);
+	return failures ? 1 : 0;
+}
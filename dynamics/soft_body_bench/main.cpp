@@ -0,0 +1,219 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2012 Erwin Coumans  http://bulletphysics.org
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+///Soft body solver benchmark
+///Drops cloth patches of thousands of nodes on static spheres and hangs many ropes, then steps the world with
+///btDefaultSoftBodySolver and with btDefaultSoftBodySolverMt on 1 and on several tasks.
+///The multi-threaded solver must give identical results for any number of tasks, and identical ropes (solved whole)
+///as the default solver. The cloth links are solved in batches, so the cloth only stays close to the default solver.
+///Usage: soft_body_bench [number of steps] [number of tasks]
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "btBulletDynamicsCommon.h"
+#include "BulletSoftBody/btSoftRigidDynamicsWorld.h"
+#include "BulletSoftBody/btSoftBodyRigidBodyCollisionConfiguration.h"
+#include "BulletSoftBody/btSoftBodyHelpers.h"
+#include "BulletSoftBody/btDefaultSoftBodySolverMt.h"
+
+#define NUM_CLOTHS 4
+#define CLOTH_RESOLUTION 64
+#define NUM_ROPES 32
+#define ROPE_RESOLUTION 62
+#define NUM_STEPS 60
+#define NUM_TASKS 4
+
+struct RunResult
+{
+	unsigned long int				m_us;
+	btAlignedObjectArray<btVector3>	m_clothPositions;
+	btAlignedObjectArray<btVector3>	m_ropePositions;
+	int								m_numNodes;
+	int								m_numLinks;
+	int								m_numBatches;
+	///mean of |length-rest length|/rest length over the cloth links
+	double							m_clothStretch;
+};
+
+static void run(bool multiThreaded,int numTasks,int numSteps,RunResult& result)
+{
+	btSoftBodyRigidBodyCollisionConfiguration collisionConfiguration;
+	btCollisionDispatcher dispatcher(&collisionConfiguration);
+	btDbvtBroadphase broadphase;
+	btSequentialImpulseConstraintSolver solver;
+	btDefaultSoftBodySolver defaultSoftBodySolver;
+	btDefaultSoftBodySolverMt softBodySolverMt;
+	btSoftBodySolver* softBodySolver = multiThreaded ? (btSoftBodySolver*)&softBodySolverMt : (btSoftBodySolver*)&defaultSoftBodySolver;
+	btSoftRigidDynamicsWorld* world = new btSoftRigidDynamicsWorld(&dispatcher, &broadphase, &solver, &collisionConfiguration, softBodySolver);
+	world->setNumTasks(numTasks);
+	softBodySolverMt.setTaskScheduler(world->getTaskScheduler());
+	btSoftBodyWorldInfo& worldInfo = world->getWorldInfo();
+	worldInfo.m_gravity.setValue(0, -10, 0);
+
+	btBoxShape groundShape(btVector3(200, 1, 200));
+	btSphereShape sphereShape(btScalar(3.));
+	btAlignedObjectArray<btRigidBody*> rigidBodies;
+	btTransform tr;
+	tr.setIdentity();
+	tr.setOrigin(btVector3(0, -1, 0));
+	rigidBodies.push_back(new btRigidBody(0, 0, &groundShape));
+	rigidBodies[0]->setWorldTransform(tr);
+	world->addRigidBody(rigidBodies[0]);
+
+	btAlignedObjectArray<btSoftBody*> cloths;
+	for (int i = 0; i < NUM_CLOTHS; i++)
+	{
+		const btScalar x = btScalar(i * 20 - NUM_CLOTHS * 10);
+		tr.setOrigin(btVector3(x, 3, 0));
+		btRigidBody* sphere = new btRigidBody(0, 0, &sphereShape);
+		sphere->setWorldTransform(tr);
+		world->addRigidBody(sphere);
+		rigidBodies.push_back(sphere);
+
+		const btScalar s = 8;
+		btSoftBody* cloth = btSoftBodyHelpers::CreatePatch(worldInfo,
+			btVector3(x - s, 8, -s), btVector3(x + s, 8, -s), btVector3(x - s, 8, s), btVector3(x + s, 8, s),
+			CLOTH_RESOLUTION, CLOTH_RESOLUTION, 0, true);
+		cloth->getCollisionShape()->setMargin(btScalar(0.1));
+		cloth->generateBendingConstraints(2, cloth->m_materials[0]);
+		cloth->m_cfg.piterations = 8;
+		cloth->m_cfg.viterations = 2;
+		cloth->m_cfg.m_vsequence.push_back(btSoftBody::eVSolver::Linear);
+		cloth->setTotalMass(10);
+		world->addSoftBody(cloth);
+		cloths.push_back(cloth);
+	}
+	btAlignedObjectArray<btSoftBody*> ropes;
+	for (int i = 0; i < NUM_ROPES; i++)
+	{
+		const btScalar x = btScalar(i - NUM_ROPES / 2);
+		btSoftBody* rope = btSoftBodyHelpers::CreateRope(worldInfo, btVector3(x, 12, 30), btVector3(x + 10, 12, 30), ROPE_RESOLUTION, 1);
+		rope->m_cfg.piterations = 4;
+		rope->setTotalMass(1);
+		world->addSoftBody(rope);
+		ropes.push_back(rope);
+	}
+
+	btClock clock;
+	for (int i = 0; i < numSteps; i++)
+	{
+		world->stepSimulation(btScalar(1.) / btScalar(60.), 0);
+	}
+	result.m_us = clock.getTimeMicroseconds();
+
+	result.m_numNodes = 0;
+	result.m_numLinks = 0;
+	result.m_numBatches = 0;
+	result.m_clothStretch = 0;
+	result.m_clothPositions.resize(0);
+	result.m_ropePositions.resize(0);
+	for (int i = 0; i < cloths.size(); i++)
+	{
+		result.m_numNodes += cloths[i]->m_nodes.size();
+		result.m_numLinks += cloths[i]->m_links.size();
+		result.m_numBatches += softBodySolverMt.getNumLinkBatches(cloths[i]);
+		for (int j = 0; j < cloths[i]->m_links.size(); j++)
+		{
+			const btSoftBody::Link& l = cloths[i]->m_links[j];
+			result.m_clothStretch += btFabs((l.m_n[1]->m_x - l.m_n[0]->m_x).length() - l.m_rl) / l.m_rl;
+		}
+		for (int j = 0; j < cloths[i]->m_nodes.size(); j++)
+			result.m_clothPositions.push_back(cloths[i]->m_nodes[j].m_x);
+	}
+	int numClothLinks = result.m_numLinks;
+	result.m_clothStretch /= double(numClothLinks);
+	for (int i = 0; i < ropes.size(); i++)
+	{
+		result.m_numNodes += ropes[i]->m_nodes.size();
+		result.m_numLinks += ropes[i]->m_links.size();
+		for (int j = 0; j < ropes[i]->m_nodes.size(); j++)
+			result.m_ropePositions.push_back(ropes[i]->m_nodes[j].m_x);
+	}
+
+	for (int i = 0; i < cloths.size(); i++)
+	{
+		world->removeSoftBody(cloths[i]);
+		delete cloths[i];
+	}
+	for (int i = 0; i < ropes.size(); i++)
+	{
+		world->removeSoftBody(ropes[i]);
+		delete ropes[i];
+	}
+	for (int i = 0; i < rigidBodies.size(); i++)
+	{
+		world->removeRigidBody(rigidBodies[i]);
+		delete rigidBodies[i];
+	}
+	delete world;
+}
+
+static btScalar maxDistance(const btAlignedObjectArray<btVector3>& a, const btAlignedObjectArray<btVector3>& b)
+{
+	btScalar distance = 0;
+	for (int i = 0; i < a.size(); i++)
+		distance = btMax(distance, (a[i] - b[i]).length());
+	return distance;
+}
+
+static bool identical(const btAlignedObjectArray<btVector3>& a, const btAlignedObjectArray<btVector3>& b)
+{
+	if (a.size() != b.size())
+		return false;
+	for (int i = 0; i < a.size(); i++)
+	{
+		if (a[i].x() != b[i].x() || a[i].y() != b[i].y() || a[i].z() != b[i].z())
+			return false;
+	}
+	return true;
+}
+
+int main(int argc, char* argv[])
+{
+	int numSteps = argc > 1 ? atoi(argv[1]) : NUM_STEPS;
+	int numTasks = argc > 2 ? atoi(argv[2]) : NUM_TASKS;
+	if (numSteps < 1)
+		numSteps = 1;
+	if (numTasks < 1)
+		numTasks = 1;
+	int failures = 0;
+
+	RunResult serial, mt1, mtN;
+	run(false, 1, numSteps, serial);
+	run(true, 1, numSteps, mt1);
+	run(true, numTasks, numSteps, mtN);
+
+	printf("%d cloths and %d ropes, %d nodes, %d links, %d steps\n", NUM_CLOTHS, NUM_ROPES, serial.m_numNodes, serial.m_numLinks, numSteps);
+	printf("cloth links colored into %.1f batches per cloth\n", double(mt1.m_numBatches) / double(NUM_CLOTHS));
+	printf("btDefaultSoftBodySolver               %8lu us\n", serial.m_us);
+	printf("btDefaultSoftBodySolverMt,  1 task    %8lu us\n", mt1.m_us);
+	printf("btDefaultSoftBodySolverMt, %2d tasks   %8lu us\n", numTasks, mtN.m_us);
+
+	bool same = identical(mt1.m_clothPositions, mtN.m_clothPositions) && identical(mt1.m_ropePositions, mtN.m_ropePositions);
+	if (!same)
+		failures++;
+	printf("1 task and %d tasks                    %s\n", numTasks, same ? "identical" : "DIFFERENT");
+
+	same = identical(serial.m_ropePositions, mt1.m_ropePositions);
+	if (!same)
+		failures++;
+	printf("ropes, default and multi-threaded     %s\n", same ? "identical" : "DIFFERENT");
+
+	printf("cloth, default and multi-threaded     max node distance %f\n", maxDistance(serial.m_clothPositions, mt1.m_clothPositions));
+	printf("cloth link stretch                    %f default, %f multi-threaded\n", serial.m_clothStretch, mt1.m_clothStretch);
+
+	return failures ? 1 : 0;
+}
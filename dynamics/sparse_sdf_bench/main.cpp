@@ -0,0 +1,215 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2012 Erwin Coumans  http://bulletphysics.org
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+///btSparseSdf benchmark
+///Evaluates frames of points moving over a few convex shapes with an unbounded cache, with a cache limited to a fraction of
+///the cells (least recently used cells are evicted and built again), and from several tasks at once, and checks all
+///give the same distances and normals. Then compares the first evaluation of the nodes of a cloth on an empty cache,
+///with and without building its cells in parallel with Prepopulate.
+///Usage: sparse_sdf_bench [number of points] [number of tasks]
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "btBulletCollisionCommon.h"
+#include "BulletSoftBody/btSparseSDF.h"
+#include "LinearMath/btQuickprof.h"
+
+#define NUM_POINTS 200000
+#define NUM_TASKS 4
+#define NUM_SHAPES 3
+
+typedef btSparseSdf<3> Sdf;
+
+struct Query
+{
+	btVector3	m_point;
+	int			m_shape;
+};
+
+struct Result
+{
+	btScalar	m_distance;
+	btVector3	m_normal;
+};
+
+struct EvaluateLoop : public btIParallelForBody
+{
+	Sdf*				m_sdf;
+	const Query*		m_queries;
+	btCollisionShape**	m_shapes;
+	Result*				m_results;
+
+	void forLoop(int iBegin, int iEnd) const
+	{
+		for (int i = iBegin; i < iEnd; i++)
+		{
+			m_results[i].m_distance = m_sdf->Evaluate(m_queries[i].m_point, m_shapes[m_queries[i].m_shape], m_results[i].m_normal, 0);
+		}
+	}
+};
+
+static unsigned int gSeed = 12345;
+
+static btScalar randRange(btScalar lo, btScalar hi)
+{
+	gSeed = gSeed * 1664525u + 1013904223u;
+	return lo + (hi - lo) * btScalar(gSeed >> 8) / btScalar(1 << 24);
+}
+
+static unsigned long int evaluate(Sdf& sdf, btITaskScheduler* scheduler, const btAlignedObjectArray<Query>& queries, btCollisionShape** shapes, btAlignedObjectArray<Result>& results)
+{
+	results.resize(queries.size());
+	EvaluateLoop loop;
+	loop.m_sdf = &sdf;
+	loop.m_queries = &queries[0];
+	loop.m_shapes = shapes;
+	loop.m_results = &results[0];
+	btClock clock;
+	if (scheduler)
+		scheduler->parallelFor(0, queries.size(), 256, loop);
+	else
+		loop.forLoop(0, queries.size());
+	return clock.getTimeMicroseconds();
+}
+
+static bool identical(const btAlignedObjectArray<Result>& a, const btAlignedObjectArray<Result>& b)
+{
+	for (int i = 0; i < a.size(); i++)
+	{
+		if (a[i].m_distance != b[i].m_distance || a[i].m_normal.x() != b[i].m_normal.x() ||
+			a[i].m_normal.y() != b[i].m_normal.y() || a[i].m_normal.z() != b[i].m_normal.z())
+			return false;
+	}
+	return true;
+}
+
+static void printStats(const char* name, const Sdf& sdf, unsigned long int us)
+{
+	Sdf::Stats stats;
+	sdf.GetStats(stats);
+	printf("%-28s %8lu us, %6d cells (max %6d), %6.2f MB, %7d built, %7d evicted, %6d prepopulated, %.2f probes/query\n",
+		name, us, stats.ncells, stats.maxcells, double(stats.memory) / (1024. * 1024.), stats.nbuilt, stats.nevicted,
+		stats.nprepopulated, stats.nqueries ? double(stats.nprobes) / double(stats.nqueries) : 0.);
+}
+
+int main(int argc, char* argv[])
+{
+	int numPoints = argc > 1 ? atoi(argv[1]) : NUM_POINTS;
+	int numTasks = argc > 2 ? atoi(argv[2]) : NUM_TASKS;
+	if (numPoints < 1)
+		numPoints = 1;
+	int failures = 0;
+
+	btSphereShape sphere(btScalar(2.));
+	btBoxShape box(btVector3(3, 1, 2));
+	btCylinderShape cylinder(btVector3(1, 2, 1));
+	btCollisionShape* shapes[NUM_SHAPES] = {&sphere, &box, &cylinder};
+
+	//frames of points in a region moving along the shapes and back, like soft body nodes sliding over them
+	btAlignedObjectArray<Query> queries;
+	const int numFrames = 100;
+	for (int pass = 0; pass < 2; pass++)
+	{
+		for (int f = 0; f < numFrames; f++)
+		{
+			const btScalar t = btScalar(pass ? numFrames - 1 - f : f) / btScalar(numFrames - 1);
+			const btVector3 center(-4 + 8 * t, 0, 0);
+			for (int i = 0; i < numPoints / (2 * numFrames); i++)
+			{
+				Query q;
+				q.m_shape = i % NUM_SHAPES;
+				q.m_point = center + btVector3(randRange(-1, 1), randRange(-3, 3), randRange(-3, 3));
+				queries.push_back(q);
+			}
+		}
+	}
+
+	btITaskScheduler* scheduler = btCreateDefaultTaskScheduler(numTasks);
+	if (scheduler)
+		scheduler->setNumThreads(numTasks);
+
+	btAlignedObjectArray<Result> reference, bounded, parallel;
+	Sdf sdf;
+	sdf.Initialize(2383, 1 << 30);
+	unsigned long int us = evaluate(sdf, 0, queries, shapes, reference);
+	printStats("unbounded, serial", sdf, us);
+	Sdf::Stats stats;
+	sdf.GetStats(stats);
+	const int numCells = stats.ncells;
+
+	sdf.Initialize(2383, numCells / 2);
+	us = evaluate(sdf, 0, queries, shapes, bounded);
+	printStats("max 1/2 of the cells", sdf, us);
+	sdf.GetStats(stats);
+	bool same = identical(reference, bounded);
+	bool bound = stats.ncells <= ((numCells / 2 + BT_SPARSE_SDF_NUM_STRIPES - 1) / BT_SPARSE_SDF_NUM_STRIPES) * BT_SPARSE_SDF_NUM_STRIPES && stats.nevicted > 0;
+	if (!same || !bound)
+		failures++;
+	printf("bounded cache                %s, %s\n", same ? "identical" : "DIFFERENT", bound ? "within bound" : "OUT OF BOUND");
+
+	if (scheduler)
+	{
+		sdf.Initialize(2383, numCells / 2);
+		us = evaluate(sdf, scheduler, queries, shapes, parallel);
+		char name[64];
+		sprintf(name, "max 1/2, %d tasks", numTasks);
+		printStats(name, sdf, us);
+		same = identical(reference, parallel);
+		if (!same)
+			failures++;
+		printf("concurrent lookups           %s\n", same ? "identical" : "DIFFERENT");
+	}
+
+	//first contact: the nodes of a cloth, in row order, reaching the sphere
+	btAlignedObjectArray<Query> cloud;
+	btAlignedObjectArray<btVector3> cloudPoints;
+	const int resolution = int(btSqrt(btScalar(numPoints / 4)));
+	for (int y = 0; y < resolution; y++)
+	{
+		for (int x = 0; x < resolution; x++)
+		{
+			Query q;
+			q.m_shape = 0;
+			q.m_point = btVector3(btScalar(x) / btScalar(resolution) * 6 - 3, btScalar(1.9), btScalar(y) / btScalar(resolution) * 6 - 3);
+			q.m_point.setY(q.m_point.y() + btScalar(0.3) * btSin(q.m_point.x() * 2) * btCos(q.m_point.z() * 3));
+			cloud.push_back(q);
+			cloudPoints.push_back(q.m_point);
+		}
+	}
+	btAlignedObjectArray<Result> cold, warm;
+	sdf.Initialize();
+	us = evaluate(sdf, 0, cloud, shapes, cold);
+	printStats("first contact, serial build", sdf, us);
+	if (scheduler)
+	{
+		sdf.Initialize();
+		sdf.SetTaskScheduler(scheduler);
+		btClock clock;
+		sdf.Prepopulate(&cloudPoints[0], cloudPoints.size(), shapes[0]);
+		evaluate(sdf, 0, cloud, shapes, warm);
+		us = clock.getTimeMicroseconds();
+		printStats("first contact, prepopulated", sdf, us);
+		sdf.GetStats(stats);
+		same = identical(cold, warm) && stats.nbuilt == stats.nprepopulated;
+		if (!same)
+			failures++;
+		printf("prepopulated cells           %s\n", same ? "identical" : "DIFFERENT");
+		sdf.SetTaskScheduler(0);
+		btDeleteTaskScheduler(scheduler);
+	}
+	sdf.Reset();
+	return failures ? 1 : 0;
+}
@@ -18,51 +18,57 @@ Physics Effects under the filename: physics_effects_license.txt
 #define _SCE_PFX_PERF_COUNTER_H
 
 #include "pfx_common.h"
+#include "pfx_perf_trace.h"
 
 //J パフォーマンス測定する場合はPFX_USE_PERFCOUNTERを定義
 //J ブックマークを使用する場合はPFX_USE_BOOKMARKを定義
+//J SCE_PFX_PUSH_MARKERをトレースに記録する場合はSCE_PFX_USE_PERFTRACEを定義
 
 //E Define SCE_PFX_USE_PERFCOUNTER to check performance
 //E Define SCE_PFX_USE_BOOKMARK to use bookmark
+//E Define SCE_PFX_USE_PERFTRACE to record SCE_PFX_PUSH_MARKER scopes into the trace
 
 
 #define SCE_PFX_MAX_PERF_STR	32
-#define SCE_PFX_MAX_PERF_COUNT	20
+
+#ifndef SCE_PFX_MAX_PERF_COUNT
+#define SCE_PFX_MAX_PERF_COUNT	64
+#endif
 
 #define SCE_PFX_USE_PERFCOUNTER
 //#define SCE_PFX_USE_BOOKMARK
+//#define SCE_PFX_USE_PERFTRACE
 
 namespace sce {
 namespace PhysicsEffects {
 #ifdef SCE_PFX_USE_PERFCOUNTER
 
+//J countBegin/countEndは入れ子にできる
+//J i番目に開始したスコープの時間はgetCountTime(i*2)で取得する
+//E countBegin/countEnd can be nested
+//E The time of the i-th scope begun is returned by getCountTime(i*2)
+
 class PfxPerfCounter
 {
 private:
-	int   m_count,m_strCount;
+	int   m_strCount,m_depth,m_overflow;
 	char  m_str[SCE_PFX_MAX_PERF_COUNT][SCE_PFX_MAX_PERF_STR];
+	int   m_strDepth[SCE_PFX_MAX_PERF_COUNT];
+	int   m_stack[SCE_PFX_MAX_PERF_COUNT];
 	float m_freq;
 
 	SCE_PFX_PADDING(1,4)
-#ifdef _WIN32
-	LONGLONG  m_cnt[SCE_PFX_MAX_PERF_COUNT*2];
-#endif
+	PfxUInt64 m_cnt[SCE_PFX_MAX_PERF_COUNT*2];
 
 	void count(int i)
 	{
-#ifdef _WIN32
-		QueryPerformanceCounter( (LARGE_INTEGER *)&m_cnt[i] );
-#endif
+		m_cnt[i] = pfxPerfGetTicks();
 	}
 
 public:
 	PfxPerfCounter()
 	{
-#ifdef _WIN32
-		LARGE_INTEGER sPerfCountFreq;
-		QueryPerformanceFrequency(&sPerfCountFreq);
-		m_freq = (float)sPerfCountFreq.QuadPart;
-#endif
+		m_freq = (float)pfxPerfGetTicksPerSecond();
 		resetCount();
 	}
 
@@ -74,42 +80,52 @@ public:
 	void countBegin(const char *name)
 	{
 		SCE_PFX_ASSERT(m_strCount < SCE_PFX_MAX_PERF_COUNT);
-		strncpy(m_str[m_strCount],name,SCE_PFX_MAX_PERF_STR-1);
-		m_str[m_strCount][SCE_PFX_MAX_PERF_STR-1] = 0x00;
-		m_strCount++;
-		count(m_count++);
+		if(m_overflow > 0 || m_strCount >= SCE_PFX_MAX_PERF_COUNT) {
+			m_overflow++;
+			return;
+		}
+		int id = m_strCount++;
+		strncpy(m_str[id],name,SCE_PFX_MAX_PERF_STR-1);
+		m_str[id][SCE_PFX_MAX_PERF_STR-1] = 0x00;
+		m_strDepth[id] = m_depth;
+		m_stack[m_depth++] = id;
+		m_cnt[id*2+1] = 0;
+		count(id*2);
 	}
 	
 	void countEnd()
 	{
-		count(m_count++);
+		if(m_overflow > 0) {
+			m_overflow--;
+			return;
+		}
+		if(m_depth == 0) return;
+		count(m_stack[--m_depth]*2+1);
 	}
 
 	void resetCount()
 	{
 		m_strCount = 0;
-		m_count = 0;
+		m_depth = 0;
+		m_overflow = 0;
 	}
 
 	float getCountTime(int i)
 	{
-#if _WIN32
-	return (float)(m_cnt[i+1]-m_cnt[i]) / m_freq * 1000.0f;
-#else
-	return 0.f;
-#endif	
-}
+		if(i < 0 || i+1 >= m_strCount*2 || m_cnt[i+1] < m_cnt[i]) return 0.0f;
+		return (float)(m_cnt[i+1]-m_cnt[i]) / m_freq * 1000.0f;
+	}
 
 	void printCount()
 	{
-		if(m_count%2 != 0) countEnd();
+		while(m_depth > 0 || m_overflow > 0) countEnd();
 		SCE_PFX_PRINTF("*** PfxPerfCounter results ***\n");
 		float total = 0.0f;
-		for(int i=0;i+1<m_count;i+=2) {
-			total += getCountTime(i);
+		for(int i=0;i<m_strCount;i++) {
+			if(m_strDepth[i] == 0) total += getCountTime(i*2);
 		}
-		for(int i=0;i+1<m_count;i+=2) {
-			SCE_PFX_PRINTF(" -- %s %fms(%.2f%%)\n",m_str[i>>1],getCountTime(i),getCountTime(i)/total*100.0f);
+		for(int i=0;i<m_strCount;i++) {
+			SCE_PFX_PRINTF(" -- %*s%s %fms(%.2f%%)\n",m_strDepth[i]*2,"",m_str[i],getCountTime(i*2),getCountTime(i*2)/total*100.0f);
 		}
 		SCE_PFX_PRINTF(" -- Total %fms\n",total);
 	}
@@ -133,7 +149,10 @@ public:
 
 #define pfxInsertBookmark(bookmark)
 
-#ifdef SCE_PFX_USE_BOOKMARK
+#if defined(SCE_PFX_USE_PERFTRACE)
+	#define SCE_PFX_PUSH_MARKER(name) sce::PhysicsEffects::pfxPerfTracePush(name)
+	#define SCE_PFX_POP_MARKER() sce::PhysicsEffects::pfxPerfTracePop()
+#elif defined(SCE_PFX_USE_BOOKMARK)
 	#define SCE_PFX_PUSH_MARKER(name)
 	#define SCE_PFX_POP_MARKER()
 #else
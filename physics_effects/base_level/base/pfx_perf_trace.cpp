@@ -0,0 +1,429 @@
+/*
+Physics Effects Copyright(C) 2011 Sony Computer Entertainment Inc.
+All rights reserved.
+
+Physics Effects is open software; you can redistribute it and/or
+modify it under the terms of the BSD License.
+
+Physics Effects is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+See the BSD License for more details.
+
+A copy of the BSD License is distributed with
+Physics Effects under the filename: physics_effects_license.txt
+*/
+
+#include "base_level/base/pfx_perf_trace.h"
+
+#if defined(_MSC_VER)
+	#define SCE_PFX_PERF_THREAD_LOCAL __declspec(thread)
+#else
+	#define SCE_PFX_PERF_THREAD_LOCAL __thread
+#endif
+
+namespace sce {
+namespace PhysicsEffects {
+
+#define SCE_PFX_PERF_TRACE_INVALID_EVENT 0xffffffff
+
+struct PfxPerfTraceEvent {
+	const char *name;
+	PfxUInt64 begin;
+	PfxUInt64 end; // 0 while the scope is open
+	PfxUInt32 depth;
+};
+
+//J 各スレッドは自分のバッファにのみ書き込む
+//E Each thread only writes to its own buffer
+struct PfxPerfTraceThread {
+	PfxPerfTraceEvent *events;
+	PfxUInt32 numEvents;
+	PfxUInt32 numDropped;
+	PfxUInt32 frameStart;
+	PfxUInt32 depth;
+	PfxUInt32 stack[SCE_PFX_PERF_TRACE_MAX_DEPTH];
+};
+
+struct PfxPerfTraceName {
+	const char *name;
+	PfxUInt32 depth;
+	PfxUInt32 numCalls;
+	PfxUInt64 ticks;
+	PfxUInt32 lastCalls;
+	PfxFloat lastMs;
+	PfxUInt32 numFrames;
+	PfxUInt32 head;
+	PfxFloat window[SCE_PFX_PERF_TRACE_WINDOW];
+};
+
+static PfxPerfTraceThread s_threads[SCE_PFX_PERF_TRACE_MAX_THREADS];
+static volatile PfxInt32 s_numThreads = 0;
+static volatile bool s_enabled = true;
+static SCE_PFX_PERF_THREAD_LOCAL PfxInt32 s_threadId = 0; // 0:not registered -1:no slot
+
+static PfxPerfTraceName s_names[SCE_PFX_PERF_TRACE_MAX_NAMES];
+static PfxUInt32 s_numNames = 0;
+
+///////////////////////////////////////////////////////////////////////////////
+// Timer
+
+PfxUInt64 pfxPerfGetTicksPerSecond()
+{
+#if defined(_WIN32)
+	LARGE_INTEGER freq;
+	QueryPerformanceFrequency(&freq);
+	return (PfxUInt64)freq.QuadPart;
+#elif defined(SCE_PFX_PERF_USE_RDTSC) && (defined(__i386__) || defined(__x86_64__))
+	//J clock_gettimeを基準に10ms間のrdtscの増分を測定する
+	//E Measure the rdtsc increment over 10ms against clock_gettime
+	static volatile PfxUInt64 s_freq = 0;
+	if(s_freq == 0) {
+		struct timespec ts0,ts1;
+		clock_gettime(CLOCK_MONOTONIC,&ts0);
+		PfxUInt64 tsc0 = (PfxUInt64)__rdtsc();
+		PfxUInt64 elapsed = 0;
+		do {
+			clock_gettime(CLOCK_MONOTONIC,&ts1);
+			elapsed = (PfxUInt64)(ts1.tv_sec-ts0.tv_sec) * 1000000000ull + (PfxUInt64)ts1.tv_nsec - (PfxUInt64)ts0.tv_nsec;
+		} while(elapsed < 10000000ull);
+		PfxUInt64 tsc1 = (PfxUInt64)__rdtsc();
+		s_freq = (PfxUInt64)((double)(tsc1-tsc0) * 1.0e9 / (double)elapsed);
+	}
+	return s_freq;
+#else
+	return 1000000000ull;
+#endif
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Thread Buffer
+
+static SCE_PFX_FORCE_INLINE
+PfxInt32 pfxPerfTraceAtomicIncrement(volatile PfxInt32 *value)
+{
+#if defined(_MSC_VER)
+	return (PfxInt32)InterlockedIncrement((volatile LONG*)value);
+#else
+	return __sync_add_and_fetch(value,1);
+#endif
+}
+
+static SCE_PFX_FORCE_INLINE
+PfxUInt32 pfxPerfTraceGetNumThreads()
+{
+	return SCE_PFX_MIN((PfxUInt32)s_numThreads,(PfxUInt32)SCE_PFX_PERF_TRACE_MAX_THREADS);
+}
+
+static PfxPerfTraceThread *pfxPerfTraceGetThread()
+{
+	if(SCE_PFX_UNLIKELY(s_threadId == 0)) {
+		PfxInt32 id = pfxPerfTraceAtomicIncrement(&s_numThreads);
+		if(id > SCE_PFX_PERF_TRACE_MAX_THREADS) {
+			s_threadId = -1;
+			return NULL;
+		}
+
+		PfxPerfTraceThread &thread = s_threads[id-1];
+		thread.numEvents = 0;
+		thread.numDropped = 0;
+		thread.frameStart = 0;
+		thread.depth = 0;
+		thread.events = (PfxPerfTraceEvent*)malloc(sizeof(PfxPerfTraceEvent)*SCE_PFX_PERF_TRACE_MAX_EVENTS);
+		if(!thread.events) {
+			s_threadId = -1;
+			return NULL;
+		}
+		s_threadId = id;
+	}
+
+	if(s_threadId < 0) return NULL;
+
+	return &s_threads[s_threadId-1];
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Recording
+
+void pfxPerfTraceEnable(bool enable)
+{
+	s_enabled = enable;
+}
+
+void pfxPerfTracePush(const char *name)
+{
+	PfxPerfTraceThread *thread = pfxPerfTraceGetThread();
+	if(!thread) return;
+
+	PfxUInt32 depth = thread->depth++;
+	if(depth >= SCE_PFX_PERF_TRACE_MAX_DEPTH) return;
+
+	if(!s_enabled) {
+		thread->stack[depth] = SCE_PFX_PERF_TRACE_INVALID_EVENT;
+		return;
+	}
+
+	if(thread->numEvents >= SCE_PFX_PERF_TRACE_MAX_EVENTS) {
+		thread->stack[depth] = SCE_PFX_PERF_TRACE_INVALID_EVENT;
+		thread->numDropped++;
+		return;
+	}
+
+	PfxPerfTraceEvent &ev = thread->events[thread->numEvents];
+	ev.name = name;
+	ev.depth = depth;
+	ev.end = 0;
+	ev.begin = pfxPerfGetTicks();
+	thread->stack[depth] = thread->numEvents++;
+}
+
+void pfxPerfTracePop()
+{
+	PfxUInt64 ticks = pfxPerfGetTicks();
+
+	PfxPerfTraceThread *thread = pfxPerfTraceGetThread();
+	if(!thread || thread->depth == 0) return;
+
+	PfxUInt32 depth = --thread->depth;
+	if(depth >= SCE_PFX_PERF_TRACE_MAX_DEPTH) return;
+
+	PfxUInt32 eventId = thread->stack[depth];
+	if(eventId != SCE_PFX_PERF_TRACE_INVALID_EVENT) {
+		PfxPerfTraceEvent &ev = thread->events[eventId];
+		ev.end = SCE_PFX_MAX(ticks,ev.begin+1);
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Statistics
+
+static PfxPerfTraceName *pfxPerfTraceFindName(const char *name,PfxUInt32 depth)
+{
+	for(PfxUInt32 i=0;i<s_numNames;i++) {
+		if(s_names[i].name == name || strcmp(s_names[i].name,name) == 0) {
+			s_names[i].depth = SCE_PFX_MIN(s_names[i].depth,depth);
+			return &s_names[i];
+		}
+	}
+
+	if(s_numNames >= SCE_PFX_PERF_TRACE_MAX_NAMES) return NULL;
+
+	PfxPerfTraceName &entry = s_names[s_numNames++];
+	memset(&entry,0,sizeof(PfxPerfTraceName));
+	entry.name = name;
+	entry.depth = depth;
+	return &entry;
+}
+
+void pfxPerfTraceBeginFrame()
+{
+	PfxUInt32 numThreads = pfxPerfTraceGetNumThreads();
+	for(PfxUInt32 t=0;t<numThreads;t++) {
+		PfxPerfTraceThread &thread = s_threads[t];
+		if(!thread.events) continue;
+		thread.frameStart = thread.numEvents;
+	}
+}
+
+void pfxPerfTraceEndFrame()
+{
+	PfxFloat msPerTick = 1000.0f / (PfxFloat)pfxPerfGetTicksPerSecond();
+
+	for(PfxUInt32 i=0;i<s_numNames;i++) {
+		s_names[i].numCalls = 0;
+		s_names[i].ticks = 0;
+	}
+
+	//J 同じ名前のスコープの時間をスレッドを問わず合計する
+	//E Sum up the time of scopes with the same name across threads
+	PfxUInt32 numThreads = pfxPerfTraceGetNumThreads();
+	for(PfxUInt32 t=0;t<numThreads;t++) {
+		PfxPerfTraceThread &thread = s_threads[t];
+		if(!thread.events) continue;
+
+		PfxUInt32 numEvents = thread.numEvents;
+		for(PfxUInt32 e=thread.frameStart;e<numEvents;e++) {
+			const PfxPerfTraceEvent &ev = thread.events[e];
+			if(ev.end == 0) continue;
+			PfxPerfTraceName *entry = pfxPerfTraceFindName(ev.name,ev.depth);
+			if(!entry) continue;
+			entry->numCalls++;
+			entry->ticks += ev.end - ev.begin;
+		}
+		thread.frameStart = numEvents;
+	}
+
+	for(PfxUInt32 i=0;i<s_numNames;i++) {
+		PfxPerfTraceName &entry = s_names[i];
+		entry.lastCalls = entry.numCalls;
+		if(entry.numCalls == 0) continue;
+		entry.lastMs = (PfxFloat)entry.ticks * msPerTick;
+		entry.window[entry.head] = entry.lastMs;
+		entry.head = (entry.head + 1) % SCE_PFX_PERF_TRACE_WINDOW;
+		entry.numFrames = SCE_PFX_MIN(entry.numFrames+1,(PfxUInt32)SCE_PFX_PERF_TRACE_WINDOW);
+	}
+}
+
+static int pfxPerfTraceCompareFloat(const void *a,const void *b)
+{
+	PfxFloat fa = *(const PfxFloat*)a;
+	PfxFloat fb = *(const PfxFloat*)b;
+	return (fa < fb) ? -1 : ((fa > fb) ? 1 : 0);
+}
+
+PfxUInt32 pfxPerfTraceGetNumStats()
+{
+	return s_numNames;
+}
+
+PfxInt32 pfxPerfTraceGetStats(PfxUInt32 i,PfxPerfTraceStats &stats)
+{
+	if(i >= s_numNames) return SCE_PFX_ERR_OUT_OF_RANGE;
+
+	const PfxPerfTraceName &entry = s_names[i];
+
+	stats.name = entry.name;
+	stats.numFrames = entry.numFrames;
+	stats.numCalls = entry.lastCalls;
+	stats.lastMs = entry.lastMs;
+	stats.minMs = 0.0f;
+	stats.avgMs = 0.0f;
+	stats.p99Ms = 0.0f;
+
+	if(entry.numFrames == 0) return SCE_PFX_OK;
+
+	PfxFloat sorted[SCE_PFX_PERF_TRACE_WINDOW];
+	PfxFloat total = 0.0f;
+	for(PfxUInt32 f=0;f<entry.numFrames;f++) {
+		sorted[f] = entry.window[f];
+		total += entry.window[f];
+	}
+	qsort(sorted,entry.numFrames,sizeof(PfxFloat),pfxPerfTraceCompareFloat);
+
+	//J 99パーセンタイルはceil(0.99*n)番目の値
+	//E The 99th percentile is the ceil(0.99*n)-th value
+	PfxUInt32 p99 = (entry.numFrames * 99 + 99) / 100;
+
+	stats.minMs = sorted[0];
+	stats.avgMs = total / (PfxFloat)entry.numFrames;
+	stats.p99Ms = sorted[p99-1];
+
+	return SCE_PFX_OK;
+}
+
+void pfxPerfTracePrintStats()
+{
+	SCE_PFX_PRINTF("*** PfxPerfTrace results ***\n");
+	for(PfxUInt32 i=0;i<s_numNames;i++) {
+		PfxPerfTraceStats stats;
+		pfxPerfTraceGetStats(i,stats);
+		PfxUInt32 indent = SCE_PFX_MIN(s_names[i].depth,16u) * 2;
+		SCE_PFX_PRINTF(" -- %*s%s last %.3fms min %.3fms avg %.3fms p99 %.3fms (%u calls, %u frames)\n",
+			indent,"",stats.name,stats.lastMs,stats.minMs,stats.avgMs,stats.p99Ms,stats.numCalls,stats.numFrames);
+	}
+
+	PfxUInt32 numDropped = 0;
+	PfxUInt32 numThreads = pfxPerfTraceGetNumThreads();
+	for(PfxUInt32 t=0;t<numThreads;t++) {
+		numDropped += s_threads[t].numDropped;
+	}
+	if(numDropped > 0) {
+		SCE_PFX_PRINTF(" -- %u events dropped (SCE_PFX_PERF_TRACE_MAX_EVENTS %u)\n",numDropped,SCE_PFX_PERF_TRACE_MAX_EVENTS);
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Export
+
+static void pfxPerfTraceWriteString(FILE *fp,const char *str)
+{
+	for(const char *c=str;*c;c++) {
+		if(*c == '"' || *c == '\\') {
+			fprintf(fp,"\\%c",*c);
+		}
+		else if((unsigned char)*c < 0x20) {
+			fprintf(fp,"\\u%04x",(unsigned int)(unsigned char)*c);
+		}
+		else {
+			fputc(*c,fp);
+		}
+	}
+}
+
+PfxInt32 pfxPerfTraceExportChromeJson(const char *filename)
+{
+	if(!filename) return SCE_PFX_ERR_INVALID_VALUE;
+
+	FILE *fp = fopen(filename,"w");
+	if(!fp) return SCE_PFX_ERR_INVALID_VALUE;
+
+	PfxUInt32 numThreads = pfxPerfTraceGetNumThreads();
+
+	//J タイムスタンプは最初のイベントからの相対時間（マイクロ秒）
+	//E Timestamps are in microseconds relative to the first event
+	PfxUInt64 origin = 0;
+	bool hasOrigin = false;
+	for(PfxUInt32 t=0;t<numThreads;t++) {
+		PfxPerfTraceThread &thread = s_threads[t];
+		if(!thread.events || thread.numEvents == 0) continue;
+		if(!hasOrigin || thread.events[0].begin < origin) {
+			origin = thread.events[0].begin;
+			hasOrigin = true;
+		}
+	}
+
+	double usPerTick = 1.0e6 / (double)pfxPerfGetTicksPerSecond();
+
+	fprintf(fp,"{\"traceEvents\":[\n");
+
+	bool first = true;
+	for(PfxUInt32 t=0;t<numThreads;t++) {
+		PfxPerfTraceThread &thread = s_threads[t];
+		if(!thread.events) continue;
+
+		fprintf(fp,"%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":%u,\"args\":{\"name\":\"thread %u\"}}",
+			first?"":",\n",t,t);
+		first = false;
+
+		PfxUInt32 numEvents = thread.numEvents;
+		for(PfxUInt32 e=0;e<numEvents;e++) {
+			const PfxPerfTraceEvent &ev = thread.events[e];
+			if(ev.end == 0) continue;
+			fprintf(fp,",\n{\"name\":\"");
+			pfxPerfTraceWriteString(fp,ev.name);
+			fprintf(fp,"\",\"cat\":\"pfx\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":0,\"tid\":%u}",
+				(double)(ev.begin-origin)*usPerTick,(double)(ev.end-ev.begin)*usPerTick,t);
+		}
+	}
+
+	fprintf(fp,"\n],\"displayTimeUnit\":\"ms\"}\n");
+
+	PfxInt32 ret = ferror(fp) ? SCE_PFX_ERR_OUT_OF_BUFFER : SCE_PFX_OK;
+	fclose(fp);
+
+	return ret;
+}
+
+void pfxPerfTraceReset()
+{
+	PfxUInt32 numThreads = pfxPerfTraceGetNumThreads();
+	for(PfxUInt32 t=0;t<numThreads;t++) {
+		PfxPerfTraceThread &thread = s_threads[t];
+		if(!thread.events) continue;
+		thread.numEvents = 0;
+		thread.numDropped = 0;
+		thread.frameStart = 0;
+
+		//J 開いているスコープは記録済みのイベントを参照しないようにする
+		//E Open scopes must not refer to discarded events
+		PfxUInt32 depth = SCE_PFX_MIN(thread.depth,(PfxUInt32)SCE_PFX_PERF_TRACE_MAX_DEPTH);
+		for(PfxUInt32 d=0;d<depth;d++) {
+			thread.stack[d] = SCE_PFX_PERF_TRACE_INVALID_EVENT;
+		}
+	}
+
+	s_numNames = 0;
+}
+
+} //namespace PhysicsEffects
+} //namespace sce
@@ -0,0 +1,137 @@
+/*
+Physics Effects Copyright(C) 2011 Sony Computer Entertainment Inc.
+All rights reserved.
+
+Physics Effects is open software; you can redistribute it and/or
+modify it under the terms of the BSD License.
+
+Physics Effects is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+See the BSD License for more details.
+
+A copy of the BSD License is distributed with
+Physics Effects under the filename: physics_effects_license.txt
+*/
+
+#ifndef _SCE_PFX_PERF_TRACE_H
+#define _SCE_PFX_PERF_TRACE_H
+
+#include "pfx_common.h"
+
+#if !defined(_WIN32)
+	#include <time.h>
+	#if defined(SCE_PFX_PERF_USE_RDTSC) && (defined(__i386__) || defined(__x86_64__))
+		#include <x86intrin.h>
+	#endif
+#endif
+
+//J 階層プロファイラ
+//J スレッドごとのバッファにスコープを記録し、フレームごとの統計（最小/平均/99パーセンタイル）と
+//J Chromeトレース形式(chrome://tracing)のJSON出力を提供する
+//J SCE_PFX_PERF_USE_RDTSCを定義するとx86ではclock_gettimeの代わりにrdtscを使用する
+
+//E Hierarchical profiler
+//E Scopes are recorded into per-thread buffers. Provides per-frame rolling statistics
+//E (min/avg/p99) and export to Chrome trace JSON (chrome://tracing)
+//E Define SCE_PFX_PERF_USE_RDTSC to use rdtsc instead of clock_gettime on x86
+
+#ifndef SCE_PFX_PERF_TRACE_MAX_THREADS
+#define SCE_PFX_PERF_TRACE_MAX_THREADS	32
+#endif
+
+#ifndef SCE_PFX_PERF_TRACE_MAX_EVENTS
+#define SCE_PFX_PERF_TRACE_MAX_EVENTS	65536
+#endif
+
+#ifndef SCE_PFX_PERF_TRACE_MAX_DEPTH
+#define SCE_PFX_PERF_TRACE_MAX_DEPTH	32
+#endif
+
+#ifndef SCE_PFX_PERF_TRACE_MAX_NAMES
+#define SCE_PFX_PERF_TRACE_MAX_NAMES	128
+#endif
+
+#ifndef SCE_PFX_PERF_TRACE_WINDOW
+#define SCE_PFX_PERF_TRACE_WINDOW		120
+#endif
+
+namespace sce {
+namespace PhysicsEffects {
+
+///////////////////////////////////////////////////////////////////////////////
+// Timer
+
+//J 現在のタイマー値を返す
+//E Returns the current timer value
+static SCE_PFX_FORCE_INLINE
+PfxUInt64 pfxPerfGetTicks()
+{
+#if defined(_WIN32)
+	LARGE_INTEGER cnt;
+	QueryPerformanceCounter(&cnt);
+	return (PfxUInt64)cnt.QuadPart;
+#elif defined(SCE_PFX_PERF_USE_RDTSC) && (defined(__i386__) || defined(__x86_64__))
+	return (PfxUInt64)__rdtsc();
+#else
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC,&ts);
+	return (PfxUInt64)ts.tv_sec * 1000000000ull + (PfxUInt64)ts.tv_nsec;
+#endif
+}
+
+//J 1秒あたりのタイマー値（rdtscの場合は初回呼び出し時に測定する）
+//E Timer ticks per second (measured on the first call when rdtsc is used)
+PfxUInt64 pfxPerfGetTicksPerSecond();
+
+///////////////////////////////////////////////////////////////////////////////
+// Trace
+
+struct PfxPerfTraceStats {
+	const char *name;
+	PfxUInt32 numFrames; // Number of frames in the window
+	PfxUInt32 numCalls;  // Number of calls in the last frame
+	PfxFloat  lastMs;    // Total time in the last frame
+	PfxFloat  minMs;     // Minimum total time per frame in the window
+	PfxFloat  avgMs;     // Average total time per frame in the window
+	PfxFloat  p99Ms;     // 99th percentile total time per frame in the window
+};
+
+//J 記録の開始/停止（初期状態は有効）
+//E Starts or stops recording (enabled by default)
+void pfxPerfTraceEnable(bool enable);
+
+//J スコープの開始と終了
+//J nameはトレースを出力するまで有効な文字列であること
+//E Begins and ends a scope
+//E name must stay valid until the trace is exported
+void pfxPerfTracePush(const char *name);
+void pfxPerfTracePop();
+
+//J フレームの区切り
+//J フレーム終了時に各スコープの合計時間を統計に加える
+//J ワーカースレッドが記録していないときに呼ぶこと
+//E Frame boundaries
+//E The total time of each scope is added to the statistics at the end of a frame
+//E Call them while worker threads are not recording
+void pfxPerfTraceBeginFrame();
+void pfxPerfTraceEndFrame();
+
+//J 統計の取得と表示
+//E Gets and prints statistics
+PfxUInt32 pfxPerfTraceGetNumStats();
+PfxInt32 pfxPerfTraceGetStats(PfxUInt32 i,PfxPerfTraceStats &stats);
+void pfxPerfTracePrintStats();
+
+//J 記録したイベントをChromeトレース形式のJSONで出力する
+//E Writes recorded events as Chrome trace JSON
+PfxInt32 pfxPerfTraceExportChromeJson(const char *filename);
+
+//J 記録したイベントと統計を破棄する
+//E Discards recorded events and statistics
+void pfxPerfTraceReset();
+
+} //namespace PhysicsEffects
+} //namespace sce
+
+#endif // _SCE_PFX_PERF_TRACE_H
@@ -0,0 +1,151 @@
+/*
+Physics Effects Copyright(C) 2011 Sony Computer Entertainment Inc.
+All rights reserved.
+
+Physics Effects is open software; you can redistribute it and/or
+modify it under the terms of the BSD License.
+
+Physics Effects is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+See the BSD License for more details.
+
+A copy of the BSD License is distributed with
+Physics Effects under the filename: physics_effects_license.txt
+*/
+
+#ifndef _SCE_PFX_VEC_FLOAT4_H
+#define _SCE_PFX_VEC_FLOAT4_H
+
+#include "pfx_common.h"
+
+//J SSEが使える環境ではSSE命令で、それ以外ではスカラー演算で実装する
+//J SCE_PFX_DISABLE_SSEを定義するとスカラー演算を使用する
+//E Implemented with SSE instructions where available, otherwise with scalar operations
+//E Define SCE_PFX_DISABLE_SSE to force the scalar implementation
+#if !defined(SCE_PFX_DISABLE_SSE) && (defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1))
+	#define SCE_PFX_USE_SSE
+	#include <xmmintrin.h>
+#endif
+
+namespace sce {
+namespace PhysicsEffects {
+
+///////////////////////////////////////////////////////////////////////////////
+// PfxFloat4
+
+//J 4つの浮動小数点数をまとめて演算する（SoA形式の計算用）
+//J 比較関数は各要素の全ビットが立ったマスクを返す
+//J 各演算はスカラーの同じ式と同じ結果になる（min/maxの選択規則もvectormathと同じ）
+
+//E Four floats processed together (for SoA computations)
+//E Comparisons return masks with all bits of each element set
+//E Every operation gives the same result as the equivalent scalar expression
+//E (min / max select in the same way as vectormath)
+
+#ifdef SCE_PFX_USE_SSE
+
+struct PfxFloat4 {
+	__m128 m_v;
+
+	PfxFloat4() {}
+	PfxFloat4(__m128 v) : m_v(v) {}
+	explicit PfxFloat4(PfxFloat f) : m_v(_mm_set1_ps(f)) {}
+	PfxFloat4(PfxFloat f0,PfxFloat f1,PfxFloat f2,PfxFloat f3) : m_v(_mm_setr_ps(f0,f1,f2,f3)) {}
+
+	PfxFloat get(int i) const {SCE_PFX_ALIGNED(16) PfxFloat f[4];_mm_store_ps(f,m_v);return f[i];}
+	void store(PfxFloat *f) const {_mm_storeu_ps(f,m_v);}
+};
+
+static SCE_PFX_FORCE_INLINE PfxFloat4 operator +(const PfxFloat4 &a,const PfxFloat4 &b) {return _mm_add_ps(a.m_v,b.m_v);}
+static SCE_PFX_FORCE_INLINE PfxFloat4 operator -(const PfxFloat4 &a,const PfxFloat4 &b) {return _mm_sub_ps(a.m_v,b.m_v);}
+static SCE_PFX_FORCE_INLINE PfxFloat4 operator *(const PfxFloat4 &a,const PfxFloat4 &b) {return _mm_mul_ps(a.m_v,b.m_v);}
+static SCE_PFX_FORCE_INLINE PfxFloat4 operator /(const PfxFloat4 &a,const PfxFloat4 &b) {return _mm_div_ps(a.m_v,b.m_v);}
+static SCE_PFX_FORCE_INLINE PfxFloat4 operator -(const PfxFloat4 &a) {return _mm_xor_ps(a.m_v,_mm_set1_ps(-0.0f));}
+
+static SCE_PFX_FORCE_INLINE PfxFloat4 pfxMinPerElem(const PfxFloat4 &a,const PfxFloat4 &b) {return _mm_min_ps(a.m_v,b.m_v);}
+static SCE_PFX_FORCE_INLINE PfxFloat4 pfxMaxPerElem(const PfxFloat4 &a,const PfxFloat4 &b) {return _mm_max_ps(a.m_v,b.m_v);}
+static SCE_PFX_FORCE_INLINE PfxFloat4 pfxAbsPerElem(const PfxFloat4 &a) {return _mm_andnot_ps(_mm_set1_ps(-0.0f),a.m_v);}
+static SCE_PFX_FORCE_INLINE PfxFloat4 pfxSqrtPerElem(const PfxFloat4 &a) {return _mm_sqrt_ps(a.m_v);}
+
+static SCE_PFX_FORCE_INLINE PfxFloat4 pfxCmpLt(const PfxFloat4 &a,const PfxFloat4 &b) {return _mm_cmplt_ps(a.m_v,b.m_v);}
+static SCE_PFX_FORCE_INLINE PfxFloat4 pfxCmpLe(const PfxFloat4 &a,const PfxFloat4 &b) {return _mm_cmple_ps(a.m_v,b.m_v);}
+static SCE_PFX_FORCE_INLINE PfxFloat4 pfxCmpGt(const PfxFloat4 &a,const PfxFloat4 &b) {return _mm_cmpgt_ps(a.m_v,b.m_v);}
+
+static SCE_PFX_FORCE_INLINE PfxFloat4 pfxAnd(const PfxFloat4 &a,const PfxFloat4 &b) {return _mm_and_ps(a.m_v,b.m_v);}
+static SCE_PFX_FORCE_INLINE PfxFloat4 pfxOr(const PfxFloat4 &a,const PfxFloat4 &b) {return _mm_or_ps(a.m_v,b.m_v);}
+
+// (a & ~mask) | (b & mask)
+static SCE_PFX_FORCE_INLINE PfxFloat4 pfxSelect(const PfxFloat4 &a,const PfxFloat4 &b,const PfxFloat4 &mask) {return _mm_or_ps(_mm_andnot_ps(mask.m_v,a.m_v),_mm_and_ps(mask.m_v,b.m_v));}
+
+//J マスクの各要素の最上位ビットを4ビットの整数にまとめる
+//E Gathers the most significant bit of each element into a 4 bit integer
+static SCE_PFX_FORCE_INLINE PfxUInt32 pfxMoveMask(const PfxFloat4 &mask) {return (PfxUInt32)_mm_movemask_ps(mask.m_v);}
+
+#else // SCE_PFX_USE_SSE
+
+struct PfxFloat4 {
+	PfxFloat m_v[4];
+
+	PfxFloat4() {}
+	explicit PfxFloat4(PfxFloat f) {m_v[0]=m_v[1]=m_v[2]=m_v[3]=f;}
+	PfxFloat4(PfxFloat f0,PfxFloat f1,PfxFloat f2,PfxFloat f3) {m_v[0]=f0;m_v[1]=f1;m_v[2]=f2;m_v[3]=f3;}
+
+	PfxFloat get(int i) const {return m_v[i];}
+	void store(PfxFloat *f) const {f[0]=m_v[0];f[1]=m_v[1];f[2]=m_v[2];f[3]=m_v[3];}
+};
+
+union PfxFloat4Bits {
+	PfxFloat f;
+	PfxUInt32 u;
+};
+
+static SCE_PFX_FORCE_INLINE PfxFloat pfxMaskToFloat(bool b) {PfxFloat4Bits t;t.u=b?0xffffffff:0;return t.f;}
+static SCE_PFX_FORCE_INLINE PfxUInt32 pfxFloatToBits(PfxFloat f) {PfxFloat4Bits t;t.f=f;return t.u;}
+static SCE_PFX_FORCE_INLINE PfxFloat pfxBitsToFloat(PfxUInt32 u) {PfxFloat4Bits t;t.u=u;return t.f;}
+
+#define SCE_PFX_FLOAT4_OP(expr) \
+	PfxFloat4 r;\
+	for(int i=0;i<4;i++) {r.m_v[i] = (expr);}\
+	return r;
+
+static SCE_PFX_FORCE_INLINE PfxFloat4 operator +(const PfxFloat4 &a,const PfxFloat4 &b) {SCE_PFX_FLOAT4_OP(a.m_v[i]+b.m_v[i])}
+static SCE_PFX_FORCE_INLINE PfxFloat4 operator -(const PfxFloat4 &a,const PfxFloat4 &b) {SCE_PFX_FLOAT4_OP(a.m_v[i]-b.m_v[i])}
+static SCE_PFX_FORCE_INLINE PfxFloat4 operator *(const PfxFloat4 &a,const PfxFloat4 &b) {SCE_PFX_FLOAT4_OP(a.m_v[i]*b.m_v[i])}
+static SCE_PFX_FORCE_INLINE PfxFloat4 operator /(const PfxFloat4 &a,const PfxFloat4 &b) {SCE_PFX_FLOAT4_OP(a.m_v[i]/b.m_v[i])}
+static SCE_PFX_FORCE_INLINE PfxFloat4 operator -(const PfxFloat4 &a) {SCE_PFX_FLOAT4_OP(-a.m_v[i])}
+
+static SCE_PFX_FORCE_INLINE PfxFloat4 pfxMinPerElem(const PfxFloat4 &a,const PfxFloat4 &b) {SCE_PFX_FLOAT4_OP(a.m_v[i]<b.m_v[i]?a.m_v[i]:b.m_v[i])}
+static SCE_PFX_FORCE_INLINE PfxFloat4 pfxMaxPerElem(const PfxFloat4 &a,const PfxFloat4 &b) {SCE_PFX_FLOAT4_OP(a.m_v[i]>b.m_v[i]?a.m_v[i]:b.m_v[i])}
+static SCE_PFX_FORCE_INLINE PfxFloat4 pfxAbsPerElem(const PfxFloat4 &a) {SCE_PFX_FLOAT4_OP(fabsf(a.m_v[i]))}
+static SCE_PFX_FORCE_INLINE PfxFloat4 pfxSqrtPerElem(const PfxFloat4 &a) {SCE_PFX_FLOAT4_OP(sqrtf(a.m_v[i]))}
+
+static SCE_PFX_FORCE_INLINE PfxFloat4 pfxCmpLt(const PfxFloat4 &a,const PfxFloat4 &b) {SCE_PFX_FLOAT4_OP(pfxMaskToFloat(a.m_v[i]<b.m_v[i]))}
+static SCE_PFX_FORCE_INLINE PfxFloat4 pfxCmpLe(const PfxFloat4 &a,const PfxFloat4 &b) {SCE_PFX_FLOAT4_OP(pfxMaskToFloat(a.m_v[i]<=b.m_v[i]))}
+static SCE_PFX_FORCE_INLINE PfxFloat4 pfxCmpGt(const PfxFloat4 &a,const PfxFloat4 &b) {SCE_PFX_FLOAT4_OP(pfxMaskToFloat(a.m_v[i]>b.m_v[i]))}
+
+static SCE_PFX_FORCE_INLINE PfxFloat4 pfxAnd(const PfxFloat4 &a,const PfxFloat4 &b) {SCE_PFX_FLOAT4_OP(pfxBitsToFloat(pfxFloatToBits(a.m_v[i])&pfxFloatToBits(b.m_v[i])))}
+static SCE_PFX_FORCE_INLINE PfxFloat4 pfxOr(const PfxFloat4 &a,const PfxFloat4 &b) {SCE_PFX_FLOAT4_OP(pfxBitsToFloat(pfxFloatToBits(a.m_v[i])|pfxFloatToBits(b.m_v[i])))}
+
+// (a & ~mask) | (b & mask)
+static SCE_PFX_FORCE_INLINE PfxFloat4 pfxSelect(const PfxFloat4 &a,const PfxFloat4 &b,const PfxFloat4 &mask) {SCE_PFX_FLOAT4_OP(pfxFloatToBits(mask.m_v[i])?b.m_v[i]:a.m_v[i])}
+
+//J マスクの各要素の最上位ビットを4ビットの整数にまとめる
+//E Gathers the most significant bit of each element into a 4 bit integer
+static SCE_PFX_FORCE_INLINE PfxUInt32 pfxMoveMask(const PfxFloat4 &mask)
+{
+	PfxUInt32 bits = 0;
+	for(int i=0;i<4;i++) {
+		bits |= (pfxFloatToBits(mask.m_v[i])>>31)<<i;
+	}
+	return bits;
+}
+
+#undef SCE_PFX_FLOAT4_OP
+
+#endif // SCE_PFX_USE_SSE
+
+} //namespace PhysicsEffects
+} //namespace sce
+
+#endif // _SCE_PFX_VEC_FLOAT4_H
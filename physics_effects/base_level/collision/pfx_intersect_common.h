@@ -18,6 +18,7 @@ Physics Effects under the filename: physics_effects_license.txt
 #define _SCE_PFX_INTERSECT_COMMON_H
 
 #include "base_level/collision/pfx_ray.h"
+#include "base_level/collision/pfx_ray_packet.h"
 
 namespace sce {
 namespace PhysicsEffects {
@@ -126,6 +127,46 @@ else {
 	return true;
 }
 
+// pfxIntersectRayAABBFastと同じ計算をレイパケットの4本に対して行う
+// 交差しないレーンのマスクを返す（tminは各軸のスラブに入る時刻）
+static SCE_PFX_FORCE_INLINE
+PfxFloat4 pfxIntersectRayPacketAABBFast(
+	const PfxFloat4 *rayStartPosition,
+	const PfxFloat4 *rayDirection,
+	const PfxVector3 &AABBmin,
+	const PfxVector3 &AABBmax,
+	PfxFloat4 *tmin,
+	PfxFloat4 &variable)
+{
+	const PfxFloat4 zero(0.0f);
+	const PfxFloat4 epsilon(SCE_PFX_INTERSECT_COMMON_EPSILON);
+	
+	PfxFloat4 reject = pfxCmpLt(zero,zero);
+	PfxFloat4 tmax[3];
+	for(int k=0;k<3;k++) {
+		PfxFloat4 bmin(AABBmin[k]),bmax(AABBmax[k]);
+		PfxFloat4 parallel = pfxCmpLt(pfxAbsPerElem(rayDirection[k]),epsilon);
+		reject = pfxOr(reject,pfxAnd(parallel,pfxOr(pfxCmpLt(rayStartPosition[k],bmin),pfxCmpGt(rayStartPosition[k],bmax))));
+		PfxFloat4 dir = pfxSelect(rayDirection[k],pfxSelect(epsilon,-epsilon,pfxCmpLt(rayDirection[k],zero)),parallel);
+		
+		PfxFloat4 t1 = (bmin - rayStartPosition[k]) / dir;
+		PfxFloat4 t2 = (bmax - rayStartPosition[k]) / dir;
+		tmin[k] = pfxMinPerElem(t1,t2);
+		tmax[k] = pfxMaxPerElem(t1,t2);
+	}
+	
+	PfxFloat4 maxTmin = pfxMaxPerElem(tmin[2],pfxMaxPerElem(tmin[0],tmin[1]));
+	PfxFloat4 minTmax = pfxMinPerElem(tmax[2],pfxMinPerElem(tmax[0],tmax[1]));
+	reject = pfxOr(reject,pfxCmpGt(maxTmin,minTmax));
+	
+	variable = pfxSelect(
+		pfxSelect(tmin[2],tmin[1],pfxCmpGt(tmin[1],tmin[2])),
+		pfxSelect(tmin[2],tmin[0],pfxCmpGt(tmin[0],tmin[2])),
+		pfxCmpGt(tmin[0],tmin[1]));
+	
+	return reject;
+}
+
 static SCE_PFX_FORCE_INLINE
 PfxBool pfxIntersectRayAABB(
 	const PfxVector3 &rayStartPosition,
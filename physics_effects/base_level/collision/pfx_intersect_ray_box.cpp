@@ -43,5 +43,67 @@ PfxBool pfxIntersectRayBox(const PfxRayInput &ray,PfxRayOutput &out,const PfxBox
 	
 	return false;
 }
+
+PfxUInt32 pfxIntersectRayPacketBox(const PfxRayPacket &packet,PfxUInt32 laneMask,PfxRayOutput *out,const PfxBox &box,const PfxTransform3 &transform)
+{
+	// レイをBoxのローカル座標へ変換
+	PfxTransform3 transformBox = orthoInverse(transform);
+	const PfxMatrix3 rot = transformBox.getUpper3x3();
+	const PfxVector3 pos = transformBox.getTranslation();
+
+	PfxFloat4 start[3],dir[3];
+	for(int k=0;k<3;k++) {
+		PfxFloat4 c0(rot.getCol0()[k]),c1(rot.getCol1()[k]),c2(rot.getCol2()[k]);
+		start[k] = c0 * packet.m_startPosition[0] + c1 * packet.m_startPosition[1] + c2 * packet.m_startPosition[2] + PfxFloat4(pos[k]);
+		dir[k] = c0 * packet.m_direction[0] + c1 * packet.m_direction[1] + c2 * packet.m_direction[2];
+	}
+
+	// pfxIntersectRayAABBと同じ計算を4本同時に行う
+	const PfxVector3 AABBmin = PfxVector3(0.0f) - box.m_half;
+	const PfxVector3 AABBmax = PfxVector3(0.0f) + box.m_half;
+	const PfxFloat4 zero(0.0f);
+
+	// 始点がBoxの内側にあるか判定
+	PfxFloat4 inside = pfxCmpLe(zero,zero);
+	for(int k=0;k<3;k++) {
+		inside = pfxAnd(inside,pfxAnd(pfxCmpLt(PfxFloat4(AABBmin[k]),start[k]),pfxCmpLt(start[k],PfxFloat4(AABBmax[k]))));
+	}
+
+	PfxFloat4 tmin[3],tt;
+	PfxFloat4 reject = pfxOr(inside,pfxIntersectRayPacketAABBFast(start,dir,AABBmin,AABBmax,tmin,tt));
+
+	PfxFloat4 variable(out[0].m_variable,out[1].m_variable,out[2].m_variable,out[3].m_variable);
+	PfxUInt32 hitMask = laneMask & pfxMoveMask(pfxAnd(pfxCmpGt(tt,zero),pfxCmpLt(tt,variable))) & ~pfxMoveMask(reject);
+	if(!hitMask) return 0;
+
+	PfxFloat t[4];
+	tt.store(t);
+	PfxUInt32 maskC01 = pfxMoveMask(pfxCmpGt(tmin[0],tmin[1]));
+	PfxUInt32 maskC02 = pfxMoveMask(pfxCmpGt(tmin[0],tmin[2]));
+	PfxUInt32 maskC12 = pfxMoveMask(pfxCmpGt(tmin[1],tmin[2]));
+	PfxUInt32 maskNegative[3] = {
+		pfxMoveMask(pfxCmpLt(dir[0],zero)),
+		pfxMoveMask(pfxCmpLt(dir[1],zero)),
+		pfxMoveMask(pfxCmpLt(dir[2],zero)),
+	};
+
+	for(PfxUInt32 i=0;i<SCE_PFX_RAY_PACKET_SIZE;i++) {
+		PfxUInt32 lane = 1<<i;
+		if(!(hitMask & lane)) continue;
+
+		int axis = (maskC01 & lane) ? ((maskC02 & lane) ? 0 : 2) : ((maskC12 & lane) ? 1 : 2);
+		PfxVector3 normal(0.0f);
+		normal[axis] = (maskNegative[axis] & lane) ? 1.0f : -1.0f;
+
+		const PfxRayInput &ray = *packet.m_rays[i];
+		out[i].m_contactFlag = true;
+		out[i].m_variable = t[i];
+		out[i].m_contactPoint = ray.m_startPosition + t[i] * ray.m_direction;
+		out[i].m_contactNormal = transform.getUpper3x3() * normal;
+		out[i].m_subData.m_type = PfxSubData::NONE;
+	}
+
+	return hitMask;
+}
 } //namespace PhysicsEffects
 } //namespace sce
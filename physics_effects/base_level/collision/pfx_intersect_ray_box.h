@@ -18,6 +18,7 @@ Physics Effects under the filename: physics_effects_license.txt
 #define _SCE_PFX_INTERSECT_RAYBOX_H
 
 #include "base_level/collision/pfx_ray.h"
+#include "base_level/collision/pfx_ray_packet.h"
 #include "base_level/collision/pfx_box.h"
 
 namespace sce {
@@ -25,6 +26,8 @@ namespace PhysicsEffects {
 
 PfxBool pfxIntersectRayBox(const PfxRayInput &ray,PfxRayOutput &out,const PfxBox &box,const PfxTransform3 &transform);
 
+PfxUInt32 pfxIntersectRayPacketBox(const PfxRayPacket &packet,PfxUInt32 laneMask,PfxRayOutput *out,const PfxBox &box,const PfxTransform3 &transform);
+
 } //namespace PhysicsEffects
 } //namespace sce
 
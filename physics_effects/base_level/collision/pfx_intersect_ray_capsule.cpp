@@ -132,5 +132,46 @@ PfxBool pfxIntersectRayCapsule(const PfxRayInput &ray,PfxRayOutput &out,const Pf
 	
 	return false;
 }
+
+PfxUInt32 pfxIntersectRayPacketCapsule(const PfxRayPacket &packet,PfxUInt32 laneMask,PfxRayOutput *out,const PfxCapsule &capsule,const PfxTransform3 &transform)
+{
+	// レイをCapsuleのローカル座標へ変換
+	PfxTransform3 transformCapsule = orthoInverse(transform);
+	const PfxMatrix3 rot = transformCapsule.getUpper3x3();
+	const PfxVector3 pos = transformCapsule.getTranslation();
+
+	PfxFloat4 startPosL[3],rayDirL[3];
+	for(int k=0;k<3;k++) {
+		PfxFloat4 c0(rot.getCol0()[k]),c1(rot.getCol1()[k]),c2(rot.getCol2()[k]);
+		startPosL[k] = c0 * packet.m_startPosition[0] + c1 * packet.m_startPosition[1] + c2 * packet.m_startPosition[2] + PfxFloat4(pos[k]);
+		rayDirL[k] = c0 * packet.m_direction[0] + c1 * packet.m_direction[1] + c2 * packet.m_direction[2];
+	}
+
+	PfxFloat4 radSqr(capsule.m_radius * capsule.m_radius);
+
+	// 始点がカプセルの内側にあるか判定
+	PfxFloat4 variable(out[0].m_variable,out[1].m_variable,out[2].m_variable,out[3].m_variable);
+	PfxFloat4 px = startPosL[0] - variable;
+	PfxFloat4 sqrLen = px * px + startPosL[1] * startPosL[1] + startPosL[2] * startPosL[2];
+	PfxFloat4 reject = pfxCmpLe(sqrLen,radSqr);
+
+	// 無限長の円柱と交差しないレイは両端の球とも交差しない
+	PfxFloat4 a = rayDirL[1] * rayDirL[1] + rayDirL[2] * rayDirL[2];
+	PfxFloat4 b = startPosL[1] * rayDirL[1] + startPosL[2] * rayDirL[2];
+	PfxFloat4 c = (startPosL[1] * startPosL[1] + startPosL[2] * startPosL[2]) - radSqr;
+	PfxFloat4 d = b * b - a * c;
+	reject = pfxOr(reject,pfxOr(pfxCmpLt(d,PfxFloat4(0.0f)),pfxCmpLt(pfxAbsPerElem(a),PfxFloat4(0.00001f))));
+
+	PfxUInt32 testMask = laneMask & ~pfxMoveMask(reject);
+	PfxUInt32 hitMask = 0;
+
+	for(PfxUInt32 i=0;i<SCE_PFX_RAY_PACKET_SIZE;i++) {
+		if((testMask & (1<<i)) && pfxIntersectRayCapsule(*packet.m_rays[i],out[i],capsule,transform)) {
+			hitMask |= 1<<i;
+		}
+	}
+
+	return hitMask;
+}
 } //namespace PhysicsEffects
 } //namespace sce
@@ -18,6 +18,7 @@ Physics Effects under the filename: physics_effects_license.txt
 #define _SCE_PFX_INTERSECT_RAYCAPSULE_H
 
 #include "base_level/collision/pfx_ray.h"
+#include "base_level/collision/pfx_ray_packet.h"
 #include "base_level/collision/pfx_capsule.h"
 
 namespace sce {
@@ -25,6 +26,10 @@ namespace PhysicsEffects {
 
 PfxBool pfxIntersectRayCapsule(const PfxRayInput &ray,PfxRayOutput &out,const PfxCapsule &capsule,const PfxTransform3 &transform);
 
+//J 4本のレイを同時にカリングし、残ったレイのみpfxIntersectRayCapsuleで判定する
+//E Culls 4 rays at once and tests only the remaining rays with pfxIntersectRayCapsule
+PfxUInt32 pfxIntersectRayPacketCapsule(const PfxRayPacket &packet,PfxUInt32 laneMask,PfxRayOutput *out,const PfxCapsule &capsule,const PfxTransform3 &transform);
+
 } //namespace PhysicsEffects
 } //namespace sce
 
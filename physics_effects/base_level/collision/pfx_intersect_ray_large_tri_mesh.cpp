@@ -98,6 +98,54 @@ PfxBool pfxIntersectRayTriMesh(const PfxTriMesh &mesh,const PfxVector3 &rayStart
 	return ret;
 }
 
+//J 量子化AABBとレイの交差判定（variableより遠い場合は交差しない）
+//E Intersection test of a ray and a quantized AABB (no intersection if it's farther than variable)
+static SCE_PFX_FORCE_INLINE
+PfxBool pfxIntersectRayQuantizedAABB(const PfxLargeTriMesh &largeMesh,const PfxAabb16 &aabbB,
+	const PfxVector3 &rayStart,const PfxVector3 &rayDir,PfxFloat variable)
+{
+	PfxVector3 aabbMin,aabbMax;
+	aabbMin = largeMesh.getWorldPosition(PfxVecInt3((PfxFloat)pfxGetXMin(aabbB),(PfxFloat)pfxGetYMin(aabbB),(PfxFloat)pfxGetZMin(aabbB)));
+	aabbMax = largeMesh.getWorldPosition(PfxVecInt3((PfxFloat)pfxGetXMax(aabbB),(PfxFloat)pfxGetYMax(aabbB),(PfxFloat)pfxGetZMax(aabbB)));
+
+	PfxFloat tmpVariable = 1.0f;
+
+	if( !pfxIntersectRayAABBFast(
+		rayStart,rayDir,
+		(aabbMax+aabbMin)*0.5f,
+		(aabbMax-aabbMin)*0.5f,
+		tmpVariable) )
+		return false;
+	
+	return tmpVariable < variable;
+}
+
+static SCE_PFX_FORCE_INLINE
+PfxBool pfxIntersectRayIsland(const PfxLargeTriMesh &largeMesh,PfxUInt32 islandId,
+	const PfxRayInput &ray,PfxRayOutput &out,const PfxTransform3 &transform,
+	const PfxVector3 &rayStartPosition,const PfxVector3 &rayDirection)
+{
+	// アイランドとの交差チェック
+	const PfxTriMesh *island = &largeMesh.m_islands[islandId];
+	
+	PfxSubData subData;
+	PfxVector3 tmpNormal;
+	PfxFloat tmpVariable = out.m_variable;
+
+	if( pfxIntersectRayTriMesh(*island,rayStartPosition,rayDirection,ray.m_facetMode,tmpVariable,tmpNormal,subData) &&
+		tmpVariable < out.m_variable ) {
+		out.m_contactFlag = true;
+		out.m_variable = tmpVariable;
+		out.m_contactPoint = ray.m_startPosition + tmpVariable * ray.m_direction;
+		out.m_contactNormal = transform.getUpper3x3() * tmpNormal;
+		subData.setIslandId(islandId);
+		out.m_subData = subData;
+		return true;
+	}
+	
+	return false;
+}
+
 PfxBool pfxIntersectRayLargeTriMesh(const PfxRayInput &ray,PfxRayOutput &out,const void *shape,const PfxTransform3 &transform)
 {
 	PfxBool ret = false;
@@ -117,49 +165,38 @@ PfxBool pfxIntersectRayLargeTriMesh(const PfxRayInput &ray,PfxRayOutput &out,con
 	aabbMinL = minPerElem(s,e);
 	aabbMaxL = maxPerElem(s,e);
 	
-	PfxUInt32 numIslands = largeMesh.m_numIslands;
-	
-	{
-	for(PfxUInt32 i=0;i<numIslands;i++) {
-		PfxAabb16 aabbB = largeMesh.m_aabbList[i];
-		if(aabbMaxL.getX() < pfxGetXMin(aabbB) || aabbMinL.getX() > pfxGetXMax(aabbB)) continue;
-		if(aabbMaxL.getY() < pfxGetYMin(aabbB) || aabbMinL.getY() > pfxGetYMax(aabbB)) continue;
-		if(aabbMaxL.getZ() < pfxGetZMin(aabbB) || aabbMinL.getZ() > pfxGetZMax(aabbB)) continue;
-		// Todo:早期終了チェック
-
-			PfxVector3 aabbMin,aabbMax;
-			aabbMin = largeMesh.getWorldPosition(PfxVecInt3((PfxFloat)pfxGetXMin(aabbB),(PfxFloat)pfxGetYMin(aabbB),(PfxFloat)pfxGetZMin(aabbB)));
-			aabbMax = largeMesh.getWorldPosition(PfxVecInt3((PfxFloat)pfxGetXMax(aabbB),(PfxFloat)pfxGetYMax(aabbB),(PfxFloat)pfxGetZMax(aabbB)));
-
-			PfxFloat tmpVariable = 1.0f;
-			PfxVector3 tmpNormal;
-
-			if( !pfxIntersectRayAABBFast(
-				rayStartPosition,rayDirection,
-				(aabbMax+aabbMin)*0.5f,
-				(aabbMax-aabbMin)*0.5f,
-				tmpVariable) )
-				continue;
+	if(largeMesh.m_bvhNodes) {
+		//J 階層を辿り、リーフのアイランドのみ判定する
+		//J ノードのAABBもレイで判定し、既に見つかった交差点より遠いノードは飛ばす
+		//E Traverse the hierarchy and test islands only at leaves
+		//E Nodes are also tested with the ray, and skipped if they are farther than the found intersection
+		PfxUInt32 nodeId = 0;
+		while(nodeId < largeMesh.m_numBvhNodes) {
+			const PfxAabb16 &node = largeMesh.m_bvhNodes[nodeId];
+			PfxBool hit = largeMesh.testBvhNode(nodeId,aabbMinL,aabbMaxL) &&
+				pfxIntersectRayQuantizedAABB(largeMesh,node,rayStartPosition,rayDirection,out.m_variable);
+			if(pfxIsLargeTriMeshBvhLeaf(node)) {
+				if(hit) {
+					ret |= pfxIntersectRayIsland(largeMesh,pfxGetLargeTriMeshBvhIslandId(node),ray,out,transform,rayStartPosition,rayDirection);
+				}
+				nodeId++;
+			}
+			else {
+				nodeId = hit ? nodeId + 1 : pfxGetLargeTriMeshBvhEscape(node);
+			}
+		}
+	}
+	else {
+		PfxUInt32 numIslands = largeMesh.m_numIslands;
+		for(PfxUInt32 i=0;i<numIslands;i++) {
+			PfxAabb16 aabbB = largeMesh.m_aabbList[i];
+			if(aabbMaxL.getX() < pfxGetXMin(aabbB) || aabbMinL.getX() > pfxGetXMax(aabbB)) continue;
+			if(aabbMaxL.getY() < pfxGetYMin(aabbB) || aabbMinL.getY() > pfxGetYMax(aabbB)) continue;
+			if(aabbMaxL.getZ() < pfxGetZMin(aabbB) || aabbMinL.getZ() > pfxGetZMax(aabbB)) continue;
 			
-			if( out.m_variable <= tmpVariable ) continue;
-
-			// アイランドとの交差チェック
-		const PfxTriMesh *island = &largeMesh.m_islands[i];
+			if(!pfxIntersectRayQuantizedAABB(largeMesh,aabbB,rayStartPosition,rayDirection,out.m_variable)) continue;
 			
-			PfxSubData subData;
-			tmpVariable = out.m_variable;
-
-			if( pfxIntersectRayTriMesh(*island,rayStartPosition,rayDirection,ray.m_facetMode,tmpVariable,tmpNormal,subData) &&
-				tmpVariable < out.m_variable ) {
-				out.m_contactFlag = true;
-				out.m_variable = tmpVariable;
-				out.m_contactPoint = ray.m_startPosition + tmpVariable * ray.m_direction;
-				out.m_contactNormal = transform.getUpper3x3() * tmpNormal;
-				subData.setIslandId(i);
-				out.m_subData = subData;
-				ret = true;
-			}
-
+			ret |= pfxIntersectRayIsland(largeMesh,i,ray,out,transform,rayStartPosition,rayDirection);
 		}
 	}
 
@@ -51,5 +51,46 @@ PfxBool pfxIntersectRaySphere(const PfxRayInput &ray,PfxRayOutput &out,const Pfx
 	return false;
 }
 
+PfxUInt32 pfxIntersectRayPacketSphere(const PfxRayPacket &packet,PfxUInt32 laneMask,PfxRayOutput *out,const PfxSphere &sphere,const PfxTransform3 &transform)
+{
+	const PfxVector3 center = transform.getTranslation();
+
+	PfxFloat4 vx = packet.m_startPosition[0] - PfxFloat4(center[0]);
+	PfxFloat4 vy = packet.m_startPosition[1] - PfxFloat4(center[1]);
+	PfxFloat4 vz = packet.m_startPosition[2] - PfxFloat4(center[2]);
+	const PfxFloat4 &dx = packet.m_direction[0];
+	const PfxFloat4 &dy = packet.m_direction[1];
+	const PfxFloat4 &dz = packet.m_direction[2];
+
+	PfxFloat4 a = dx * dx + dy * dy + dz * dz;
+	PfxFloat4 b = vx * dx + vy * dy + vz * dz;
+	PfxFloat4 c = (vx * vx + vy * vy + vz * vz) - PfxFloat4(sphere.m_radius * sphere.m_radius);
+	PfxFloat4 d = b * b - a * c;
+	PfxFloat4 tt = ( -b - pfxSqrtPerElem(d) ) / a;
+
+	const PfxFloat4 zero(0.0f);
+	PfxFloat4 reject = pfxOr(pfxOr(pfxCmpLt(c,zero),pfxCmpLt(d,zero)),pfxCmpLt(pfxAbsPerElem(a),PfxFloat4(0.00001f)));
+	reject = pfxOr(reject,pfxOr(pfxCmpLt(tt,zero),pfxCmpGt(tt,PfxFloat4(1.0f))));
+
+	PfxFloat4 variable(out[0].m_variable,out[1].m_variable,out[2].m_variable,out[3].m_variable);
+	PfxUInt32 hitMask = laneMask & pfxMoveMask(pfxCmpLt(tt,variable)) & ~pfxMoveMask(reject);
+	if(!hitMask) return 0;
+
+	PfxFloat t[4];
+	tt.store(t);
+
+	for(PfxUInt32 i=0;i<SCE_PFX_RAY_PACKET_SIZE;i++) {
+		if(!(hitMask & (1<<i))) continue;
+		const PfxRayInput &ray = *packet.m_rays[i];
+		out[i].m_contactFlag = true;
+		out[i].m_variable = t[i];
+		out[i].m_contactPoint = ray.m_startPosition + t[i] * ray.m_direction;
+		out[i].m_contactNormal = normalize(out[i].m_contactPoint - center);
+		out[i].m_subData.m_type = PfxSubData::NONE;
+	}
+
+	return hitMask;
+}
+
 } //namespace PhysicsEffects
 } //namespace sce
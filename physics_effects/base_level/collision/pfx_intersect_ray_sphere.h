@@ -18,6 +18,7 @@ Physics Effects under the filename: physics_effects_license.txt
 #define _SCE_PFX_INTERSECT_RAYSPHERE_H
 
 #include "base_level/collision/pfx_ray.h"
+#include "base_level/collision/pfx_ray_packet.h"
 #include "base_level/collision/pfx_sphere.h"
 
 namespace sce {
@@ -25,6 +26,8 @@ namespace PhysicsEffects {
 
 PfxBool pfxIntersectRaySphere(const PfxRayInput &ray,PfxRayOutput &out,const PfxSphere &sphere,const PfxTransform3 &transform);
 
+PfxUInt32 pfxIntersectRayPacketSphere(const PfxRayPacket &packet,PfxUInt32 laneMask,PfxRayOutput *out,const PfxSphere &sphere,const PfxTransform3 &transform);
+
 } //namespace PhysicsEffects
 } //namespace sce
 
@@ -22,7 +22,24 @@ Physics Effects under the filename: physics_effects_license.txt
 namespace sce {
 namespace PhysicsEffects {
 
-#define SCE_PFX_MAX_LARGETRIMESH_ISLANDS 256
+#define SCE_PFX_MAX_LARGETRIMESH_ISLANDS 0xffff
+
+///////////////////////////////////////////////////////////////////////////////
+// Large Mesh BVH
+
+//J アイランドAABBの階層（深さ優先順に並べた量子化AABBの配列）
+//J 32ビットのスロット3に、リーフならアイランド番号、ノードなら子孫を飛ばした次のノード番号を格納する
+//E Hierarchy of island AABBs (array of quantized AABBs in depth first order)
+//E 32 bit slot 3 holds the island index for a leaf, or the index of the next node after the subtree for an internal node
+
+#define SCE_PFX_LARGETRIMESH_BVH_LEAF 0x80000000
+
+SCE_PFX_FORCE_INLINE void pfxSetLargeTriMeshBvhLeaf(PfxAabb16 &node,PfxUInt32 islandId) {node.set32(3,SCE_PFX_LARGETRIMESH_BVH_LEAF|islandId);}
+SCE_PFX_FORCE_INLINE void pfxSetLargeTriMeshBvhEscape(PfxAabb16 &node,PfxUInt32 escapeId) {node.set32(3,escapeId);}
+
+SCE_PFX_FORCE_INLINE PfxBool pfxIsLargeTriMeshBvhLeaf(const PfxAabb16 &node) {return (node.get32(3)&SCE_PFX_LARGETRIMESH_BVH_LEAF) != 0;}
+SCE_PFX_FORCE_INLINE PfxUInt32 pfxGetLargeTriMeshBvhIslandId(const PfxAabb16 &node) {return node.get32(3)&~SCE_PFX_LARGETRIMESH_BVH_LEAF;}
+SCE_PFX_FORCE_INLINE PfxUInt32 pfxGetLargeTriMeshBvhEscape(const PfxAabb16 &node) {return node.get32(3);}
 
 ///////////////////////////////////////////////////////////////////////////////
 // Large Mesh
@@ -48,15 +65,30 @@ public:
 	//J アイランド配列
 	//E Array of island
 	PfxTriMesh *m_islands;
+	SCE_PFX_PADDING(3,4)
+
+	//J アイランドAABBの階層（NULLの場合はm_aabbListを順に判定する）
+	//J リーフはアイランド番号順に並んでいる
+	//E Hierarchy of island AABBs (m_aabbList is tested linearly if NULL)
+	//E Leaves are ordered by island index
+	PfxAabb16 *m_bvhNodes;
+	SCE_PFX_PADDING(4,4)
+	PfxUInt32 m_numBvhNodes;
 
 	PfxLargeTriMesh()
 	{
 		m_numIslands = 0;
 		m_islands = NULL;
 		m_aabbList = NULL;
+		m_bvhNodes = NULL;
+		m_numBvhNodes = 0;
 	}
 	
 	inline bool testAABB(int islandId,const PfxVector3 &center,const PfxVector3 &half) const;
+
+	//J 量子化されたAABBとノードのAABBを判定する
+	//E Test a quantized AABB with the AABB of a node
+	inline bool testBvhNode(PfxUInt32 nodeId,const PfxVecInt3 &aabbMinL,const PfxVecInt3 &aabbMaxL) const;
 	
 	//J ワールド座標値をラージメッシュローカルに変換する
 	//E Convert a position in the world coordinate into a position in the local coordinate
@@ -83,6 +115,18 @@ bool PfxLargeTriMesh::testAABB(int islandId,const PfxVector3 &center,const PfxVe
 	return true;
 }
 
+inline
+bool PfxLargeTriMesh::testBvhNode(PfxUInt32 nodeId,const PfxVecInt3 &aabbMinL,const PfxVecInt3 &aabbMaxL) const
+{
+	const PfxAabb16 &node = m_bvhNodes[nodeId];
+	
+	if(aabbMaxL.getX() < pfxGetXMin(node) || aabbMinL.getX() > pfxGetXMax(node)) return false;
+	if(aabbMaxL.getY() < pfxGetYMin(node) || aabbMinL.getY() > pfxGetYMax(node)) return false;
+	if(aabbMaxL.getZ() < pfxGetZMin(node) || aabbMinL.getZ() > pfxGetZMax(node)) return false;
+	
+	return true;
+}
+
 inline
 PfxVecInt3 PfxLargeTriMesh::getLocalPosition(const PfxVector3 &worldPosition) const 
 {
@@ -0,0 +1,76 @@
+/*
+Physics Effects Copyright(C) 2011 Sony Computer Entertainment Inc.
+All rights reserved.
+
+Physics Effects is open software; you can redistribute it and/or
+modify it under the terms of the BSD License.
+
+Physics Effects is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+See the BSD License for more details.
+
+A copy of the BSD License is distributed with
+Physics Effects under the filename: physics_effects_license.txt
+*/
+
+#ifndef _SCE_PFX_RAY_PACKET_H
+#define _SCE_PFX_RAY_PACKET_H
+
+#include "../base/pfx_vec_float4.h"
+#include "pfx_ray.h"
+
+namespace sce {
+namespace PhysicsEffects {
+
+#define SCE_PFX_RAY_PACKET_SIZE 4
+
+//J 最大4本のレイをSoA形式でまとめたもの
+//J 各レイの判定結果は同じレーン番号のPfxRayOutputに格納される
+//E Up to 4 rays stored in SoA form
+//E The result of each ray is stored into the PfxRayOutput of the same lane
+
+struct SCE_PFX_ALIGNED(16) PfxRayPacket
+{
+	PfxFloat4 m_startPosition[3];
+	PfxFloat4 m_direction[3];
+	const PfxRayInput *m_rays[SCE_PFX_RAY_PACKET_SIZE];
+	PfxUInt32 m_numRays;
+	SCE_PFX_PADDING(1,12)
+
+	void set(const PfxRayInput **rays,PfxUInt32 numRays)
+	{
+		SCE_PFX_ASSERT(numRays > 0 && numRays <= SCE_PFX_RAY_PACKET_SIZE);
+
+		m_numRays = numRays;
+
+		PfxFloat start[3][SCE_PFX_RAY_PACKET_SIZE];
+		PfxFloat dir[3][SCE_PFX_RAY_PACKET_SIZE];
+
+		//J 使用しないレーンには最後のレイを複製する
+		//E Unused lanes are filled with the last ray
+		for(PfxUInt32 i=0;i<SCE_PFX_RAY_PACKET_SIZE;i++) {
+			const PfxRayInput *ray = rays[SCE_PFX_MIN(i,numRays-1)];
+			m_rays[i] = ray;
+			for(int axis=0;axis<3;axis++) {
+				start[axis][i] = ray->m_startPosition[axis];
+				dir[axis][i] = ray->m_direction[axis];
+			}
+		}
+
+		for(int axis=0;axis<3;axis++) {
+			m_startPosition[axis] = PfxFloat4(start[axis][0],start[axis][1],start[axis][2],start[axis][3]);
+			m_direction[axis] = PfxFloat4(dir[axis][0],dir[axis][1],dir[axis][2],dir[axis][3]);
+		}
+	}
+
+	PfxUInt32 getLaneMask() const
+	{
+		return (1u<<m_numRays)-1;
+	}
+};
+
+} //namespace PhysicsEffects
+} //namespace sce
+
+#endif // _SCE_PFX_RAY_PACKET_H
@@ -29,11 +29,12 @@ struct PfxSubData {
 	union {
 		struct {
 			PfxUInt8  m_type;
-			SCE_PFX_PADDING(1,1)
+			PfxUInt8  m_facetId;
 
+			//J アイランド番号は16ビット（ラージメッシュのアイランド数の上限）
+			//E Island index is 16 bits (the limit of the number of islands in a large mesh)
 			struct {
-				PfxUInt8  islandId;
-				PfxUInt8  facetId;
+				PfxUInt16 islandId;
 				PfxUInt16 s;
 				PfxUInt16 t;
 
@@ -47,13 +48,13 @@ struct PfxSubData {
 		param[0] = param[1] = 0;
 	}
 
-	void  setIslandId(PfxUInt8 i) {m_facetLocal.islandId = i;}
-	void  setFacetId(PfxUInt8 i) {m_facetLocal.facetId = i;}
+	void  setIslandId(PfxUInt16 i) {m_facetLocal.islandId = i;}
+	void  setFacetId(PfxUInt8 i) {m_facetId = i;}
 	void  setFacetLocalS(PfxFloat s) {m_facetLocal.s = (PfxUInt16)(s * 65535.0f);}
 	void  setFacetLocalT(PfxFloat t) {m_facetLocal.t = (PfxUInt16)(t * 65535.0f);}
 
-	PfxUInt8 getIslandId() {return m_facetLocal.islandId;}
-	PfxUInt8 getFacetId() {return m_facetLocal.facetId;}
+	PfxUInt16 getIslandId() {return m_facetLocal.islandId;}
+	PfxUInt8 getFacetId() {return m_facetId;}
 	PfxFloat getFacetLocalS() {return m_facetLocal.s / 65535.0f;}
 	PfxFloat getFacetLocalT() {return m_facetLocal.t / 65535.0f;}
 };
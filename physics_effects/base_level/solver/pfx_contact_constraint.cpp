@@ -115,24 +115,17 @@ void pfxSetupContactConstraint(
 	}
 }
 
-void pfxSolveContactConstraint(
-	PfxConstraintRow &constraintResponse,
-	PfxConstraintRow &constraintFriction1,
-	PfxConstraintRow &constraintFriction2,
-	const PfxVector3 &contactPointA,
-	const PfxVector3 &contactPointB,
-	PfxSolverBody &solverBodyA,
-	PfxSolverBody &solverBodyB,
-	PfxFloat friction
-	)
+static SCE_PFX_FORCE_INLINE
+void pfxGetContactMass(
+	const PfxSolverBody &solverBodyA,
+	const PfxSolverBody &solverBodyB,
+	PfxFloat &massInvA,PfxMatrix3 &inertiaInvA,
+	PfxFloat &massInvB,PfxMatrix3 &inertiaInvB)
 {
-	PfxVector3 rA = rotate(solverBodyA.m_orientation,contactPointA);
-	PfxVector3 rB = rotate(solverBodyB.m_orientation,contactPointB);
-
-	PfxFloat massInvA = solverBodyA.m_massInv;
-	PfxFloat massInvB = solverBodyB.m_massInv;
-	PfxMatrix3 inertiaInvA = solverBodyA.m_inertiaInv;
-	PfxMatrix3 inertiaInvB = solverBodyB.m_inertiaInv;
+	massInvA = solverBodyA.m_massInv;
+	massInvB = solverBodyB.m_massInv;
+	inertiaInvA = solverBodyA.m_inertiaInv;
+	inertiaInvB = solverBodyB.m_inertiaInv;
 
 	if(solverBodyA.m_motionType == kPfxMotionTypeOneWay) {
 		massInvB = 0.0f;
@@ -142,6 +135,23 @@ void pfxSolveContactConstraint(
 		massInvA = 0.0f;
 		inertiaInvA = PfxMatrix3(0.0f);
 	}
+}
+
+static SCE_PFX_FORCE_INLINE
+void pfxSolveContactConstraintRows(
+	PfxConstraintRow &constraintResponse,
+	PfxConstraintRow &constraintFriction1,
+	PfxConstraintRow &constraintFriction2,
+	const PfxVector3 &rA,
+	const PfxVector3 &rB,
+	PfxSolverBody &solverBodyA,
+	PfxSolverBody &solverBodyB,
+	PfxFloat friction
+	)
+{
+	PfxFloat massInvA,massInvB;
+	PfxMatrix3 inertiaInvA,inertiaInvB;
+	pfxGetContactMass(solverBodyA,solverBodyB,massInvA,inertiaInvA,massInvB,inertiaInvB);
 
 	pfxSolveLinearConstraintRow(constraintResponse,
 		solverBodyA.m_deltaLinearVelocity,solverBodyA.m_deltaAngularVelocity,massInvA,inertiaInvA,rA,
@@ -162,5 +172,63 @@ void pfxSolveContactConstraint(
 		solverBodyB.m_deltaLinearVelocity,solverBodyB.m_deltaAngularVelocity,massInvB,inertiaInvB,rB);
 }
 
+void pfxSolveContactConstraint(
+	PfxConstraintRow &constraintResponse,
+	PfxConstraintRow &constraintFriction1,
+	PfxConstraintRow &constraintFriction2,
+	const PfxVector3 &contactPointA,
+	const PfxVector3 &contactPointB,
+	PfxSolverBody &solverBodyA,
+	PfxSolverBody &solverBodyB,
+	PfxFloat friction
+	)
+{
+	PfxVector3 rA = rotate(solverBodyA.m_orientation,contactPointA);
+	PfxVector3 rB = rotate(solverBodyB.m_orientation,contactPointB);
+
+	pfxSolveContactConstraintRows(
+		constraintResponse,constraintFriction1,constraintFriction2,
+		rA,rB,solverBodyA,solverBodyB,friction);
+}
+
+void pfxWarmStartContactConstraint(
+	const PfxContactSolverPoint &contactPoint,
+	PfxSolverBody &solverBodyA,
+	PfxSolverBody &solverBodyB
+	)
+{
+	PfxFloat massInvA,massInvB;
+	PfxMatrix3 inertiaInvA,inertiaInvB;
+	pfxGetContactMass(solverBodyA,solverBodyB,massInvA,inertiaInvA,massInvB,inertiaInvB);
+
+	PfxVector3 rA = pfxReadVector3(contactPoint.m_rA);
+	PfxVector3 rB = pfxReadVector3(contactPoint.m_rB);
+
+	for(int k=0;k<3;k++) {
+		PfxVector3 normal = pfxReadVector3(contactPoint.m_constraintRow[k].m_normal);
+		PfxFloat deltaImpulse = contactPoint.m_constraintRow[k].m_accumImpulse;
+		solverBodyA.m_deltaLinearVelocity += deltaImpulse * massInvA * normal;
+		solverBodyA.m_deltaAngularVelocity += deltaImpulse * inertiaInvA * cross(rA,normal);
+		solverBodyB.m_deltaLinearVelocity -= deltaImpulse * massInvB * normal;
+		solverBodyB.m_deltaAngularVelocity -= deltaImpulse * inertiaInvB * cross(rB,normal);
+	}
+}
+
+void pfxSolveContactConstraint(
+	PfxContactSolverPoint &contactPoint,
+	PfxSolverBody &solverBodyA,
+	PfxSolverBody &solverBodyB
+	)
+{
+	pfxSolveContactConstraintRows(
+		contactPoint.m_constraintRow[0],
+		contactPoint.m_constraintRow[1],
+		contactPoint.m_constraintRow[2],
+		pfxReadVector3(contactPoint.m_rA),
+		pfxReadVector3(contactPoint.m_rB),
+		solverBodyA,solverBodyB,
+		contactPoint.m_friction);
+}
+
 } //namespace PhysicsEffects
 } //namespace sce
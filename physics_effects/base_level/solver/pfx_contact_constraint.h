@@ -24,6 +24,20 @@ Physics Effects under the filename: physics_effects_license.txt
 namespace sce {
 namespace PhysicsEffects {
 
+//J ソルバーが反復計算で参照するコンタクト点のデータ（ホットデータ）
+//J 接触点はワールド座標系に変換済みで、マニフォールドのローカル座標やサブデータ（コールドデータ）は含まない
+//E Data of a contact point referred to by the solver iterations (hot data)
+//E Contact points are already in world coordinates, and local points and sub data
+//E of the manifold (cold data) are not included
+
+struct SCE_PFX_ALIGNED(16) PfxContactSolverPoint {
+	PfxConstraintRow m_constraintRow[3];
+	PfxFloat m_rA[3];
+	PfxFloat m_friction;
+	PfxFloat m_rB[3];
+	SCE_PFX_PADDING(1,4)
+};
+
 void pfxSetupContactConstraint(
 	PfxConstraintRow &constraintResponse,
 	PfxConstraintRow &constraintFriction1,
@@ -53,6 +67,18 @@ void pfxSolveContactConstraint(
 	PfxFloat friction
 	);
 
+void pfxWarmStartContactConstraint(
+	const PfxContactSolverPoint &contactPoint,
+	PfxSolverBody &solverBodyA,
+	PfxSolverBody &solverBodyB
+	);
+
+void pfxSolveContactConstraint(
+	PfxContactSolverPoint &contactPoint,
+	PfxSolverBody &solverBodyA,
+	PfxSolverBody &solverBodyB
+	);
+
 
 } //namespace PhysicsEffects
 } //namespace sce
@@ -98,21 +98,25 @@ unsigned int i=0,j=0;
 
 while(i<n1&&j<n2) {
 	if(Key(d1[i]) < Key(d2[j])) {
-		buff[i+j] = d1[i++];
+		buff[i+j] = d1[i];
+		i++;
 	}
 	else {
-		buff[i+j] = d2[j++];
+		buff[i+j] = d2[j];
+		j++;
 	}
 }
 
 if(i<n1) {
 	while(i<n1) {
-		buff[i+j] = d1[i++];
+		buff[i+j] = d1[i];
+		i++;
 	}
 }
 else if(j<n2) {
 	while(j<n2) {
-		buff[i+j] = d2[j++];
+		buff[i+j] = d2[j];
+		j++;
 	}
 }
 
@@ -250,6 +254,59 @@ void pfxHybridSort(SortData *data,SortData *buff,unsigned int n)
 	}
 }
 
+///////////////////////////////////////////////////////////////////////////////
+// Radix Sort
+
+template <class SortData>
+void pfxRadixSortInternal(SortData *data,SortData *buff,unsigned int n)
+{
+	if(n < 2) return;
+
+	//J 4桁分のヒストグラムを1回の走査で作成する
+	//E Count all four digits in a single pass
+	PfxUInt32 count[4][256];
+	memset(count,0,sizeof(count));
+
+	for(unsigned int i=0;i<n;i++) {
+		PfxUInt32 key = Key(data[i]);
+		count[0][key&0xff]++;
+		count[1][(key>>8)&0xff]++;
+		count[2][(key>>16)&0xff]++;
+		count[3][key>>24]++;
+	}
+
+	SortData *src = data;
+	SortData *dst = buff;
+
+	for(int pass=0;pass<4;pass++) {
+		PfxUInt32 shift = pass*8;
+		PfxUInt32 *offset = count[pass];
+
+		//J 全てのキーでこの桁が同じならスキップ
+		//E Skip the digit if it is the same for all keys
+		if(offset[(Key(src[0])>>shift)&0xff] == n) continue;
+
+		PfxUInt32 sum = 0;
+		for(int b=0;b<256;b++) {
+			PfxUInt32 c = offset[b];
+			offset[b] = sum;
+			sum += c;
+		}
+
+		for(unsigned int i=0;i<n;i++) {
+			dst[offset[(Key(src[i])>>shift)&0xff]++] = src[i];
+		}
+
+		SortData *tmp = src;
+		src = dst;
+		dst = tmp;
+	}
+
+	if(src != data) {
+		memcpy(data,src,sizeof(SortData)*n);
+	}
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 // Single Sort
 
@@ -263,5 +320,15 @@ void pfxSort(PfxSortData32 *data,PfxSortData32 *buff,unsigned int n)
 pfxMergeSort(data,buff,n);
 }
 
+void pfxRadixSort(PfxSortData16 *data,PfxSortData16 *buff,unsigned int n)
+{
+pfxRadixSortInternal(data,buff,n);
+}
+
+void pfxRadixSort(PfxSortData32 *data,PfxSortData32 *buff,unsigned int n)
+{
+pfxRadixSortInternal(data,buff,n);
+}
+
 } //namespace PhysicsEffects
 } //namespace sce
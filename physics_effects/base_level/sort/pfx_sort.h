@@ -27,6 +27,11 @@ namespace PhysicsEffects {
 void pfxSort(PfxSortData16 *data,PfxSortData16 *buff,unsigned int n);
 void pfxSort(PfxSortData32 *data,PfxSortData32 *buff,unsigned int n);
 
+//J 32ビットキーのLSD基数ソート（安定ソート）
+//E LSD radix sort on 32 bit keys (stable)
+void pfxRadixSort(PfxSortData16 *data,PfxSortData16 *buff,unsigned int n);
+void pfxRadixSort(PfxSortData32 *data,PfxSortData32 *buff,unsigned int n);
+
 } //namespace PhysicsEffects
 } //namespace sce
 
@@ -0,0 +1,463 @@
+/*
+Physics Effects Copyright(C) 2011 Sony Computer Entertainment Inc.
+All rights reserved.
+
+Physics Effects is open software; you can redistribute it and/or
+modify it under the terms of the BSD License.
+
+Physics Effects is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+See the BSD License for more details.
+
+A copy of the BSD License is distributed with
+Physics Effects under the filename: physics_effects_license.txt
+*/
+
+#include "base_level/base/pfx_perf_counter.h"
+#include "base_level/sort/pfx_sort.h"
+#include "base_level/broadphase/pfx_update_broadphase_proxy.h"
+#include "low_level/broadphase/pfx_broadphase.h"
+#include "low_level/sort/pfx_parallel_sort.h"
+#include "base_level/broadphase/pfx_check_collidable.h"
+
+namespace sce {
+namespace PhysicsEffects {
+
+PfxInt32 pfxCheckParamOfUpdateBroadphaseProxies(const PfxUpdateBroadphaseProxiesParam &param);
+PfxInt32 pfxCheckParamOfFindPairs(const PfxFindPairsParam &param,int maxTasks);
+PfxInt32 pfxCheckParamOfDecomposePairs(const PfxDecomposePairsParam &param,int maxTasks);
+
+///////////////////////////////////////////////////////////////////////////////
+// MULTI THREAD
+
+///////////////////////////////////////////////////////////////////////////////
+// Update Broadphase Proxies
+
+struct PfxUpdateBroadphaseProxiesIO {
+	PfxUpdateBroadphaseProxiesParam *param;
+};
+
+void pfxUpdateBroadphaseProxiesTaskEntry(PfxTaskArg *arg)
+{
+	PfxUpdateBroadphaseProxiesIO *io = (PfxUpdateBroadphaseProxiesIO*)arg->io;
+	PfxUpdateBroadphaseProxiesParam &param = *io->param;
+	PfxUInt32 start = arg->data[0];
+	PfxUInt32 num = arg->data[1];
+
+	PfxUInt32 numOutOfWorldProxies = 0;
+
+	for(PfxUInt32 i=start;i<start+num;i++) {
+		PfxInt32 chk = pfxUpdateBroadphaseProxy(
+			param.proxiesX[i],
+			param.proxiesY[i],
+			param.proxiesZ[i],
+			param.proxiesXb[i],
+			param.proxiesYb[i],
+			param.proxiesZb[i],
+			param.offsetRigidStates[i],
+			param.offsetCollidables[i],
+			param.worldCenter,
+			param.worldExtent);
+
+		if(chk == SCE_PFX_ERR_OUT_OF_WORLD) {
+			numOutOfWorldProxies++;
+
+			if(param.outOfWorldBehavior & SCE_PFX_OUT_OF_WORLD_BEHAVIOR_FIX_MOTION) {
+				PfxRigidState &state = param.offsetRigidStates[i];
+				state.setMotionType(kPfxMotionTypeFixed);
+				pfxSetMotionMask(param.proxiesX[i],state.getMotionMask());
+				pfxSetMotionMask(param.proxiesY[i],state.getMotionMask());
+				pfxSetMotionMask(param.proxiesZ[i],state.getMotionMask());
+				pfxSetMotionMask(param.proxiesXb[i],state.getMotionMask());
+				pfxSetMotionMask(param.proxiesYb[i],state.getMotionMask());
+				pfxSetMotionMask(param.proxiesZb[i],state.getMotionMask());
+			}
+
+			if(param.outOfWorldBehavior & SCE_PFX_OUT_OF_WORLD_BEHAVIOR_REMOVE_PROXY) {
+				pfxSetKey(param.proxiesX[i],SCE_PFX_SENTINEL_KEY);
+				pfxSetKey(param.proxiesY[i],SCE_PFX_SENTINEL_KEY);
+				pfxSetKey(param.proxiesZ[i],SCE_PFX_SENTINEL_KEY);
+				pfxSetKey(param.proxiesXb[i],SCE_PFX_SENTINEL_KEY);
+				pfxSetKey(param.proxiesYb[i],SCE_PFX_SENTINEL_KEY);
+				pfxSetKey(param.proxiesZb[i],SCE_PFX_SENTINEL_KEY);
+			}
+		}
+	}
+
+	arg->data[0] = numOutOfWorldProxies;
+}
+
+PfxInt32 pfxUpdateBroadphaseProxies(PfxUpdateBroadphaseProxiesParam &param,PfxUpdateBroadphaseProxiesResult &result,PfxTaskManager *taskManager)
+{
+	PfxInt32 ret = pfxCheckParamOfUpdateBroadphaseProxies(param);
+	if(ret != SCE_PFX_OK) return ret;
+	if(!taskManager) return SCE_PFX_ERR_INVALID_VALUE;
+
+	SCE_PFX_PUSH_MARKER("pfxUpdateBroadphaseProxies");
+
+	result.numOutOfWorldProxies = 0;
+
+	{
+		PfxUpdateBroadphaseProxiesIO *io = (PfxUpdateBroadphaseProxiesIO*)taskManager->allocate(sizeof(PfxUpdateBroadphaseProxiesIO));
+		io->param = &param;
+
+		PfxUInt32 numTasks = taskManager->getNumTasks();
+		taskManager->setTaskEntry((void*)pfxUpdateBroadphaseProxiesTaskEntry);
+
+		for(PfxUInt32 t=0;t<numTasks;t++) {
+			PfxUInt32 start = param.numRigidBodies*t/numTasks;
+			PfxUInt32 end = param.numRigidBodies*(t+1)/numTasks;
+			taskManager->startTask(t,io,start,end-start,0,0);
+		}
+
+		for(PfxUInt32 t=0;t<numTasks;t++) {
+			int taskId;
+			PfxUInt32 numOutOfWorld,data2,data3,data4;
+			taskManager->waitTask(taskId,numOutOfWorld,data2,data3,data4);
+			result.numOutOfWorldProxies += numOutOfWorld;
+		}
+
+		taskManager->deallocate(io);
+	}
+
+	PfxHeapManager pool((unsigned char*)param.workBuff,param.workBytes);
+	PfxUInt32 workBytes = sizeof(PfxBroadphaseProxy)*param.numRigidBodies;
+	void *workProxies = pool.allocate(workBytes,PfxHeapManager::ALIGN128);
+
+	pfxParallelSort(param.proxiesX,param.numRigidBodies,workProxies,workBytes,taskManager);
+	pfxParallelSort(param.proxiesY,param.numRigidBodies,workProxies,workBytes,taskManager);
+	pfxParallelSort(param.proxiesZ,param.numRigidBodies,workProxies,workBytes,taskManager);
+	pfxParallelSort(param.proxiesXb,param.numRigidBodies,workProxies,workBytes,taskManager);
+	pfxParallelSort(param.proxiesYb,param.numRigidBodies,workProxies,workBytes,taskManager);
+	pfxParallelSort(param.proxiesZb,param.numRigidBodies,workProxies,workBytes,taskManager);
+
+	pool.deallocate(workProxies);
+
+	SCE_PFX_POP_MARKER();
+
+	return SCE_PFX_OK;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Find Pairs
+
+//J 各タスクはプロキシを飛び飛びに担当し、自分専用のバッファにペアを書き出す
+//J 結合後にキーでソートするため、結果はシングルスレッド版と一致する
+//E Each task takes every numTasks-th proxy and writes pairs into its own buffer.
+//E Pairs are sorted by key after merging, so the result matches the single thread version.
+
+struct PfxFindPairsIO {
+	PfxBroadphaseProxy *proxies;
+	PfxUInt32 numProxies;
+	PfxUInt32 maxPairs;
+	int axis;
+	PfxBroadphasePair *taskPairs;
+	PfxUInt32 taskPairsStride;
+};
+
+void pfxFindPairsTaskEntry(PfxTaskArg *arg)
+{
+	PfxFindPairsIO *io = (PfxFindPairsIO*)arg->io;
+	PfxBroadphaseProxy *proxies = io->proxies;
+	PfxUInt32 numProxies = io->numProxies;
+	PfxUInt32 maxPairs = io->maxPairs;
+	int axis = io->axis;
+
+	PfxBroadphasePair *pairs = (PfxBroadphasePair*)((uintptr_t)io->taskPairs + io->taskPairsStride * arg->taskId);
+	PfxUInt32 numPairs = 0;
+	PfxUInt32 overflow = 0;
+
+	for(PfxUInt32 i=arg->taskId;i<numProxies&&!overflow;i+=arg->maxTasks) {
+		for(PfxUInt32 j=i+1;j<numProxies;j++) {
+			PfxBroadphaseProxy proxyA,proxyB;
+			if(pfxGetObjectId(proxies[i]) < pfxGetObjectId(proxies[j])) {
+				proxyA = proxies[i];
+				proxyB = proxies[j];
+			}
+			else {
+				proxyA = proxies[j];
+				proxyB = proxies[i];
+			}
+
+			if(pfxGetXYZMax(proxyA,axis) < pfxGetXYZMin(proxyB,axis)) {
+				break;
+			}
+
+			if(	pfxCheckCollidableInBroadphase(proxyA,proxyB) ) {
+				if(numPairs >= maxPairs) {
+					overflow = 1;
+					break;
+				}
+
+				PfxBroadphasePair &pair = pairs[numPairs++];
+				pfxSetActive(pair,true);
+				pfxSetObjectIdA(pair,pfxGetObjectId(proxyA));
+				pfxSetObjectIdB(pair,pfxGetObjectId(proxyB));
+				pfxSetMotionMaskA(pair,pfxGetMotionMask(proxyA));
+				pfxSetMotionMaskB(pair,pfxGetMotionMask(proxyB));
+
+				pfxSetKey(pair,pfxCreateUniqueKey(pfxGetObjectId(proxyA),pfxGetObjectId(proxyB)));
+			}
+		}
+	}
+
+	arg->data[0] = numPairs;
+	arg->data[1] = overflow;
+}
+
+PfxInt32 pfxFindPairs(PfxFindPairsParam &param,PfxFindPairsResult &result,PfxTaskManager *taskManager)
+{
+	if(!taskManager) return SCE_PFX_ERR_INVALID_VALUE;
+
+	PfxUInt32 numTasks = taskManager->getNumTasks();
+
+	PfxInt32 ret = pfxCheckParamOfFindPairs(param,numTasks);
+	if(ret != SCE_PFX_OK) return ret;
+
+	SCE_PFX_PUSH_MARKER("pfxFindPairs");
+
+	PfxBroadphasePair *pairs = (PfxBroadphasePair*)SCE_PFX_PTR_ALIGN16(param.pairBuff);
+	PfxUInt32 numPairs = 0;
+
+	PfxFindPairsIO *io = (PfxFindPairsIO*)taskManager->allocate(sizeof(PfxFindPairsIO));
+	io->proxies = param.proxies;
+	io->numProxies = param.numProxies;
+	io->maxPairs = param.maxPairs;
+	io->axis = param.axis;
+	io->taskPairs = (PfxBroadphasePair*)SCE_PFX_PTR_ALIGN128(param.workBuff);
+	io->taskPairsStride = SCE_PFX_ALLOC_BYTES_ALIGN128(sizeof(PfxBroadphasePair) * param.maxPairs);
+
+	PfxUInt32 *numTaskPairs = (PfxUInt32*)taskManager->allocate(sizeof(PfxUInt32)*numTasks);
+
+	taskManager->setTaskEntry((void*)pfxFindPairsTaskEntry);
+
+	for(PfxUInt32 t=0;t<numTasks;t++) {
+		taskManager->startTask(t,io,0,0,0,0);
+	}
+
+	PfxUInt32 overflow = 0;
+	for(PfxUInt32 t=0;t<numTasks;t++) {
+		int taskId;
+		PfxUInt32 n,ovf,data3,data4;
+		taskManager->waitTask(taskId,n,ovf,data3,data4);
+		numTaskPairs[taskId] = n;
+		numPairs += n;
+		overflow |= ovf;
+	}
+
+	if(overflow || numPairs > param.maxPairs) {
+		taskManager->deallocate(numTaskPairs);
+		taskManager->deallocate(io);
+		SCE_PFX_POP_MARKER();
+		return SCE_PFX_ERR_OUT_OF_MAX_PAIRS;
+	}
+
+	PfxUInt32 offset = 0;
+	for(PfxUInt32 t=0;t<numTasks;t++) {
+		PfxBroadphasePair *taskPairs = (PfxBroadphasePair*)((uintptr_t)io->taskPairs + io->taskPairsStride * t);
+		memcpy(pairs+offset,taskPairs,sizeof(PfxBroadphasePair)*numTaskPairs[t]);
+		offset += numTaskPairs[t];
+	}
+
+	taskManager->deallocate(numTaskPairs);
+	taskManager->deallocate(io);
+
+	pfxParallelSort(pairs,numPairs,(void*)SCE_PFX_PTR_ALIGN128(param.workBuff),sizeof(PfxBroadphasePair)*numPairs,taskManager);
+
+	result.pairs = pairs;
+	result.numPairs = numPairs;
+
+	SCE_PFX_POP_MARKER();
+
+	return SCE_PFX_OK;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Decompose Pairs
+
+//J 現在のペアをタスク数で分割し、その境界キーで前回のペアを二分探索して分割する
+//J 各タスクは出力バッファの自分の担当範囲に書き込み、最後に前詰めする
+//E Current pairs are split evenly between tasks and previous pairs are split
+//E at the same keys by binary search. Each task writes into its own range of
+//E the output buffers, which are compacted afterwards.
+
+struct PfxDecomposePairsIO {
+	PfxBroadphasePair *previousPairs;
+	PfxBroadphasePair *currentPairs;
+	PfxBroadphasePair *outNewPairs;
+	PfxBroadphasePair *outKeepPairs;
+	PfxBroadphasePair *outRemovePairs;
+};
+
+static PfxUInt32 pfxLowerBoundOfPairs(const PfxBroadphasePair *pairs,PfxUInt32 numPairs,PfxUInt32 key)
+{
+	PfxUInt32 lo = 0,hi = numPairs;
+	while(lo < hi) {
+		PfxUInt32 mid = (lo+hi)>>1;
+		if(pfxGetKey(pairs[mid]) < key) {
+			lo = mid+1;
+		}
+		else {
+			hi = mid;
+		}
+	}
+	return lo;
+}
+
+void pfxDecomposePairsTaskEntry(PfxTaskArg *arg)
+{
+	PfxDecomposePairsIO *io = (PfxDecomposePairsIO*)arg->io;
+	PfxUInt32 curStart = arg->data[0];
+	PfxUInt32 curEnd = arg->data[1];
+	PfxUInt32 prevStart = arg->data[2];
+	PfxUInt32 prevEnd = arg->data[3];
+
+	PfxBroadphasePair *previousPairs = io->previousPairs;
+	PfxBroadphasePair *currentPairs = io->currentPairs;
+	PfxBroadphasePair *outNewPairs = io->outNewPairs + curStart;
+	PfxBroadphasePair *outKeepPairs = io->outKeepPairs + prevStart;
+	PfxBroadphasePair *outRemovePairs = io->outRemovePairs + prevStart;
+
+	PfxUInt32 nNew = 0;
+	PfxUInt32 nKeep = 0;
+	PfxUInt32 nRemove = 0;
+
+	PfxUInt32 oldId = prevStart,newId = curStart;
+
+	while(oldId<prevEnd&&newId<curEnd) {
+		if(pfxGetKey(currentPairs[newId]) > pfxGetKey(previousPairs[oldId])) {
+			// remove
+			outRemovePairs[nRemove] = previousPairs[oldId];
+			nRemove++;
+			oldId++;
+		}
+		else if(pfxGetKey(currentPairs[newId]) == pfxGetKey(previousPairs[oldId])) {
+			// keep
+			outKeepPairs[nKeep] = currentPairs[newId];
+			pfxSetContactId(outKeepPairs[nKeep],pfxGetContactId(previousPairs[oldId]));
+			nKeep++;
+			oldId++;
+			newId++;
+		}
+		else {
+			// new
+			outNewPairs[nNew] = currentPairs[newId];
+			nNew++;
+			newId++;
+		}
+	};
+
+	for(;newId<curEnd;newId++,nNew++) {
+		outNewPairs[nNew] = currentPairs[newId];
+	}
+
+	for(;oldId<prevEnd;oldId++,nRemove++) {
+		outRemovePairs[nRemove] = previousPairs[oldId];
+	}
+
+	arg->data[0] = nNew;
+	arg->data[1] = nKeep;
+	arg->data[2] = nRemove;
+}
+
+PfxInt32 pfxDecomposePairs(PfxDecomposePairsParam &param,PfxDecomposePairsResult &result,PfxTaskManager *taskManager)
+{
+	if(!taskManager) return SCE_PFX_ERR_INVALID_VALUE;
+
+	PfxUInt32 numTasks = taskManager->getNumTasks();
+
+	PfxInt32 ret = pfxCheckParamOfDecomposePairs(param,numTasks);
+	if(ret != SCE_PFX_OK) return ret;
+
+	SCE_PFX_PUSH_MARKER("pfxDecomposePairs");
+
+	PfxBroadphasePair *previousPairs = param.previousPairs;
+	PfxUInt32 numPreviousPairs = param.numPreviousPairs;
+	PfxBroadphasePair *currentPairs = param.currentPairs;
+	PfxUInt32 numCurrentPairs = param.numCurrentPairs;
+
+	PfxBroadphasePair *outNewPairs = (PfxBroadphasePair*)SCE_PFX_PTR_ALIGN16(param.pairBuff);
+	PfxBroadphasePair *outKeepPairs = outNewPairs + numCurrentPairs;
+	PfxBroadphasePair *outRemovePairs = outKeepPairs + numPreviousPairs;
+
+	PfxDecomposePairsIO *io = (PfxDecomposePairsIO*)taskManager->allocate(sizeof(PfxDecomposePairsIO));
+	io->previousPairs = previousPairs;
+	io->currentPairs = currentPairs;
+	io->outNewPairs = outNewPairs;
+	io->outKeepPairs = outKeepPairs;
+	io->outRemovePairs = outRemovePairs;
+
+	// [curStart,curEnd,prevStart,prevEnd] and [nNew,nKeep,nRemove] for each task
+	PfxUInt32 *taskRange = (PfxUInt32*)taskManager->allocate(sizeof(PfxUInt32)*4*numTasks);
+	PfxUInt32 *taskCount = (PfxUInt32*)taskManager->allocate(sizeof(PfxUInt32)*3*numTasks);
+
+	for(PfxUInt32 t=0;t<numTasks;t++) {
+		PfxUInt32 curStart = numCurrentPairs*t/numTasks;
+		PfxUInt32 curEnd = numCurrentPairs*(t+1)/numTasks;
+		taskRange[t*4+0] = curStart;
+		taskRange[t*4+1] = curEnd;
+		if(t == 0) {
+			taskRange[t*4+2] = 0;
+		}
+		else if(curStart < numCurrentPairs) {
+			taskRange[t*4+2] = pfxLowerBoundOfPairs(previousPairs,numPreviousPairs,pfxGetKey(currentPairs[curStart]));
+		}
+		else {
+			taskRange[t*4+2] = numPreviousPairs;
+		}
+	}
+	for(PfxUInt32 t=0;t<numTasks;t++) {
+		taskRange[t*4+3] = (t+1<numTasks) ? taskRange[(t+1)*4+2] : numPreviousPairs;
+	}
+
+	taskManager->setTaskEntry((void*)pfxDecomposePairsTaskEntry);
+
+	for(PfxUInt32 t=0;t<numTasks;t++) {
+		taskManager->startTask(t,io,taskRange[t*4+0],taskRange[t*4+1],taskRange[t*4+2],taskRange[t*4+3]);
+	}
+
+	for(PfxUInt32 t=0;t<numTasks;t++) {
+		int taskId;
+		PfxUInt32 nNew,nKeep,nRemove,data4;
+		taskManager->waitTask(taskId,nNew,nKeep,nRemove,data4);
+		taskCount[taskId*3+0] = nNew;
+		taskCount[taskId*3+1] = nKeep;
+		taskCount[taskId*3+2] = nRemove;
+	}
+
+	//J 各タスクの出力を前詰めする（移動先は常に移動元より前）
+	//E Compact the output of each task (destinations never pass their sources)
+	PfxUInt32 nNew = 0;
+	PfxUInt32 nKeep = 0;
+	PfxUInt32 nRemove = 0;
+
+	for(PfxUInt32 t=0;t<numTasks;t++) {
+		PfxUInt32 curStart = taskRange[t*4+0];
+		PfxUInt32 prevStart = taskRange[t*4+2];
+		if(nNew != curStart) memmove(outNewPairs+nNew,outNewPairs+curStart,sizeof(PfxBroadphasePair)*taskCount[t*3+0]);
+		if(nKeep != prevStart) memmove(outKeepPairs+nKeep,outKeepPairs+prevStart,sizeof(PfxBroadphasePair)*taskCount[t*3+1]);
+		if(nRemove != prevStart) memmove(outRemovePairs+nRemove,outRemovePairs+prevStart,sizeof(PfxBroadphasePair)*taskCount[t*3+2]);
+		nNew += taskCount[t*3+0];
+		nKeep += taskCount[t*3+1];
+		nRemove += taskCount[t*3+2];
+	}
+
+	taskManager->deallocate(taskCount);
+	taskManager->deallocate(taskRange);
+	taskManager->deallocate(io);
+
+	result.outNewPairs = outNewPairs;
+	result.outKeepPairs = outKeepPairs;
+	result.outRemovePairs = outRemovePairs;
+	result.numOutNewPairs = nNew;
+	result.numOutKeepPairs = nKeep;
+	result.numOutRemovePairs = nRemove;
+
+	SCE_PFX_POP_MARKER();
+
+	return SCE_PFX_OK;
+}
+
+} //namespace PhysicsEffects
+} //namespace sce
@@ -95,7 +95,7 @@ PfxInt32 pfxUpdateBroadphaseProxies(PfxUpdateBroadphaseProxiesParam &param,PfxUp
 	PfxInt32 ret = pfxCheckParamOfUpdateBroadphaseProxies(param);
 	if(ret != SCE_PFX_OK) return ret;
 
-	SCE_PFX_PUSH_MARKER("pfxUpdateBroadphaseProxies")
+	SCE_PFX_PUSH_MARKER("pfxUpdateBroadphaseProxies");
 
 	result.numOutOfWorldProxies = 0;
 
@@ -159,7 +159,7 @@ PfxInt32 pfxFindPairs(PfxFindPairsParam &param,PfxFindPairsResult &result)
 	PfxInt32 ret = pfxCheckParamOfFindPairs(param,0);
 	if(ret != SCE_PFX_OK) return ret;
 
-	SCE_PFX_PUSH_MARKER("pfxFindPairs")
+	SCE_PFX_PUSH_MARKER("pfxFindPairs");
 
 	void *workBuff = param.workBuff;
 	PfxUInt32 workBytes = param.workBytes;
@@ -190,8 +190,10 @@ PfxInt32 pfxFindPairs(PfxFindPairsParam &param,PfxFindPairsResult &result)
 			}
 
 			if(	pfxCheckCollidableInBroadphase(proxyA,proxyB) ) {
-				if(numPairs >= maxPairs) 
+				if(numPairs >= maxPairs) {
+					SCE_PFX_POP_MARKER();
 					return SCE_PFX_ERR_OUT_OF_MAX_PAIRS;
+				}
 
 				PfxBroadphasePair &pair = pairs[numPairs++];
 				pfxSetActive(pair,true);
@@ -220,7 +222,7 @@ PfxInt32 pfxDecomposePairs(PfxDecomposePairsParam &param,PfxDecomposePairsResult
 	PfxInt32 ret = pfxCheckParamOfDecomposePairs(param,0);
 	if(ret != SCE_PFX_OK) return ret;
 
-	SCE_PFX_PUSH_MARKER("pfxDecomposePairs")
+	SCE_PFX_PUSH_MARKER("pfxDecomposePairs");
 
 	PfxBroadphasePair *previousPairs = param.previousPairs;
 	PfxUInt32 numPreviousPairs = param.numPreviousPairs;
@@ -0,0 +1,460 @@
+/*
+Physics Effects Copyright(C) 2011 Sony Computer Entertainment Inc.
+All rights reserved.
+
+Physics Effects is open software; you can redistribute it and/or
+modify it under the terms of the BSD License.
+
+Physics Effects is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+See the BSD License for more details.
+
+A copy of the BSD License is distributed with
+Physics Effects under the filename: physics_effects_license.txt
+*/
+
+#include "base_level/base/pfx_perf_counter.h"
+#include "base_level/sort/pfx_sort.h"
+#include "base_level/broadphase/pfx_update_broadphase_proxy.h"
+#include "base_level/broadphase/pfx_check_collidable.h"
+#include "low_level/broadphase/pfx_incremental_broadphase.h"
+
+namespace sce {
+namespace PhysicsEffects {
+
+#define SCE_PFX_INCREMENTAL_EVENT_ADD		1
+#define SCE_PFX_INCREMENTAL_EVENT_REMOVE	2
+
+static SCE_PFX_FORCE_INLINE
+PfxUInt32 pfxGetMaxEventsOfIncrementalBroadphase(PfxUInt32 maxRigidBodies,PfxUInt32 maxPairs)
+{
+	//J イベントバッファは再構築時の端点のソートにも使用する
+	//E The event buffer is also used to sort endpoints when rebuilding
+	return SCE_PFX_MAX(maxPairs,maxRigidBodies*2);
+}
+
+PfxUInt32 pfxGetBytesOfIncrementalBroadphase(PfxUInt32 maxRigidBodies,PfxUInt32 maxPairs)
+{
+	PfxUInt32 maxEvents = pfxGetMaxEventsOfIncrementalBroadphase(maxRigidBodies,maxPairs);
+	return 128 +
+		SCE_PFX_BYTES_ALIGN128(sizeof(PfxBroadphaseProxy)*maxRigidBodies) +
+		SCE_PFX_BYTES_ALIGN128(sizeof(PfxIncrementalBroadphaseEndpoint)*maxRigidBodies*2) * 3 +
+		SCE_PFX_BYTES_ALIGN128(sizeof(PfxUInt32)*maxRigidBodies*2) * 3 +
+		SCE_PFX_BYTES_ALIGN128(sizeof(PfxBroadphasePair)*maxPairs) * 2 +
+		SCE_PFX_BYTES_ALIGN128(sizeof(PfxBroadphasePair)*maxEvents) * 2;
+}
+
+PfxUInt32 pfxGetPairBytesOfUpdateIncrementalBroadphase(PfxUInt32 numPreviousPairs,PfxUInt32 maxPairs)
+{
+	return sizeof(PfxBroadphasePair)*(numPreviousPairs*2+maxPairs);
+}
+
+static void *pfxIncrementalBroadphaseAlloc(uintptr_t &ptr,PfxUInt32 bytes)
+{
+	void *p = (void*)ptr;
+	ptr += SCE_PFX_BYTES_ALIGN128(bytes);
+	return p;
+}
+
+PfxInt32 pfxInitializeIncrementalBroadphase(PfxIncrementalBroadphase &broadphase,void *buff,PfxUInt32 bytes,PfxUInt32 maxRigidBodies,PfxUInt32 maxPairs)
+{
+	if(!buff || maxRigidBodies > 0x10000) return SCE_PFX_ERR_INVALID_VALUE;
+	if(bytes < pfxGetBytesOfIncrementalBroadphase(maxRigidBodies,maxPairs)) return SCE_PFX_ERR_OUT_OF_BUFFER;
+
+	broadphase.maxRigidBodies = maxRigidBodies;
+	broadphase.maxPairs = maxPairs;
+	broadphase.maxEvents = pfxGetMaxEventsOfIncrementalBroadphase(maxRigidBodies,maxPairs);
+	broadphase.numRigidBodies = 0;
+	broadphase.numPairs = 0;
+	broadphase.pairSwap = 0;
+	broadphase.needsRebuild = true;
+	broadphase.worldCenter = PfxVector3(0.0f);
+	broadphase.worldExtent = PfxVector3(0.0f);
+
+	uintptr_t ptr = SCE_PFX_PTR_ALIGN128(buff);
+	broadphase.proxies = (PfxBroadphaseProxy*)pfxIncrementalBroadphaseAlloc(ptr,sizeof(PfxBroadphaseProxy)*maxRigidBodies);
+	for(int axis=0;axis<3;axis++) {
+		broadphase.endpoints[axis] = (PfxIncrementalBroadphaseEndpoint*)pfxIncrementalBroadphaseAlloc(ptr,sizeof(PfxIncrementalBroadphaseEndpoint)*maxRigidBodies*2);
+		broadphase.positions[axis] = (PfxUInt32*)pfxIncrementalBroadphaseAlloc(ptr,sizeof(PfxUInt32)*maxRigidBodies*2);
+	}
+	broadphase.pairs[0] = (PfxBroadphasePair*)pfxIncrementalBroadphaseAlloc(ptr,sizeof(PfxBroadphasePair)*maxPairs);
+	broadphase.pairs[1] = (PfxBroadphasePair*)pfxIncrementalBroadphaseAlloc(ptr,sizeof(PfxBroadphasePair)*maxPairs);
+	broadphase.events = (PfxBroadphasePair*)pfxIncrementalBroadphaseAlloc(ptr,sizeof(PfxBroadphasePair)*broadphase.maxEvents);
+	broadphase.sortBuff = (PfxBroadphasePair*)pfxIncrementalBroadphaseAlloc(ptr,sizeof(PfxBroadphasePair)*broadphase.maxEvents);
+
+	return SCE_PFX_OK;
+}
+
+void pfxResetIncrementalBroadphase(PfxIncrementalBroadphase &broadphase)
+{
+	broadphase.needsRebuild = true;
+}
+
+PfxInt32 pfxCheckParamOfUpdateIncrementalBroadphase(const PfxIncrementalBroadphase &broadphase,const PfxUpdateIncrementalBroadphaseParam &param)
+{
+	if(!param.pairBuff || !param.offsetRigidStates || !param.offsetCollidables) return SCE_PFX_ERR_INVALID_VALUE;
+	if(param.numPreviousPairs > 0 && !param.previousPairs) return SCE_PFX_ERR_INVALID_VALUE;
+	if(!SCE_PFX_PTR_IS_ALIGNED16(param.pairBuff) || !SCE_PFX_PTR_IS_ALIGNED16(param.previousPairs)) return SCE_PFX_ERR_INVALID_ALIGN;
+	if(param.numRigidBodies > broadphase.maxRigidBodies) return SCE_PFX_ERR_OUT_OF_BUFFER;
+	if(SCE_PFX_AVAILABLE_BYTES_ALIGN16(param.pairBuff,param.pairBytes) < pfxGetPairBytesOfUpdateIncrementalBroadphase(param.numPreviousPairs,broadphase.maxPairs)) return SCE_PFX_ERR_OUT_OF_BUFFER;
+	return SCE_PFX_OK;
+}
+
+static SCE_PFX_FORCE_INLINE
+PfxBool pfxIsOverlappedOnAxis(const PfxIncrementalBroadphase &broadphase,int axis,PfxUInt32 idA,PfxUInt32 idB)
+{
+	const PfxUInt32 *pos = broadphase.positions[axis];
+	return pos[idA*2] < pos[idB*2+1] && pos[idB*2] < pos[idA*2+1];
+}
+
+static SCE_PFX_FORCE_INLINE
+void pfxSetIncrementalPair(PfxBroadphasePair &pair,PfxUInt32 idA,PfxUInt32 idB)
+{
+	pair.set32(0,0);
+	pair.set32(1,0);
+	pair.set32(2,0);
+	pfxSetObjectIdA(pair,(PfxUInt16)SCE_PFX_MIN(idA,idB));
+	pfxSetObjectIdB(pair,(PfxUInt16)SCE_PFX_MAX(idA,idB));
+	pfxSetKey(pair,pfxCreateUniqueKey(idA,idB));
+}
+
+//J 端点リストの作成とソート
+//E Creates and sorts the endpoint lists
+static void pfxBuildEndpoints(PfxIncrementalBroadphase &broadphase)
+{
+	PfxUInt32 numEndpoints = broadphase.numRigidBodies*2;
+	PfxSortData16 *sortData = broadphase.events;
+	PfxSortData16 *sortBuff = broadphase.sortBuff;
+
+	for(int axis=0;axis<3;axis++) {
+		for(PfxUInt32 i=0;i<broadphase.numRigidBodies;i++) {
+			const PfxBroadphaseProxy &proxy = broadphase.proxies[i];
+			sortData[i*2].set32(0,i*2);
+			sortData[i*2+1].set32(0,i*2+1);
+			pfxSetKey(sortData[i*2],(PfxUInt32)pfxGetXYZMin(proxy,axis)<<1);
+			pfxSetKey(sortData[i*2+1],((PfxUInt32)pfxGetXYZMax(proxy,axis)<<1)|1);
+		}
+
+		pfxSort(sortData,sortBuff,numEndpoints);
+
+		PfxIncrementalBroadphaseEndpoint *endpoints = broadphase.endpoints[axis];
+		PfxUInt32 *positions = broadphase.positions[axis];
+		for(PfxUInt32 i=0;i<numEndpoints;i++) {
+			PfxUInt32 e = sortData[i].get32(0);
+			endpoints[i].key = pfxGetKey(sortData[i]);
+			endpoints[i].id = e>>1;
+			positions[e] = i;
+		}
+	}
+}
+
+//J X軸の端点リストを走査して交差している全てのペアを作成する
+//E Creates all overlapped pairs by sweeping the endpoint list of the X axis
+static PfxInt32 pfxSweepEndpoints(PfxIncrementalBroadphase &broadphase)
+{
+	const PfxIncrementalBroadphaseEndpoint *endpoints = broadphase.endpoints[0];
+	const PfxUInt32 *positions = broadphase.positions[0];
+	PfxUInt32 numEndpoints = broadphase.numRigidBodies*2;
+	PfxBroadphasePair *pairs = broadphase.pairs[broadphase.pairSwap];
+	PfxUInt32 numPairs = 0;
+
+	for(PfxUInt32 i=0;i<numEndpoints;i++) {
+		if(endpoints[i].key&1) continue;
+
+		PfxUInt32 idA = endpoints[i].id;
+		PfxUInt32 end = positions[idA*2+1];
+
+		for(PfxUInt32 j=i+1;j<end;j++) {
+			if(endpoints[j].key&1) continue;
+
+			PfxUInt32 idB = endpoints[j].id;
+			if(pfxIsOverlappedOnAxis(broadphase,1,idA,idB) && pfxIsOverlappedOnAxis(broadphase,2,idA,idB)) {
+				if(numPairs >= broadphase.maxPairs) {
+					return SCE_PFX_ERR_OUT_OF_MAX_PAIRS;
+				}
+				pfxSetIncrementalPair(pairs[numPairs++],idA,idB);
+			}
+		}
+	}
+
+	pfxSort(pairs,broadphase.sortBuff,numPairs);
+
+	broadphase.numPairs = numPairs;
+
+	return SCE_PFX_OK;
+}
+
+//J 端点の挿入ソート
+//J 最小点が他の最大点を追い越せば交差の開始、最大点が他の最小点を追い越せば交差の終了となる
+//E Insertion sort of endpoints
+//E A min passing another max starts an overlap, a max passing another min ends it
+static void pfxSortEndpoints(PfxIncrementalBroadphase &broadphase,int axis,PfxUInt32 &numEvents,PfxUInt32 &numSwaps)
+{
+	PfxIncrementalBroadphaseEndpoint *endpoints = broadphase.endpoints[axis];
+	PfxUInt32 *positions = broadphase.positions[axis];
+	PfxUInt32 numEndpoints = broadphase.numRigidBodies*2;
+	int axis1 = (axis+1)%3;
+	int axis2 = (axis+2)%3;
+
+	for(PfxUInt32 i=1;i<numEndpoints;i++) {
+		PfxIncrementalBroadphaseEndpoint e = endpoints[i];
+		if(endpoints[i-1].key <= e.key) continue;
+
+		PfxUInt32 isMaxE = e.key&1;
+		PfxUInt32 j = i;
+		for(;j>0 && endpoints[j-1].key > e.key;j--) {
+			PfxIncrementalBroadphaseEndpoint o = endpoints[j-1];
+			PfxUInt32 isMaxO = o.key&1;
+
+			if(isMaxE != isMaxO &&
+				pfxIsOverlappedOnAxis(broadphase,axis1,e.id,o.id) &&
+				pfxIsOverlappedOnAxis(broadphase,axis2,e.id,o.id)) {
+				//J 溢れたイベントは記録しない（呼び出し元でペアを作り直す）
+				//E Overflowed events are not recorded (the caller recreates pairs)
+				if(numEvents < broadphase.maxEvents) {
+					PfxBroadphasePair &event = broadphase.events[numEvents];
+					pfxSetIncrementalPair(event,e.id,o.id);
+					pfxSetBroadphaseFlag(event,isMaxE ? SCE_PFX_INCREMENTAL_EVENT_REMOVE : SCE_PFX_INCREMENTAL_EVENT_ADD);
+				}
+				numEvents++;
+			}
+
+			endpoints[j] = o;
+			positions[o.id*2+isMaxO] = j;
+			numSwaps++;
+		}
+
+		endpoints[j] = e;
+		positions[e.id*2+isMaxE] = j;
+	}
+}
+
+//J イベントを集計して交差ペアに反映する
+//J 同じペアの追加と削除は交互に発生するため、差し引きは-1,0,1のいずれかになる
+//E Accumulates events and applies them to overlapped pairs
+//E Adds and removes of the same pair alternate, so the net count is -1, 0 or 1
+static PfxInt32 pfxApplyEvents(PfxIncrementalBroadphase &broadphase,PfxUInt32 numEvents)
+{
+	PfxBroadphasePair *events = broadphase.events;
+
+	pfxSort(events,broadphase.sortBuff,numEvents);
+
+	PfxBroadphasePair *srcPairs = broadphase.pairs[broadphase.pairSwap];
+	PfxBroadphasePair *dstPairs = broadphase.pairs[1-broadphase.pairSwap];
+	PfxUInt32 numSrcPairs = broadphase.numPairs;
+	PfxUInt32 numDstPairs = 0;
+	PfxUInt32 src = 0;
+
+	for(PfxUInt32 i=0;i<numEvents;) {
+		PfxUInt32 key = pfxGetKey(events[i]);
+		PfxInt32 net = 0;
+		PfxUInt32 first = i;
+		for(;i<numEvents && pfxGetKey(events[i]) == key;i++) {
+			net += pfxGetBroadphaseFlag(events[i]) == SCE_PFX_INCREMENTAL_EVENT_ADD ? 1 : -1;
+		}
+
+		for(;src<numSrcPairs && pfxGetKey(srcPairs[src]) < key;src++) {
+			if(numDstPairs >= broadphase.maxPairs) return SCE_PFX_ERR_OUT_OF_MAX_PAIRS;
+			dstPairs[numDstPairs++] = srcPairs[src];
+		}
+
+		PfxBool exists = src<numSrcPairs && pfxGetKey(srcPairs[src]) == key;
+		if(exists) src++;
+
+		if((exists && net >= 0) || (!exists && net > 0)) {
+			if(numDstPairs >= broadphase.maxPairs) return SCE_PFX_ERR_OUT_OF_MAX_PAIRS;
+			pfxSetIncrementalPair(dstPairs[numDstPairs++],pfxGetObjectIdA(events[first]),pfxGetObjectIdB(events[first]));
+		}
+	}
+
+	for(;src<numSrcPairs;src++) {
+		if(numDstPairs >= broadphase.maxPairs) return SCE_PFX_ERR_OUT_OF_MAX_PAIRS;
+		dstPairs[numDstPairs++] = srcPairs[src];
+	}
+
+	broadphase.pairSwap = 1-broadphase.pairSwap;
+	broadphase.numPairs = numDstPairs;
+
+	return SCE_PFX_OK;
+}
+
+PfxInt32 pfxUpdateIncrementalBroadphase(PfxIncrementalBroadphase &broadphase,PfxUpdateIncrementalBroadphaseParam &param,PfxUpdateIncrementalBroadphaseResult &result)
+{
+	PfxInt32 ret = pfxCheckParamOfUpdateIncrementalBroadphase(broadphase,param);
+	if(ret != SCE_PFX_OK) return ret;
+
+	SCE_PFX_PUSH_MARKER("pfxUpdateIncrementalBroadphase");
+
+	result.numOutOfWorldProxies = 0;
+	result.numSwaps = 0;
+	result.rebuilt = false;
+
+	//J プロキシの更新
+	//E Update proxies
+	for(PfxUInt32 i=0;i<param.numRigidBodies;i++) {
+		PfxBroadphaseProxy &proxy = broadphase.proxies[i];
+		PfxInt32 chk = pfxUpdateBroadphaseProxy(
+			proxy,
+			param.offsetRigidStates[i],
+			param.offsetCollidables[i],
+			param.worldCenter,
+			param.worldExtent,
+			0);
+
+		if(chk == SCE_PFX_ERR_OUT_OF_WORLD) {
+			result.numOutOfWorldProxies++;
+
+			if(param.outOfWorldBehavior & SCE_PFX_OUT_OF_WORLD_BEHAVIOR_FIX_MOTION) {
+				PfxRigidState &state = param.offsetRigidStates[i];
+				state.setMotionType(kPfxMotionTypeFixed);
+				pfxSetMotionMask(proxy,state.getMotionMask());
+			}
+
+			//J 端点は残し、フィルターで全ての剛体と衝突しないようにする
+			//E Endpoints are kept, and filters make it collide with nothing
+			if(param.outOfWorldBehavior & SCE_PFX_OUT_OF_WORLD_BEHAVIOR_REMOVE_PROXY) {
+				pfxSetSelf(proxy,0);
+				pfxSetTarget(proxy,0);
+			}
+		}
+	}
+
+	if(broadphase.needsRebuild || broadphase.numRigidBodies != param.numRigidBodies ||
+		lengthSqr(broadphase.worldCenter-param.worldCenter) > 0.0f ||
+		lengthSqr(broadphase.worldExtent-param.worldExtent) > 0.0f) {
+		SCE_PFX_PUSH_MARKER("Rebuild");
+
+		broadphase.numRigidBodies = param.numRigidBodies;
+		broadphase.worldCenter = param.worldCenter;
+		broadphase.worldExtent = param.worldExtent;
+
+		pfxBuildEndpoints(broadphase);
+		ret = pfxSweepEndpoints(broadphase);
+
+		result.rebuilt = true;
+
+		SCE_PFX_POP_MARKER();
+	}
+	else {
+		SCE_PFX_PUSH_MARKER("Sort Endpoints");
+
+		//J 量子化された新しい値を端点に書き込む
+		//E Write new quantized values into endpoints
+		for(int axis=0;axis<3;axis++) {
+			PfxIncrementalBroadphaseEndpoint *endpoints = broadphase.endpoints[axis];
+			const PfxUInt32 *positions = broadphase.positions[axis];
+			for(PfxUInt32 i=0;i<param.numRigidBodies;i++) {
+				endpoints[positions[i*2]].key = (PfxUInt32)pfxGetXYZMin(broadphase.proxies[i],axis)<<1;
+				endpoints[positions[i*2+1]].key = ((PfxUInt32)pfxGetXYZMax(broadphase.proxies[i],axis)<<1)|1;
+			}
+		}
+
+		PfxUInt32 numEvents = 0;
+		for(int axis=0;axis<3;axis++) {
+			pfxSortEndpoints(broadphase,axis,numEvents,result.numSwaps);
+		}
+
+		SCE_PFX_POP_MARKER();
+
+		SCE_PFX_PUSH_MARKER("Apply Events");
+
+		//J イベントが溢れた場合はソート済みの端点からペアを作り直す
+		//E Recreate pairs from the sorted endpoints if events overflowed
+		if(numEvents > broadphase.maxEvents) {
+			ret = pfxSweepEndpoints(broadphase);
+			result.rebuilt = true;
+		}
+		else {
+			ret = pfxApplyEvents(broadphase,numEvents);
+		}
+
+		SCE_PFX_POP_MARKER();
+	}
+
+	if(ret != SCE_PFX_OK) {
+		broadphase.needsRebuild = true;
+		SCE_PFX_POP_MARKER();
+		return ret;
+	}
+
+	broadphase.needsRebuild = false;
+
+	//J 前フレームのペアと比較して新規/維持/廃棄に分ける
+	//J フィルターとモーションタイプは毎フレーム判定する
+	//E Decompose pairs into new, keep and remove by comparing them with previous pairs
+	//E Filters and motion types are checked every frame
+	SCE_PFX_PUSH_MARKER("Decompose");
+
+	const PfxBroadphasePair *currentPairs = broadphase.pairs[broadphase.pairSwap];
+	PfxUInt32 numCurrentPairs = broadphase.numPairs;
+	PfxBroadphasePair *previousPairs = param.previousPairs;
+	PfxUInt32 numPreviousPairs = param.numPreviousPairs;
+
+	PfxBroadphasePair *outNewPairs = (PfxBroadphasePair*)SCE_PFX_PTR_ALIGN16(param.pairBuff);
+	PfxBroadphasePair *outKeepPairs = outNewPairs + numCurrentPairs;
+	PfxBroadphasePair *outRemovePairs = outKeepPairs + numPreviousPairs;
+
+	PfxUInt32 nNew = 0;
+	PfxUInt32 nKeep = 0;
+	PfxUInt32 nRemove = 0;
+
+	PfxUInt32 oldId = 0,newId = 0;
+
+	while(newId<numCurrentPairs) {
+		const PfxBroadphasePair &current = currentPairs[newId];
+		const PfxBroadphaseProxy &proxyA = broadphase.proxies[pfxGetObjectIdA(current)];
+		const PfxBroadphaseProxy &proxyB = broadphase.proxies[pfxGetObjectIdB(current)];
+
+		if(!pfxCheckCollidableInBroadphase(proxyA,proxyB)) {
+			newId++;
+			continue;
+		}
+
+		PfxUInt32 key = pfxGetKey(current);
+
+		for(;oldId<numPreviousPairs && pfxGetKey(previousPairs[oldId]) < key;oldId++) {
+			// remove
+			outRemovePairs[nRemove++] = previousPairs[oldId];
+		}
+
+		PfxBroadphasePair pair = current;
+		pfxSetActive(pair,true);
+		pfxSetMotionMaskA(pair,pfxGetMotionMask(proxyA));
+		pfxSetMotionMaskB(pair,pfxGetMotionMask(proxyB));
+
+		if(oldId<numPreviousPairs && pfxGetKey(previousPairs[oldId]) == key) {
+			// keep
+			pfxSetContactId(pair,pfxGetContactId(previousPairs[oldId]));
+			outKeepPairs[nKeep++] = pair;
+			oldId++;
+		}
+		else {
+			// new
+			outNewPairs[nNew++] = pair;
+		}
+
+		newId++;
+	}
+
+	for(;oldId<numPreviousPairs;oldId++) {
+		// remove
+		outRemovePairs[nRemove++] = previousPairs[oldId];
+	}
+
+	result.outNewPairs = outNewPairs;
+	result.outKeepPairs = outKeepPairs;
+	result.outRemovePairs = outRemovePairs;
+	result.numOutNewPairs = nNew;
+	result.numOutKeepPairs = nKeep;
+	result.numOutRemovePairs = nRemove;
+
+	SCE_PFX_POP_MARKER();
+
+	SCE_PFX_POP_MARKER();
+
+	return SCE_PFX_OK;
+}
+
+} //namespace PhysicsEffects
+} //namespace sce
@@ -0,0 +1,112 @@
+/*
+Physics Effects Copyright(C) 2011 Sony Computer Entertainment Inc.
+All rights reserved.
+
+Physics Effects is open software; you can redistribute it and/or
+modify it under the terms of the BSD License.
+
+Physics Effects is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+See the BSD License for more details.
+
+A copy of the BSD License is distributed with
+Physics Effects under the filename: physics_effects_license.txt
+*/
+
+#ifndef _SCE_PFX_INCREMENTAL_BROADPHASE_H_
+#define _SCE_PFX_INCREMENTAL_BROADPHASE_H_
+
+#include "pfx_broadphase.h"
+
+namespace sce {
+namespace PhysicsEffects {
+
+///////////////////////////////////////////////////////////////////////////////
+// Incremental Broadphase
+
+//J ＜補足＞
+//J 3軸の端点リストをフレーム間で保持し、挿入ソートで差分だけを更新する。
+//J 端点の入れ替わりから直接ペアの追加と削除を検出するため、剛体の動きが小さい場合は
+//J pfxUpdateBroadphaseProxies + pfxFindPairs + pfxDecomposePairs より高速に動作する。
+//J 出力はpfxDecomposePairsと同じ形式（新規/維持/廃棄）で、ペアの集合も一致する。
+//J 剛体IDは剛体配列のインデックスと一致していること。
+//J 剛体数、ワールドの大きさが変わった場合は自動的に再構築される。
+
+//E <Notes>
+//E Keeps endpoint lists of all three axes across frames and updates them with an
+//E insertion sort. New and removed pairs are detected directly from swapped endpoints,
+//E so it runs faster than pfxUpdateBroadphaseProxies + pfxFindPairs + pfxDecomposePairs
+//E when rigid bodies move little between frames.
+//E The output has the same form as pfxDecomposePairs (new / keep / remove) and
+//E contains the same set of pairs.
+//E Rigid body IDs must be equal to indices of the rigid body arrays.
+//E The lists are rebuilt automatically when the number of rigid bodies or the world size changes.
+
+struct PfxIncrementalBroadphaseEndpoint {
+	PfxUInt32 key; // (quantized value << 1) | isMax
+	PfxUInt32 id;  // rigid body index
+};
+
+struct PfxIncrementalBroadphase {
+	PfxUInt32 maxRigidBodies;
+	PfxUInt32 maxPairs;
+	PfxUInt32 maxEvents;
+	PfxUInt32 numRigidBodies;
+	PfxUInt32 numPairs;
+	PfxUInt32 pairSwap;
+	PfxBool needsRebuild;
+	PfxVector3 worldCenter;
+	PfxVector3 worldExtent;
+	PfxBroadphaseProxy *proxies;
+	PfxIncrementalBroadphaseEndpoint *endpoints[3];
+	PfxUInt32 *positions[3]; // Index of min and max endpoints of each rigid body
+	PfxBroadphasePair *pairs[2]; // All overlapped pairs sorted by key (filters are not applied)
+	PfxBroadphasePair *events;
+	PfxBroadphasePair *sortBuff;
+};
+
+PfxUInt32 pfxGetBytesOfIncrementalBroadphase(PfxUInt32 maxRigidBodies,PfxUInt32 maxPairs);
+
+PfxInt32 pfxInitializeIncrementalBroadphase(PfxIncrementalBroadphase &broadphase,void *buff,PfxUInt32 bytes,PfxUInt32 maxRigidBodies,PfxUInt32 maxPairs);
+
+//J 次の更新で端点リストを再構築させる
+//E Forces the endpoint lists to be rebuilt at the next update
+void pfxResetIncrementalBroadphase(PfxIncrementalBroadphase &broadphase);
+
+struct PfxUpdateIncrementalBroadphaseParam {
+	void *pairBuff;
+	PfxUInt32 pairBytes;
+	PfxBroadphasePair *previousPairs;
+	PfxUInt32 numPreviousPairs;
+	PfxRigidState *offsetRigidStates;
+	PfxCollidable *offsetCollidables;
+	PfxUInt32 numRigidBodies;
+	PfxUInt32 outOfWorldBehavior;
+	PfxVector3 worldCenter;
+	PfxVector3 worldExtent;
+
+	PfxUpdateIncrementalBroadphaseParam() : outOfWorldBehavior(0) {}
+};
+
+struct PfxUpdateIncrementalBroadphaseResult {
+	PfxBroadphasePair *outNewPairs;
+	PfxUInt32 numOutNewPairs;
+	PfxBroadphasePair *outKeepPairs;
+	PfxUInt32 numOutKeepPairs;
+	PfxBroadphasePair *outRemovePairs;
+	PfxUInt32 numOutRemovePairs;
+	PfxInt32 numOutOfWorldProxies;
+	PfxUInt32 numSwaps;
+	PfxBool rebuilt;
+};
+
+PfxUInt32 pfxGetPairBytesOfUpdateIncrementalBroadphase(PfxUInt32 numPreviousPairs,PfxUInt32 maxPairs);
+
+//J SCE_PFX_ERR_OUT_OF_MAX_PAIRSが返された場合は、より大きなmaxPairsで初期化し直すこと
+//E Initialize again with larger maxPairs if SCE_PFX_ERR_OUT_OF_MAX_PAIRS is returned
+PfxInt32 pfxUpdateIncrementalBroadphase(PfxIncrementalBroadphase &broadphase,PfxUpdateIncrementalBroadphaseParam &param,PfxUpdateIncrementalBroadphaseResult &result);
+
+} //namespace PhysicsEffects
+} //namespace sce
+#endif /* _SCE_PFX_INCREMENTAL_BROADPHASE_H_ */
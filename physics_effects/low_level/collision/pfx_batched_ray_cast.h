@@ -32,6 +32,17 @@ void pfxCastRays(PfxRayInput *rayInputs,PfxRayOutput *rayOutputs,int numRays,Pfx
 
 void pfxCastRays(PfxRayInput *rayInputs,PfxRayOutput *rayOutputs,int numRays,PfxRayCastParam &param,PfxTaskManager *taskManager);
 
+//J レイパケットによるレイキャスト
+//J 探索方向と位置が近いレイを4本ずつまとめてpfxCastRayPacketで判定する
+//J 結果はpfxCastRaysと同じで、rayOutputsの順序も入力と同じ
+//E Ray casting with ray packets
+//E Rays with the same traverse direction and close positions are cast 4 at a time with pfxCastRayPacket
+//E The results are the same as pfxCastRays, in the same order as the input
+
+void pfxCastRayPackets(PfxRayInput *rayInputs,PfxRayOutput *rayOutputs,int numRays,PfxRayCastParam &param);
+
+void pfxCastRayPackets(PfxRayInput *rayInputs,PfxRayOutput *rayOutputs,int numRays,PfxRayCastParam &param,PfxTaskManager *taskManager);
+
 } //namespace PhysicsEffects
 } //namespace sce
 
@@ -0,0 +1,108 @@
+/*
+Physics Effects Copyright(C) 2011 Sony Computer Entertainment Inc.
+All rights reserved.
+
+Physics Effects is open software; you can redistribute it and/or
+modify it under the terms of the BSD License.
+
+Physics Effects is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+See the BSD License for more details.
+
+A copy of the BSD License is distributed with
+Physics Effects under the filename: physics_effects_license.txt
+*/
+
+#include "base_level/base/pfx_perf_counter.h"
+#include "low_level/collision/pfx_batched_ray_cast.h"
+
+namespace sce {
+namespace PhysicsEffects {
+
+void pfxCastRaysStart(PfxRayInput *rayInputs,PfxRayOutput *rayOutputs,int numRays,PfxRayCastParam &param);
+void pfxCastRayPacketsStart(PfxRayInput *rayInputs,PfxRayOutput *rayOutputs,int numRays,PfxRayCastParam &param);
+
+///////////////////////////////////////////////////////////////////////////////
+// MULTI THREAD
+
+struct PfxCastRaysIO {
+	PfxRayInput *rayInputs;
+	PfxRayOutput *rayOutputs;
+	PfxRayCastParam *param;
+};
+
+void pfxCastRaysTaskEntry(PfxTaskArg *arg)
+{
+	PfxCastRaysIO *io = (PfxCastRaysIO*)arg->io;
+	PfxUInt32 start = arg->data[0];
+	PfxUInt32 num = arg->data[1];
+
+	pfxCastRaysStart(io->rayInputs+start,io->rayOutputs+start,(int)num,*io->param);
+}
+
+void pfxCastRayPacketsTaskEntry(PfxTaskArg *arg)
+{
+	PfxCastRaysIO *io = (PfxCastRaysIO*)arg->io;
+	PfxUInt32 start = arg->data[0];
+	PfxUInt32 num = arg->data[1];
+
+	pfxCastRayPacketsStart(io->rayInputs+start,io->rayOutputs+start,(int)num,*io->param);
+}
+
+static
+void pfxCastRaysParallel(PfxRayInput *rayInputs,PfxRayOutput *rayOutputs,int numRays,PfxRayCastParam &param,PfxTaskManager *taskManager,void *taskEntry)
+{
+	SCE_PFX_ALWAYS_ASSERT(SCE_PFX_PTR_IS_ALIGNED16(param.proxiesX));
+	SCE_PFX_ALWAYS_ASSERT(SCE_PFX_PTR_IS_ALIGNED16(param.proxiesY));
+	SCE_PFX_ALWAYS_ASSERT(SCE_PFX_PTR_IS_ALIGNED16(param.proxiesZ));
+	SCE_PFX_ALWAYS_ASSERT(SCE_PFX_PTR_IS_ALIGNED16(param.proxiesXb));
+	SCE_PFX_ALWAYS_ASSERT(SCE_PFX_PTR_IS_ALIGNED16(param.proxiesYb));
+	SCE_PFX_ALWAYS_ASSERT(SCE_PFX_PTR_IS_ALIGNED16(param.proxiesZb));
+	SCE_PFX_ALWAYS_ASSERT(SCE_PFX_PTR_IS_ALIGNED16(param.offsetRigidStates));
+	SCE_PFX_ALWAYS_ASSERT(SCE_PFX_PTR_IS_ALIGNED16(param.offsetCollidables));
+	SCE_PFX_ALWAYS_ASSERT(taskManager);
+
+	PfxCastRaysIO *io = (PfxCastRaysIO*)taskManager->allocate(sizeof(PfxCastRaysIO));
+	io->rayInputs = rayInputs;
+	io->rayOutputs = rayOutputs;
+	io->param = &param;
+
+	PfxUInt32 numTasks = taskManager->getNumTasks();
+	taskManager->setTaskEntry(taskEntry);
+
+	for(PfxUInt32 t=0;t<numTasks;t++) {
+		PfxUInt32 start = (PfxUInt32)numRays*t/numTasks;
+		PfxUInt32 end = (PfxUInt32)numRays*(t+1)/numTasks;
+		taskManager->startTask(t,io,start,end-start,0,0);
+	}
+
+	for(PfxUInt32 t=0;t<numTasks;t++) {
+		int taskId;
+		PfxUInt32 data1,data2,data3,data4;
+		taskManager->waitTask(taskId,data1,data2,data3,data4);
+	}
+
+	taskManager->deallocate(io);
+}
+
+void pfxCastRays(PfxRayInput *rayInputs,PfxRayOutput *rayOutputs,int numRays,PfxRayCastParam &param,PfxTaskManager *taskManager)
+{
+	SCE_PFX_PUSH_MARKER("pfxCastRays");
+	
+	pfxCastRaysParallel(rayInputs,rayOutputs,numRays,param,taskManager,(void*)pfxCastRaysTaskEntry);
+	
+	SCE_PFX_POP_MARKER();
+}
+
+void pfxCastRayPackets(PfxRayInput *rayInputs,PfxRayOutput *rayOutputs,int numRays,PfxRayCastParam &param,PfxTaskManager *taskManager)
+{
+	SCE_PFX_PUSH_MARKER("pfxCastRayPackets");
+	
+	pfxCastRaysParallel(rayInputs,rayOutputs,numRays,param,taskManager,(void*)pfxCastRayPacketsTaskEntry);
+	
+	SCE_PFX_POP_MARKER();
+}
+
+} //namespace PhysicsEffects
+} //namespace sce
@@ -15,6 +15,8 @@ Physics Effects under the filename: physics_effects_license.txt
 */
 
 #include "low_level/collision/pfx_batched_ray_cast.h"
+#include "base_level/base/pfx_vec_utils.h"
+#include "base_level/sort/pfx_sort.h"
 
 namespace sce {
 namespace PhysicsEffects {
@@ -43,5 +45,67 @@ void pfxCastRays(PfxRayInput *rayInputs,PfxRayOutput *rayOutputs,int numRays,Pfx
 	pfxCastRaysStart(rayInputs,rayOutputs,numRays,param);
 }
 
+///////////////////////////////////////////////////////////////////////////////
+// SINGLE THREAD (RAY PACKET)
+
+// 一度に並べ替えるレイの数
+#define SCE_PFX_RAY_PACKET_SORT_WINDOW 256
+
+static inline
+PfxUInt32 pfxSpreadBits9(PfxUInt32 x)
+{
+	x &= 0x1ff;
+	x = (x | (x << 16)) & 0x030000ff;
+	x = (x | (x <<  8)) & 0x0300f00f;
+	x = (x | (x <<  4)) & 0x030c30c3;
+	x = (x | (x <<  2)) & 0x09249249;
+	return x;
+}
+
+void pfxCastRayPacketsStart(PfxRayInput *rayInputs,PfxRayOutput *rayOutputs,int numRays,PfxRayCastParam &param)
+{
+	PfxSortData16 sortData[SCE_PFX_RAY_PACKET_SORT_WINDOW];
+	PfxSortData16 sortBuff[SCE_PFX_RAY_PACKET_SORT_WINDOW];
+	
+	for(int start=0;start<numRays;start+=SCE_PFX_RAY_PACKET_SORT_WINDOW) {
+		int num = SCE_PFX_MIN(numRays-start,SCE_PFX_RAY_PACKET_SORT_WINDOW);
+		
+		// 探索方向（上位3ビット）とレイの中点のモートンコード（下位27ビット）で並べ替える
+		for(int i=0;i<num;i++) {
+			const PfxRayInput &ray = rayInputs[start+i];
+			PfxVecInt3 p = pfxConvertCoordWorldToLocal(ray.m_startPosition + 0.5f * ray.m_direction,param.rangeCenter,param.rangeExtent);
+			PfxUInt32 morton = pfxSpreadBits9(p.getX()>>7) | (pfxSpreadBits9(p.getY()>>7)<<1) | (pfxSpreadBits9(p.getZ()>>7)<<2);
+			sortData[i].set32(0,start+i);
+			pfxSetKey(sortData[i],(pfxGetRayTraverseDirection(ray)<<27) | morton);
+		}
+		pfxSort(sortData,sortBuff,num);
+		
+		// 探索方向が同じレイを4本ずつ判定
+		for(int i=0;i<num;) {
+			PfxUInt32 rayIds[SCE_PFX_RAY_PACKET_SIZE];
+			PfxUInt32 direction = pfxGetKey(sortData[i])>>27;
+			PfxUInt32 n = 0;
+			while(i < num && n < SCE_PFX_RAY_PACKET_SIZE && (pfxGetKey(sortData[i])>>27) == direction) {
+				rayIds[n++] = sortData[i++].get32(0);
+			}
+			pfxCastRayPacket(rayInputs,rayOutputs,rayIds,n,param);
+		}
+	}
+}
+
+void pfxCastRayPackets(PfxRayInput *rayInputs,PfxRayOutput *rayOutputs,int numRays,PfxRayCastParam &param)
+{
+	SCE_PFX_ALWAYS_ASSERT(SCE_PFX_PTR_IS_ALIGNED16(param.proxiesX));
+	SCE_PFX_ALWAYS_ASSERT(SCE_PFX_PTR_IS_ALIGNED16(param.proxiesY));
+	SCE_PFX_ALWAYS_ASSERT(SCE_PFX_PTR_IS_ALIGNED16(param.proxiesZ));
+	SCE_PFX_ALWAYS_ASSERT(SCE_PFX_PTR_IS_ALIGNED16(param.proxiesXb));
+	SCE_PFX_ALWAYS_ASSERT(SCE_PFX_PTR_IS_ALIGNED16(param.proxiesYb));
+	SCE_PFX_ALWAYS_ASSERT(SCE_PFX_PTR_IS_ALIGNED16(param.proxiesZb));
+	SCE_PFX_ALWAYS_ASSERT(SCE_PFX_PTR_IS_ALIGNED16(param.offsetRigidStates));
+	SCE_PFX_ALWAYS_ASSERT(SCE_PFX_PTR_IS_ALIGNED16(param.offsetCollidables));
+	
+	pfxCastRayPacketsStart(rayInputs,rayOutputs,numRays,param);
+}
+
 } //namespace PhysicsEffects
 } //namespace sce
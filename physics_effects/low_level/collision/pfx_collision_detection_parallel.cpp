@@ -0,0 +1,149 @@
+/*
+Physics Effects Copyright(C) 2011 Sony Computer Entertainment Inc.
+All rights reserved.
+
+Physics Effects is open software; you can redistribute it and/or
+modify it under the terms of the BSD License.
+
+Physics Effects is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+See the BSD License for more details.
+
+A copy of the BSD License is distributed with
+Physics Effects under the filename: physics_effects_license.txt
+*/
+
+#include "base_level/base/pfx_perf_counter.h"
+#include "base_level/collision/pfx_shape_iterator.h"
+#include "low_level/collision/pfx_collision_detection.h"
+#include "base_level/broadphase/pfx_check_collidable.h"
+#include "base_level/collision/pfx_contact_cache.h"
+#include "pfx_detect_collision_func.h"
+
+namespace sce {
+namespace PhysicsEffects {
+
+int pfxCheckParamOfDetectCollision(PfxDetectCollisionParam &param);
+
+///////////////////////////////////////////////////////////////////////////////
+// MULTI THREAD
+
+#define SCE_PFX_CONTACT_THRESHOLD 0.0f
+
+//J 各ペアは異なるコンタクトマニフォールドを参照するため、ペア単位で分割すればロックは不要
+//E Each pair refers to its own contact manifold, so splitting by pairs needs no locking
+
+struct PfxDetectCollisionIO {
+	PfxConstraintPair *contactPairs;
+	PfxContactManifold *offsetContactManifolds;
+	PfxRigidState *offsetRigidStates;
+	PfxCollidable *offsetCollidables;
+};
+
+void pfxDetectCollisionTaskEntry(PfxTaskArg *arg)
+{
+	PfxDetectCollisionIO *io = (PfxDetectCollisionIO*)arg->io;
+	PfxUInt32 start = arg->data[0];
+	PfxUInt32 num = arg->data[1];
+
+	for(PfxUInt32 i=start;i<start+num;i++) {
+		const PfxBroadphasePair &pair = io->contactPairs[i];
+		if(!pfxCheckCollidableInCollision(pair)) {
+			continue;
+		}
+
+		PfxUInt32 iContact = pfxGetContactId(pair);
+		PfxUInt32 iA = pfxGetObjectIdA(pair);
+		PfxUInt32 iB = pfxGetObjectIdB(pair);
+
+		PfxContactManifold &contact = io->offsetContactManifolds[iContact];
+
+		SCE_PFX_ALWAYS_ASSERT(iA==contact.getRigidBodyIdA());
+		SCE_PFX_ALWAYS_ASSERT(iB==contact.getRigidBodyIdB());
+
+		PfxRigidState &stateA = io->offsetRigidStates[iA];
+		PfxRigidState &stateB = io->offsetRigidStates[iB];
+		PfxCollidable &collA = io->offsetCollidables[iA];
+		PfxCollidable &collB = io->offsetCollidables[iB];
+		PfxTransform3 tA0(stateA.getOrientation(), stateA.getPosition());
+		PfxTransform3 tB0(stateB.getOrientation(), stateB.getPosition());
+
+		PfxContactCache contactCache;
+
+		PfxShapeIterator itrShapeA(collA);
+		for(PfxUInt32 j=0;j<collA.getNumShapes();j++,++itrShapeA) {
+			const PfxShape &shapeA = *itrShapeA;
+			PfxTransform3 offsetTrA = shapeA.getOffsetTransform();
+			PfxTransform3 worldTrA = tA0 * offsetTrA;
+
+			PfxShapeIterator itrShapeB(collB);
+			for(PfxUInt32 k=0;k<collB.getNumShapes();k++,++itrShapeB) {
+				const PfxShape &shapeB = *itrShapeB;
+				PfxTransform3 offsetTrB = shapeB.getOffsetTransform();
+				PfxTransform3 worldTrB = tB0 * offsetTrB;
+
+				if( (shapeA.getContactFilterSelf()&shapeB.getContactFilterTarget()) &&
+				    (shapeA.getContactFilterTarget()&shapeB.getContactFilterSelf()) ) {
+					pfxGetDetectCollisionFunc(shapeA.getType(),shapeB.getType())(
+						contactCache,
+						shapeA,offsetTrA,worldTrA,j,
+						shapeB,offsetTrB,worldTrB,k,
+						SCE_PFX_CONTACT_THRESHOLD);
+				}
+			}
+		}
+
+		for(int j=0;j<contactCache.getNumContacts();j++) {
+			const PfxCachedContactPoint &cp = contactCache.getContactPoint(j);
+
+			contact.addContactPoint(
+				cp.m_distance,
+				cp.m_normal,
+				cp.m_localPointA,
+				cp.m_localPointB,
+				cp.m_subData
+				);
+		}
+	}
+}
+
+PfxInt32 pfxDetectCollision(PfxDetectCollisionParam &param,PfxTaskManager *taskManager)
+{
+	PfxInt32 ret = pfxCheckParamOfDetectCollision(param);
+	if(ret != SCE_PFX_OK)
+		return ret;
+	if(!taskManager) return SCE_PFX_ERR_INVALID_VALUE;
+
+	SCE_PFX_PUSH_MARKER("pfxDetectCollision");
+
+	PfxDetectCollisionIO *io = (PfxDetectCollisionIO*)taskManager->allocate(sizeof(PfxDetectCollisionIO));
+	io->contactPairs = param.contactPairs;
+	io->offsetContactManifolds = param.offsetContactManifolds;
+	io->offsetRigidStates = param.offsetRigidStates;
+	io->offsetCollidables = param.offsetCollidables;
+
+	PfxUInt32 numTasks = taskManager->getNumTasks();
+	taskManager->setTaskEntry((void*)pfxDetectCollisionTaskEntry);
+
+	for(PfxUInt32 t=0;t<numTasks;t++) {
+		PfxUInt32 start = param.numContactPairs*t/numTasks;
+		PfxUInt32 end = param.numContactPairs*(t+1)/numTasks;
+		taskManager->startTask(t,io,start,end-start,0,0);
+	}
+
+	for(PfxUInt32 t=0;t<numTasks;t++) {
+		int taskId;
+		PfxUInt32 data1,data2,data3,data4;
+		taskManager->waitTask(taskId,data1,data2,data3,data4);
+	}
+
+	taskManager->deallocate(io);
+
+	SCE_PFX_POP_MARKER();
+
+	return SCE_PFX_OK;
+}
+
+} //namespace PhysicsEffects
+} //namespace sce
@@ -106,6 +106,45 @@ PfxIntersectRayFunc funcTbl_intersectRay[kPfxShapeCount] = {
 	intersectRayFuncDummy,
 };
 
+///////////////////////////////////////////////////////////////////////////////
+// Ray Packet Intersection Function Table
+
+PfxUInt32 intersectRayPacketFuncBox(
+				const PfxRayPacket &packet,PfxUInt32 laneMask,PfxRayOutput *out,
+				const PfxShape &shape,const PfxTransform3 &transform)
+{
+	return pfxIntersectRayPacketBox(packet,laneMask,out,shape.getBox(),transform);
+}
+
+PfxUInt32 intersectRayPacketFuncSphere(
+				const PfxRayPacket &packet,PfxUInt32 laneMask,PfxRayOutput *out,
+				const PfxShape &shape,const PfxTransform3 &transform)
+{
+	return pfxIntersectRayPacketSphere(packet,laneMask,out,shape.getSphere(),transform);
+}
+
+PfxUInt32 intersectRayPacketFuncCapsule(
+				const PfxRayPacket &packet,PfxUInt32 laneMask,PfxRayOutput *out,
+				const PfxShape &shape,const PfxTransform3 &transform)
+{
+	return pfxIntersectRayPacketCapsule(packet,laneMask,out,shape.getCapsule(),transform);
+}
+
+PfxIntersectRayPacketFunc funcTbl_intersectRayPacket[kPfxShapeCount] = {
+	intersectRayPacketFuncSphere,
+	intersectRayPacketFuncBox,
+	intersectRayPacketFuncCapsule,
+	NULL,
+	NULL,
+	NULL,
+	NULL,
+	NULL,
+	NULL,
+	NULL,
+	NULL,
+	NULL,
+};
+
 ///////////////////////////////////////////////////////////////////////////////
 // Ray Intersection Function Table Interface
 
@@ -121,6 +160,23 @@ PfxInt32 pfxSetIntersectRayFunc(PfxUInt8 shapeType,PfxIntersectRayFunc func)
 	}
 	
 	funcTbl_intersectRay[shapeType] = func;
+	funcTbl_intersectRayPacket[shapeType] = NULL;
+	
+	return SCE_PFX_OK;
+}
+
+PfxIntersectRayPacketFunc pfxGetIntersectRayPacketFunc(PfxUInt8 shapeType)
+{
+	return funcTbl_intersectRayPacket[shapeType];
+}
+
+PfxInt32 pfxSetIntersectRayPacketFunc(PfxUInt8 shapeType,PfxIntersectRayPacketFunc func)
+{
+	if(shapeType >= kPfxShapeCount) {
+		return SCE_PFX_ERR_OUT_OF_RANGE;
+	}
+	
+	funcTbl_intersectRayPacket[shapeType] = func;
 	
 	return SCE_PFX_OK;
 }
@@ -18,6 +18,7 @@ Physics Effects under the filename: physics_effects_license.txt
 #define _SCE_PFX_INTERSECT_RAY_FUNC_H
 
 #include "base_level/collision/pfx_ray.h"
+#include "base_level/collision/pfx_ray_packet.h"
 
 namespace sce {
 namespace PhysicsEffects {
@@ -30,6 +31,22 @@ PfxIntersectRayFunc pfxGetIntersectRayFunc(PfxUInt8 shapeType);
 
 PfxInt32 pfxSetIntersectRayFunc(PfxUInt8 shapeType,PfxIntersectRayFunc func);
 
+//J レイパケット用の判定関数
+//J laneMaskのレーンのみ判定し、outを更新したレーンのマスクを返す
+//J NULLの形状は各レイごとにPfxIntersectRayFuncで判定される
+//E Intersection functions for ray packets
+//E Only lanes in laneMask are tested. Returns the mask of lanes whose out was updated.
+//E Shapes with NULL are tested ray by ray with PfxIntersectRayFunc
+typedef PfxUInt32 (*PfxIntersectRayPacketFunc)(
+				const PfxRayPacket &packet,PfxUInt32 laneMask,PfxRayOutput *out,
+				const PfxShape &shape,const PfxTransform3 &transform);
+
+PfxIntersectRayPacketFunc pfxGetIntersectRayPacketFunc(PfxUInt8 shapeType);
+
+//J pfxSetIntersectRayFuncで判定関数を置き換えた形状は、パケット用の関数がNULLに戻される
+//E pfxSetIntersectRayFunc resets the packet function of the shape type to NULL
+PfxInt32 pfxSetIntersectRayPacketFunc(PfxUInt8 shapeType,PfxIntersectRayPacketFunc func);
+
 } //namespace PhysicsEffects
 } //namespace sce
 
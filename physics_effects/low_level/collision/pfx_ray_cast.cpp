@@ -18,6 +18,7 @@ Physics Effects under the filename: physics_effects_license.txt
 #include "low_level/collision/pfx_ray_cast.h"
 #include "base_level/collision/pfx_shape_iterator.h"
 #include "pfx_intersect_ray_func.h"
+#include "base_level/base/pfx_vec_float4.h"
 #include "base_level/collision/pfx_intersect_common.h"
 
 
@@ -224,5 +225,225 @@ void pfxCastSingleRay(const PfxRayInput &ray,PfxRayOutput &out,const PfxRayCastP
 	}
 }
 
+PfxUInt32 pfxGetRayTraverseDirection(const PfxRayInput &ray)
+{
+	// pfxCastSingleRayと同じ規則で探索軸と方向を決める
+	PfxVector3 chkAxisVec = absPerElem(ray.m_direction);
+	int axis = 0;
+	if(chkAxisVec[1] < chkAxisVec[0]) axis = 1;
+	if(chkAxisVec[2] < chkAxisVec[axis]) axis = 2;
+	
+	return ray.m_direction[axis] < 0.0f ? axis+3 : axis;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Ray Packet
+
+// pfxConvertCoordLocalToWorldの1要素のみを計算する
+static SCE_PFX_FORCE_INLINE
+PfxFloat pfxConvertCoordLocalToWorld(PfxUInt16 coord,PfxFloat center,PfxFloat half)
+{
+	PfxFloat q = (PfxFloat)coord / 65535.0f;
+	return q * (2.0f * half) + center - half;
+}
+
+// pfxRayTraverseForward/Backwardと同じ順序でプロキシを探索し、各レイの判定結果も同じになる
+// 終了条件はレイ毎に判定し、全てのレイが終了した時点で探索を打ち切る
+static
+void pfxRayPacketTraverse(
+	const PfxRayPacket &packet,PfxRayOutput **out,
+	const PfxFloat4 *rayMin,const PfxFloat4 *rayMax,
+	PfxBroadphaseProxy *proxies,int numProxies,
+	PfxRigidState *offsetRigidStates,
+	PfxCollidable *offsetCollidables,
+	int axis,PfxBool forward,const PfxVector3 &center,const PfxVector3 &half)
+{
+	PfxUInt32 activeMask = packet.getLaneMask();
+	PfxFloat4 variable(out[0]->m_variable,out[1]->m_variable,out[2]->m_variable,out[3]->m_variable);
+	PfxFloat4 boundOnRay = packet.m_startPosition[axis] + variable * packet.m_direction[axis];
+	
+	for(int n=0;n<numProxies;n++) {
+		PfxBroadphaseProxy &proxy = proxies[forward ? n : numProxies-1-n];
+		
+		PfxFloat4 proxyMin((PfxFloat)pfxGetXYZMin(proxy,axis));
+		PfxFloat4 proxyMax((PfxFloat)pfxGetXYZMax(proxy,axis));
+		
+		// 終了条件のチェック
+		PfxFloat4 finished;
+		if(forward) {
+			finished = pfxCmpLt(rayMax[axis],proxyMin);
+			finished = pfxOr(finished,pfxCmpLt(boundOnRay,PfxFloat4(pfxConvertCoordLocalToWorld(pfxGetXYZMin(proxy,axis),center[axis],half[axis]))));
+		}
+		else {
+			finished = pfxCmpLt(proxyMax,rayMin[axis]);
+			finished = pfxOr(finished,pfxCmpLt(PfxFloat4(pfxConvertCoordLocalToWorld(pfxGetXYZMax(proxy,axis),center[axis],half[axis])),boundOnRay));
+		}
+		activeMask &= ~pfxMoveMask(finished);
+		if(!activeMask) return;
+		
+		// スキップ
+		PfxFloat4 skip = forward ? pfxCmpLt(proxyMax,rayMin[axis]) : pfxCmpLt(rayMax[axis],proxyMin);
+		PfxUInt32 testMask = activeMask & ~pfxMoveMask(skip);
+		if(!testMask) continue;
+		
+		// レイのAABBとプロキシのAABBの交差判定
+		PfxFloat4 reject = skip;
+		for(int k=0;k<3;k++) {
+			reject = pfxOr(reject,pfxOr(
+				pfxCmpLt(rayMax[k],PfxFloat4((PfxFloat)pfxGetXYZMin(proxy,k))),
+				pfxCmpGt(rayMin[k],PfxFloat4((PfxFloat)pfxGetXYZMax(proxy,k)))));
+		}
+		testMask &= ~pfxMoveMask(reject);
+		if(!testMask) continue;
+		
+		// レイとプロキシのAABBの交差判定
+		PfxVector3 AABBmin = pfxConvertCoordLocalToWorld(PfxVecInt3((PfxInt32)pfxGetXMin(proxy),(PfxInt32)pfxGetYMin(proxy),(PfxInt32)pfxGetZMin(proxy)),center,half);
+		PfxVector3 AABBmax = pfxConvertCoordLocalToWorld(PfxVecInt3((PfxInt32)pfxGetXMax(proxy),(PfxInt32)pfxGetYMax(proxy),(PfxInt32)pfxGetZMax(proxy)),center,half);
+		PfxVector3 AABBcenter = (AABBmax+AABBmin)*0.5f;
+		PfxVector3 AABBhalf = (AABBmax-AABBmin)*0.5f;
+		PfxFloat4 tmin[3],t_;
+		reject = pfxIntersectRayPacketAABBFast(packet.m_startPosition,packet.m_direction,AABBcenter-AABBhalf,AABBcenter+AABBhalf,tmin,t_);
+		testMask &= pfxMoveMask(pfxCmpLt(t_,variable)) & ~pfxMoveMask(reject);
+		if(!testMask) continue;
+		
+		// フィルタ
+		PfxUInt16 rigidbodyId = pfxGetObjectId(proxy);
+		PfxUInt32 contactFilterSelf = pfxGetSelf(proxy);
+		PfxUInt32 contactFilterTarget = pfxGetTarget(proxy);
+		
+		for(PfxUInt32 i=0;i<SCE_PFX_RAY_PACKET_SIZE;i++) {
+			const PfxRayInput &ray = *packet.m_rays[i];
+			if(!((ray.m_contactFilterSelf&contactFilterTarget) && (ray.m_contactFilterTarget&contactFilterSelf))) {
+				testMask &= ~(1<<i);
+			}
+		}
+		if(!testMask) continue;
+		
+		PfxRigidState &state = offsetRigidStates[rigidbodyId];
+		PfxCollidable &coll = offsetCollidables[rigidbodyId];
+		PfxTransform3 transform(state.getOrientation(), state.getPosition());
+		
+		PfxRayOutput tout[SCE_PFX_RAY_PACKET_SIZE];
+		for(PfxUInt32 i=0;i<SCE_PFX_RAY_PACKET_SIZE;i++) {
+			tout[i] = *out[i];
+		}
+		
+		PfxUInt32 updateMask = 0;
+		PfxShapeIterator itrShape(coll);
+		for(PfxUInt32 j=0;j<coll.getNumShapes();j++,++itrShape) {
+			const PfxShape &shape = *itrShape;
+			PfxTransform3 shapeTr = transform * shape.getOffsetTransform();
+			
+			PfxUInt32 hitMask = 0;
+			PfxIntersectRayPacketFunc packetFunc = pfxGetIntersectRayPacketFunc(shape.getType());
+			if(packetFunc) {
+				hitMask = packetFunc(packet,testMask,tout,shape,shapeTr);
+			}
+			else {
+				PfxIntersectRayFunc func = pfxGetIntersectRayFunc(shape.getType());
+				for(PfxUInt32 i=0;i<SCE_PFX_RAY_PACKET_SIZE;i++) {
+					if((testMask & (1<<i)) && func(*packet.m_rays[i],tout[i],shape,shapeTr)) {
+						hitMask |= 1<<i;
+					}
+				}
+			}
+			
+			for(PfxUInt32 i=0;i<SCE_PFX_RAY_PACKET_SIZE;i++) {
+				if((hitMask & (1<<i)) && tout[i].m_variable < out[i]->m_variable) {
+					*out[i] = tout[i];
+					out[i]->m_shapeId = j;
+					out[i]->m_objectId = rigidbodyId;
+					updateMask |= 1<<i;
+				}
+			}
+		}
+		
+		if(updateMask) {
+			variable = PfxFloat4(out[0]->m_variable,out[1]->m_variable,out[2]->m_variable,out[3]->m_variable);
+			boundOnRay = packet.m_startPosition[axis] + variable * packet.m_direction[axis];
+		}
+	}
+}
+
+void pfxCastRayPacket(const PfxRayInput *rayInputs,PfxRayOutput *rayOutputs,const PfxUInt32 *rayIds,PfxUInt32 numRays,const PfxRayCastParam &param)
+{
+	SCE_PFX_ASSERT(numRays <= SCE_PFX_RAY_PACKET_SIZE);
+	SCE_PFX_ASSERT(SCE_PFX_PTR_IS_ALIGNED16(param.proxiesX));
+	SCE_PFX_ASSERT(SCE_PFX_PTR_IS_ALIGNED16(param.proxiesY));
+	SCE_PFX_ASSERT(SCE_PFX_PTR_IS_ALIGNED16(param.proxiesZ));
+	SCE_PFX_ASSERT(SCE_PFX_PTR_IS_ALIGNED16(param.proxiesXb));
+	SCE_PFX_ASSERT(SCE_PFX_PTR_IS_ALIGNED16(param.proxiesYb));
+	SCE_PFX_ASSERT(SCE_PFX_PTR_IS_ALIGNED16(param.proxiesZb));
+	SCE_PFX_ASSERT(SCE_PFX_PTR_IS_ALIGNED16(param.offsetRigidStates));
+	SCE_PFX_ASSERT(SCE_PFX_PTR_IS_ALIGNED16(param.offsetCollidables));
+	
+	if(numRays == 0) return;
+	
+	// 探索軸と方向が揃っていなければ1本ずつ判定
+	PfxUInt32 direction = pfxGetRayTraverseDirection(rayInputs[rayIds[0]]);
+	for(PfxUInt32 i=1;i<numRays;i++) {
+		if(pfxGetRayTraverseDirection(rayInputs[rayIds[i]]) != direction) {
+			for(PfxUInt32 j=0;j<numRays;j++) {
+				pfxCastSingleRay(rayInputs[rayIds[j]],rayOutputs[rayIds[j]],param);
+			}
+			return;
+		}
+	}
+	
+	PfxBroadphaseProxy *proxies[] = {
+		param.proxiesX,
+		param.proxiesY,
+		param.proxiesZ,
+		param.proxiesXb,
+		param.proxiesYb,
+		param.proxiesZb,
+	};
+	
+	const PfxRayInput *rays[SCE_PFX_RAY_PACKET_SIZE];
+	PfxRayOutput *out[SCE_PFX_RAY_PACKET_SIZE];
+	PfxRayOutput dummyOut[SCE_PFX_RAY_PACKET_SIZE]; // 使用しないレーン用
+	PfxFloat rayMinF[3][SCE_PFX_RAY_PACKET_SIZE],rayMaxF[3][SCE_PFX_RAY_PACKET_SIZE];
+	
+	for(PfxUInt32 i=0;i<SCE_PFX_RAY_PACKET_SIZE;i++) {
+		PfxUInt32 rayId = rayIds[SCE_PFX_MIN(i,numRays-1)];
+		rays[i] = &rayInputs[rayId];
+		out[i] = i < numRays ? &rayOutputs[rayId] : &dummyOut[i];
+		out[i]->m_variable = 1.0f;
+		out[i]->m_contactFlag = false;
+		
+		// レイのAABB作成
+		const PfxRayInput &ray = *rays[i];
+		PfxVector3 p1 = ray.m_startPosition;
+		PfxVector3 p2 = ray.m_startPosition + ray.m_direction;
+		PfxVecInt3 rayMin,rayMax;
+		pfxConvertCoordWorldToLocal(param.rangeCenter,param.rangeExtent,minPerElem(p1,p2),maxPerElem(p1,p2),rayMin,rayMax);
+		
+		// PfxAabb16に格納される値に合わせる
+		for(int k=0;k<3;k++) {
+			rayMinF[k][i] = (PfxFloat)(PfxUInt16)rayMin.get(k);
+			rayMaxF[k][i] = (PfxFloat)(PfxUInt16)rayMax.get(k);
+		}
+	}
+	
+	PfxRayPacket packet;
+	packet.set(rays,numRays);
+	
+	PfxFloat4 rayMin[3],rayMax[3];
+	for(int k=0;k<3;k++) {
+		rayMin[k] = PfxFloat4(rayMinF[k][0],rayMinF[k][1],rayMinF[k][2],rayMinF[k][3]);
+		rayMax[k] = PfxFloat4(rayMaxF[k][0],rayMaxF[k][1],rayMaxF[k][2],rayMaxF[k][3]);
+	}
+	
+	// AABB探索開始
+	int axis = direction % 3;
+	PfxBool forward = direction < 3;
+	
+	pfxRayPacketTraverse(
+		packet,out,rayMin,rayMax,
+		proxies[direction],param.numProxies,
+		param.offsetRigidStates,param.offsetCollidables,
+		axis,forward,param.rangeCenter,param.rangeExtent);
+}
+
 } //namespace PhysicsEffects
 } //namespace sce
@@ -20,6 +20,7 @@ Physics Effects under the filename: physics_effects_license.txt
 #include "../../base_level/rigidbody/pfx_rigid_state.h"
 #include "../../base_level/collision/pfx_collidable.h"
 #include "../../base_level/collision/pfx_ray.h"
+#include "../../base_level/collision/pfx_ray_packet.h"
 #include "../../base_level/broadphase/pfx_broadphase_proxy.h"
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -45,6 +46,20 @@ struct PfxRayCastParam {
 
 void pfxCastSingleRay(const PfxRayInput &rayInput,PfxRayOutput &rayOutput,const PfxRayCastParam &param);
 
+//J レイがプロキシ配列を探索する軸と向き（0～5）を返す
+//E Returns the axis and the direction (0-5) in which the ray traverses the proxy arrays
+PfxUInt32 pfxGetRayTraverseDirection(const PfxRayInput &rayInput);
+
+//J rayIdsで指定した最大4本のレイをまとめて判定し、結果をrayOutputsの同じインデックスに格納する
+//J プロキシ配列の探索は1度だけ行われ、球、ボックス、カプセルとの交差判定は4本同時に行われる
+//J 結果はpfxCastSingleRayと同じになる
+//J pfxGetRayTraverseDirectionの値が異なるレイが含まれる場合は1本ずつ判定する
+//E Casts up to 4 rays specified by rayIds together and stores the results into rayOutputs with the same indices
+//E Proxy arrays are traversed only once, and spheres, boxes and capsules are tested against 4 rays at once
+//E The results are the same as pfxCastSingleRay
+//E Rays are cast one by one if their pfxGetRayTraverseDirection differ
+void pfxCastRayPacket(const PfxRayInput *rayInputs,PfxRayOutput *rayOutputs,const PfxUInt32 *rayIds,PfxUInt32 numRays,const PfxRayCastParam &param);
+
 } //namespace PhysicsEffects
 } //namespace sce
 #endif // _SCE_PFX_RAY_CAST_H
@@ -0,0 +1,97 @@
+/*
+Physics Effects Copyright(C) 2011 Sony Computer Entertainment Inc.
+All rights reserved.
+
+Physics Effects is open software; you can redistribute it and/or
+modify it under the terms of the BSD License.
+
+Physics Effects is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+See the BSD License for more details.
+
+A copy of the BSD License is distributed with
+Physics Effects under the filename: physics_effects_license.txt
+*/
+
+#include "base_level/base/pfx_perf_counter.h"
+#include "low_level/collision/pfx_refresh_contacts.h"
+
+namespace sce {
+namespace PhysicsEffects {
+
+int pfxCheckParamOfRefreshContacts(PfxRefreshContactsParam &param);
+
+///////////////////////////////////////////////////////////////////////////////
+// MULTI THREAD
+
+struct PfxRefreshContactsIO {
+	PfxConstraintPair *contactPairs;
+	PfxContactManifold *offsetContactManifolds;
+	PfxRigidState *offsetRigidStates;
+};
+
+void pfxRefreshContactsTaskEntry(PfxTaskArg *arg)
+{
+	PfxRefreshContactsIO *io = (PfxRefreshContactsIO*)arg->io;
+	PfxUInt32 start = arg->data[0];
+	PfxUInt32 num = arg->data[1];
+
+	for(PfxUInt32 i=start;i<start+num;i++) {
+		PfxBroadphasePair &pair = io->contactPairs[i];
+
+		PfxUInt32 iContact = pfxGetContactId(pair);
+		PfxUInt32 iA = pfxGetObjectIdA(pair);
+		PfxUInt32 iB = pfxGetObjectIdB(pair);
+
+		PfxContactManifold &contact = io->offsetContactManifolds[iContact];
+
+		SCE_PFX_ALWAYS_ASSERT(iA==contact.getRigidBodyIdA());
+		SCE_PFX_ALWAYS_ASSERT(iB==contact.getRigidBodyIdB());
+
+		PfxRigidState &instA = io->offsetRigidStates[iA];
+		PfxRigidState &instB = io->offsetRigidStates[iB];
+
+		contact.refresh(
+			instA.getPosition(),instA.getOrientation(),
+			instB.getPosition(),instB.getOrientation() );
+	}
+}
+
+PfxInt32 pfxRefreshContacts(PfxRefreshContactsParam &param,PfxTaskManager *taskManager)
+{
+	PfxInt32 ret = pfxCheckParamOfRefreshContacts(param);
+	if(ret != SCE_PFX_OK) return ret;
+	if(!taskManager) return SCE_PFX_ERR_INVALID_VALUE;
+
+	SCE_PFX_PUSH_MARKER("pfxRefreshContacts");
+
+	PfxRefreshContactsIO *io = (PfxRefreshContactsIO*)taskManager->allocate(sizeof(PfxRefreshContactsIO));
+	io->contactPairs = param.contactPairs;
+	io->offsetContactManifolds = param.offsetContactManifolds;
+	io->offsetRigidStates = param.offsetRigidStates;
+
+	PfxUInt32 numTasks = taskManager->getNumTasks();
+	taskManager->setTaskEntry((void*)pfxRefreshContactsTaskEntry);
+
+	for(PfxUInt32 t=0;t<numTasks;t++) {
+		PfxUInt32 start = param.numContactPairs*t/numTasks;
+		PfxUInt32 end = param.numContactPairs*(t+1)/numTasks;
+		taskManager->startTask(t,io,start,end-start,0,0);
+	}
+
+	for(PfxUInt32 t=0;t<numTasks;t++) {
+		int taskId;
+		PfxUInt32 data1,data2,data3,data4;
+		taskManager->waitTask(taskId,data1,data2,data3,data4);
+	}
+
+	taskManager->deallocate(io);
+
+	SCE_PFX_POP_MARKER();
+
+	return SCE_PFX_OK;
+}
+
+} //namespace PhysicsEffects
+} //namespace sce
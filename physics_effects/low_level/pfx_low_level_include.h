@@ -25,6 +25,7 @@ Physics Effects under the filename: physics_effects_license.txt
 
 // Include low level headers
 #include "broadphase/pfx_broadphase.h"
+#include "broadphase/pfx_incremental_broadphase.h"
 
 #include "collision/pfx_collision_detection.h"
 #include "collision/pfx_refresh_contacts.h"
@@ -37,5 +38,7 @@ Physics Effects under the filename: physics_effects_license.txt
 
 #include "sort/pfx_parallel_sort.h"
 
+#include "task/pfx_task_manager_pthreads.h"
+
 
 #endif // _SCE_PFX_LOW_LEVEL_INCLUDE_H
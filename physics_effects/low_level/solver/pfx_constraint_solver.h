@@ -25,6 +25,7 @@ Physics Effects under the filename: physics_effects_license.txt
 #include "../../base_level/collision/pfx_contact_manifold.h"
 
 #include "../task/pfx_task_manager.h"
+#include "pfx_parallel_group.h"
 
 namespace sce {
 namespace PhysicsEffects {
@@ -43,6 +44,27 @@ PfxInt32 pfxSetupSolverBodies(PfxSetupSolverBodiesParam &param);
 
 PfxInt32 pfxSetupSolverBodies(PfxSetupSolverBodiesParam &param,PfxTaskManager *taskManager);
 
+///////////////////////////////////////////////////////////////////////////////
+// Contact Solver Buffer
+
+//J ＜補足＞
+//J contactSolverBuffを指定すると、pfxSetupContactConstraintsはソルバーが反復計算で参照するデータ
+//J （拘束の法線と右辺、累積インパルス、ワールド座標系の接触点）をPfxContactSolverPointとして
+//J ペアの順に詰めて書き出し、pfxSolveConstraintsはマニフォールドではなくこのバッファを先頭から順に参照する。
+//J 累積インパルスは最後にマニフォールドへ書き戻されるため、結果は指定しない場合と同じになる。
+//J セットアップとソルバーには同じバッファとペアを渡すこと。
+
+//E <Notes>
+//E If contactSolverBuff is given, pfxSetupContactConstraints packs the data referred to by
+//E the solver iterations (constraint normals and right hand sides, accumulated impulses and
+//E contact points in world coordinates) into the buffer as PfxContactSolverPoint in pair order,
+//E and pfxSolveConstraints walks this buffer from the front instead of the manifolds.
+//E Accumulated impulses are written back to the manifolds at the end, so the results are
+//E the same as without the buffer.
+//E The same buffer and pairs must be passed to the setup and the solver.
+
+PfxUInt32 pfxGetContactSolverBytes(PfxUInt32 numContactPairs);
+
 ///////////////////////////////////////////////////////////////////////////////
 // Setup Constraints
 
@@ -56,11 +78,18 @@ struct PfxSetupContactConstraintsParam {
 	PfxUInt32 numRigidBodies;
 	PfxFloat timeStep;
 	PfxFloat separateBias;
+
+	//J NULLでなければソルバー用のデータを詰めて書き出す（サイズはpfxGetContactSolverBytes）
+	//E If not NULL, data for the solver is packed into this buffer (size is pfxGetContactSolverBytes)
+	void *contactSolverBuff;
+	PfxUInt32 contactSolverBytes;
 	
 	PfxSetupContactConstraintsParam()
 	{
 		timeStep = 0.016f;
 		separateBias = 0.2f;
+		contactSolverBuff = NULL;
+		contactSolverBytes = 0;
 	}
 };
 
@@ -91,6 +120,13 @@ PfxInt32 pfxSetupJointConstraints(PfxSetupJointConstraintsParam &param,PfxTaskMa
 ///////////////////////////////////////////////////////////////////////////////
 // Solve Constraints
 
+//J マルチスレッド版で拘束ペアをフェーズとバッチに分割した結果の統計情報
+//E Statistics of the phases and batches built by the multi thread version
+struct PfxSolveConstraintsStats {
+	PfxParallelGroupStats contactStats;
+	PfxParallelGroupStats jointStats;
+};
+
 struct PfxSolveConstraintsParam {
 	void *workBuff;
 	PfxUInt32 workBytes;
@@ -104,10 +140,29 @@ struct PfxSolveConstraintsParam {
 	PfxSolverBody *offsetSolverBodies;
 	PfxUInt32 numRigidBodies;
 	PfxUInt32 iteration;
+
+	//J マルチスレッド版で１バッチに詰めるペア数の範囲 (1 - SCE_PFX_MAX_SOLVER_PAIRS)
+	//E Range of pairs packed into a batch by the multi thread version (1 - SCE_PFX_MAX_SOLVER_PAIRS)
+	PfxUInt32 minPairsPerBatch;
+	PfxUInt32 maxPairsPerBatch;
+
+	//J NULLでなければマルチスレッド版が分割結果の統計情報を書き込む
+	//E If not NULL, the multi thread version writes statistics of the split
+	PfxSolveConstraintsStats *stats;
+
+	//J pfxSetupContactConstraintsに渡したものと同じバッファ（NULLの場合はマニフォールドを参照する）
+	//E The same buffer as given to pfxSetupContactConstraints (manifolds are referred to if NULL)
+	void *contactSolverBuff;
+	PfxUInt32 contactSolverBytes;
 	
 	PfxSolveConstraintsParam()
 	{
 		iteration = 5;
+		minPairsPerBatch = SCE_PFX_MIN_SOLVER_PAIRS;
+		maxPairsPerBatch = SCE_PFX_MAX_SOLVER_PAIRS;
+		stats = NULL;
+		contactSolverBuff = NULL;
+		contactSolverBytes = 0;
 	}
 };
 
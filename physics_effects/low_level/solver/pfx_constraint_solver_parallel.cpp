@@ -0,0 +1,762 @@
+/*
+Physics Effects Copyright(C) 2011 Sony Computer Entertainment Inc.
+All rights reserved.
+
+Physics Effects is open software; you can redistribute it and/or
+modify it under the terms of the BSD License.
+
+Physics Effects is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+See the BSD License for more details.
+
+A copy of the BSD License is distributed with
+Physics Effects under the filename: physics_effects_license.txt
+*/
+
+#include "base_level/base/pfx_perf_counter.h"
+#include "base_level/solver/pfx_contact_constraint.h"
+#include "low_level/solver/pfx_joint_constraint_func.h"
+#include "low_level/solver/pfx_constraint_solver.h"
+#include "base_level/solver/pfx_check_solver.h"
+
+namespace sce {
+namespace PhysicsEffects {
+
+PfxInt32 pfxCheckParamOfSetupSolverBodies(const PfxSetupSolverBodiesParam &param);
+PfxInt32 pfxCheckParamOfSetupContactConstraints(const PfxSetupContactConstraintsParam &param);
+PfxInt32 pfxCheckParamOfSetupJointConstraints(const PfxSetupJointConstraintsParam &param);
+PfxInt32 pfxCheckParamOfSolveConstraints(const PfxSolveConstraintsParam &param);
+
+PfxUInt32 *pfxGetContactSolverOffsets(void *contactSolverBuff);
+PfxContactSolverPoint *pfxGetContactSolverPoints(void *contactSolverBuff,PfxUInt32 numContactPairs);
+PfxInt32 pfxSetupContactSolverOffsets(PfxSetupContactConstraintsParam &param);
+void pfxSetupContactConstraintPair(PfxSetupContactConstraintsParam &param,PfxUInt32 i,PfxContactSolverPoint *contactSolverPoints);
+void pfxStoreContactSolverPoints(
+	PfxConstraintPair *contactPairs,PfxUInt32 start,PfxUInt32 num,
+	PfxContactManifold *offsetContactManifolds,
+	const PfxUInt32 *contactSolverOffsets,const PfxContactSolverPoint *contactSolverPoints);
+
+///////////////////////////////////////////////////////////////////////////////
+// MULTI THREAD
+
+///////////////////////////////////////////////////////////////////////////////
+// Setup Solver Bodies
+
+struct PfxSetupSolverBodiesIO {
+	PfxRigidState *states;
+	PfxRigidBody *bodies;
+	PfxSolverBody *solverBodies;
+};
+
+void pfxSetupSolverBodiesTaskEntry(PfxTaskArg *arg)
+{
+	PfxSetupSolverBodiesIO *io = (PfxSetupSolverBodiesIO*)arg->io;
+	PfxUInt32 start = arg->data[0];
+	PfxUInt32 num = arg->data[1];
+
+	for(PfxUInt32 i=start;i<start+num;i++) {
+		PfxRigidState &state = io->states[i];
+		PfxRigidBody &body = io->bodies[i];
+		PfxSolverBody &solverBody = io->solverBodies[i];
+
+		solverBody.m_orientation = state.getOrientation();
+		solverBody.m_deltaLinearVelocity = PfxVector3(0.0f);
+		solverBody.m_deltaAngularVelocity = PfxVector3(0.0f);
+		solverBody.m_motionType = state.getMotionMask();
+
+		if(SCE_PFX_MOTION_MASK_DYNAMIC(state.getMotionType())) {
+			PfxMatrix3 ori(solverBody.m_orientation);
+			solverBody.m_massInv = body.getMassInv();
+			solverBody.m_inertiaInv = ori * body.getInertiaInv() * transpose(ori);
+		}
+		else {
+			solverBody.m_massInv = 0.0f;
+			solverBody.m_inertiaInv = PfxMatrix3(0.0f);
+		}
+	}
+}
+
+PfxInt32 pfxSetupSolverBodies(PfxSetupSolverBodiesParam &param,PfxTaskManager *taskManager)
+{
+	PfxInt32 ret = pfxCheckParamOfSetupSolverBodies(param);
+	if(ret != SCE_PFX_OK) return ret;
+	if(!taskManager) return SCE_PFX_ERR_INVALID_VALUE;
+
+	SCE_PFX_PUSH_MARKER("pfxSetupSolverBodies");
+
+	PfxSetupSolverBodiesIO *io = (PfxSetupSolverBodiesIO*)taskManager->allocate(sizeof(PfxSetupSolverBodiesIO));
+	io->states = param.states;
+	io->bodies = param.bodies;
+	io->solverBodies = param.solverBodies;
+
+	PfxUInt32 numTasks = taskManager->getNumTasks();
+	taskManager->setTaskEntry((void*)pfxSetupSolverBodiesTaskEntry);
+
+	for(PfxUInt32 t=0;t<numTasks;t++) {
+		PfxUInt32 start = param.numRigidBodies*t/numTasks;
+		PfxUInt32 end = param.numRigidBodies*(t+1)/numTasks;
+		taskManager->startTask(t,io,start,end-start,0,0);
+	}
+
+	for(PfxUInt32 t=0;t<numTasks;t++) {
+		int taskId;
+		PfxUInt32 data1,data2,data3,data4;
+		taskManager->waitTask(taskId,data1,data2,data3,data4);
+	}
+
+	taskManager->deallocate(io);
+
+	SCE_PFX_POP_MARKER();
+
+	return SCE_PFX_OK;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Setup Constraints
+
+//J セットアップはソルバーボディを読むだけなので、ペア単位で分割してもロックは不要
+//E Setup only reads solver bodies, so pairs can be split between tasks without locking
+
+struct PfxSetupContactConstraintsIO {
+	PfxSetupContactConstraintsParam *param;
+	PfxUInt32 *contactSolverOffsets;
+	PfxContactSolverPoint *contactSolverPoints;
+};
+
+void pfxSetupContactConstraintsTaskEntry(PfxTaskArg *arg)
+{
+	PfxSetupContactConstraintsIO *io = (PfxSetupContactConstraintsIO*)arg->io;
+	PfxSetupContactConstraintsParam &param = *io->param;
+	PfxUInt32 start = arg->data[0];
+	PfxUInt32 num = arg->data[1];
+
+	for(PfxUInt32 i=start;i<start+num;i++) {
+		pfxSetupContactConstraintPair(param,i,io->contactSolverPoints ? io->contactSolverPoints + io->contactSolverOffsets[i] : NULL);
+	}
+}
+
+PfxInt32 pfxSetupContactConstraints(PfxSetupContactConstraintsParam &param,PfxTaskManager *taskManager)
+{
+	PfxInt32 ret = pfxCheckParamOfSetupContactConstraints(param);
+	if(ret != SCE_PFX_OK) return ret;
+	if(!taskManager) return SCE_PFX_ERR_INVALID_VALUE;
+
+	SCE_PFX_PUSH_MARKER("pfxSetupContactConstraints");
+
+	//J コンタクト点の開始位置は先に決めておく
+	//E Start indices of contact points are decided beforehand
+	PfxUInt32 *contactSolverOffsets = NULL;
+	PfxContactSolverPoint *contactSolverPoints = NULL;
+
+	if(param.contactSolverBuff) {
+		ret = pfxSetupContactSolverOffsets(param);
+		if(ret != SCE_PFX_OK) {
+			SCE_PFX_POP_MARKER();
+			return ret;
+		}
+		contactSolverOffsets = pfxGetContactSolverOffsets(param.contactSolverBuff);
+		contactSolverPoints = pfxGetContactSolverPoints(param.contactSolverBuff,param.numContactPairs);
+	}
+
+	PfxSetupContactConstraintsIO *io = (PfxSetupContactConstraintsIO*)taskManager->allocate(sizeof(PfxSetupContactConstraintsIO));
+	io->param = &param;
+	io->contactSolverOffsets = contactSolverOffsets;
+	io->contactSolverPoints = contactSolverPoints;
+
+	PfxUInt32 numTasks = taskManager->getNumTasks();
+	taskManager->setTaskEntry((void*)pfxSetupContactConstraintsTaskEntry);
+
+	for(PfxUInt32 t=0;t<numTasks;t++) {
+		PfxUInt32 start = param.numContactPairs*t/numTasks;
+		PfxUInt32 end = param.numContactPairs*(t+1)/numTasks;
+		taskManager->startTask(t,io,start,end-start,0,0);
+	}
+
+	for(PfxUInt32 t=0;t<numTasks;t++) {
+		int taskId;
+		PfxUInt32 data1,data2,data3,data4;
+		taskManager->waitTask(taskId,data1,data2,data3,data4);
+	}
+
+	taskManager->deallocate(io);
+
+	SCE_PFX_POP_MARKER();
+
+	return SCE_PFX_OK;
+}
+
+struct PfxSetupJointConstraintsIO {
+	PfxSetupJointConstraintsParam *param;
+};
+
+void pfxSetupJointConstraintsTaskEntry(PfxTaskArg *arg)
+{
+	PfxSetupJointConstraintsIO *io = (PfxSetupJointConstraintsIO*)arg->io;
+	PfxSetupJointConstraintsParam &param = *io->param;
+	PfxUInt32 start = arg->data[0];
+	PfxUInt32 num = arg->data[1];
+
+	PfxConstraintPair *jointPairs = param.jointPairs;
+	PfxJoint *offsetJoints = param.offsetJoints;
+	PfxRigidState *offsetRigidStates = param.offsetRigidStates;
+	PfxSolverBody *offsetSolverBodies = param.offsetSolverBodies;
+
+	for(PfxUInt32 i=start;i<start+num;i++) {
+		PfxConstraintPair &pair = jointPairs[i];
+		if(!pfxCheckSolver(pair)) {
+			continue;
+		}
+
+		PfxUInt16 iA = pfxGetObjectIdA(pair);
+		PfxUInt16 iB = pfxGetObjectIdB(pair);
+		PfxUInt32 iConstraint = pfxGetConstraintId(pair);
+
+		PfxJoint &joint = offsetJoints[iConstraint];
+
+		SCE_PFX_ALWAYS_ASSERT(iA==joint.m_rigidBodyIdA);
+		SCE_PFX_ALWAYS_ASSERT(iB==joint.m_rigidBodyIdB);
+
+		PfxRigidState &stateA = offsetRigidStates[iA];
+		PfxSolverBody &solverBodyA = offsetSolverBodies[iA];
+
+		PfxRigidState &stateB = offsetRigidStates[iB];
+		PfxSolverBody &solverBodyB = offsetSolverBodies[iB];
+
+		pfxGetSetupJointConstraintFunc(joint.m_type)(
+			joint,
+			stateA,
+			stateB,
+			solverBodyA,
+			solverBodyB,
+			param.timeStep);
+	}
+}
+
+PfxInt32 pfxSetupJointConstraints(PfxSetupJointConstraintsParam &param,PfxTaskManager *taskManager)
+{
+	PfxInt32 ret = pfxCheckParamOfSetupJointConstraints(param);
+	if(ret != SCE_PFX_OK) return ret;
+	if(!taskManager) return SCE_PFX_ERR_INVALID_VALUE;
+
+	SCE_PFX_PUSH_MARKER("pfxSetupJointConstraints");
+
+	PfxSetupJointConstraintsIO *io = (PfxSetupJointConstraintsIO*)taskManager->allocate(sizeof(PfxSetupJointConstraintsIO));
+	io->param = &param;
+
+	PfxUInt32 numTasks = taskManager->getNumTasks();
+	taskManager->setTaskEntry((void*)pfxSetupJointConstraintsTaskEntry);
+
+	for(PfxUInt32 t=0;t<numTasks;t++) {
+		PfxUInt32 start = param.numJointPairs*t/numTasks;
+		PfxUInt32 end = param.numJointPairs*(t+1)/numTasks;
+		taskManager->startTask(t,io,start,end-start,0,0);
+	}
+
+	for(PfxUInt32 t=0;t<numTasks;t++) {
+		int taskId;
+		PfxUInt32 data1,data2,data3,data4;
+		taskManager->waitTask(taskId,data1,data2,data3,data4);
+	}
+
+	taskManager->deallocate(io);
+
+	SCE_PFX_POP_MARKER();
+
+	return SCE_PFX_OK;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Solve Constraints
+
+static SCE_PFX_FORCE_INLINE
+void pfxWarmStartJointPair(PfxConstraintPair &pair,PfxJoint *offsetJoints,PfxSolverBody *offsetSolverBodies)
+{
+	if(!pfxCheckSolver(pair)) {
+		return;
+	}
+
+	PfxUInt16 iA = pfxGetObjectIdA(pair);
+	PfxUInt16 iB = pfxGetObjectIdB(pair);
+
+	PfxJoint &joint = offsetJoints[pfxGetConstraintId(pair)];
+
+	SCE_PFX_ASSERT(iA==joint.m_rigidBodyIdA);
+	SCE_PFX_ASSERT(iB==joint.m_rigidBodyIdB);
+
+	PfxSolverBody &solverBodyA = offsetSolverBodies[iA];
+	PfxSolverBody &solverBodyB = offsetSolverBodies[iB];
+
+	pfxGetWarmStartJointConstraintFunc(joint.m_type)(
+		joint,
+		solverBodyA,
+		solverBodyB);
+}
+
+static SCE_PFX_FORCE_INLINE
+void pfxWarmStartContactPair(PfxConstraintPair &pair,PfxContactManifold *offsetContactManifolds,PfxSolverBody *offsetSolverBodies)
+{
+	if(!pfxCheckSolver(pair)) {
+		return;
+	}
+
+	PfxUInt16 iA = pfxGetObjectIdA(pair);
+	PfxUInt16 iB = pfxGetObjectIdB(pair);
+
+	PfxContactManifold &contact = offsetContactManifolds[pfxGetConstraintId(pair)];
+
+	SCE_PFX_ASSERT(iA==contact.getRigidBodyIdA());
+	SCE_PFX_ASSERT(iB==contact.getRigidBodyIdB());
+
+	PfxSolverBody &solverBodyA = offsetSolverBodies[iA];
+	PfxSolverBody &solverBodyB = offsetSolverBodies[iB];
+
+	PfxFloat massInvA = solverBodyA.m_massInv;
+	PfxFloat massInvB = solverBodyB.m_massInv;
+	PfxMatrix3 inertiaInvA = solverBodyA.m_inertiaInv;
+	PfxMatrix3 inertiaInvB = solverBodyB.m_inertiaInv;
+
+	if(solverBodyA.m_motionType == kPfxMotionTypeOneWay) {
+		massInvB = 0.0f;
+		inertiaInvB = PfxMatrix3(0.0f);
+	}
+	if(solverBodyB.m_motionType == kPfxMotionTypeOneWay) {
+		massInvA = 0.0f;
+		inertiaInvA = PfxMatrix3(0.0f);
+	}
+
+	for(int j=0;j<contact.getNumContacts();j++) {
+		PfxContactPoint &cp = contact.getContactPoint(j);
+
+		PfxVector3 rA = rotate(solverBodyA.m_orientation,pfxReadVector3(cp.m_localPointA));
+		PfxVector3 rB = rotate(solverBodyB.m_orientation,pfxReadVector3(cp.m_localPointB));
+
+		for(int k=0;k<3;k++) {
+			PfxVector3 normal = pfxReadVector3(cp.m_constraintRow[k].m_normal);
+			PfxFloat deltaImpulse = cp.m_constraintRow[k].m_accumImpulse;
+			solverBodyA.m_deltaLinearVelocity += deltaImpulse * massInvA * normal;
+			solverBodyA.m_deltaAngularVelocity += deltaImpulse * inertiaInvA * cross(rA,normal);
+			solverBodyB.m_deltaLinearVelocity -= deltaImpulse * massInvB * normal;
+			solverBodyB.m_deltaAngularVelocity -= deltaImpulse * inertiaInvB * cross(rB,normal);
+		}
+	}
+}
+
+static SCE_PFX_FORCE_INLINE
+void pfxSolveJointPair(PfxConstraintPair &pair,PfxJoint *offsetJoints,PfxSolverBody *offsetSolverBodies)
+{
+	if(!pfxCheckSolver(pair)) {
+		return;
+	}
+
+	PfxUInt16 iA = pfxGetObjectIdA(pair);
+	PfxUInt16 iB = pfxGetObjectIdB(pair);
+
+	PfxJoint &joint = offsetJoints[pfxGetConstraintId(pair)];
+
+	SCE_PFX_ASSERT(iA==joint.m_rigidBodyIdA);
+	SCE_PFX_ASSERT(iB==joint.m_rigidBodyIdB);
+
+	PfxSolverBody &solverBodyA = offsetSolverBodies[iA];
+	PfxSolverBody &solverBodyB = offsetSolverBodies[iB];
+
+	pfxGetSolveJointConstraintFunc(joint.m_type)(
+		joint,
+		solverBodyA,
+		solverBodyB);
+}
+
+static SCE_PFX_FORCE_INLINE
+void pfxSolveContactPair(PfxConstraintPair &pair,PfxContactManifold *offsetContactManifolds,PfxSolverBody *offsetSolverBodies)
+{
+	if(!pfxCheckSolver(pair)) {
+		return;
+	}
+
+	PfxUInt16 iA = pfxGetObjectIdA(pair);
+	PfxUInt16 iB = pfxGetObjectIdB(pair);
+
+	PfxContactManifold &contact = offsetContactManifolds[pfxGetConstraintId(pair)];
+
+	SCE_PFX_ASSERT(iA==contact.getRigidBodyIdA());
+	SCE_PFX_ASSERT(iB==contact.getRigidBodyIdB());
+
+	PfxSolverBody &solverBodyA = offsetSolverBodies[iA];
+	PfxSolverBody &solverBodyB = offsetSolverBodies[iB];
+
+	for(int j=0;j<contact.getNumContacts();j++) {
+		PfxContactPoint &cp = contact.getContactPoint(j);
+
+		pfxSolveContactConstraint(
+			cp.m_constraintRow[0],
+			cp.m_constraintRow[1],
+			cp.m_constraintRow[2],
+			pfxReadVector3(cp.m_localPointA),
+			pfxReadVector3(cp.m_localPointB),
+			solverBodyA,
+			solverBodyB,
+			contact.getCompositeFriction()
+			);
+	}
+}
+
+//J ソルバー用に詰めたコンタクト点を参照する場合
+//E When the contact points packed for the solver are referred to
+
+struct PfxContactSolverBuffer {
+	PfxConstraintPair *contactPairs;
+	PfxUInt32 *contactSolverOffsets;
+	PfxContactSolverPoint *contactSolverPoints;
+};
+
+static SCE_PFX_FORCE_INLINE
+void pfxWarmStartContactSolverPair(PfxConstraintPair &pair,PfxContactSolverBuffer *buffer,PfxSolverBody *offsetSolverBodies)
+{
+	if(!pfxCheckSolver(pair)) {
+		return;
+	}
+
+	PfxUInt32 i = (PfxUInt32)(&pair - buffer->contactPairs);
+	PfxSolverBody &solverBodyA = offsetSolverBodies[pfxGetObjectIdA(pair)];
+	PfxSolverBody &solverBodyB = offsetSolverBodies[pfxGetObjectIdB(pair)];
+
+	for(PfxUInt32 j=buffer->contactSolverOffsets[i];j<buffer->contactSolverOffsets[i+1];j++) {
+		pfxWarmStartContactConstraint(buffer->contactSolverPoints[j],solverBodyA,solverBodyB);
+	}
+}
+
+static SCE_PFX_FORCE_INLINE
+void pfxSolveContactSolverPair(PfxConstraintPair &pair,PfxContactSolverBuffer *buffer,PfxSolverBody *offsetSolverBodies)
+{
+	if(!pfxCheckSolver(pair)) {
+		return;
+	}
+
+	PfxUInt32 i = (PfxUInt32)(&pair - buffer->contactPairs);
+	PfxSolverBody &solverBodyA = offsetSolverBodies[pfxGetObjectIdA(pair)];
+	PfxSolverBody &solverBodyB = offsetSolverBodies[pfxGetObjectIdB(pair)];
+
+	for(PfxUInt32 j=buffer->contactSolverOffsets[i];j<buffer->contactSolverOffsets[i+1];j++) {
+		pfxSolveContactConstraint(buffer->contactSolverPoints[j],solverBodyA,solverBodyB);
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Split Pairs
+
+//J 動的な剛体を共有しないペアをバッチにまとめ、同時に処理できるバッチをフェーズにまとめる
+//J 静的な剛体の速度は変化しないためロックしない
+//E Pairs which share no dynamic rigid body are packed into a batch, and batches
+//E which can be processed at the same time are packed into a phase.
+//E Static rigid bodies are not locked since their velocities never change.
+
+static void pfxSplitPairs(
+	PfxConstraintPair *pairs,PfxUInt32 numPairs,
+	PfxParallelGroup &group,PfxParallelBatch *batches,PfxUInt32 *pairTable,
+	PfxUInt8 *bodyTable,PfxUInt32 numRigidBodies,
+	PfxUInt32 maxBatches,PfxUInt32 minPairs,PfxUInt32 maxPairs,
+	PfxParallelGroupStats &stats)
+{
+	memset(pairTable,0,sizeof(PfxUInt32)*((numPairs+31)/32));
+	memset(&stats,0,sizeof(PfxParallelGroupStats));
+
+	PfxUInt32 targetCount = SCE_PFX_MAX(minPairs,SCE_PFX_MIN(maxPairs,numPairs/(maxBatches*2)));
+	PfxUInt32 startIndex = 0;
+	PfxUInt32 totalCount = 0;
+	PfxUInt32 phaseId;
+
+	for(phaseId=0;phaseId<SCE_PFX_MAX_SOLVER_PHASES&&totalCount<numPairs;phaseId++) {
+		PfxBool startIndexCheck = true;
+		PfxUInt32 batchId;
+		PfxUInt32 i = startIndex;
+
+		memset(bodyTable,0xff,sizeof(PfxUInt8)*numRigidBodies);
+
+		for(batchId=0;i<numPairs&&batchId<maxBatches;batchId++) {
+			PfxParallelBatch &batch = batches[phaseId*SCE_PFX_MAX_SOLVER_BATCHES+batchId];
+			PfxUInt32 pairCount = 0;
+
+			for(;i<numPairs&&pairCount<targetCount;i++) {
+				PfxUInt32 idxP = i>>5;
+				PfxUInt32 maskP = 1L << (i & 31);
+
+				//J 既に割り当て済みのペア
+				//E Already assigned
+				if(pairTable[idxP] & maskP) {
+					if(startIndexCheck) startIndex = i+1;
+					continue;
+				}
+
+				//J 拘束計算の不要なペアは割り当てずに処理済みとする
+				//E Pairs which need no solving are marked as done without being assigned
+				if(!pfxCheckSolver(pairs[i])) {
+					if(startIndexCheck) startIndex = i+1;
+					pairTable[idxP] |= maskP;
+					totalCount++;
+					stats.numSkippedPairs++;
+					continue;
+				}
+
+				PfxUInt32 idxA = pfxGetObjectIdA(pairs[i]);
+				PfxUInt32 idxB = pfxGetObjectIdB(pairs[i]);
+				PfxBool dynamicA = SCE_PFX_MOTION_MASK_DYNAMIC(pfxGetMotionMaskA(pairs[i])&SCE_PFX_MOTION_MASK_TYPE) != 0;
+				PfxBool dynamicB = SCE_PFX_MOTION_MASK_DYNAMIC(pfxGetMotionMaskB(pairs[i])&SCE_PFX_MOTION_MASK_TYPE) != 0;
+
+				//J 他のバッチが使用中の剛体を含むペアは次のフェーズに回す
+				//E Pairs touching a rigid body owned by another batch are left to later phases
+				if( (dynamicA && bodyTable[idxA] != batchId && bodyTable[idxA] != 0xff) ||
+					(dynamicB && bodyTable[idxB] != batchId && bodyTable[idxB] != 0xff) ) {
+					startIndexCheck = false;
+					continue;
+				}
+
+				if(dynamicA) bodyTable[idxA] = (PfxUInt8)batchId;
+				if(dynamicB) bodyTable[idxB] = (PfxUInt8)batchId;
+
+				if(startIndexCheck) startIndex = i+1;
+
+				pairTable[idxP] |= maskP;
+				batch.pairIndices[pairCount++] = i;
+			}
+
+			if(pairCount == 0) break;
+
+			group.numPairs[phaseId*SCE_PFX_MAX_SOLVER_BATCHES+batchId] = (PfxUInt16)pairCount;
+			totalCount += pairCount;
+		}
+
+		group.numBatches[phaseId] = (PfxUInt16)batchId;
+	}
+
+	group.numPhases = (PfxUInt16)phaseId;
+
+	// Statistics
+	stats.numPairs = numPairs;
+	stats.numSerialPairs = numPairs - totalCount;
+	stats.numPhases = group.numPhases;
+	stats.targetPairsPerBatch = targetCount;
+	stats.minPairsPerBatch = 0;
+	stats.maxPairsPerBatch = 0;
+
+	for(PfxUInt32 p=0;p<group.numPhases;p++) {
+		stats.numBatchesInPhase[p] = group.numBatches[p];
+		stats.numBatches += group.numBatches[p];
+		for(PfxUInt32 b=0;b<group.numBatches[p];b++) {
+			PfxUInt32 n = group.numPairs[p*SCE_PFX_MAX_SOLVER_BATCHES+b];
+			stats.numPairsInPhase[p] += n;
+			stats.minPairsPerBatch = (stats.minPairsPerBatch==0)?n:SCE_PFX_MIN(stats.minPairsPerBatch,n);
+			stats.maxPairsPerBatch = SCE_PFX_MAX(stats.maxPairsPerBatch,n);
+		}
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Solve Constraints
+
+//J フェーズ内のバッチは剛体を共有しないため並列に処理し、フェーズ間はバリアで同期する
+//E Batches in a phase share no rigid body and run in parallel, with a barrier between phases
+
+struct PfxSolveConstraintsIO {
+	PfxParallelGroup *contactParallelGroup;
+	PfxParallelBatch *contactParallelBatches;
+	PfxUInt32 *contactPairTable;
+	PfxUInt32 numSerialContactPairs;
+	PfxParallelGroup *jointParallelGroup;
+	PfxParallelBatch *jointParallelBatches;
+	PfxUInt32 *jointPairTable;
+	PfxUInt32 numSerialJointPairs;
+	PfxContactSolverBuffer *contactSolverBuffer;
+	PfxSolveConstraintsParam *param;
+};
+
+template <class Constraint>
+static void pfxSolveParallelGroup(
+	void (*func)(PfxConstraintPair&,Constraint*,PfxSolverBody*),
+	PfxConstraintPair *pairs,PfxUInt32 numPairs,
+	const PfxParallelGroup &group,const PfxParallelBatch *batches,
+	const PfxUInt32 *pairTable,PfxUInt32 numSerialPairs,
+	Constraint *offsetConstraints,PfxSolverBody *offsetSolverBodies,
+	PfxTaskArg *arg)
+{
+	for(PfxUInt32 phaseId=0;phaseId<group.numPhases;phaseId++) {
+		for(PfxUInt32 batchId=arg->taskId;batchId<group.numBatches[phaseId];batchId+=arg->maxTasks) {
+			PfxUInt32 batchIdx = phaseId*SCE_PFX_MAX_SOLVER_BATCHES+batchId;
+			const PfxParallelBatch &batch = batches[batchIdx];
+			for(PfxUInt32 i=0;i<group.numPairs[batchIdx];i++) {
+				func(pairs[batch.pairIndices[i]],offsetConstraints,offsetSolverBodies);
+			}
+		}
+		arg->barrier->sync();
+	}
+
+	//J フェーズに収まらなかったペアは１つのタスクが処理する
+	//E Pairs which didn't fit into the phases are processed by a single task
+	if(numSerialPairs > 0) {
+		if(arg->taskId == 0) {
+			for(PfxUInt32 i=0;i<numPairs;i++) {
+				if(!(pairTable[i>>5] & (1L << (i & 31)))) {
+					func(pairs[i],offsetConstraints,offsetSolverBodies);
+				}
+			}
+		}
+		arg->barrier->sync();
+	}
+}
+
+void pfxSolveConstraintsTaskEntry(PfxTaskArg *arg)
+{
+	PfxSolveConstraintsIO *io = (PfxSolveConstraintsIO*)arg->io;
+	PfxSolveConstraintsParam &param = *io->param;
+
+	PfxConstraintPair *contactPairs = param.contactPairs;
+	PfxUInt32 numContactPairs = param.numContactPairs;
+	PfxContactManifold *offsetContactManifolds = param.offsetContactManifolds;
+	PfxConstraintPair *jointPairs = param.jointPairs;
+	PfxUInt32 numJointPairs = param.numJointPairs;
+	PfxJoint *offsetJoints = param.offsetJoints;
+	PfxRigidState *offsetRigidStates = param.offsetRigidStates;
+	PfxSolverBody *offsetSolverBodies = param.offsetSolverBodies;
+
+	PfxContactSolverBuffer *contactSolverBuffer = io->contactSolverBuffer;
+
+	// Warm Starting
+	pfxSolveParallelGroup(pfxWarmStartJointPair,jointPairs,numJointPairs,
+		*io->jointParallelGroup,io->jointParallelBatches,io->jointPairTable,io->numSerialJointPairs,
+		offsetJoints,offsetSolverBodies,arg);
+	if(contactSolverBuffer) {
+		pfxSolveParallelGroup(pfxWarmStartContactSolverPair,contactPairs,numContactPairs,
+			*io->contactParallelGroup,io->contactParallelBatches,io->contactPairTable,io->numSerialContactPairs,
+			contactSolverBuffer,offsetSolverBodies,arg);
+	}
+	else {
+		pfxSolveParallelGroup(pfxWarmStartContactPair,contactPairs,numContactPairs,
+			*io->contactParallelGroup,io->contactParallelBatches,io->contactPairTable,io->numSerialContactPairs,
+			offsetContactManifolds,offsetSolverBodies,arg);
+	}
+
+	// Solver
+	for(PfxUInt32 iteration=0;iteration<param.iteration;iteration++) {
+		pfxSolveParallelGroup(pfxSolveJointPair,jointPairs,numJointPairs,
+			*io->jointParallelGroup,io->jointParallelBatches,io->jointPairTable,io->numSerialJointPairs,
+			offsetJoints,offsetSolverBodies,arg);
+		if(contactSolverBuffer) {
+			pfxSolveParallelGroup(pfxSolveContactSolverPair,contactPairs,numContactPairs,
+				*io->contactParallelGroup,io->contactParallelBatches,io->contactPairTable,io->numSerialContactPairs,
+				contactSolverBuffer,offsetSolverBodies,arg);
+		}
+		else {
+			pfxSolveParallelGroup(pfxSolveContactPair,contactPairs,numContactPairs,
+				*io->contactParallelGroup,io->contactParallelBatches,io->contactPairTable,io->numSerialContactPairs,
+				offsetContactManifolds,offsetSolverBodies,arg);
+		}
+	}
+
+	//J 全てのタスクの反復計算が終わった後、ペアを分担してマニフォールドへ書き戻す
+	//E After all tasks finished the iterations, the pairs are written back to the manifolds in parallel
+	if(contactSolverBuffer) {
+		PfxUInt32 startPair = numContactPairs*arg->taskId/arg->maxTasks;
+		PfxUInt32 endPair = numContactPairs*(arg->taskId+1)/arg->maxTasks;
+		pfxStoreContactSolverPoints(contactPairs,startPair,endPair-startPair,offsetContactManifolds,
+			contactSolverBuffer->contactSolverOffsets,contactSolverBuffer->contactSolverPoints);
+	}
+
+	// Apply velocities
+	PfxUInt32 start = param.numRigidBodies*arg->taskId/arg->maxTasks;
+	PfxUInt32 end = param.numRigidBodies*(arg->taskId+1)/arg->maxTasks;
+	for(PfxUInt32 i=start;i<end;i++) {
+		offsetRigidStates[i].setLinearVelocity(
+			offsetRigidStates[i].getLinearVelocity()+offsetSolverBodies[i].m_deltaLinearVelocity);
+		offsetRigidStates[i].setAngularVelocity(
+			offsetRigidStates[i].getAngularVelocity()+offsetSolverBodies[i].m_deltaAngularVelocity);
+	}
+}
+
+PfxInt32 pfxSolveConstraints(PfxSolveConstraintsParam &param,PfxTaskManager *taskManager)
+{
+	if(!taskManager) return SCE_PFX_ERR_INVALID_VALUE;
+	if(param.minPairsPerBatch == 0 || param.minPairsPerBatch > param.maxPairsPerBatch || 
+		param.maxPairsPerBatch > SCE_PFX_MAX_SOLVER_PAIRS) return SCE_PFX_ERR_INVALID_VALUE;
+
+	PfxUInt32 numTasks = taskManager->getNumTasks();
+
+	PfxInt32 ret = pfxCheckParamOfSolveConstraints(param);
+	if(ret != SCE_PFX_OK) return ret;
+	if(SCE_PFX_AVAILABLE_BYTES_ALIGN16(param.workBuff,param.workBytes) < 
+		pfxGetWorkBytesOfSolveConstraints(param.numRigidBodies,param.numContactPairs,param.numJointPairs,numTasks) ) return SCE_PFX_ERR_OUT_OF_BUFFER;
+
+	SCE_PFX_PUSH_MARKER("pfxSolveConstraints");
+
+	PfxHeapManager pool((unsigned char*)param.workBuff,param.workBytes);
+
+	PfxParallelGroup *contactGroup = (PfxParallelGroup*)pool.allocate(sizeof(PfxParallelGroup),PfxHeapManager::ALIGN128);
+	PfxParallelBatch *contactBatches = (PfxParallelBatch*)pool.allocate(sizeof(PfxParallelBatch)*(SCE_PFX_MAX_SOLVER_PHASES*SCE_PFX_MAX_SOLVER_BATCHES),PfxHeapManager::ALIGN128);
+	PfxParallelGroup *jointGroup = (PfxParallelGroup*)pool.allocate(sizeof(PfxParallelGroup),PfxHeapManager::ALIGN128);
+	PfxParallelBatch *jointBatches = (PfxParallelBatch*)pool.allocate(sizeof(PfxParallelBatch)*(SCE_PFX_MAX_SOLVER_PHASES*SCE_PFX_MAX_SOLVER_BATCHES),PfxHeapManager::ALIGN128);
+	PfxUInt32 *contactPairTable = (PfxUInt32*)pool.allocate(sizeof(PfxUInt32)*((param.numContactPairs+31)/32));
+	PfxUInt32 *jointPairTable = (PfxUInt32*)pool.allocate(sizeof(PfxUInt32)*((param.numJointPairs+31)/32));
+	PfxUInt8 *bodyTable = (PfxUInt8*)pool.allocate(sizeof(PfxUInt8)*param.numRigidBodies);
+
+	//J ステップごとに一度だけ分割し、ウォームスタートと全ての反復計算で使い回す
+	//E Split once per step and reuse the result for warm starting and all iterations
+	PfxUInt32 maxBatches = SCE_PFX_MIN(numTasks,SCE_PFX_MAX_SOLVER_BATCHES);
+	PfxSolveConstraintsStats stats;
+
+	pfxSplitPairs(param.contactPairs,param.numContactPairs,
+		*contactGroup,contactBatches,contactPairTable,
+		bodyTable,param.numRigidBodies,
+		maxBatches,param.minPairsPerBatch,param.maxPairsPerBatch,
+		stats.contactStats);
+
+	pfxSplitPairs(param.jointPairs,param.numJointPairs,
+		*jointGroup,jointBatches,jointPairTable,
+		bodyTable,param.numRigidBodies,
+		maxBatches,param.minPairsPerBatch,param.maxPairsPerBatch,
+		stats.jointStats);
+
+	if(param.stats) {
+		*param.stats = stats;
+	}
+
+	PfxSolveConstraintsIO *io = (PfxSolveConstraintsIO*)taskManager->allocate(sizeof(PfxSolveConstraintsIO));
+	io->contactParallelGroup = contactGroup;
+	io->contactParallelBatches = contactBatches;
+	io->contactPairTable = contactPairTable;
+	io->numSerialContactPairs = stats.contactStats.numSerialPairs;
+	io->jointParallelGroup = jointGroup;
+	io->jointParallelBatches = jointBatches;
+	io->jointPairTable = jointPairTable;
+	io->numSerialJointPairs = stats.jointStats.numSerialPairs;
+	io->contactSolverBuffer = NULL;
+	io->param = &param;
+
+	PfxContactSolverBuffer contactSolverBuffer;
+	if(param.contactSolverBuff) {
+		contactSolverBuffer.contactPairs = param.contactPairs;
+		contactSolverBuffer.contactSolverOffsets = pfxGetContactSolverOffsets(param.contactSolverBuff);
+		contactSolverBuffer.contactSolverPoints = pfxGetContactSolverPoints(param.contactSolverBuff,param.numContactPairs);
+		io->contactSolverBuffer = &contactSolverBuffer;
+	}
+
+	taskManager->setTaskEntry((void*)pfxSolveConstraintsTaskEntry);
+
+	for(PfxUInt32 t=0;t<numTasks;t++) {
+		taskManager->startTask(t,io,0,0,0,0);
+	}
+
+	for(PfxUInt32 t=0;t<numTasks;t++) {
+		int taskId;
+		PfxUInt32 data1,data2,data3,data4;
+		taskManager->waitTask(taskId,data1,data2,data3,data4);
+	}
+
+	taskManager->deallocate(io);
+
+	pool.clear();
+
+	SCE_PFX_POP_MARKER();
+
+	return SCE_PFX_OK;
+}
+
+} //namespace PhysicsEffects
+} //namespace sce
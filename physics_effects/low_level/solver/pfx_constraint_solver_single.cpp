@@ -28,7 +28,8 @@ PfxUInt32 pfxGetWorkBytesOfSolveConstraints(PfxUInt32 numRigidBodies,PfxUInt32 n
 {
 	(void)maxTasks;
 	PfxUInt32 workBytes = SCE_PFX_ALLOC_BYTES_ALIGN16(sizeof(PfxUInt8) * numRigidBodies) +
-		SCE_PFX_ALLOC_BYTES_ALIGN16(sizeof(PfxUInt32)*((SCE_PFX_MAX(numContactPairs,numJointPairs)+31)/32));
+		SCE_PFX_ALLOC_BYTES_ALIGN16(sizeof(PfxUInt32)*((numContactPairs+31)/32)) +
+		SCE_PFX_ALLOC_BYTES_ALIGN16(sizeof(PfxUInt32)*((numJointPairs+31)/32));
 
 	workBytes += 128 + (SCE_PFX_ALLOC_BYTES_ALIGN16(sizeof(PfxParallelGroup)) + 
 		 SCE_PFX_ALLOC_BYTES_ALIGN128(sizeof(PfxParallelBatch)*(SCE_PFX_MAX_SOLVER_PHASES*SCE_PFX_MAX_SOLVER_BATCHES))) * 2;
@@ -49,6 +50,10 @@ PfxInt32 pfxCheckParamOfSetupContactConstraints(const PfxSetupContactConstraints
 		!param.offsetRigidBodies  || !param.offsetSolverBodies || param.timeStep <= 0.0f) return SCE_PFX_ERR_INVALID_VALUE;
 	if(!SCE_PFX_PTR_IS_ALIGNED16(param.contactPairs) || !SCE_PFX_PTR_IS_ALIGNED16(param.offsetContactManifolds) || !SCE_PFX_PTR_IS_ALIGNED16(param.offsetRigidStates) ||
 		!SCE_PFX_PTR_IS_ALIGNED16(param.offsetRigidBodies) || !SCE_PFX_PTR_IS_ALIGNED16(param.offsetSolverBodies)) return SCE_PFX_ERR_INVALID_ALIGN;
+	if(param.contactSolverBuff) {
+		if(!SCE_PFX_PTR_IS_ALIGNED16(param.contactSolverBuff)) return SCE_PFX_ERR_INVALID_ALIGN;
+		if(param.contactSolverBytes < SCE_PFX_BYTES_ALIGN16(sizeof(PfxUInt32)*(param.numContactPairs+1))) return SCE_PFX_ERR_OUT_OF_BUFFER;
+	}
 	return SCE_PFX_OK;
 }
 
@@ -67,11 +72,153 @@ PfxInt32 pfxCheckParamOfSolveConstraints(const PfxSolveConstraintsParam &param)
 		(param.numJointPairs>0&&(!param.jointPairs||!param.offsetJoints)) || !param.offsetRigidStates || !param.offsetSolverBodies) return SCE_PFX_ERR_INVALID_VALUE;
 	if(!SCE_PFX_PTR_IS_ALIGNED16(param.contactPairs) || !SCE_PFX_PTR_IS_ALIGNED16(param.offsetContactManifolds) || 
 		!SCE_PFX_PTR_IS_ALIGNED16(param.jointPairs) || !SCE_PFX_PTR_IS_ALIGNED16(param.offsetJoints) || !SCE_PFX_PTR_IS_ALIGNED16(param.offsetRigidStates) ||
-		!SCE_PFX_PTR_IS_ALIGNED16(param.offsetSolverBodies)) return SCE_PFX_ERR_INVALID_ALIGN;
+		!SCE_PFX_PTR_IS_ALIGNED16(param.offsetSolverBodies) || !SCE_PFX_PTR_IS_ALIGNED16(param.contactSolverBuff)) return SCE_PFX_ERR_INVALID_ALIGN;
 	if(SCE_PFX_AVAILABLE_BYTES_ALIGN16(param.workBuff,param.workBytes) < pfxGetWorkBytesOfSolveConstraints(param.numRigidBodies,param.numContactPairs,param.numJointPairs) ) return SCE_PFX_ERR_OUT_OF_BUFFER;
 	return SCE_PFX_OK;
 }
 
+///////////////////////////////////////////////////////////////////////////////
+// Contact Solver Buffer
+
+//J バッファの先頭にペアごとのコンタクト点の開始位置(numContactPairs+1個)、その後にコンタクト点を配置する
+//E Start indices of contact points per pair (numContactPairs+1 entries) are placed at the head
+//E of the buffer, followed by the contact points
+
+PfxUInt32 pfxGetContactSolverBytes(PfxUInt32 numContactPairs)
+{
+	return SCE_PFX_BYTES_ALIGN16(sizeof(PfxUInt32)*(numContactPairs+1)) +
+		sizeof(PfxContactSolverPoint)*SCE_PFX_NUMCONTACTS_PER_BODIES*numContactPairs;
+}
+
+PfxUInt32 *pfxGetContactSolverOffsets(void *contactSolverBuff)
+{
+	return (PfxUInt32*)contactSolverBuff;
+}
+
+PfxContactSolverPoint *pfxGetContactSolverPoints(void *contactSolverBuff,PfxUInt32 numContactPairs)
+{
+	return (PfxContactSolverPoint*)((PfxUInt8*)contactSolverBuff + SCE_PFX_BYTES_ALIGN16(sizeof(PfxUInt32)*(numContactPairs+1)));
+}
+
+//J ソルバーが処理するペアのコンタクト点の開始位置を決める
+//E Decides where the contact points of the pairs processed by the solver start
+PfxInt32 pfxSetupContactSolverOffsets(PfxSetupContactConstraintsParam &param)
+{
+	PfxUInt32 *offsets = pfxGetContactSolverOffsets(param.contactSolverBuff);
+	PfxUInt32 numPoints = 0;
+
+	for(PfxUInt32 i=0;i<param.numContactPairs;i++) {
+		offsets[i] = numPoints;
+		if(pfxCheckSolver(param.contactPairs[i])) {
+			numPoints += param.offsetContactManifolds[pfxGetConstraintId(param.contactPairs[i])].getNumContacts();
+		}
+	}
+	offsets[param.numContactPairs] = numPoints;
+
+	if(param.contactSolverBytes < SCE_PFX_BYTES_ALIGN16(sizeof(PfxUInt32)*(param.numContactPairs+1)) + 
+		sizeof(PfxContactSolverPoint)*numPoints) return SCE_PFX_ERR_OUT_OF_BUFFER;
+
+	return SCE_PFX_OK;
+}
+
+//J コンタクト点の拘束をセットアップする
+//J contactSolverPointsがNULLでなければ、累積インパルスをコピーしてそちらへ書き出す
+//E Sets up the constraints of contact points
+//E If contactSolverPoints is not NULL, accumulated impulses are copied and the results are written there
+void pfxSetupContactConstraintPair(PfxSetupContactConstraintsParam &param,PfxUInt32 i,PfxContactSolverPoint *contactSolverPoints)
+{
+	PfxConstraintPair &pair = param.contactPairs[i];
+	if(!pfxCheckSolver(pair)) {
+		return;
+	}
+
+	PfxUInt16 iA = pfxGetObjectIdA(pair);
+	PfxUInt16 iB = pfxGetObjectIdB(pair);
+	PfxUInt32 iConstraint = pfxGetConstraintId(pair);
+
+	PfxContactManifold &contact = param.offsetContactManifolds[iConstraint];
+
+	SCE_PFX_ALWAYS_ASSERT(iA==contact.getRigidBodyIdA());
+	SCE_PFX_ALWAYS_ASSERT(iB==contact.getRigidBodyIdB());
+
+	PfxRigidState &stateA = param.offsetRigidStates[iA];
+	PfxRigidBody &bodyA = param.offsetRigidBodies[iA];
+	PfxSolverBody &solverBodyA = param.offsetSolverBodies[iA];
+
+	PfxRigidState &stateB = param.offsetRigidStates[iB];
+	PfxRigidBody &bodyB = param.offsetRigidBodies[iB];
+	PfxSolverBody &solverBodyB = param.offsetSolverBodies[iB];
+
+	contact.setInternalFlag(0);
+	
+	PfxFloat restitution = 0.5f * (bodyA.getRestitution() + bodyB.getRestitution());
+	if(contact.getDuration() > 1) restitution = 0.0f;
+	
+	PfxFloat friction = sqrtf(bodyA.getFriction() * bodyB.getFriction());
+	
+	for(int j=0;j<contact.getNumContacts();j++) {
+		PfxContactPoint &cp = contact.getContactPoint(j);
+		PfxConstraintRow *constraintRow = cp.m_constraintRow;
+
+		if(contactSolverPoints) {
+			PfxContactSolverPoint &sp = contactSolverPoints[j];
+			sp.m_constraintRow[0].m_accumImpulse = cp.m_constraintRow[0].m_accumImpulse;
+			sp.m_constraintRow[1].m_accumImpulse = cp.m_constraintRow[1].m_accumImpulse;
+			sp.m_constraintRow[2].m_accumImpulse = cp.m_constraintRow[2].m_accumImpulse;
+			pfxStoreVector3(rotate(solverBodyA.m_orientation,pfxReadVector3(cp.m_localPointA)),sp.m_rA);
+			pfxStoreVector3(rotate(solverBodyB.m_orientation,pfxReadVector3(cp.m_localPointB)),sp.m_rB);
+			sp.m_friction = friction;
+			constraintRow = sp.m_constraintRow;
+		}
+		
+		pfxSetupContactConstraint(
+			constraintRow[0],
+			constraintRow[1],
+			constraintRow[2],
+			cp.m_distance,
+			restitution,
+			friction,
+			pfxReadVector3(cp.m_constraintRow[0].m_normal),
+			pfxReadVector3(cp.m_localPointA),
+			pfxReadVector3(cp.m_localPointB),
+			stateA,
+			stateB,
+			solverBodyA,
+			solverBodyB,
+			param.separateBias,
+			param.timeStep
+			);
+	}
+
+	contact.setCompositeFriction(friction);
+}
+
+//J ソルバーの結果をマニフォールドへ書き戻す
+//E Writes the results of the solver back to the manifolds
+void pfxStoreContactSolverPoints(
+	PfxConstraintPair *contactPairs,PfxUInt32 start,PfxUInt32 num,
+	PfxContactManifold *offsetContactManifolds,
+	const PfxUInt32 *contactSolverOffsets,const PfxContactSolverPoint *contactSolverPoints)
+{
+	for(PfxUInt32 i=start;i<start+num;i++) {
+		if(!pfxCheckSolver(contactPairs[i])) {
+			continue;
+		}
+
+		PfxContactManifold &contact = offsetContactManifolds[pfxGetConstraintId(contactPairs[i])];
+		const PfxContactSolverPoint *sp = contactSolverPoints + contactSolverOffsets[i];
+
+		SCE_PFX_ASSERT(contactSolverOffsets[i]+contact.getNumContacts() == contactSolverOffsets[i+1]);
+
+		for(int j=0;j<contact.getNumContacts();j++) {
+			PfxContactPoint &cp = contact.getContactPoint(j);
+			cp.m_constraintRow[0] = sp[j].m_constraintRow[0];
+			cp.m_constraintRow[1] = sp[j].m_constraintRow[1];
+			cp.m_constraintRow[2] = sp[j].m_constraintRow[2];
+		}
+	}
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 // SINGLE THREAD
 
@@ -120,66 +267,21 @@ PfxInt32 pfxSetupContactConstraints(PfxSetupContactConstraintsParam &param)
 	
 	SCE_PFX_PUSH_MARKER("pfxSetupContactConstraints");
 
-	PfxConstraintPair *contactPairs = param.contactPairs;
-	PfxUInt32 numContactPairs = param.numContactPairs;
-	PfxContactManifold *offsetContactManifolds = param.offsetContactManifolds;
-	PfxRigidState *offsetRigidStates = param.offsetRigidStates;
-	PfxRigidBody *offsetRigidBodies = param.offsetRigidBodies;
-	PfxSolverBody *offsetSolverBodies = param.offsetSolverBodies;
+	PfxUInt32 *contactSolverOffsets = NULL;
+	PfxContactSolverPoint *contactSolverPoints = NULL;
 	
-	for(PfxUInt32 i=0;i<numContactPairs;i++) {
-		PfxConstraintPair &pair = contactPairs[i];
-		if(!pfxCheckSolver(pair)) {
-			continue;
+	if(param.contactSolverBuff) {
+		ret = pfxSetupContactSolverOffsets(param);
+		if(ret != SCE_PFX_OK) {
+			SCE_PFX_POP_MARKER();
+			return ret;
 		}
-
-		PfxUInt16 iA = pfxGetObjectIdA(pair);
-		PfxUInt16 iB = pfxGetObjectIdB(pair);
-		PfxUInt32 iConstraint = pfxGetConstraintId(pair);
-
-		PfxContactManifold &contact = offsetContactManifolds[iConstraint];
-
-		SCE_PFX_ALWAYS_ASSERT(iA==contact.getRigidBodyIdA());
-		SCE_PFX_ALWAYS_ASSERT(iB==contact.getRigidBodyIdB());
-
-		PfxRigidState &stateA = offsetRigidStates[iA];
-		PfxRigidBody &bodyA = offsetRigidBodies[iA];
-		PfxSolverBody &solverBodyA = offsetSolverBodies[iA];
-
-		PfxRigidState &stateB = offsetRigidStates[iB];
-		PfxRigidBody &bodyB = offsetRigidBodies[iB];
-		PfxSolverBody &solverBodyB = offsetSolverBodies[iB];
+		contactSolverOffsets = pfxGetContactSolverOffsets(param.contactSolverBuff);
+		contactSolverPoints = pfxGetContactSolverPoints(param.contactSolverBuff,param.numContactPairs);
+	}
 	
-		contact.setInternalFlag(0);
-		
-		PfxFloat restitution = 0.5f * (bodyA.getRestitution() + bodyB.getRestitution());
-		if(contact.getDuration() > 1) restitution = 0.0f;
-		
-		PfxFloat friction = sqrtf(bodyA.getFriction() * bodyB.getFriction());
-		
-		for(int j=0;j<contact.getNumContacts();j++) {
-			PfxContactPoint &cp = contact.getContactPoint(j);
-			
-			pfxSetupContactConstraint(
-				cp.m_constraintRow[0],
-				cp.m_constraintRow[1],
-				cp.m_constraintRow[2],
-				cp.m_distance,
-				restitution,
-				friction,
-				pfxReadVector3(cp.m_constraintRow[0].m_normal),
-				pfxReadVector3(cp.m_localPointA),
-				pfxReadVector3(cp.m_localPointB),
-				stateA,
-				stateB,
-				solverBodyA,
-				solverBodyB,
-				param.separateBias,
-				param.timeStep
-				);
-		}
-
-		contact.setCompositeFriction(friction);
+	for(PfxUInt32 i=0;i<param.numContactPairs;i++) {
+		pfxSetupContactConstraintPair(param,i,contactSolverPoints ? contactSolverPoints + contactSolverOffsets[i] : NULL);
 	}
 
 	SCE_PFX_POP_MARKER();
@@ -251,6 +353,13 @@ PfxInt32 pfxSolveConstraints(PfxSolveConstraintsParam &param)
 	PfxRigidState *offsetRigidStates = param.offsetRigidStates;
 	PfxSolverBody *offsetSolverBodies = param.offsetSolverBodies;
 	PfxUInt32 numRigidBodies = param.numRigidBodies;
+	PfxUInt32 *contactSolverOffsets = NULL;
+	PfxContactSolverPoint *contactSolverPoints = NULL;
+	
+	if(param.contactSolverBuff) {
+		contactSolverOffsets = pfxGetContactSolverOffsets(param.contactSolverBuff);
+		contactSolverPoints = pfxGetContactSolverPoints(param.contactSolverBuff,numContactPairs);
+	}
 	
 	// Warm Starting
 	{
@@ -285,6 +394,13 @@ PfxInt32 pfxSolveConstraints(PfxSolveConstraintsParam &param)
 			PfxUInt16 iA = pfxGetObjectIdA(pair);
 			PfxUInt16 iB = pfxGetObjectIdB(pair);
 
+			if(contactSolverPoints) {
+				for(PfxUInt32 j=contactSolverOffsets[i];j<contactSolverOffsets[i+1];j++) {
+					pfxWarmStartContactConstraint(contactSolverPoints[j],offsetSolverBodies[iA],offsetSolverBodies[iB]);
+				}
+				continue;
+			}
+
 			PfxContactManifold &contact = offsetContactManifolds[pfxGetConstraintId(pair)];
 
 			SCE_PFX_ASSERT(iA==contact.getRigidBodyIdA());
@@ -358,6 +474,13 @@ PfxInt32 pfxSolveConstraints(PfxSolveConstraintsParam &param)
 			PfxUInt16 iA = pfxGetObjectIdA(pair);
 			PfxUInt16 iB = pfxGetObjectIdB(pair);
 
+			if(contactSolverPoints) {
+				for(PfxUInt32 j=contactSolverOffsets[i];j<contactSolverOffsets[i+1];j++) {
+					pfxSolveContactConstraint(contactSolverPoints[j],offsetSolverBodies[iA],offsetSolverBodies[iB]);
+				}
+				continue;
+			}
+
 			PfxContactManifold &contact = offsetContactManifolds[pfxGetConstraintId(pair)];
 
 			SCE_PFX_ASSERT(iA==contact.getRigidBodyIdA());
@@ -383,6 +506,10 @@ PfxInt32 pfxSolveConstraints(PfxSolveConstraintsParam &param)
 		}
 	}
 
+	if(contactSolverPoints) {
+		pfxStoreContactSolverPoints(contactPairs,0,numContactPairs,offsetContactManifolds,contactSolverOffsets,contactSolverPoints);
+	}
+
 	for(PfxUInt32 i=0;i<numRigidBodies;i++) {
 		offsetRigidStates[i].setLinearVelocity(
 			offsetRigidStates[i].getLinearVelocity()+offsetSolverBodies[i].m_deltaLinearVelocity);
@@ -17,6 +17,8 @@ Physics Effects under the filename: physics_effects_license.txt
 #ifndef _SCE_PFX_PARALLEL_GROUP_H
 #define _SCE_PFX_PARALLEL_GROUP_H
 
+#include "../../base_level/base/pfx_common.h"
+
 ///////////////////////////////////////////////////////////////////////////////
 // Parallel Group
 
@@ -29,7 +31,7 @@ namespace sce {
 namespace PhysicsEffects {
 
 struct SCE_PFX_ALIGNED(128) PfxParallelBatch {
-	PfxUInt16 pairIndices[SCE_PFX_MAX_SOLVER_PAIRS];
+	PfxUInt32 pairIndices[SCE_PFX_MAX_SOLVER_PAIRS];
 };
 
 struct SCE_PFX_ALIGNED(128) PfxParallelGroup {
@@ -39,6 +41,21 @@ struct SCE_PFX_ALIGNED(128) PfxParallelGroup {
 SCE_PFX_PADDING(1,126)
 };
 
+//J ペアの分割結果の統計情報
+//E Statistics of splitting pairs into phases and batches
+struct PfxParallelGroupStats {
+	PfxUInt32 numPairs;				// 分割対象のペア数
+	PfxUInt32 numSkippedPairs;		// 拘束計算の不要なペア数
+	PfxUInt32 numSerialPairs;		// フェーズに収まらず逐次処理されるペア数
+	PfxUInt32 numPhases;			// フェーズ数
+	PfxUInt32 numBatches;			// 全フェーズのバッチ数の合計
+	PfxUInt32 targetPairsPerBatch;	// １バッチあたりの目標ペア数
+	PfxUInt32 minPairsPerBatch;		// バッチに含まれるペア数の最小値
+	PfxUInt32 maxPairsPerBatch;		// バッチに含まれるペア数の最大値
+	PfxUInt32 numPairsInPhase[SCE_PFX_MAX_SOLVER_PHASES];	// 各フェーズに含まれるペア数
+	PfxUInt32 numBatchesInPhase[SCE_PFX_MAX_SOLVER_PHASES];	// 各フェーズに含まれるバッチ数
+};
+
 } //namespace PhysicsEffects
 } //namespace sce
 #endif // _SCE_PFX_PARALLEL_GROUP_H
@@ -0,0 +1,82 @@
+/*
+Physics Effects Copyright(C) 2011 Sony Computer Entertainment Inc.
+All rights reserved.
+
+Physics Effects is open software; you can redistribute it and/or
+modify it under the terms of the BSD License.
+
+Physics Effects is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+See the BSD License for more details.
+
+A copy of the BSD License is distributed with
+Physics Effects under the filename: physics_effects_license.txt
+*/
+
+#include "base_level/base/pfx_perf_counter.h"
+#include "base_level/solver/pfx_integrate.h"
+#include "low_level/solver/pfx_update_rigid_states.h"
+
+namespace sce {
+namespace PhysicsEffects {
+
+PfxInt32 pfxCheckParamOfUpdateRigidStates(const PfxUpdateRigidStatesParam &param);
+
+///////////////////////////////////////////////////////////////////////////////
+// MULTI THREAD
+
+struct PfxUpdateRigidStatesIO {
+	PfxRigidState *states;
+	PfxRigidBody *bodies;
+	PfxFloat timeStep;
+};
+
+void pfxUpdateRigidStatesTaskEntry(PfxTaskArg *arg)
+{
+	PfxUpdateRigidStatesIO *io = (PfxUpdateRigidStatesIO*)arg->io;
+	PfxUInt32 start = arg->data[0];
+	PfxUInt32 num = arg->data[1];
+
+	for(PfxUInt32 i=start;i<start+num;i++) {
+		pfxIntegrate(io->states[i],io->bodies[i],io->timeStep);
+	}
+}
+
+PfxInt32 pfxUpdateRigidStates(PfxUpdateRigidStatesParam &param,PfxTaskManager *taskManager)
+{
+	PfxInt32 ret = pfxCheckParamOfUpdateRigidStates(param);
+	if(ret != SCE_PFX_OK) return ret;
+	if(!taskManager) return SCE_PFX_ERR_INVALID_VALUE;
+
+	SCE_PFX_PUSH_MARKER("pfxUpdateRigidStates");
+
+	PfxUpdateRigidStatesIO *io = (PfxUpdateRigidStatesIO*)taskManager->allocate(sizeof(PfxUpdateRigidStatesIO));
+	io->states = param.states;
+	io->bodies = param.bodies;
+	io->timeStep = param.timeStep;
+
+	PfxUInt32 numTasks = taskManager->getNumTasks();
+	taskManager->setTaskEntry((void*)pfxUpdateRigidStatesTaskEntry);
+
+	for(PfxUInt32 t=0;t<numTasks;t++) {
+		PfxUInt32 start = param.numRigidBodies*t/numTasks;
+		PfxUInt32 end = param.numRigidBodies*(t+1)/numTasks;
+		taskManager->startTask(t,io,start,end-start,0,0);
+	}
+
+	for(PfxUInt32 t=0;t<numTasks;t++) {
+		int taskId;
+		PfxUInt32 data1,data2,data3,data4;
+		taskManager->waitTask(taskId,data1,data2,data3,data4);
+	}
+
+	taskManager->deallocate(io);
+
+	SCE_PFX_POP_MARKER();
+
+	return SCE_PFX_OK;
+}
+
+} //namespace PhysicsEffects
+} //namespace sce
@@ -25,6 +25,27 @@ Physics Effects under the filename: physics_effects_license.txt
 namespace sce {
 namespace PhysicsEffects {
 
+//J ソートアルゴリズム
+//J kPfxSortAlgorithmMerge : マージソート
+//J kPfxSortAlgorithmRadix : 32ビットキーのLSD基数ソート（安定ソート）
+//J 同じキーを持つデータの順序はアルゴリズムによって異なる場合がある
+//E Sort algorithms
+//E kPfxSortAlgorithmMerge : Merge sort
+//E kPfxSortAlgorithmRadix : LSD radix sort on 32 bit keys (stable)
+//E The order of data with equal keys may differ between algorithms
+enum ePfxSortAlgorithm {
+	kPfxSortAlgorithmMerge = 0,
+	kPfxSortAlgorithmRadix,
+	kPfxSortAlgorithmCount
+};
+
+//J アルゴリズムを指定しないpfxParallelSortが使用するアルゴリズム（初期値はマージソート）
+//J ソートの実行中に変更しないこと
+//E The algorithm used by pfxParallelSort without an explicit algorithm (merge sort by default)
+//E Do not change it while sorting
+void pfxSetParallelSortAlgorithm(ePfxSortAlgorithm algorithm);
+ePfxSortAlgorithm pfxGetParallelSortAlgorithm();
+
 PfxInt32 pfxParallelSort(PfxSortData16 *data,PfxUInt32 numData,void *workBuff,PfxUInt32 workBytes);
 
 PfxInt32 pfxParallelSort(PfxSortData32 *data,PfxUInt32 numData,void *workBuff,PfxUInt32 workBytes);
@@ -35,6 +56,18 @@ PfxInt32 pfxParallelSort(PfxSortData16 *data,PfxUInt32 numData,void *workBuff,Pf
 PfxInt32 pfxParallelSort(PfxSortData32 *data,PfxUInt32 numData,void *workBuff,PfxUInt32 workBytes,
 	PfxTaskManager *taskManager);
 
+PfxInt32 pfxParallelSort(PfxSortData16 *data,PfxUInt32 numData,void *workBuff,PfxUInt32 workBytes,
+	ePfxSortAlgorithm algorithm);
+
+PfxInt32 pfxParallelSort(PfxSortData32 *data,PfxUInt32 numData,void *workBuff,PfxUInt32 workBytes,
+	ePfxSortAlgorithm algorithm);
+
+PfxInt32 pfxParallelSort(PfxSortData16 *data,PfxUInt32 numData,void *workBuff,PfxUInt32 workBytes,
+	PfxTaskManager *taskManager,ePfxSortAlgorithm algorithm);
+
+PfxInt32 pfxParallelSort(PfxSortData32 *data,PfxUInt32 numData,void *workBuff,PfxUInt32 workBytes,
+	PfxTaskManager *taskManager,ePfxSortAlgorithm algorithm);
+
 } //namespace PhysicsEffects
 } //namespace sce
 #endif // _SCE_PFX_PARALLEL_SORT_H
@@ -0,0 +1,319 @@
+/*
+Physics Effects Copyright(C) 2011 Sony Computer Entertainment Inc.
+All rights reserved.
+
+Physics Effects is open software; you can redistribute it and/or
+modify it under the terms of the BSD License.
+
+Physics Effects is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+See the BSD License for more details.
+
+A copy of the BSD License is distributed with
+Physics Effects under the filename: physics_effects_license.txt
+*/
+
+#include "base_level/base/pfx_perf_counter.h"
+#include "low_level/sort/pfx_parallel_sort.h"
+#include "base_level/sort/pfx_sort.h"
+
+///////////////////////////////////////////////////////////////////////////////
+// MULTI THREAD
+
+//J マージソート : 各タスクがデータをnumTask個のブロックに分けてソートし、
+//J バリアで同期しながらブロックを2つずつマージしていく
+//J 基数ソート : 各タスクが自分のブロックのヒストグラムを作成し、
+//J 全タスクのヒストグラムから求めた位置へ8ビットずつ並列に書き込む
+//E Merge sort : Each task sorts one of numTasks blocks, then blocks are merged
+//E in pairs round by round with a barrier between rounds
+//E Radix sort : Each task counts digits of its own block, then scatters the block
+//E 8 bits at a time to offsets computed from the histograms of all tasks
+
+namespace sce {
+namespace PhysicsEffects {
+
+struct PfxParallelSortIO {
+	void *data;
+	void *buff;
+	PfxUInt32 numData;
+};
+
+static SCE_PFX_FORCE_INLINE
+PfxUInt32 pfxGetSortBlockStart(PfxUInt32 numData,PfxUInt32 numBlocks,PfxUInt32 blockId)
+{
+	if(blockId >= numBlocks) return numData;
+	return (PfxUInt32)(((PfxUInt64)numData*blockId)/numBlocks);
+}
+
+template <class SortData>
+void pfxMergeSortedBlocks(SortData *d,SortData *buff,PfxUInt32 n1,PfxUInt32 n2)
+{
+	SortData *d1 = d;
+	SortData *d2 = d + n1;
+	PfxUInt32 i=0,j=0,k=0;
+
+	//J 同じキーの場合は前のブロックを優先する（安定マージ）
+	//E Prefer the preceding block on equal keys (stable merge)
+	while(i<n1&&j<n2) {
+		if(pfxGetKey(d2[j]) < pfxGetKey(d1[i])) {
+			buff[k++] = d2[j++];
+		}
+		else {
+			buff[k++] = d1[i++];
+		}
+	}
+	while(i<n1) buff[k++] = d1[i++];
+	while(j<n2) buff[k++] = d2[j++];
+
+	memcpy(d,buff,sizeof(SortData)*k);
+}
+
+template <class SortData>
+void pfxParallelSortTaskEntry(PfxTaskArg *arg)
+{
+	PfxParallelSortIO *io = (PfxParallelSortIO*)arg->io;
+	SortData *data = (SortData*)io->data;
+	SortData *buff = (SortData*)io->buff;
+	PfxUInt32 numData = io->numData;
+	PfxUInt32 taskId = arg->taskId;
+	PfxUInt32 numBlocks = arg->maxTasks;
+
+	{
+		PfxUInt32 start = pfxGetSortBlockStart(numData,numBlocks,taskId);
+		PfxUInt32 end = pfxGetSortBlockStart(numData,numBlocks,taskId+1);
+		if(end > start) {
+			pfxSort(data+start,buff+start,end-start);
+		}
+	}
+
+	for(PfxUInt32 width=1;width<numBlocks;width<<=1) {
+		arg->barrier->sync();
+
+		PfxUInt32 numMerges = (numBlocks+width*2-1)/(width*2);
+		for(PfxUInt32 m=taskId;m<numMerges;m+=numBlocks) {
+			PfxUInt32 b0 = m*width*2;
+			PfxUInt32 start = pfxGetSortBlockStart(numData,numBlocks,b0);
+			PfxUInt32 mid = pfxGetSortBlockStart(numData,numBlocks,b0+width);
+			PfxUInt32 end = pfxGetSortBlockStart(numData,numBlocks,b0+width*2);
+			if(mid < end) {
+				pfxMergeSortedBlocks(data+start,buff+start,mid-start,end-mid);
+			}
+		}
+	}
+}
+
+#define SCE_PFX_RADIX_SORT_BUCKETS 256
+
+struct PfxParallelRadixSortIO {
+	void *data;
+	void *buff;
+	PfxUInt32 numData;
+	PfxUInt32 *count; // [numTasks][4][SCE_PFX_RADIX_SORT_BUCKETS]
+};
+
+template <class SortData>
+static void pfxCountDigits(const SortData *data,PfxUInt32 start,PfxUInt32 end,PfxUInt32 shift,PfxUInt32 *count)
+{
+	memset(count,0,sizeof(PfxUInt32)*SCE_PFX_RADIX_SORT_BUCKETS);
+	for(PfxUInt32 i=start;i<end;i++) {
+		count[(pfxGetKey(data[i])>>shift)&0xff]++;
+	}
+}
+
+template <class SortData>
+void pfxParallelRadixSortTaskEntry(PfxTaskArg *arg)
+{
+	PfxParallelRadixSortIO *io = (PfxParallelRadixSortIO*)arg->io;
+	SortData *data = (SortData*)io->data;
+	SortData *buff = (SortData*)io->buff;
+	PfxUInt32 numData = io->numData;
+	PfxUInt32 taskId = arg->taskId;
+	PfxUInt32 numTasks = arg->maxTasks;
+	PfxUInt32 start = pfxGetSortBlockStart(numData,numTasks,taskId);
+	PfxUInt32 end = pfxGetSortBlockStart(numData,numTasks,taskId+1);
+
+	const PfxUInt32 countStride = 4 * SCE_PFX_RADIX_SORT_BUCKETS;
+	PfxUInt32 *count = io->count + taskId * countStride;
+
+	//J 4桁分のヒストグラムを1回の走査で作成する
+	//E Count all four digits in a single pass
+	memset(count,0,sizeof(PfxUInt32)*countStride);
+	for(PfxUInt32 i=start;i<end;i++) {
+		PfxUInt32 key = pfxGetKey(data[i]);
+		count[key&0xff]++;
+		count[SCE_PFX_RADIX_SORT_BUCKETS+((key>>8)&0xff)]++;
+		count[SCE_PFX_RADIX_SORT_BUCKETS*2+((key>>16)&0xff)]++;
+		count[SCE_PFX_RADIX_SORT_BUCKETS*3+(key>>24)]++;
+	}
+
+	arg->barrier->sync();
+
+	//J 全てのキーで同じ桁はスキップする（全タスクで同じ判定になる）
+	//E Skip digits that are the same for all keys (every task makes the same decision)
+	PfxBool skip[4];
+	for(PfxUInt32 pass=0;pass<4;pass++) {
+		skip[pass] = false;
+		for(PfxUInt32 b=0;b<SCE_PFX_RADIX_SORT_BUCKETS && !skip[pass];b++) {
+			PfxUInt32 total = 0;
+			for(PfxUInt32 t=0;t<numTasks;t++) {
+				total += io->count[t*countStride+pass*SCE_PFX_RADIX_SORT_BUCKETS+b];
+			}
+			if(total == numData) skip[pass] = true;
+			if(total > 0) break;
+		}
+	}
+
+	SortData *src = data;
+	SortData *dst = buff;
+	PfxBool first = true;
+
+	for(PfxUInt32 pass=0;pass<4;pass++) {
+		if(skip[pass]) continue;
+
+		PfxUInt32 shift = pass*8;
+
+		//J 2回目以降は並べ替えた後のブロックで数え直す
+		//E After the first pass, digits are counted again over the reordered block
+		if(!first) {
+			pfxCountDigits(src,start,end,shift,count+pass*SCE_PFX_RADIX_SORT_BUCKETS);
+			arg->barrier->sync();
+		}
+		first = false;
+
+		//J バケットの開始位置 = 前のバケットの総数 + 前のタスクの同じバケットの数
+		//E Offset of a bucket = total of preceding buckets + counts of preceding tasks in the bucket
+		PfxUInt32 offset[SCE_PFX_RADIX_SORT_BUCKETS];
+		PfxUInt32 sum = 0;
+		for(PfxUInt32 b=0;b<SCE_PFX_RADIX_SORT_BUCKETS;b++) {
+			PfxUInt32 before = 0,total = 0;
+			for(PfxUInt32 t=0;t<numTasks;t++) {
+				PfxUInt32 c = io->count[t*countStride+pass*SCE_PFX_RADIX_SORT_BUCKETS+b];
+				if(t < taskId) before += c;
+				total += c;
+			}
+			offset[b] = sum + before;
+			sum += total;
+		}
+
+		for(PfxUInt32 i=start;i<end;i++) {
+			dst[offset[(pfxGetKey(src[i])>>shift)&0xff]++] = src[i];
+		}
+
+		arg->barrier->sync();
+
+		SortData *tmp = src;
+		src = dst;
+		dst = tmp;
+	}
+
+	if(src != data && end > start) {
+		memcpy(data+start,src+start,sizeof(SortData)*(end-start));
+	}
+}
+
+template <class SortData>
+PfxInt32 pfxParallelSortInternal(
+	SortData *data,PfxUInt32 numData,
+	void *workBuff,PfxUInt32 workBytes,
+	PfxTaskManager *taskManager,
+	ePfxSortAlgorithm algorithm)
+{
+	if(!taskManager || algorithm >= kPfxSortAlgorithmCount) return SCE_PFX_ERR_INVALID_VALUE;
+	if(!SCE_PFX_PTR_IS_ALIGNED16(workBuff)) return SCE_PFX_ERR_INVALID_ALIGN;
+	if(SCE_PFX_AVAILABLE_BYTES_ALIGN16(workBuff,workBytes) < sizeof(SortData) * numData) return SCE_PFX_ERR_OUT_OF_BUFFER;
+
+	SCE_PFX_PUSH_MARKER("pfxParallelSort");
+
+	PfxUInt32 numTasks = taskManager->getNumTasks();
+
+	if(numTasks < 2 || numData < numTasks * 2) {
+		if(algorithm == kPfxSortAlgorithmRadix) {
+			pfxRadixSort(data,(SortData*)workBuff,numData);
+		}
+		else {
+			pfxSort(data,(SortData*)workBuff,numData);
+		}
+	}
+	else if(algorithm == kPfxSortAlgorithmRadix) {
+		PfxParallelRadixSortIO *io = (PfxParallelRadixSortIO*)taskManager->allocate(sizeof(PfxParallelRadixSortIO));
+		io->data = data;
+		io->buff = workBuff;
+		io->numData = numData;
+		io->count = (PfxUInt32*)taskManager->allocate(sizeof(PfxUInt32)*4*SCE_PFX_RADIX_SORT_BUCKETS*numTasks);
+
+		taskManager->setTaskEntry((void*)pfxParallelRadixSortTaskEntry<SortData>);
+
+		for(PfxUInt32 t=0;t<numTasks;t++) {
+			taskManager->startTask(t,io,0,0,0,0);
+		}
+
+		for(PfxUInt32 t=0;t<numTasks;t++) {
+			int taskId;
+			PfxUInt32 data1,data2,data3,data4;
+			taskManager->waitTask(taskId,data1,data2,data3,data4);
+		}
+
+		taskManager->deallocate(io->count);
+		taskManager->deallocate(io);
+	}
+	else {
+		PfxParallelSortIO *io = (PfxParallelSortIO*)taskManager->allocate(sizeof(PfxParallelSortIO));
+		io->data = data;
+		io->buff = workBuff;
+		io->numData = numData;
+
+		taskManager->setTaskEntry((void*)pfxParallelSortTaskEntry<SortData>);
+
+		for(PfxUInt32 t=0;t<numTasks;t++) {
+			taskManager->startTask(t,io,0,0,0,0);
+		}
+
+		for(PfxUInt32 t=0;t<numTasks;t++) {
+			int taskId;
+			PfxUInt32 data1,data2,data3,data4;
+			taskManager->waitTask(taskId,data1,data2,data3,data4);
+		}
+
+		taskManager->deallocate(io);
+	}
+
+	SCE_PFX_POP_MARKER();
+
+	return SCE_PFX_OK;
+}
+
+PfxInt32 pfxParallelSort(
+	PfxSortData16 *data,PfxUInt32 numData,
+	void *workBuff,PfxUInt32 workBytes,
+	PfxTaskManager *taskManager)
+{
+	return pfxParallelSortInternal(data,numData,workBuff,workBytes,taskManager,pfxGetParallelSortAlgorithm());
+}
+
+PfxInt32 pfxParallelSort(
+	PfxSortData32 *data,PfxUInt32 numData,
+	void *workBuff,PfxUInt32 workBytes,
+	PfxTaskManager *taskManager)
+{
+	return pfxParallelSortInternal(data,numData,workBuff,workBytes,taskManager,pfxGetParallelSortAlgorithm());
+}
+
+PfxInt32 pfxParallelSort(
+	PfxSortData16 *data,PfxUInt32 numData,
+	void *workBuff,PfxUInt32 workBytes,
+	PfxTaskManager *taskManager,ePfxSortAlgorithm algorithm)
+{
+	return pfxParallelSortInternal(data,numData,workBuff,workBytes,taskManager,algorithm);
+}
+
+PfxInt32 pfxParallelSort(
+	PfxSortData32 *data,PfxUInt32 numData,
+	void *workBuff,PfxUInt32 workBytes,
+	PfxTaskManager *taskManager,ePfxSortAlgorithm algorithm)
+{
+	return pfxParallelSortInternal(data,numData,workBuff,workBytes,taskManager,algorithm);
+}
+
+} //namespace PhysicsEffects
+} //namespace sce
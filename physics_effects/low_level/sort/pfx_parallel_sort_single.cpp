@@ -24,32 +24,69 @@ Physics Effects under the filename: physics_effects_license.txt
 namespace sce {
 namespace PhysicsEffects {
 
-PfxInt32 pfxParallelSort(
-	PfxSortData16 *data,PfxUInt32 numData,
-	void *workBuff,PfxUInt32 workBytes)
+static ePfxSortAlgorithm gPfxParallelSortAlgorithm = kPfxSortAlgorithmMerge;
+
+void pfxSetParallelSortAlgorithm(ePfxSortAlgorithm algorithm)
+{
+	SCE_PFX_ASSERT(algorithm < kPfxSortAlgorithmCount);
+	gPfxParallelSortAlgorithm = algorithm;
+}
+
+ePfxSortAlgorithm pfxGetParallelSortAlgorithm()
 {
+	return gPfxParallelSortAlgorithm;
+}
+
+template <class SortData>
+PfxInt32 pfxParallelSortSingle(
+	SortData *data,PfxUInt32 numData,
+	void *workBuff,PfxUInt32 workBytes,
+	ePfxSortAlgorithm algorithm)
+{
+	if(algorithm >= kPfxSortAlgorithmCount) return SCE_PFX_ERR_INVALID_VALUE;
 	if(!SCE_PFX_PTR_IS_ALIGNED16(workBuff)) return SCE_PFX_ERR_INVALID_ALIGN;
-	if(SCE_PFX_AVAILABLE_BYTES_ALIGN16(workBuff,workBytes) < sizeof(PfxSortData16) * numData) return SCE_PFX_ERR_OUT_OF_BUFFER;
+	if(SCE_PFX_AVAILABLE_BYTES_ALIGN16(workBuff,workBytes) < sizeof(SortData) * numData) return SCE_PFX_ERR_OUT_OF_BUFFER;
 
 	SCE_PFX_PUSH_MARKER("pfxParallelSort");
-	pfxSort(data,(PfxSortData16*)workBuff,numData);
+	if(algorithm == kPfxSortAlgorithmRadix) {
+		pfxRadixSort(data,(SortData*)workBuff,numData);
+	}
+	else {
+		pfxSort(data,(SortData*)workBuff,numData);
+	}
 	SCE_PFX_POP_MARKER();
 
 	return SCE_PFX_OK;
 }
 
+PfxInt32 pfxParallelSort(
+	PfxSortData16 *data,PfxUInt32 numData,
+	void *workBuff,PfxUInt32 workBytes)
+{
+	return pfxParallelSortSingle(data,numData,workBuff,workBytes,gPfxParallelSortAlgorithm);
+}
+
 PfxInt32 pfxParallelSort(
 	PfxSortData32 *data,PfxUInt32 numData,
 	void *workBuff,PfxUInt32 workBytes)
 {
-	if(!SCE_PFX_PTR_IS_ALIGNED16(workBuff)) return SCE_PFX_ERR_INVALID_ALIGN;
-	if(SCE_PFX_AVAILABLE_BYTES_ALIGN16(workBuff,workBytes) < sizeof(PfxSortData32) * numData) return SCE_PFX_ERR_OUT_OF_BUFFER;
+	return pfxParallelSortSingle(data,numData,workBuff,workBytes,gPfxParallelSortAlgorithm);
+}
 
-	SCE_PFX_PUSH_MARKER("pfxParallelSort");
-	pfxSort(data,(PfxSortData32*)workBuff,numData);
-	SCE_PFX_POP_MARKER();
+PfxInt32 pfxParallelSort(
+	PfxSortData16 *data,PfxUInt32 numData,
+	void *workBuff,PfxUInt32 workBytes,
+	ePfxSortAlgorithm algorithm)
+{
+	return pfxParallelSortSingle(data,numData,workBuff,workBytes,algorithm);
+}
 
-	return SCE_PFX_OK;
+PfxInt32 pfxParallelSort(
+	PfxSortData32 *data,PfxUInt32 numData,
+	void *workBuff,PfxUInt32 workBytes,
+	ePfxSortAlgorithm algorithm)
+{
+	return pfxParallelSortSingle(data,numData,workBuff,workBytes,algorithm);
 }
 
 } //namespace PhysicsEffects
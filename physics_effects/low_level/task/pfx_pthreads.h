@@ -0,0 +1,28 @@
+/*
+Physics Effects Copyright(C) 2011 Sony Computer Entertainment Inc.
+All rights reserved.
+
+Physics Effects is open software; you can redistribute it and/or
+modify it under the terms of the BSD License.
+
+Physics Effects is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+See the BSD License for more details.
+
+A copy of the BSD License is distributed with
+Physics Effects under the filename: physics_effects_license.txt
+*/
+
+#ifndef _SCE_PFX_PTHREADS_H
+#define _SCE_PFX_PTHREADS_H
+
+//J POSIXスレッドが利用可能な環境ではSCE_PFX_USE_PTHREADSが定義される
+//E SCE_PFX_USE_PTHREADS is defined on platforms which provide POSIX threads
+
+#if !defined(_WIN32)
+	#define SCE_PFX_USE_PTHREADS
+	#include <pthread.h>
+#endif
+
+#endif // _SCE_PFX_PTHREADS_H
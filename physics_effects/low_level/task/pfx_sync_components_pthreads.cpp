@@ -0,0 +1,117 @@
+/*
+Physics Effects Copyright(C) 2011 Sony Computer Entertainment Inc.
+All rights reserved.
+
+Physics Effects is open software; you can redistribute it and/or
+modify it under the terms of the BSD License.
+
+Physics Effects is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+See the BSD License for more details.
+
+A copy of the BSD License is distributed with
+Physics Effects under the filename: physics_effects_license.txt
+*/
+
+#include "low_level/task/pfx_sync_components_pthreads.h"
+
+#ifdef SCE_PFX_USE_PTHREADS
+
+namespace sce {
+namespace PhysicsEffects {
+
+///////////////////////////////////////////////////////////////////////////////
+// Barrier
+
+PfxBarrierPthreads::PfxBarrierPthreads(int n)
+{
+	SCE_PFX_ASSERT(n>0);
+	pthread_mutex_init(&m_mutex,NULL);
+	pthread_cond_init(&m_cond,NULL);
+	m_maxCount = n;
+	m_count = 0;
+	m_generation = 0;
+}
+
+PfxBarrierPthreads::~PfxBarrierPthreads()
+{
+	pthread_cond_destroy(&m_cond);
+	pthread_mutex_destroy(&m_mutex);
+}
+
+void PfxBarrierPthreads::sync()
+{
+	pthread_mutex_lock(&m_mutex);
+
+	//J 世代番号で起床条件を判定するため、スプリアスウェイクアップに影響されない
+	//E Waiting on a generation number makes the barrier safe against spurious wakeups
+	PfxUInt32 generation = m_generation;
+	if(++m_count >= m_maxCount) {
+		m_count = 0;
+		m_generation++;
+		pthread_cond_broadcast(&m_cond);
+	}
+	else {
+		while(generation == m_generation) {
+			pthread_cond_wait(&m_cond,&m_mutex);
+		}
+	}
+
+	pthread_mutex_unlock(&m_mutex);
+}
+
+void PfxBarrierPthreads::setMaxCount(int n)
+{
+	SCE_PFX_ASSERT(n>0);
+	pthread_mutex_lock(&m_mutex);
+	SCE_PFX_ASSERT(m_count==0);
+	m_maxCount = n;
+	pthread_mutex_unlock(&m_mutex);
+}
+
+int PfxBarrierPthreads::getMaxCount()
+{
+	return m_maxCount;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Critical Section
+
+PfxCriticalSectionPthreads::PfxCriticalSectionPthreads()
+{
+	pthread_mutex_init(&m_mutex,NULL);
+	memset(m_commonBuff,0,sizeof(m_commonBuff));
+}
+
+PfxCriticalSectionPthreads::~PfxCriticalSectionPthreads()
+{
+	pthread_mutex_destroy(&m_mutex);
+}
+
+PfxUInt32 PfxCriticalSectionPthreads::getSharedParam(int i)
+{
+	SCE_PFX_ASSERT(i>=0&&i<32);
+	return m_commonBuff[i];
+}
+
+void PfxCriticalSectionPthreads::setSharedParam(int i,PfxUInt32 p)
+{
+	SCE_PFX_ASSERT(i>=0&&i<32);
+	m_commonBuff[i] = p;
+}
+
+void PfxCriticalSectionPthreads::lock()
+{
+	pthread_mutex_lock(&m_mutex);
+}
+
+void PfxCriticalSectionPthreads::unlock()
+{
+	pthread_mutex_unlock(&m_mutex);
+}
+
+} //namespace PhysicsEffects
+} //namespace sce
+
+#endif // SCE_PFX_USE_PTHREADS
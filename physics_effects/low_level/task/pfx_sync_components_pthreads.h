@@ -0,0 +1,67 @@
+/*
+Physics Effects Copyright(C) 2011 Sony Computer Entertainment Inc.
+All rights reserved.
+
+Physics Effects is open software; you can redistribute it and/or
+modify it under the terms of the BSD License.
+
+Physics Effects is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+See the BSD License for more details.
+
+A copy of the BSD License is distributed with
+Physics Effects under the filename: physics_effects_license.txt
+*/
+
+#ifndef _SCE_PFX_SYNC_COMPONENTS_PTHREADS_H
+#define _SCE_PFX_SYNC_COMPONENTS_PTHREADS_H
+
+#include "pfx_sync_components.h"
+#include "pfx_pthreads.h"
+
+#ifdef SCE_PFX_USE_PTHREADS
+
+//J POSIXスレッドによる同期コンポネントの実装
+//E Synchronization components implemented with POSIX threads
+namespace sce {
+namespace PhysicsEffects {
+
+class PfxBarrierPthreads : public PfxBarrier {
+private:
+	pthread_mutex_t m_mutex;
+	pthread_cond_t m_cond;
+	int m_maxCount;
+	int m_count;
+	PfxUInt32 m_generation;
+
+public:
+	PfxBarrierPthreads(int n=1);
+	virtual ~PfxBarrierPthreads();
+
+	virtual void sync();
+	virtual void setMaxCount(int n);
+	virtual int  getMaxCount();
+};
+
+class PfxCriticalSectionPthreads : public PfxCriticalSection {
+private:
+	pthread_mutex_t m_mutex;
+
+public:
+	PfxCriticalSectionPthreads();
+	virtual ~PfxCriticalSectionPthreads();
+
+	virtual PfxUInt32 getSharedParam(int i);
+	virtual void setSharedParam(int i,PfxUInt32 p);
+
+	virtual void lock();
+	virtual void unlock();
+};
+
+} //namespace PhysicsEffects
+} //namespace sce
+
+#endif // SCE_PFX_USE_PTHREADS
+
+#endif // _SCE_PFX_SYNC_COMPONENTS_PTHREADS_H
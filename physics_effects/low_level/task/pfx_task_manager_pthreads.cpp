@@ -0,0 +1,233 @@
+/*
+Physics Effects Copyright(C) 2011 Sony Computer Entertainment Inc.
+All rights reserved.
+
+Physics Effects is open software; you can redistribute it and/or
+modify it under the terms of the BSD License.
+
+Physics Effects is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+See the BSD License for more details.
+
+A copy of the BSD License is distributed with
+Physics Effects under the filename: physics_effects_license.txt
+*/
+
+#include "low_level/task/pfx_task_manager_pthreads.h"
+
+#ifdef SCE_PFX_USE_PTHREADS
+
+namespace sce {
+namespace PhysicsEffects {
+
+enum {
+	kPfxPthreadsCommandIdle = 0,
+	kPfxPthreadsCommandRun,
+	kPfxPthreadsCommandQuit
+};
+
+struct PfxPthreadsTaskState {
+	pthread_t m_thread;
+	pthread_mutex_t m_mutex;
+	pthread_cond_t m_cond;
+	PfxTaskManagerPthreads *m_manager;
+	PfxUInt32 m_taskId;
+	PfxUInt32 m_command;
+};
+
+PfxUInt32 pfxGetWorkBytesOfTaskManagerPthreads(PfxUInt32 maxTasks)
+{
+	return 128 +
+		SCE_PFX_ALLOC_BYTES_ALIGN16(sizeof(PfxTaskArg)*maxTasks) +
+		SCE_PFX_ALLOC_BYTES_ALIGN16(sizeof(PfxPthreadsTaskState)*maxTasks) +
+		SCE_PFX_ALLOC_BYTES_ALIGN16(sizeof(PfxUInt32)*maxTasks);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Worker Thread
+
+void *PfxTaskManagerPthreads::threadMain(void *arg)
+{
+	PfxPthreadsTaskState *state = (PfxPthreadsTaskState*)arg;
+	PfxTaskManagerPthreads *manager = state->m_manager;
+
+	for(;;) {
+		pthread_mutex_lock(&state->m_mutex);
+		while(state->m_command == kPfxPthreadsCommandIdle) {
+			pthread_cond_wait(&state->m_cond,&state->m_mutex);
+		}
+		PfxUInt32 command = state->m_command;
+		if(command == kPfxPthreadsCommandRun) {
+			state->m_command = kPfxPthreadsCommandIdle;
+		}
+		pthread_mutex_unlock(&state->m_mutex);
+
+		if(command == kPfxPthreadsCommandQuit) {
+			break;
+		}
+
+		manager->m_taskEntry(&manager->m_taskArg[state->m_taskId]);
+		manager->notifyDone(state->m_taskId);
+	}
+
+	return NULL;
+}
+
+void PfxTaskManagerPthreads::notifyDone(PfxUInt32 taskId)
+{
+	pthread_mutex_lock(&m_doneMutex);
+	m_doneQueue[m_doneTail%m_maxTasks] = taskId;
+	m_doneTail++;
+	pthread_cond_signal(&m_doneCond);
+	pthread_mutex_unlock(&m_doneMutex);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Task Manager
+
+PfxTaskManagerPthreads::PfxTaskManagerPthreads(PfxUInt32 numTasks,PfxUInt32 maxTasks,void *workBuff,PfxUInt32 workBytes)
+	: PfxTaskManager(numTasks,maxTasks,workBuff,workBytes),m_barrier(numTasks)
+{
+	m_taskStates = (PfxPthreadsTaskState*)m_pool.allocate(sizeof(PfxPthreadsTaskState)*m_maxTasks);
+	m_doneQueue = (PfxUInt32*)m_pool.allocate(sizeof(PfxUInt32)*m_maxTasks);
+	m_doneHead = 0;
+	m_doneTail = 0;
+	m_numRunning = 0;
+	m_taskEntry = NULL;
+	m_initialized = false;
+}
+
+PfxTaskManagerPthreads::~PfxTaskManagerPthreads()
+{
+	if(m_initialized) {
+		finalize();
+	}
+}
+
+PfxUInt32 PfxTaskManagerPthreads::getSharedParam(int i)
+{
+	return m_criticalSection.getSharedParam(i);
+}
+
+void PfxTaskManagerPthreads::setSharedParam(int i,PfxUInt32 p)
+{
+	m_criticalSection.setSharedParam(i,p);
+}
+
+void PfxTaskManagerPthreads::setNumTasks(PfxUInt32 tasks)
+{
+	//J 実行中のタスクがある間はタスク数を変更できない
+	//E The number of tasks can't be changed while tasks are running
+	SCE_PFX_ASSERT(m_numRunning == 0);
+	PfxTaskManager::setNumTasks(SCE_PFX_MAX(1,tasks));
+	m_barrier.setMaxCount(m_numTasks);
+}
+
+void PfxTaskManagerPthreads::startTask(int taskId,void *io,PfxUInt32 data1,PfxUInt32 data2,PfxUInt32 data3,PfxUInt32 data4)
+{
+	SCE_PFX_ASSERT(m_initialized);
+	SCE_PFX_ASSERT(taskId>=0&&taskId<(int)m_numTasks);
+	SCE_PFX_ASSERT(m_taskEntry);
+
+	PfxTaskArg &arg = m_taskArg[taskId];
+	arg.taskId = taskId;
+	arg.maxTasks = m_numTasks;
+	arg.barrier = &m_barrier;
+	arg.criticalSection = &m_criticalSection;
+	arg.io = io;
+	arg.data[0] = data1;
+	arg.data[1] = data2;
+	arg.data[2] = data3;
+	arg.data[3] = data4;
+
+	PfxPthreadsTaskState &state = m_taskStates[taskId];
+	pthread_mutex_lock(&state.m_mutex);
+	SCE_PFX_ASSERT(state.m_command == kPfxPthreadsCommandIdle);
+	state.m_command = kPfxPthreadsCommandRun;
+	pthread_cond_signal(&state.m_cond);
+	pthread_mutex_unlock(&state.m_mutex);
+
+	m_numRunning++;
+}
+
+void PfxTaskManagerPthreads::waitTask(int &taskId,PfxUInt32 &data1,PfxUInt32 &data2,PfxUInt32 &data3,PfxUInt32 &data4)
+{
+	SCE_PFX_ASSERT(m_numRunning > 0);
+
+	pthread_mutex_lock(&m_doneMutex);
+	while(m_doneHead == m_doneTail) {
+		pthread_cond_wait(&m_doneCond,&m_doneMutex);
+	}
+	PfxUInt32 id = m_doneQueue[m_doneHead%m_maxTasks];
+	m_doneHead++;
+	pthread_mutex_unlock(&m_doneMutex);
+
+	m_numRunning--;
+
+	//J タスクはarg->dataに結果を書き戻すことができる
+	//E A task can return its results through arg->data
+	const PfxTaskArg &arg = m_taskArg[id];
+	taskId = (int)id;
+	data1 = arg.data[0];
+	data2 = arg.data[1];
+	data3 = arg.data[2];
+	data4 = arg.data[3];
+}
+
+void PfxTaskManagerPthreads::initialize()
+{
+	if(m_initialized) return;
+
+	pthread_mutex_init(&m_doneMutex,NULL);
+	pthread_cond_init(&m_doneCond,NULL);
+	m_doneHead = 0;
+	m_doneTail = 0;
+	m_numRunning = 0;
+
+	for(PfxUInt32 i=0;i<m_maxTasks;i++) {
+		PfxPthreadsTaskState &state = m_taskStates[i];
+		state.m_manager = this;
+		state.m_taskId = i;
+		state.m_command = kPfxPthreadsCommandIdle;
+		pthread_mutex_init(&state.m_mutex,NULL);
+		pthread_cond_init(&state.m_cond,NULL);
+		int ret = pthread_create(&state.m_thread,NULL,threadMain,&state);
+		SCE_PFX_ALWAYS_ASSERT_MSG(ret == 0,"pthread_create failed");
+		(void)ret;
+	}
+
+	m_initialized = true;
+}
+
+void PfxTaskManagerPthreads::finalize()
+{
+	if(!m_initialized) return;
+
+	SCE_PFX_ASSERT(m_numRunning == 0);
+
+	for(PfxUInt32 i=0;i<m_maxTasks;i++) {
+		PfxPthreadsTaskState &state = m_taskStates[i];
+		pthread_mutex_lock(&state.m_mutex);
+		state.m_command = kPfxPthreadsCommandQuit;
+		pthread_cond_signal(&state.m_cond);
+		pthread_mutex_unlock(&state.m_mutex);
+	}
+
+	for(PfxUInt32 i=0;i<m_maxTasks;i++) {
+		PfxPthreadsTaskState &state = m_taskStates[i];
+		pthread_join(state.m_thread,NULL);
+		pthread_cond_destroy(&state.m_cond);
+		pthread_mutex_destroy(&state.m_mutex);
+	}
+
+	pthread_cond_destroy(&m_doneCond);
+	pthread_mutex_destroy(&m_doneMutex);
+
+	m_initialized = false;
+}
+
+} //namespace PhysicsEffects
+} //namespace sce
+
+#endif // SCE_PFX_USE_PTHREADS
@@ -0,0 +1,79 @@
+/*
+Physics Effects Copyright(C) 2011 Sony Computer Entertainment Inc.
+All rights reserved.
+
+Physics Effects is open software; you can redistribute it and/or
+modify it under the terms of the BSD License.
+
+Physics Effects is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+See the BSD License for more details.
+
+A copy of the BSD License is distributed with
+Physics Effects under the filename: physics_effects_license.txt
+*/
+
+#ifndef _SCE_PFX_TASK_MANAGER_PTHREADS_H
+#define _SCE_PFX_TASK_MANAGER_PTHREADS_H
+
+#include "pfx_task_manager.h"
+#include "pfx_sync_components_pthreads.h"
+
+#ifdef SCE_PFX_USE_PTHREADS
+
+namespace sce {
+namespace PhysicsEffects {
+
+//J POSIXスレッドによるタスクマネージャ
+//J initialize()でmaxTasks個のワーカースレッドを起動し、finalize()まで再利用する
+//E Task manager implemented with POSIX threads
+//E initialize() spawns maxTasks worker threads which are reused until finalize()
+
+struct PfxPthreadsTaskState;
+
+//J workBuffに必要なバイト数を取得する
+//E Get the number of bytes of workBuff required by PfxTaskManagerPthreads
+PfxUInt32 pfxGetWorkBytesOfTaskManagerPthreads(PfxUInt32 maxTasks);
+
+class PfxTaskManagerPthreads : public PfxTaskManager
+{
+private:
+	PfxPthreadsTaskState *m_taskStates;
+	PfxBarrierPthreads m_barrier;
+	PfxCriticalSectionPthreads m_criticalSection;
+
+	pthread_mutex_t m_doneMutex;
+	pthread_cond_t m_doneCond;
+	PfxUInt32 *m_doneQueue;
+	PfxUInt32 m_doneHead;
+	PfxUInt32 m_doneTail;
+	PfxUInt32 m_numRunning;
+	bool m_initialized;
+
+	static void *threadMain(void *arg);
+
+	void notifyDone(PfxUInt32 taskId);
+
+public:
+	PfxTaskManagerPthreads(PfxUInt32 numTasks,PfxUInt32 maxTasks,void *workBuff,PfxUInt32 workBytes);
+	virtual ~PfxTaskManagerPthreads();
+
+	virtual PfxUInt32 getSharedParam(int i);
+	virtual void setSharedParam(int i,PfxUInt32 p);
+
+	virtual void startTask(int taskId,void *io,PfxUInt32 data1,PfxUInt32 data2,PfxUInt32 data3,PfxUInt32 data4);
+	virtual void waitTask(int &taskId,PfxUInt32 &data1,PfxUInt32 &data2,PfxUInt32 &data3,PfxUInt32 &data4);
+
+	virtual void setNumTasks(PfxUInt32 tasks);
+
+	virtual void initialize();
+	virtual void finalize();
+};
+
+} //namespace PhysicsEffects
+} //namespace sce
+
+#endif // SCE_PFX_USE_PTHREADS
+
+#endif // _SCE_PFX_TASK_MANAGER_PTHREADS_H
@@ -36,8 +36,11 @@ int main()
 	while(frameCount<600) {
 		physics_simulate();
 		perf_sync();
+		frameCount++;
 	}
 
+	perf_release();
+
 	SCE_PFX_PRINTF("program complete\n");
 
 	return 0;
@@ -9,10 +9,16 @@
 		"physics_effects_base_level",
 		"physics_effects_util"
 	}
+
+	if os.is("Windows") then
+		files {"../common/perf_func.win32.cpp"}
+	else
+		links {"pthread"}
+		files {"../common/perf_func.linux.cpp"}
+	end
 	
 	files {
 		"main.cpp",
 		"physics_func.cpp",
-		"physics_func.h",
-		"../common/perf_func.win32.cpp"		
+		"physics_func.h"
 	}
\ No newline at end of file
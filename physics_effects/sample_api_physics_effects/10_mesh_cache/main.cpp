@@ -0,0 +1,317 @@
+/*
+Physics Effects Copyright(C) 2011 Sony Computer Entertainment Inc.
+All rights reserved.
+
+Physics Effects is open software; you can redistribute it and/or
+modify it under the terms of the BSD License.
+
+Physics Effects is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+See the BSD License for more details.
+
+A copy of the BSD License is distributed with
+Physics Effects under the filename: physics_effects_license.txt
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include "physics_effects.h"
+#include "base_level/collision/pfx_intersect_ray_large_tri_mesh.h"
+#include "base_level/collision/pfx_contact_large_tri_mesh.h"
+
+using namespace sce::PhysicsEffects;
+
+//J ラージメッシュのキャッシュのテスト
+//J 地形のラージメッシュとタイルをキャッシュに書き出し、別のアドレスにコピーしてからマップし直す
+//J 元のメッシュとマップしたメッシュでレイキャストと衝突判定の結果が一致すること、
+//J 壊れたヘッダーのキャッシュが拒否されることを確認する
+//J 使い方 : App_10_Mesh_Cache [タスク数]
+
+//E Large mesh cache test
+//E Writes a terrain large mesh and its tiles into caches, copies them to another address and maps them back
+//E Checks ray casts and contacts give the same results on the created and the mapped meshes,
+//E and that caches with a broken header are rejected
+//E Usage : App_10_Mesh_Cache [number of tasks]
+
+#define NUM_TASKS		4
+#define GRID_SIZE		48
+#define TILE_SIZE		16.0f
+#define MAX_TILES		64
+#define NUM_RAYS		4096
+#define NUM_CONTACTS	512
+
+static PfxUInt32 gSeed = 12345;
+
+static PfxFloat frand()
+{
+	gSeed = gSeed * 1664525u + 1013904223u;
+	return (PfxFloat)(gSeed>>8) / (PfxFloat)(1<<24);
+}
+
+static PfxFloat terrainHeight(int x,int z)
+{
+	return 2.0f * sinf((PfxFloat)x * 0.3f) * cosf((PfxFloat)z * 0.2f);
+}
+
+static PfxBool isSameRayOutput(const PfxRayOutput &a,const PfxRayOutput &b)
+{
+	if(a.m_contactFlag != b.m_contactFlag) return false;
+	if(!a.m_contactFlag) return true;
+	return a.m_variable == b.m_variable &&
+		memcmp(&a.m_subData,&b.m_subData,sizeof(PfxSubData)) == 0 &&
+		lengthSqr(a.m_contactPoint - b.m_contactPoint) == 0.0f &&
+		lengthSqr(a.m_contactNormal - b.m_contactNormal) == 0.0f;
+}
+
+static PfxBool isSameContacts(const PfxContactCache &a,const PfxContactCache &b)
+{
+	if(a.getNumContacts() != b.getNumContacts()) return false;
+	for(int i=0;i<a.getNumContacts();i++) {
+		const PfxCachedContactPoint &ca = a.getContactPoint(i);
+		const PfxCachedContactPoint &cb = b.getContactPoint(i);
+		if(ca.m_distance != cb.m_distance ||
+		   memcmp(&ca.m_subData,&cb.m_subData,sizeof(PfxSubData)) != 0 ||
+		   lengthSqr(ca.m_normal - cb.m_normal) != 0.0f ||
+		   lengthSqr(PfxVector3(ca.m_localPointA - cb.m_localPointA)) != 0.0f ||
+		   lengthSqr(PfxVector3(ca.m_localPointB - cb.m_localPointB)) != 0.0f) {
+			return false;
+		}
+	}
+	return true;
+}
+
+//J 同じレイと形状で2つのメッシュを判定し、結果が異なる数を返す
+//E Tests two meshes with the same rays and shapes, returns the number of different results
+static PfxUInt32 compareQueries(const PfxLargeTriMesh &meshA,const PfxLargeTriMesh &meshB,const PfxVector3 &position,PfxUInt32 &numHits)
+{
+	PfxTransform3 transform = PfxTransform3::translation(position);
+	PfxFloat extent = (PfxFloat)GRID_SIZE;
+	PfxUInt32 numDiffs = 0;
+
+	for(PfxUInt32 i=0;i<NUM_RAYS;i++) {
+		PfxRayInput ray;
+		ray.reset();
+		ray.m_facetMode = SCE_PFX_RAY_FACET_MODE_FRONT_AND_BACK;
+		ray.m_startPosition = PfxVector3(extent*frand(),10.0f,extent*frand());
+		ray.m_direction = PfxVector3(extent*frand(),-3.0f,extent*frand()) - ray.m_startPosition;
+
+		PfxRayOutput outA,outB;
+		outA.m_contactFlag = outB.m_contactFlag = false;
+		outA.m_variable = outB.m_variable = 1.0f;
+		pfxIntersectRayLargeTriMesh(ray,outA,&meshA,transform);
+		pfxIntersectRayLargeTriMesh(ray,outB,&meshB,transform);
+		if(!isSameRayOutput(outA,outB)) numDiffs++;
+		if(outA.m_contactFlag) numHits++;
+	}
+
+	for(PfxUInt32 i=0;i<NUM_CONTACTS;i++) {
+		PfxShape shape;
+		shape.reset();
+		if(i&1) {
+			shape.setSphere(PfxSphere(0.3f+frand()));
+		}
+		else {
+			shape.setBox(PfxBox(0.2f+frand(),0.2f+frand(),0.2f+frand()));
+		}
+		PfxTransform3 transformB(
+			normalize(PfxQuat(frand()-0.5f,frand()-0.5f,frand()-0.5f,frand()+0.1f)),
+			PfxVector3(extent*frand(),4.0f*frand()-2.0f,extent*frand()));
+
+		PfxContactCache contactsA,contactsB;
+		pfxContactLargeTriMesh(contactsA,&meshA,transform,shape,transformB);
+		pfxContactLargeTriMesh(contactsB,&meshB,transform,shape,transformB);
+		if(!isSameContacts(contactsA,contactsB)) numDiffs++;
+		numHits += contactsA.getNumContacts();
+	}
+
+	return numDiffs;
+}
+
+//J 壊れたキャッシュが期待したエラーで拒否されることを確認する
+//E Checks a broken cache is rejected with the expected error
+static int checkRejected(const char *name,const void *buff,PfxUInt32 bytes,PfxInt32 expected)
+{
+	PfxLargeTriMesh lmesh;
+	PfxInt32 ret = pfxMapLargeTriMeshCache(lmesh,buff,bytes);
+	PfxBool ok = ret == expected;
+	SCE_PFX_PRINTF("reject %-22s %s (0x%08x)\n",name,ok?"ok":"FAILED",(PfxUInt32)ret);
+	return ok ? 0 : 1;
+}
+
+int main(int argc,char **argv)
+{
+	int numTasks = argc > 1 ? atoi(argv[1]) : NUM_TASKS;
+	numTasks = SCE_PFX_MAX(numTasks,1);
+
+	PfxUInt32 taskBytes = pfxGetWorkBytesOfTaskManagerPthreads(numTasks);
+	void *taskBuff = SCE_PFX_UTIL_ALLOC(16,taskBytes);
+	PfxTaskManagerPthreads *taskManager = new PfxTaskManagerPthreads(numTasks,numTasks,taskBuff,taskBytes);
+	taskManager->initialize();
+
+	int ret = 0;
+
+	//J 地形メッシュ
+	//E Terrain mesh
+	const int numVerts = (GRID_SIZE+1)*(GRID_SIZE+1);
+	const int numTriangles = GRID_SIZE*GRID_SIZE*2;
+	PfxFloat *verts = (PfxFloat*)SCE_PFX_UTIL_ALLOC(16,sizeof(PfxFloat)*3*numVerts);
+	PfxUInt16 *triangles = (PfxUInt16*)SCE_PFX_UTIL_ALLOC(16,sizeof(PfxUInt16)*3*numTriangles);
+	for(int z=0;z<=GRID_SIZE;z++) {
+		for(int x=0;x<=GRID_SIZE;x++) {
+			PfxFloat *v = verts + 3*(z*(GRID_SIZE+1)+x);
+			v[0] = (PfxFloat)x;
+			v[1] = terrainHeight(x,z);
+			v[2] = (PfxFloat)z;
+		}
+	}
+	for(int z=0,t=0;z<GRID_SIZE;z++) {
+		for(int x=0;x<GRID_SIZE;x++,t+=6) {
+			PfxUInt16 i = (PfxUInt16)(z*(GRID_SIZE+1)+x);
+			triangles[t+0] = i;
+			triangles[t+1] = (PfxUInt16)(i+GRID_SIZE+1);
+			triangles[t+2] = (PfxUInt16)(i+1);
+			triangles[t+3] = (PfxUInt16)(i+1);
+			triangles[t+4] = (PfxUInt16)(i+GRID_SIZE+1);
+			triangles[t+5] = (PfxUInt16)(i+GRID_SIZE+2);
+		}
+	}
+
+	PfxCreateLargeTriMeshParam param;
+	param.verts = verts;
+	param.numVerts = numVerts;
+	param.triangles = triangles;
+	param.numTriangles = numTriangles;
+
+	PfxLargeTriMesh lmesh;
+	if(pfxCreateLargeTriMesh(lmesh,param) != SCE_PFX_OK) {
+		SCE_PFX_PRINTF("pfxCreateLargeTriMesh FAILED\n");
+		return 1;
+	}
+
+	//J キャッシュを書き出し、別のアドレスへコピーしてから元の領域を壊す
+	//E Write the cache, copy it to another address and overwrite the original
+	PfxUInt32 cacheBytes = pfxGetBytesOfLargeTriMeshCache(lmesh);
+	void *written = SCE_PFX_UTIL_ALLOC(128,cacheBytes);
+	void *copied = SCE_PFX_UTIL_ALLOC(128,cacheBytes+16);
+	PfxUInt8 *mapped = (PfxUInt8*)copied + 16;
+	ret |= pfxWriteLargeTriMeshCache(lmesh,written,cacheBytes,PfxVector3(1.0f,2.0f,3.0f)) != SCE_PFX_OK;
+	memcpy(mapped,written,cacheBytes);
+	memset(written,0xcd,cacheBytes);
+
+	{
+		PfxLargeTriMesh mappedMesh;
+		PfxVector3 center(0.0f);
+		PfxUInt32 mappedBytes = 0;
+		PfxInt32 err = pfxMapLargeTriMeshCache(mappedMesh,mapped,cacheBytes,&center,&mappedBytes);
+		PfxUInt32 numHits = 0;
+		PfxUInt32 numDiffs = err == SCE_PFX_OK ? compareQueries(lmesh,mappedMesh,PfxVector3(0.0f),numHits) : 1;
+		PfxBool ok = err == SCE_PFX_OK && numDiffs == 0 && mappedBytes == cacheBytes &&
+			lengthSqr(center - PfxVector3(1.0f,2.0f,3.0f)) == 0.0f;
+		if(!ok) ret = 1;
+		SCE_PFX_PRINTF("mesh   %4u islands %7u bytes | %u hits, %u differ | %s\n",
+			(PfxUInt32)lmesh.m_numIslands,cacheBytes,numHits,numDiffs,ok?"identical":"DIFFERENT");
+	}
+
+	//J ヘッダーを壊したキャッシュ
+	//J ヘッダーの先頭はmagic, version, bytes, sizeOfTriMeshの順
+	//E Caches with a broken header
+	//E The header starts with magic, version, bytes and sizeOfTriMesh
+	{
+		PfxUInt8 *broken = (PfxUInt8*)SCE_PFX_UTIL_ALLOC(128,cacheBytes+16);
+		PfxUInt32 *header = (PfxUInt32*)broken;
+
+		memcpy(broken,mapped,cacheBytes);
+		header[0] ^= 0x01010101;
+		ret |= checkRejected("bad magic",broken,cacheBytes,SCE_PFX_ERR_INVALID_VALUE);
+
+		memcpy(broken,mapped,cacheBytes);
+		header[1] += 1;
+		ret |= checkRejected("bad version",broken,cacheBytes,SCE_PFX_ERR_INVALID_VALUE);
+
+		memcpy(broken,mapped,cacheBytes);
+		header[3] += 16;
+		ret |= checkRejected("other structure size",broken,cacheBytes,SCE_PFX_ERR_INVALID_VALUE);
+
+		memcpy(broken,mapped,cacheBytes);
+		header[2] = 0xffffff80;
+		ret |= checkRejected("size beyond buffer",broken,cacheBytes,SCE_PFX_ERR_OUT_OF_BUFFER);
+
+		memcpy(broken,mapped,cacheBytes);
+		ret |= checkRejected("truncated",broken,cacheBytes-128,SCE_PFX_ERR_OUT_OF_BUFFER);
+		ret |= checkRejected("shorter than header",broken,16,SCE_PFX_ERR_OUT_OF_BUFFER);
+
+		memmove(broken+4,broken,cacheBytes);
+		ret |= checkRejected("misaligned",broken+4,cacheBytes,SCE_PFX_ERR_INVALID_ALIGN);
+
+		SCE_PFX_UTIL_FREE(broken);
+	}
+
+	SCE_PFX_UTIL_FREE(written);
+	SCE_PFX_UTIL_FREE(copied);
+
+	//J タイルのキャッシュを連結して一つのバッファに書き出し、cacheBytesで辿ってマップする
+	//E Concatenate the caches of the tiles in one buffer, and map them by following cacheBytes
+	PfxLargeTriMesh *tiles = new PfxLargeTriMesh[MAX_TILES];
+	PfxVector3 *tileCenters = new PfxVector3[MAX_TILES];
+	PfxUInt32 numTiles = 0;
+	if(pfxCreateLargeTriMeshTiles(tiles,tileCenters,MAX_TILES,numTiles,param,PfxVector3(TILE_SIZE),taskManager) != SCE_PFX_OK) {
+		SCE_PFX_PRINTF("pfxCreateLargeTriMeshTiles FAILED\n");
+		return 1;
+	}
+
+	{
+		PfxUInt32 totalBytes = 0;
+		for(PfxUInt32 i=0;i<numTiles;i++) {
+			totalBytes += pfxGetBytesOfLargeTriMeshCache(tiles[i]);
+		}
+		PfxUInt8 *tileCaches = (PfxUInt8*)SCE_PFX_UTIL_ALLOC(128,totalBytes);
+		PfxUInt8 *tileCopy = (PfxUInt8*)SCE_PFX_UTIL_ALLOC(128,totalBytes+16);
+		for(PfxUInt32 i=0,offset=0;i<numTiles;i++) {
+			PfxUInt32 bytes = pfxGetBytesOfLargeTriMeshCache(tiles[i]);
+			ret |= pfxWriteLargeTriMeshCache(tiles[i],tileCaches+offset,bytes,tileCenters[i]) != SCE_PFX_OK;
+			offset += bytes;
+		}
+		memcpy(tileCopy+16,tileCaches,totalBytes);
+		memset(tileCaches,0xcd,totalBytes);
+
+		PfxUInt32 numHits = 0,numDiffs = 0,numBroken = 0;
+		PfxUInt32 offset = 0;
+		for(PfxUInt32 i=0;i<numTiles;i++) {
+			PfxLargeTriMesh mappedTile;
+			PfxVector3 center(0.0f);
+			PfxUInt32 bytes = 0;
+			if(pfxMapLargeTriMeshCache(mappedTile,tileCopy+16+offset,totalBytes-offset,&center,&bytes) != SCE_PFX_OK ||
+			   lengthSqr(center - tileCenters[i]) != 0.0f) {
+				numBroken++;
+				break;
+			}
+			numDiffs += compareQueries(tiles[i],mappedTile,tileCenters[i],numHits);
+			offset += bytes;
+		}
+		PfxBool ok = numBroken == 0 && numDiffs == 0 && offset == totalBytes;
+		if(!ok) ret = 1;
+		SCE_PFX_PRINTF("tiles  %4u tiles   %7u bytes | %u hits, %u differ | %s\n",
+			numTiles,totalBytes,numHits,numDiffs,ok?"identical":"DIFFERENT");
+
+		SCE_PFX_UTIL_FREE(tileCaches);
+		SCE_PFX_UTIL_FREE(tileCopy);
+	}
+
+	for(PfxUInt32 i=0;i<numTiles;i++) {
+		pfxReleaseLargeTriMesh(tiles[i]);
+	}
+	delete [] tiles;
+	delete [] tileCenters;
+	pfxReleaseLargeTriMesh(lmesh);
+	SCE_PFX_UTIL_FREE(verts);
+	SCE_PFX_UTIL_FREE(triangles);
+
+	taskManager->finalize();
+	delete taskManager;
+	SCE_PFX_UTIL_FREE(taskBuff);
+
+	SCE_PFX_PRINTF("program complete\n");
+
+	return ret;
+}
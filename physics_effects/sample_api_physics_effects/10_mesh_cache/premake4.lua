@@ -0,0 +1,20 @@
+	
+	project "pe_sample_10_mesh_cache"
+		
+	kind "ConsoleApp"
+	targetdir "../../../bin"
+	includedirs {"../../../physics_effects"}
+		
+	links {
+		"physics_effects_low_level",
+		"physics_effects_base_level",
+		"physics_effects_util"
+	}
+
+	if not os.is("Windows") then
+		links {"pthread"}
+	end
+	
+	files {
+		"main.cpp"
+	}
@@ -25,6 +25,10 @@ Physics Effects under the filename: physics_effects_license.txt
 #define NUM_CONTACTS  4000
 #define NUM_RAYS 100
 
+//J レイキャストのスループット計測に使うレイの数
+//E Number of rays used to measure ray cast throughput
+#define NUM_BENCH_RAYS 16384
+
 const float timeStep = 0.016f;
 const float separateBias = 0.1f;
 int iteration = 5;
@@ -113,6 +117,9 @@ PfxRayInput SCE_PFX_ALIGNED(128) rayInputs[NUM_RAYS];
 PfxRayOutput SCE_PFX_ALIGNED(128) rayOutputs[NUM_RAYS];
 int numRays;
 
+PfxRayInput SCE_PFX_ALIGNED(128) benchRayInputs[NUM_BENCH_RAYS];
+PfxRayOutput SCE_PFX_ALIGNED(128) benchRayOutputs[2][NUM_BENCH_RAYS];
+
 /* 
 	doAreaRaycastがtrueの場合、指定された領域内の剛体のみ判定対象とする
 */
@@ -541,10 +548,8 @@ int gatherBroadphaseProxiesInArea(const PfxVector3 &center,const PfxVector3 &ext
 	return numRigidBodies - result.numOutOfWorldProxies;
 }
 
-void castRays()
+void setupRayCastParam(PfxRayCastParam &param)
 {
-	PfxRayCastParam param;
-
 	if(doAreaRaycast) {
 		static PfxFloat deltaRotY = 0.0f;
 		PfxQuat rotY = PfxQuat::rotationY(deltaRotY);
@@ -577,10 +582,62 @@ void castRays()
 		param.rangeCenter = worldCenter;
 		param.rangeExtent = worldExtent;
 	}
+}
+
+void castRays()
+{
+	PfxRayCastParam param;
+	setupRayCastParam(param);
 	
 	pfxCastRays(rayInputs,rayOutputs,numRays,param);
 }
 
+/*
+	シーンのレイを少しずつずらしてNUM_BENCH_RAYS本に増やし、
+	pfxCastRaysとpfxCastRayPacketsのスループットを比較する
+*/
+void benchmarkRays()
+{
+	if(numRays == 0) return;
+	
+	for(int i=0;i<NUM_BENCH_RAYS;i++) {
+		const PfxRayInput &ray = rayInputs[i%numRays];
+		PfxFloat offset = 0.01f * (PfxFloat)(i/numRays);
+		benchRayInputs[i] = ray;
+		benchRayInputs[i].m_startPosition = ray.m_startPosition + PfxVector3(offset,0.0f,offset);
+	}
+	
+	PfxRayCastParam param;
+	setupRayCastParam(param);
+	
+	PfxPerfCounter pc;
+	
+	pc.countBegin("rays");
+	pfxCastRays(benchRayInputs,benchRayOutputs[0],NUM_BENCH_RAYS,param);
+	pc.countEnd();
+	
+	pc.countBegin("packets");
+	pfxCastRayPackets(benchRayInputs,benchRayOutputs[1],NUM_BENCH_RAYS,param);
+	pc.countEnd();
+	
+	int numDiffs = 0;
+	for(int i=0;i<NUM_BENCH_RAYS;i++) {
+		const PfxRayOutput &out0 = benchRayOutputs[0][i];
+		const PfxRayOutput &out1 = benchRayOutputs[1][i];
+		if(out0.m_contactFlag != out1.m_contactFlag ||
+			(out0.m_contactFlag && (out0.m_variable != out1.m_variable || out0.m_objectId != out1.m_objectId))) {
+			numDiffs++;
+		}
+	}
+	
+	float raysTime = pc.getCountTime(0);
+	float packetsTime = pc.getCountTime(2);
+	SCE_PFX_PRINTF("raycast bench %d rays | rays %.1f rays/ms packets %.1f rays/ms | diffs %d\n",NUM_BENCH_RAYS,
+		raysTime > 0.0f ? NUM_BENCH_RAYS/raysTime : 0.0f,
+		packetsTime > 0.0f ? NUM_BENCH_RAYS/packetsTime : 0.0f,
+		numDiffs);
+}
+
 void physics_simulate()
 {
 	PfxPerfCounter pc;
@@ -637,6 +694,7 @@ void physics_simulate()
 		SCE_PFX_PRINTF("frame %3d broadphase %.2f collision %.2f solver %.2f sleepCheck %.2f integrate %.2f raycast %.2f | total %.2f\n",frame,
 			broadphaseTime,collisionTime,solverTime,sleepTime,integrateTime,raycastTime,
 			broadphaseTime+collisionTime+solverTime+sleepTime+integrateTime+raycastTime);
+		benchmarkRays();
 	}
 }
 
@@ -0,0 +1,364 @@
+/*
+Physics Effects Copyright(C) 2011 Sony Computer Entertainment Inc.
+All rights reserved.
+
+Physics Effects is open software; you can redistribute it and/or
+modify it under the terms of the BSD License.
+
+Physics Effects is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+See the BSD License for more details.
+
+A copy of the BSD License is distributed with
+Physics Effects under the filename: physics_effects_license.txt
+*/
+
+#include <stdlib.h>
+#include "physics_effects.h"
+
+using namespace sce::PhysicsEffects;
+
+//J ブロードフェーズのベンチマーク
+//J ほとんどの剛体が静止しているシーンで、毎フレーム全体を作り直す方法
+//J (pfxUpdateBroadphaseProxies + pfxFindPairs + pfxDecomposePairs)と
+//J インクリメンタルブロードフェーズを比較し、ペアが一致することを確認する
+//J 剛体IDは16ビットのため、剛体数は65535以下に制限される
+
+//E Broadphase benchmark
+//E Compares rebuilding everything every frame
+//E (pfxUpdateBroadphaseProxies + pfxFindPairs + pfxDecomposePairs) with the
+//E incremental broadphase in a scene where most rigid bodies are at rest,
+//E and checks that both find the same pairs
+//E Rigid body IDs are 16 bits, so the number of rigid bodies is limited to 65535
+
+#define NUM_FRAMES			100
+#define MAX_PAIRS_PER_BODY	16
+
+//J 毎フレーム動く剛体の割合
+//E Ratio of rigid bodies moving every frame
+#define MOVING_RATIO		0.1f
+
+const PfxFloat timeStep = 0.016f;
+
+static PfxFloat frand()
+{
+	return (PfxFloat)rand() / (PfxFloat)RAND_MAX;
+}
+
+struct BenchScene {
+	PfxUInt32 numRigidBodies;
+	PfxUInt32 maxPairs;
+	PfxVector3 worldCenter;
+	PfxVector3 worldExtent;
+	PfxRigidState *states;
+	PfxCollidable *collidables;
+	PfxVector3 *velocities;
+	PfxFloat bound;
+};
+
+static void createScene(BenchScene &scene,PfxUInt32 numRigidBodies)
+{
+	srand(12345);
+
+	scene.numRigidBodies = numRigidBodies;
+	scene.maxPairs = numRigidBodies * MAX_PAIRS_PER_BODY;
+	scene.states = (PfxRigidState*)SCE_PFX_UTIL_ALLOC(128,sizeof(PfxRigidState)*numRigidBodies);
+	scene.collidables = (PfxCollidable*)SCE_PFX_UTIL_ALLOC(128,sizeof(PfxCollidable)*numRigidBodies);
+	scene.velocities = (PfxVector3*)SCE_PFX_UTIL_ALLOC(16,sizeof(PfxVector3)*numRigidBodies);
+
+	//J 格子状に配置し、隣接する数個の剛体と交差させる
+	//E Bodies are placed on a jittered grid so that each overlaps a few neighbors
+	int side = 1;
+	while((PfxUInt32)(side*side*side) < numRigidBodies) side++;
+	const PfxFloat spacing = 2.0f;
+	scene.bound = side * spacing * 0.5f;
+	scene.worldCenter = PfxVector3(0.0f);
+	scene.worldExtent = PfxVector3(scene.bound + 10.0f);
+
+	for(PfxUInt32 i=0;i<numRigidBodies;i++) {
+		int x = i % side;
+		int y = (i / side) % side;
+		int z = i / (side*side);
+		PfxVector3 pos(
+			(x + 0.5f) * spacing - scene.bound + (frand()-0.5f),
+			(y + 0.5f) * spacing - scene.bound + (frand()-0.5f),
+			(z + 0.5f) * spacing - scene.bound + (frand()-0.5f));
+
+		PfxBox box(0.5f + 0.5f*frand(),0.5f + 0.5f*frand(),0.5f + 0.5f*frand());
+		PfxShape shape;
+		shape.reset();
+		shape.setBox(box);
+		scene.collidables[i].reset();
+		scene.collidables[i].addShape(shape);
+		scene.collidables[i].finish();
+
+		scene.states[i].reset();
+		scene.states[i].setPosition(pos);
+		scene.states[i].setMotionType(kPfxMotionTypeActive);
+		scene.states[i].setRigidBodyId((PfxUInt16)i);
+
+		if(frand() < MOVING_RATIO) {
+			scene.velocities[i] = PfxVector3(frand()-0.5f,frand()-0.5f,frand()-0.5f) * 8.0f;
+		}
+		else {
+			scene.velocities[i] = PfxVector3(0.0f);
+		}
+	}
+}
+
+static void releaseScene(BenchScene &scene)
+{
+	SCE_PFX_UTIL_FREE(scene.states);
+	SCE_PFX_UTIL_FREE(scene.collidables);
+	SCE_PFX_UTIL_FREE(scene.velocities);
+}
+
+static void moveScene(BenchScene &scene)
+{
+	for(PfxUInt32 i=0;i<scene.numRigidBodies;i++) {
+		PfxVector3 pos = scene.states[i].getPosition() + scene.velocities[i] * timeStep;
+		for(int j=0;j<3;j++) {
+			if(pos[j] < -scene.bound || pos[j] > scene.bound) {
+				scene.velocities[i].setElem(j,-scene.velocities[i].getElem(j));
+			}
+		}
+		scene.states[i].setPosition(pos);
+	}
+}
+
+//J ペアを前フレームのバッファへ合成する（PfxWorldと同じ手順）
+//E Merges pairs into the buffer for the next frame (same steps as PfxWorld)
+static PfxUInt32 mergePairs(
+	PfxBroadphasePair *currentPairs,PfxBroadphasePair *sortBuff,
+	const PfxBroadphasePair *newPairs,PfxUInt32 numNewPairs,
+	const PfxBroadphasePair *keepPairs,PfxUInt32 numKeepPairs)
+{
+	PfxUInt32 numCurrentPairs = 0;
+	for(PfxUInt32 i=0;i<numKeepPairs;i++) {
+		currentPairs[numCurrentPairs++] = keepPairs[i];
+	}
+	for(PfxUInt32 i=0;i<numNewPairs;i++) {
+		currentPairs[numCurrentPairs++] = newPairs[i];
+	}
+	pfxSort(currentPairs,sortBuff,numCurrentPairs);
+	return numCurrentPairs;
+}
+
+static PfxFloat ticksToMs(PfxUInt64 ticks)
+{
+	return (PfxFloat)((double)ticks * 1000.0 / (double)pfxPerfGetTicksPerSecond());
+}
+
+static int runBenchmark(PfxUInt32 numRigidBodies,int numFrames)
+{
+	BenchScene scene;
+	createScene(scene,numRigidBodies);
+
+	PfxUInt32 maxPairs = scene.maxPairs;
+
+	// Full rebuild
+	PfxBroadphaseProxy *proxies[6];
+	for(int i=0;i<6;i++) {
+		proxies[i] = (PfxBroadphaseProxy*)SCE_PFX_UTIL_ALLOC(128,sizeof(PfxBroadphaseProxy)*numRigidBodies);
+	}
+	PfxUInt32 workBytes =
+		pfxGetWorkBytesOfUpdateBroadphaseProxies(numRigidBodies,1) +
+		pfxGetPairBytesOfFindPairs(maxPairs) + pfxGetWorkBytesOfFindPairs(maxPairs) +
+		pfxGetPairBytesOfDecomposePairs(maxPairs,maxPairs) + pfxGetWorkBytesOfDecomposePairs(maxPairs,maxPairs) + 1024;
+	PfxUInt8 *workBuff = (PfxUInt8*)SCE_PFX_UTIL_ALLOC(128,workBytes);
+
+	// Incremental
+	PfxUInt32 incBytes = pfxGetBytesOfIncrementalBroadphase(numRigidBodies,maxPairs);
+	PfxUInt8 *incBuff = (PfxUInt8*)SCE_PFX_UTIL_ALLOC(128,incBytes);
+	PfxIncrementalBroadphase incBroadphase;
+	pfxInitializeIncrementalBroadphase(incBroadphase,incBuff,incBytes,numRigidBodies,maxPairs);
+	PfxUInt32 incPairBytes = pfxGetPairBytesOfUpdateIncrementalBroadphase(maxPairs,maxPairs);
+	PfxUInt8 *incPairBuff = (PfxUInt8*)SCE_PFX_UTIL_ALLOC(128,incPairBytes);
+
+	// Pairs of the previous frame
+	PfxBroadphasePair *fullPairs = (PfxBroadphasePair*)SCE_PFX_UTIL_ALLOC(128,sizeof(PfxBroadphasePair)*maxPairs);
+	PfxBroadphasePair *incPairs = (PfxBroadphasePair*)SCE_PFX_UTIL_ALLOC(128,sizeof(PfxBroadphasePair)*maxPairs);
+	PfxBroadphasePair *sortBuff = (PfxBroadphasePair*)SCE_PFX_UTIL_ALLOC(128,sizeof(PfxBroadphasePair)*maxPairs);
+	PfxUInt32 numFullPairs = 0;
+	PfxUInt32 numIncPairs = 0;
+
+	PfxUInt64 fullTicks = 0,incTicks = 0,incFirstTicks = 0;
+	PfxUInt64 numSwaps = 0,numChangedPairs = 0;
+	int ret = 0;
+
+	for(int frame=0;frame<numFrames && ret == 0;frame++) {
+		moveScene(scene);
+
+		PfxDecomposePairsResult fullResult;
+		PfxUpdateIncrementalBroadphaseResult incResult;
+
+		//J 全体を作り直す
+		//E Rebuild everything
+		{
+			PfxUInt64 t0 = pfxPerfGetTicks();
+
+			int axis = 0;
+			{
+				PfxVector3 s(0.0f),s2(0.0f);
+				for(PfxUInt32 i=0;i<numRigidBodies;i++) {
+					PfxVector3 c = scene.states[i].getPosition();
+					s += c;
+					s2 += mulPerElem(c,c);
+				}
+				PfxVector3 v = s2 - mulPerElem(s,s) / (float)numRigidBodies;
+				if(v[1] > v[0]) axis = 1;
+				if(v[2] > v[axis]) axis = 2;
+			}
+
+			PfxUpdateBroadphaseProxiesParam proxyParam;
+			proxyParam.workBuff = workBuff;
+			proxyParam.workBytes = workBytes;
+			proxyParam.proxiesX = proxies[0];
+			proxyParam.proxiesY = proxies[1];
+			proxyParam.proxiesZ = proxies[2];
+			proxyParam.proxiesXb = proxies[3];
+			proxyParam.proxiesYb = proxies[4];
+			proxyParam.proxiesZb = proxies[5];
+			proxyParam.offsetRigidStates = scene.states;
+			proxyParam.offsetCollidables = scene.collidables;
+			proxyParam.numRigidBodies = numRigidBodies;
+			proxyParam.worldCenter = scene.worldCenter;
+			proxyParam.worldExtent = scene.worldExtent;
+
+			PfxUpdateBroadphaseProxiesResult proxyResult;
+			pfxUpdateBroadphaseProxies(proxyParam,proxyResult);
+
+			PfxHeapManager pool(workBuff,workBytes);
+
+			PfxFindPairsParam findPairsParam;
+			findPairsParam.pairBytes = pfxGetPairBytesOfFindPairs(maxPairs);
+			findPairsParam.pairBuff = pool.allocate(findPairsParam.pairBytes);
+			findPairsParam.workBytes = pfxGetWorkBytesOfFindPairs(maxPairs);
+			findPairsParam.workBuff = pool.allocate(findPairsParam.workBytes);
+			findPairsParam.proxies = proxies[axis];
+			findPairsParam.numProxies = numRigidBodies;
+			findPairsParam.maxPairs = maxPairs;
+			findPairsParam.axis = axis;
+
+			PfxFindPairsResult findPairsResult;
+			if(pfxFindPairs(findPairsParam,findPairsResult) != SCE_PFX_OK) {
+				SCE_PFX_PRINTF("pfxFindPairs failed\n");
+				ret = 1;
+				break;
+			}
+
+			PfxDecomposePairsParam decomposePairsParam;
+			decomposePairsParam.pairBytes = pfxGetPairBytesOfDecomposePairs(numFullPairs,findPairsResult.numPairs);
+			decomposePairsParam.pairBuff = pool.allocate(decomposePairsParam.pairBytes);
+			decomposePairsParam.workBytes = pfxGetWorkBytesOfDecomposePairs(numFullPairs,findPairsResult.numPairs);
+			decomposePairsParam.workBuff = pool.allocate(decomposePairsParam.workBytes);
+			decomposePairsParam.previousPairs = fullPairs;
+			decomposePairsParam.numPreviousPairs = numFullPairs;
+			decomposePairsParam.currentPairs = findPairsResult.pairs;
+			decomposePairsParam.numCurrentPairs = findPairsResult.numPairs;
+
+			pfxDecomposePairs(decomposePairsParam,fullResult);
+
+			numFullPairs = mergePairs(fullPairs,sortBuff,
+				fullResult.outNewPairs,fullResult.numOutNewPairs,
+				fullResult.outKeepPairs,fullResult.numOutKeepPairs);
+
+			fullTicks += pfxPerfGetTicks() - t0;
+		}
+
+		//J インクリメンタル
+		//E Incremental
+		{
+			PfxUInt64 t0 = pfxPerfGetTicks();
+
+			PfxUpdateIncrementalBroadphaseParam incParam;
+			incParam.pairBuff = incPairBuff;
+			incParam.pairBytes = incPairBytes;
+			incParam.previousPairs = incPairs;
+			incParam.numPreviousPairs = numIncPairs;
+			incParam.offsetRigidStates = scene.states;
+			incParam.offsetCollidables = scene.collidables;
+			incParam.numRigidBodies = numRigidBodies;
+			incParam.worldCenter = scene.worldCenter;
+			incParam.worldExtent = scene.worldExtent;
+
+			if(pfxUpdateIncrementalBroadphase(incBroadphase,incParam,incResult) != SCE_PFX_OK) {
+				SCE_PFX_PRINTF("pfxUpdateIncrementalBroadphase failed\n");
+				ret = 1;
+				break;
+			}
+
+			numIncPairs = mergePairs(incPairs,sortBuff,
+				incResult.outNewPairs,incResult.numOutNewPairs,
+				incResult.outKeepPairs,incResult.numOutKeepPairs);
+
+			PfxUInt64 t = pfxPerfGetTicks() - t0;
+			if(frame == 0) {
+				incFirstTicks = t;
+			}
+			else {
+				incTicks += t;
+			}
+			numSwaps += incResult.numSwaps;
+		}
+
+		numChangedPairs += fullResult.numOutNewPairs + fullResult.numOutRemovePairs;
+
+		//J 結果の比較
+		//E Compare results
+		PfxBool match =
+			fullResult.numOutNewPairs == incResult.numOutNewPairs &&
+			fullResult.numOutKeepPairs == incResult.numOutKeepPairs &&
+			fullResult.numOutRemovePairs == incResult.numOutRemovePairs &&
+			numFullPairs == numIncPairs;
+		for(PfxUInt32 i=0;match && i<numFullPairs;i++) {
+			match = pfxGetKey(fullPairs[i]) == pfxGetKey(incPairs[i]);
+		}
+		if(!match) {
+			SCE_PFX_PRINTF("frame %d pairs mismatch : full new %u keep %u remove %u / incremental new %u keep %u remove %u\n",frame,
+				fullResult.numOutNewPairs,fullResult.numOutKeepPairs,fullResult.numOutRemovePairs,
+				incResult.numOutNewPairs,incResult.numOutKeepPairs,incResult.numOutRemovePairs);
+			ret = 1;
+		}
+	}
+
+	if(ret == 0) {
+		PfxFloat fullMs = ticksToMs(fullTicks) / numFrames;
+		PfxFloat incMs = numFrames > 1 ? ticksToMs(incTicks) / (numFrames-1) : 0.0f;
+		SCE_PFX_PRINTF("bodies %6u pairs %7u changed/frame %6u | full %8.3f ms | incremental %8.3f ms (first frame %8.3f ms, swaps/frame %7u) | x%.1f\n",
+			numRigidBodies,numFullPairs,(PfxUInt32)(numChangedPairs/numFrames),
+			fullMs,incMs,ticksToMs(incFirstTicks),(PfxUInt32)(numSwaps/SCE_PFX_MAX(numFrames-1,1)),
+			incMs > 0.0f ? fullMs / incMs : 0.0f);
+	}
+
+	for(int i=0;i<6;i++) {
+		SCE_PFX_UTIL_FREE(proxies[i]);
+	}
+	SCE_PFX_UTIL_FREE(workBuff);
+	SCE_PFX_UTIL_FREE(incBuff);
+	SCE_PFX_UTIL_FREE(incPairBuff);
+	SCE_PFX_UTIL_FREE(fullPairs);
+	SCE_PFX_UTIL_FREE(incPairs);
+	SCE_PFX_UTIL_FREE(sortBuff);
+
+	releaseScene(scene);
+
+	return ret;
+}
+
+int main(int argc,char **argv)
+{
+	int numFrames = argc > 1 ? atoi(argv[1]) : NUM_FRAMES;
+
+	const PfxUInt32 numBodies[] = {10000,30000,60000};
+
+	int ret = 0;
+	for(int i=0;i<3 && ret == 0;i++) {
+		ret = runBenchmark(numBodies[i],numFrames);
+	}
+
+	SCE_PFX_PRINTF("program complete\n");
+
+	return ret;
+}
@@ -0,0 +1,171 @@
+/*
+Physics Effects Copyright(C) 2011 Sony Computer Entertainment Inc.
+All rights reserved.
+
+Physics Effects is open software; you can redistribute it and/or
+modify it under the terms of the BSD License.
+
+Physics Effects is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+See the BSD License for more details.
+
+A copy of the BSD License is distributed with
+Physics Effects under the filename: physics_effects_license.txt
+*/
+
+#include <stdlib.h>
+#include "physics_effects.h"
+
+using namespace sce::PhysicsEffects;
+
+//J ソートのマイクロベンチマーク
+//J マージソートと基数ソートをシングルスレッド、マルチスレッドで比較し、結果が正しく並んでいることを確認する
+//J 使い方 : App_8_Sort_Bench [タスク数] [繰り返し回数]
+
+//E Sort micro benchmark
+//E Compares merge sort and radix sort with single and multiple threads, and checks the results are sorted
+//E Usage : App_8_Sort_Bench [number of tasks] [number of repeats]
+
+#define NUM_TASKS	4
+#define NUM_REPEATS	10
+
+static PfxUInt32 gSeed = 12345;
+
+static PfxUInt32 random32()
+{
+	gSeed = gSeed * 1664525u + 1013904223u;
+	return gSeed;
+}
+
+static PfxFloat ticksToMs(PfxUInt64 ticks)
+{
+	return (PfxFloat)((double)ticks * 1000.0 / (double)pfxPerfGetTicksPerSecond());
+}
+
+//J キーの分布
+//J Random : 32ビットの乱数
+//J Pair : ブロードフェーズペアと同じ形式(上位16ビットと下位16ビットに剛体ID)
+//E Key distributions
+//E Random : 32 bit random numbers
+//E Pair : Same as broadphase pairs (rigid body IDs in upper and lower 16 bits)
+enum eKeyType {
+	kKeyRandom = 0,
+	kKeyPair,
+	kKeyCount
+};
+
+static const char *keyTypeName[kKeyCount] = {"random","pair"};
+
+template <class SortData>
+static void createData(SortData *data,PfxUInt32 numData,eKeyType keyType)
+{
+	PfxUInt32 numBodies = SCE_PFX_MIN(numData/4+2,0xffffu);
+	for(PfxUInt32 i=0;i<numData;i++) {
+		for(int j=0;j<(int)(sizeof(SortData)/4);j++) {
+			data[i].set32(j,i);
+		}
+		if(keyType == kKeyPair) {
+			pfxSetKey(data[i],pfxCreateUniqueKey(random32()%numBodies,random32()%numBodies));
+		}
+		else {
+			pfxSetKey(data[i],random32());
+		}
+	}
+}
+
+//J ソート済みで、かつデータが失われていないことを確認する
+//E Checks the data are sorted and nothing is lost
+template <class SortData>
+static PfxBool isSorted(const SortData *data,PfxUInt32 numData)
+{
+	PfxUInt64 sum = 0;
+	for(PfxUInt32 i=0;i<numData;i++) {
+		if(i > 0 && pfxGetKey(data[i-1]) > pfxGetKey(data[i])) return false;
+		sum += data[i].get32(0);
+	}
+	return sum == (PfxUInt64)numData*(numData-1)/2;
+}
+
+template <class SortData>
+static int runBenchmark(const char *name,PfxUInt32 numData,eKeyType keyType,int numRepeats,PfxTaskManager *taskManager)
+{
+	SortData *source = (SortData*)SCE_PFX_UTIL_ALLOC(128,sizeof(SortData)*numData);
+	SortData *data = (SortData*)SCE_PFX_UTIL_ALLOC(128,sizeof(SortData)*numData);
+	SortData *buff = (SortData*)SCE_PFX_UTIL_ALLOC(128,sizeof(SortData)*numData);
+	PfxUInt32 buffBytes = sizeof(SortData)*numData;
+
+	createData(source,numData,keyType);
+
+	//J マージソート(1スレッド)、基数ソート(1スレッド)、マージソート(Nスレッド)、基数ソート(Nスレッド)
+	//E Merge sort (1 thread), radix sort (1 thread), merge sort (N threads), radix sort (N threads)
+	PfxFloat ms[4];
+	int ret = 0;
+
+	for(int method=0;method<4;method++) {
+		ePfxSortAlgorithm algorithm = (method&1) ? kPfxSortAlgorithmRadix : kPfxSortAlgorithmMerge;
+		PfxUInt64 ticks = 0;
+
+		for(int r=0;r<numRepeats;r++) {
+			memcpy(data,source,sizeof(SortData)*numData);
+
+			PfxUInt64 t0 = pfxPerfGetTicks();
+			if(method < 2) {
+				pfxParallelSort(data,numData,buff,buffBytes,algorithm);
+			}
+			else {
+				pfxParallelSort(data,numData,buff,buffBytes,taskManager,algorithm);
+			}
+			ticks += pfxPerfGetTicks() - t0;
+		}
+
+		if(!isSorted(data,numData)) {
+			SCE_PFX_PRINTF("%s %s %u : method %d is not sorted\n",name,keyTypeName[keyType],numData,method);
+			ret = 1;
+		}
+
+		ms[method] = ticksToMs(ticks) / numRepeats;
+	}
+
+	SCE_PFX_PRINTF("%s %-6s %8u | merge %8.3f ms radix %8.3f ms (x%4.1f) | %u tasks merge %8.3f ms radix %8.3f ms (x%4.1f)\n",
+		name,keyTypeName[keyType],numData,
+		ms[0],ms[1],ms[1] > 0.0f ? ms[0]/ms[1] : 0.0f,
+		taskManager->getNumTasks(),ms[2],ms[3],ms[3] > 0.0f ? ms[2]/ms[3] : 0.0f);
+
+	SCE_PFX_UTIL_FREE(source);
+	SCE_PFX_UTIL_FREE(data);
+	SCE_PFX_UTIL_FREE(buff);
+
+	return ret;
+}
+
+int main(int argc,char **argv)
+{
+	int numTasks = argc > 1 ? atoi(argv[1]) : NUM_TASKS;
+	int numRepeats = argc > 2 ? atoi(argv[2]) : NUM_REPEATS;
+	numTasks = SCE_PFX_MAX(numTasks,1);
+	numRepeats = SCE_PFX_MAX(numRepeats,1);
+
+	PfxUInt32 taskBytes = pfxGetWorkBytesOfTaskManagerPthreads(numTasks);
+	void *taskBuff = SCE_PFX_UTIL_ALLOC(16,taskBytes);
+	PfxTaskManagerPthreads *taskManager = new PfxTaskManagerPthreads(numTasks,numTasks,taskBuff,taskBytes);
+	taskManager->initialize();
+
+	const PfxUInt32 numData[] = {1000,10000,100000,1000000};
+
+	int ret = 0;
+	for(int i=0;i<4;i++) {
+		for(int k=0;k<kKeyCount;k++) {
+			ret |= runBenchmark<PfxSortData16>("PfxSortData16",numData[i],(eKeyType)k,numRepeats,taskManager);
+			ret |= runBenchmark<PfxSortData32>("PfxSortData32",numData[i],(eKeyType)k,numRepeats,taskManager);
+		}
+	}
+
+	taskManager->finalize();
+	delete taskManager;
+	SCE_PFX_UTIL_FREE(taskBuff);
+
+	SCE_PFX_PRINTF("program complete\n");
+
+	return ret;
+}
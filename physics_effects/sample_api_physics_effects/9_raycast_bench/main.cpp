@@ -0,0 +1,270 @@
+/*
+Physics Effects Copyright(C) 2011 Sony Computer Entertainment Inc.
+All rights reserved.
+
+Physics Effects is open software; you can redistribute it and/or
+modify it under the terms of the BSD License.
+
+Physics Effects is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+See the BSD License for more details.
+
+A copy of the BSD License is distributed with
+Physics Effects under the filename: physics_effects_license.txt
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include "physics_effects.h"
+
+using namespace sce::PhysicsEffects;
+
+//J レイキャストのベンチマーク
+//J pfxCastRaysとpfxCastRayPacketsを比較し、全てのレイの結果が一致することを確認する
+//J 使い方 : App_9_Raycast_Bench [タスク数] [繰り返し回数]
+
+//E Ray cast benchmark
+//E Compares pfxCastRays with pfxCastRayPackets, and checks the results of all rays match
+//E Usage : App_9_Raycast_Bench [number of tasks] [number of repeats]
+
+#define NUM_TASKS	4
+#define NUM_REPEATS	5
+#define NUM_RAYS	65536
+
+static PfxUInt32 gSeed = 12345;
+
+static PfxFloat frand()
+{
+	gSeed = gSeed * 1664525u + 1013904223u;
+	return (PfxFloat)(gSeed>>8) / (PfxFloat)(1<<24);
+}
+
+static PfxFloat ticksToMs(PfxUInt64 ticks)
+{
+	return (PfxFloat)((double)ticks * 1000.0 / (double)pfxPerfGetTicksPerSecond());
+}
+
+struct BenchScene {
+	PfxUInt32 numRigidBodies;
+	PfxRigidState *states;
+	PfxCollidable *collidables;
+	PfxBroadphaseProxy *proxies[6];
+	PfxUInt32 numProxies;
+	PfxVector3 worldCenter;
+	PfxVector3 worldExtent;
+};
+
+//J 球、箱、カプセル、シリンダーをランダムに配置する
+//E Spheres, boxes, capsules and cylinders placed randomly
+static void createScene(BenchScene &scene,PfxUInt32 numRigidBodies)
+{
+	scene.numRigidBodies = numRigidBodies;
+	scene.states = (PfxRigidState*)SCE_PFX_UTIL_ALLOC(128,sizeof(PfxRigidState)*numRigidBodies);
+	scene.collidables = (PfxCollidable*)SCE_PFX_UTIL_ALLOC(128,sizeof(PfxCollidable)*numRigidBodies);
+	for(int i=0;i<6;i++) {
+		scene.proxies[i] = (PfxBroadphaseProxy*)SCE_PFX_UTIL_ALLOC(16,sizeof(PfxBroadphaseProxy)*numRigidBodies);
+	}
+	scene.worldCenter = PfxVector3(0.0f);
+	scene.worldExtent = PfxVector3(100.0f);
+
+	for(PfxUInt32 i=0;i<numRigidBodies;i++) {
+		PfxShape shape;
+		shape.reset();
+		switch(i%4) {
+			case 0: shape.setSphere(PfxSphere(0.3f+frand())); break;
+			case 1: shape.setBox(PfxBox(0.2f+frand(),0.2f+frand(),0.2f+frand())); break;
+			case 2: shape.setCapsule(PfxCapsule(0.2f+frand(),0.2f+0.5f*frand())); break;
+			case 3: shape.setCylinder(PfxCylinder(0.2f+frand(),0.2f+0.5f*frand())); break;
+		}
+		scene.collidables[i].reset();
+		scene.collidables[i].addShape(shape);
+		scene.collidables[i].finish();
+
+		scene.states[i].reset();
+		scene.states[i].setPosition(PfxVector3(80.0f*frand()-40.0f,20.0f*frand(),80.0f*frand()-40.0f));
+		scene.states[i].setOrientation(normalize(PfxQuat(frand()-0.5f,frand()-0.5f,frand()-0.5f,frand()+0.1f)));
+		scene.states[i].setMotionType(kPfxMotionTypeActive);
+		scene.states[i].setRigidBodyId((PfxUInt16)i);
+	}
+
+	PfxUpdateBroadphaseProxiesParam param;
+	param.workBytes = pfxGetWorkBytesOfUpdateBroadphaseProxies(numRigidBodies);
+	param.workBuff = SCE_PFX_UTIL_ALLOC(128,param.workBytes);
+	param.numRigidBodies = numRigidBodies;
+	param.offsetRigidStates = scene.states;
+	param.offsetCollidables = scene.collidables;
+	param.proxiesX = scene.proxies[0];
+	param.proxiesY = scene.proxies[1];
+	param.proxiesZ = scene.proxies[2];
+	param.proxiesXb = scene.proxies[3];
+	param.proxiesYb = scene.proxies[4];
+	param.proxiesZb = scene.proxies[5];
+	param.worldCenter = scene.worldCenter;
+	param.worldExtent = scene.worldExtent;
+	param.outOfWorldBehavior = 0;
+
+	PfxUpdateBroadphaseProxiesResult result;
+	pfxUpdateBroadphaseProxies(param,result);
+	scene.numProxies = numRigidBodies - result.numOutOfWorldProxies;
+
+	SCE_PFX_UTIL_FREE(param.workBuff);
+}
+
+static void releaseScene(BenchScene &scene)
+{
+	SCE_PFX_UTIL_FREE(scene.states);
+	SCE_PFX_UTIL_FREE(scene.collidables);
+	for(int i=0;i<6;i++) {
+		SCE_PFX_UTIL_FREE(scene.proxies[i]);
+	}
+}
+
+//J レイの分布
+//J Scatter : ランダムな2点間
+//J Probe : 下向きの平行なレイ
+//J Fan : 1点から放射状
+//E Ray distributions
+//E Scatter : Between two random points
+//E Probe : Parallel downward rays
+//E Fan : Radiating from one point
+enum eRayType {
+	kRayScatter = 0,
+	kRayProbe,
+	kRayFan,
+	kRayCount
+};
+
+static const char *rayTypeName[kRayCount] = {"scatter","probe","fan"};
+
+static void createRays(PfxRayInput *rays,PfxUInt32 numRays,eRayType rayType)
+{
+	for(PfxUInt32 i=0;i<numRays;i++) {
+		rays[i].reset();
+		if(rayType == kRayScatter) {
+			PfxVector3 p1(80.0f*frand()-40.0f,10.0f*frand(),80.0f*frand()-40.0f);
+			PfxVector3 p2(80.0f*frand()-40.0f,10.0f*frand(),80.0f*frand()-40.0f);
+			rays[i].m_startPosition = p1;
+			rays[i].m_direction = p2 - p1;
+		}
+		else if(rayType == kRayProbe) {
+			rays[i].m_startPosition = PfxVector3(80.0f*frand()-40.0f,30.0f,80.0f*frand()-40.0f);
+			rays[i].m_direction = PfxVector3(0.0f,-40.0f,0.0f);
+		}
+		else {
+			PfxFloat angle = SCE_PFX_PI * 2.0f * (PfxFloat)i / (PfxFloat)numRays;
+			rays[i].m_startPosition = PfxVector3(0.0f,5.0f,0.0f);
+			rays[i].m_direction = PfxVector3(cosf(angle)*50.0f,-2.0f*frand(),sinf(angle)*50.0f);
+		}
+	}
+}
+
+static PfxBool isSameOutput(const PfxRayOutput &a,const PfxRayOutput &b)
+{
+	if(a.m_contactFlag != b.m_contactFlag) return false;
+	if(!a.m_contactFlag) return true;
+	return a.m_variable == b.m_variable &&
+		a.m_objectId == b.m_objectId &&
+		a.m_shapeId == b.m_shapeId &&
+		lengthSqr(a.m_contactPoint - b.m_contactPoint) == 0.0f &&
+		lengthSqr(a.m_contactNormal - b.m_contactNormal) == 0.0f;
+}
+
+static int runBenchmark(BenchScene &scene,eRayType rayType,int numRepeats,PfxTaskManager *taskManager)
+{
+	PfxRayInput *rays = (PfxRayInput*)SCE_PFX_UTIL_ALLOC(16,sizeof(PfxRayInput)*NUM_RAYS);
+	PfxRayOutput *reference = (PfxRayOutput*)SCE_PFX_UTIL_ALLOC(16,sizeof(PfxRayOutput)*NUM_RAYS);
+	PfxRayOutput *outputs = (PfxRayOutput*)SCE_PFX_UTIL_ALLOC(16,sizeof(PfxRayOutput)*NUM_RAYS);
+
+	createRays(rays,NUM_RAYS,rayType);
+
+	PfxRayCastParam param;
+	param.offsetRigidStates = scene.states;
+	param.offsetCollidables = scene.collidables;
+	param.proxiesX = scene.proxies[0];
+	param.proxiesY = scene.proxies[1];
+	param.proxiesZ = scene.proxies[2];
+	param.proxiesXb = scene.proxies[3];
+	param.proxiesYb = scene.proxies[4];
+	param.proxiesZb = scene.proxies[5];
+	param.numProxies = scene.numProxies;
+	param.rangeCenter = scene.worldCenter;
+	param.rangeExtent = scene.worldExtent;
+
+	pfxCastRays(rays,reference,NUM_RAYS,param);
+
+	//J レイ単位(1スレッド)、パケット(1スレッド)、レイ単位(Nスレッド)、パケット(Nスレッド)
+	//E Single rays (1 thread), packets (1 thread), single rays (N threads), packets (N threads)
+	PfxFloat ms[4];
+	int ret = 0;
+
+	for(int method=0;method<4;method++) {
+		PfxUInt64 ticks = 0;
+
+		for(int r=0;r<numRepeats;r++) {
+			PfxUInt64 t0 = pfxPerfGetTicks();
+			switch(method) {
+				case 0: pfxCastRays(rays,outputs,NUM_RAYS,param); break;
+				case 1: pfxCastRayPackets(rays,outputs,NUM_RAYS,param); break;
+				case 2: pfxCastRays(rays,outputs,NUM_RAYS,param,taskManager); break;
+				case 3: pfxCastRayPackets(rays,outputs,NUM_RAYS,param,taskManager); break;
+			}
+			ticks += pfxPerfGetTicks() - t0;
+		}
+
+		PfxUInt32 numDiffs = 0;
+		for(PfxUInt32 i=0;i<NUM_RAYS;i++) {
+			if(!isSameOutput(reference[i],outputs[i])) numDiffs++;
+		}
+		if(numDiffs > 0) {
+			SCE_PFX_PRINTF("%s %u : method %d differs in %u rays\n",rayTypeName[rayType],scene.numRigidBodies,method,numDiffs);
+			ret = 1;
+		}
+
+		ms[method] = ticksToMs(ticks) / numRepeats;
+	}
+
+	SCE_PFX_PRINTF("%-7s %6u bodies | rays %8.1f /ms packets %8.1f /ms (x%4.2f) | %u tasks rays %8.1f /ms packets %8.1f /ms (x%4.2f)\n",
+		rayTypeName[rayType],scene.numRigidBodies,
+		NUM_RAYS/ms[0],NUM_RAYS/ms[1],ms[0]/ms[1],
+		taskManager->getNumTasks(),NUM_RAYS/ms[2],NUM_RAYS/ms[3],ms[2]/ms[3]);
+
+	SCE_PFX_UTIL_FREE(rays);
+	SCE_PFX_UTIL_FREE(reference);
+	SCE_PFX_UTIL_FREE(outputs);
+
+	return ret;
+}
+
+int main(int argc,char **argv)
+{
+	int numTasks = argc > 1 ? atoi(argv[1]) : NUM_TASKS;
+	int numRepeats = argc > 2 ? atoi(argv[2]) : NUM_REPEATS;
+	numTasks = SCE_PFX_MAX(numTasks,1);
+	numRepeats = SCE_PFX_MAX(numRepeats,1);
+
+	PfxUInt32 taskBytes = pfxGetWorkBytesOfTaskManagerPthreads(numTasks);
+	void *taskBuff = SCE_PFX_UTIL_ALLOC(16,taskBytes);
+	PfxTaskManagerPthreads *taskManager = new PfxTaskManagerPthreads(numTasks,numTasks,taskBuff,taskBytes);
+	taskManager->initialize();
+
+	const PfxUInt32 numRigidBodies[] = {100,1000,4000};
+
+	int ret = 0;
+	for(int i=0;i<3;i++) {
+		BenchScene scene;
+		createScene(scene,numRigidBodies[i]);
+		for(int k=0;k<kRayCount;k++) {
+			ret |= runBenchmark(scene,(eRayType)k,numRepeats,taskManager);
+		}
+		releaseScene(scene);
+	}
+
+	taskManager->finalize();
+	delete taskManager;
+	SCE_PFX_UTIL_FREE(taskBuff);
+
+	SCE_PFX_PRINTF("program complete\n");
+
+	return ret;
+}
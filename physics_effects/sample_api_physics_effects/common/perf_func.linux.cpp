@@ -0,0 +1,64 @@
+/*
+Physics Effects Copyright(C) 2011 Sony Computer Entertainment Inc.
+All rights reserved.
+
+Physics Effects is open software; you can redistribute it and/or
+modify it under the terms of the BSD License.
+
+Physics Effects is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+See the BSD License for more details.
+
+A copy of the BSD License is distributed with
+Physics Effects under the filename: physics_effects_license.txt
+*/
+
+#include "common.h"
+#include "perf_func.h"
+#include "base_level/base/pfx_perf_trace.h"
+
+using namespace sce::PhysicsEffects;
+
+//J マーカーをトレースに記録し、終了時に統計を表示してChromeトレース形式で出力する
+//J 出力先は環境変数PFX_PERF_TRACEで指定できる
+//E Markers are recorded into the trace. Statistics are printed and Chrome trace JSON
+//E is written on release. The output file can be set with the PFX_PERF_TRACE environment variable
+
+#define PERF_TRACE_FILE "pfx_trace.json"
+
+void perf_init()
+{
+	pfxPerfTraceReset();
+	pfxPerfTraceBeginFrame();
+}
+
+void perf_release()
+{
+	pfxPerfTracePrintStats();
+
+	const char *filename = getenv("PFX_PERF_TRACE");
+	if(!filename) filename = PERF_TRACE_FILE;
+
+	if(pfxPerfTraceExportChromeJson(filename) == SCE_PFX_OK) {
+		SCE_PFX_PRINTF("trace written to %s\n",filename);
+	}
+	else {
+		SCE_PFX_PRINTF("failed to write trace to %s\n",filename);
+	}
+}
+
+void perf_push_marker(char *str)
+{
+	pfxPerfTracePush(str);
+}
+
+void perf_pop_marker()
+{
+	pfxPerfTracePop();
+}
+
+void perf_sync()
+{
+	pfxPerfTraceEndFrame();
+}
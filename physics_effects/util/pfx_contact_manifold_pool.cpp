@@ -0,0 +1,103 @@
+/*
+Physics Effects Copyright(C) 2011 Sony Computer Entertainment Inc.
+All rights reserved.
+
+Physics Effects is open software; you can redistribute it and/or
+modify it under the terms of the BSD License.
+
+Physics Effects is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+See the BSD License for more details.
+
+A copy of the BSD License is distributed with
+Physics Effects under the filename: physics_effects_license.txt
+*/
+
+#include "util/pfx_contact_manifold_pool.h"
+
+namespace sce {
+namespace PhysicsEffects {
+
+PfxContactManifoldPool::PfxContactManifoldPool()
+{
+	m_manifolds = NULL;
+	m_freeIds = NULL;
+	m_numManifolds = 0;
+	m_numFreeIds = 0;
+	m_maxManifolds = 0;
+}
+
+PfxContactManifoldPool::~PfxContactManifoldPool()
+{
+	finalize();
+}
+
+PfxInt32 PfxContactManifoldPool::reserve(PfxUInt32 maxManifolds)
+{
+	if(maxManifolds <= m_maxManifolds) return SCE_PFX_OK;
+
+	PfxContactManifold *manifolds = (PfxContactManifold*)SCE_PFX_UTIL_ALLOC(128,sizeof(PfxContactManifold)*maxManifolds);
+	PfxUInt32 *freeIds = (PfxUInt32*)SCE_PFX_UTIL_ALLOC(16,sizeof(PfxUInt32)*maxManifolds);
+
+	if(!manifolds || !freeIds) {
+		SCE_PFX_UTIL_FREE(manifolds);
+		SCE_PFX_UTIL_FREE(freeIds);
+		return SCE_PFX_ERR_OUT_OF_BUFFER;
+	}
+
+	if(m_manifolds) {
+		memcpy(manifolds,m_manifolds,sizeof(PfxContactManifold)*m_numManifolds);
+		memcpy(freeIds,m_freeIds,sizeof(PfxUInt32)*m_numFreeIds);
+		SCE_PFX_UTIL_FREE(m_manifolds);
+		SCE_PFX_UTIL_FREE(m_freeIds);
+	}
+
+	m_manifolds = manifolds;
+	m_freeIds = freeIds;
+	m_maxManifolds = maxManifolds;
+
+	return SCE_PFX_OK;
+}
+
+void PfxContactManifoldPool::finalize()
+{
+	SCE_PFX_UTIL_FREE(m_manifolds);
+	SCE_PFX_UTIL_FREE(m_freeIds);
+	m_maxManifolds = 0;
+	clear();
+}
+
+void PfxContactManifoldPool::clear()
+{
+	m_numManifolds = 0;
+	m_numFreeIds = 0;
+}
+
+PfxInt32 PfxContactManifoldPool::allocate(PfxUInt16 rigidBodyIdA,PfxUInt16 rigidBodyIdB,PfxUInt32 &manifoldId)
+{
+	if(m_numFreeIds > 0) {
+		manifoldId = m_freeIds[--m_numFreeIds];
+	}
+	else {
+		if(m_numManifolds >= m_maxManifolds) {
+			PfxInt32 ret = reserve(SCE_PFX_MAX(m_maxManifolds*2,m_numManifolds+1));
+			if(ret != SCE_PFX_OK) return ret;
+		}
+		manifoldId = m_numManifolds++;
+	}
+
+	m_manifolds[manifoldId].reset(rigidBodyIdA,rigidBodyIdB);
+
+	return SCE_PFX_OK;
+}
+
+void PfxContactManifoldPool::deallocate(PfxUInt32 manifoldId)
+{
+	SCE_PFX_ASSERT(manifoldId < m_numManifolds);
+	SCE_PFX_ASSERT(m_numFreeIds < m_numManifolds);
+	m_freeIds[m_numFreeIds++] = manifoldId;
+}
+
+} //namespace PhysicsEffects
+} //namespace sce
@@ -0,0 +1,93 @@
+/*
+Physics Effects Copyright(C) 2011 Sony Computer Entertainment Inc.
+All rights reserved.
+
+Physics Effects is open software; you can redistribute it and/or
+modify it under the terms of the BSD License.
+
+Physics Effects is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+See the BSD License for more details.
+
+A copy of the BSD License is distributed with
+Physics Effects under the filename: physics_effects_license.txt
+*/
+
+#ifndef _SCE_PFX_CONTACT_MANIFOLD_POOL_H
+#define _SCE_PFX_CONTACT_MANIFOLD_POOL_H
+
+#include "../base_level/collision/pfx_contact_manifold.h"
+#include "pfx_util_common.h"
+
+namespace sce {
+namespace PhysicsEffects {
+
+///////////////////////////////////////////////////////////////////////////////
+// PfxContactManifoldPool
+
+//J ＜補足＞
+//J ペアからIDで参照されるコンタクトマニフォールドを管理する。
+//J 解放されたIDは再利用され、容量が不足すると自動的に拡張される。
+//J 拡張時、マニフォールドは同じIDの位置へコピーされるためIDは変化しないが、
+//J getManifolds()で取得したポインタは無効になる。
+
+//E <Notes>
+//E Manages contact manifolds referred to by ID from pairs.
+//E Released IDs are reused, and the capacity grows automatically when it runs short.
+//E Manifolds are copied to the same IDs when growing, so IDs never change but
+//E pointers returned by getManifolds() become invalid.
+
+class PfxContactManifoldPool
+{
+private:
+	PfxContactManifold *m_manifolds;
+	PfxUInt32 *m_freeIds;
+	PfxUInt32 m_numManifolds;
+	PfxUInt32 m_numFreeIds;
+	PfxUInt32 m_maxManifolds;
+
+	PfxContactManifoldPool(const PfxContactManifoldPool &);
+	PfxContactManifoldPool &operator=(const PfxContactManifoldPool &);
+
+public:
+	PfxContactManifoldPool();
+	~PfxContactManifoldPool();
+
+	//J 容量をmaxManifolds以上にする
+	//E Makes the capacity at least maxManifolds
+	PfxInt32 reserve(PfxUInt32 maxManifolds);
+
+	void finalize();
+
+	//J 全てのマニフォールドを解放する（容量は維持される）
+	//E Releases all manifolds (the capacity is kept)
+	void clear();
+
+	//J 剛体のペアに対してマニフォールドを初期化して確保する
+	//E Allocates a manifold initialized for the pair of rigid bodies
+	PfxInt32 allocate(PfxUInt16 rigidBodyIdA,PfxUInt16 rigidBodyIdB,PfxUInt32 &manifoldId);
+
+	void deallocate(PfxUInt32 manifoldId);
+
+	//J 使用中のマニフォールドの数
+	//E Number of manifolds in use
+	PfxUInt32 getNumManifolds() const {return m_numManifolds - m_numFreeIds;}
+
+	//J 使用されたIDの上限（ペアが参照するIDはこれより小さい）
+	//E Upper bound of used IDs (pairs refer to IDs smaller than this)
+	PfxUInt32 getIdRange() const {return m_numManifolds;}
+
+	PfxUInt32 getCapacity() const {return m_maxManifolds;}
+
+	PfxContactManifold *getManifolds() {return m_manifolds;}
+	const PfxContactManifold *getManifolds() const {return m_manifolds;}
+
+	PfxContactManifold &getManifold(PfxUInt32 manifoldId) {SCE_PFX_ASSERT(manifoldId < m_numManifolds);return m_manifolds[manifoldId];}
+	const PfxContactManifold &getManifold(PfxUInt32 manifoldId) const {SCE_PFX_ASSERT(manifoldId < m_numManifolds);return m_manifolds[manifoldId];}
+};
+
+} //namespace PhysicsEffects
+} //namespace sce
+
+#endif // _SCE_PFX_CONTACT_MANIFOLD_POOL_H
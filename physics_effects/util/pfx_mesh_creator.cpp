@@ -17,12 +17,12 @@ Physics Effects under the filename: physics_effects_license.txt
 #include "pfx_mesh_creator.h"
 #include "pfx_array.h"
 #include "../base_level/collision/pfx_intersect_common.h"
+#include "../base_level/sort/pfx_sort.h"
+#include "../low_level/task/pfx_task_manager.h"
 
 namespace sce {
 namespace PhysicsEffects {
 
-#define SCE_PFX_LARGETRIMESH_MAX_ISLANDS 256
-
 ///////////////////////////////////////////////////////////////////////////////
 // 凸メッシュ作成時に使用する関数
 
@@ -105,9 +105,9 @@ PfxInt32 pfxCreateConvexMesh(PfxConvexMesh &convex,const PfxCreateConvexMeshPara
 // ラージメッシュ作成時に使用する構造体
 
 struct PfxMcVert {
-	PfxInt16 i;
-	PfxInt16 flag;
-	SCE_PFX_PADDING(1,12)
+	PfxInt32 i;
+	PfxInt32 flag;
+	SCE_PFX_PADDING(1,8)
 	PfxVector3  coord;
 };
 
@@ -181,7 +181,7 @@ struct PfxMcFacetLink {
 typedef PfxMcFacet* PfxMcFacetPtr;
 
 struct PfxMcIslands {
-	PfxArray<PfxMcFacetPtr> facetsInIsland[SCE_PFX_MAX_LARGETRIMESH_ISLANDS];
+	PfxArray<PfxArray<PfxMcFacetPtr>*> facetsInIsland;
 	PfxUInt32 numIslands;
 	SCE_PFX_PADDING(1,12)
 	
@@ -190,9 +190,117 @@ struct PfxMcIslands {
 		numIslands = 0;
 	}
 	
+	~PfxMcIslands()
+	{
+		for(PfxUInt32 i=0;i<numIslands;i++) {
+			delete facetsInIsland[i];
+		}
+	}
+	
 	void add(PfxArray<PfxMcFacetPtr> &facets)
 	{
-		facetsInIsland[numIslands++] = facets;
+		PfxArray<PfxMcFacetPtr> *newFacets = new PfxArray<PfxMcFacetPtr>(SCE_PFX_MAX(facets.size(),1u));
+		*newFacets = facets;
+		facetsInIsland.push(newFacets);
+		numIslands++;
+	}
+};
+
+// 近傍探索に使用するハッシュグリッド
+// 登録したAABBが重なる全てのセルにIDを格納する
+// 多数のセルにまたがる大きなAABBはセルに格納せず、全ての探索で候補として返す
+#define SCE_PFX_MC_GRID_MAX_CELLS 64
+
+struct PfxMcHashGrid {
+	PfxVector3 origin;
+	PfxFloat invCellSize;
+	PfxUInt32 mask;
+	PfxUInt32 numItems;
+	PfxArray<PfxInt32> head;
+	PfxArray<PfxInt32> next;
+	PfxArray<PfxUInt32> ids;
+	PfxArray<PfxUInt32> largeIds;
+	
+	PfxMcHashGrid(const PfxVector3 &origin_,PfxFloat cellSize,PfxUInt32 numItems_)
+	{
+		origin = origin_;
+		invCellSize = 1.0f / cellSize;
+		numItems = numItems_;
+		PfxUInt32 tableSize = 1;
+		while(tableSize < numItems * 2) tableSize <<= 1;
+		mask = tableSize - 1;
+		head.assign(tableSize,-1);
+	}
+	
+	void getCell(const PfxVector3 &p,PfxInt32 *cell) const
+	{
+		for(int axis=0;axis<3;axis++) {
+			PfxFloat c = floorf((p[axis] - origin[axis]) * invCellSize);
+			cell[axis] = (PfxInt32)SCE_PFX_CLAMP(c,-1073741824.0f,1073741824.0f);
+		}
+	}
+	
+	PfxUInt32 getHash(PfxInt32 x,PfxInt32 y,PfxInt32 z) const
+	{
+		return (((PfxUInt32)x * 73856093u) ^ ((PfxUInt32)y * 19349663u) ^ ((PfxUInt32)z * 83492791u)) & mask;
+	}
+	
+	static PfxFloat getNumCells(const PfxInt32 *cellMin,const PfxInt32 *cellMax)
+	{
+		return (PfxFloat)(cellMax[0]-cellMin[0]+1) * (PfxFloat)(cellMax[1]-cellMin[1]+1) * (PfxFloat)(cellMax[2]-cellMin[2]+1);
+	}
+	
+	void add(PfxUInt32 id,const PfxVector3 &aabbMin,const PfxVector3 &aabbMax)
+	{
+		PfxInt32 cellMin[3],cellMax[3];
+		getCell(aabbMin,cellMin);
+		getCell(aabbMax,cellMax);
+		
+		if(getNumCells(cellMin,cellMax) > SCE_PFX_MC_GRID_MAX_CELLS) {
+			largeIds.push(id);
+			return;
+		}
+		
+		for(PfxInt32 z=cellMin[2];z<=cellMax[2];z++) {
+			for(PfxInt32 y=cellMin[1];y<=cellMax[1];y++) {
+				for(PfxInt32 x=cellMin[0];x<=cellMax[0];x++) {
+					PfxUInt32 h = getHash(x,y,z);
+					next.push(head[h]);
+					head[h] = ids.push(id);
+				}
+			}
+		}
+	}
+	
+	// AABBと重なる可能性のあるIDを列挙する（重複を含む）
+	void query(const PfxVector3 &aabbMin,const PfxVector3 &aabbMax,PfxArray<PfxUInt32> &result) const
+	{
+		result.clear();
+		
+		PfxInt32 cellMin[3],cellMax[3];
+		getCell(aabbMin,cellMin);
+		getCell(aabbMax,cellMax);
+		
+		if(getNumCells(cellMin,cellMax) > SCE_PFX_MC_GRID_MAX_CELLS) {
+			for(PfxUInt32 i=0;i<numItems;i++) {
+				result.push(i);
+			}
+			return;
+		}
+		
+		for(PfxInt32 z=cellMin[2];z<=cellMax[2];z++) {
+			for(PfxInt32 y=cellMin[1];y<=cellMax[1];y++) {
+				for(PfxInt32 x=cellMin[0];x<=cellMax[0];x++) {
+					for(PfxInt32 e=head[getHash(x,y,z)];e>=0;e=next[e]) {
+						result.push(ids[e]);
+					}
+				}
+			}
+		}
+		
+		for(PfxUInt32 i=0;i<largeIds.size();i++) {
+			result.push(largeIds[i]);
+		}
 	}
 };
 
@@ -360,7 +468,9 @@ int addIslandToLargeTriMesh(PfxLargeTriMesh &lmesh,PfxTriMesh &island)
 	SCE_PFX_ASSERT(island.m_numFacets <= SCE_PFX_NUMMESHFACETS);
 
 	int newIsland = lmesh.m_numIslands++;
-	lmesh.m_islands[newIsland] = island;
+	// PfxTriMeshはポインタを持たないPODレイアウトのため、キャッシュイメージを一定にするよう未使用領域も含めてバイト単位でコピー
+	memcpy((void*)&lmesh.m_islands[newIsland],&island,sizeof(PfxTriMesh));
+	memset(&lmesh.m_aabbList[newIsland],0,sizeof(PfxAabb16));
 	
 	// アイランドローカルのAABBを計算
 	if(island.m_numFacets > 0) {
@@ -386,14 +496,14 @@ int addIslandToLargeTriMesh(PfxLargeTriMesh &lmesh,PfxTriMesh &island)
 }
 
 static
-void createIsland(PfxTriMesh &island,const PfxArray<PfxMcFacetPtr> &facets)
+void createIsland(PfxTriMesh &island,const PfxArray<PfxMcFacetPtr> &facets,const PfxVector3 &offset)
 {
 	if(facets.empty()) return;
 	
 	island.m_numFacets = facets.size();
 	
-	PfxUInt32 vertsFlag[(0xff*SCE_PFX_NUMMESHFACETS*3+31)/32];
-	memset(vertsFlag,0,sizeof(PfxUInt32)*((0xff*SCE_PFX_NUMMESHFACETS*3+31)/32));
+	// アイランド内の頂点（入力頂点は複数のタイルから同時に参照されるため書き換えない）
+	const PfxMcVert *islandVerts[SCE_PFX_NUMMESHVERTICES];
 	
 	PfxArray<PfxMcEdgeEntry*> edgeHead(facets.size()*3);
 	PfxArray<PfxMcEdgeEntry> edgeList(facets.size()*3);
@@ -421,17 +531,16 @@ void createIsland(PfxTriMesh &island,const PfxArray<PfxMcFacetPtr> &facets)
 		
 		// Vertex
 		for(int v=0;v<3;v++) {
-			PfxMcVert *vert = facets[f]->v[v];
-			PfxUInt32 idx = vert->i;
-			PfxUInt32 mask = 1 << (idx & 31);
-			if((vertsFlag[idx>>5] & mask) == 0) {
+			const PfxMcVert *vert = facets[f]->v[v];
+			int vid = 0;
+			while(vid < vcnt && islandVerts[vid] != vert) vid++;
+			if(vid == vcnt) {
 				SCE_PFX_ASSERT(vcnt<SCE_PFX_NUMMESHVERTICES);
-                vertsFlag[idx>>5] |= mask;
-                island.m_verts[vcnt] = vert->coord;
-				vert->flag = vcnt;// 新しいインデックス
+				islandVerts[vcnt] = vert;
+				island.m_verts[vcnt] = vert->coord - offset;
 				vcnt++;
 			}
-			oFacet.m_vertIds[v] = (PfxUInt8)vert->flag;
+			oFacet.m_vertIds[v] = (PfxUInt8)vid;// 新しいインデックス
 		}
 		
 		// Edge
@@ -483,12 +592,68 @@ void createIsland(PfxTriMesh &island,const PfxArray<PfxMcFacetPtr> &facets)
 	island.updateAABB();
 }
 
+//J アイランドAABBの階層を再帰的に作成する
+//J 最も長い軸でAABBの中心をソートし、半分に分割する
+//J リーフの出現順をleafOrderに格納する
+static
+void createLargeTriMeshBvh(
+	PfxLargeTriMesh &lmesh,
+	PfxSortData16 *islandIds,PfxSortData16 *sortBuff,PfxUInt32 numIslandIds,
+	PfxUInt32 *leafOrder,PfxUInt32 &numLeaves)
+{
+	PfxUInt32 nodeId = lmesh.m_numBvhNodes++;
+	PfxAabb16 &node = lmesh.m_bvhNodes[nodeId];
+
+	node = lmesh.m_aabbList[islandIds[0].get32(0)];
+	for(PfxUInt32 i=1;i<numIslandIds;i++) {
+		node = pfxMergeAabb(node,lmesh.m_aabbList[islandIds[i].get32(0)]);
+	}
+
+	if(numIslandIds == 1) {
+		leafOrder[numLeaves] = islandIds[0].get32(0);
+		pfxSetLargeTriMeshBvhLeaf(node,numLeaves++);
+		return;
+	}
+
+	// 中心の分布が最も広い軸を探す
+	PfxUInt32 centerMin[3] = {0xffffffff,0xffffffff,0xffffffff};
+	PfxUInt32 centerMax[3] = {0,0,0};
+	for(PfxUInt32 i=0;i<numIslandIds;i++) {
+		const PfxAabb16 &aabb = lmesh.m_aabbList[islandIds[i].get32(0)];
+		for(int axis=0;axis<3;axis++) {
+			PfxUInt32 center = (PfxUInt32)pfxGetXYZMin(aabb,axis) + (PfxUInt32)pfxGetXYZMax(aabb,axis);
+			centerMin[axis] = SCE_PFX_MIN(centerMin[axis],center);
+			centerMax[axis] = SCE_PFX_MAX(centerMax[axis],center);
+		}
+	}
+
+	int divAxis = 0;
+	for(int axis=1;axis<3;axis++) {
+		if(centerMax[axis]-centerMin[axis] > centerMax[divAxis]-centerMin[divAxis]) {
+			divAxis = axis;
+		}
+	}
+
+	for(PfxUInt32 i=0;i<numIslandIds;i++) {
+		const PfxAabb16 &aabb = lmesh.m_aabbList[islandIds[i].get32(0)];
+		pfxSetKey(islandIds[i],(PfxUInt32)pfxGetXYZMin(aabb,divAxis) + (PfxUInt32)pfxGetXYZMax(aabb,divAxis));
+	}
+	pfxSort(islandIds,sortBuff,numIslandIds);
+
+	PfxUInt32 numLeft = numIslandIds>>1;
+	createLargeTriMeshBvh(lmesh,islandIds,sortBuff,numLeft,leafOrder,numLeaves);
+	createLargeTriMeshBvh(lmesh,islandIds+numLeft,sortBuff,numIslandIds-numLeft,leafOrder,numLeaves);
+
+	// 子孫を飛ばした次のノード
+	pfxSetLargeTriMeshBvhEscape(lmesh.m_bvhNodes[nodeId],lmesh.m_numBvhNodes);
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 // ラージメッシュ
 
-PfxInt32 pfxCreateLargeTriMesh(PfxLargeTriMesh &lmesh,const PfxCreateLargeTriMeshParam &param)
+static
+PfxInt32 checkLargeTriMeshParam(const PfxCreateLargeTriMeshParam &param)
 {
-	// Check input
 	if(param.numVerts == 0 || param.numTriangles == 0 || !param.verts || !param.triangles)
 		return SCE_PFX_ERR_INVALID_VALUE;
 	
@@ -498,17 +663,25 @@ PfxInt32 pfxCreateLargeTriMesh(PfxLargeTriMesh &lmesh,const PfxCreateLargeTriMes
 	if(param.numFacetsLimit == 0 || param.numFacetsLimit > SCE_PFX_NUMMESHFACETS)
 		return SCE_PFX_ERR_OUT_OF_RANGE;
 	
+	return SCE_PFX_OK;
+}
+
+// 頂点の統合、面の接続と角度、厚み、AABBを算出する
+// タイルに分割する場合もメッシュ全体で行うため、タイル境界のエッジも正しく接続される
+static
+PfxInt32 prepareFacets(
+	const PfxCreateLargeTriMeshParam &param,
+	PfxArray<PfxMcVert> &vertList,
+	PfxArray<PfxMcFacet> &facetList,
+	PfxArray<PfxMcEdge> &edgeList,
+	PfxArray<PfxMcEdge*> &edgeHead)
+{
 	const PfxFloat epsilon = 0.00001f;
 	
-	PfxArray<PfxMcVert>  vertList(param.numVerts);		// 頂点配列
-	PfxArray<PfxMcFacet> facetList(param.numTriangles);	// 面配列
-	PfxArray<PfxMcEdge>  edgeList(param.numTriangles*3);	// エッジ配列
-	PfxArray<PfxMcEdge*> edgeHead(param.numTriangles*3);
-	
 	//J 頂点配列作成
 	for(PfxUInt32 i=0;i<param.numVerts;i++) {
 		PfxFloat *vtx = (PfxFloat*)((uintptr_t)param.verts + param.vertexStrideBytes * i);
-		PfxMcVert mcv;
+		PfxMcVert mcv = PfxMcVert(); // パディングも初期化
 		mcv.flag = 0;
 		mcv.i = i;
 		mcv.coord = pfxReadVector3(vtx);
@@ -598,11 +771,29 @@ PfxInt32 pfxCreateLargeTriMesh(PfxLargeTriMesh &lmesh,const PfxCreateLargeTriMes
 		}
 		
 		// 同一頂点をまとめる
+		// ハッシュグリッドで近傍の頂点のみを比較する（結果は全頂点を比較した場合と同じ）
 		if(param.flag & SCE_PFX_MESH_FLAG_AUTO_ELIMINATION) {
+			const PfxVector3 range(sqrtf(epsilon) * 1.01f);
+			
+			PfxVector3 vertMin(SCE_PFX_FLT_MAX);
+			for(PfxUInt32 i=0;i<param.numVerts;i++) {
+				vertMin = minPerElem(vertMin,vertList[i].coord);
+			}
+			
+			PfxMcHashGrid grid(vertMin,2.0f*range[0],param.numVerts);
+			for(PfxUInt32 i=0;i<param.numVerts;i++) {
+				grid.add(i,vertList[i].coord,vertList[i].coord);
+			}
+			
+			PfxArray<PfxUInt32> candidates;
 			for(PfxUInt32 i=0;i<param.numVerts;i++) {
 				if(vertList[i].flag == 1) continue;
-				for(PfxUInt32 j=i+1;j<param.numVerts;j++) {
-					if(vertList[j].flag == 1) continue;
+				
+				grid.query(vertList[i].coord-range,vertList[i].coord+range,candidates);
+				
+				for(PfxUInt32 n=0;n<candidates.size();n++) {
+					PfxUInt32 j = candidates[n];
+					if(j <= i || vertList[j].flag == 1) continue;
 
 					PfxFloat lenSqr = lengthSqr(vertList[i].coord-vertList[j].coord);
 					
@@ -672,10 +863,11 @@ PfxInt32 pfxCreateLargeTriMesh(PfxLargeTriMesh &lmesh,const PfxCreateLargeTriMes
 	}
 	
 	// 角度を計算
+	PfxQueue<PfxMcFacetLink> cqueue(ecnt); // 面毎に確保すると面数に比例したコストがかかるため使い回す
 	for(PfxUInt32 i=0;i<numTriangles;i++) {
 		PfxMcFacet &facetA = facetList[i];
 
-		PfxQueue<PfxMcFacetLink> cqueue(ecnt);
+		cqueue.clear();
 
 		for(PfxUInt32 j=0;j<3;j++) {
 			if(facetA.neighbor[j] >= 0) {
@@ -752,64 +944,154 @@ PfxInt32 pfxCreateLargeTriMesh(PfxLargeTriMesh &lmesh,const PfxCreateLargeTriMes
 		}
 	}
 	
+	// 面のAABBを算出
+	for(PfxUInt32 f=0;f<(PfxUInt32)numTriangles;f++) {
+		PfxVector3 pnts[3] = {
+			facetList[f].v[0]->coord,
+			facetList[f].v[1]->coord,
+			facetList[f].v[2]->coord,
+		};
+		
+		facetList[f].aabbMin = minPerElem(pnts[2],minPerElem(pnts[1],pnts[0]));
+		facetList[f].aabbMax = maxPerElem(pnts[2],maxPerElem(pnts[1],pnts[0]));
+	}
+
 	// 面に厚みを付ける
+	// 面AのAABBを厚み分広げた範囲と交差する面Bのみをハッシュグリッドで探して判定する
 	if(param.flag & SCE_PFX_MESH_FLAG_AUTO_THICKNESS) {
+		PfxFloat margin = 0.0f;
+		PfxFloat averageSize = 0.0f;
+		PfxVector3 meshMin(SCE_PFX_FLT_MAX);
 		for(PfxUInt32 i=0;i<numTriangles;i++) {
-			PfxMcFacet &facetA = facetList[i];
-			for(PfxUInt32 j=0;j<numTriangles;j++) {
-				// 隣接面は比較対象にしない
-				if( i==j ||
-					j == (PfxInt32)facetA.e[0]->facetId[0] ||
-					j == (PfxInt32)facetA.e[0]->facetId[1] ||
-					j == (PfxInt32)facetA.e[1]->facetId[0] ||
-					j == (PfxInt32)facetA.e[1]->facetId[1] ||
-					j == (PfxInt32)facetA.e[2]->facetId[0] ||
-					j == (PfxInt32)facetA.e[2]->facetId[1]) {
-					continue;
-				}
+			margin = SCE_PFX_MAX(margin,facetList[i].thickness);
+			averageSize += maxElem(facetList[i].aabbMax-facetList[i].aabbMin);
+			meshMin = minPerElem(meshMin,facetList[i].aabbMin);
+		}
+		averageSize /= (PfxFloat)SCE_PFX_MAX(numTriangles,1u);
+		
+		PfxFloat cellSize = averageSize + 2.0f * margin;
+		if(cellSize <= 0.0f) cellSize = 1.0f;
+		
+		PfxMcHashGrid grid(meshMin,cellSize,numTriangles);
+		for(PfxUInt32 i=0;i<numTriangles;i++) {
+			grid.add(i,facetList[i].aabbMin,facetList[i].aabbMax);
+		}
+		
+		// 同じ面を複数のセルから重複して判定しないように記録する
+		PfxArray<PfxUInt32> visited(SCE_PFX_MAX(numTriangles,1u));
+		visited.assign(numTriangles,0xffffffff);
+		
+		PfxArray<PfxUInt32> candidates;
+		for(PfxUInt32 i=0;i<numTriangles;i++) {
+			PfxVector3 aabbMinA = facetList[i].aabbMin - PfxVector3(margin);
+			PfxVector3 aabbMaxA = facetList[i].aabbMax + PfxVector3(margin);
+			
+			grid.query(aabbMinA,aabbMaxA,candidates);
+			
+			for(PfxUInt32 n=0;n<candidates.size();n++) {
+				PfxUInt32 j = candidates[n];
+				if(j <= i || visited[j] == i) continue;
+				visited[j] = i;
 				
-				PfxMcFacet &facetB = facetList[j];
+				if(facetList[j].aabbMin[0] > aabbMaxA[0] || facetList[j].aabbMax[0] < aabbMinA[0]) continue;
+				if(facetList[j].aabbMin[1] > aabbMaxA[1] || facetList[j].aabbMax[1] < aabbMinA[1]) continue;
+				if(facetList[j].aabbMin[2] > aabbMaxA[2] || facetList[j].aabbMax[2] < aabbMinA[2]) continue;
 				
-				// 交差判定
-				PfxFloat closestDistance=0;
-				if(intersect(facetA,facetB,closestDistance)) {
-					// 最近接距離/2を厚みとして採用
-					facetA.thickness = SCE_PFX_MAX(param.defaultThickness,SCE_PFX_MIN(facetA.thickness,closestDistance * 0.5f));
+				// 両方向に判定
+				for(int k=0;k<2;k++) {
+					PfxMcFacet &facetA = facetList[k==0?i:j];
+					PfxMcFacet &facetB = facetList[k==0?j:i];
+					PfxUInt32 idB = k==0?j:i;
+					
+					// 隣接面は比較対象にしない
+					if( idB == facetA.e[0]->facetId[0] ||
+						idB == facetA.e[0]->facetId[1] ||
+						idB == facetA.e[1]->facetId[0] ||
+						idB == facetA.e[1]->facetId[1] ||
+						idB == facetA.e[2]->facetId[0] ||
+						idB == facetA.e[2]->facetId[1]) {
+						continue;
+					}
+					
+					// 交差判定
+					PfxFloat closestDistance=0;
+					if(intersect(facetA,facetB,closestDistance)) {
+						// 最近接距離/2を厚みとして採用
+						facetA.thickness = SCE_PFX_MAX(param.defaultThickness,SCE_PFX_MIN(facetA.thickness,closestDistance * 0.5f));
+					}
 				}
 			}
-
 		}
 	}
+	
+	return SCE_PFX_OK;
+}
 
-	// 面の面積によって３種類に分類する
+// 面の面積の分類に使用する閾値を算出する
+static
+void getAreaLevels(const PfxArray<PfxMcFacet> &facetList,PfxFloat &areaLevel0,PfxFloat &areaLevel1)
+{
 	PfxFloat areaMin=SCE_PFX_FLT_MAX,areaMax=-SCE_PFX_FLT_MAX;
-	for(PfxUInt32 f=0;f<(PfxUInt32)numTriangles;f++) {
-		PfxVector3 pnts[3] = {
-			facetList[f].v[0]->coord,
-			facetList[f].v[1]->coord,
-			facetList[f].v[2]->coord,
-		};
+	for(PfxUInt32 f=0;f<facetList.size();f++) {
 		areaMin = SCE_PFX_MIN(areaMin,facetList[f].area);
 		areaMax = SCE_PFX_MAX(areaMax,facetList[f].area);
-		
-		// 面のAABBを算出
-		facetList[f].aabbMin = minPerElem(pnts[2],minPerElem(pnts[1],pnts[0]));
-		facetList[f].aabbMax = maxPerElem(pnts[2],maxPerElem(pnts[1],pnts[0]));
 	}
 
 	PfxFloat areaDiff = (areaMax-areaMin)/3.0f;
-	PfxFloat areaLevel0,areaLevel1;
 	areaLevel0 = areaMin + areaDiff;
 	areaLevel1 = areaMin + areaDiff * 2.0f;
+}
+
+// 面の集合を再帰的に分割してアイランドに登録する
+static
+void divideFacets(
+	const PfxCreateLargeTriMeshParam &param,
+	PfxMcIslands &islands,
+	PfxArray<PfxMcFacetPtr> &facets,
+	const PfxVector3 &offset,
+	PfxVector3 &lmeshSize)
+{
+	if(facets.empty()) return;
+
+	// 全体のAABBを求める
+	PfxVector3 aabbMin,aabbMax,center,half;
+	aabbMin = facets[0]->aabbMin;
+	aabbMax = facets[0]->aabbMax;
+	for(PfxUInt32 f=1;f<facets.size();f++) {
+		aabbMin = minPerElem(facets[f]->aabbMin,aabbMin);
+		aabbMax = maxPerElem(facets[f]->aabbMax,aabbMax);
+	}
+	center = ( aabbMin + aabbMax ) * 0.5f;
+	half = ( aabbMax - aabbMin ) * 0.5f;
 
-	PfxArray<PfxMcFacetPtr> facetsLv0(numTriangles);
-	PfxArray<PfxMcFacetPtr> facetsLv1(numTriangles);
-	PfxArray<PfxMcFacetPtr> facetsLv2(numTriangles);
+	// 再帰的に処理
+	divideMeshes(
+		param.numFacetsLimit,param.islandsRatio,
+		islands,
+		facets,
+		center,half);
 
-	for(PfxUInt32 f=0;f<numTriangles;f++) {
-		PfxFloat area = facetList[f].area;
+	lmeshSize = maxPerElem(lmeshSize,maxPerElem(absPerElem(aabbMin-offset),absPerElem(aabbMax-offset)));
+}
+
+// 面の集合からラージメッシュを作成する（頂点座標はoffsetからの相対位置に変換される）
+static
+PfxInt32 buildLargeTriMesh(
+	PfxLargeTriMesh &lmesh,
+	const PfxCreateLargeTriMeshParam &param,
+	const PfxArray<PfxMcFacetPtr> &facets,
+	PfxFloat areaLevel0,PfxFloat areaLevel1,
+	const PfxVector3 &offset)
+{
+	// 面の面積によって３種類に分類する
+	PfxArray<PfxMcFacetPtr> facetsLv0(SCE_PFX_MAX(facets.size(),1u));
+	PfxArray<PfxMcFacetPtr> facetsLv1(SCE_PFX_MAX(facets.size(),1u));
+	PfxArray<PfxMcFacetPtr> facetsLv2(SCE_PFX_MAX(facets.size(),1u));
 
-		PfxMcFacet *fct = &facetList[f];
+	for(PfxUInt32 f=0;f<facets.size();f++) {
+		PfxFloat area = facets[f]->area;
+
+		PfxMcFacet *fct = facets[f];
 		if(area < areaLevel0) {
 			facetsLv0.push(fct);
 		}
@@ -823,113 +1105,308 @@ PfxInt32 pfxCreateLargeTriMesh(PfxLargeTriMesh &lmesh,const PfxCreateLargeTriMes
 
 	// アイランドの配列
 	PfxMcIslands islands;
-	PfxVector3 lmeshSize;
+	PfxVector3 lmeshSize(0.0f);
 
 	// レベル毎にPfxTriMeshを作成
-	if(!facetsLv0.empty()) {
-		// 全体のAABBを求める
-		PfxVector3 aabbMin,aabbMax,center,half;
-		aabbMin =facetsLv0[0]->aabbMin;
-		aabbMax = facetsLv0[0]->aabbMax;
-		for(PfxUInt32 f=1;f<facetsLv0.size();f++) {
-			aabbMin = minPerElem(facetsLv0[f]->aabbMin,aabbMin);
-			aabbMax = maxPerElem(facetsLv0[f]->aabbMax,aabbMax);
-		}
-		center = ( aabbMin + aabbMax ) * 0.5f;
-		half = ( aabbMax - aabbMin ) * 0.5f;
-
-		// 再帰的に処理
-		divideMeshes(
-			param.numFacetsLimit,param.islandsRatio,
-			islands,
-			facetsLv0,
-			center,half);
-
-		lmeshSize = maxPerElem(lmeshSize,maxPerElem(absPerElem(aabbMin),absPerElem(aabbMax)));
-	}
-
-	if(!facetsLv1.empty()) {
-		// 全体のAABBを求める
-		PfxVector3 aabbMin,aabbMax,center,half;
-		aabbMin =facetsLv1[0]->aabbMin;
-		aabbMax = facetsLv1[0]->aabbMax;
-		for(PfxUInt32 f=1;f<facetsLv1.size();f++) {
-			aabbMin = minPerElem(facetsLv1[f]->aabbMin,aabbMin);
-			aabbMax = maxPerElem(facetsLv1[f]->aabbMax,aabbMax);
-		}
-		center = ( aabbMin + aabbMax ) * 0.5f;
-		half = ( aabbMax - aabbMin ) * 0.5f;
-
-		// 再帰的に処理
-		divideMeshes(
-			param.numFacetsLimit,param.islandsRatio,
-			islands,
-			facetsLv1,
-			center,half);
-
-		lmeshSize = maxPerElem(lmeshSize,maxPerElem(absPerElem(aabbMin),absPerElem(aabbMax)));
-	}
-
-	if(!facetsLv2.empty()) {
-		// 全体のAABBを求める
-		PfxVector3 aabbMin,aabbMax,center,half;
-		aabbMin =facetsLv2[0]->aabbMin;
-		aabbMax = facetsLv2[0]->aabbMax;
-		for(PfxUInt32 f=1;f<facetsLv2.size();f++) {
-			aabbMin = minPerElem(facetsLv2[f]->aabbMin,aabbMin);
-			aabbMax = maxPerElem(facetsLv2[f]->aabbMax,aabbMax);
-		}
-		center = ( aabbMin + aabbMax ) * 0.5f;
-		half = ( aabbMax - aabbMin ) * 0.5f;
-
-		// 再帰的に処理
-		divideMeshes(
-			param.numFacetsLimit,param.islandsRatio,
-			islands,
-			facetsLv2,
-			center,half);
-
-		lmeshSize = maxPerElem(lmeshSize,maxPerElem(absPerElem(aabbMin),absPerElem(aabbMax)));
+	divideFacets(param,islands,facetsLv0,offset,lmeshSize);
+	divideFacets(param,islands,facetsLv1,offset,lmeshSize);
+	divideFacets(param,islands,facetsLv2,offset,lmeshSize);
+
+	if(islands.numIslands == 0 || islands.numIslands > SCE_PFX_MAX_LARGETRIMESH_ISLANDS) {
+		SCE_PFX_PRINTF("islands overflow! %d/%d\n",islands.numIslands,SCE_PFX_MAX_LARGETRIMESH_ISLANDS);
+		return SCE_PFX_ERR_OUT_OF_RANGE;
 	}
 
+	// PfxLargeTriMeshの生成
 	lmesh.m_half = lmeshSize;
+	lmesh.m_numIslands = 0;
+	lmesh.m_aabbList = (PfxAabb16*)SCE_PFX_UTIL_ALLOC(128,sizeof(PfxAabb16)*islands.numIslands);
+	lmesh.m_islands = (PfxTriMesh*)SCE_PFX_UTIL_ALLOC(128,sizeof(PfxTriMesh)*islands.numIslands);
+	
+	for(PfxUInt32 i=0;i<islands.numIslands;i++) {
+		PfxTriMesh island;
+		memset((void*)&island,0,sizeof(PfxTriMesh)); // キャッシュの内容を一定にするため未使用領域もクリア（PODレイアウト）
+		createIsland(island,*islands.facetsInIsland[i],offset);
+		addIslandToLargeTriMesh(lmesh,island);
+	}
 
-	// Check Islands
-	//for(PfxInt32 i=0;i<islands.numIslands;i++) {
-	//	SCE_PFX_PRINTF("island %d\n",i);
-	//	for(PfxInt32 f=0;f<islands.facetsInIsland[i].size();f++) {
-	//		PfxMcFacet *facet = islands.facetsInIsland[i][f];
-	//		SCE_PFX_PRINTF("   %d %d %d\n",facet->v[0]->i,facet->v[1]->i,facet->v[2]->i);
-	//	}
-	//}
+	// アイランドAABBの階層を作成し、アイランドをリーフの順に並べ替える
+	{
+		PfxUInt32 numIslands = lmesh.m_numIslands;
+		lmesh.m_numBvhNodes = 0;
+		lmesh.m_bvhNodes = (PfxAabb16*)SCE_PFX_UTIL_ALLOC(128,sizeof(PfxAabb16)*(2*numIslands-1));
+		
+		PfxSortData16 *islandIds = (PfxSortData16*)SCE_PFX_UTIL_ALLOC(16,sizeof(PfxSortData16)*numIslands);
+		PfxSortData16 *sortBuff = (PfxSortData16*)SCE_PFX_UTIL_ALLOC(16,sizeof(PfxSortData16)*numIslands);
+		PfxUInt32 *leafOrder = (PfxUInt32*)SCE_PFX_UTIL_ALLOC(16,sizeof(PfxUInt32)*numIslands);
+		for(PfxUInt32 i=0;i<numIslands;i++) {
+			islandIds[i].set32(0,i);
+		}
+		
+		PfxUInt32 numLeaves = 0;
+		createLargeTriMeshBvh(lmesh,islandIds,sortBuff,numIslands,leafOrder,numLeaves);
+		SCE_PFX_ASSERT(numLeaves == numIslands && lmesh.m_numBvhNodes == 2*numIslands-1);
+		
+		PfxAabb16 *aabbList = (PfxAabb16*)SCE_PFX_UTIL_ALLOC(128,sizeof(PfxAabb16)*numIslands);
+		PfxTriMesh *islandList = (PfxTriMesh*)SCE_PFX_UTIL_ALLOC(128,sizeof(PfxTriMesh)*numIslands);
+		for(PfxUInt32 i=0;i<numIslands;i++) {
+			aabbList[i] = lmesh.m_aabbList[leafOrder[i]];
+			memcpy((void*)&islandList[i],&lmesh.m_islands[leafOrder[i]],sizeof(PfxTriMesh)); // 未使用領域も含めてコピー（PODレイアウト）
+		}
+		
+		SCE_PFX_UTIL_FREE(lmesh.m_aabbList);
+		SCE_PFX_UTIL_FREE(lmesh.m_islands);
+		lmesh.m_aabbList = aabbList;
+		lmesh.m_islands = islandList;
+		
+		SCE_PFX_UTIL_FREE(islandIds);
+		SCE_PFX_UTIL_FREE(sortBuff);
+		SCE_PFX_UTIL_FREE(leafOrder);
+	}
 
-	// PfxLargeTriMeshの生成
-	if(islands.numIslands > 0) {
-		lmesh.m_numIslands = 0;
-		lmesh.m_aabbList = (PfxAabb16*)SCE_PFX_UTIL_ALLOC(128,sizeof(PfxAabb16)*islands.numIslands);
-		lmesh.m_islands = (PfxTriMesh*)SCE_PFX_UTIL_ALLOC(128,sizeof(PfxTriMesh)*islands.numIslands);
-		
-		PfxInt32 maxFacets=0,maxVerts=0,maxEdges=0;
-		for(PfxUInt32 i=0;i<islands.numIslands;i++) {
-			PfxTriMesh island;
-			createIsland(island,islands.facetsInIsland[i]);
-			addIslandToLargeTriMesh(lmesh,island);
-			maxFacets = SCE_PFX_MAX(maxFacets,island.m_numFacets);
-			maxVerts = SCE_PFX_MAX(maxVerts,island.m_numVerts);
-			maxEdges = SCE_PFX_MAX(maxEdges,island.m_numEdges);
-			//SCE_PFX_PRINTF("island %d verts %d edges %d facets %d\n",i,island.m_numVerts,island.m_numEdges,island.m_numFacets);
-		}
-
-		SCE_PFX_PRINTF("generate completed!\n\tinput mesh verts %d triangles %d\n\tislands %d max triangles %d verts %d edges %d\n",
-			param.numVerts,param.numTriangles,
-			lmesh.m_numIslands,maxFacets,maxVerts,maxEdges);
-		SCE_PFX_PRINTF("\tsizeof(PfxLargeTriMesh) %d sizeof(PfxTriMesh) %d\n",sizeof(PfxLargeTriMesh),sizeof(PfxTriMesh));
+	return SCE_PFX_OK;
+}
+
+static
+void printLargeTriMeshInfo(const PfxLargeTriMesh &lmesh,const PfxCreateLargeTriMeshParam &param)
+{
+	PfxInt32 maxFacets=0,maxVerts=0,maxEdges=0;
+	for(PfxUInt32 i=0;i<lmesh.m_numIslands;i++) {
+		const PfxTriMesh &island = lmesh.m_islands[i];
+		maxFacets = SCE_PFX_MAX(maxFacets,island.m_numFacets);
+		maxVerts = SCE_PFX_MAX(maxVerts,island.m_numVerts);
+		maxEdges = SCE_PFX_MAX(maxEdges,island.m_numEdges);
+		//SCE_PFX_PRINTF("island %d verts %d edges %d facets %d\n",i,island.m_numVerts,island.m_numEdges,island.m_numFacets);
 	}
-	else {
-		SCE_PFX_PRINTF("islands overflow! %d/%d\n",islands.numIslands,SCE_PFX_LARGETRIMESH_MAX_ISLANDS);
-		return SCE_PFX_ERR_OUT_OF_RANGE;
+
+	SCE_PFX_PRINTF("generate completed!\n\tinput mesh verts %d triangles %d\n\tislands %d max triangles %d verts %d edges %d bvh nodes %d\n",
+		param.numVerts,param.numTriangles,
+		lmesh.m_numIslands,maxFacets,maxVerts,maxEdges,lmesh.m_numBvhNodes);
+	SCE_PFX_PRINTF("\tsizeof(PfxLargeTriMesh) %d sizeof(PfxTriMesh) %d\n",sizeof(PfxLargeTriMesh),sizeof(PfxTriMesh));
+}
+
+PfxInt32 pfxCreateLargeTriMesh(PfxLargeTriMesh &lmesh,const PfxCreateLargeTriMeshParam &param)
+{
+	// Check input
+	PfxInt32 ret = checkLargeTriMeshParam(param);
+	if(ret != SCE_PFX_OK) return ret;
+	
+	PfxArray<PfxMcVert>  vertList(param.numVerts);		// 頂点配列
+	PfxArray<PfxMcFacet> facetList(param.numTriangles);	// 面配列
+	PfxArray<PfxMcEdge>  edgeList(param.numTriangles*3);	// エッジ配列
+	PfxArray<PfxMcEdge*> edgeHead(param.numTriangles*3);
+	
+	ret = prepareFacets(param,vertList,facetList,edgeList,edgeHead);
+	if(ret != SCE_PFX_OK) return ret;
+	
+	PfxFloat areaLevel0,areaLevel1;
+	getAreaLevels(facetList,areaLevel0,areaLevel1);
+	
+	PfxArray<PfxMcFacetPtr> facets(SCE_PFX_MAX(facetList.size(),1u));
+	for(PfxUInt32 f=0;f<facetList.size();f++) {
+		facets.push(&facetList[f]);
 	}
+	
+	ret = buildLargeTriMesh(lmesh,param,facets,areaLevel0,areaLevel1,PfxVector3(0.0f));
+	if(ret != SCE_PFX_OK) return ret;
+	
+	printLargeTriMeshInfo(lmesh,param);
+
+	return SCE_PFX_OK;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// タイルに分割したラージメッシュ
+
+struct PfxMcTilesIO {
+	PfxLargeTriMesh *tiles;
+	PfxVector3 *tileCenters;
+	PfxInt32 *results;
+	PfxUInt32 numTiles;
+	const PfxUInt32 *tileStarts; // sortedFacets内の各タイルの先頭（numTiles+1個）
+	const PfxSortData16 *sortedFacets;
+	PfxMcFacet *facetList;
+	const PfxCreateLargeTriMeshParam *param;
+	PfxFloat areaLevel0;
+	PfxFloat areaLevel1;
+};
+
+static
+void buildTile(PfxMcTilesIO *io,PfxUInt32 tileId)
+{
+	PfxUInt32 start = io->tileStarts[tileId];
+	PfxUInt32 num = io->tileStarts[tileId+1] - start;
+	
+	PfxArray<PfxMcFacetPtr> facets(num);
+	PfxVector3 aabbMin(SCE_PFX_FLT_MAX),aabbMax(-SCE_PFX_FLT_MAX);
+	for(PfxUInt32 f=0;f<num;f++) {
+		PfxMcFacet *facet = &io->facetList[io->sortedFacets[start+f].get32(0)];
+		aabbMin = minPerElem(aabbMin,facet->aabbMin);
+		aabbMax = maxPerElem(aabbMax,facet->aabbMax);
+		facets.push(facet);
+	}
+	
+	PfxVector3 center = (aabbMin + aabbMax) * 0.5f;
+	io->tileCenters[tileId] = center;
+	io->results[tileId] = buildLargeTriMesh(io->tiles[tileId],*io->param,facets,io->areaLevel0,io->areaLevel1,center);
+}
+
+void pfxCreateLargeTriMeshTilesTaskEntry(PfxTaskArg *arg)
+{
+	PfxMcTilesIO *io = (PfxMcTilesIO*)arg->io;
+	
+	// 大きさの異なるタイルを均等に割り振るため、未処理のタイルを順に取り出す
+	for(;;) {
+		arg->criticalSection->lock();
+		PfxUInt32 tileId = arg->criticalSection->getSharedParam(0);
+		arg->criticalSection->setSharedParam(0,tileId+1);
+		arg->criticalSection->unlock();
+		
+		if(tileId >= io->numTiles) break;
+		
+		buildTile(io,tileId);
+	}
+}
 
+PfxInt32 pfxCreateLargeTriMeshTiles(
+	PfxLargeTriMesh *tiles,PfxVector3 *tileCenters,PfxUInt32 maxTiles,PfxUInt32 &numTiles,
+	const PfxCreateLargeTriMeshParam &param,const PfxVector3 &tileSize,
+	PfxTaskManager *taskManager)
+{
+	numTiles = 0;
+	
+	// Check input
+	PfxInt32 ret = checkLargeTriMeshParam(param);
+	if(ret != SCE_PFX_OK) return ret;
+	
+	if(!tiles || !tileCenters || tileSize[0] <= 0.0f || tileSize[1] <= 0.0f || tileSize[2] <= 0.0f)
+		return SCE_PFX_ERR_INVALID_VALUE;
+	
+	PfxArray<PfxMcVert>  vertList(param.numVerts);		// 頂点配列
+	PfxArray<PfxMcFacet> facetList(param.numTriangles);	// 面配列
+	PfxArray<PfxMcEdge>  edgeList(param.numTriangles*3);	// エッジ配列
+	PfxArray<PfxMcEdge*> edgeHead(param.numTriangles*3);
+	
+	ret = prepareFacets(param,vertList,facetList,edgeList,edgeHead);
+	if(ret != SCE_PFX_OK) return ret;
+	
+	const PfxUInt32 numFacets = facetList.size();
+	if(numFacets == 0) return SCE_PFX_ERR_INVALID_VALUE;
+	
+	// 面積の分類はメッシュ全体で共通
+	PfxFloat areaLevel0,areaLevel1;
+	getAreaLevels(facetList,areaLevel0,areaLevel1);
+	
+	// グリッドの大きさを決める
+	PfxVector3 meshMin(SCE_PFX_FLT_MAX),meshMax(-SCE_PFX_FLT_MAX);
+	for(PfxUInt32 f=0;f<numFacets;f++) {
+		meshMin = minPerElem(meshMin,facetList[f].aabbMin);
+		meshMax = maxPerElem(meshMax,facetList[f].aabbMax);
+	}
+	
+	PfxUInt32 gridSize[3];
+	for(int axis=0;axis<3;axis++) {
+		PfxFloat n = ceilf((meshMax[axis]-meshMin[axis])/tileSize[axis]);
+		gridSize[axis] = (PfxUInt32)SCE_PFX_CLAMP(n,1.0f,1024.0f);
+	}
+	
+	// 面の中心が含まれるタイルでソート
+	PfxSortData16 *sortedFacets = (PfxSortData16*)SCE_PFX_UTIL_ALLOC(16,sizeof(PfxSortData16)*numFacets);
+	PfxSortData16 *sortBuff = (PfxSortData16*)SCE_PFX_UTIL_ALLOC(16,sizeof(PfxSortData16)*numFacets);
+	for(PfxUInt32 f=0;f<numFacets;f++) {
+		PfxVector3 facetCenter = (facetList[f].aabbMin + facetList[f].aabbMax) * 0.5f;
+		PfxUInt32 cell[3];
+		for(int axis=0;axis<3;axis++) {
+			PfxFloat c = floorf((facetCenter[axis]-meshMin[axis])/tileSize[axis]);
+			cell[axis] = (PfxUInt32)SCE_PFX_CLAMP(c,0.0f,(PfxFloat)(gridSize[axis]-1));
+		}
+		sortedFacets[f].set32(0,f);
+		pfxSetKey(sortedFacets[f],(cell[2]*gridSize[1]+cell[1])*gridSize[0]+cell[0]);
+	}
+	pfxSort(sortedFacets,sortBuff,numFacets);
+	SCE_PFX_UTIL_FREE(sortBuff);
+	
+	// 空でないタイルを数える
+	PfxArray<PfxUInt32> tileStarts;
+	for(PfxUInt32 f=0;f<numFacets;f++) {
+		if(f == 0 || pfxGetKey(sortedFacets[f]) != pfxGetKey(sortedFacets[f-1])) {
+			tileStarts.push(f);
+		}
+	}
+	tileStarts.push(numFacets);
+	
+	numTiles = tileStarts.size() - 1;
+	if(numTiles > maxTiles) {
+		SCE_PFX_UTIL_FREE(sortedFacets);
+		return SCE_PFX_ERR_OUT_OF_BUFFER;
+	}
+	
+	PfxArray<PfxInt32> results;
+	results.assign(numTiles,SCE_PFX_OK);
+	
+	PfxMcTilesIO tilesIO;
+	tilesIO.tiles = tiles;
+	tilesIO.tileCenters = tileCenters;
+	tilesIO.results = &results[0];
+	tilesIO.numTiles = numTiles;
+	tilesIO.tileStarts = &tileStarts[0];
+	tilesIO.sortedFacets = sortedFacets;
+	tilesIO.facetList = &facetList[0];
+	tilesIO.param = &param;
+	tilesIO.areaLevel0 = areaLevel0;
+	tilesIO.areaLevel1 = areaLevel1;
+	
+	// タイル毎にラージメッシュを作成
+	if(taskManager) {
+		PfxMcTilesIO *io = (PfxMcTilesIO*)taskManager->allocate(sizeof(PfxMcTilesIO));
+		*io = tilesIO;
+		
+		PfxUInt32 numTasks = taskManager->getNumTasks();
+		taskManager->setSharedParam(0,0);
+		taskManager->setTaskEntry((void*)pfxCreateLargeTriMeshTilesTaskEntry);
+		
+		for(PfxUInt32 t=0;t<numTasks;t++) {
+			taskManager->startTask(t,io,0,0,0,0);
+		}
+		
+		for(PfxUInt32 t=0;t<numTasks;t++) {
+			int taskId;
+			PfxUInt32 data1,data2,data3,data4;
+			taskManager->waitTask(taskId,data1,data2,data3,data4);
+		}
+		
+		taskManager->deallocate(io);
+	}
+	else {
+		for(PfxUInt32 i=0;i<numTiles;i++) {
+			buildTile(&tilesIO,i);
+		}
+	}
+	
+	SCE_PFX_UTIL_FREE(sortedFacets);
+	
+	// 一つでも失敗したら全て解放する
+	ret = SCE_PFX_OK;
+	for(PfxUInt32 i=0;i<numTiles;i++) {
+		if(results[i] != SCE_PFX_OK) ret = results[i];
+	}
+	
+	if(ret != SCE_PFX_OK) {
+		for(PfxUInt32 i=0;i<numTiles;i++) {
+			pfxReleaseLargeTriMesh(tiles[i]);
+		}
+		return ret;
+	}
+	
+	PfxUInt32 totalIslands = 0;
+	for(PfxUInt32 i=0;i<numTiles;i++) {
+		totalIslands += tiles[i].m_numIslands;
+	}
+	
+	SCE_PFX_PRINTF("generate completed!\n\tinput mesh verts %d triangles %d\n\ttiles %d (grid %d x %d x %d) islands %d\n",
+		param.numVerts,param.numTriangles,
+		numTiles,gridSize[0],gridSize[1],gridSize[2],totalIslands);
+	
 	return SCE_PFX_OK;
 }
 
@@ -937,7 +1414,125 @@ void pfxReleaseLargeTriMesh(PfxLargeTriMesh &lmesh)
 {
 	SCE_PFX_UTIL_FREE(lmesh.m_aabbList);
 	SCE_PFX_UTIL_FREE(lmesh.m_islands);
+	SCE_PFX_UTIL_FREE(lmesh.m_bvhNodes);
+	lmesh.m_aabbList = NULL;
+	lmesh.m_islands = NULL;
+	lmesh.m_bvhNodes = NULL;
 	lmesh.m_numIslands = 0;
+	lmesh.m_numBvhNodes = 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// ラージメッシュのキャッシュ
+
+#define SCE_PFX_LARGETRIMESH_CACHE_MAGIC	0x4c584650 // "PFXL"
+#define SCE_PFX_LARGETRIMESH_CACHE_VERSION	1
+#define SCE_PFX_LARGETRIMESH_CACHE_ALIGN	128
+
+struct PfxLargeTriMeshCacheHeader {
+	PfxUInt32 magic;
+	PfxUInt32 version;
+	PfxUInt32 bytes;
+	PfxUInt32 sizeOfTriMesh; // 構造体のレイアウトが異なるキャッシュを検出する
+	PfxUInt32 numIslands;
+	PfxUInt32 numBvhNodes;
+	PfxUInt32 offsetAabbList;
+	PfxUInt32 offsetIslands;
+	PfxUInt32 offsetBvhNodes;
+	PfxFloat half[3];
+	PfxFloat center[3];
+};
+
+static inline
+PfxUInt32 alignCacheBytes(PfxUInt32 bytes)
+{
+	return (bytes + SCE_PFX_LARGETRIMESH_CACHE_ALIGN - 1) & ~(SCE_PFX_LARGETRIMESH_CACHE_ALIGN - 1);
+}
+
+static
+void getLargeTriMeshCacheLayout(const PfxLargeTriMesh &lmesh,PfxLargeTriMeshCacheHeader &header)
+{
+	PfxUInt32 numBvhNodes = lmesh.m_bvhNodes ? lmesh.m_numBvhNodes : 0;
+	
+	header.magic = SCE_PFX_LARGETRIMESH_CACHE_MAGIC;
+	header.version = SCE_PFX_LARGETRIMESH_CACHE_VERSION;
+	header.sizeOfTriMesh = sizeof(PfxTriMesh);
+	header.numIslands = lmesh.m_numIslands;
+	header.numBvhNodes = numBvhNodes;
+	header.offsetAabbList = alignCacheBytes(sizeof(PfxLargeTriMeshCacheHeader));
+	header.offsetIslands = alignCacheBytes(header.offsetAabbList + sizeof(PfxAabb16) * lmesh.m_numIslands);
+	header.offsetBvhNodes = alignCacheBytes(header.offsetIslands + sizeof(PfxTriMesh) * lmesh.m_numIslands);
+	header.bytes = alignCacheBytes(header.offsetBvhNodes + sizeof(PfxAabb16) * numBvhNodes);
+	pfxStoreVector3(lmesh.m_half,header.half);
+	header.center[0] = header.center[1] = header.center[2] = 0.0f;
+}
+
+PfxUInt32 pfxGetBytesOfLargeTriMeshCache(const PfxLargeTriMesh &lmesh)
+{
+	PfxLargeTriMeshCacheHeader header;
+	getLargeTriMeshCacheLayout(lmesh,header);
+	return header.bytes;
+}
+
+PfxInt32 pfxWriteLargeTriMeshCache(const PfxLargeTriMesh &lmesh,void *buff,PfxUInt32 bytes,const PfxVector3 &center)
+{
+	if(!buff || lmesh.m_numIslands == 0 || !lmesh.m_islands || !lmesh.m_aabbList) return SCE_PFX_ERR_INVALID_VALUE;
+	
+	PfxLargeTriMeshCacheHeader header;
+	getLargeTriMeshCacheLayout(lmesh,header);
+	pfxStoreVector3(center,header.center);
+	
+	if(bytes < header.bytes) return SCE_PFX_ERR_OUT_OF_BUFFER;
+	
+	PfxUInt8 *p = (PfxUInt8*)buff;
+	memset(p,0,header.bytes);
+	memcpy(p,&header,sizeof(PfxLargeTriMeshCacheHeader));
+	memcpy(p+header.offsetAabbList,lmesh.m_aabbList,sizeof(PfxAabb16)*header.numIslands);
+	memcpy(p+header.offsetIslands,lmesh.m_islands,sizeof(PfxTriMesh)*header.numIslands);
+	if(header.numBvhNodes > 0) {
+		memcpy(p+header.offsetBvhNodes,lmesh.m_bvhNodes,sizeof(PfxAabb16)*header.numBvhNodes);
+	}
+	
+	return SCE_PFX_OK;
+}
+
+PfxInt32 pfxMapLargeTriMeshCache(PfxLargeTriMesh &lmesh,const void *buff,PfxUInt32 bytes,PfxVector3 *center,PfxUInt32 *cacheBytes)
+{
+	if(!buff) return SCE_PFX_ERR_INVALID_VALUE;
+	if(((uintptr_t)buff & 15) != 0) return SCE_PFX_ERR_INVALID_ALIGN;
+	if(bytes < sizeof(PfxLargeTriMeshCacheHeader)) return SCE_PFX_ERR_OUT_OF_BUFFER;
+	
+	PfxLargeTriMeshCacheHeader header;
+	memcpy(&header,buff,sizeof(PfxLargeTriMeshCacheHeader));
+	
+	// エンディアンや構造体のレイアウトが異なる環境で作成されたキャッシュは使用できない
+	if(header.magic != SCE_PFX_LARGETRIMESH_CACHE_MAGIC ||
+	   header.version != SCE_PFX_LARGETRIMESH_CACHE_VERSION ||
+	   header.sizeOfTriMesh != sizeof(PfxTriMesh) ||
+	   header.numIslands == 0 || header.numIslands > SCE_PFX_MAX_LARGETRIMESH_ISLANDS) {
+		return SCE_PFX_ERR_INVALID_VALUE;
+	}
+	
+	if(bytes < header.bytes ||
+	   header.offsetAabbList + sizeof(PfxAabb16) * header.numIslands > header.bytes ||
+	   header.offsetIslands + sizeof(PfxTriMesh) * header.numIslands > header.bytes ||
+	   header.offsetBvhNodes + sizeof(PfxAabb16) * header.numBvhNodes > header.bytes) {
+		return SCE_PFX_ERR_OUT_OF_BUFFER;
+	}
+	
+	// ポインタはラージメッシュ側にのみ保持するため、キャッシュは読み込み専用のままで良い
+	PfxUInt8 *p = (PfxUInt8*)buff;
+	lmesh.m_half = pfxReadVector3(header.half);
+	lmesh.m_numIslands = (PfxUInt16)header.numIslands;
+	lmesh.m_aabbList = (PfxAabb16*)(p+header.offsetAabbList);
+	lmesh.m_islands = (PfxTriMesh*)(p+header.offsetIslands);
+	lmesh.m_bvhNodes = header.numBvhNodes > 0 ? (PfxAabb16*)(p+header.offsetBvhNodes) : NULL;
+	lmesh.m_numBvhNodes = header.numBvhNodes;
+	
+	if(center) *center = pfxReadVector3(header.center);
+	if(cacheBytes) *cacheBytes = header.bytes;
+	
+	return SCE_PFX_OK;
 }
 
 } //namespace PhysicsEffects
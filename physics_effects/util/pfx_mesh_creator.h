@@ -22,6 +22,8 @@ Physics Effects under the filename: physics_effects_license.txt
 namespace sce {
 namespace PhysicsEffects {
 
+class PfxTaskManager;
+
 //J フラグに指定する値
 //E Specify these values to a flag parameter
 #define SCE_PFX_MESH_FLAG_NORMAL_FLIP		0x01
@@ -88,8 +90,47 @@ struct PfxCreateLargeTriMeshParam {
 
 PfxInt32 pfxCreateLargeTriMesh(PfxLargeTriMesh &lmesh,const PfxCreateLargeTriMeshParam &param);
 
+//J 入力メッシュを一様なグリッドでタイルに分割し、タイル毎にラージメッシュを作成する
+//J 各タイルの頂点はタイルの中心（tileCenters）からの相対位置になるので、剛体をその位置に配置すること
+//J 頂点の統合と面の接続はメッシュ全体で行うため、タイル境界のエッジも正しく接続される
+//J taskManagerを指定した場合はタイルを並列に作成する
+//J タイル数がmaxTilesを超える場合はSCE_PFX_ERR_OUT_OF_BUFFERを返し、numTilesに必要な数を格納する
+//E Split an input mesh into tiles on a uniform grid and create a large mesh for each tile
+//E Vertices of each tile are relative to the center of the tile (tileCenters), so place a rigid body at the position
+//E Vertices are merged and facets are connected on the whole mesh, so edges on tile borders are connected correctly
+//E Tiles are created in parallel if taskManager is specified
+//E If the number of tiles exceeds maxTiles, SCE_PFX_ERR_OUT_OF_BUFFER is returned and numTiles is set to the required number
+PfxInt32 pfxCreateLargeTriMeshTiles(
+	PfxLargeTriMesh *tiles,PfxVector3 *tileCenters,PfxUInt32 maxTiles,PfxUInt32 &numTiles,
+	const PfxCreateLargeTriMeshParam &param,const PfxVector3 &tileSize,
+	PfxTaskManager *taskManager=NULL);
+
 void pfxReleaseLargeTriMesh(PfxLargeTriMesh &lmesh);
 
+///////////////////////////////////////////////////////////////////////////////
+// Large Mesh Cache
+
+//J ラージメッシュのキャッシュはポインタを含まない再配置可能なバイナリイメージ
+//J そのままファイルに保存し、任意のアドレスに読み込む（またはメモリマップする）だけで、コピーせずにラージメッシュとして使用できる
+//J キャッシュのサイズは128バイトの倍数なので、複数のキャッシュを連結して一つのファイルに格納できる
+//E A large mesh cache is a relocatable binary image which has no pointers
+//E It can be saved to a file as is, and used as a large mesh without copying after loading (or memory mapping) at any address
+//E The size of a cache is a multiple of 128 bytes, so caches can be concatenated in a file
+
+PfxUInt32 pfxGetBytesOfLargeTriMeshCache(const PfxLargeTriMesh &lmesh);
+
+//J centerにはタイルの中心などを格納できる
+//E center can be used to store the center of a tile etc.
+PfxInt32 pfxWriteLargeTriMeshCache(const PfxLargeTriMesh &lmesh,void *buff,PfxUInt32 bytes,const PfxVector3 &center=PfxVector3(0.0f));
+
+//J キャッシュを参照するラージメッシュをセットアップする
+//J buffは16バイトアラインされ、ラージメッシュを使用する間保持されていること。このラージメッシュにpfxReleaseLargeTriMeshを呼ばないこと
+//J cacheBytesにはキャッシュ自身のサイズが格納されるので、連結されたキャッシュの次の位置を求めるのに使用できる
+//E Set up a large mesh referring to a cache
+//E buff should be aligned to 16 bytes and kept while the large mesh is used. Don't call pfxReleaseLargeTriMesh for the large mesh
+//E cacheBytes receives the size of the cache, which can be used to find the next one in concatenated caches
+PfxInt32 pfxMapLargeTriMeshCache(PfxLargeTriMesh &lmesh,const void *buff,PfxUInt32 bytes,PfxVector3 *center=NULL,PfxUInt32 *cacheBytes=NULL);
+
 } //namespace PhysicsEffects
 } //namespace sce
 
@@ -24,8 +24,31 @@ Physics Effects under the filename: physics_effects_license.txt
 	#define SCE_PFX_UTIL_REALLOC(ptr,align,size) _aligned_realloc(ptr,size,align)
 	#define SCE_PFX_UTIL_FREE(ptr) if(ptr) {_aligned_free(ptr);ptr=NULL;}
 #else
-	#define SCE_PFX_UTIL_ALLOC(align,size) malloc(size)
-        #define SCE_PFX_UTIL_REALLOC(ptr,align,size) realloc(ptr,size)
+	#include <stdlib.h>
+
+	//J mallocはアライメントを保証しないためposix_memalignを使用する
+	//E Use posix_memalign because malloc does not guarantee the alignment
+	static inline void *pfxUtilAlignedAlloc(size_t align,size_t size)
+	{
+		void *ptr = NULL;
+		if(posix_memalign(&ptr,(align<sizeof(void*))?sizeof(void*):align,size) != 0) return NULL;
+		return ptr;
+	}
+
+	//J reallocはアライメントを保持しないため、ずれた場合はアライメントされた領域へコピーし直す
+	//E realloc does not keep the alignment, so a misaligned result is copied into an aligned block
+	static inline void *pfxUtilAlignedRealloc(void *ptr,size_t align,size_t size)
+	{
+		void *newPtr = realloc(ptr,size);
+		if(!newPtr || ((size_t)newPtr & (align-1)) == 0) return newPtr;
+		void *alignedPtr = pfxUtilAlignedAlloc(align,size);
+		if(alignedPtr) memcpy(alignedPtr,newPtr,size);
+		free(newPtr);
+		return alignedPtr;
+	}
+
+	#define SCE_PFX_UTIL_ALLOC(align,size) pfxUtilAlignedAlloc(align,size)
+	#define SCE_PFX_UTIL_REALLOC(ptr,align,size) pfxUtilAlignedRealloc(ptr,align,size)
         #define SCE_PFX_UTIL_FREE(ptr) if(ptr) {free(ptr);ptr=NULL;}
 #endif
 
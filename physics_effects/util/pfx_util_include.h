@@ -20,7 +20,9 @@ Physics Effects under the filename: physics_effects_license.txt
 ///////////////////////////////////////////////////////////////////////////////
 // Physics Effects Utility Headers
 
+#include "pfx_contact_manifold_pool.h"
 #include "pfx_mass.h"
 #include "pfx_mesh_creator.h"
+#include "pfx_world.h"
 
 #endif // _SCE_PFX_UTIL_INCLUDE_H
@@ -0,0 +1,741 @@
+/*
+Physics Effects Copyright(C) 2011 Sony Computer Entertainment Inc.
+All rights reserved.
+
+Physics Effects is open software; you can redistribute it and/or
+modify it under the terms of the BSD License.
+
+Physics Effects is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+See the BSD License for more details.
+
+A copy of the BSD License is distributed with
+Physics Effects under the filename: physics_effects_license.txt
+*/
+
+#include "util/pfx_world.h"
+
+namespace sce {
+namespace PhysicsEffects {
+
+//J PfxHeapManagerの1回の割り当てで生じるアライメントの余白
+//E Alignment slack of one PfxHeapManager allocation
+#define SCE_PFX_WORLD_ALLOC_SLACK 128
+
+///////////////////////////////////////////////////////////////////////////////
+// Buffer
+
+template <class T>
+static T *pfxWorldAlloc(PfxUInt32 num)
+{
+	return (T*)SCE_PFX_UTIL_ALLOC(128,sizeof(T)*SCE_PFX_MAX(num,1u));
+}
+
+//J 新しいバッファへ有効なデータをコピーして古いバッファを開放する
+//J ワールドのバッファはポインタを持たないPODレイアウトの構造体なのでバイト単位でコピーする
+//E Copies valid data into the new buffer and frees the old one
+//E The world buffers hold pointer-free structures with a POD layout, so they are copied byte-wise
+template <class T>
+static void pfxWorldMove(T *&data,T *newData,PfxUInt32 num)
+{
+	if(data) {
+		memcpy((void*)newData,(const void*)data,sizeof(T)*num);
+		SCE_PFX_UTIL_FREE(data);
+	}
+	data = newData;
+}
+
+static SCE_PFX_FORCE_INLINE
+PfxUInt32 pfxWorldNextCapacity(PfxUInt32 current,PfxUInt32 required)
+{
+	return SCE_PFX_MAX(required,current*2);
+}
+
+PfxInt32 PfxWorld::reserveRigidBodies(PfxUInt32 maxRigidBodies)
+{
+	if(maxRigidBodies <= m_maxRigidBodies) return SCE_PFX_OK;
+
+	PfxRigidState *states = pfxWorldAlloc<PfxRigidState>(maxRigidBodies);
+	PfxRigidBody *bodies = pfxWorldAlloc<PfxRigidBody>(maxRigidBodies);
+	PfxCollidable *collidables = pfxWorldAlloc<PfxCollidable>(maxRigidBodies);
+	PfxSolverBody *solverBodies = pfxWorldAlloc<PfxSolverBody>(maxRigidBodies);
+	PfxBroadphaseProxy *proxies[6];
+	bool failed = !states || !bodies || !collidables || !solverBodies;
+	for(int i=0;i<6;i++) {
+		proxies[i] = pfxWorldAlloc<PfxBroadphaseProxy>(maxRigidBodies);
+		failed = failed || !proxies[i];
+	}
+
+	if(failed) {
+		SCE_PFX_UTIL_FREE(states);
+		SCE_PFX_UTIL_FREE(bodies);
+		SCE_PFX_UTIL_FREE(collidables);
+		SCE_PFX_UTIL_FREE(solverBodies);
+		for(int i=0;i<6;i++) {
+			SCE_PFX_UTIL_FREE(proxies[i]);
+		}
+		return SCE_PFX_ERR_OUT_OF_BUFFER;
+	}
+
+	//J プロキシとソルバーボディは毎フレーム作り直されるのでコピー不要
+	//E Proxies and solver bodies are rebuilt every frame, so they are not copied
+	pfxWorldMove(m_states,states,m_numRigidBodies);
+	pfxWorldMove(m_bodies,bodies,m_numRigidBodies);
+	pfxWorldMove(m_collidables,collidables,m_numRigidBodies);
+	pfxWorldMove(m_solverBodies,solverBodies,0);
+	for(int i=0;i<6;i++) {
+		pfxWorldMove(m_proxies[i],proxies[i],0);
+	}
+
+	m_maxRigidBodies = maxRigidBodies;
+
+	return SCE_PFX_OK;
+}
+
+PfxInt32 PfxWorld::reserveJoints(PfxUInt32 maxJoints)
+{
+	if(maxJoints <= m_maxJoints) return SCE_PFX_OK;
+
+	PfxJoint *joints = pfxWorldAlloc<PfxJoint>(maxJoints);
+	PfxConstraintPair *jointPairs = pfxWorldAlloc<PfxConstraintPair>(maxJoints);
+
+	if(!joints || !jointPairs) {
+		SCE_PFX_UTIL_FREE(joints);
+		SCE_PFX_UTIL_FREE(jointPairs);
+		return SCE_PFX_ERR_OUT_OF_BUFFER;
+	}
+
+	pfxWorldMove(m_joints,joints,m_numJoints);
+	pfxWorldMove(m_jointPairs,jointPairs,m_numJoints);
+
+	m_maxJoints = maxJoints;
+
+	return SCE_PFX_OK;
+}
+
+PfxInt32 PfxWorld::reserveContacts(PfxUInt32 maxContacts)
+{
+	if(maxContacts <= m_maxContacts) return SCE_PFX_OK;
+
+	//J 有効なコンタクトの数はペアの数を超えないため、ペアと同じ容量を確保しておく
+	//E Live contacts never outnumber the pairs, so the same capacity as the pairs is reserved
+	PfxInt32 ret = m_contactPool.reserve(maxContacts);
+	if(ret != SCE_PFX_OK) return ret;
+
+	PfxBroadphasePair *pairsBuff0 = pfxWorldAlloc<PfxBroadphasePair>(maxContacts);
+	PfxBroadphasePair *pairsBuff1 = pfxWorldAlloc<PfxBroadphasePair>(maxContacts);
+
+	if(!pairsBuff0 || !pairsBuff1) {
+		SCE_PFX_UTIL_FREE(pairsBuff0);
+		SCE_PFX_UTIL_FREE(pairsBuff1);
+		return SCE_PFX_ERR_OUT_OF_BUFFER;
+	}
+
+	pfxWorldMove(m_pairsBuff[0],pairsBuff0,m_numPairs[0]);
+	pfxWorldMove(m_pairsBuff[1],pairsBuff1,m_numPairs[1]);
+
+	m_maxContacts = maxContacts;
+
+	return SCE_PFX_OK;
+}
+
+PfxInt32 PfxWorld::reserveIncrementalBroadphase(PfxUInt32 maxRigidBodies,PfxUInt32 maxPairs)
+{
+	if(m_incrementalBuff &&
+		maxRigidBodies <= m_incrementalBroadphase.maxRigidBodies &&
+		maxPairs <= m_incrementalBroadphase.maxPairs) return SCE_PFX_OK;
+
+	//J 作り直した端点リストは次の更新で再構築される
+	//E The new endpoint lists are rebuilt at the next update
+	PfxUInt32 bytes = pfxGetBytesOfIncrementalBroadphase(maxRigidBodies,maxPairs);
+	PfxUInt8 *buff = (PfxUInt8*)SCE_PFX_UTIL_ALLOC(128,bytes);
+	if(!buff) return SCE_PFX_ERR_OUT_OF_BUFFER;
+
+	SCE_PFX_UTIL_FREE(m_incrementalBuff);
+	m_incrementalBuff = buff;
+
+	return pfxInitializeIncrementalBroadphase(m_incrementalBroadphase,buff,bytes,maxRigidBodies,maxPairs);
+}
+
+PfxInt32 PfxWorld::reservePool(PfxUInt32 bytes)
+{
+	if(bytes <= m_poolBytes) return SCE_PFX_OK;
+
+	//J 最大使用量を保持し、拡張する場合は余裕を持たせる
+	//E Keep the high-water mark and add some headroom when growing
+	PfxUInt32 newBytes = SCE_PFX_BYTES_ALIGN128(SCE_PFX_MAX(bytes,m_poolBytes+m_poolBytes/2));
+	PfxUInt8 *newBuff = (PfxUInt8*)SCE_PFX_UTIL_ALLOC(128,newBytes);
+	if(!newBuff) return SCE_PFX_ERR_OUT_OF_BUFFER;
+
+	SCE_PFX_UTIL_FREE(m_poolBuff);
+	m_poolBuff = newBuff;
+	m_poolBytes = newBytes;
+
+	return SCE_PFX_OK;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// PfxWorld
+
+PfxWorld::PfxWorld()
+{
+	m_numRigidBodies = m_maxRigidBodies = 0;
+	m_states = NULL;
+	m_bodies = NULL;
+	m_collidables = NULL;
+	m_solverBodies = NULL;
+	for(int i=0;i<6;i++) {
+		m_proxies[i] = NULL;
+	}
+
+	m_numJoints = m_maxJoints = 0;
+	m_joints = NULL;
+	m_jointPairs = NULL;
+
+	m_maxContacts = 0;
+
+	m_pairSwap = 0;
+	m_numPairs[0] = m_numPairs[1] = 0;
+	m_pairsBuff[0] = m_pairsBuff[1] = NULL;
+
+	m_incrementalBuff = NULL;
+
+	m_poolBuff = NULL;
+	m_poolBytes = 0;
+
+	m_frame = 0;
+}
+
+PfxWorld::~PfxWorld()
+{
+	finalize();
+}
+
+PfxInt32 PfxWorld::initialize(const PfxWorldParam &param)
+{
+	finalize();
+
+	m_param = param;
+
+	PfxInt32 ret = SCE_PFX_OK;
+	if(ret == SCE_PFX_OK) ret = reserveRigidBodies(SCE_PFX_MAX(param.initialRigidBodies,1u));
+	if(ret == SCE_PFX_OK) ret = reserveJoints(SCE_PFX_MAX(param.initialJoints,1u));
+	if(ret == SCE_PFX_OK) ret = reserveContacts(SCE_PFX_MAX(param.initialContacts,1u));
+
+	if(ret != SCE_PFX_OK) {
+		finalize();
+	}
+
+	return ret;
+}
+
+void PfxWorld::finalize()
+{
+	SCE_PFX_UTIL_FREE(m_states);
+	SCE_PFX_UTIL_FREE(m_bodies);
+	SCE_PFX_UTIL_FREE(m_collidables);
+	SCE_PFX_UTIL_FREE(m_solverBodies);
+	for(int i=0;i<6;i++) {
+		SCE_PFX_UTIL_FREE(m_proxies[i]);
+	}
+	SCE_PFX_UTIL_FREE(m_joints);
+	SCE_PFX_UTIL_FREE(m_jointPairs);
+	m_contactPool.finalize();
+	SCE_PFX_UTIL_FREE(m_pairsBuff[0]);
+	SCE_PFX_UTIL_FREE(m_pairsBuff[1]);
+	SCE_PFX_UTIL_FREE(m_incrementalBuff);
+	SCE_PFX_UTIL_FREE(m_poolBuff);
+
+	m_maxRigidBodies = 0;
+	m_maxJoints = 0;
+	m_maxContacts = 0;
+	m_poolBytes = 0;
+
+	clear();
+}
+
+void PfxWorld::clear()
+{
+	m_numRigidBodies = 0;
+	m_numJoints = 0;
+	m_contactPool.clear();
+	m_pairSwap = 0;
+	m_numPairs[0] = m_numPairs[1] = 0;
+	m_frame = 0;
+
+	if(m_incrementalBuff) {
+		pfxResetIncrementalBroadphase(m_incrementalBroadphase);
+	}
+}
+
+PfxInt32 PfxWorld::addRigidBody(const PfxRigidState &state,const PfxRigidBody &body,const PfxCollidable &collidable,PfxUInt32 &rigidBodyId)
+{
+	//J 剛体IDは16ビットで保持される
+	//E Rigid body IDs are stored in 16 bits
+	if(m_numRigidBodies >= 0xffff) return SCE_PFX_ERR_OUT_OF_RANGE;
+
+	if(m_numRigidBodies >= m_maxRigidBodies) {
+		PfxInt32 ret = reserveRigidBodies(pfxWorldNextCapacity(m_maxRigidBodies,m_numRigidBodies+1));
+		if(ret != SCE_PFX_OK) return ret;
+	}
+
+	rigidBodyId = m_numRigidBodies++;
+
+	m_states[rigidBodyId] = state;
+	m_states[rigidBodyId].setRigidBodyId((PfxUInt16)rigidBodyId);
+	m_bodies[rigidBodyId] = body;
+	m_collidables[rigidBodyId] = collidable;
+
+	return SCE_PFX_OK;
+}
+
+PfxInt32 PfxWorld::addJoint(const PfxJoint &joint,PfxUInt32 &jointId)
+{
+	if(joint.m_rigidBodyIdA >= m_numRigidBodies || joint.m_rigidBodyIdB >= m_numRigidBodies) return SCE_PFX_ERR_OUT_OF_RANGE;
+
+	if(m_numJoints >= m_maxJoints) {
+		PfxInt32 ret = reserveJoints(pfxWorldNextCapacity(m_maxJoints,m_numJoints+1));
+		if(ret != SCE_PFX_OK) return ret;
+	}
+
+	jointId = m_numJoints++;
+
+	m_joints[jointId] = joint;
+
+	return SCE_PFX_OK;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Simulation
+
+PfxInt32 PfxWorld::simulate()
+{
+	SCE_PFX_PUSH_MARKER("PfxWorld::simulate");
+
+	applyGravity();
+
+	PfxInt32 ret = broadphase();
+	if(ret == SCE_PFX_OK) ret = collision();
+	if(ret == SCE_PFX_OK) ret = constraintSolver();
+	if(ret == SCE_PFX_OK) ret = integrate();
+
+	m_frame++;
+
+	SCE_PFX_POP_MARKER();
+
+	return ret;
+}
+
+void PfxWorld::applyGravity()
+{
+	for(PfxUInt32 i=0;i<m_numRigidBodies;i++) {
+		pfxApplyExternalForce(m_states[i],m_bodies[i],m_bodies[i].getMass()*m_param.gravity,PfxVector3(0.0f),m_param.timeStep);
+	}
+}
+
+PfxInt32 PfxWorld::broadphase()
+{
+	PfxTaskManager *taskManager = m_param.taskManager;
+	PfxInt32 ret = SCE_PFX_OK;
+
+	m_pairSwap = 1-m_pairSwap;
+
+	PfxUInt32 &numCurrentPairs = m_numPairs[m_pairSwap];
+
+	numCurrentPairs = 0;
+
+	if(m_numRigidBodies == 0) {
+		m_numPairs[1-m_pairSwap] = 0;
+		return SCE_PFX_OK;
+	}
+
+	ret = m_param.incrementalBroadphase ? findPairsIncremental() : findPairs();
+	if(ret != SCE_PFX_OK) return ret;
+
+	{
+		PfxBroadphasePair *currentPairs = m_pairsBuff[m_pairSwap];
+
+		PfxUInt32 workBytes = sizeof(PfxBroadphasePair) * numCurrentPairs;
+		ret = reservePool(workBytes + SCE_PFX_WORLD_ALLOC_SLACK);
+		if(ret != SCE_PFX_OK) return ret;
+
+		ret = taskManager ?
+			pfxParallelSort(currentPairs,numCurrentPairs,m_poolBuff,m_poolBytes,taskManager) :
+			pfxParallelSort(currentPairs,numCurrentPairs,m_poolBuff,m_poolBytes);
+		if(ret != SCE_PFX_OK) return ret;
+	}
+
+	return SCE_PFX_OK;
+}
+
+PfxInt32 PfxWorld::findPairs()
+{
+	PfxTaskManager *taskManager = m_param.taskManager;
+	PfxUInt32 numTasks = getNumTasks();
+	PfxInt32 ret = SCE_PFX_OK;
+
+	PfxUInt32 numPreviousPairs = m_numPairs[1-m_pairSwap];
+
+	//J 剛体が最も分散している軸を見つける
+	//E Find the axis along which all rigid bodies are most widely positioned
+	int axis = 0;
+	{
+		PfxVector3 s(0.0f),s2(0.0f);
+		for(PfxUInt32 i=0;i<m_numRigidBodies;i++) {
+			PfxVector3 c = m_states[i].getPosition();
+			s += c;
+			s2 += mulPerElem(c,c);
+		}
+		PfxVector3 v = s2 - mulPerElem(s,s) / (float)m_numRigidBodies;
+		if(v[1] > v[0]) axis = 1;
+		if(v[2] > v[axis]) axis = 2;
+	}
+
+	//J ブロードフェーズプロキシの更新
+	//E Update broadphase proxies
+	{
+		ret = reservePool(pfxGetWorkBytesOfUpdateBroadphaseProxies(m_numRigidBodies,numTasks) + SCE_PFX_WORLD_ALLOC_SLACK);
+		if(ret != SCE_PFX_OK) return ret;
+
+		PfxUpdateBroadphaseProxiesParam param;
+		param.workBuff = m_poolBuff;
+		param.workBytes = m_poolBytes;
+		param.proxiesX = m_proxies[0];
+		param.proxiesY = m_proxies[1];
+		param.proxiesZ = m_proxies[2];
+		param.proxiesXb = m_proxies[3];
+		param.proxiesYb = m_proxies[4];
+		param.proxiesZb = m_proxies[5];
+		param.offsetRigidStates = m_states;
+		param.offsetCollidables = m_collidables;
+		param.numRigidBodies = m_numRigidBodies;
+		param.outOfWorldBehavior = m_param.outOfWorldBehavior;
+		param.worldCenter = m_param.worldCenter;
+		param.worldExtent = m_param.worldExtent;
+
+		PfxUpdateBroadphaseProxiesResult result;
+
+		ret = taskManager ?
+			pfxUpdateBroadphaseProxies(param,result,taskManager) :
+			pfxUpdateBroadphaseProxies(param,result);
+		if(ret != SCE_PFX_OK) return ret;
+	}
+
+	//J 交差ペア探索と合成
+	//J ペア数が容量を超えた場合はコンタクトを拡張してやり直す
+	//E Find and decompose overlapped pairs
+	//E Contacts are grown and pairs are searched again if they exceed the capacity
+	for(;;) {
+		PfxUInt32 maxPairs = m_maxContacts;
+
+		ret = reservePool(
+			pfxGetPairBytesOfFindPairs(maxPairs) +
+			pfxGetWorkBytesOfFindPairs(maxPairs,numTasks) +
+			pfxGetPairBytesOfDecomposePairs(numPreviousPairs,maxPairs) +
+			pfxGetWorkBytesOfDecomposePairs(numPreviousPairs,maxPairs,numTasks) +
+			SCE_PFX_WORLD_ALLOC_SLACK * 4);
+		if(ret != SCE_PFX_OK) return ret;
+
+		PfxHeapManager pool(m_poolBuff,m_poolBytes);
+
+		PfxFindPairsParam findPairsParam;
+		findPairsParam.pairBytes = pfxGetPairBytesOfFindPairs(maxPairs);
+		findPairsParam.pairBuff = pool.allocate(findPairsParam.pairBytes);
+		findPairsParam.workBytes = pfxGetWorkBytesOfFindPairs(maxPairs,numTasks);
+		findPairsParam.workBuff = pool.allocate(findPairsParam.workBytes);
+		findPairsParam.proxies = m_proxies[axis];
+		findPairsParam.numProxies = m_numRigidBodies;
+		findPairsParam.maxPairs = maxPairs;
+		findPairsParam.axis = axis;
+
+		PfxFindPairsResult findPairsResult;
+
+		ret = taskManager ?
+			pfxFindPairs(findPairsParam,findPairsResult,taskManager) :
+			pfxFindPairs(findPairsParam,findPairsResult);
+
+		if(ret == SCE_PFX_ERR_OUT_OF_MAX_PAIRS) {
+			ret = reserveContacts(pfxWorldNextCapacity(m_maxContacts,m_maxContacts+1));
+			if(ret != SCE_PFX_OK) return ret;
+			continue;
+		}
+		if(ret != SCE_PFX_OK) return ret;
+
+		pool.deallocate(findPairsParam.workBuff);
+
+		PfxDecomposePairsParam decomposePairsParam;
+		decomposePairsParam.pairBytes = pfxGetPairBytesOfDecomposePairs(numPreviousPairs,findPairsResult.numPairs);
+		decomposePairsParam.pairBuff = pool.allocate(decomposePairsParam.pairBytes);
+		decomposePairsParam.workBytes = pfxGetWorkBytesOfDecomposePairs(numPreviousPairs,findPairsResult.numPairs,numTasks);
+		decomposePairsParam.workBuff = pool.allocate(decomposePairsParam.workBytes);
+		decomposePairsParam.previousPairs = m_pairsBuff[1-m_pairSwap];
+		decomposePairsParam.numPreviousPairs = numPreviousPairs;
+		decomposePairsParam.currentPairs = findPairsResult.pairs;
+		decomposePairsParam.numCurrentPairs = findPairsResult.numPairs;
+
+		PfxDecomposePairsResult decomposePairsResult;
+
+		ret = taskManager ?
+			pfxDecomposePairs(decomposePairsParam,decomposePairsResult,taskManager) :
+			pfxDecomposePairs(decomposePairsParam,decomposePairsResult);
+		if(ret != SCE_PFX_OK) return ret;
+
+		pool.deallocate(decomposePairsParam.workBuff);
+
+		mergePairs(
+			decomposePairsResult.outNewPairs,decomposePairsResult.numOutNewPairs,
+			decomposePairsResult.outKeepPairs,decomposePairsResult.numOutKeepPairs,
+			decomposePairsResult.outRemovePairs,decomposePairsResult.numOutRemovePairs);
+
+		pool.deallocate(decomposePairsParam.pairBuff);
+		pool.deallocate(findPairsParam.pairBuff);
+		break;
+	}
+
+	return SCE_PFX_OK;
+}
+
+PfxInt32 PfxWorld::findPairsIncremental()
+{
+	PfxInt32 ret = SCE_PFX_OK;
+
+	PfxUInt32 numPreviousPairs = m_numPairs[1-m_pairSwap];
+
+	//J ペア数が容量を超えた場合はコンタクトを拡張し、端点リストを再構築する
+	//E Contacts are grown and the endpoint lists are rebuilt if pairs exceed the capacity
+	for(;;) {
+		PfxUInt32 maxPairs = m_maxContacts;
+
+		ret = reserveIncrementalBroadphase(m_maxRigidBodies,maxPairs);
+		if(ret != SCE_PFX_OK) return ret;
+
+		ret = reservePool(pfxGetPairBytesOfUpdateIncrementalBroadphase(numPreviousPairs,maxPairs) + SCE_PFX_WORLD_ALLOC_SLACK);
+		if(ret != SCE_PFX_OK) return ret;
+
+		PfxUpdateIncrementalBroadphaseParam param;
+		param.pairBuff = m_poolBuff;
+		param.pairBytes = m_poolBytes;
+		param.previousPairs = m_pairsBuff[1-m_pairSwap];
+		param.numPreviousPairs = numPreviousPairs;
+		param.offsetRigidStates = m_states;
+		param.offsetCollidables = m_collidables;
+		param.numRigidBodies = m_numRigidBodies;
+		param.outOfWorldBehavior = m_param.outOfWorldBehavior;
+		param.worldCenter = m_param.worldCenter;
+		param.worldExtent = m_param.worldExtent;
+
+		PfxUpdateIncrementalBroadphaseResult result;
+
+		ret = pfxUpdateIncrementalBroadphase(m_incrementalBroadphase,param,result);
+
+		if(ret == SCE_PFX_ERR_OUT_OF_MAX_PAIRS) {
+			ret = reserveContacts(pfxWorldNextCapacity(m_maxContacts,m_maxContacts+1));
+			if(ret != SCE_PFX_OK) return ret;
+			continue;
+		}
+		if(ret != SCE_PFX_OK) return ret;
+
+		mergePairs(
+			result.outNewPairs,result.numOutNewPairs,
+			result.outKeepPairs,result.numOutKeepPairs,
+			result.outRemovePairs,result.numOutRemovePairs);
+		break;
+	}
+
+	return SCE_PFX_OK;
+}
+
+void PfxWorld::mergePairs(
+	PfxBroadphasePair *outNewPairs,PfxUInt32 numOutNewPairs,
+	PfxBroadphasePair *outKeepPairs,PfxUInt32 numOutKeepPairs,
+	PfxBroadphasePair *outRemovePairs,PfxUInt32 numOutRemovePairs)
+{
+	PfxBroadphasePair *currentPairs = m_pairsBuff[m_pairSwap];
+	PfxUInt32 &numCurrentPairs = m_numPairs[m_pairSwap];
+
+	//J 廃棄ペアのコンタクトをプールに戻す
+	//E Put removed contacts into the contact pool
+	for(PfxUInt32 i=0;i<numOutRemovePairs;i++) {
+		m_contactPool.deallocate(pfxGetContactId(outRemovePairs[i]));
+	}
+
+	//J 新規ペアのコンタクトのリンクと初期化
+	//J 有効なコンタクトの数はペアの容量を超えないため、新しいIDは常に容量内に収まる
+	//E Add new contacts and initialize
+	//E Live contacts never outnumber the pair capacity, so a new ID always fits
+	for(PfxUInt32 i=0;i<numOutNewPairs;i++) {
+		PfxUInt32 cId = 0;
+		PfxInt32 ret = m_contactPool.allocate(pfxGetObjectIdA(outNewPairs[i]),pfxGetObjectIdB(outNewPairs[i]),cId);
+		(void)ret;
+		SCE_PFX_ASSERT(ret == SCE_PFX_OK && cId < m_maxContacts);
+		pfxSetContactId(outNewPairs[i],cId);
+	}
+
+	//J 新規ペアと維持ペアを合成
+	//E Merge 'new' and 'keep' pairs
+	for(PfxUInt32 i=0;i<numOutKeepPairs;i++) {
+		currentPairs[numCurrentPairs++] = outKeepPairs[i];
+	}
+	for(PfxUInt32 i=0;i<numOutNewPairs;i++) {
+		currentPairs[numCurrentPairs++] = outNewPairs[i];
+	}
+}
+
+PfxInt32 PfxWorld::collision()
+{
+	PfxTaskManager *taskManager = m_param.taskManager;
+	PfxInt32 ret = SCE_PFX_OK;
+
+	PfxUInt32 numCurrentPairs = m_numPairs[m_pairSwap];
+	PfxBroadphasePair *currentPairs = m_pairsBuff[m_pairSwap];
+
+	//J 衝突検出
+	//E Detect collisions
+	{
+		PfxDetectCollisionParam param;
+		param.contactPairs = currentPairs;
+		param.numContactPairs = numCurrentPairs;
+		param.offsetContactManifolds = m_contactPool.getManifolds();
+		param.offsetRigidStates = m_states;
+		param.offsetCollidables = m_collidables;
+		param.numRigidBodies = m_numRigidBodies;
+
+		ret = taskManager ?
+			pfxDetectCollision(param,taskManager) :
+			pfxDetectCollision(param);
+		if(ret != SCE_PFX_OK) return ret;
+	}
+
+	//J リフレッシュ
+	//E Refresh contacts
+	{
+		PfxRefreshContactsParam param;
+		param.contactPairs = currentPairs;
+		param.numContactPairs = numCurrentPairs;
+		param.offsetContactManifolds = m_contactPool.getManifolds();
+		param.offsetRigidStates = m_states;
+		param.numRigidBodies = m_numRigidBodies;
+
+		ret = taskManager ?
+			pfxRefreshContacts(param,taskManager) :
+			pfxRefreshContacts(param);
+		if(ret != SCE_PFX_OK) return ret;
+	}
+
+	return SCE_PFX_OK;
+}
+
+PfxInt32 PfxWorld::constraintSolver()
+{
+	PfxTaskManager *taskManager = m_param.taskManager;
+	PfxUInt32 numTasks = getNumTasks();
+	PfxInt32 ret = SCE_PFX_OK;
+
+	PfxUInt32 numCurrentPairs = m_numPairs[m_pairSwap];
+	PfxBroadphasePair *currentPairs = m_pairsBuff[m_pairSwap];
+
+	//J 一時バッファの先頭にソルバー用のコンタクト点を詰め、残りをソルバーの作業領域とする
+	//E Contact points for the solver are packed at the head of the work buffer, and the rest is the solver work area
+	PfxUInt32 contactSolverBytes = SCE_PFX_BYTES_ALIGN128(pfxGetContactSolverBytes(numCurrentPairs));
+	PfxUInt32 solveWorkBytes = pfxGetWorkBytesOfSolveConstraints(m_numRigidBodies,numCurrentPairs,m_numJoints,numTasks);
+	ret = reservePool(contactSolverBytes + solveWorkBytes + SCE_PFX_WORLD_ALLOC_SLACK);
+	if(ret != SCE_PFX_OK) return ret;
+
+	void *contactSolverBuff = m_poolBuff;
+
+	{
+		PfxSetupSolverBodiesParam param;
+		param.states = m_states;
+		param.bodies = m_bodies;
+		param.solverBodies = m_solverBodies;
+		param.numRigidBodies = m_numRigidBodies;
+
+		ret = taskManager ?
+			pfxSetupSolverBodies(param,taskManager) :
+			pfxSetupSolverBodies(param);
+		if(ret != SCE_PFX_OK) return ret;
+	}
+
+	{
+		PfxSetupContactConstraintsParam param;
+		param.contactPairs = currentPairs;
+		param.numContactPairs = numCurrentPairs;
+		param.offsetContactManifolds = m_contactPool.getManifolds();
+		param.offsetRigidStates = m_states;
+		param.offsetRigidBodies = m_bodies;
+		param.offsetSolverBodies = m_solverBodies;
+		param.numRigidBodies = m_numRigidBodies;
+		param.timeStep = m_param.timeStep;
+		param.separateBias = m_param.separateBias;
+		param.contactSolverBuff = contactSolverBuff;
+		param.contactSolverBytes = contactSolverBytes;
+
+		ret = taskManager ?
+			pfxSetupContactConstraints(param,taskManager) :
+			pfxSetupContactConstraints(param);
+		if(ret != SCE_PFX_OK) return ret;
+	}
+
+	{
+		for(PfxUInt32 i=0;i<m_numJoints;i++) {
+			pfxUpdateJointPairs(m_jointPairs[i],i,m_joints[i],m_states[m_joints[i].m_rigidBodyIdA],m_states[m_joints[i].m_rigidBodyIdB]);
+		}
+
+		PfxSetupJointConstraintsParam param;
+		param.jointPairs = m_jointPairs;
+		param.numJointPairs = m_numJoints;
+		param.offsetJoints = m_joints;
+		param.offsetRigidStates = m_states;
+		param.offsetRigidBodies = m_bodies;
+		param.offsetSolverBodies = m_solverBodies;
+		param.numRigidBodies = m_numRigidBodies;
+		param.timeStep = m_param.timeStep;
+
+		ret = taskManager ?
+			pfxSetupJointConstraints(param,taskManager) :
+			pfxSetupJointConstraints(param);
+		if(ret != SCE_PFX_OK) return ret;
+	}
+
+	{
+		PfxSolveConstraintsParam param;
+		param.workBytes = m_poolBytes - contactSolverBytes;
+		param.workBuff = m_poolBuff + contactSolverBytes;
+		param.contactSolverBuff = contactSolverBuff;
+		param.contactSolverBytes = contactSolverBytes;
+		param.contactPairs = currentPairs;
+		param.numContactPairs = numCurrentPairs;
+		param.offsetContactManifolds = m_contactPool.getManifolds();
+		param.jointPairs = m_jointPairs;
+		param.numJointPairs = m_numJoints;
+		param.offsetJoints = m_joints;
+		param.offsetRigidStates = m_states;
+		param.offsetSolverBodies = m_solverBodies;
+		param.numRigidBodies = m_numRigidBodies;
+		param.iteration = m_param.iteration;
+
+		ret = taskManager ?
+			pfxSolveConstraints(param,taskManager) :
+			pfxSolveConstraints(param);
+		if(ret != SCE_PFX_OK) return ret;
+	}
+
+	return SCE_PFX_OK;
+}
+
+PfxInt32 PfxWorld::integrate()
+{
+	PfxUpdateRigidStatesParam param;
+	param.states = m_states;
+	param.bodies = m_bodies;
+	param.numRigidBodies = m_numRigidBodies;
+	param.timeStep = m_param.timeStep;
+
+	return m_param.taskManager ?
+		pfxUpdateRigidStates(param,m_param.taskManager) :
+		pfxUpdateRigidStates(param);
+}
+
+} //namespace PhysicsEffects
+} //namespace sce
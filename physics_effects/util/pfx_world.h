@@ -0,0 +1,213 @@
+/*
+Physics Effects Copyright(C) 2011 Sony Computer Entertainment Inc.
+All rights reserved.
+
+Physics Effects is open software; you can redistribute it and/or
+modify it under the terms of the BSD License.
+
+Physics Effects is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+See the BSD License for more details.
+
+A copy of the BSD License is distributed with
+Physics Effects under the filename: physics_effects_license.txt
+*/
+
+#ifndef _SCE_PFX_WORLD_H
+#define _SCE_PFX_WORLD_H
+
+#include "../low_level/pfx_low_level_include.h"
+#include "pfx_util_common.h"
+#include "pfx_contact_manifold_pool.h"
+
+namespace sce {
+namespace PhysicsEffects {
+
+///////////////////////////////////////////////////////////////////////////////
+// PfxWorld
+
+//J ＜補足＞
+//J 剛体、ジョイント、コンタクト、ペアのバッファと一時バッファを所有し、
+//J ブロードフェーズ→衝突検出→拘束ソルバ→積分の順にシミュレーションを進める。
+//J バッファは不足した時点で拡張され、一時バッファは過去の最大使用量を保持するため
+//J 定常状態ではフレームごとのメモリ確保は発生しない。
+//J taskManagerを指定するとマルチスレッド版の関数を使用する。
+//J 剛体とジョイントの削除はサポートしない。
+
+//E <Notes>
+//E Owns buffers of rigid bodies, joints, contacts, pairs and temporary work, and
+//E steps the simulation in the order broadphase, collision, solver and integration.
+//E Buffers grow when they run short and the work buffer keeps its high-water mark,
+//E so no memory is allocated per frame in a steady state.
+//E The multi thread functions are used if a task manager is given.
+//E Removing rigid bodies and joints is not supported.
+
+struct PfxWorldParam {
+	PfxVector3 worldCenter;
+	PfxVector3 worldExtent;
+	PfxVector3 gravity;
+	PfxFloat timeStep;
+	PfxFloat separateBias;
+	PfxUInt32 iteration;
+	PfxUInt32 outOfWorldBehavior;
+
+	//J 初期容量（不足した場合は自動的に拡張される）
+	//E Initial capacities (grown automatically when exceeded)
+	PfxUInt32 initialRigidBodies;
+	PfxUInt32 initialJoints;
+	PfxUInt32 initialContacts;
+
+	//J NULLの場合はシングルスレッド版を使用する
+	//E The single thread functions are used if NULL
+	PfxTaskManager *taskManager;
+
+	//J インクリメンタルブロードフェーズを使用する（動きの少ない大規模なシーン向け）
+	//E Use the incremental broadphase (suited for large scenes with little movement)
+	PfxBool incrementalBroadphase;
+
+	PfxWorldParam()
+	{
+		worldCenter = PfxVector3(0.0f);
+		worldExtent = PfxVector3(500.0f);
+		gravity = PfxVector3(0.0f,-9.8f,0.0f);
+		timeStep = 0.016f;
+		separateBias = 0.1f;
+		iteration = 5;
+		outOfWorldBehavior = 0;
+		initialRigidBodies = 128;
+		initialJoints = 16;
+		initialContacts = 512;
+		taskManager = NULL;
+		incrementalBroadphase = false;
+	}
+};
+
+class PfxWorld
+{
+private:
+	PfxWorldParam m_param;
+
+	// Rigid bodies
+	PfxUInt32 m_numRigidBodies;
+	PfxUInt32 m_maxRigidBodies;
+	PfxRigidState *m_states;
+	PfxRigidBody *m_bodies;
+	PfxCollidable *m_collidables;
+	PfxSolverBody *m_solverBodies;
+	PfxBroadphaseProxy *m_proxies[6];
+
+	// Joints
+	PfxUInt32 m_numJoints;
+	PfxUInt32 m_maxJoints;
+	PfxJoint *m_joints;
+	PfxConstraintPair *m_jointPairs;
+
+	// Contacts
+	PfxUInt32 m_maxContacts;
+	PfxContactManifoldPool m_contactPool;
+
+	// Pairs
+	PfxUInt32 m_pairSwap;
+	PfxUInt32 m_numPairs[2];
+	PfxBroadphasePair *m_pairsBuff[2];
+
+	// Incremental broadphase
+	PfxIncrementalBroadphase m_incrementalBroadphase;
+	PfxUInt8 *m_incrementalBuff;
+
+	// Work buffer
+	PfxUInt8 *m_poolBuff;
+	PfxUInt32 m_poolBytes;
+
+	PfxUInt32 m_frame;
+
+	PfxInt32 reserveRigidBodies(PfxUInt32 maxRigidBodies);
+	PfxInt32 reserveJoints(PfxUInt32 maxJoints);
+	PfxInt32 reserveContacts(PfxUInt32 maxContacts);
+	PfxInt32 reservePool(PfxUInt32 bytes);
+	PfxInt32 reserveIncrementalBroadphase(PfxUInt32 maxRigidBodies,PfxUInt32 maxPairs);
+
+	PfxInt32 findPairs();
+	PfxInt32 findPairsIncremental();
+	void mergePairs(
+		PfxBroadphasePair *outNewPairs,PfxUInt32 numOutNewPairs,
+		PfxBroadphasePair *outKeepPairs,PfxUInt32 numOutKeepPairs,
+		PfxBroadphasePair *outRemovePairs,PfxUInt32 numOutRemovePairs);
+
+	PfxUInt32 getNumTasks() const {return m_param.taskManager ? m_param.taskManager->getNumTasks() : 1;}
+
+	PfxWorld(const PfxWorld &);
+	PfxWorld &operator=(const PfxWorld &);
+
+public:
+	PfxWorld();
+	~PfxWorld();
+
+	PfxInt32 initialize(const PfxWorldParam &param);
+	void finalize();
+
+	//J 全ての剛体、ジョイント、コンタクトを消去する（容量は維持される）
+	//E Removes all rigid bodies, joints and contacts (capacities are kept)
+	void clear();
+
+	// Rigid bodies
+	PfxInt32 addRigidBody(const PfxRigidState &state,const PfxRigidBody &body,const PfxCollidable &collidable,PfxUInt32 &rigidBodyId);
+
+	PfxUInt32 getNumRigidBodies() const {return m_numRigidBodies;}
+
+	PfxRigidState &getRigidState(PfxUInt32 i) {return m_states[i];}
+	const PfxRigidState &getRigidState(PfxUInt32 i) const {return m_states[i];}
+	PfxRigidBody &getRigidBody(PfxUInt32 i) {return m_bodies[i];}
+	const PfxRigidBody &getRigidBody(PfxUInt32 i) const {return m_bodies[i];}
+	PfxCollidable &getCollidable(PfxUInt32 i) {return m_collidables[i];}
+	const PfxCollidable &getCollidable(PfxUInt32 i) const {return m_collidables[i];}
+
+	// Joints
+	PfxInt32 addJoint(const PfxJoint &joint,PfxUInt32 &jointId);
+
+	PfxUInt32 getNumJoints() const {return m_numJoints;}
+
+	PfxJoint &getJoint(PfxUInt32 i) {return m_joints[i];}
+	const PfxJoint &getJoint(PfxUInt32 i) const {return m_joints[i];}
+
+	// Contacts
+	PfxUInt32 getNumContactPairs() const {return m_numPairs[m_pairSwap];}
+	const PfxBroadphasePair *getContactPairs() const {return m_pairsBuff[m_pairSwap];}
+
+	PfxContactManifold &getContactManifold(PfxUInt32 contactId) {return m_contactPool.getManifold(contactId);}
+	const PfxContactManifold &getContactManifold(PfxUInt32 contactId) const {return m_contactPool.getManifold(contactId);}
+
+	// Parameters
+	const PfxWorldParam &getParam() const {return m_param;}
+
+	void setGravity(const PfxVector3 &gravity) {m_param.gravity = gravity;}
+	void setTimeStep(PfxFloat timeStep) {m_param.timeStep = timeStep;}
+	void setIteration(PfxUInt32 iteration) {m_param.iteration = iteration;}
+	void setTaskManager(PfxTaskManager *taskManager) {m_param.taskManager = taskManager;}
+
+	// Capacities
+	PfxUInt32 getMaxRigidBodies() const {return m_maxRigidBodies;}
+	PfxUInt32 getMaxJoints() const {return m_maxJoints;}
+	PfxUInt32 getMaxContacts() const {return m_maxContacts;}
+	PfxUInt32 getPoolBytes() const {return m_poolBytes;}
+
+	PfxUInt32 getFrame() const {return m_frame;}
+
+	//J 1ステップ進める（重力の適用と各ステージの実行）
+	//E Steps the simulation (applies gravity and runs each stage)
+	PfxInt32 simulate();
+
+	//J 各ステージを個別に実行する場合はsimulate()と同じ順序で呼ぶこと
+	//E Call them in the same order as simulate() when running stages individually
+	void applyGravity();
+	PfxInt32 broadphase();
+	PfxInt32 collision();
+	PfxInt32 constraintSolver();
+	PfxInt32 integrate();
+};
+
+} //namespace PhysicsEffects
+} //namespace sce
+
+#endif // _SCE_PFX_WORLD_H